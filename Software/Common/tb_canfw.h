@@ -0,0 +1,879 @@
+/*****************************************************************************/
+/**
+ * @file tb_canfw.h
+ * @comments CANでのファームウェアの一斉配信(Master -> 全Panel)
+ *           ヘッダのみのC(Master_v2の送信側、Panelのブートローダの受信側、simで使う)
+ *           イメージをブロック(TBFW_BLOCK_SIZE, ATmega328Pのフラッシュの1ページ)に分け、
+ *           全Panelへ同じフレームを1回だけ流す。各Panelは足りないブロックを
+ *           ビットマップで返し(NACK)、Masterは全Panelの足りない分の和だけを送り直す。
+ *
+ *           手順(問い合わせはグループ宛て0x400、[0] bit7..5: TBCAN_VER_CTRL)
+ *             BEGIN : [1..2] イメージのバイト数(LE) [3] バージョン(メジャー) [4] (マイナー)
+ *                     [5] TBCAN_CMD_FW_BEGIN [6] セッション番号
+ *                     -> PanelはREADY(書き換えられない場合はNO_BOOT / TOO_BIG)を返す
+ *             データ: TBCAN_ID_FW_DATA  [0] ブロック番号 [1] チャンク番号(0..TBFW_CHUNKS-1)
+ *                     [2..7] データ(最後のチャンクはブロックの残り、DLCで分かる)
+ *                     イメージの末尾を越えた所は0xFF(消去済みのフラッシュと同じ)で埋める
+ *             END   : [1..4] イメージ全体のCRC32(LE) [5] TBCAN_CMD_FW_END [6] セッション番号
+ *                     -> 全ブロックがあればフラッシュを読み返してCRCを確かめ、OK / CRC_NG、
+ *                        足りなければMISSINGを返す
+ *             COMMIT: [5] TBCAN_CMD_FW_COMMIT [6] セッション番号
+ *                     -> OKのPanelはDONEを返して新しいファームウェアで起動する
+ *           MasterはMISSINGの和を送り直してENDを繰り返す(TBFW_ROUNDS_MAX周まで)。
+ *
+ *           応答(Panel -> Master, TBCAN_ID_FW_REPLY_BASE + PanelID)
+ *             [0] bit7..5: TBCAN_VER_CTRL  bit4..0: PanelID
+ *             [1] TBFW_ST_*  [2] セッション番号
+ *             [3] bit7: この応答の最後のフレーム  bit2..0: 窓(TBFW_WINDOW_BLOCKS毎)
+ *             [4..7] MISSINGのみ: 窓の中の足りないブロック(LE, bit = ブロック番号 - 窓の先頭)
+ *             足りないブロックのある窓の数だけ続けて送る。PanelID順に
+ *             TBFW_REPLY_SLOT_MSずつずらす(TBCAN_DISCOVER_SLOT_MSと同じ考え方)。
+ *
+ *           ブートローダのCANの設定(MCP2515, ロールオーバーあり)
+ *             RXM0 0x7FF: RXF0 TBCAN_ID_FW_DATA, RXF1 PanelID
+ *             RXM1 グループのマスク(Panel_v2と同じ): RXF2..5 TBCAN_ID_GROUP_FLAG
+ *           AVRのフラッシュ(SPM)はブートセクションからしか書けないので、受信側は
+ *           ブートローダで使う。アプリケーション(Panel_v2)はBEGINにNO_BOOTを返す。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef COMMON_TB_CANFW_H
+#define COMMON_TB_CANFW_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "tb_canproto.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* ブロック(フラッシュの1ページ)、チャンク(データフレーム1つ分) */
+#define TBFW_BLOCK_SIZE 128
+#define TBFW_BLOCK_MAX 256
+#define TBFW_IMAGE_MAX ((uint32_t)TBFW_BLOCK_SIZE * TBFW_BLOCK_MAX) // 32KB
+#define TBFW_CHUNK_SIZE 6
+#define TBFW_CHUNKS ((TBFW_BLOCK_SIZE + TBFW_CHUNK_SIZE - 1) / TBFW_CHUNK_SIZE)
+#define TBFW_DATA_HDR 2
+
+/* NACKの窓(1フレームで返すブロック数) */
+#define TBFW_WINDOW_BLOCKS 32
+#define TBFW_WINDOW_NUM (TBFW_BLOCK_MAX / TBFW_WINDOW_BLOCKS)
+#define TBFW_REPLY_LAST 0x80
+#define TBFW_REPLY_WINDOW_MASK 0x07
+
+/* 応答の状態 */
+#define TBFW_ST_READY 1   // BEGINを受けた(全ブロックを待つ)
+#define TBFW_ST_MISSING 2 // 足りないブロックがある
+#define TBFW_ST_OK 3      // 全ブロックあり、CRCが合った
+#define TBFW_ST_CRC_NG 4  // 全ブロックあるがCRCが合わない(全部捨てて受け直す)
+#define TBFW_ST_DONE 5    // 確定した(新しいファームウェアで起動する)
+#define TBFW_ST_NO_BOOT 6 // ブートローダが無い(書き換えられない)
+#define TBFW_ST_TOO_BIG 7 // イメージが書ける領域より大きい
+
+/*
+ * 時間
+ * REPLY_SLOT : PanelID毎の応答のずらし[ms](MISSINGの最大TBFW_WINDOW_NUMフレームが入る)
+ * VERIFY     : ENDを受けてからCRCを確かめ終えるまでの見込み[ms]
+ *              (ATmega328P 16MHz, ビット毎のCRC32で32KBを読み返す)
+ * REPLY_WAIT : 問い合わせから全Panelの応答を待つ時間[ms](ENDはVERIFYを足す)
+ */
+#define TBFW_REPLY_SLOT_MS 3
+#define TBFW_VERIFY_MS 250
+#define TBFW_REPLY_WAIT_MS (TBCAN_GRID_SIZE * TBCAN_GRID_SIZE * TBFW_REPLY_SLOT_MS + 20)
+
+/*
+ * 送信側の既定値(vTbFwTxStartの後で変えてよい)
+ * FRAME_GAP : データフレームの間隔[us]。0: 間隔を空けず、送信キューが空くのを待つだけ
+ *             (バスの容量で送る。500kbpsで8byteのフレームは約250us)
+ * BLOCK_GAP : ブロックの最後のフレームを渡してからの間隔[us]
+ *             (Panelがページを消去・書き込みする約9ms + 送信キューに残ったフレームの分)
+ */
+#define TBFW_FRAME_GAP_US 0
+#define TBFW_BLOCK_GAP_US 12000
+#define TBFW_BEGIN_TRIES 5  // BEGINを送る回数(応答の無いPanelがいる間)
+#define TBFW_ROUNDS_MAX 10  // 送り直し(END)の周回の上限
+#define TBFW_COMMIT_TRIES 3 // COMMITを送る回数(DONEの無いPanelがいる間)
+
+/* 受信側の状態 */
+#define TBFW_RX_IDLE 0
+#define TBFW_RX_RECV 1     // BEGINを受けた
+#define TBFW_RX_VERIFIED 2 // CRCが合った(COMMIT待ち)
+#define TBFW_RX_DONE 3     // 確定した
+
+/* 送信側の状態 */
+#define TBFW_TX_IDLE 0
+#define TBFW_TX_BEGIN 1
+#define TBFW_TX_WAIT_READY 2
+#define TBFW_TX_DATA 3
+#define TBFW_TX_END 4
+#define TBFW_TX_WAIT_STATUS 5
+#define TBFW_TX_COMMIT 6
+#define TBFW_TX_WAIT_DONE 7
+#define TBFW_TX_FINISHED 8 // 1枚以上確定した(結果はマスクを見る)
+#define TBFW_TX_FAILED 9   // 1枚も書き換えられなかった
+
+#define TBFW_PANEL_ALL (((1UL << (TBCAN_GRID_SIZE * TBCAN_GRID_SIZE + 1)) - 1) & ~1UL)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 受信側のフラッシュの読み書き(ブートローダ / sim) */
+typedef struct TBFW_IO
+{
+    /* 1ブロック書く(1: 成功) */
+    uint8_t (*bWrite)(void *pvCtx, uint8_t bBlock, const uint8_t *pbPage);
+    /* 書いたイメージを読む(CRCの確認用) */
+    void (*vRead)(void *pvCtx, uint16_t usOffset, uint8_t *pbData, uint8_t bLen);
+    void *pvCtx;
+} tbFwIo_t;
+
+/* 受信側(Panel, 約170byte) */
+typedef struct TBFW_RX
+{
+    uint8_t bState;   // TBFW_RX_*
+    uint8_t bStatus;  // 次に返す応答(TBFW_ST_*)
+    uint8_t bSession;
+    uint16_t usSize;  // イメージのバイト数
+    uint16_t usBlocks;
+    uint16_t usMaxSize; // 書ける領域のバイト数
+    uint16_t usCur;     // 組み立て中のブロック
+    uint32_t ulChunks;  // 組み立て中のブロックの受けたチャンク(0: 組み立てていない)
+    uint8_t bHave[TBFW_BLOCK_MAX / 8]; // 書いたブロック
+    uint8_t bPage[TBFW_BLOCK_SIZE];
+} tbFwRx_t;
+
+/* 応答を読んだもの */
+typedef struct TBFW_REPLY
+{
+    uint8_t bPanelId;
+    uint8_t bStatus;
+    uint8_t bSession;
+    uint8_t bWindow;
+    uint8_t bLast;
+    uint32_t ulMissing;
+} tbFwReply_t;
+
+/* 送信側(Master) */
+typedef struct TBFW_TX
+{
+    const uint8_t *pbImage;
+    uint16_t usSize;
+    uint16_t usBlocks;
+    uint32_t ulCrc;
+    uint8_t bFwMajor;
+    uint8_t bFwMinor;
+    uint8_t bSession;
+    uint8_t bState;  // TBFW_TX_*
+    uint8_t bTries;  // 今の問い合わせを送った回数
+    uint8_t bRound;  // データを送った周回(1から)
+    uint16_t usBlock; // 次に送るブロック
+    uint8_t bChunk;   // 次に送るチャンク
+    uint32_t ulDueUs; // 次に送る／待ちの終わりの時刻
+    /* 送り方(vTbFwTxStartで既定値) */
+    uint32_t ulFrameGapUs;
+    uint32_t ulBlockGapUs;
+    uint32_t ulReplyWaitUs;
+    uint32_t ulVerifyUs;
+    /* Panel(bit = PanelID) */
+    uint32_t ulTargets; // 書き換えるPanel
+    uint32_t ulReady;   // BEGINにREADYを返した
+    uint32_t ulRefused; // NO_BOOT / TOO_BIG
+    uint32_t ulOk;      // CRCが合った
+    uint32_t ulDone;    // DONEを返した
+    uint32_t ulHeard;   // 今の待ちで応答し終えた
+    uint8_t bSend[TBFW_BLOCK_MAX / 8]; // この周に送るブロック
+    uint8_t bNack[TBFW_BLOCK_MAX / 8]; // 次の周に送るブロック(MISSINGの和)
+    /* 統計 */
+    uint32_t ulDataFrames;
+    uint32_t ulCtrlFrames;
+    uint32_t ulBlocksSent;
+    uint32_t ulBlocksResent; // 2周目以降に送ったブロック
+    uint32_t ulStartUs;
+    uint32_t ulEndUs;
+} tbFwTx_t;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+
+/* ビットマップ(bit = ブロック番号 / PanelID) */
+static inline uint8_t bTbFwBit(const uint8_t *pbMap, uint16_t usIdx)
+{
+    return (uint8_t)((pbMap[usIdx >> 3] >> (usIdx & 7)) & 1);
+}
+
+static inline void vTbFwSetBit(uint8_t *pbMap, uint16_t usIdx)
+{
+    pbMap[usIdx >> 3] |= (uint8_t)(1 << (usIdx & 7));
+}
+
+static inline void vTbFwFill(uint8_t *pbMap, uint8_t bValue)
+{
+    uint8_t i;
+
+    for (i = 0; i < TBFW_BLOCK_MAX / 8; i++)
+        pbMap[i] = bValue;
+}
+
+/*****************************************************************************/
+/**
+ * CRC32(IEEE 802.3, zlibのcrc32()と同じ)
+ *
+ * @param    ulCrc: 前回の戻り値(最初は0)
+ * @param    pbData: データ
+ * @param    usLen: バイト数
+ *
+ * @return   uint32_t CRC
+ *
+ * @note     表を持たない(ブートローダの大きさを優先)
+ *
+ ******************************************************************************/
+static inline uint32_t ulTbFwCrc32(uint32_t ulCrc, const uint8_t *pbData, uint16_t usLen)
+{
+    uint8_t i;
+
+    ulCrc = ~ulCrc;
+    while (usLen--)
+    {
+        ulCrc ^= *pbData++;
+        for (i = 0; i < 8; i++)
+            ulCrc = (ulCrc >> 1) ^ (0xEDB88320UL & (0UL - (ulCrc & 1)));
+    }
+    return ~ulCrc;
+}
+
+/* ブロック数 */
+static inline uint16_t usTbFwBlocks(uint16_t usSize)
+{
+    return (uint16_t)(((uint32_t)usSize + TBFW_BLOCK_SIZE - 1) / TBFW_BLOCK_SIZE);
+}
+
+/* チャンクのデータのバイト数 */
+static inline uint8_t bTbFwChunkLen(uint8_t bChunk)
+{
+    uint8_t bOff = (uint8_t)(bChunk * TBFW_CHUNK_SIZE);
+
+    return (uint8_t)(TBFW_BLOCK_SIZE - bOff < TBFW_CHUNK_SIZE ? TBFW_BLOCK_SIZE - bOff
+                                                              : TBFW_CHUNK_SIZE);
+}
+
+/*****************************************************************************/
+/**
+ * 問い合わせ(BEGIN / END / COMMIT)のフレームを作る
+ *
+ * @param    bCmd: TBCAN_CMD_FW_*
+ * @param    bSession: セッション番号
+ * @param    ulArg: BEGIN: [15..0]バイト数 [23..16]メジャー [31..24]マイナー / END: CRC32
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwEncodeCtrl(uint8_t bCmd, uint8_t bSession, uint32_t ulArg,
+                                      uint8_t *pbData)
+{
+    bTbCanEncodeCtrl(bCmd, pbData);
+    if (bCmd != TBCAN_CMD_FW_COMMIT)
+    {
+        pbData[1] = (uint8_t)ulArg;
+        pbData[2] = (uint8_t)(ulArg >> 8);
+        pbData[3] = (uint8_t)(ulArg >> 16);
+        pbData[4] = (uint8_t)(ulArg >> 24);
+    }
+    pbData[6] = bSession;
+    return TBCAN_DLC;
+}
+
+/* 問い合わせの引数(bTbFwEncodeCtrlのulArg) */
+static inline uint32_t ulTbFwCtrlArg(const uint8_t *pbData)
+{
+    return (uint32_t)pbData[1] | (uint32_t)pbData[2] << 8 | (uint32_t)pbData[3] << 16 |
+           (uint32_t)pbData[4] << 24;
+}
+
+/*****************************************************************************/
+/**
+ * データフレームを作る
+ *
+ * @param    pbImage: イメージ
+ * @param    usSize: イメージのバイト数
+ * @param    usBlock: ブロック番号
+ * @param    bChunk: チャンク番号
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     CAN IDはTBCAN_ID_FW_DATA
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwEncodeData(const uint8_t *pbImage, uint16_t usSize, uint16_t usBlock,
+                                      uint8_t bChunk, uint8_t *pbData)
+{
+    uint32_t ulOff = (uint32_t)usBlock * TBFW_BLOCK_SIZE + (uint32_t)bChunk * TBFW_CHUNK_SIZE;
+    uint8_t bLen = bTbFwChunkLen(bChunk);
+    uint8_t i;
+
+    pbData[0] = (uint8_t)usBlock;
+    pbData[1] = bChunk;
+    for (i = 0; i < bLen; i++)
+        pbData[TBFW_DATA_HDR + i] = ulOff + i < usSize ? pbImage[ulOff + i] : 0xFF;
+    return (uint8_t)(TBFW_DATA_HDR + bLen);
+}
+
+/*****************************************************************************/
+/**
+ * 応答のフレームを作る／読む
+ *
+ * @param    bPanelId: PanelID
+ * @param    bStatus: TBFW_ST_*
+ * @param    bSession: セッション番号
+ * @param    bWindow: 窓(TBFW_REPLY_LASTを含む)
+ * @param    ulMissing: 窓の中の足りないブロック
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     CAN IDはTBCAN_ID_FW_REPLY_BASE + PanelID
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwEncodeReply(uint8_t bPanelId, uint8_t bStatus, uint8_t bSession,
+                                       uint8_t bWindow, uint32_t ulMissing, uint8_t *pbData)
+{
+    pbData[0] = (uint8_t)((TBCAN_VER_CTRL << TBCAN_VER_SHIFT) | (bPanelId & TBCAN_ID_MASK));
+    pbData[1] = bStatus;
+    pbData[2] = bSession;
+    pbData[3] = bWindow;
+    pbData[4] = (uint8_t)ulMissing;
+    pbData[5] = (uint8_t)(ulMissing >> 8);
+    pbData[6] = (uint8_t)(ulMissing >> 16);
+    pbData[7] = (uint8_t)(ulMissing >> 24);
+    return TBCAN_DLC;
+}
+
+static inline uint8_t bTbFwDecodeReply(uint32_t ulCanId, const uint8_t *pbData, uint8_t bDlc,
+                                       tbFwReply_t *pxReply)
+{
+    if (!TBCAN_ID_IS_FW_REPLY(ulCanId) || bDlc < TBCAN_DLC ||
+        (pbData[0] >> TBCAN_VER_SHIFT) != TBCAN_VER_CTRL ||
+        (pbData[0] & TBCAN_ID_MASK) != (ulCanId & TBCAN_ID_MASK))
+    {
+        return 0;
+    }
+    pxReply->bPanelId = pbData[0] & TBCAN_ID_MASK;
+    pxReply->bStatus = pbData[1];
+    pxReply->bSession = pbData[2];
+    pxReply->bWindow = pbData[3] & TBFW_REPLY_WINDOW_MASK;
+    pxReply->bLast = (pbData[3] & TBFW_REPLY_LAST) ? 1 : 0;
+    pxReply->ulMissing = (uint32_t)pbData[4] | (uint32_t)pbData[5] << 8 |
+                         (uint32_t)pbData[6] << 16 | (uint32_t)pbData[7] << 24;
+    return 1;
+}
+
+/*****************************************************************************/
+/**
+ * 受信側: 初期化
+ *
+ * @param    pxRx: 受信側の状態
+ * @param    usMaxSize: 書ける領域のバイト数(ブートローダの手前まで)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline void vTbFwRxInit(tbFwRx_t *pxRx, uint16_t usMaxSize)
+{
+    pxRx->bState = TBFW_RX_IDLE;
+    pxRx->bStatus = 0;
+    pxRx->bSession = 0;
+    pxRx->usSize = 0;
+    pxRx->usBlocks = 0;
+    pxRx->usMaxSize = usMaxSize;
+    pxRx->usCur = 0;
+    pxRx->ulChunks = 0;
+    vTbFwFill(pxRx->bHave, 0);
+}
+
+/* 受信側: 窓の中の足りないブロック */
+static inline uint32_t ulTbFwRxMissing(const tbFwRx_t *pxRx, uint8_t bWindow)
+{
+    uint32_t ulMissing = 0;
+    uint16_t usBlock = (uint16_t)bWindow * TBFW_WINDOW_BLOCKS;
+    uint8_t i;
+
+    for (i = 0; i < TBFW_WINDOW_BLOCKS && usBlock + i < pxRx->usBlocks; i++)
+    {
+        if (!bTbFwBit(pxRx->bHave, (uint16_t)(usBlock + i)))
+            ulMissing |= 1UL << i;
+    }
+    return ulMissing;
+}
+
+/* 受信側: 読み返したイメージのCRC32(ページバッファを使う) */
+static inline uint32_t ulTbFwRxCrc(tbFwRx_t *pxRx, const tbFwIo_t *pxIo)
+{
+    uint32_t ulCrc = 0;
+    uint16_t usOff;
+    uint8_t bLen;
+
+    for (usOff = 0; usOff < pxRx->usSize; usOff = (uint16_t)(usOff + bLen))
+    {
+        bLen = (uint8_t)(pxRx->usSize - usOff < TBFW_BLOCK_SIZE ? pxRx->usSize - usOff
+                                                                 : TBFW_BLOCK_SIZE);
+        pxIo->vRead(pxIo->pvCtx, usOff, pxRx->bPage, bLen);
+        ulCrc = ulTbFwCrc32(ulCrc, pxRx->bPage, bLen);
+    }
+    return ulCrc;
+}
+
+/* 受信側: データフレーム。ブロックが揃ったら書く */
+static inline void vTbFwRxData(tbFwRx_t *pxRx, const tbFwIo_t *pxIo, const uint8_t *pbData,
+                               uint8_t bDlc)
+{
+    uint16_t usBlock = pbData[0];
+    uint8_t bChunk = pbData[1];
+    uint8_t i;
+
+    if (pxRx->bState != TBFW_RX_RECV || bChunk >= TBFW_CHUNKS || usBlock >= pxRx->usBlocks ||
+        bDlc != TBFW_DATA_HDR + bTbFwChunkLen(bChunk) || bTbFwBit(pxRx->bHave, usBlock))
+    {
+        return;
+    }
+    // 別のブロックが来た: 組み立て中のブロックは捨てる(NACKで送り直させる)
+    if (pxRx->ulChunks != 0 && pxRx->usCur != usBlock)
+        pxRx->ulChunks = 0;
+    pxRx->usCur = usBlock;
+    for (i = 0; i < bDlc - TBFW_DATA_HDR; i++)
+        pxRx->bPage[bChunk * TBFW_CHUNK_SIZE + i] = pbData[TBFW_DATA_HDR + i];
+    pxRx->ulChunks |= 1UL << bChunk;
+    if (pxRx->ulChunks != (1UL << TBFW_CHUNKS) - 1)
+        return;
+    pxRx->ulChunks = 0;
+    if (pxIo->bWrite(pxIo->pvCtx, (uint8_t)usBlock, pxRx->bPage))
+        vTbFwSetBit(pxRx->bHave, usBlock);
+}
+
+/*****************************************************************************/
+/**
+ * 受信側: フレームを受けた
+ *
+ * @param    pxRx: 受信側の状態
+ * @param    pxIo: フラッシュの読み書き
+ * @param    ulCanId: CAN ID
+ * @param    pbData / bDlc: 受信データ
+ *
+ * @return   返す応答のフレーム数(0: 返さない)。bTbFwRxReplyで1つずつ作る
+ *
+ * @note     応答はPanelID毎にTBFW_REPLY_SLOT_MSずらして送ること。
+ *           DONEを返したら新しいファームウェアで起動してよい
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwRxFrame(tbFwRx_t *pxRx, const tbFwIo_t *pxIo, uint32_t ulCanId,
+                                   const uint8_t *pbData, uint8_t bDlc)
+{
+    uint8_t bCmd;
+    uint8_t bReplies = 0;
+    uint8_t i;
+    uint32_t ulArg;
+
+    if (ulCanId == TBCAN_ID_FW_DATA)
+    {
+        vTbFwRxData(pxRx, pxIo, pbData, bDlc);
+        return 0;
+    }
+    bCmd = bTbCanDecodeCtrl(pbData, bDlc);
+    if (bCmd < TBCAN_CMD_FW_BEGIN || bCmd > TBCAN_CMD_FW_COMMIT)
+        return 0;
+    ulArg = ulTbFwCtrlArg(pbData);
+
+    if (bCmd == TBCAN_CMD_FW_BEGIN)
+    {
+        // 同じセッションのBEGIN(READYが失われた)は受けたブロックを残す
+        if (pxRx->bState == TBFW_RX_RECV && pxRx->bSession == pbData[6])
+        {
+            pxRx->bStatus = TBFW_ST_READY;
+            return 1;
+        }
+        pxRx->bSession = pbData[6];
+        pxRx->usSize = (uint16_t)ulArg;
+        pxRx->usBlocks = usTbFwBlocks(pxRx->usSize);
+        pxRx->ulChunks = 0;
+        vTbFwFill(pxRx->bHave, 0);
+        if (pxRx->usSize == 0 || pxRx->usSize > pxRx->usMaxSize ||
+            pxRx->usBlocks > TBFW_BLOCK_MAX)
+        {
+            pxRx->bState = TBFW_RX_IDLE;
+            pxRx->bStatus = TBFW_ST_TOO_BIG;
+            return 1;
+        }
+        pxRx->bState = TBFW_RX_RECV;
+        pxRx->bStatus = TBFW_ST_READY;
+        return 1;
+    }
+
+    if (pxRx->bState == TBFW_RX_IDLE || pxRx->bSession != pbData[6])
+        return 0;
+
+    if (bCmd == TBCAN_CMD_FW_END)
+    {
+        if (pxRx->bState != TBFW_RX_RECV)
+            return 1; // 確かめ済み(OKが失われた)
+        for (i = 0; i < TBFW_WINDOW_NUM; i++)
+        {
+            if (ulTbFwRxMissing(pxRx, i) != 0)
+                bReplies++;
+        }
+        if (bReplies > 0)
+        {
+            pxRx->bStatus = TBFW_ST_MISSING;
+            return bReplies;
+        }
+        if (ulTbFwRxCrc(pxRx, pxIo) == ulArg)
+        {
+            pxRx->bState = TBFW_RX_VERIFIED;
+            pxRx->bStatus = TBFW_ST_OK;
+        }
+        else
+        {
+            vTbFwFill(pxRx->bHave, 0);
+            pxRx->bStatus = TBFW_ST_CRC_NG;
+        }
+        return 1;
+    }
+
+    // COMMIT: 確かめたPanelだけ
+    if (pxRx->bState != TBFW_RX_VERIFIED && pxRx->bState != TBFW_RX_DONE)
+        return 0;
+    pxRx->bState = TBFW_RX_DONE;
+    pxRx->bStatus = TBFW_ST_DONE;
+    return 1;
+}
+
+/*****************************************************************************/
+/**
+ * 受信側: 応答のフレームを作る
+ *
+ * @param    pxRx: 受信側の状態
+ * @param    bPanelId: PanelID
+ * @param    bIdx: 何番目の応答か(0 .. bTbFwRxFrameの戻り値 - 1)
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     CAN IDはTBCAN_ID_FW_REPLY_BASE + PanelID
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwRxReply(const tbFwRx_t *pxRx, uint8_t bPanelId, uint8_t bIdx,
+                                   uint8_t *pbData)
+{
+    uint8_t bWindow = TBFW_REPLY_LAST;
+    uint32_t ulMissing = 0;
+    uint8_t bLeft = bIdx;
+    uint8_t i;
+
+    if (pxRx->bStatus == TBFW_ST_MISSING)
+    {
+        for (i = 0; i < TBFW_WINDOW_NUM; i++)
+        {
+            uint32_t ulBits = ulTbFwRxMissing(pxRx, i);
+            if (ulBits == 0)
+                continue;
+            if (ulMissing != 0)
+                break; // 後ろにまだある
+            if (bLeft-- == 0)
+            {
+                ulMissing = ulBits;
+                bWindow = i;
+            }
+        }
+        if (i == TBFW_WINDOW_NUM)
+            bWindow |= TBFW_REPLY_LAST;
+    }
+    return bTbFwEncodeReply(bPanelId, pxRx->bStatus, pxRx->bSession, bWindow, ulMissing, pbData);
+}
+
+/*****************************************************************************/
+/**
+ * 送信側: 開始
+ *
+ * @param    pxTx: 送信側の状態
+ * @param    pbImage / usSize: イメージ(終わるまで保持すること)
+ * @param    bFwMajor / bFwMinor: イメージのバージョン
+ * @param    bSession: セッション番号(前回と変えること)
+ * @param    ulTargets: 書き換えるPanel(bit = PanelID)
+ * @param    ulNowUs: 現在時刻[us]
+ *
+ * @return   ##
+ *
+ * @note     大きすぎる／空のイメージはTBFW_TX_FAILEDになる
+ *
+ ******************************************************************************/
+static inline void vTbFwTxStart(tbFwTx_t *pxTx, const uint8_t *pbImage, uint16_t usSize,
+                                uint8_t bFwMajor, uint8_t bFwMinor, uint8_t bSession,
+                                uint32_t ulTargets, uint32_t ulNowUs)
+{
+    uint8_t *pbRaw = (uint8_t *)pxTx;
+    uint16_t i;
+
+    for (i = 0; i < sizeof(*pxTx); i++)
+        pbRaw[i] = 0;
+    pxTx->pbImage = pbImage;
+    pxTx->usSize = usSize;
+    pxTx->usBlocks = usTbFwBlocks(usSize);
+    pxTx->ulCrc = ulTbFwCrc32(0, pbImage, usSize);
+    pxTx->bFwMajor = bFwMajor;
+    pxTx->bFwMinor = bFwMinor;
+    pxTx->bSession = bSession;
+    pxTx->ulTargets = ulTargets;
+    pxTx->ulFrameGapUs = TBFW_FRAME_GAP_US;
+    pxTx->ulBlockGapUs = TBFW_BLOCK_GAP_US;
+    pxTx->ulReplyWaitUs = TBFW_REPLY_WAIT_MS * 1000UL;
+    pxTx->ulVerifyUs = TBFW_VERIFY_MS * 1000UL;
+    pxTx->ulDueUs = ulNowUs;
+    pxTx->ulStartUs = ulNowUs;
+    pxTx->ulEndUs = ulNowUs;
+    pxTx->bState = (usSize == 0 || pxTx->usBlocks > TBFW_BLOCK_MAX || ulTargets == 0)
+                       ? TBFW_TX_FAILED
+                       : TBFW_TX_BEGIN;
+}
+
+/* 送信側: 終わったか */
+static inline uint8_t bTbFwTxFinished(const tbFwTx_t *pxTx)
+{
+    return pxTx->bState == TBFW_TX_FINISHED || pxTx->bState == TBFW_TX_FAILED ||
+           pxTx->bState == TBFW_TX_IDLE;
+}
+
+/* 送信側: 次にbTbFwTxPollを呼ぶまでの時間[us](終わったらUINT32_MAX) */
+static inline uint32_t ulTbFwTxWaitUs(const tbFwTx_t *pxTx, uint32_t ulNowUs)
+{
+    int32_t lLeft = (int32_t)(pxTx->ulDueUs - ulNowUs);
+
+    if (bTbFwTxFinished(pxTx))
+        return UINT32_MAX;
+    return lLeft > 0 ? (uint32_t)lLeft : 0;
+}
+
+/*****************************************************************************/
+/**
+ * 送信側: 応答を受けた
+ *
+ * @param    pxTx: 送信側の状態
+ * @param    ulCanId / pbData / bDlc: 受信したフレーム(TBCAN_ID_IS_FW_REPLY)
+ *
+ * @return   ##
+ *
+ * @note     他のセッション、待っていない応答は捨てる
+ *
+ ******************************************************************************/
+static inline void vTbFwTxReply(tbFwTx_t *pxTx, uint32_t ulCanId, const uint8_t *pbData,
+                                uint8_t bDlc)
+{
+    tbFwReply_t xReply;
+    uint32_t ulBit;
+    uint16_t usBlock;
+    uint8_t i;
+
+    if (!bTbFwDecodeReply(ulCanId, pbData, bDlc, &xReply) || xReply.bSession != pxTx->bSession)
+        return;
+    ulBit = 1UL << xReply.bPanelId;
+    if ((pxTx->ulTargets & ulBit) == 0)
+        return;
+
+    switch (pxTx->bState)
+    {
+    case TBFW_TX_WAIT_READY:
+        if (xReply.bStatus == TBFW_ST_READY)
+            pxTx->ulReady |= ulBit;
+        else if (xReply.bStatus == TBFW_ST_NO_BOOT || xReply.bStatus == TBFW_ST_TOO_BIG)
+            pxTx->ulRefused |= ulBit;
+        pxTx->ulHeard |= ulBit;
+        break;
+    case TBFW_TX_WAIT_STATUS:
+        if ((pxTx->ulReady & ulBit) == 0)
+            break;
+        if (xReply.bStatus == TBFW_ST_MISSING)
+        {
+            usBlock = (uint16_t)xReply.bWindow * TBFW_WINDOW_BLOCKS;
+            for (i = 0; i < TBFW_WINDOW_BLOCKS; i++)
+            {
+                if ((xReply.ulMissing & (1UL << i)) != 0 && usBlock + i < pxTx->usBlocks)
+                    vTbFwSetBit(pxTx->bNack, (uint16_t)(usBlock + i));
+            }
+            if (xReply.bLast)
+                pxTx->ulHeard |= ulBit;
+        }
+        else if (xReply.bStatus == TBFW_ST_CRC_NG)
+        {
+            vTbFwFill(pxTx->bNack, 0xFF); // 全部送り直す
+            pxTx->ulHeard |= ulBit;
+        }
+        else if (xReply.bStatus == TBFW_ST_OK)
+        {
+            pxTx->ulOk |= ulBit;
+            pxTx->ulHeard |= ulBit;
+        }
+        break;
+    case TBFW_TX_WAIT_DONE:
+        if (xReply.bStatus == TBFW_ST_DONE)
+            pxTx->ulDone |= ulBit;
+        break;
+    default:
+        break;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 送信側: 次に送るフレーム
+ *
+ * @param    pxTx: 送信側の状態
+ * @param    ulNowUs: 現在時刻[us]
+ * @param    pulCanId / pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC(0: 今は送らない、ulTbFwTxWaitUs後にまた呼ぶ)
+ *
+ * @note     応答を受けたらすぐにまた呼ぶこと(全員が応答したら待ちを切り上げる)
+ *
+ ******************************************************************************/
+static inline uint8_t bTbFwTxPoll(tbFwTx_t *pxTx, uint32_t ulNowUs, uint32_t *pulCanId,
+                                  uint8_t *pbData)
+{
+    uint32_t ulPending;
+    uint8_t bDlc;
+    uint8_t bExpired = (int32_t)(ulNowUs - pxTx->ulDueUs) >= 0;
+    uint8_t i;
+
+    *pulCanId = TBCAN_ID_GROUP_FLAG; // 全Panel(問い合わせ)
+    switch (pxTx->bState)
+    {
+    case TBFW_TX_BEGIN:
+        pxTx->bTries++;
+        pxTx->ulHeard = 0;
+        pxTx->bState = TBFW_TX_WAIT_READY;
+        pxTx->ulDueUs = ulNowUs + pxTx->ulReplyWaitUs;
+        pxTx->ulCtrlFrames++;
+        return bTbFwEncodeCtrl(TBCAN_CMD_FW_BEGIN, pxTx->bSession,
+                               (uint32_t)pxTx->usSize | (uint32_t)pxTx->bFwMajor << 16 |
+                                   (uint32_t)pxTx->bFwMinor << 24,
+                               pbData);
+
+    case TBFW_TX_WAIT_READY:
+        ulPending = pxTx->ulTargets & ~(pxTx->ulReady | pxTx->ulRefused);
+        if (ulPending != 0 && !bExpired)
+            return 0;
+        if (ulPending != 0 && pxTx->bTries < TBFW_BEGIN_TRIES)
+        {
+            pxTx->bState = TBFW_TX_BEGIN; // 起動中のPanel(ブートローダへ入る途中)を待つ
+            return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+        }
+        if (pxTx->ulReady == 0)
+        {
+            pxTx->bState = TBFW_TX_FAILED;
+            pxTx->ulEndUs = ulNowUs;
+            return 0;
+        }
+        vTbFwFill(pxTx->bSend, 0xFF);
+        pxTx->bRound = 1;
+        pxTx->usBlock = 0;
+        pxTx->bChunk = 0;
+        pxTx->bState = TBFW_TX_DATA;
+        pxTx->ulDueUs = ulNowUs;
+        return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+
+    case TBFW_TX_DATA:
+        if (!bExpired)
+            return 0;
+        while (pxTx->usBlock < pxTx->usBlocks && !bTbFwBit(pxTx->bSend, pxTx->usBlock))
+            pxTx->usBlock++;
+        if (pxTx->usBlock >= pxTx->usBlocks)
+        {
+            pxTx->bState = TBFW_TX_END;
+            return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+        }
+        *pulCanId = TBCAN_ID_FW_DATA;
+        bDlc = bTbFwEncodeData(pxTx->pbImage, pxTx->usSize, pxTx->usBlock, pxTx->bChunk, pbData);
+        pxTx->ulDataFrames++;
+        if (++pxTx->bChunk < TBFW_CHUNKS)
+        {
+            pxTx->ulDueUs = ulNowUs + pxTx->ulFrameGapUs;
+            return bDlc;
+        }
+        pxTx->bChunk = 0;
+        pxTx->usBlock++;
+        pxTx->ulBlocksSent++;
+        if (pxTx->bRound > 1)
+            pxTx->ulBlocksResent++;
+        pxTx->ulDueUs = ulNowUs + pxTx->ulBlockGapUs;
+        return bDlc;
+
+    case TBFW_TX_END:
+        pxTx->ulHeard = 0;
+        vTbFwFill(pxTx->bNack, 0);
+        pxTx->bState = TBFW_TX_WAIT_STATUS;
+        pxTx->ulDueUs = ulNowUs + pxTx->ulVerifyUs + pxTx->ulReplyWaitUs;
+        pxTx->ulCtrlFrames++;
+        return bTbFwEncodeCtrl(TBCAN_CMD_FW_END, pxTx->bSession, pxTx->ulCrc, pbData);
+
+    case TBFW_TX_WAIT_STATUS:
+        ulPending = pxTx->ulReady & ~pxTx->ulOk;
+        if ((ulPending & ~pxTx->ulHeard) != 0 && !bExpired)
+            return 0;
+        if (ulPending == 0 || pxTx->bRound >= TBFW_ROUNDS_MAX)
+        {
+            if (pxTx->ulOk == 0)
+            {
+                pxTx->bState = TBFW_TX_FAILED;
+                pxTx->ulEndUs = ulNowUs;
+                return 0;
+            }
+            pxTx->bTries = 0;
+            pxTx->bState = TBFW_TX_COMMIT;
+            return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+        }
+        // 足りないブロックの和を送り直す(応答の無かったPanelにはENDだけ送り直す)
+        for (i = 0; i < TBFW_BLOCK_MAX / 8; i++)
+            pxTx->bSend[i] = pxTx->bNack[i];
+        pxTx->bRound++;
+        pxTx->usBlock = 0;
+        pxTx->bChunk = 0;
+        pxTx->bState = TBFW_TX_DATA;
+        pxTx->ulDueUs = ulNowUs;
+        return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+
+    case TBFW_TX_COMMIT:
+        pxTx->bTries++;
+        pxTx->bState = TBFW_TX_WAIT_DONE;
+        pxTx->ulDueUs = ulNowUs + pxTx->ulReplyWaitUs;
+        pxTx->ulCtrlFrames++;
+        return bTbFwEncodeCtrl(TBCAN_CMD_FW_COMMIT, pxTx->bSession, 0, pbData);
+
+    case TBFW_TX_WAIT_DONE:
+        ulPending = pxTx->ulOk & ~pxTx->ulDone;
+        if (ulPending != 0 && !bExpired)
+            return 0;
+        if (ulPending != 0 && pxTx->bTries < TBFW_COMMIT_TRIES)
+        {
+            pxTx->bState = TBFW_TX_COMMIT;
+            return bTbFwTxPoll(pxTx, ulNowUs, pulCanId, pbData);
+        }
+        pxTx->bState = TBFW_TX_FINISHED;
+        pxTx->ulEndUs = ulNowUs;
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+#endif
@@ -0,0 +1,887 @@
+/*****************************************************************************/
+/**
+ * @file tb_canproto.h
+ * @comments Master / Panel 共通 CANプロトコル定義(v1 / v2)
+ *           ヘッダのみのC(AVRのPanel_v2とESP32のMaster_v2の両方で使う)
+ *           両方のplatformio.iniで -I../Common を指定している。
+ *
+ *           v1 (従来, 1byte 1項目)
+ *             [0]PanelID [1]BtnFlag [2]R [3]G [4]B [5]点灯時間(秒) [6]StartSwFlag
+ *             [7]送信側の対応バージョン(v2以降のPanelの返信のみ。従来は0)
+ *
+ *           v2 (DLC 8)
+ *             [0] bit7..5: バージョン(2)  bit4..0: PanelID
+ *             [1] bit7: ACK要求 bit6: 返信をACK付きで bit5..4: フェードカーブ
+ *                 bit3: 踏んだ時刻付き bit2: RGB565 bit1: StartSw bit0: Btn
+ *             [2] シーケンス番号(返信は受信したフレームの番号を返す)
+ *             [3..4] 色: パレット番号([3]) / RGB565(ビッグエンディアン)
+ *             [5..6] 点灯時間(10ms単位, リトルエンディアン)
+ *             [7] 送信側の対応バージョン
+ *
+ *           v1の[0]はPanelID(0..31)なのでbit7..5は常に0。これでv1/v2を見分ける。
+ *
+ *           バージョンの切り替え(段階的な移行)
+ *             - Masterは最初は全Panelへv1で送る
+ *             - v2対応のPanelはv1を受けてもv1で返し、[7]に対応バージョンを入れる
+ *             - Masterは[7]を見てそのPanelへv2で送る(グループ宛ては全員がv2のとき)
+ *             - Panelは受信したフレームと同じバージョンで返す
+ *
+ *           死活監視(v2のPanelのみ, 0x100 + PanelID, Panel -> Master)
+ *             [0] bit7..5: バージョン(2)  bit4..0: PanelID(DIPスイッチ)
+ *             [1] センサ bit0: 踏まれている bit1: 踏まれたまま(TBCAN_SENSOR_STUCK_MS以上)
+ *                 bit4..2: 受信の列が一杯だった回数 bit7..5: 受信オーバーフローの回数
+ *                 (TBCAN_FEAT_RXCNTのPanelのみ、3bitで一周する。Masterは差分を足す)
+ *             [2] 送信回数(起動から、一周する)
+ *             [3] ファームウェアのバージョン(メジャー) [4] (マイナー)
+ *             [5] 送信理由(TBCAN_STATUS_*)  [6] 機能(TBCAN_FEAT_*)  [7] 送信側の対応バージョン
+ *             起動時とTBCAN_HEARTBEAT_MS毎、問い合わせを受けたときに送る。
+ *             受信の回数がTBCAN_RXCNT_REPORT以上増えたときも送る(一周する前に)。
+ *
+ *           問い合わせ(Master -> 全Panel, グループ宛て0x400)
+ *             [0] bit7..5: TBCAN_VER_CTRL  [5] コマンド(TBCAN_CMD_*)  他は0
+ *             v1のPanelには消灯色のデモ点灯に見える(何も起きない)。
+ *             PanelはPanelID順にTBCAN_DISCOVER_SLOT_MSずつずらして状態を返す。
+ *
+ *           時刻同期(Master -> 全Panel, 全Panelがv2のときのみ, PTPの2段階方式)
+ *             SYNC     : [5] TBCAN_CMD_SYNC  [7] 番号  他は0
+ *             FOLLOW_UP: [2..4] SYNCの送信完了時のMasterの時刻[us](下位24bit, リトルエンディアン)
+ *                        [5] TBCAN_CMD_FOLLOW_UP  [7] SYNCと同じ番号  他は0
+ *             PanelはSYNCの受信割り込みの時刻と組にして自分の時計を合わせる(tb_timesync.h)。
+ *             v1のPanelの[1](押下許可)と[6](スタートSW)に当たる所は0にしている。
+ *
+ *           踏んだ時刻付きの返信(v2, [1] bit3: TBCAN_FLAG_TIME)
+ *             Panelが同期しているときだけ付ける。色は返さない。
+ *             [3..4] 踏んだ時刻(Masterの時刻の64us単位の下位16bit, リトルエンディアン)
+ *             [5..6] 反応時間(点灯 -> 踏んだ, Panelの時計の64us単位, リトルエンディアン)
+ *
+ *           配送確認(v2, 死活監視の[6]にTBCAN_FEAT_ACKを立てたPanelとのみ)
+ *             ACK要求(TBCAN_FLAG_ACK_REQ)のフレームを受けたら、すぐにACKを返す。
+ *             ACK: [0] bit7..5: TBCAN_VER_CTRL bit4..0: PanelID  [5] TBCAN_CMD_ACK
+ *                  [7] 受けたフレームの[2](シーケンス番号)  他は0
+ *                  Panel -> MasterはTBCAN_ID_MASTER、Master -> PanelはPanelIDで送る。
+ *             送った側はTBCAN_ACK_TIMEOUT_MS(再送毎に倍)待ってACKが無ければ同じ番号で
+ *             送り直す(TBCAN_RETRY_MAX回まで)。受けた側は同じ番号が続いたら
+ *             ACKだけ返して捨てる(ACKが失われた再送)。
+ *             Masterはスタート通知にACK要求、押下許可／スタート通知に
+ *             TBCAN_FLAG_REL_REPLY(返信にACK要求を付けてよい)を付ける。
+ *             点灯だけのフレームは従来どおり送りっぱなし。
+ *             v2.2以前のPanelは[1] bit7..4をフェードとして読むので付けない。
+ *
+ *           アニメーション(Master -> Panel, 死活監視の[6]にTBCAN_FEAT_ANIMを立てたPanelのみ)
+ *             [0] bit7..5: TBCAN_VER_CTRL  [1] bit3..0: TBCAN_ANIM_*  bit7: 開始時刻あり
+ *             [2] 色(パレット番号)  [3] 周期(10ms単位)  [4] 続ける時間(100ms単位, 0: 次の指示まで)
+ *             [5] TBCAN_CMD_ANIM  [6..7] 開始時刻(Masterの時刻の64us単位の下位16bit)
+ *             Panelが自分で描く(60..100Hz)。開始時刻は同期しているPanelだけが使い、
+ *             位相を揃える(同期していなければ受信した時刻から)。
+ *             v1のPanelは[1]を押下許可と読むので、グループ宛ては全員が対応しているときだけ。
+ *
+ *           LED毎の色(Master -> Panel, 死活監視の[6]にTBCAN_FEAT_PIXELを立てたPanelのみ)
+ *             1つの指示(tbCanPixel_t, TBCAN_PIXEL_LEN byte)をTBCAN_PIXEL_SEG_NUMフレームに分けて送る。
+ *             [0] bit7..5: TBCAN_VER_CTRL  bit4..2: 指示の番号  bit1..0: フレームの番号
+ *             [1..4][6..7] 指示の続き(TBCAN_PIXEL_SEG_LEN byte)  [5] TBCAN_CMD_PIXEL
+ *             指示: [0..1] 点灯時間(10ms単位, リトルエンディアン)  [2] フェード(TBCAN_FADE_*)
+ *                   [3] 予約(0)  [4..] LED毎のR, G, B(TBCAN_PIXEL_NUM個)
+ *             Panelは同じ番号のフレームが揃ったときだけ表示する(1つでも失えば表示しない)。
+ *             番号の違うフレームが来たら、揃っていない指示は捨てる。
+ *
+ *           ファームウェアの配信(Master -> 全Panel, tb_canfw.h)
+ *             開始・終了・確定は問い合わせ(TBCAN_CMD_FW_*)、データはTBCAN_ID_FW_DATAへ、
+ *             PanelはTBCAN_ID_FW_REPLY_BASE + PanelIDで状態と足りないブロックを返す。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef COMMON_TB_CANPROTO_H
+#define COMMON_TB_CANPROTO_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* バージョン */
+#define TBCAN_VER_1 1
+#define TBCAN_VER_2 2
+#define TBCAN_VER_MAX TBCAN_VER_2 // このヘッダで送受信できる最大
+
+/*
+ * CAN ID (11bit標準フォーマット)
+ * 0x000        : Master宛て(Panelからの返答)
+ * 0x001..0x019 : Panel宛て(PanelID)
+ * 0x400..0x7FE : グループ宛て
+ *                bit9..5が行、bit4..0が列。0(ドミナント)のビットの行×列のPanelが受信する。
+ */
+#define TBCAN_ID_MASTER 0x000
+#define TBCAN_ID_GROUP_FLAG 0x400
+#define TBCAN_ID_GROUP_ROW_SHIFT 5
+#define TBCAN_ID_STD_MASK 0x7FF
+#define TBCAN_GRID_SIZE 5 // 5x5, PanelIDは行優先(1..25)
+
+#define TBCAN_ID_STATUS_BASE 0x100 // 死活監視(+ PanelID)。押下の返答より優先度が低い
+#define TBCAN_ID_IS_STATUS(id) (((id) & ~(uint32_t)TBCAN_ID_MASK) == TBCAN_ID_STATUS_BASE)
+
+/* ファームウェアの配信(tb_canfw.h)。応答はデータより優先度が高い */
+#define TBCAN_ID_FW_REPLY_BASE 0x180 // Panel -> Master (+ PanelID)
+#define TBCAN_ID_FW_DATA 0x200       // Master -> 全Panel(ブートローダのみ受ける)
+#define TBCAN_ID_IS_FW_REPLY(id) (((id) & ~(uint32_t)TBCAN_ID_MASK) == TBCAN_ID_FW_REPLY_BASE)
+
+#define TBCAN_DLC 8
+
+/* v2 [0] */
+#define TBCAN_VER_SHIFT 5
+#define TBCAN_ID_MASK 0x1F
+
+/* v2 [1] */
+#define TBCAN_FLAG_BTN 0x01
+#define TBCAN_FLAG_START_SW 0x02
+#define TBCAN_FLAG_RGB565 0x04
+#define TBCAN_FLAG_TIME 0x08 // 返信に踏んだ時刻を入れた(色の代わり)
+#define TBCAN_FADE_SHIFT 4
+#define TBCAN_FADE_MASK 0x03
+#define TBCAN_FLAG_REL_REPLY 0x40 // 返信にACK要求を付けてよい(Master -> Panel)
+#define TBCAN_FLAG_ACK_REQ 0x80   // 受けたらACKを返す
+
+/* フェードカーブ(v1は常にLINEAR) */
+#define TBCAN_FADE_LINEAR 0   // 点灯時間で0まで直線的に暗くする(v1と同じ)
+#define TBCAN_FADE_HOLD 1     // 点灯時間の間、同じ明るさ
+#define TBCAN_FADE_EASE_OUT 2 // 始めに速く、後はゆっくり暗くする(古いPanelはLINEAR)
+#define TBCAN_FADE_PULSE 3    // TBCAN_PULSE_PERIOD_MS周期で明滅(古いPanelはLINEAR)
+#define TBCAN_FADE_MAX 4
+#define TBCAN_PULSE_PERIOD_MS 500
+
+/* 問い合わせ([0] bit7..5, [5]) */
+#define TBCAN_VER_CTRL 7
+#define TBCAN_CMD_DISCOVER 1   // 全Panelが状態を返す
+#define TBCAN_CMD_SYNC 2       // 時刻同期(受信した時刻を控える)
+#define TBCAN_CMD_FOLLOW_UP 3  // 時刻同期(直前のSYNCの送信完了時刻)
+#define TBCAN_CMD_ACK 4        // 配送確認([0]にPanelID、[7]に受けた番号)
+#define TBCAN_CMD_FW_BEGIN 5   // ファームウェアの配信の開始(tb_canfw.h)
+#define TBCAN_CMD_FW_END 6     // 送り終えた(足りないブロックとCRCの結果を返させる)
+#define TBCAN_CMD_FW_COMMIT 7  // 確定(検証できたPanelは新しいファームウェアで起動する)
+#define TBCAN_CMD_ANIM 8       // アニメーション(Panelが自分で描く)
+
+/* アニメーション [1] */
+#define TBCAN_ANIM_MASK 0x0F
+#define TBCAN_ANIM_TIMED 0x80 // [6..7]に開始時刻がある
+#define TBCAN_ANIM_OFF 0      // 止めて消灯
+#define TBCAN_ANIM_PULSE 1    // 周期毎に光って減衰する
+#define TBCAN_ANIM_BREATHE 2  // ゆっくり明滅
+#define TBCAN_ANIM_CHASE 3    // 1つの光がLEDを回る
+#define TBCAN_ANIM_RAINBOW 4  // 色相が回る(色は明るさだけ使う)
+#define TBCAN_ANIM_STROBE 5   // 周期の始めだけ光る
+#define TBCAN_ANIM_SWEEP 6    // 光の帯が盤面を列の順に流れる(チーム色)
+#define TBCAN_ANIM_MAX 7
+#define TBCAN_ANIM_PERIOD_UNIT_MS 10
+#define TBCAN_ANIM_DURATION_UNIT_MS 100
+#define TBCAN_CMD_PIXEL 9      // LED毎の色(TBCAN_PIXEL_SEG_NUMフレームに分けて送る)
+
+/* LED毎の色 [0] bit4..0 */
+#define TBCAN_PIXEL_XFER_SHIFT 2
+#define TBCAN_PIXEL_XFER_MASK 0x07
+#define TBCAN_PIXEL_SEG_MASK 0x03
+#define TBCAN_PIXEL_NUM 4     // PanelのLEDの数
+#define TBCAN_PIXEL_HDR_LEN 4 // 点灯時間、フェード、予約
+#define TBCAN_PIXEL_LEN (TBCAN_PIXEL_HDR_LEN + TBCAN_PIXEL_NUM * 3)
+#define TBCAN_PIXEL_SEG_LEN 6 // 1フレームで送る指示の長さ([1..4][6..7])
+#define TBCAN_PIXEL_SEG_POS(i) ((i) < 4 ? (i) + 1 : (i) + 2) // 指示のi byte目を入れる所
+#define TBCAN_PIXEL_SEG_NUM ((TBCAN_PIXEL_LEN + TBCAN_PIXEL_SEG_LEN - 1) / TBCAN_PIXEL_SEG_LEN)
+#define TBCAN_PIXEL_SEG_ALL ((1U << TBCAN_PIXEL_SEG_NUM) - 1)
+
+/* 死活監視 [1] センサ */
+#define TBCAN_SENSOR_PRESSED 0x01
+#define TBCAN_SENSOR_STUCK 0x02
+#define TBCAN_SENSOR_RXFULL_SHIFT 2 // 受信の列が一杯(MCP2515に残した)
+#define TBCAN_SENSOR_RXOVR_SHIFT 5  // MCP2515の受信オーバーフロー(失ったフレーム)
+#define TBCAN_SENSOR_RXCNT_MASK 0x07
+#define TBCAN_RXCNT_REPORT 4
+
+/* 死活監視 [5] 送信理由 */
+#define TBCAN_STATUS_PERIODIC 0
+#define TBCAN_STATUS_BOOT 1
+#define TBCAN_STATUS_DISCOVER 2
+#define TBCAN_STATUS_RXLOST 3 // 受信の回数が増えた
+
+/* 死活監視 [6] 機能 */
+#define TBCAN_FEAT_ACK 0x01   // 配送確認(TBCAN_FLAG_ACK_REQ / TBCAN_CMD_ACK)に対応
+#define TBCAN_FEAT_RXCNT 0x02 // センサの上位bitに受信の回数を入れる
+#define TBCAN_FEAT_ANIM 0x04  // アニメーション(TBCAN_CMD_ANIM)に対応
+#define TBCAN_FEAT_PIXEL 0x08 // LED毎の色(TBCAN_CMD_PIXEL)に対応
+
+/* 死活監視の周期、問い合わせへの返信の間隔、踏まれたままとみなす時間[ms] */
+#define TBCAN_HEARTBEAT_MS 1000
+#define TBCAN_DISCOVER_SLOT_MS 2
+#define TBCAN_SENSOR_STUCK_MS 10000
+
+/* 時刻同期の周期[ms]、踏んだ時刻・反応時間の単位(1 << TBCAN_TIME_TICK_SHIFT [us]) */
+#define TBCAN_SYNC_PERIOD_MS 1000
+#define TBCAN_TIME_TICK_SHIFT 6
+
+/* 配送確認: ACKを待つ時間[ms](再送毎に倍)、再送の回数 */
+#define TBCAN_ACK_TIMEOUT_MS 20
+#define TBCAN_RETRY_MAX 3
+
+/* 点灯時間の単位[ms] */
+#define TBCAN_V1_LIGHT_UNIT_MS 1000 // 従来のPanelと同じ秒単位
+#define TBCAN_V2_LIGHT_UNIT_MS 10
+
+/*
+ * 色パレット(v2 [3])
+ * Masterが使う色は1byteで送る。ここに無い色はRGB565で送る。
+ */
+#define TBCAN_PALETTE_NUM 15
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* デコード後のフレーム(v1/v2共通) */
+typedef struct TBCAN_FRAME
+{
+    uint8_t bVer;       // TBCAN_VER_1 / TBCAN_VER_2
+    uint8_t bPanelId;   // PanelID(Panelからの返答のみに使用)
+    uint8_t bBtn;       // パネル押下許可／押下フラグ
+    uint8_t bStartSw;   // スタートSW
+    uint8_t bFade;      // フェードカーブ(TBCAN_FADE_*)
+    uint8_t bSeq;       // シーケンス番号(v2)
+    uint8_t bCap;       // 送信側の対応バージョン(0: v1のみ)
+    uint8_t bR, bG, bB; // 色
+    uint16_t usLightMs; // 点灯時間[ms]
+    uint8_t bTimed;       // 踏んだ時刻付きの返信(v2, 色は無い)
+    uint16_t usPressTick; // 踏んだ時刻(Masterの時刻, TBCAN_TIME_TICK_SHIFT単位の下位16bit)
+    uint16_t usReactTick; // 反応時間(TBCAN_TIME_TICK_SHIFT単位)
+    uint8_t bAckReq;      // ACK要求(v2)
+    uint8_t bRelReply;    // 返信にACK要求を付けてよい(v2, Master -> Panel)
+} tbCanFrame_t;
+
+/* 死活監視(Panel -> Master) */
+typedef struct TBCAN_STATUS
+{
+    uint8_t bPanelId; // PanelID(DIPスイッチ)
+    uint8_t bSensor;  // TBCAN_SENSOR_*
+    uint8_t bCount;   // 送信回数
+    uint8_t bFwMajor; // ファームウェアのバージョン
+    uint8_t bFwMinor;
+    uint8_t bReason;  // TBCAN_STATUS_*
+    uint8_t bFeat;    // TBCAN_FEAT_*
+    uint8_t bCap;     // 送信側の対応バージョン
+} tbCanStatus_t;
+
+/* アニメーション(Master -> Panel) */
+typedef struct TBCAN_ANIM
+{
+    uint8_t bAnim;         // TBCAN_ANIM_*
+    uint8_t bColor;        // 色(パレット番号)
+    uint16_t usPeriodMs;   // 周期[ms](10ms単位)
+    uint16_t usDurationMs; // 続ける時間[ms](100ms単位, 0: 次の指示まで)
+    uint8_t bTimed;        // 開始時刻あり
+    uint16_t usStartTick;  // 開始時刻(Masterの時刻, TBCAN_TIME_TICK_SHIFT単位の下位16bit)
+} tbCanAnim_t;
+
+/* LED毎の色(Master -> Panel) */
+typedef struct TBCAN_PIXEL
+{
+    uint16_t usLightMs;                 // 点灯時間[ms](10ms単位)
+    uint8_t bFade;                      // フェードカーブ(TBCAN_FADE_*)
+    uint8_t bRgb[TBCAN_PIXEL_NUM][3];   // LED毎の[0]R [1]G [2]B
+} tbCanPixel_t;
+
+/* LED毎の色の受信(フレームを揃える) */
+typedef struct TBCAN_PIXEL_RX
+{
+    uint8_t bBuf[TBCAN_PIXEL_SEG_NUM * TBCAN_PIXEL_SEG_LEN];
+    uint8_t bXfer;    // 揃えている指示の番号
+    uint8_t bSegMask; // 受けたフレーム(bit = フレームの番号, 0: 揃えていない)
+} tbCanPixelRx_t;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * パレットの色
+ *
+ * @param    bIdx: パレット番号
+ * @param    pbRgb: [0]R [1]G [2]B
+ *
+ * @return   1: 成功 / 0: 範囲外
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanPalette(uint8_t bIdx, uint8_t *pbRgb)
+{
+    /* 並びは変えないこと(追加は末尾へ) */
+    switch (bIdx)
+    {
+    case 0:  pbRgb[0] = 0;   pbRgb[1] = 0;   pbRgb[2] = 0;   break; // 消灯
+    case 1:  pbRgb[0] = 255; pbRgb[1] = 255; pbRgb[2] = 255; break; // WHITE
+    case 2:  pbRgb[0] = 255; pbRgb[1] = 0;   pbRgb[2] = 0;   break; // RED
+    case 3:  pbRgb[0] = 0;   pbRgb[1] = 255; pbRgb[2] = 0;   break; // GREEN
+    case 4:  pbRgb[0] = 0;   pbRgb[1] = 0;   pbRgb[2] = 255; break; // BLUE
+    case 5:  pbRgb[0] = 32;  pbRgb[1] = 32;  pbRgb[2] = 32;  break; // WHITE_L
+    case 6:  pbRgb[0] = 32;  pbRgb[1] = 0;   pbRgb[2] = 0;   break; // RED_L
+    case 7:  pbRgb[0] = 0;   pbRgb[1] = 32;  pbRgb[2] = 0;   break; // GREEN_L
+    case 8:  pbRgb[0] = 0;   pbRgb[1] = 0;   pbRgb[2] = 32;  break; // BLUE_L
+    case 9:  pbRgb[0] = 255; pbRgb[1] = 128; pbRgb[2] = 128; break; // チーム RED
+    case 10: pbRgb[0] = 128; pbRgb[1] = 255; pbRgb[2] = 128; break; // チーム GREEN
+    case 11: pbRgb[0] = 128; pbRgb[1] = 128; pbRgb[2] = 255; break; // チーム BLUE
+    case 12: pbRgb[0] = 128; pbRgb[1] = 128; pbRgb[2] = 128; break; // HALF
+    case 13: pbRgb[0] = 235; pbRgb[1] = 97;  pbRgb[2] = 0;   break; // Orange
+    case 14: pbRgb[0] = 106; pbRgb[1] = 51;  pbRgb[2] = 134; break; // Purple
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+/*****************************************************************************/
+/**
+ * パレット番号を探す
+ *
+ * @param    bR, bG, bB: 色
+ *
+ * @return   パレット番号 / TBCAN_PALETTE_NUM: パレットに無い
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanPaletteFind(uint8_t bR, uint8_t bG, uint8_t bB)
+{
+    uint8_t bRgb[3];
+    uint8_t i;
+
+    for (i = 0; i < TBCAN_PALETTE_NUM; i++)
+    {
+        bTbCanPalette(i, bRgb);
+        if (bRgb[0] == bR && bRgb[1] == bG && bRgb[2] == bB)
+            break;
+    }
+    return i;
+}
+
+/*****************************************************************************/
+/**
+ * v2でフレームを作る
+ *
+ * @param    pxFrame: 送る内容(bVerは見ない)
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     点灯時間は10ms単位に切り捨てる
+ *           bTimedなら色・点灯時間の代わりに踏んだ時刻・反応時間を入れる
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeV2(const tbCanFrame_t *pxFrame, uint8_t *pbData)
+{
+    uint8_t bFlags;
+    uint16_t usColor = 0xFFFF;
+    uint16_t usLight = (uint16_t)(pxFrame->usLightMs / TBCAN_V2_LIGHT_UNIT_MS);
+    uint8_t bIdx = bTbCanPaletteFind(pxFrame->bR, pxFrame->bG, pxFrame->bB);
+
+    if (bIdx < TBCAN_PALETTE_NUM)
+        usColor = (uint16_t)bIdx << 8;
+
+    bFlags = (uint8_t)((pxFrame->bFade & TBCAN_FADE_MASK) << TBCAN_FADE_SHIFT);
+    if (pxFrame->bAckReq)
+        bFlags |= TBCAN_FLAG_ACK_REQ;
+    if (pxFrame->bRelReply)
+        bFlags |= TBCAN_FLAG_REL_REPLY;
+    if (pxFrame->bBtn)
+        bFlags |= TBCAN_FLAG_BTN;
+    if (pxFrame->bStartSw)
+        bFlags |= TBCAN_FLAG_START_SW;
+    if (pxFrame->bTimed)
+    {
+        bFlags |= TBCAN_FLAG_TIME;
+    }
+    else if (usColor == 0xFFFF)
+    {
+        bFlags |= TBCAN_FLAG_RGB565;
+        usColor = (uint16_t)(((uint16_t)(pxFrame->bR >> 3) << 11) |
+                             ((uint16_t)(pxFrame->bG >> 2) << 5) | (pxFrame->bB >> 3));
+    }
+
+    pbData[0] = (uint8_t)((TBCAN_VER_2 << TBCAN_VER_SHIFT) | (pxFrame->bPanelId & TBCAN_ID_MASK));
+    pbData[1] = bFlags;
+    pbData[2] = pxFrame->bSeq;
+    pbData[3] = (uint8_t)(usColor >> 8);
+    pbData[4] = (uint8_t)usColor;
+    pbData[5] = (uint8_t)usLight;
+    pbData[6] = (uint8_t)(usLight >> 8);
+    pbData[7] = pxFrame->bCap;
+    if (pxFrame->bTimed)
+    {
+        pbData[3] = (uint8_t)pxFrame->usPressTick;
+        pbData[4] = (uint8_t)(pxFrame->usPressTick >> 8);
+        pbData[5] = (uint8_t)pxFrame->usReactTick;
+        pbData[6] = (uint8_t)(pxFrame->usReactTick >> 8);
+    }
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * v1でフレームを作る
+ *
+ * @param    pxFrame: 送る内容(bVer, bFade, bSeq, bAckReq, bRelReplyは見ない)
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     点灯時間は秒単位に切り上げる(1500ms -> 2s、0msは0のまま)
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeV1(const tbCanFrame_t *pxFrame, uint8_t *pbData)
+{
+    uint16_t usLight = (uint16_t)((pxFrame->usLightMs + TBCAN_V1_LIGHT_UNIT_MS - 1) / TBCAN_V1_LIGHT_UNIT_MS);
+
+    pbData[0] = (uint8_t)(pxFrame->bPanelId & TBCAN_ID_MASK);
+    pbData[1] = pxFrame->bBtn;
+    pbData[2] = pxFrame->bR;
+    pbData[3] = pxFrame->bG;
+    pbData[4] = pxFrame->bB;
+    pbData[5] = (uint8_t)(usLight > 0xFF ? 0xFF : usLight);
+    pbData[6] = pxFrame->bStartSw;
+    pbData[7] = pxFrame->bCap;
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * 指定のバージョンでフレームを作る
+ *
+ * @param    pxFrame: 送る内容
+ * @param    bVer: TBCAN_VER_1 / TBCAN_VER_2
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncode(const tbCanFrame_t *pxFrame, uint8_t bVer, uint8_t *pbData)
+{
+    return bVer >= TBCAN_VER_2 ? bTbCanEncodeV2(pxFrame, pbData)
+                               : bTbCanEncodeV1(pxFrame, pbData);
+}
+
+/*****************************************************************************/
+/**
+ * フレームを読む
+ *
+ * @param    pbData: 受信データ
+ * @param    bDlc: DLC
+ * @param    pxFrame: 出力
+ *
+ * @return   バージョン / 0: 読めない(短い、未対応のバージョン、範囲外のパレット)
+ *
+ * @note     v1の[7]はDLC 8のときのみ見る(Masterの従来のフレームはDLC 7)
+ *           v1の点灯時間は65535ms(66s以上)で頭打ちにする
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanDecode(const uint8_t *pbData, uint8_t bDlc, tbCanFrame_t *pxFrame)
+{
+    uint8_t bVer;
+    uint8_t bRgb[3];
+    uint16_t usColor;
+    uint32_t ulLight;
+
+    if (bDlc < 7)
+        return 0;
+    bVer = (uint8_t)(pbData[0] >> TBCAN_VER_SHIFT);
+    if (bVer == 0)
+    {
+        pxFrame->bVer = TBCAN_VER_1;
+        pxFrame->bPanelId = pbData[0];
+        pxFrame->bBtn = pbData[1];
+        pxFrame->bR = pbData[2];
+        pxFrame->bG = pbData[3];
+        pxFrame->bB = pbData[4];
+        ulLight = (uint32_t)pbData[5] * TBCAN_V1_LIGHT_UNIT_MS;
+        pxFrame->usLightMs = (uint16_t)(ulLight > 0xFFFF ? 0xFFFF : ulLight);
+        pxFrame->bStartSw = pbData[6];
+        pxFrame->bFade = TBCAN_FADE_LINEAR;
+        pxFrame->bSeq = 0;
+        pxFrame->bCap = bDlc >= TBCAN_DLC ? pbData[7] : 0;
+        pxFrame->bTimed = 0;
+        pxFrame->usPressTick = 0;
+        pxFrame->usReactTick = 0;
+        pxFrame->bAckReq = 0;
+        pxFrame->bRelReply = 0;
+        return TBCAN_VER_1;
+    }
+    if (bVer != TBCAN_VER_2 || bDlc < TBCAN_DLC)
+        return 0;
+
+    usColor = (uint16_t)(((uint16_t)pbData[3] << 8) | pbData[4]);
+    pxFrame->bTimed = 0;
+    pxFrame->usPressTick = 0;
+    pxFrame->usReactTick = 0;
+    if (pbData[1] & TBCAN_FLAG_TIME)
+    {
+        pxFrame->bTimed = 1;
+        pxFrame->usPressTick = (uint16_t)((uint16_t)pbData[4] << 8 | pbData[3]);
+        pxFrame->usReactTick = (uint16_t)((uint16_t)pbData[6] << 8 | pbData[5]);
+        bRgb[0] = bRgb[1] = bRgb[2] = 0;
+    }
+    else if (pbData[1] & TBCAN_FLAG_RGB565)
+    {
+        bRgb[0] = (uint8_t)(((usColor >> 11) & 0x1F) << 3);
+        bRgb[0] |= bRgb[0] >> 5;
+        bRgb[1] = (uint8_t)(((usColor >> 5) & 0x3F) << 2);
+        bRgb[1] |= bRgb[1] >> 6;
+        bRgb[2] = (uint8_t)((usColor & 0x1F) << 3);
+        bRgb[2] |= bRgb[2] >> 5;
+    }
+    else if (!bTbCanPalette(pbData[3], bRgb))
+    {
+        return 0;
+    }
+
+    pxFrame->bVer = TBCAN_VER_2;
+    pxFrame->bPanelId = pbData[0] & TBCAN_ID_MASK;
+    pxFrame->bBtn = (pbData[1] & TBCAN_FLAG_BTN) ? 1 : 0;
+    pxFrame->bStartSw = (pbData[1] & TBCAN_FLAG_START_SW) ? 1 : 0;
+    pxFrame->bFade = (uint8_t)((pbData[1] >> TBCAN_FADE_SHIFT) & TBCAN_FADE_MASK);
+    pxFrame->bAckReq = (pbData[1] & TBCAN_FLAG_ACK_REQ) ? 1 : 0;
+    pxFrame->bRelReply = (pbData[1] & TBCAN_FLAG_REL_REPLY) ? 1 : 0;
+    pxFrame->bSeq = pbData[2];
+    pxFrame->bR = bRgb[0];
+    pxFrame->bG = bRgb[1];
+    pxFrame->bB = bRgb[2];
+    pxFrame->usLightMs = pxFrame->bTimed
+                             ? 0
+                             : (uint16_t)(((uint16_t)pbData[6] << 8 | pbData[5]) * TBCAN_V2_LIGHT_UNIT_MS);
+    pxFrame->bCap = pbData[7];
+    return TBCAN_VER_2;
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを作る
+ *
+ * @param    pxStatus: 送る内容
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     CAN IDはTBCAN_ID_STATUS_BASE + PanelID
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeStatus(const tbCanStatus_t *pxStatus, uint8_t *pbData)
+{
+    pbData[0] = (uint8_t)((TBCAN_VER_2 << TBCAN_VER_SHIFT) | (pxStatus->bPanelId & TBCAN_ID_MASK));
+    pbData[1] = pxStatus->bSensor;
+    pbData[2] = pxStatus->bCount;
+    pbData[3] = pxStatus->bFwMajor;
+    pbData[4] = pxStatus->bFwMinor;
+    pbData[5] = pxStatus->bReason;
+    pbData[6] = pxStatus->bFeat;
+    pbData[7] = pxStatus->bCap;
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを読む
+ *
+ * @param    pbData: 受信データ
+ * @param    bDlc: DLC
+ * @param    pxStatus: 出力
+ *
+ * @return   1: 成功 / 0: 読めない
+ *
+ * @note     CAN IDがTBCAN_ID_IS_STATUSのときだけ呼ぶこと
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanDecodeStatus(const uint8_t *pbData, uint8_t bDlc,
+                                         tbCanStatus_t *pxStatus)
+{
+    if (bDlc < TBCAN_DLC || (pbData[0] >> TBCAN_VER_SHIFT) != TBCAN_VER_2)
+        return 0;
+    pxStatus->bPanelId = pbData[0] & TBCAN_ID_MASK;
+    pxStatus->bSensor = pbData[1];
+    pxStatus->bCount = pbData[2];
+    pxStatus->bFwMajor = pbData[3];
+    pxStatus->bFwMinor = pbData[4];
+    pxStatus->bReason = pbData[5];
+    pxStatus->bFeat = pbData[6];
+    pxStatus->bCap = pbData[7];
+    return 1;
+}
+
+/*****************************************************************************/
+/**
+ * 問い合わせのフレームを作る
+ *
+ * @param    bCmd: TBCAN_CMD_*
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeCtrl(uint8_t bCmd, uint8_t *pbData)
+{
+    uint8_t i;
+
+    for (i = 0; i < TBCAN_DLC; i++)
+        pbData[i] = 0;
+    pbData[0] = (uint8_t)(TBCAN_VER_CTRL << TBCAN_VER_SHIFT);
+    pbData[5] = bCmd;
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * 問い合わせのフレームか
+ *
+ * @param    pbData: 受信データ
+ * @param    bDlc: DLC
+ *
+ * @return   TBCAN_CMD_* / 0: 問い合わせではない
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanDecodeCtrl(const uint8_t *pbData, uint8_t bDlc)
+{
+    if (bDlc < TBCAN_DLC || (pbData[0] >> TBCAN_VER_SHIFT) != TBCAN_VER_CTRL)
+        return 0;
+    return pbData[5];
+}
+
+/*****************************************************************************/
+/**
+ * 時刻同期のフレームを作る
+ *
+ * @param    bCmd: TBCAN_CMD_SYNC / TBCAN_CMD_FOLLOW_UP
+ * @param    bSeq: 番号(FOLLOW_UPはSYNCと同じ番号)
+ * @param    ulMasterUs: SYNCの送信完了時のMasterの時刻[us](FOLLOW_UPのみ)
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     時刻は下位24bitだけ送る(Panelは自分の予測の近くへ広げる)
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeSync(uint8_t bCmd, uint8_t bSeq, uint32_t ulMasterUs,
+                                       uint8_t *pbData)
+{
+    bTbCanEncodeCtrl(bCmd, pbData);
+    if (bCmd == TBCAN_CMD_FOLLOW_UP)
+    {
+        pbData[2] = (uint8_t)ulMasterUs;
+        pbData[3] = (uint8_t)(ulMasterUs >> 8);
+        pbData[4] = (uint8_t)(ulMasterUs >> 16);
+    }
+    pbData[7] = bSeq;
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * 時刻同期のフレームを読む
+ *
+ * @param    pbData: 受信データ(bTbCanDecodeCtrlがTBCAN_CMD_SYNC / FOLLOW_UP)
+ * @param    pbSeq: 番号
+ * @param    pulMasterUs: SYNCの送信完了時のMasterの時刻[us](下位24bit, FOLLOW_UPのみ)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline void vTbCanDecodeSync(const uint8_t *pbData, uint8_t *pbSeq, uint32_t *pulMasterUs)
+{
+    *pbSeq = pbData[7];
+    *pulMasterUs = (uint32_t)pbData[2] | (uint32_t)pbData[3] << 8 | (uint32_t)pbData[4] << 16;
+}
+
+/*****************************************************************************/
+/**
+ * 配送確認(ACK)のフレームを作る
+ *
+ * @param    bPanelId: 送った／受けたPanelのPanelID
+ * @param    bSeq: 受けたフレームのシーケンス番号
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeAck(uint8_t bPanelId, uint8_t bSeq, uint8_t *pbData)
+{
+    bTbCanEncodeCtrl(TBCAN_CMD_ACK, pbData);
+    pbData[0] |= (uint8_t)(bPanelId & TBCAN_ID_MASK);
+    pbData[7] = bSeq;
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * 配送確認(ACK)のフレームを読む
+ *
+ * @param    pbData: 受信データ(bTbCanDecodeCtrlがTBCAN_CMD_ACK)
+ * @param    pbPanelId: PanelID
+ * @param    pbSeq: 受けたフレームのシーケンス番号
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline void vTbCanDecodeAck(const uint8_t *pbData, uint8_t *pbPanelId, uint8_t *pbSeq)
+{
+    *pbPanelId = pbData[0] & TBCAN_ID_MASK;
+    *pbSeq = pbData[7];
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションのフレームを作る
+ *
+ * @param    pxAnim: 送る内容
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     周期は10ms(1..255)、続ける時間は100ms単位(0..255)に丸める
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodeAnim(const tbCanAnim_t *pxAnim, uint8_t *pbData)
+{
+    uint16_t usPeriod = (uint16_t)(pxAnim->usPeriodMs / TBCAN_ANIM_PERIOD_UNIT_MS);
+    uint16_t usDuration = (uint16_t)(pxAnim->usDurationMs / TBCAN_ANIM_DURATION_UNIT_MS);
+
+    bTbCanEncodeCtrl(TBCAN_CMD_ANIM, pbData);
+    pbData[1] = (uint8_t)(pxAnim->bAnim & TBCAN_ANIM_MASK);
+    if (pxAnim->bTimed)
+        pbData[1] |= TBCAN_ANIM_TIMED;
+    pbData[2] = pxAnim->bColor;
+    pbData[3] = (uint8_t)(usPeriod == 0 ? 1 : usPeriod > 0xFF ? 0xFF : usPeriod);
+    pbData[4] = (uint8_t)(usDuration > 0xFF ? 0xFF : usDuration);
+    pbData[6] = (uint8_t)pxAnim->usStartTick;
+    pbData[7] = (uint8_t)(pxAnim->usStartTick >> 8);
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションのフレームを読む
+ *
+ * @param    pbData: 受信データ(bTbCanDecodeCtrlがTBCAN_CMD_ANIM)
+ * @param    pxAnim: 出力
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline void vTbCanDecodeAnim(const uint8_t *pbData, tbCanAnim_t *pxAnim)
+{
+    pxAnim->bAnim = pbData[1] & TBCAN_ANIM_MASK;
+    pxAnim->bTimed = (pbData[1] & TBCAN_ANIM_TIMED) ? 1 : 0;
+    pxAnim->bColor = pbData[2];
+    pxAnim->usPeriodMs = (uint16_t)(pbData[3] == 0 ? 1 : pbData[3]) * TBCAN_ANIM_PERIOD_UNIT_MS;
+    pxAnim->usDurationMs = (uint16_t)pbData[4] * TBCAN_ANIM_DURATION_UNIT_MS;
+    pxAnim->usStartTick = (uint16_t)((uint16_t)pbData[7] << 8 | pbData[6]);
+}
+
+/*****************************************************************************/
+/**
+ * LED毎の色のフレームを作る(1フレーム分)
+ *
+ * @param    pxPixel: 送る指示
+ * @param    bXfer: 指示の番号(送る度に変える, 下位3bit)
+ * @param    bSeg: フレームの番号(0..TBCAN_PIXEL_SEG_NUM-1)
+ * @param    pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return   DLC
+ *
+ * @note     点灯時間は10ms単位に切り捨てる。指示の残りが無い所は0
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanEncodePixel(const tbCanPixel_t *pxPixel, uint8_t bXfer, uint8_t bSeg,
+                                        uint8_t *pbData)
+{
+    uint16_t usLight = (uint16_t)(pxPixel->usLightMs / TBCAN_V2_LIGHT_UNIT_MS);
+    uint8_t bOfs;
+    uint8_t bVal;
+    uint8_t i;
+
+    bTbCanEncodeCtrl(TBCAN_CMD_PIXEL, pbData);
+    pbData[0] |= (uint8_t)(((bXfer & TBCAN_PIXEL_XFER_MASK) << TBCAN_PIXEL_XFER_SHIFT) |
+                           (bSeg & TBCAN_PIXEL_SEG_MASK));
+    for (i = 0; i < TBCAN_PIXEL_SEG_LEN; i++)
+    {
+        bOfs = (uint8_t)(bSeg * TBCAN_PIXEL_SEG_LEN + i);
+        if (bOfs == 0)
+            bVal = (uint8_t)usLight;
+        else if (bOfs == 1)
+            bVal = (uint8_t)(usLight >> 8);
+        else if (bOfs == 2)
+            bVal = pxPixel->bFade;
+        else if (bOfs >= TBCAN_PIXEL_HDR_LEN && bOfs < TBCAN_PIXEL_LEN)
+            bVal = pxPixel->bRgb[(bOfs - TBCAN_PIXEL_HDR_LEN) / 3][(bOfs - TBCAN_PIXEL_HDR_LEN) % 3];
+        else
+            bVal = 0;
+        pbData[TBCAN_PIXEL_SEG_POS(i)] = bVal;
+    }
+    return TBCAN_DLC;
+}
+
+/*****************************************************************************/
+/**
+ * LED毎の色のフレームを受ける(揃ったら指示を返す)
+ *
+ * @param    pxRx: 受信の状態(最初は0で埋めておく)
+ * @param    pbData: 受信データ(bTbCanDecodeCtrlがTBCAN_CMD_PIXEL)
+ * @param    pxPixel: 出力(揃ったときだけ書く)
+ *
+ * @return   1: 揃った / 0: まだ
+ *
+ * @note     番号の違う指示のフレームが来たら、揃っていない指示は捨てて新しい方を揃える。
+ *           同じフレームが重ねて来たら上書きする
+ *
+ ******************************************************************************/
+static inline uint8_t bTbCanDecodePixel(tbCanPixelRx_t *pxRx, const uint8_t *pbData,
+                                        tbCanPixel_t *pxPixel)
+{
+    uint8_t bXfer = (uint8_t)((pbData[0] >> TBCAN_PIXEL_XFER_SHIFT) & TBCAN_PIXEL_XFER_MASK);
+    uint8_t bSeg = (uint8_t)(pbData[0] & TBCAN_PIXEL_SEG_MASK);
+    uint8_t i;
+
+    if (bSeg >= TBCAN_PIXEL_SEG_NUM)
+        return 0;
+    if (pxRx->bSegMask == 0 || bXfer != pxRx->bXfer)
+    {
+        pxRx->bXfer = bXfer;
+        pxRx->bSegMask = 0;
+    }
+    for (i = 0; i < TBCAN_PIXEL_SEG_LEN; i++)
+        pxRx->bBuf[bSeg * TBCAN_PIXEL_SEG_LEN + i] = pbData[TBCAN_PIXEL_SEG_POS(i)];
+    pxRx->bSegMask |= (uint8_t)(1U << bSeg);
+    if (pxRx->bSegMask != TBCAN_PIXEL_SEG_ALL)
+        return 0;
+
+    pxRx->bSegMask = 0;
+    pxPixel->usLightMs =
+        (uint16_t)(((uint16_t)pxRx->bBuf[1] << 8 | pxRx->bBuf[0]) * TBCAN_V2_LIGHT_UNIT_MS);
+    pxPixel->bFade = pxRx->bBuf[2] < TBCAN_FADE_MAX ? pxRx->bBuf[2] : TBCAN_FADE_LINEAR;
+    for (i = 0; i < TBCAN_PIXEL_NUM * 3; i++)
+        pxPixel->bRgb[i / 3][i % 3] = pxRx->bBuf[TBCAN_PIXEL_HDR_LEN + i];
+    return 1;
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*****************************************************************************/
+/**
+ * @file tb_timesync.h
+ * @comments Panel側の時刻同期(Masterの時刻の推定)
+ *           ヘッダのみのC(Panel_v2とMaster_v2のsimのパネルで使う)
+ *
+ *           SYNCを受信した割り込みの時刻(自分の時計)とFOLLOW_UPのMasterの時刻を組にして
+ *           Masterの時刻 = 基準のMasterの時刻 + 経過 × (1 + 周波数のずれ)
+ *           で推定する。
+ *             - 1回目: 基準を合わせる
+ *             - 2回目: 周波数のずれをそのまま求める
+ *             - 3回目以降: 予測とのずれで基準を1/2、周波数を1/8ずつ寄せる(PI)
+ *           同期後に予測からTBSYNC_OUTLIER_US以上ずれた組は捨てる
+ *           (割り込みがNeoPixelの送信などで遅れた)。続けて捨てたらやり直す。
+ *           時刻はuint32_tの[us]で一周を跨いでよい(micros()は約71分で一周)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef COMMON_TB_TIMESYNC_H
+#define COMMON_TB_TIMESYNC_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TBSYNC_LOCK_SAMPLES 3            // 同期したとみなすまでの組の数
+#define TBSYNC_OUTLIER_US 300            // 同期後、予測からこれ以上ずれた組は捨てる
+#define TBSYNC_OUTLIER_MAX 3             // 続けて捨てたらやり直す
+#define TBSYNC_DRIFT_MAX_PPB 10000000L   // 周波数のずれの上限(セラミック発振子 ±1%)
+#define TBSYNC_HOLDOVER_US 10000000UL    // 同期が途絶えても推定を使う時間
+#define TBSYNC_MASTER_BITS 24            // FOLLOW_UPで届くMasterの時刻のビット数
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef struct TBCAN_TIME_SYNC
+{
+    uint32_t ulLocalUs;  // 基準: 最後に受け入れた組の自分の時刻
+    uint32_t ulMasterUs; // 基準: そのときのMasterの時刻(推定)
+    int32_t lDriftPpb;   // Masterの時計 / 自分の時計 - 1 [ppb]
+    int32_t lLastErrUs;  // 最後の組の予測とのずれ(診断用)
+    uint8_t bSamples;    // 受け入れた組の数(255で止める)
+    uint8_t bOutliers;   // 続けて捨てた組の数
+} tbTimeSync_t;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 初期化(同期していない状態)
+ *
+ * @param    pxSync: 同期の状態
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static inline void vTbSyncInit(tbTimeSync_t *pxSync)
+{
+    pxSync->ulLocalUs = 0;
+    pxSync->ulMasterUs = 0;
+    pxSync->lDriftPpb = 0;
+    pxSync->lLastErrUs = 0;
+    pxSync->bSamples = 0;
+    pxSync->bOutliers = 0;
+}
+
+/*****************************************************************************/
+/**
+ * 自分の時刻 -> Masterの時刻
+ *
+ * @param    pxSync: 同期の状態
+ * @param    ulLocalUs: 自分の時刻[us]
+ *
+ * @return   uint32_t Masterの時刻[us](推定)
+ *
+ * @note     基準の前後約35分以内の時刻に使うこと
+ *
+ ******************************************************************************/
+static inline uint32_t ulTbSyncToMaster(const tbTimeSync_t *pxSync, uint32_t ulLocalUs)
+{
+    int32_t lDt = (int32_t)(ulLocalUs - pxSync->ulLocalUs);
+
+    return pxSync->ulMasterUs + (uint32_t)lDt +
+           (uint32_t)(int32_t)((int64_t)lDt * pxSync->lDriftPpb / 1000000000L);
+}
+
+/*****************************************************************************/
+/**
+ * 同期しているか
+ *
+ * @param    pxSync: 同期の状態
+ * @param    ulLocalUs: 自分の時刻[us]
+ *
+ * @return   1: 同期している / 0: していない
+ *
+ * @note     最後の組からTBSYNC_HOLDOVER_USを過ぎたら同期していないとみなす
+ *
+ ******************************************************************************/
+static inline uint8_t bTbSyncLocked(const tbTimeSync_t *pxSync, uint32_t ulLocalUs)
+{
+    return pxSync->bSamples >= TBSYNC_LOCK_SAMPLES &&
+           (uint32_t)(ulLocalUs - pxSync->ulLocalUs) < TBSYNC_HOLDOVER_US;
+}
+
+/*****************************************************************************/
+/**
+ * 組(SYNCを受信した自分の時刻, FOLLOW_UPのMasterの時刻)で更新
+ *
+ * @param    pxSync: 同期の状態
+ * @param    ulLocalUs: SYNCを受信した割り込みの時刻[us](自分の時計)
+ * @param    ulMasterUs: SYNCの送信完了時のMasterの時刻[us](下位TBSYNC_MASTER_BITS bit)
+ *
+ * @return   1: 受け入れた / 0: 捨てた
+ *
+ * @note     Masterの時刻の上位ビットは予測から補う(最初の組は0)。
+ *           上位ビットはMasterと揃わないが、送る時刻(下位22bit)には影響しない。
+ *
+ ******************************************************************************/
+static inline uint8_t bTbSyncUpdate(tbTimeSync_t *pxSync, uint32_t ulLocalUs, uint32_t ulMasterUs)
+{
+    uint32_t ulPredUs;
+    int32_t lDt;
+    int32_t lErr;
+
+    ulMasterUs &= (1UL << TBSYNC_MASTER_BITS) - 1;
+    if (pxSync->bSamples == 0)
+    {
+        pxSync->ulLocalUs = ulLocalUs;
+        pxSync->ulMasterUs = ulMasterUs;
+        pxSync->lLastErrUs = 0;
+        pxSync->bSamples = 1;
+        pxSync->bOutliers = 0;
+        return 1;
+    }
+    lDt = (int32_t)(ulLocalUs - pxSync->ulLocalUs);
+    if (lDt <= 0)
+        return 0;
+
+    ulPredUs = ulTbSyncToMaster(pxSync, ulLocalUs);
+    // 予測とのずれ(下位24bitの差を符号付きに広げる)
+    lErr = (int32_t)((ulMasterUs - ulPredUs) << (32 - TBSYNC_MASTER_BITS)) >>
+           (32 - TBSYNC_MASTER_BITS);
+    pxSync->lLastErrUs = lErr;
+
+    if (pxSync->bSamples >= TBSYNC_LOCK_SAMPLES &&
+        (lErr > TBSYNC_OUTLIER_US || lErr < -TBSYNC_OUTLIER_US))
+    {
+        if (++pxSync->bOutliers < TBSYNC_OUTLIER_MAX)
+            return 0;
+        // ずれ続ける(Masterの再起動など): やり直す
+        pxSync->bSamples = 0;
+        pxSync->lDriftPpb = 0;
+        return bTbSyncUpdate(pxSync, ulLocalUs, ulMasterUs);
+    }
+    pxSync->bOutliers = 0;
+
+    if (pxSync->bSamples == 1)
+    {
+        pxSync->lDriftPpb += (int32_t)((int64_t)lErr * 1000000000L / lDt);
+        pxSync->ulMasterUs = ulPredUs + (uint32_t)lErr;
+    }
+    else
+    {
+        pxSync->lDriftPpb += (int32_t)((int64_t)lErr * 1000000000L / lDt / 8);
+        pxSync->ulMasterUs = ulPredUs + (uint32_t)(lErr / 2);
+    }
+    if (pxSync->lDriftPpb > TBSYNC_DRIFT_MAX_PPB)
+        pxSync->lDriftPpb = TBSYNC_DRIFT_MAX_PPB;
+    if (pxSync->lDriftPpb < -TBSYNC_DRIFT_MAX_PPB)
+        pxSync->lDriftPpb = -TBSYNC_DRIFT_MAX_PPB;
+    pxSync->ulLocalUs = ulLocalUs;
+    if (pxSync->bSamples < 255)
+        pxSync->bSamples++;
+    return 1;
+}
+
+#endif
@@ -3,6 +3,9 @@ from tkinter import ttk
 import socket
 import threading
 import json
+import os
+import struct
+import time
 
 try:
     s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
@@ -16,6 +19,22 @@ except Exception as e:
     print(u"Cannot connect Server.")
     exit()
 
+# 難易度調整ファイル(Tuneボタンで選択中の難易度の値を送る)
+TUNE_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                         "dfclt_tune.json")
+# ゲーム記録(esp_rec)の保存先
+REC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "rec")
+REC_CMD = b"esp_rec "
+# 診断ログ(esp_diag, util_diag.h)も同じ所へ保存し、文字列に直す
+DIAG_CMD = b"esp_diag "
+DIAG_HEADER = struct.Struct("<4sHHIII")  # diagHeader_t
+DIAG_EVENT = struct.Struct("<IBBH8s")    # diagEvent_t
+DIAG_CODES = {1: "can rx", 2: "can rx msg", 3: "can rx batch",
+              4: "can rx dup", 5: "can tx", 6: "can retry"}
+PANELS_CMD = "esp_panels "
+# Panelのファームウェア配信の結果(JSON)
+FWUP_CMD = "esp_fwup_result "
+
 # Button Lock Flag
 # buttonLock = False
 
@@ -27,9 +46,30 @@ class ServerThread(threading.Thread):
     def run(self):
         while True:
             try:
-                recvmsg = s.recv(1024)
+                recvmsg = s.recv(4096)
+                if (recvmsg.startswith(REC_CMD)):
+                    # ゲーム記録(バイナリ)は保存のみ
+                    self.receive_rec(recvmsg)
+                    continue
+                if (recvmsg.startswith(DIAG_CMD)):
+                    self.receive_diag(recvmsg)
+                    continue
+                if (recvmsg.decode('utf-8').startswith("esp_trace")):
+                    # レイテンシトレース(JSON)は表示せずログのみ
+                    print(recvmsg)
+                    continue
+                if (recvmsg.decode('utf-8').startswith(PANELS_CMD)):
+                    # パネルの死活(JSON)はパネル欄へ、ゲーム状態と関係ない
+                    self.receive_panels(recvmsg.decode('utf-8'))
+                    continue
+                if (recvmsg.decode('utf-8').startswith(FWUP_CMD)):
+                    self.receive_fwup(recvmsg.decode('utf-8'))
+                    continue
                 statusText.set(recvmsg)
                 print(recvmsg)
+                if (recvmsg.decode('utf-8') in ("esp_tune", "esp_fwup")):
+                    # 難易度調整・配信開始の応答はゲーム状態と関係ない
+                    continue
                 if (recvmsg.decode('utf-8') == "esp_gamestart"):
                     print("button Lock")
                     # buttonLock = True
@@ -42,6 +82,97 @@ class ServerThread(threading.Thread):
                 app.entryBtn.configure(state='disabled')
                 exit()
 
+    def receive_panels(self, recvmsg):
+        # {"alive":N,"dead":[..],"stuck":[..],"unknown":[..],"fw":[..],"rxovr":[..]}
+        print(recvmsg)
+        try:
+            live = json.loads(recvmsg[len(PANELS_CMD):])
+        except ValueError as e:
+            print(e)
+            return
+        text = u"Panels alive: {}".format(live['alive'])
+        if live['dead']:
+            text += u"  dead: " + ",".join(str(i) for i in live['dead'])
+        if live['stuck']:
+            text += u"  stuck: " + ",".join(str(i) for i in live['stuck'])
+        rxovr = [str(i + 1) for i, n in enumerate(live.get('rxovr', [])) if n]
+        if rxovr:
+            text += u"  rx overrun: " + ",".join(rxovr)
+        panelText.set(text)
+
+    def receive_fwup(self, recvmsg):
+        # {"state":"done","size":N,...,"done":[..],"failed":[..],"refused":[..],"noReply":[..]}
+        print(recvmsg)
+        try:
+            res = json.loads(recvmsg[len(FWUP_CMD):])
+        except ValueError as e:
+            print(e)
+            return
+        text = u"Panel FW {}: {} bytes, {} ms".format(
+            res['state'], res['size'], res['ms'])
+        for key in ('done', 'failed', 'refused', 'noReply'):
+            if res[key]:
+                text += u"  {}: ".format(key) + ",".join(str(i) for i in res[key])
+        statusText.set(text)
+
+    def receive_binary(self, recvmsg, cmd):
+        # "<cmd><bytes>\n" + バイナリ
+        head, _, data = recvmsg.partition(b"\n")
+        size = int(head[len(cmd):])
+        while len(data) < size:
+            chunk = s.recv(size - len(data))
+            if not chunk:
+                raise ConnectionError("binary truncated")
+            data += chunk
+        return data[:size]
+
+    def receive_rec(self, recvmsg):
+        data = self.receive_binary(recvmsg, REC_CMD)
+        os.makedirs(REC_DIR, exist_ok=True)
+        path = os.path.join(REC_DIR,
+                            time.strftime("%Y%m%d_%H%M%S") + ".tbrec")
+        with open(path, "wb") as f:
+            f.write(data)
+        print(u"Recording saved: {} ({} bytes)".format(path, len(data)))
+
+    def receive_diag(self, recvmsg):
+        data = self.receive_binary(recvmsg, DIAG_CMD)
+        os.makedirs(REC_DIR, exist_ok=True)
+        path = os.path.join(REC_DIR,
+                            time.strftime("%Y%m%d_%H%M%S") + ".tbdiag")
+        with open(path, "wb") as f:
+            f.write(data)
+        with open(path + ".txt", "w") as f:
+            f.write(decode_diag(data))
+        print(u"Diagnostics saved: {} ({} bytes)".format(path, len(data)))
+
+
+def decode_diag(data):
+    # diagHeader_t + diagEvent_t * n -> 1記録1行(時刻は読み出し時からの相対[ms])
+    magic, version, size, now, count, dropped = DIAG_HEADER.unpack_from(data)
+    if magic != b"TBDG" or size != DIAG_EVENT.size:
+        return u"bad diagnostics header\n"
+    lines = [u"version:{} events:{} dropped:{}".format(version, count, dropped)]
+    for i in range(count):
+        t, code, arg, arg2, raw = DIAG_EVENT.unpack_from(
+            data, DIAG_HEADER.size + i * DIAG_EVENT.size)
+        dt = ((t - now + 0x80000000) % 0x100000000 - 0x80000000) / 1000.0
+        name = DIAG_CODES.get(code, u"code{}".format(code))
+        if code in (1, 5):
+            detail = u"id:0x{:03x} dlc:{} data:{}".format(
+                arg2, arg, raw[:arg].hex())
+        elif code == 2:
+            detail = u"panel:{} seq:{} btn:{} rgb:{},{},{} v{}".format(
+                arg, arg2, raw[0], raw[1], raw[2], raw[3], raw[4])
+        elif code == 3:
+            detail = u"frames:{} forwarded:{}".format(arg, arg2)
+        elif code == 6:
+            detail = u"panel:{} seq:{} tries:{}".format(arg, arg2, raw[0])
+        else:
+            detail = u"panel:{} seq:{}".format(arg, arg2)
+        lines.append(u"{:+12.3f}ms {:<12} {}".format(dt, name, detail))
+    return u"\n".join(lines) + u"\n"
+
 
 class Application(tk.Frame):
     def __init__(self, master):
@@ -51,6 +182,7 @@ class Application(tk.Frame):
         self.master.option_add('*font', ('Helvetica', 12))
         self.grid(row=0, column=0, sticky="we")
         self.player = {}
+        self.players = []  # 同時に遊ぶプレイヤー(並びが区画, 最大3人)
         self.create_widgets()
 
     def create_widgets(self):
@@ -87,6 +219,20 @@ class Application(tk.Frame):
         #     self.entryBtn.configure(state='normal')
         self.entryBtn.grid(row=4, column=2, padx=5, pady=5)
 
+        # Add (同時に遊ぶプレイヤーを追加、Player Entryでまとめて送る)
+        self.addBtn = tk.Button(text=u'Add Player', command=self.add)
+        self.addBtn.grid(row=2, column=2, padx=5, pady=5)
+        self.addLabel = tk.Label(text=u'')
+        self.addLabel.grid(row=5, column=1, padx=5, pady=5, sticky="W")
+
+        # Tune (次のゲームから反映)
+        self.tuneBtn = tk.Button(text=u'Tune', command=self.tune)
+        self.tuneBtn.grid(row=3, column=2, padx=5, pady=5)
+
+        # Panel FW (ゲームの合間に全Panelへ配信)
+        self.fwupBtn = tk.Button(text=u'Panel FW', command=self.fwup)
+        self.fwupBtn.grid(row=5, column=2, padx=5, pady=5)
+
         # self.hi_there = tk.Button(self)
         # self.hi_there["text"] = "Hello World\n(click me)"
         # self.hi_there["command"] = self.say_hi
@@ -98,7 +244,25 @@ class Application(tk.Frame):
 
         # self.
 
+    def add(self):
+        if len(self.players) >= 3:
+            return
+        self.read_player()
+        self.players.append(dict(self.player))
+        self.addLabel.configure(
+            text=", ".join(p['name'] for p in self.players))
+
     def entry(self):
+        if self.players:
+            # 同時プレイ: JSON配列で送る
+            s.send(json.dumps(self.players, ensure_ascii = False).encode("UTF-8"))
+            self.players = []
+            self.addLabel.configure(text=u'')
+            return
+        self.read_player()
+        s.send(json.dumps(self.player, ensure_ascii = False).encode("UTF-8"))
+
+    def read_player(self):
         self.player['startFlag'] = True
         self.player['name'] = self.nameForm.get()
 
@@ -120,7 +284,29 @@ class Application(tk.Frame):
         elif (self.dfcltForm.get() == "Lunatic"):
             self.player['difficulty'] = 4
 
-        s.send(json.dumps(self.player, ensure_ascii = False).encode("UTF-8"))
+    def tune(self):
+        # dfclt_tune.json: {"Hard": {"spawnMs": 600, "lightMs": 1500, ...}, ...}
+        # {"reset": 1} で既定値に戻す
+        try:
+            with open(TUNE_FILE, encoding="UTF-8") as f:
+                table = json.load(f)
+        except Exception as e:
+            print(e)
+            statusText.set(u"Cannot read " + os.path.basename(TUNE_FILE))
+            return
+
+        dfclt = self.dfcltForm.get()
+        if dfclt not in table:
+            statusText.set(u"No tune entry: " + dfclt)
+            return
+
+        msg = {'tune': self.dfcltForm.current() + 1}
+        msg.update(table[dfclt])
+        s.send(json.dumps(msg).encode("UTF-8"))
+
+    def fwup(self):
+        # イメージはMasterのSPIFFS(/spiffs/panel_v2.bin)に置いておく
+        s.send(json.dumps({'fwup': 1}).encode("UTF-8"))
 
 
 root = tk.Tk()
@@ -156,6 +342,14 @@ statFrame.statLabel = tk.Label(
 statFrame.statLabel.grid(row=5, column=0, columnspan=3,
                          sticky="wes")
 
+# Panels (死活監視、途絶えたパネルはゲームに使わない)
+panelText = tk.StringVar()
+panelText.set("Panels...")
+statFrame.panelLabel = tk.Label(
+    textvariable=panelText, font=('Helvetica', '12'), anchor="w")
+statFrame.panelLabel.grid(row=6, column=0, columnspan=3,
+                          sticky="wes")
+
 th = ServerThread()
 th.setDaemon(True)
 th.start()
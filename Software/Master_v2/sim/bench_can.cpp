@@ -0,0 +1,549 @@
+/*****************************************************************************/
+/**
+ * @file bench_can.cpp
+ * @comments CANプロトコルのスループット計測(仮想CANバス)
+ *
+ *           vcan.hのバスにMaster(ESP32のTWAI、TXキュー5)と25枚のPanel
+ *           (shim/mcp_can.hのMCP_CAN、Panel_v2と同じマスク/フィルタ)を繋ぎ、
+ *           Masterが盤面の更新を送り続けたときに
+ *             - 1秒あたりに何枚分のPanelが更新できるか
+ *             - キュー投入からPanelが読み出すまでの遅延(競合時を含む)
+ *             - MCP2515の受信バッファの溢れ
+ *           を送り方(シナリオ)毎に比べる。時刻は仮想時間で、実行環境に依らない。
+ *
+ *           Panelのファームウェアは1フレーム毎に--panel-us[us]かかるものとし
+ *           (SPIの読み出しとシリアル出力)、その間に来たフレームはRXB0/RXB1に溜まる。
+ *           Masterはdrv_canと同じく同じPanel宛てをconfigCAN_PANEL_GAP_MS空ける
+ *           (グループ宛ては含まれる全Panel、drv_canpaceをそのまま使う)。PanelはTBCAN_HEARTBEAT_MS毎に状態を返す。
+ *
+ *   make bench-can && ./build/bench_can [--secs S] [--panel-us US] [--gap-ms MS]
+ *                                       [--err P] [--reply P] [--seed N]
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "def_system.h"
+#include "drv_canpace.h"
+#include "mcp_can.h"
+#include "tb_canproto.h"
+
+#include "sim_stats.h"
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define BENCH_NS_PER_MS 1000000ULL
+#define BENCH_DEFAULT_SECS 10
+#define BENCH_DEFAULT_PANEL_US 2000
+#define BENCH_DEFAULT_REPLY 0.2 // 競合シナリオ: 更新毎にPanelが押下を返す確率
+#define BENCH_TX_QUEUE_LEN 5    // CAN_GENERAL_CONFIG_DEFAULT
+#define BENCH_RX_QUEUE_LEN 5
+#define BENCH_STATUS_STAGGER_MS 40 // 起動の報告と同じくPanelID毎にずらす
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 盤面の更新1回分のフレーム(1周したら最初から繰り返す) */
+struct BenchJob
+{
+    uint32_t ulCanId; // 更新されるPanelはulGroupPanelMask(drv_canpaceが引く)
+};
+
+struct BenchScenario
+{
+    const char *pcName;
+    uint8_t bVer;
+    bool bReply; // Panelが押下を返す(Master宛て、ID 0で必ず調停に勝つ)
+    std::vector<BenchJob> jobs;
+};
+
+struct BenchOpt
+{
+    uint32_t ulSecs = BENCH_DEFAULT_SECS;
+    uint32_t ulPanelUs = BENCH_DEFAULT_PANEL_US;
+    uint32_t ulGapMs = configCAN_PANEL_GAP_MS;
+    double dErr = 0.0;
+    double dReply = BENCH_DEFAULT_REPLY;
+    uint64_t ullSeed = 1;
+};
+
+struct BenchPanel
+{
+    BenchPanel() : xCan(0) {}
+
+    MCP_CAN xCan;
+    uint8_t bId = 0;
+    uint64_t ullBusyNs = 0; // ファームウェアがフレームを処理し終える時刻
+    bool bPolling = false;  // 読み出しのイベントを置いた
+    uint8_t bStatusCount = 0;
+};
+
+/* drv_canから見たMaster: TXキューから送り終えた時刻と投入時刻を対応付ける */
+class BenchMaster : public VcanTwai
+{
+  public:
+    BenchMaster() : VcanTwai(BENCH_TX_QUEUE_LEN, BENCH_RX_QUEUE_LEN) {}
+
+    bool bEnqueue(const can_message_t *pxMsg, uint64_t ullNs)
+    {
+        if (!bTransmit(pxMsg, ullNs))
+            return false;
+        m_enq.push_back(ullNs);
+        return true;
+    }
+
+    void vTxDone(bool bOk, uint64_t ullNs) override;
+
+    std::deque<uint64_t> m_enq;
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static BenchOpt gxOpt;
+
+// イベント(時刻順、同時刻は登録順)
+struct BenchEvent
+{
+    uint64_t ullNs;
+    uint64_t ullSeq;
+    std::function<void()> fn;
+    bool operator>(const BenchEvent &x) const
+    {
+        return ullNs != x.ullNs ? ullNs > x.ullNs : ullSeq > x.ullSeq;
+    }
+};
+static std::priority_queue<BenchEvent, std::vector<BenchEvent>, std::greater<BenchEvent>> gxEvents;
+static uint64_t gullEventSeq = 0;
+static uint64_t gullNowNs = 0;
+
+// 1シナリオ分の状態
+static VcanBus *gpxBus = nullptr;
+static BenchMaster *gpxMaster = nullptr;
+static BenchPanel *gpxPanels = nullptr; // [MAX_PANEL_NUM]
+static const BenchScenario *gpxScenario = nullptr;
+static size_t guxJob = 0;
+static canPace_t gxPace; // 宛先Panel毎の間隔と間隔待ちのフレーム
+static bool gbFillPosted = false;
+static uint64_t gullRand = 1;
+static std::unordered_map<uint64_t, uint64_t> gxDoneToEnq; // バス上の送信完了時刻 -> 投入時刻
+
+// 計測
+static uint64_t gullUpdates = 0; // 更新を読み出したPanelの延べ数
+static uint64_t gullReplies = 0;
+static uint64_t gullReplyFull = 0; // TXBが空いていなかった
+static uint64_t gullMasterRx = 0;
+static SimSeries gxLatency;      // 投入 -> Panelが読み出す[us]
+static SimSeries gxBusToRead;    // バス上の受信完了 -> Panelが読み出す[us]
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvPost(uint64_t ullNs, std::function<void()> fn);
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs);
+static void prvMasterFill();
+static void prvMasterDrain();
+static void prvPanelInt(void *pvCtx, uint64_t ullNs);
+static void prvPanelPoll(BenchPanel *pxPanel);
+static void prvPanelStatus(BenchPanel *pxPanel);
+static void prvPanelInit(BenchPanel *pxPanel, uint8_t bId);
+static double prvRand();
+static void prvRun(const BenchScenario &xScenario);
+static std::vector<BenchScenario> prvScenarios();
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *pcArg = argv[i];
+        const char *pcVal = i + 1 < argc ? argv[i + 1] : NULL;
+        if (pcVal == NULL)
+        {
+            fprintf(stderr, "bench_can: %s needs a value\n", pcArg);
+            return 1;
+        }
+        if (strcmp(pcArg, "--secs") == 0)
+            gxOpt.ulSecs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--panel-us") == 0)
+            gxOpt.ulPanelUs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--gap-ms") == 0)
+            gxOpt.ulGapMs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--err") == 0)
+            gxOpt.dErr = atof(pcVal);
+        else if (strcmp(pcArg, "--reply") == 0)
+            gxOpt.dReply = atof(pcVal);
+        else if (strcmp(pcArg, "--seed") == 0)
+            gxOpt.ullSeed = strtoull(pcVal, NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: bench_can [--secs S] [--panel-us US] [--gap-ms MS] "
+                            "[--err P] [--reply P] [--seed N]\n");
+            return 1;
+        }
+        i++;
+    }
+
+    printf("secs=%u panel-us=%u gap-ms=%u err=%g reply=%g bitrate=%u\n", gxOpt.ulSecs,
+           gxOpt.ulPanelUs, gxOpt.ulGapMs, gxOpt.dErr, gxOpt.dReply, VCAN_BITRATE_DEFAULT);
+    printf("%-20s %8s %8s %7s %9s %9s %9s %8s %7s %7s\n", "", "upd/s", "frame/s", "load%",
+           "p50[us]", "p99[us]", "max[us]", "rxb-ovr", "arb", "errors");
+    for (const BenchScenario &xScenario : prvScenarios())
+        prvRun(xScenario);
+    return 0;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * シナリオ
+ * 盤面全体を1回更新するフレームの並び。
+ *
+ * @param    ##
+ *
+ * @return   シナリオの一覧
+ *
+ * @note     v2-row / v2-allは行(全体)で同じ色を送れるときだけ使える
+ *
+ ******************************************************************************/
+static std::vector<BenchScenario> prvScenarios()
+{
+    std::vector<BenchScenario> xList;
+    BenchScenario xUni1 = {"v1 unicast", TBCAN_VER_1, false, {}};
+    BenchScenario xUni2 = {"v2 unicast", TBCAN_VER_2, false, {}};
+    BenchScenario xRow = {"v2 row group", TBCAN_VER_2, false, {}};
+    BenchScenario xAll = {"v2 all group", TBCAN_VER_2, false, {}};
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        xUni1.jobs.push_back({i});
+        xUni2.jobs.push_back({i});
+    }
+    for (uint32_t r = 0; r < TBCAN_GRID_SIZE; r++)
+        xRow.jobs.push_back({CAN_ID_GROUP_ROW(r)});
+    xAll.jobs.push_back({CAN_ID_GROUP_ALL});
+
+    BenchScenario xUniReply = xUni2;
+    xUniReply.pcName = "v2 unicast +reply";
+    xUniReply.bReply = true;
+    BenchScenario xAllReply = xAll;
+    xAllReply.pcName = "v2 all +reply";
+    xAllReply.bReply = true;
+
+    xList.push_back(xUni1);
+    xList.push_back(xUni2);
+    xList.push_back(xRow);
+    xList.push_back(xAll);
+    xList.push_back(xUniReply);
+    xList.push_back(xAllReply);
+    return xList;
+}
+
+/*****************************************************************************/
+/**
+ * 1シナリオの実行と結果の出力
+ *
+ * @param    xScenario: シナリオ
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvRun(const BenchScenario &xScenario)
+{
+    VcanBus xBus;
+    BenchMaster xMaster;
+    std::vector<BenchPanel> xPanels(MAX_PANEL_NUM);
+    uint64_t ullEndNs = (uint64_t)gxOpt.ulSecs * 1000 * BENCH_NS_PER_MS;
+
+    // 状態の初期化
+    gxEvents = decltype(gxEvents)();
+    gullNowNs = 0;
+    gpxBus = &xBus;
+    gpxMaster = &xMaster;
+    gpxPanels = xPanels.data();
+    gpxScenario = &xScenario;
+    guxJob = 0;
+    vCanPaceInit(&gxPace, (int64_t)gxOpt.ulGapMs * 1000);
+    gbFillPosted = false;
+    gullRand = gxOpt.ullSeed * 0x9E3779B97F4A7C15ULL + 1;
+    gxDoneToEnq.clear();
+    gullUpdates = gullReplies = gullReplyFull = gullMasterRx = 0;
+    gxLatency.vClear();
+    gxBusToRead.vClear();
+
+    xBus.vSetWake(prvBusWake, NULL);
+    xBus.vSetErrorRate(gxOpt.dErr, gxOpt.ullSeed);
+    vVcanSetDefaultBus(&xBus);
+    xBus.iAttach(&xMaster);
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+        prvPanelInit(&xPanels[i], (uint8_t)i);
+
+    prvPost(0, prvMasterFill);
+    while (!gxEvents.empty() && gxEvents.top().ullNs <= ullEndNs)
+    {
+        BenchEvent xEvent = gxEvents.top();
+        gxEvents.pop();
+        gullNowNs = xEvent.ullNs;
+        xBus.vAdvance(gullNowNs);
+        xEvent.fn();
+        prvMasterDrain();
+    }
+    xBus.vAdvance(ullEndNs);
+
+    // 結果
+    const VcanBusStats &xStats = xBus.xStats();
+    uint64_t ullOverflow = 0;
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+        ullOverflow += xPanels[i].xCan.xModel().ulRxOverflow[0] +
+                       xPanels[i].xCan.xModel().ulRxOverflow[1];
+    printf("%-20s %8.0f %8.0f %7.1f %9llu %9llu %9llu %8llu %7u %7llu\n", xScenario.pcName,
+           (double)gullUpdates / gxOpt.ulSecs, (double)xMaster.ulTxOk / gxOpt.ulSecs,
+           100.0 * xStats.ullBusyNs / ullEndNs, (unsigned long long)gxLatency.ullPercentile(50),
+           (unsigned long long)gxLatency.ullPercentile(99), (unsigned long long)gxLatency.ullMax(),
+           (unsigned long long)ullOverflow, xMaster.ulArbLost,
+           (unsigned long long)xStats.ullErrors);
+    if (xScenario.bReply)
+    {
+        // 全Panelが同じID(TBCAN_ID_MASTER)で返すので、同時に送ると実機ではビットエラーになる
+        printf("%-20s replies=%llu (txb full %llu) same-id=%llu master-rx=%llu rx-missed=%u "
+               "bus->read p99=%lluus\n",
+               "", (unsigned long long)gullReplies, (unsigned long long)gullReplyFull,
+               (unsigned long long)xStats.ullIdClash, (unsigned long long)gullMasterRx,
+               xMaster.ulRxMissed, (unsigned long long)gxBusToRead.ullPercentile(99));
+    }
+    vVcanSetDefaultBus(nullptr);
+}
+
+static void prvPost(uint64_t ullNs, std::function<void()> fn)
+{
+    gxEvents.push({ullNs, gullEventSeq++, fn});
+}
+
+/* バスは各イベントの前にvAdvance()するので、時刻に起こすだけでよい */
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs)
+{
+    (void)pvCtx;
+    prvPost(ullAtNs, [] {});
+}
+
+/*****************************************************************************/
+/**
+ * Master: TXキューに空きがある間、次のフレームを入れる
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     宛先のPanelが前回からgap-ms経っていなければ取っておき、次の仕事を先に送る
+ *           (drv_canのCAN_txタスクと同じく列の先頭で待たない)。
+ *           取っておく場所が埋まったら、取っておいたフレームが送れる時刻まで待つ
+ *
+ ******************************************************************************/
+static void prvMasterFill()
+{
+    gbFillPosted = false;
+    while (gpxMaster->ulTxWaiting() < BENCH_TX_QUEUE_LEN)
+    {
+        int64_t llNowUs = (int64_t)(gullNowNs / 1000);
+        canCommMsg_t xJobMsg = {};
+
+        if (xCanPacePop(&gxPace, 0, llNowUs, &xJobMsg) != pdTRUE)
+        {
+            if (xCanPaceFull(&gxPace) == pdTRUE)
+            {
+                gbFillPosted = true;
+                prvPost((uint64_t)llCanPaceNextUs(&gxPace, 0) * 1000, prvMasterFill);
+                return;
+            }
+            xJobMsg.ulCanId = gpxScenario->jobs[guxJob].ulCanId;
+            xJobMsg.bSeq = (uint8_t)guxJob;
+            guxJob = (guxJob + 1) % gpxScenario->jobs.size();
+            if (xCanPaceSubmit(&gxPace, &xJobMsg, 0, llNowUs) != pdTRUE)
+                continue;
+        }
+
+        tbCanFrame_t xFrame = {};
+        can_message_t xMsg = {};
+        xFrame.bR = 255;
+        xFrame.bG = (uint8_t)(xJobMsg.bSeq * 40);
+        xFrame.bB = 0;
+        xFrame.usLightMs = 500;
+        xFrame.bSeq = xJobMsg.bSeq;
+        xMsg.identifier = xJobMsg.ulCanId;
+        xMsg.data_length_code = bTbCanEncode(&xFrame, gpxScenario->bVer, xMsg.data);
+        if (!gpxMaster->bEnqueue(&xMsg, gullNowNs))
+            return;
+    }
+}
+
+/* Master: CAN_rxタスク相当(受信をすぐに読み出す) */
+static void prvMasterDrain()
+{
+    can_message_t xMsg;
+    while (gpxMaster->bReceive(&xMsg, NULL))
+        gullMasterRx++;
+}
+
+/* TXキューに空きができた */
+void BenchMaster::vTxDone(bool bOk, uint64_t ullNs)
+{
+    VcanTwai::vTxDone(bOk, ullNs);
+    if (bOk && !m_enq.empty())
+    {
+        gxDoneToEnq[ullNs] = m_enq.front();
+        m_enq.pop_front();
+    }
+    if (!gbFillPosted)
+    {
+        gbFillPosted = true;
+        prvPost(ullNs, prvMasterFill);
+    }
+}
+
+/*****************************************************************************/
+/**
+ * Panel: Panel_v2のbInitCanDriver()と同じ設定
+ *
+ * @param    pxPanel: Panel
+ * @param    bId: PanelID
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvPanelInit(BenchPanel *pxPanel, uint8_t bId)
+{
+    uint32_t ulRow = (bId - 1) / TBCAN_GRID_SIZE;
+    uint32_t ulCol = (bId - 1) % TBCAN_GRID_SIZE;
+    uint32_t ulGroupMask = TBCAN_ID_GROUP_FLAG | (1UL << (TBCAN_ID_GROUP_ROW_SHIFT + ulRow)) |
+                           (1UL << ulCol);
+
+    pxPanel->bId = bId;
+    pxPanel->xCan.begin(CAN_500KBPS, MCP_8MHz);
+    pxPanel->xCan.init_Mask(0, 0, ulGroupMask);
+    pxPanel->xCan.init_Filt(0, 0, TBCAN_ID_GROUP_FLAG);
+    pxPanel->xCan.init_Filt(1, 0, TBCAN_ID_GROUP_FLAG);
+    pxPanel->xCan.init_Mask(1, 0, TBCAN_ID_STD_MASK);
+    for (int i = 2; i < 6; i++)
+        pxPanel->xCan.init_Filt(i, 0, bId);
+    pxPanel->xCan.xModel().vSetInt(prvPanelInt, pxPanel);
+    prvPost((uint64_t)bId * BENCH_STATUS_STAGGER_MS * BENCH_NS_PER_MS,
+            [pxPanel] { prvPanelStatus(pxPanel); });
+}
+
+/* INT(H->L): loop()が次に回ってきたときに読む */
+static void prvPanelInt(void *pvCtx, uint64_t ullNs)
+{
+    BenchPanel *pxPanel = (BenchPanel *)pvCtx;
+    if (pxPanel->bPolling)
+        return;
+    pxPanel->bPolling = true;
+    prvPost(ullNs > pxPanel->ullBusyNs ? ullNs : pxPanel->ullBusyNs,
+            [pxPanel] { prvPanelPoll(pxPanel); });
+}
+
+/*****************************************************************************/
+/**
+ * Panel: 1フレーム読み出して処理する(uCanReceiveInfo相当)
+ *
+ * @param    pxPanel: Panel
+ *
+ * @return   ##
+ *
+ * @note     処理に--panel-us掛かり、その間に来たフレームは受信バッファに溜まる
+ *
+ ******************************************************************************/
+static void prvPanelPoll(BenchPanel *pxPanel)
+{
+    uint8_t bLen = 0;
+    uint8_t bBuf[CAN_MAX_DATA_LEN];
+    tbCanFrame_t xFrame;
+
+    pxPanel->bPolling = false;
+    if (pxPanel->xCan.checkReceive() != CAN_MSGAVAIL)
+        return;
+    pxPanel->xCan.readMsgBuf(&bLen, bBuf);
+    pxPanel->ullBusyNs = gullNowNs + (uint64_t)gxOpt.ulPanelUs * 1000;
+
+    if (bTbCanDecodeCtrl(bBuf, bLen) == 0 && bTbCanDecode(bBuf, bLen, &xFrame) != 0)
+    {
+        gullUpdates++;
+        uint64_t ullRxNs = pxPanel->xCan.ullLastRxNs();
+        auto it = gxDoneToEnq.find(ullRxNs);
+        if (it != gxDoneToEnq.end())
+            gxLatency.vAdd((gullNowNs - it->second) / 1000);
+        gxBusToRead.vAdd((gullNowNs - ullRxNs) / 1000);
+
+        // 押下の返答(v2)
+        if (gpxScenario->bReply && prvRand() < gxOpt.dReply)
+        {
+            tbCanFrame_t xReply = {};
+            uint8_t bData[CAN_MAX_DATA_LEN];
+            xReply.bPanelId = pxPanel->bId;
+            xReply.bBtn = 1;
+            xReply.bSeq = xFrame.bSeq;
+            uint8_t bDlc = bTbCanEncodeV2(&xReply, bData);
+            if (pxPanel->xCan.sendMsgBuf(TBCAN_ID_MASTER, 0, bDlc, bData) == CAN_OK)
+                gullReplies++;
+            else
+                gullReplyFull++;
+        }
+    }
+
+    if (pxPanel->xCan.checkReceive() == CAN_MSGAVAIL)
+    {
+        pxPanel->bPolling = true;
+        prvPost(pxPanel->ullBusyNs, [pxPanel] { prvPanelPoll(pxPanel); });
+    }
+}
+
+/* Panel: 死活監視の定期送信 */
+static void prvPanelStatus(BenchPanel *pxPanel)
+{
+    tbCanStatus_t xStatus = {};
+    uint8_t bData[CAN_MAX_DATA_LEN];
+
+    xStatus.bPanelId = pxPanel->bId;
+    xStatus.bCount = pxPanel->bStatusCount++;
+    xStatus.bReason = TBCAN_STATUS_PERIODIC;
+    xStatus.bCap = TBCAN_VER_2;
+    uint8_t bDlc = bTbCanEncodeStatus(&xStatus, bData);
+    pxPanel->xCan.sendMsgBuf(TBCAN_ID_STATUS_BASE + pxPanel->bId, 0, bDlc, bData);
+    prvPost(gullNowNs + (uint64_t)TBCAN_HEARTBEAT_MS * BENCH_NS_PER_MS,
+            [pxPanel] { prvPanelStatus(pxPanel); });
+}
+
+/* xorshift64* */
+static double prvRand()
+{
+    gullRand ^= gullRand >> 12;
+    gullRand ^= gullRand << 25;
+    gullRand ^= gullRand >> 27;
+    return (double)((gullRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
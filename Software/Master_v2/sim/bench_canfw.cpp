@@ -0,0 +1,583 @@
+/*****************************************************************************/
+/**
+ * @file bench_canfw.cpp
+ * @comments Panelのファームウェア一斉配信の計測(仮想CANバス, tb_canfw.h)
+ *
+ *           vcan.hのバスにMaster(ESP32のTWAI、TXキュー5)と25枚のPanel
+ *           (shim/mcp_can.hのMCP_CAN、tb_canfw.hのブートローダのマスク/フィルタ)を繋ぎ、
+ *           drv_canfwと同じくtbFwTx_tでイメージを配信して
+ *             - 全Panelが確定するまでの時間、実効スループット
+ *             - 送り直しの周回とブロック数、MCP2515の受信バッファの溢れ
+ *           をシナリオ毎に比べる。最後に各Panelのフラッシュをイメージと照合する。
+ *           時刻は仮想時間で、実行環境に依らない。
+ *
+ *           Panel(ブートローダ)は1フレームの読み出しに--panel-us[us]、
+ *           ページの書き込みに--write-us[us](シナリオによってばらつく)、
+ *           CRCの確認に1byteあたりTBFW_VERIFY_MS / TBFW_IMAGE_MAXかかるものとし、
+ *           その間に来たフレームはRXB0/RXB1に溜まる(溢れたチャンクはNACKで送り直される)。
+ *
+ *   make bench-canfw && ./build/bench_canfw [--size BYTES] [--panel-us US] [--write-us US]
+ *                                           [--gap-ms MS] [--seed N]
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "def_system.h"
+#include "mcp_can.h"
+#include "tb_canfw.h"
+#include "tb_canproto.h"
+
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define BENCH_NS_PER_US 1000ULL
+#define BENCH_NS_PER_MS 1000000ULL
+#define BENCH_TIMEOUT_MS 60000 // 1シナリオの上限(仮想時間)
+#define BENCH_DEFAULT_SIZE 30000
+#define BENCH_DEFAULT_PANEL_US 100   // SPIでRXBを読んでチャンクを写す
+#define BENCH_DEFAULT_WRITE_US 9000  // ページの消去 + 書き込み(ATmega328P 約4.5ms x 2)
+#define BENCH_FLASH_MAX 30720        // 32KB - ブートローダ(2KB)
+#define BENCH_TX_QUEUE_LEN 5         // CAN_GENERAL_CONFIG_DEFAULT
+#define BENCH_RX_QUEUE_LEN 5
+#define BENCH_REPLY_RETRY_US 500     // TXBが空いていないときの再試行
+#define BENCH_FW_MAJOR 2             // 配信するイメージのバージョン
+#define BENCH_FW_MINOR 4
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+struct BenchScenario
+{
+    const char *pcName;
+    double dErr;          // バスのエラー率(フレーム毎、自動再送される)
+    uint32_t ulWriteJitterUs; // 書き込み時間のばらつき(0 .. この値を足す)
+    double dDrop;         // Panelがフレームを取りこぼす率(SPIの読み損ないなど)
+    uint32_t ulOffline;   // 電源の入っていないPanel
+    uint32_t ulNoBoot;    // ブートローダの無いPanel(Panel_v2のアプリケーションが応答)
+};
+
+struct BenchOpt
+{
+    uint32_t ulSize = BENCH_DEFAULT_SIZE;
+    uint32_t ulPanelUs = BENCH_DEFAULT_PANEL_US;
+    uint32_t ulWriteUs = BENCH_DEFAULT_WRITE_US;
+    uint32_t ulGapMs = configCANFW_BLOCK_GAP_MS;
+    uint64_t ullSeed = 1;
+};
+
+struct BenchPanel
+{
+    BenchPanel() : xCan(0) {}
+
+    MCP_CAN xCan;
+    uint8_t bId = 0;
+    bool bNoBoot = false;
+    uint64_t ullBusyNs = 0; // ファームウェアがフレームを処理し終える時刻
+    bool bPolling = false;  // 読み出しのイベントを置いた
+    tbFwRx_t xRx;
+    tbFwIo_t xIo;
+    std::vector<uint8_t> flash;
+    std::deque<can_message_t> replies; // TXBへ入れる応答
+    bool bReplyPosted = false;
+    bool bBooted = false; // DONEを返して新しいファームウェアで起動した
+    uint32_t ulWrites = 0;
+    uint32_t ulDropped = 0;
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static BenchOpt gxOpt;
+
+// イベント(時刻順、同時刻は登録順)
+struct BenchEvent
+{
+    uint64_t ullNs;
+    uint64_t ullSeq;
+    std::function<void()> fn;
+    bool operator>(const BenchEvent &x) const
+    {
+        return ullNs != x.ullNs ? ullNs > x.ullNs : ullSeq > x.ullSeq;
+    }
+};
+static std::priority_queue<BenchEvent, std::vector<BenchEvent>, std::greater<BenchEvent>> gxEvents;
+static uint64_t gullEventSeq = 0;
+static uint64_t gullNowNs = 0;
+
+// 1シナリオ分の状態
+static VcanTwai *gpxMaster = nullptr;
+static BenchPanel *gpxPanels = nullptr; // [MAX_PANEL_NUM]
+static const BenchScenario *gpxScenario = nullptr;
+static tbFwTx_t gxTx;
+static uint64_t gullFillNs = UINT64_MAX; // 置いてあるprvMasterFillの時刻
+static uint64_t gullRand = 1;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvPost(uint64_t ullNs, std::function<void()> fn);
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs);
+static void prvMasterFill();
+static void prvMasterPost(uint64_t ullNs);
+static void prvMasterDrain();
+static void prvPanelInit(BenchPanel *pxPanel, uint8_t bId);
+static void prvPanelInt(void *pvCtx, uint64_t ullNs);
+static void prvPanelPoll(BenchPanel *pxPanel);
+static void prvPanelReply(BenchPanel *pxPanel);
+static uint8_t prvFlashWrite(void *pvCtx, uint8_t bBlock, const uint8_t *pbPage);
+static void prvFlashRead(void *pvCtx, uint16_t usOffset, uint8_t *pbData, uint8_t bLen);
+static double prvRand();
+static bool prvRun(const BenchScenario &xScenario);
+static std::vector<BenchScenario> prvScenarios();
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+int main(int argc, char **argv)
+{
+    bool bPass = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *pcArg = argv[i];
+        const char *pcVal = i + 1 < argc ? argv[i + 1] : NULL;
+        if (pcVal == NULL)
+        {
+            fprintf(stderr, "bench_canfw: %s needs a value\n", pcArg);
+            return 1;
+        }
+        if (strcmp(pcArg, "--size") == 0)
+            gxOpt.ulSize = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--panel-us") == 0)
+            gxOpt.ulPanelUs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--write-us") == 0)
+            gxOpt.ulWriteUs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--gap-ms") == 0)
+            gxOpt.ulGapMs = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--seed") == 0)
+            gxOpt.ullSeed = strtoull(pcVal, NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: bench_canfw [--size BYTES] [--panel-us US] [--write-us US] "
+                            "[--gap-ms MS] [--seed N]\n");
+            return 1;
+        }
+        i++;
+    }
+    if (gxOpt.ulSize == 0 || gxOpt.ulSize > BENCH_FLASH_MAX)
+    {
+        fprintf(stderr, "bench_canfw: --size must be 1..%u\n", BENCH_FLASH_MAX);
+        return 1;
+    }
+
+    printf("size=%u panel-us=%u write-us=%u gap-ms=%u bitrate=%u\n", gxOpt.ulSize,
+           gxOpt.ulPanelUs, gxOpt.ulWriteUs, gxOpt.ulGapMs, VCAN_BITRATE_DEFAULT);
+    printf("%-22s %8s %7s %7s %7s %7s %7s %8s %5s %5s %5s %6s\n", "", "time[ms]", "KB/s",
+           "load%", "rounds", "frames", "resent", "rxb-ovr", "done", "refus", "noRep", "result");
+    for (const BenchScenario &xScenario : prvScenarios())
+        bPass &= prvRun(xScenario);
+    return bPass ? 0 : 1;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * シナリオ
+ *
+ * @param    ##
+ *
+ * @return   シナリオの一覧
+ *
+ * @note     slow flashは書き込みがブロックの間隔を越えることがある
+ *           (次のブロックの先頭が溢れ、NACKで送り直す)
+ *
+ ******************************************************************************/
+static std::vector<BenchScenario> prvScenarios()
+{
+    std::vector<BenchScenario> xList;
+
+    xList.push_back({"clean", 0.0, 0, 0.0, 0, 0});
+    xList.push_back({"bus errors 1e-2", 1e-2, 0, 0.0, 0, 0});
+    xList.push_back({"slow flash", 0.0, 6000, 0.0, 0, 0});
+    xList.push_back({"drops+offline+noboot", 1e-3, 2000, 2e-3, 1UL << 7, 1UL << 13});
+    return xList;
+}
+
+/*****************************************************************************/
+/**
+ * 1シナリオの実行と結果の出力
+ *
+ * @param    xScenario: シナリオ
+ *
+ * @return   true: 期待どおり(確定したPanelのフラッシュがイメージと一致)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static bool prvRun(const BenchScenario &xScenario)
+{
+    VcanBus xBus;
+    VcanTwai xMaster(BENCH_TX_QUEUE_LEN, BENCH_RX_QUEUE_LEN);
+    std::vector<BenchPanel> xPanels(MAX_PANEL_NUM);
+    std::vector<uint8_t> image(gxOpt.ulSize);
+    uint64_t ullEndNs = (uint64_t)BENCH_TIMEOUT_MS * BENCH_NS_PER_MS;
+    uint32_t ulExpect = TBFW_PANEL_ALL & ~(xScenario.ulOffline | xScenario.ulNoBoot);
+    uint32_t ulVerified = 0;
+    uint64_t ullOverflow = 0;
+    bool bPass;
+
+    // 状態の初期化
+    gxEvents = decltype(gxEvents)();
+    gullNowNs = 0;
+    gpxMaster = &xMaster;
+    gpxPanels = xPanels.data();
+    gpxScenario = &xScenario;
+    gullFillNs = UINT64_MAX;
+    gullRand = gxOpt.ullSeed * 0x9E3779B97F4A7C15ULL + 1;
+    for (uint8_t &b : image)
+        b = (uint8_t)(prvRand() * 256);
+
+    xBus.vSetWake(prvBusWake, NULL);
+    xBus.vSetErrorRate(xScenario.dErr, gxOpt.ullSeed);
+    vVcanSetDefaultBus(&xBus);
+    xBus.iAttach(&xMaster);
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((xScenario.ulOffline & (1UL << i)) == 0)
+            prvPanelInit(&xPanels[i], (uint8_t)i);
+    }
+
+    // drv_canfwのprvCanFwTask相当
+    vTbFwTxStart(&gxTx, image.data(), (uint16_t)image.size(), BENCH_FW_MAJOR, BENCH_FW_MINOR,
+                 1, TBFW_PANEL_ALL, 0);
+    gxTx.ulFrameGapUs = configCANFW_FRAME_GAP_US;
+    gxTx.ulBlockGapUs = gxOpt.ulGapMs * 1000UL;
+    prvMasterPost(0);
+    while (!gxEvents.empty() && gxEvents.top().ullNs <= ullEndNs && !bTbFwTxFinished(&gxTx))
+    {
+        BenchEvent xEvent = gxEvents.top();
+        gxEvents.pop();
+        gullNowNs = xEvent.ullNs;
+        xBus.vAdvance(gullNowNs);
+        xEvent.fn();
+        prvMasterDrain();
+    }
+
+    // 結果: 確定したPanelのフラッシュを照合する
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        BenchPanel &xPanel = xPanels[i];
+        if ((xScenario.ulOffline & (1UL << i)) != 0)
+            continue;
+        ullOverflow += xPanel.xCan.xModel().ulRxOverflow[0] + xPanel.xCan.xModel().ulRxOverflow[1];
+        if (xPanel.bBooted && memcmp(xPanel.flash.data(), image.data(), image.size()) == 0)
+            ulVerified |= 1UL << i;
+    }
+    uint32_t ulNoReply = gxTx.ulTargets & ~(gxTx.ulReady | gxTx.ulRefused);
+    bPass = gxTx.bState == TBFW_TX_FINISHED && gxTx.ulDone == ulExpect &&
+            ulVerified == ulExpect && gxTx.ulRefused == xScenario.ulNoBoot &&
+            ulNoReply == xScenario.ulOffline;
+
+    uint32_t ulMs = (gxTx.ulEndUs - gxTx.ulStartUs) / 1000;
+    const VcanBusStats &xStats = xBus.xStats();
+    printf("%-22s %8u %7.1f %7.1f %7u %7u %7u %8llu %5d %5d %5d %6s\n", xScenario.pcName, ulMs,
+           ulMs != 0 ? (double)image.size() / ulMs : 0.0,
+           gullNowNs != 0 ? 100.0 * xStats.ullBusyNs / gullNowNs : 0.0, gxTx.bRound,
+           gxTx.ulDataFrames, gxTx.ulBlocksResent, (unsigned long long)ullOverflow,
+           __builtin_popcount(gxTx.ulDone), __builtin_popcount(gxTx.ulRefused),
+           __builtin_popcount(ulNoReply), bPass ? "ok" : "NG");
+    if (!bPass)
+    {
+        printf("%-22s state=%u done=0x%08x expect=0x%08x verified=0x%08x refused=0x%08x "
+               "noReply=0x%08x\n",
+               "", gxTx.bState, gxTx.ulDone, ulExpect, ulVerified, gxTx.ulRefused, ulNoReply);
+    }
+    vVcanSetDefaultBus(nullptr);
+    return bPass;
+}
+
+static void prvPost(uint64_t ullNs, std::function<void()> fn)
+{
+    gxEvents.push({ullNs, gullEventSeq++, fn});
+}
+
+/* バスは各イベントの前にvAdvance()するので、時刻に起こすだけでよい */
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs)
+{
+    (void)pvCtx;
+    prvPost(ullAtNs, [] {});
+}
+
+/*****************************************************************************/
+/**
+ * Master: TXキューに空きがある間、次のフレームを入れる(CAN_fwタスク相当)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     送るものが無ければulTbFwTxWaitUs後にまた呼ぶ
+ *           (応答を受けたとき、TXキューが空いたときはすぐ)
+ *
+ ******************************************************************************/
+static void prvMasterFill()
+{
+    uint32_t ulCanId;
+    can_message_t xMsg = {};
+
+    if (gullFillNs > gullNowNs)
+        return; // 置き直した
+    gullFillNs = UINT64_MAX;
+    while (gpxMaster->ulTxWaiting() < BENCH_TX_QUEUE_LEN && !bTbFwTxFinished(&gxTx))
+    {
+        xMsg.data_length_code = bTbFwTxPoll(&gxTx, (uint32_t)(gullNowNs / BENCH_NS_PER_US),
+                                            &ulCanId, xMsg.data);
+        if (xMsg.data_length_code == 0)
+        {
+            uint32_t ulWaitUs = ulTbFwTxWaitUs(&gxTx, (uint32_t)(gullNowNs / BENCH_NS_PER_US));
+            if (ulWaitUs != UINT32_MAX)
+                prvMasterPost(gullNowNs + (uint64_t)ulWaitUs * BENCH_NS_PER_US);
+            return;
+        }
+        xMsg.identifier = ulCanId;
+        gpxMaster->bTransmit(&xMsg, gullNowNs);
+    }
+}
+
+/* Master: prvMasterFillを置く(早い方だけ残す) */
+static void prvMasterPost(uint64_t ullNs)
+{
+    if (ullNs >= gullFillNs)
+        return;
+    gullFillNs = ullNs;
+    prvPost(ullNs, prvMasterFill);
+}
+
+/* Master: CAN_rxタスク相当(応答をすぐに渡す)、TXキューの空きもここで拾う */
+static void prvMasterDrain()
+{
+    can_message_t xMsg;
+
+    while (gpxMaster->bReceive(&xMsg, NULL))
+    {
+        if (TBCAN_ID_IS_FW_REPLY(xMsg.identifier))
+        {
+            vTbFwTxReply(&gxTx, xMsg.identifier, xMsg.data, xMsg.data_length_code);
+            prvMasterPost(gullNowNs);
+        }
+    }
+    if (gpxMaster->ulTxWaiting() < BENCH_TX_QUEUE_LEN && gullFillNs == UINT64_MAX)
+        prvMasterPost(gullNowNs);
+}
+
+/*****************************************************************************/
+/**
+ * Panel: ブートローダのCANの設定(tb_canfw.h)
+ *
+ * @param    pxPanel: Panel
+ * @param    bId: PanelID
+ *
+ * @return   ##
+ *
+ * @note     ブートローダの無いPanelはPanel_v2と同じ設定(データフレームは受けない)
+ *
+ ******************************************************************************/
+static void prvPanelInit(BenchPanel *pxPanel, uint8_t bId)
+{
+    uint32_t ulRow = (bId - 1) / TBCAN_GRID_SIZE;
+    uint32_t ulCol = (bId - 1) % TBCAN_GRID_SIZE;
+    uint32_t ulGroupMask = TBCAN_ID_GROUP_FLAG | (1UL << (TBCAN_ID_GROUP_ROW_SHIFT + ulRow)) |
+                           (1UL << ulCol);
+
+    pxPanel->bId = bId;
+    pxPanel->bNoBoot = (gpxScenario->ulNoBoot & (1UL << bId)) != 0;
+    pxPanel->flash.assign(BENCH_FLASH_MAX, 0xFF);
+    pxPanel->xIo.bWrite = prvFlashWrite;
+    pxPanel->xIo.vRead = prvFlashRead;
+    pxPanel->xIo.pvCtx = pxPanel;
+    vTbFwRxInit(&pxPanel->xRx, BENCH_FLASH_MAX);
+
+    pxPanel->xCan.begin(CAN_500KBPS, MCP_8MHz);
+    if (pxPanel->bNoBoot)
+    {
+        pxPanel->xCan.init_Mask(0, 0, ulGroupMask);
+        pxPanel->xCan.init_Filt(0, 0, TBCAN_ID_GROUP_FLAG);
+        pxPanel->xCan.init_Filt(1, 0, TBCAN_ID_GROUP_FLAG);
+        pxPanel->xCan.init_Mask(1, 0, TBCAN_ID_STD_MASK);
+        for (int i = 2; i < 6; i++)
+            pxPanel->xCan.init_Filt(i, 0, bId);
+    }
+    else
+    {
+        pxPanel->xCan.init_Mask(0, 0, TBCAN_ID_STD_MASK);
+        pxPanel->xCan.init_Filt(0, 0, TBCAN_ID_FW_DATA);
+        pxPanel->xCan.init_Filt(1, 0, bId);
+        pxPanel->xCan.init_Mask(1, 0, ulGroupMask);
+        for (int i = 2; i < 6; i++)
+            pxPanel->xCan.init_Filt(i, 0, TBCAN_ID_GROUP_FLAG);
+    }
+    pxPanel->xCan.xModel().vSetInt(prvPanelInt, pxPanel);
+}
+
+/* INT(H->L): ループが次に回ってきたときに読む */
+static void prvPanelInt(void *pvCtx, uint64_t ullNs)
+{
+    BenchPanel *pxPanel = (BenchPanel *)pvCtx;
+    if (pxPanel->bPolling)
+        return;
+    pxPanel->bPolling = true;
+    prvPost(ullNs > pxPanel->ullBusyNs ? ullNs : pxPanel->ullBusyNs,
+            [pxPanel] { prvPanelPoll(pxPanel); });
+}
+
+/*****************************************************************************/
+/**
+ * Panel: 1フレーム読み出して処理する
+ *
+ * @param    pxPanel: Panel
+ *
+ * @return   ##
+ *
+ * @note     書き込み・CRCの確認・応答の枠待ちの間は読まない(受信バッファに溜まる)
+ *
+ ******************************************************************************/
+static void prvPanelPoll(BenchPanel *pxPanel)
+{
+    uint8_t bLen = 0;
+    uint8_t bBuf[CAN_MAX_DATA_LEN];
+    uint8_t bReplies;
+    uint32_t ulCanId;
+    uint32_t ulWrites = pxPanel->ulWrites;
+    uint64_t ullReplyNs;
+
+    pxPanel->bPolling = false;
+    if (pxPanel->xCan.checkReceive() != CAN_MSGAVAIL)
+        return;
+    pxPanel->xCan.readMsgBuf(&bLen, bBuf);
+    ulCanId = pxPanel->xCan.getCanId();
+    pxPanel->ullBusyNs = gullNowNs + (uint64_t)gxOpt.ulPanelUs * BENCH_NS_PER_US;
+
+    if (pxPanel->bNoBoot)
+    {
+        // Panel_v2: BEGINにNO_BOOTを返す
+        if (bTbCanDecodeCtrl(bBuf, bLen) == TBCAN_CMD_FW_BEGIN)
+        {
+            can_message_t xMsg = {};
+            xMsg.identifier = TBCAN_ID_FW_REPLY_BASE + pxPanel->bId;
+            xMsg.data_length_code = bTbFwEncodeReply(pxPanel->bId, TBFW_ST_NO_BOOT, bBuf[6],
+                                                     TBFW_REPLY_LAST, 0, xMsg.data);
+            pxPanel->replies.push_back(xMsg);
+            pxPanel->ullBusyNs += (uint64_t)(pxPanel->bId - 1) * TBFW_REPLY_SLOT_MS * BENCH_NS_PER_MS;
+        }
+    }
+    else if (gpxScenario->dDrop > 0.0 && prvRand() < gpxScenario->dDrop)
+    {
+        pxPanel->ulDropped++;
+    }
+    else
+    {
+        bReplies = bTbFwRxFrame(&pxPanel->xRx, &pxPanel->xIo, ulCanId, bBuf, bLen);
+        if (pxPanel->ulWrites != ulWrites)
+            pxPanel->ullBusyNs += (uint64_t)gxOpt.ulWriteUs * BENCH_NS_PER_US +
+                                  (uint64_t)(prvRand() * gpxScenario->ulWriteJitterUs) * BENCH_NS_PER_US;
+        if (bReplies > 0)
+        {
+            // ENDで確かめたときはCRCの時間(読み返したバイト数)、その後PanelIDの枠まで待つ
+            if (bTbCanDecodeCtrl(bBuf, bLen) == TBCAN_CMD_FW_END &&
+                pxPanel->xRx.bStatus != TBFW_ST_MISSING)
+                pxPanel->ullBusyNs += (uint64_t)pxPanel->xRx.usSize * TBFW_VERIFY_MS *
+                                      BENCH_NS_PER_MS / TBFW_IMAGE_MAX;
+            pxPanel->ullBusyNs += (uint64_t)(pxPanel->bId - 1) * TBFW_REPLY_SLOT_MS * BENCH_NS_PER_MS;
+            for (uint8_t i = 0; i < bReplies; i++)
+            {
+                can_message_t xMsg = {};
+                xMsg.identifier = TBCAN_ID_FW_REPLY_BASE + pxPanel->bId;
+                xMsg.data_length_code = bTbFwRxReply(&pxPanel->xRx, pxPanel->bId, i, xMsg.data);
+                pxPanel->replies.push_back(xMsg);
+            }
+            if (pxPanel->xRx.bStatus == TBFW_ST_DONE)
+                pxPanel->bBooted = true;
+        }
+    }
+
+    if (!pxPanel->replies.empty() && !pxPanel->bReplyPosted)
+    {
+        pxPanel->bReplyPosted = true;
+        ullReplyNs = pxPanel->ullBusyNs;
+        prvPost(ullReplyNs, [pxPanel] { prvPanelReply(pxPanel); });
+    }
+    if (pxPanel->xCan.checkReceive() == CAN_MSGAVAIL)
+    {
+        pxPanel->bPolling = true;
+        prvPost(pxPanel->ullBusyNs, [pxPanel] { prvPanelPoll(pxPanel); });
+    }
+}
+
+/* Panel: 応答をTXBへ入れる(空いていなければ少し後に) */
+static void prvPanelReply(BenchPanel *pxPanel)
+{
+    pxPanel->bReplyPosted = false;
+    while (!pxPanel->replies.empty())
+    {
+        const can_message_t &xMsg = pxPanel->replies.front();
+        if (pxPanel->xCan.sendMsgBuf(xMsg.identifier, 0, xMsg.data_length_code, xMsg.data) !=
+            CAN_OK)
+        {
+            pxPanel->bReplyPosted = true;
+            prvPost(gullNowNs + BENCH_REPLY_RETRY_US * BENCH_NS_PER_US,
+                    [pxPanel] { prvPanelReply(pxPanel); });
+            return;
+        }
+        pxPanel->replies.pop_front();
+    }
+}
+
+/* Panel: フラッシュの1ページ */
+static uint8_t prvFlashWrite(void *pvCtx, uint8_t bBlock, const uint8_t *pbPage)
+{
+    BenchPanel *pxPanel = (BenchPanel *)pvCtx;
+    uint32_t ulOff = (uint32_t)bBlock * TBFW_BLOCK_SIZE;
+
+    if (ulOff + TBFW_BLOCK_SIZE > pxPanel->flash.size())
+        return 0;
+    memcpy(&pxPanel->flash[ulOff], pbPage, TBFW_BLOCK_SIZE);
+    pxPanel->ulWrites++;
+    return 1;
+}
+
+static void prvFlashRead(void *pvCtx, uint16_t usOffset, uint8_t *pbData, uint8_t bLen)
+{
+    BenchPanel *pxPanel = (BenchPanel *)pvCtx;
+    memcpy(pbData, &pxPanel->flash[usOffset], bLen);
+}
+
+/* xorshift64* */
+static double prvRand()
+{
+    gullRand ^= gullRand >> 12;
+    gullRand ^= gullRand << 25;
+    gullRand ^= gullRand >> 27;
+    return (double)((gullRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,252 @@
+/*****************************************************************************/
+/**
+ * @file bench_ring.cpp
+ * @comments util_ring(SPSCリング) と Queue相当の比較ベンチマーク
+ *
+ *           Queue側はFreeRTOSのxQueueSend/xQueueReceiveと同じく、
+ *           要素のコピーをクリティカルセクション(スピンロック)内で行う。
+ *           ホストの実時間で測るので、値はESP32と比べるためではなく
+ *           リングとQueueの相対比較に使う。
+ *
+ *   make bench && ./build/bench_ring [回数]
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "def_system.h"
+#include "util_ring.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define BENCH_DEFAULT_ITEMS 2000000UL
+#define BENCH_BURST 8 // 1スレッド時に続けて送信する数
+#define BENCH_DEPTH 32
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* FreeRTOS Queue相当(コピーをクリティカルセクション内で行う) */
+struct CsQueue
+{
+    std::atomic_flag xLock = ATOMIC_FLAG_INIT;
+    uint8_t bBuf[BENCH_DEPTH][sizeof(canCommMsg_t)];
+    uint32_t ulHead = 0;
+    uint32_t ulCount = 0;
+
+    bool bSend(const canCommMsg_t *pxItem)
+    {
+        bool bOk = false;
+        while (xLock.test_and_set(std::memory_order_acquire))
+        {
+        }
+        if (ulCount < BENCH_DEPTH)
+        {
+            memcpy(bBuf[(ulHead + ulCount) % BENCH_DEPTH], pxItem, sizeof(*pxItem));
+            ulCount++;
+            bOk = true;
+        }
+        xLock.clear(std::memory_order_release);
+        return bOk;
+    }
+    bool bReceive(canCommMsg_t *pxItem)
+    {
+        bool bOk = false;
+        while (xLock.test_and_set(std::memory_order_acquire))
+        {
+        }
+        if (ulCount > 0)
+        {
+            memcpy(pxItem, bBuf[ulHead], sizeof(*pxItem));
+            ulHead = (ulHead + 1) % BENCH_DEPTH;
+            ulCount--;
+            bOk = true;
+        }
+        xLock.clear(std::memory_order_release);
+        return bOk;
+    }
+};
+
+/* リング(比較対象と同じ深さ、BLOCK) */
+struct RingAdapter
+{
+    SpscRing<canCommMsg_t, BENCH_DEPTH> xRing;
+
+    RingAdapter() { xRing.vInit(RING_POLICY_BLOCK, "bench"); }
+    bool bSend(const canCommMsg_t *pxItem)
+    {
+        return xRingTrySend(xRing.pxHandle(), pxItem) == pdPASS;
+    }
+    bool bReceive(canCommMsg_t *pxItem)
+    {
+        return xRingTryReceive(xRing.pxHandle(), pxItem) == pdPASS;
+    }
+};
+
+template <typename Q>
+struct BenchArg
+{
+    Q *pxQueue;
+    uint32_t ulItems;
+    uint64_t ullSum;
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static double prvNowNs(void)
+{
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return xTs.tv_sec * 1e9 + xTs.tv_nsec;
+}
+
+template <typename Q>
+static void *prvProducer(void *pvArg)
+{
+    BenchArg<Q> *pxArg = (BenchArg<Q> *)pvArg;
+    canCommMsg_t xMsg = {};
+
+    for (uint32_t i = 0; i < pxArg->ulItems; i++)
+    {
+        xMsg.ulCanId = i;
+        while (!pxArg->pxQueue->bSend(&xMsg))
+            sched_yield();
+    }
+    return NULL;
+}
+
+template <typename Q>
+static void *prvConsumer(void *pvArg)
+{
+    BenchArg<Q> *pxArg = (BenchArg<Q> *)pvArg;
+    canCommMsg_t xMsg;
+
+    for (uint32_t i = 0; i < pxArg->ulItems; i++)
+    {
+        while (!pxArg->pxQueue->bReceive(&xMsg))
+            sched_yield();
+        if (xMsg.ulCanId != i)
+        {
+            fprintf(stderr, "bench: order error %u != %u\n", xMsg.ulCanId, i);
+            exit(1);
+        }
+        pxArg->ullSum += xMsg.ulCanId;
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+/**
+ * 1スレッド: BENCH_BURST個送信してから同数受信を繰り返す
+ * (競合なしの1要素あたりのコスト)
+ *
+ ******************************************************************************/
+template <typename Q>
+static double prvBenchSingle(uint32_t ulItems)
+{
+    static Q xQueue;
+    Q *pxQueue = &xQueue;
+    canCommMsg_t xMsg = {};
+    double dStart = prvNowNs();
+
+    for (uint32_t i = 0; i < ulItems; i += BENCH_BURST)
+    {
+        for (uint32_t j = 0; j < BENCH_BURST; j++)
+        {
+            xMsg.ulCanId = i + j;
+            pxQueue->bSend(&xMsg);
+        }
+        for (uint32_t j = 0; j < BENCH_BURST; j++)
+            pxQueue->bReceive(&xMsg);
+    }
+    return (prvNowNs() - dStart) / ulItems;
+}
+
+/*****************************************************************************/
+/**
+ * 2スレッド: Producer/Consumer を別スレッドで(空き/満杯はyieldで待つ)
+ *
+ ******************************************************************************/
+template <typename Q>
+static double prvBenchPair(uint32_t ulItems)
+{
+    static Q xQueue;
+    Q *pxQueue = &xQueue;
+    BenchArg<Q> xArg = {pxQueue, ulItems, 0};
+    pthread_t xProd, xCons;
+    double dStart = prvNowNs();
+
+    pthread_create(&xCons, NULL, prvConsumer<Q>, &xArg);
+    pthread_create(&xProd, NULL, prvProducer<Q>, &xArg);
+    pthread_join(xProd, NULL);
+    pthread_join(xCons, NULL);
+
+    return (prvNowNs() - dStart) / ulItems;
+}
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+int main(int argc, char **argv)
+{
+    uint32_t ulItems = BENCH_DEFAULT_ITEMS;
+
+    if (argc > 1)
+        ulItems = (uint32_t)strtoul(argv[1], NULL, 0);
+    ulItems -= ulItems % BENCH_BURST;
+
+    printf("items=%u depth=%d item=%zuB\n", ulItems, BENCH_DEPTH,
+           sizeof(canCommMsg_t));
+    printf("%-24s %12s %12s\n", "", "queue[ns]", "ring[ns]");
+    printf("%-24s %12.1f %12.1f\n", "single thread (burst)",
+           prvBenchSingle<CsQueue>(ulItems), prvBenchSingle<RingAdapter>(ulItems));
+    printf("%-24s %12.1f %12.1f\n", "producer/consumer",
+           prvBenchPair<CsQueue>(ulItems), prvBenchPair<RingAdapter>(ulItems));
+    return 0;
+}
+
+/*****************************************************************************/
+/* FreeRTOS Stub
+ * ベンチマークはTry系のみ使うため、待ち合わせ関数は呼ばれない。
+******************************************************************************/
+extern "C" {
+void vSimAssertFailed(const char *pcFile, int iLine, const char *pcExpr)
+{
+    fprintf(stderr, "bench: assert failed (%s) at %s:%d\n", pcExpr, pcFile, iLine);
+    abort();
+}
+TickType_t xTaskGetTickCount(void) { return 0; }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    abort();
+}
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue,
+                              eNotifyAction eAction,
+                              uint32_t *pulPreviousNotificationValue)
+{
+    abort();
+}
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/**
+ * @file Arduino.h
+ * @comments Virtual Arena用 Arduino-ESP32互換ヘッダ
+ *           random()はシード固定の擬似乱数で、実行毎に同じ系列になります。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_system.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x02
+
+typedef uint8_t byte;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void initArduino(void);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void delay(uint32_t ms);
+unsigned long millis(void);
+unsigned long micros(void);
+
+#ifdef __cplusplus
+}
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class Stream
+{
+  public:
+    virtual ~Stream() {}
+};
+
+class HardwareSerial : public Stream
+{
+  public:
+    explicit HardwareSerial(int uart_nr) : _uart_nr(uart_nr), _baud(0) {}
+    void begin(unsigned long baud) { _baud = baud; }
+    unsigned long baudRate() const { return _baud; }
+
+  private:
+    int _uart_nr;
+    unsigned long _baud;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+#endif
+
+#endif
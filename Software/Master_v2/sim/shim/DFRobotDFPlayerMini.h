@@ -0,0 +1,34 @@
+/*****************************************************************************/
+/**
+ * @file DFRobotDFPlayerMini.h
+ * @comments Virtual Arena用 DFPlayer Mini互換クラス
+ *           コマンド1回分のUART送信時間(10byte @ 9600bps)だけ呼出元を
+ *           ブロックし、再生要求を仮想アリーナへ通知します。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_DFROBOTDFPLAYERMINI_H
+#define SIM_DFROBOTDFPLAYERMINI_H
+
+#include "Arduino.h"
+
+class DFRobotDFPlayerMini
+{
+  public:
+    /* 実機と同様にESP_ERROR_CHECK()へ渡されるため、
+     * ACK無し起動時の戻り値(false = ESP_OK)を返す */
+    bool begin(Stream &stream, bool isACK = true, bool doReset = true);
+    void volume(uint8_t volume);
+    void play(int fileNumber = 1);
+
+  private:
+    void sendStack();
+    uint8_t _volume = 0;
+};
+
+#endif
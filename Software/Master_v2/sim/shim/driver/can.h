@@ -0,0 +1,164 @@
+/*****************************************************************************/
+/**
+ * @file can.h
+ * @comments Virtual Arena用 ESP-IDF v3.3 CAN(TWAI)ドライバ互換ヘッダ
+ *           送受信は仮想CANバス(sim_can.cpp)へ接続されます。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_DRIVER_CAN_H
+#define SIM_DRIVER_CAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define CAN_MAX_DATA_LEN 8
+#define CAN_STD_ID_MASK 0x7FF
+#define CAN_EXTD_ID_MASK 0x1FFFFFFF
+#define CAN_IO_UNUSED ((gpio_num_t)-1)
+
+#define CAN_MSG_FLAG_NONE 0x00
+#define CAN_MSG_FLAG_EXTD 0x01
+#define CAN_MSG_FLAG_RTR 0x02
+#define CAN_MSG_FLAG_SS 0x04
+#define CAN_MSG_FLAG_SELF 0x08
+
+#define CAN_ALERT_TX_IDLE 0x0001
+#define CAN_ALERT_TX_SUCCESS 0x0002
+#define CAN_ALERT_BELOW_ERR_WARN 0x0004
+#define CAN_ALERT_ERR_ACTIVE 0x0008
+#define CAN_ALERT_RECOVERY_IN_PROGRESS 0x0010
+#define CAN_ALERT_BUS_RECOVERED 0x0020
+#define CAN_ALERT_ARB_LOST 0x0040
+#define CAN_ALERT_ABOVE_ERR_WARN 0x0080
+#define CAN_ALERT_BUS_ERROR 0x0100
+#define CAN_ALERT_TX_FAILED 0x0200
+#define CAN_ALERT_RX_QUEUE_FULL 0x0400
+#define CAN_ALERT_ERR_PASS 0x0800
+#define CAN_ALERT_BUS_OFF 0x1000
+#define CAN_ALERT_ALL 0x1FFF
+#define CAN_ALERT_NONE 0x0000
+
+#define CAN_TIMING_CONFIG_500KBITS()                                           \
+    {                                                                          \
+        .brp = 8, .tseg_1 = 15, .tseg_2 = 4, .sjw = 3, .triple_sampling = false \
+    }
+#define CAN_FILTER_CONFIG_ACCEPT_ALL()                                         \
+    {                                                                          \
+        .acceptance_code = 0, .acceptance_mask = 0xFFFFFFFF,                   \
+        .single_filter = true                                                  \
+    }
+#define CAN_GENERAL_CONFIG_DEFAULT(tx_io_num, rx_io_num, op_mode)              \
+    {                                                                          \
+        .mode = op_mode, .tx_io = tx_io_num, .rx_io = rx_io_num,               \
+        .clkout_io = CAN_IO_UNUSED, .bus_off_io = CAN_IO_UNUSED,               \
+        .tx_queue_len = 5, .rx_queue_len = 5,                                  \
+        .alerts_enabled = CAN_ALERT_NONE, .clkout_divider = 0,                 \
+    }
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef enum
+{
+    CAN_MODE_NORMAL,
+    CAN_MODE_NO_ACK,
+    CAN_MODE_LISTEN_ONLY,
+} can_mode_t;
+
+typedef enum
+{
+    CAN_STATE_STOPPED,
+    CAN_STATE_RUNNING,
+    CAN_STATE_BUS_OFF,
+    CAN_STATE_RECOVERING,
+} can_state_t;
+
+typedef struct
+{
+    can_mode_t mode;
+    gpio_num_t tx_io;
+    gpio_num_t rx_io;
+    gpio_num_t clkout_io;
+    gpio_num_t bus_off_io;
+    uint32_t tx_queue_len;
+    uint32_t rx_queue_len;
+    uint32_t alerts_enabled;
+    uint32_t clkout_divider;
+} can_general_config_t;
+
+typedef struct
+{
+    uint8_t brp;
+    uint8_t tseg_1;
+    uint8_t tseg_2;
+    uint8_t sjw;
+    bool triple_sampling;
+} can_timing_config_t;
+
+typedef struct
+{
+    uint32_t acceptance_code;
+    uint32_t acceptance_mask;
+    bool single_filter;
+} can_filter_config_t;
+
+typedef struct
+{
+    can_state_t state;
+    uint32_t msgs_to_tx;
+    uint32_t msgs_to_rx;
+    uint32_t tx_error_counter;
+    uint32_t rx_error_counter;
+    uint32_t tx_failed_count;
+    uint32_t rx_missed_count;
+    uint32_t arb_lost_count;
+    uint32_t bus_error_count;
+} can_status_info_t;
+
+typedef struct
+{
+    uint32_t flags;
+    uint32_t identifier;
+    uint8_t data_length_code;
+    uint8_t data[CAN_MAX_DATA_LEN];
+} can_message_t;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+esp_err_t can_driver_install(const can_general_config_t *g_config,
+                             const can_timing_config_t *t_config,
+                             const can_filter_config_t *f_config);
+esp_err_t can_driver_uninstall(void);
+esp_err_t can_start(void);
+esp_err_t can_stop(void);
+esp_err_t can_transmit(const can_message_t *message, TickType_t ticks_to_wait);
+esp_err_t can_receive(can_message_t *message, TickType_t ticks_to_wait);
+esp_err_t can_initiate_recovery(void);
+esp_err_t can_get_status_info(can_status_info_t *status_info);
+esp_err_t can_clear_transmit_queue(void);
+esp_err_t can_clear_receive_queue(void);
+esp_err_t can_read_alerts(uint32_t *alerts, TickType_t ticks_to_wait);
+esp_err_t can_reconfigure_alerts(uint32_t alerts_enabled, uint32_t *current_alerts);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,25 @@
+/*****************************************************************************/
+/**
+ * @file esp_bit_defs.h
+ * @comments Virtual Arena用 BITn定義
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_BIT_DEFS_H
+#define SIM_ESP_BIT_DEFS_H
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define BIT4 0x00000010
+#define BIT5 0x00000020
+#define BIT6 0x00000040
+#define BIT7 0x00000080
+
+#endif
@@ -0,0 +1,57 @@
+/*****************************************************************************/
+/**
+ * @file esp_err.h
+ * @comments Virtual Arena用 esp_err互換ヘッダ
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_ERR_H
+#define SIM_ESP_ERR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+
+const char *esp_err_to_name(esp_err_t code);
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line,
+                             const char *function, const char *expression);
+
+/* 実機(CONFIG_OPTIMIZATION_ASSERTIONS_ENABLED)と同じくabortする */
+#define ESP_ERROR_CHECK(x)                                                     \
+    do                                                                         \
+    {                                                                          \
+        esp_err_t __err_rc = (x);                                              \
+        if (__err_rc != ESP_OK)                                                \
+        {                                                                      \
+            _esp_error_check_failed(__err_rc, __FILE__, __LINE__,              \
+                                    __ASSERT_FUNC, #x);                        \
+        }                                                                      \
+    } while (0)
+
+#ifndef __ASSERT_FUNC
+#define __ASSERT_FUNC __func__
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
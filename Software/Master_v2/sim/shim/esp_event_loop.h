@@ -0,0 +1,61 @@
+/*****************************************************************************/
+/**
+ * @file esp_event_loop.h
+ * @comments Virtual Arena用 legacy event loop互換ヘッダ
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_EVENT_LOOP_H
+#define SIM_ESP_EVENT_LOOP_H
+
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "tcpip_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    SYSTEM_EVENT_WIFI_READY = 0,
+    SYSTEM_EVENT_SCAN_DONE,
+    SYSTEM_EVENT_STA_START,
+    SYSTEM_EVENT_STA_STOP,
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+    SYSTEM_EVENT_STA_GOT_IP,
+    SYSTEM_EVENT_STA_LOST_IP,
+    SYSTEM_EVENT_AP_STA_GOT_IP6 = 19,
+    SYSTEM_EVENT_MAX
+} system_event_id_t;
+
+typedef struct
+{
+    tcpip_adapter_ip6_info_t ip6_info;
+} system_event_got_ip6_t;
+
+typedef union {
+    system_event_got_ip6_t got_ip6;
+} system_event_info_t;
+
+typedef struct
+{
+    system_event_id_t event_id;
+    system_event_info_t event_info;
+} system_event_t;
+
+typedef esp_err_t (*system_event_cb_t)(void *ctx, system_event_t *event);
+
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
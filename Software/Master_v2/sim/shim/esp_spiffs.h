@@ -0,0 +1,39 @@
+/*****************************************************************************/
+/**
+ * @file esp_spiffs.h
+ * @comments Virtual Arena用 esp_spiffs互換ヘッダ
+ *           マウントは成功したことにする(パスはホストのファイルとして開く)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_SPIFFS_H
+#define SIM_ESP_SPIFFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    const char *base_path;
+    const char *partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,16 @@
+/*****************************************************************************/
+/**
+ * @file esp_tls.h
+ * @comments Virtual Arena用 空ヘッダ (インクルード互換のみ)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_TLS_H
+#define SIM_ESP_TLS_H
+
+#endif
@@ -0,0 +1,75 @@
+/*****************************************************************************/
+/**
+ * @file esp_wifi.h
+ * @comments Virtual Arena用 esp_wifi互換ヘッダ
+ *           接続処理は即座に成功し、GOT_IPイベントを発行します。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_ESP_WIFI_H
+#define SIM_ESP_WIFI_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "tcpip_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+typedef enum
+{
+    ESP_IF_WIFI_STA = 0,
+    ESP_IF_WIFI_AP,
+} esp_interface_t;
+
+typedef enum
+{
+    WIFI_STORAGE_FLASH,
+    WIFI_STORAGE_RAM,
+} wifi_storage_t;
+
+typedef struct
+{
+    int magic;
+} wifi_init_config_t;
+#define WIFI_INIT_CONFIG_DEFAULT()                                             \
+    {                                                                          \
+        .magic = 0x1F2F3F4F                                                    \
+    }
+
+typedef struct
+{
+    uint8_t ssid[32];
+    uint8_t password[64];
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_connect(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,93 @@
+/*****************************************************************************/
+/**
+ * @file FreeRTOS.h
+ * @comments Virtual Arena用 FreeRTOS互換ヘッダ
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_bit_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* sdkconfig相当 (CONFIG_FREERTOS_HZ = 1000) */
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define configTIMER_TASK_PRIORITY 1
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+
+#define pdMS_TO_TICKS(xTimeInMs)                                               \
+    ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / \
+                  (TickType_t)1000))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+/* シミュレータは単一スレッド実行なのでクリティカルセクションは不要 */
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portYIELD_FROM_ISR() ((void)0)
+
+#define configASSERT(x)                                                        \
+    do                                                                         \
+    {                                                                          \
+        if (!(x))                                                              \
+            vSimAssertFailed(__FILE__, __LINE__, #x);                          \
+    } while (0)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+
+typedef struct SimTask *TaskHandle_t;
+typedef struct SimQueue *QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef struct SimTimer *TimerHandle_t;
+typedef struct SimEventGroup *EventGroupHandle_t;
+
+typedef void (*TaskFunction_t)(void *);
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vSimAssertFailed(const char *pcFile, int iLine, const char *pcExpr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/**
+ * @file queue.h
+ * @comments Virtual Arena用 FreeRTOS queue API
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FREERTOS_QUEUE_H
+#define SIM_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define queueSEND_TO_BACK ((BaseType_t)0)
+#define queueSEND_TO_FRONT ((BaseType_t)1)
+#define queueOVERWRITE ((BaseType_t)2)
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+void vQueueDelete(QueueHandle_t xQueue);
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue,
+                             const void *const pvItemToQueue,
+                             TickType_t xTicksToWait,
+                             const BaseType_t xCopyPosition);
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue,
+                                    const void *const pvItemToQueue,
+                                    BaseType_t *const pxHigherPriorityTaskWoken,
+                                    const BaseType_t xCopyPosition);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *const pvBuffer,
+                         TickType_t xTicksToWait);
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *const pvBuffer,
+                      TickType_t xTicksToWait);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void *const pvBuffer,
+                                BaseType_t *const pxHigherPriorityTaskWoken);
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue);
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue);
+void vQueueAddToRegistry(QueueHandle_t xQueue, const char *pcQueueName);
+
+#define xQueueSend(xQueue, pvItemToQueue, xTicksToWait)                        \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_BACK)
+#define xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait)                  \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_BACK)
+#define xQueueSendToFront(xQueue, pvItemToQueue, xTicksToWait)                 \
+    xQueueGenericSend((xQueue), (pvItemToQueue), (xTicksToWait),               \
+                      queueSEND_TO_FRONT)
+#define xQueueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken)    \
+    xQueueGenericSendFromISR((xQueue), (pvItemToQueue),                        \
+                             (pxHigherPriorityTaskWoken), queueSEND_TO_BACK)
+#define xQueueSendToBackFromISR(xQueue, pvItemToQueue, pxWoken)                \
+    xQueueGenericSendFromISR((xQueue), (pvItemToQueue), (pxWoken),             \
+                             queueSEND_TO_BACK)
+#define xQueueReset(xQueue) xQueueGenericReset((xQueue), pdFALSE)
+
+#ifdef __cplusplus
+}
+#endif
+#endif
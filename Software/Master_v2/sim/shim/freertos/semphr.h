@@ -0,0 +1,38 @@
+/*****************************************************************************/
+/**
+ * @file semphr.h
+ * @comments Virtual Arena用 FreeRTOS semaphore API
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FREERTOS_SEMPHR_H
+#define SIM_FREERTOS_SEMPHR_H
+
+#include "freertos/queue.h"
+
+/* セマフォは長さ1 / 要素サイズ0のQueueとして扱う */
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)
+#define xSemaphoreTake(xSemaphore, xBlockTime)                                 \
+    xQueueReceive((xSemaphore), NULL, (xBlockTime))
+#define xSemaphoreGive(xSemaphore)                                             \
+    xQueueGenericSend((xSemaphore), NULL, 0, queueSEND_TO_BACK)
+#define xSemaphoreGiveFromISR(xSemaphore, pxWoken)                             \
+    xQueueGenericSendFromISR((xSemaphore), NULL, (pxWoken), queueSEND_TO_BACK)
+#define vSemaphoreDelete(xSemaphore) vQueueDelete(xSemaphore)
+
+/* ミューテックスは取れる状態で作るバイナリセマフォ(優先度継承はしない) */
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t xSemaphore = xQueueCreate(1, 0);
+
+    if (xSemaphore != NULL)
+        xSemaphoreGive(xSemaphore);
+    return xSemaphore;
+}
+
+#endif
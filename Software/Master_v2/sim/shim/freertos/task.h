@@ -0,0 +1,87 @@
+/*****************************************************************************/
+/**
+ * @file task.h
+ * @comments Virtual Arena用 FreeRTOS task API
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode,
+                                   const char *const pcName,
+                                   const uint32_t usStackDepth,
+                                   void *const pvParameters,
+                                   UBaseType_t uxPriority,
+                                   TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID);
+#define xTaskCreate(pvTaskCode, pcName, usStackDepth, pvParameters,            \
+                    uxPriority, pxCreatedTask)                                 \
+    xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters,    \
+                            uxPriority, pxCreatedTask, tskNO_AFFINITY)
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(const TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t *const pxPreviousWakeTime,
+                     const TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+void vTaskYield(void);
+#define taskYIELD() vTaskYield()
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit,
+                          TickType_t xTicksToWait);
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry,
+                           uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue,
+                           TickType_t xTicksToWait);
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue,
+                              eNotifyAction eAction,
+                              uint32_t *pulPreviousNotificationValue);
+BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t xTaskToNotify,
+                                     uint32_t ulValue, eNotifyAction eAction,
+                                     uint32_t *pulPreviousNotificationValue,
+                                     BaseType_t *pxHigherPriorityTaskWoken);
+#define xTaskNotify(xTaskToNotify, ulValue, eAction)                           \
+    xTaskGenericNotify((xTaskToNotify), (ulValue), (eAction), NULL)
+#define xTaskNotifyGive(xTaskToNotify)                                         \
+    xTaskGenericNotify((xTaskToNotify), 0, eIncrement, NULL)
+#define xTaskNotifyFromISR(xTaskToNotify, ulValue, eAction, pxWoken)           \
+    xTaskGenericNotifyFromISR((xTaskToNotify), (ulValue), (eAction), NULL,     \
+                              (pxWoken))
+#define vTaskNotifyGiveFromISR(xTaskToNotify, pxWoken)                         \
+    ((void)xTaskGenericNotifyFromISR((xTaskToNotify), 0, eIncrement, NULL,     \
+                                     (pxWoken)))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,64 @@
+/*****************************************************************************/
+/**
+ * @file timers.h
+ * @comments Virtual Arena用 FreeRTOS software timer API
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FREERTOS_TIMERS_H
+#define SIM_FREERTOS_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define tmrCOMMAND_START 1
+#define tmrCOMMAND_RESET 2
+#define tmrCOMMAND_STOP 3
+#define tmrCOMMAND_CHANGE_PERIOD 4
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+TimerHandle_t xTimerCreate(const char *const pcTimerName,
+                           const TickType_t xTimerPeriodInTicks,
+                           const UBaseType_t uxAutoReload,
+                           void *const pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction);
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer,
+                                const BaseType_t xCommandID,
+                                const TickType_t xOptionalValue,
+                                BaseType_t *const pxHigherPriorityTaskWoken,
+                                const TickType_t xTicksToWait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer);
+void *pvTimerGetTimerID(TimerHandle_t xTimer);
+
+#define xTimerStart(xTimer, xTicksToWait)                                      \
+    xTimerGenericCommand((xTimer), tmrCOMMAND_START, 0, NULL, (xTicksToWait))
+#define xTimerReset(xTimer, xTicksToWait)                                      \
+    xTimerGenericCommand((xTimer), tmrCOMMAND_RESET, 0, NULL, (xTicksToWait))
+#define xTimerStop(xTimer, xTicksToWait)                                       \
+    xTimerGenericCommand((xTimer), tmrCOMMAND_STOP, 0, NULL, (xTicksToWait))
+#define xTimerChangePeriod(xTimer, xNewPeriod, xTicksToWait)                   \
+    xTimerGenericCommand((xTimer), tmrCOMMAND_CHANGE_PERIOD, (xNewPeriod),     \
+                         NULL, (xTicksToWait))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
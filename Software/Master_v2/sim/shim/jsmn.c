@@ -0,0 +1,245 @@
+/*****************************************************************************/
+/**
+ * @file jsmn.c
+ * @comments Virtual Arena用 JSONトークナイザ(jsmn互換API)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include "jsmn.h"
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static jsmntok_t *prvAllocToken(jsmn_parser *parser, jsmntok_t *tokens,
+                                unsigned int num_tokens)
+{
+    jsmntok_t *tok;
+    if (parser->toknext >= num_tokens)
+        return NULL;
+    tok = &tokens[parser->toknext++];
+    tok->start = tok->end = -1;
+    tok->size = 0;
+    tok->type = JSMN_UNDEFINED;
+    return tok;
+}
+
+static void prvFillToken(jsmntok_t *token, jsmntype_t type, int start,
+                         int end)
+{
+    token->type = type;
+    token->start = start;
+    token->end = end;
+    token->size = 0;
+}
+
+static int prvParsePrimitive(jsmn_parser *parser, const char *js, size_t len,
+                             jsmntok_t *tokens, unsigned int num_tokens)
+{
+    jsmntok_t *token;
+    int start = (int)parser->pos;
+
+    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+    {
+        char c = js[parser->pos];
+        if (c == ':' || c == '\t' || c == '\r' || c == '\n' || c == ' ' ||
+            c == ',' || c == ']' || c == '}')
+            break;
+        if (c < 32 || c >= 127)
+        {
+            parser->pos = start;
+            return JSMN_ERROR_INVAL;
+        }
+    }
+
+    if (tokens == NULL)
+    {
+        parser->pos--;
+        return 0;
+    }
+    token = prvAllocToken(parser, tokens, num_tokens);
+    if (token == NULL)
+    {
+        parser->pos = start;
+        return JSMN_ERROR_NOMEM;
+    }
+    prvFillToken(token, JSMN_PRIMITIVE, start, (int)parser->pos);
+    parser->pos--;
+    return 0;
+}
+
+static int prvParseString(jsmn_parser *parser, const char *js, size_t len,
+                          jsmntok_t *tokens, unsigned int num_tokens)
+{
+    jsmntok_t *token;
+    int start = (int)parser->pos;
+
+    parser->pos++; // 開始の'"'を飛ばす
+    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+    {
+        char c = js[parser->pos];
+        if (c == '\"')
+        {
+            if (tokens == NULL)
+                return 0;
+            token = prvAllocToken(parser, tokens, num_tokens);
+            if (token == NULL)
+            {
+                parser->pos = start;
+                return JSMN_ERROR_NOMEM;
+            }
+            prvFillToken(token, JSMN_STRING, start + 1, (int)parser->pos);
+            return 0;
+        }
+        if (c == '\\' && parser->pos + 1 < len)
+        {
+            parser->pos++;
+        }
+    }
+    parser->pos = start;
+    return JSMN_ERROR_PART;
+}
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+void jsmn_init(jsmn_parser *parser)
+{
+    parser->pos = 0;
+    parser->toknext = 0;
+    parser->toksuper = -1;
+}
+
+/*****************************************************************************/
+/**
+ * JSONのトークン分割
+ *
+ * @param    parser / js / len / tokens / num_tokens
+ *
+ * @return   トークン数 / JSMN_ERROR_*
+ *
+ * @note     非strictモードのjsmnと同じトークン列を返す
+ *
+ ******************************************************************************/
+int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
+               jsmntok_t *tokens, unsigned int num_tokens)
+{
+    int r;
+    int i;
+    jsmntok_t *token;
+    int count = (int)parser->toknext;
+
+    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++)
+    {
+        char c = js[parser->pos];
+        jsmntype_t type;
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+            count++;
+            if (tokens == NULL)
+                break;
+            token = prvAllocToken(parser, tokens, num_tokens);
+            if (token == NULL)
+                return JSMN_ERROR_NOMEM;
+            if (parser->toksuper != -1)
+                tokens[parser->toksuper].size++;
+            token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
+            token->start = (int)parser->pos;
+            parser->toksuper = (int)parser->toknext - 1;
+            break;
+        case '}':
+        case ']':
+            if (tokens == NULL)
+                break;
+            type = (c == '}' ? JSMN_OBJECT : JSMN_ARRAY);
+            for (i = (int)parser->toknext - 1; i >= 0; i--)
+            {
+                token = &tokens[i];
+                if (token->start != -1 && token->end == -1)
+                {
+                    if (token->type != type)
+                        return JSMN_ERROR_INVAL;
+                    parser->toksuper = -1;
+                    token->end = (int)parser->pos + 1;
+                    break;
+                }
+            }
+            if (i == -1)
+                return JSMN_ERROR_INVAL;
+            for (; i >= 0; i--)
+            {
+                token = &tokens[i];
+                if (token->start != -1 && token->end == -1)
+                {
+                    parser->toksuper = i;
+                    break;
+                }
+            }
+            break;
+        case '\"':
+            r = prvParseString(parser, js, len, tokens, num_tokens);
+            if (r < 0)
+                return r;
+            count++;
+            if (parser->toksuper != -1 && tokens != NULL)
+                tokens[parser->toksuper].size++;
+            break;
+        case '\t':
+        case '\r':
+        case '\n':
+        case ' ':
+            break;
+        case ':':
+            parser->toksuper = (int)parser->toknext - 1;
+            break;
+        case ',':
+            if (tokens != NULL && parser->toksuper != -1 &&
+                tokens[parser->toksuper].type != JSMN_ARRAY &&
+                tokens[parser->toksuper].type != JSMN_OBJECT)
+            {
+                for (i = (int)parser->toknext - 1; i >= 0; i--)
+                {
+                    if (tokens[i].type == JSMN_ARRAY ||
+                        tokens[i].type == JSMN_OBJECT)
+                    {
+                        if (tokens[i].start != -1 && tokens[i].end == -1)
+                        {
+                            parser->toksuper = i;
+                            break;
+                        }
+                    }
+                }
+            }
+            break;
+        default:
+            r = prvParsePrimitive(parser, js, len, tokens, num_tokens);
+            if (r < 0)
+                return r;
+            count++;
+            if (parser->toksuper != -1 && tokens != NULL)
+                tokens[parser->toksuper].size++;
+            break;
+        }
+    }
+
+    if (tokens != NULL)
+    {
+        for (i = (int)parser->toknext - 1; i >= 0; i--)
+        {
+            if (tokens[i].start != -1 && tokens[i].end == -1)
+                return JSMN_ERROR_PART;
+        }
+    }
+    return count;
+}
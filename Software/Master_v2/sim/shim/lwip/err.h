@@ -0,0 +1,16 @@
+/*****************************************************************************/
+/**
+ * @file err.h
+ * @comments Virtual Arena用 空ヘッダ (インクルード互換のみ)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_LWIP_ERR_H
+#define SIM_LWIP_ERR_H
+
+#endif
@@ -0,0 +1,56 @@
+/*****************************************************************************/
+/**
+ * @file sockets.h
+ * @comments Virtual Arena用 lwIP socket互換ヘッダ
+ *           lwIPのLWIP_COMPAT_SOCKETSと同様に、socket API名をlwip_*へ
+ *           置き換えます。接続先は仮想GameManagement(sim_gm.cpp)です。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_LWIP_SOCKETS_H
+#define SIM_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int lwip_socket(int domain, int type, int protocol);
+int lwip_bind(int s, const struct sockaddr *name, socklen_t namelen);
+int lwip_listen(int s, int backlog);
+int lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen);
+int lwip_recv(int s, void *mem, size_t len, int flags);
+int lwip_send(int s, const void *dataptr, size_t size, int flags);
+int lwip_shutdown(int s, int how);
+int lwip_close(int s);
+int lwip_fcntl(int s, int cmd, ...);
+char *lwip_sim_ntoa_r(const void *addr, char *buf, int buflen);
+char *lwip_sim_ntoa6_r(const void *addr, char *buf, int buflen);
+
+#define socket(domain, type, protocol) lwip_socket(domain, type, protocol)
+#define bind(s, name, namelen) lwip_bind(s, name, namelen)
+#define listen(s, backlog) lwip_listen(s, backlog)
+#define accept(s, addr, addrlen) lwip_accept(s, addr, addrlen)
+#define recv(s, mem, len, flags) lwip_recv(s, mem, len, flags)
+#define send(s, dataptr, size, flags) lwip_send(s, dataptr, size, flags)
+#define shutdown(s, how) lwip_shutdown(s, how)
+#define close(s) lwip_close(s)
+#define fcntl lwip_fcntl
+#define inet_ntoa_r(addr, buf, buflen) lwip_sim_ntoa_r(&(addr), buf, buflen)
+#define inet6_ntoa_r(addr, buf, buflen) lwip_sim_ntoa6_r(&(addr), buf, buflen)
+
+#ifdef __cplusplus
+}
+#endif
+#endif
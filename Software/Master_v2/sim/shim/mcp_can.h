@@ -0,0 +1,125 @@
+/*****************************************************************************/
+/**
+ * @file mcp_can.h
+ * @comments Virtual Arena用 Seeed CAN-BUS Shield(MCP_CAN)互換ヘッダ
+ *           Panel_v2が使う関数だけを、vcan.hのMCP2515モデルの上に実装する。
+ *           begin()でpxVcanDefaultBus()のバスに繋がる(先にvVcanSetDefaultBus()を呼ぶこと)。
+ *           時刻はバスの現在時刻(VcanBus::ullNowNs)を使う。
+ *
+ *           実機のライブラリと同じく、begin()はマスク/フィルタを0にして
+ *           ロールオーバー(BUKT)を有効にする。標準フォーマットのみ。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_MCP_CAN_H
+#define SIM_MCP_CAN_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define CAN_OK 0
+#define CAN_FAILINIT 1
+#define CAN_FAILTX 2
+#define CAN_MSGAVAIL 3
+#define CAN_NOMSG 4
+#define CAN_CTRLERROR 5
+#define CAN_GETTXBFTIMEOUT 6
+#define CAN_SENDMSGTIMEOUT 7
+#define CAN_FAIL 0xff
+
+/* 速度・クロックは見ない(バスのビットレートで動く) */
+#define CAN_500KBPS 15
+#define MCP_8MHz 2
+#define MCP_16MHz 1
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+class MCP_CAN
+{
+  public:
+    explicit MCP_CAN(uint8_t bCsPin) : m_bCsPin(bCsPin) { memset(&m_xRx, 0, sizeof(m_xRx)); }
+
+    uint8_t begin(uint8_t bSpeed, uint8_t bClock = MCP_16MHz)
+    {
+        (void)bSpeed;
+        (void)bClock;
+        VcanBus *pxBus = pxVcanDefaultBus();
+        if (pxBus == nullptr)
+            return CAN_FAILINIT;
+        m_xMcp.vReset();
+        m_xMcp.vSetRollover(true);
+        if (m_xMcp.pxBus == nullptr)
+            pxBus->iAttach(&m_xMcp);
+        return CAN_OK;
+    }
+
+    uint8_t init_Mask(uint8_t bNum, uint8_t bExt, uint32_t ulData)
+    {
+        if (bExt != 0 || bNum >= VCAN_MCP_MASK_NUM)
+            return CAN_FAIL;
+        m_xMcp.vSetMask(bNum, ulData);
+        return CAN_OK;
+    }
+
+    uint8_t init_Filt(uint8_t bNum, uint8_t bExt, uint32_t ulData)
+    {
+        if (bExt != 0 || bNum >= VCAN_MCP_FILT_NUM)
+            return CAN_FAIL;
+        m_xMcp.vSetFilter(bNum, ulData);
+        return CAN_OK;
+    }
+
+    uint8_t checkReceive() { return m_xMcp.bRxPending() ? CAN_MSGAVAIL : CAN_NOMSG; }
+
+    uint8_t checkError() { return m_xMcp.bErrorPassive() ? CAN_CTRLERROR : CAN_OK; }
+
+    uint8_t readMsgBuf(uint8_t *pbLen, uint8_t *pbBuf)
+    {
+        if (!m_xMcp.bRead(&m_xRx, &m_ullRxNs))
+            return CAN_NOMSG;
+        *pbLen = m_xRx.data_length_code;
+        memcpy(pbBuf, m_xRx.data, m_xRx.data_length_code);
+        return CAN_OK;
+    }
+
+    uint32_t getCanId() { return m_xRx.identifier; }
+
+    uint8_t sendMsgBuf(uint32_t ulId, uint8_t bExt, uint8_t bLen, const uint8_t *pbBuf)
+    {
+        can_message_t xMsg = {};
+        if (bExt != 0 || bLen > CAN_MAX_DATA_LEN || m_xMcp.pxBus == nullptr)
+            return CAN_FAILTX;
+        xMsg.identifier = ulId;
+        xMsg.data_length_code = bLen;
+        memcpy(xMsg.data, pbBuf, bLen);
+        if (!m_xMcp.bLoad(&xMsg, 0, m_xMcp.pxBus->ullNowNs()))
+            return CAN_GETTXBFTIMEOUT;
+        return CAN_OK;
+    }
+
+    /* ホスト側の拡張(実機のライブラリには無い) */
+    VcanMcp2515 &xModel() { return m_xMcp; }
+    uint64_t ullLastRxNs() const { return m_ullRxNs; } // 最後に読んだフレームの受信時刻
+
+  private:
+    uint8_t m_bCsPin;
+    VcanMcp2515 m_xMcp;
+    can_message_t m_xRx;
+    uint64_t m_ullRxNs = 0;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/**
+ * @file tcpip_adapter.h
+ * @comments Virtual Arena用 tcpip_adapter互換ヘッダ
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_TCPIP_ADAPTER_H
+#define SIM_TCPIP_ADAPTER_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t u32_t;
+
+#define LWIP_MAKEU32(a, b, c, d)                                               \
+    (((u32_t)((a)&0xff) << 24) | ((u32_t)((b)&0xff) << 16) |                   \
+     ((u32_t)((c)&0xff) << 8) | (u32_t)((d)&0xff))
+#define PP_HTONL(x)                                                            \
+    ((((x) & (u32_t)0x000000ffUL) << 24) | (((x) & (u32_t)0x0000ff00UL) << 8) | \
+     (((x) & (u32_t)0x00ff0000UL) >> 8) | (((x) & (u32_t)0xff000000UL) >> 24))
+
+typedef struct
+{
+    u32_t addr;
+} ip4_addr_t;
+
+typedef struct
+{
+    u32_t addr[4];
+    uint8_t zone;
+} ip6_addr_t;
+
+typedef struct
+{
+    ip4_addr_t ip;
+    ip4_addr_t netmask;
+    ip4_addr_t gw;
+} tcpip_adapter_ip_info_t;
+
+typedef struct
+{
+    ip6_addr_t ip;
+} tcpip_adapter_ip6_info_t;
+
+typedef enum
+{
+    TCPIP_ADAPTER_IF_STA = 0,
+    TCPIP_ADAPTER_IF_AP,
+    TCPIP_ADAPTER_IF_MAX
+} tcpip_adapter_if_t;
+
+void tcpip_adapter_init(void);
+esp_err_t tcpip_adapter_dhcpc_stop(tcpip_adapter_if_t tcpip_if);
+esp_err_t tcpip_adapter_set_ip_info(tcpip_adapter_if_t tcpip_if,
+                                    const tcpip_adapter_ip_info_t *ip_info);
+esp_err_t tcpip_adapter_create_ip6_linklocal(tcpip_adapter_if_t tcpip_if);
+char *ip6addr_ntoa(const ip6_addr_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,664 @@
+/*****************************************************************************/
+/**
+ * @file sim_can.cpp
+ * @comments Virtual Arena CANドライバ(ESP-IDF v3.3 CAN API)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <string.h>
+
+#include <deque>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "driver/can.h"
+#include "esp_err.h"
+
+#include "drv_can.h"
+
+#include "sim_core.h"
+#include "sim_hw.h"
+#include "sim_stats.h"
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * バスはvcan.h(VcanBus)
+ *  - 500kbps、スタッフビットを含むフレーム長を実際のビット列から計算
+ *  - 送信待ちフレームのうち(ID, RTR)が最小のものが調停に勝つ
+ *    (同じIDはパネル側が先: パネルのノードを先に繋ぐ)
+ *  - 受信完了(EOF)時点で各ノードへ配送する
+ * ノードはMaster(TWAIドライバのキュー)とパネル全体(先着順)の2つ。
+ * パネル側はまとめて1ノードなのでTEC/RECを数えない
+ *
+ * 故障モデル(vSimCanFaultConfig)
+ *  - バスエラー: フレーム毎に確率でフレーム途中からエラーフレームになり、
+ *    その後の調停からやり直す。TEC/RECの増減とバスオフはVcanBus
+ *  - 強制バスオフ: 指定時刻にMasterのコントローラがバスオフになる(配線の短絡など)
+ *  - バスオフ中はMasterの送受信を止め、TXキューを捨てる。
+ *    can_initiate_recovery()後、128 x 11ビットのレセッシブでSTOPPEDへ戻る
+ *
+ * アラート(can_read_alerts): TX_SUCCESS / TX_IDLE / TX_FAILED / BUS_OFF /
+ * BUS_RECOVEREDのみ。Masterのフレームの受信完了(EOF)時点で上げる
+ */
+#define SIM_CAN_BIT_NS (SIM_CAN_BIT_US * 1000)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* Master: ドライバTXキューの先頭を送信バッファへ移して送る(エラーなら再送) */
+class SimCanMaster : public VcanNode
+{
+  public:
+    bool bTxPeek(can_message_t *pxMsg) override;
+    void vTxBegin(uint64_t ullNs) override;
+    void vTxDone(bool bOk, uint64_t ullNs) override;
+    void vRx(const can_message_t *pxMsg, uint64_t ullNs) override;
+    bool bOnBus(uint64_t ullNs) override;
+    void vBusOff(uint64_t ullNs) override;
+
+    void vDropHeld();
+
+  private:
+    SimCanFrame m_xHeld;
+    bool m_bHeld = false;
+};
+
+/* パネル全体: 送信要求の先着順 */
+class SimCanFloor : public VcanNode
+{
+  public:
+    SimCanFloor() { bCountErrors = false; }
+
+    bool bTxPeek(can_message_t *pxMsg) override;
+    void vTxBegin(uint64_t ullNs) override;
+    void vTxDone(bool bOk, uint64_t ullNs) override;
+    void vRx(const can_message_t *pxMsg, uint64_t ullNs) override;
+
+    std::deque<SimCanFrame> m_tx;
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+// ドライバ
+static bool gbInstalled = false;
+static can_state_t geState = CAN_STATE_STOPPED;
+static can_general_config_t gxGConfig;
+static can_filter_config_t gxFConfig;
+static QueueHandle_t gxTxQueue = NULL; // ドライバTXキュー(送信中のフレームは含まない)
+static QueueHandle_t gxRxQueue = NULL;
+static uint32_t gulRxMissed = 0;
+static uint32_t gulTxFailed = 0;
+static EventGroupHandle_t gxAlerts = NULL;
+static uint32_t gulAlertsEnabled = 0;
+
+// 故障注入
+static uint32_t gulBusOffs = 0;
+
+// バス
+static VcanBus gxBus(1000000000ULL / SIM_CAN_BIT_NS);
+static SimCanFloor gxFloor;
+static SimCanMaster gxMaster;
+static bool gbBusAttached = false;
+static SimCanFrame gxOnBus; // 送信中(配送する)フレーム
+static SimCanRxHook_t gpxPanelRxHook = NULL;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvBusAttach(void);
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs);
+static void prvBusStep(void *pvArg);
+static void prvBusKick(void *pvArg);
+static void prvBusOff(void *pvArg);
+static void prvRecoveryDone(void *pvArg);
+static void prvAlert(uint32_t ulAlert);
+
+/*****************************************************************************/
+/* Public Function (Driver)
+******************************************************************************/
+esp_err_t can_driver_install(const can_general_config_t *g_config,
+                             const can_timing_config_t *t_config,
+                             const can_filter_config_t *f_config)
+{
+    (void)t_config;
+    if (gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    gxGConfig = *g_config;
+    gxFConfig = *f_config;
+    gxTxQueue = xQueueCreate(g_config->tx_queue_len, sizeof(SimCanFrame));
+    gxRxQueue = xQueueCreate(g_config->rx_queue_len, sizeof(SimCanFrame));
+    vQueueAddToRegistry(gxTxQueue, "can_drv_tx");
+    vQueueAddToRegistry(gxRxQueue, "can_drv_rx");
+    if (gxAlerts == NULL)
+        gxAlerts = xEventGroupCreate();
+    prvBusAttach();
+    xEventGroupClearBits(gxAlerts, CAN_ALERT_ALL);
+    gulAlertsEnabled = g_config->alerts_enabled & CAN_ALERT_ALL;
+    gbInstalled = true;
+    geState = CAN_STATE_STOPPED;
+    return ESP_OK;
+}
+
+esp_err_t can_driver_uninstall(void)
+{
+    if (!gbInstalled || geState == CAN_STATE_RUNNING)
+        return ESP_ERR_INVALID_STATE;
+    gbInstalled = false;
+    return ESP_OK;
+}
+
+esp_err_t can_start(void)
+{
+    if (!gbInstalled || geState != CAN_STATE_STOPPED)
+        return ESP_ERR_INVALID_STATE;
+    geState = CAN_STATE_RUNNING;
+    return ESP_OK;
+}
+
+esp_err_t can_stop(void)
+{
+    if (!gbInstalled || geState != CAN_STATE_RUNNING)
+        return ESP_ERR_INVALID_STATE;
+    geState = CAN_STATE_STOPPED;
+    xQueueReset(gxTxQueue);
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * 送信
+ * 送信元タスクが最後に受信したキュー要素の投入時刻を起点として記録する。
+ * (CAN_txタスクならxCanTxRingへの投入時刻 = 生成からの遅延計測用)
+ * 問い合わせ・時刻同期のフレームは起点なし
+ *
+ * @param    message: 送信メッセージ
+ * @param    ticks_to_wait: TXキュー空き待ち時間
+ *
+ * @return   ESP_OK / ESP_ERR_TIMEOUT / ESP_ERR_INVALID_STATE
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t can_transmit(const can_message_t *message, TickType_t ticks_to_wait)
+{
+    if (message == NULL || message->data_length_code > CAN_MAX_DATA_LEN)
+        return ESP_ERR_INVALID_ARG;
+    if (!gbInstalled || geState != CAN_STATE_RUNNING)
+        return ESP_ERR_INVALID_STATE;
+
+    SimCanFrame xFrame;
+    xFrame.msg = *message;
+    // 問い合わせ・時刻同期はxCanTxRingを通らない(起点なし)
+    xFrame.ullOriginUs = bTbCanDecodeCtrl(message->data, message->data_length_code) != 0
+                             ? 0
+                             : ullSimTaskLastRxEnqUs();
+    xFrame.iSrcNode = SIM_CAN_MASTER_NODE;
+    if (xQueueSend(gxTxQueue, &xFrame, ticks_to_wait) != pdPASS)
+    {
+        ullSimCounter("can.tx_timeout")++;
+        return ESP_ERR_TIMEOUT;
+    }
+    vSimPostEvent(ullSimNowUs(), prvBusKick, NULL);
+    return ESP_OK;
+}
+
+esp_err_t can_receive(can_message_t *message, TickType_t ticks_to_wait)
+{
+    SimCanFrame xFrame;
+    if (!gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    if (xQueueReceive(gxRxQueue, &xFrame, ticks_to_wait) != pdPASS)
+        return ESP_ERR_TIMEOUT;
+    *message = xFrame.msg;
+    if (xFrame.ullOriginUs != 0)
+    {
+        xSimSeries("stomp -> can_receive")
+            .vAdd(ullSimNowUs() - xFrame.ullOriginUs);
+    }
+    return ESP_OK;
+}
+
+esp_err_t can_initiate_recovery(void)
+{
+    if (geState != CAN_STATE_BUS_OFF)
+        return ESP_ERR_INVALID_STATE;
+    geState = CAN_STATE_RECOVERING;
+    vSimPostEvent(ullSimNowUs() + (uint64_t)VCAN_RECOVERY_BITS * SIM_CAN_BIT_US,
+                  prvRecoveryDone, NULL);
+    return ESP_OK;
+}
+
+esp_err_t can_get_status_info(can_status_info_t *status_info)
+{
+    if (!gbInstalled || status_info == NULL)
+        return ESP_ERR_INVALID_ARG;
+    memset(status_info, 0, sizeof(*status_info));
+    status_info->state = geState;
+    status_info->msgs_to_tx =
+        uxQueueMessagesWaiting(gxTxQueue) + (gxBus.iOnBusNode() == gxMaster.iNode ? 1 : 0);
+    status_info->msgs_to_rx = uxQueueMessagesWaiting(gxRxQueue);
+    status_info->tx_error_counter = gxMaster.ulTec;
+    status_info->rx_error_counter = gxMaster.ulRec;
+    status_info->tx_failed_count = gulTxFailed;
+    status_info->rx_missed_count = gulRxMissed;
+    status_info->arb_lost_count = gxMaster.ulArbLost;
+    status_info->bus_error_count = (uint32_t)gxBus.xStats().ullErrors;
+    return ESP_OK;
+}
+
+esp_err_t can_clear_transmit_queue(void)
+{
+    if (!gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    xQueueReset(gxTxQueue);
+    return ESP_OK;
+}
+
+esp_err_t can_clear_receive_queue(void)
+{
+    if (!gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    xQueueReset(gxRxQueue);
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * アラートの読み出し
+ * 有効なアラートのいずれかが上がるまで待ち、読んだアラートは下ろす。
+ *
+ * @param    alerts: 上がっていたアラート
+ * @param    ticks_to_wait: 待ち時間
+ *
+ * @return   ESP_OK / ESP_ERR_TIMEOUT / ESP_ERR_INVALID_STATE
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t can_read_alerts(uint32_t *alerts, TickType_t ticks_to_wait)
+{
+    if (alerts == NULL)
+        return ESP_ERR_INVALID_ARG;
+    if (!gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    *alerts = 0;
+    if (gulAlertsEnabled == 0)
+        return ESP_ERR_TIMEOUT;
+    *alerts = xEventGroupWaitBits(gxAlerts, gulAlertsEnabled, pdTRUE, pdFALSE,
+                                  ticks_to_wait) &
+              gulAlertsEnabled;
+    return *alerts != 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t can_reconfigure_alerts(uint32_t alerts_enabled, uint32_t *current_alerts)
+{
+    if (!gbInstalled)
+        return ESP_ERR_INVALID_STATE;
+    gulAlertsEnabled = alerts_enabled & CAN_ALERT_ALL;
+    if (current_alerts != NULL)
+        *current_alerts = xEventGroupGetBits(gxAlerts) & CAN_ALERT_ALL;
+    xEventGroupClearBits(gxAlerts, CAN_ALERT_ALL & ~gulAlertsEnabled);
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/* Public Function (Bus)
+******************************************************************************/
+void vSimCanSetPanelRxHook(SimCanRxHook_t pxHook) { gpxPanelRxHook = pxHook; }
+
+/*****************************************************************************/
+/**
+ * 故障注入の設定
+ *
+ * @param    dErrProb: フレーム毎のバスエラー確率
+ * @param    pullBusOffUs / ulBusOffNum: 強制バスオフの時刻[us]
+ * @param    ullSeed: 乱数シード
+ *
+ * @return   ##
+ *
+ * @note     vSimStart()の前に呼ぶこと
+ *
+ ******************************************************************************/
+void vSimCanFaultConfig(double dErrProb, const uint64_t *pullBusOffUs, uint32_t ulBusOffNum,
+                        uint64_t ullSeed)
+{
+    prvBusAttach();
+    gxBus.vSetErrorRate(dErrProb, ullSeed);
+    for (uint32_t i = 0; i < ulBusOffNum; i++)
+        vSimPostEvent(pullBusOffUs[i], prvBusOff, NULL);
+}
+
+/*****************************************************************************/
+/**
+ * パネル(MCP2515)からの送信要求
+ *
+ * @param    pxFrame: 送信フレーム
+ *
+ * @return   ##
+ *
+ * @note     SimEventタスクのコンテキストから呼ぶこと
+ *
+ ******************************************************************************/
+void vSimCanPanelSubmit(const SimCanFrame *pxFrame)
+{
+    prvBusAttach();
+    gxFloor.m_tx.push_back(*pxFrame);
+    gxFloor.vKick(ullSimNowUs() * 1000);
+}
+
+void vSimCanReport(FILE *pxOut)
+{
+    uint64_t ullNow = ullSimNowUs();
+    const VcanBusStats &xBus = gxBus.xStats();
+    fprintf(pxOut, "--- can bus ---\n");
+    fprintf(pxOut, "%-34s %10llu\n", "bits on bus",
+            (unsigned long long)xBus.ullBits);
+    fprintf(pxOut, "%-34s %10.3f\n", "bus busy [s]", xBus.ullBusyNs / 1e9);
+    fprintf(pxOut, "%-34s %9.2f%%\n", "bus load (whole run)",
+            ullNow ? 100.0 * xBus.ullBusyNs / 1000 / ullNow : 0.0);
+    fprintf(pxOut, "%-34s %10llu\n", "bus arbitrations",
+            (unsigned long long)xBus.ullArbitrations);
+    fprintf(pxOut, "%-34s %10llu\n", "bus same-id clashes",
+            (unsigned long long)xBus.ullIdClash);
+    fprintf(pxOut, "%-34s %10u\n", "driver rx missed", gulRxMissed);
+    fprintf(pxOut, "%-34s %10llu\n", "driver bus errors",
+            (unsigned long long)xBus.ullErrors);
+    fprintf(pxOut, "%-34s %10u\n", "driver bus-off", gulBusOffs);
+
+    // ファームウェア側の送信カウンタ(drv_can)
+    canTxStats_t tFrom = {};
+    canTxStats_t tTo;
+    vCanGetTxStats(&tTo);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx frames", tTo.ulFrames);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx frames/s (whole run)", ulCanTxFps(&tFrom, &tTo));
+    fprintf(pxOut, "%-34s %10u\n", "fw tx peak frames/s (100ms)", tTo.ulPeakFps);
+    fprintf(pxOut, "%-34s %9.1f%%\n", "fw tx load (whole run)",
+            ulCanTxLoadPermil(&tFrom, &tTo) / 10.0);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx paced (same panel)", tTo.ulPaced);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx backpressure (queue full)", tTo.ulBackpressure);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx time syncs", tTo.ulSync);
+    fprintf(pxOut, "%-34s %10u\n", "fw tx time syncs skipped", tTo.ulSyncSkipped);
+    canRelStats_t tRel;
+    vCanGetRelStats(&tRel);
+    fprintf(pxOut, "%-34s %10u\n", "fw reliable sent (ack req)", tRel.ulSent);
+    fprintf(pxOut, "%-34s %10u\n", "fw reliable acked", tRel.ulAcked);
+    fprintf(pxOut, "%-34s %10u\n", "fw reliable retransmits", tRel.ulRetry);
+    fprintf(pxOut, "%-34s %10u\n", "fw reliable give-ups", tRel.ulGiveUp);
+    fprintf(pxOut, "%-34s %10u\n", "fw acks sent (replies)", tRel.ulAckTx);
+    fprintf(pxOut, "%-34s %10u\n", "fw duplicate replies dropped", tRel.ulDup);
+    canRxStats_t tRx;
+    vCanGetRxStats(&tRx);
+    fprintf(pxOut, "%-34s %10u\n", "fw rx wakeups", tRx.ulWakeups);
+    fprintf(pxOut, "%-34s %10u\n", "fw rx frames", tRx.ulFrames);
+    fprintf(pxOut, "%-34s %10u\n", "fw rx forwarded to ctrl_main", tRx.ulForwarded);
+    fprintf(pxOut, "%-34s %10u\n", "fw rx frames / wakeup (max)", tRx.ulBatchMax);
+    uint32_t ulV2 = 0;
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+        ulV2 += bCanPanelProto(i) >= TBCAN_VER_2 ? 1 : 0;
+    fprintf(pxOut, "%-34s %10u\n", "fw panels on protocol v2", ulV2);
+
+    // ファームウェア側の監視(drv_canの監視タスク)
+    canHealth_t tHealth;
+    vCanGetHealth(&tHealth);
+    fprintf(pxOut, "%-34s %10u\n", "fw health bus-off", tHealth.ulBusOff);
+    fprintf(pxOut, "%-34s %10u\n", "fw health recovered", tHealth.ulRecovered);
+    fprintf(pxOut, "%-34s %10u\n", "fw health tx dropped", tHealth.ulTxDropped);
+    fprintf(pxOut, "%-34s %10.3f\n", "fw health down [s]", tHealth.llDownUs / 1e6);
+    fprintf(pxOut, "%-34s %10u\n", "fw health tec peak (window)", tHealth.ulTecPeak);
+
+    // パネルの死活(drv_canの死活テーブル)
+    liveTbl_t tLive;
+    uint32_t ulLost = 0;
+    uint32_t ulBoots = 0;
+    uint32_t ulRxFull = 0;
+    uint32_t ulRxOvr = 0;
+    uint32_t ulSeq = ulCanGetLive(&tLive);
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        ulLost += tLive.usLost[i];
+        ulBoots += tLive.usBoots[i];
+        ulRxFull += tLive.usRxFull[i];
+        ulRxOvr += tLive.usRxOvr[i];
+    }
+    fprintf(pxOut, "%-34s %10d\n", "fw panels alive",
+            __builtin_popcount(ulLiveTblMask(&tLive, PANEL_LIVE_ALIVE)));
+    fprintf(pxOut, "%-34s 0x%08x\n", "fw panels dead",
+            ulLiveTblMask(&tLive, PANEL_LIVE_DEAD));
+    fprintf(pxOut, "%-34s 0x%08x\n", "fw panels stuck",
+            ulLiveTblMask(&tLive, PANEL_LIVE_STUCK));
+    fprintf(pxOut, "%-34s 0x%08x\n", "fw panels unknown",
+            ulLiveTblMask(&tLive, PANEL_LIVE_UNKNOWN));
+    fprintf(pxOut, "%-34s %10u\n", "fw panels boots", ulBoots);
+    fprintf(pxOut, "%-34s %10u\n", "fw panels status lost", ulLost);
+    fprintf(pxOut, "%-34s %10u\n", "fw panels rx ring full", ulRxFull);
+    fprintf(pxOut, "%-34s %10u\n", "fw panels rx overrun", ulRxOvr);
+    fprintf(pxOut, "%-34s %10u\n", "fw panels live changes", ulSeq);
+}
+
+/*****************************************************************************/
+/* Private Function (Node)
+******************************************************************************/
+bool SimCanMaster::bTxPeek(can_message_t *pxMsg)
+{
+    SimCanFrame xFrame;
+    if (m_bHeld)
+    {
+        *pxMsg = m_xHeld.msg;
+        return true;
+    }
+    if (gxTxQueue == NULL || xQueuePeek(gxTxQueue, &xFrame, 0) != pdPASS)
+        return false;
+    *pxMsg = xFrame.msg;
+    return true;
+}
+
+void SimCanMaster::vTxBegin(uint64_t ullNs)
+{
+    can_message_t xMsg;
+    (void)ullNs;
+    if (!m_bHeld)
+    {
+        xQueueReceive(gxTxQueue, &m_xHeld, 0);
+        m_bHeld = true;
+    }
+    gxOnBus = m_xHeld;
+    if (gxFloor.bTxPeek(&xMsg))
+        ullSimCounter("can.arbitration_lost (panel)")++;
+}
+
+/*****************************************************************************/
+/**
+ * Masterの送信完了
+ *
+ * @param    bOk: false = 送信中にバスオフ、停止した
+ * @param    ullNs: 現在時刻
+ *
+ * @return   ##
+ *
+ * @note     パネルへの配送はこの後(VcanBusがgxFloor.vRx()を呼ぶ)
+ *
+ ******************************************************************************/
+void SimCanMaster::vTxDone(bool bOk, uint64_t ullNs)
+{
+    (void)ullNs;
+    if (!m_bHeld)
+        return;
+    m_bHeld = false;
+    if (!bOk)
+    {
+        ullSimCounter("can.frames lost (bus-off)")++;
+        prvAlert(CAN_ALERT_TX_FAILED);
+        return;
+    }
+    ullSimCounter("can.frames master->panel")++;
+    prvAlert(CAN_ALERT_TX_SUCCESS |
+             (uxQueueMessagesWaiting(gxTxQueue) == 0 ? CAN_ALERT_TX_IDLE : 0));
+    if (m_xHeld.ullOriginUs != 0)
+    {
+        xSimSeries("CAN_tx queue in -> bus done")
+            .vAdd(ullSimNowUs() - m_xHeld.ullOriginUs);
+    }
+}
+
+void SimCanMaster::vRx(const can_message_t *pxMsg, uint64_t ullNs)
+{
+    (void)ullNs;
+    if (!bVcanTwaiFilterMatch(gxFConfig.acceptance_code, gxFConfig.acceptance_mask,
+                              pxMsg->identifier))
+        return;
+    if (xQueueSendFromISR(gxRxQueue, &gxOnBus, NULL) != pdPASS)
+        gulRxMissed++;
+}
+
+bool SimCanMaster::bOnBus(uint64_t ullNs)
+{
+    (void)ullNs;
+    return geState == CAN_STATE_RUNNING;
+}
+
+/* TECが256に達した: 送信中のフレームは失敗 */
+void SimCanMaster::vBusOff(uint64_t ullNs)
+{
+    (void)ullNs;
+    m_bHeld = false;
+    gulTxFailed++;
+    prvAlert(CAN_ALERT_TX_FAILED);
+    prvBusOff(NULL);
+}
+
+/* バスに出ていない送信バッファのフレームを捨てる(調停に負けて再送待ちの間のバスオフ) */
+void SimCanMaster::vDropHeld()
+{
+    if (m_bHeld && gxBus.iOnBusNode() != iNode)
+    {
+        m_bHeld = false;
+        ullSimCounter("can.frames lost (bus-off)")++;
+    }
+}
+
+bool SimCanFloor::bTxPeek(can_message_t *pxMsg)
+{
+    if (m_tx.empty())
+        return false;
+    *pxMsg = m_tx.front().msg;
+    return true;
+}
+
+void SimCanFloor::vTxBegin(uint64_t ullNs)
+{
+    can_message_t xMsg;
+    gxOnBus = m_tx.front();
+    if (gxMaster.bOnBus(ullNs) && gxMaster.bTxPeek(&xMsg))
+        ullSimCounter("can.arbitration_lost (master)")++;
+}
+
+void SimCanFloor::vTxDone(bool bOk, uint64_t ullNs)
+{
+    (void)bOk;
+    (void)ullNs;
+    m_tx.pop_front();
+    ullSimCounter("can.frames panel->master")++;
+}
+
+void SimCanFloor::vRx(const can_message_t *pxMsg, uint64_t ullNs)
+{
+    (void)pxMsg;
+    (void)ullNs;
+    if (gpxPanelRxHook != NULL)
+        gpxPanelRxHook(&gxOnBus);
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+/* パネル側を先に繋ぐ(同じIDの調停はパネルが先) */
+static void prvBusAttach(void)
+{
+    if (gbBusAttached)
+        return;
+    gbBusAttached = true;
+    gxBus.iAttach(&gxFloor);
+    gxBus.iAttach(&gxMaster);
+    gxBus.vSetWake(prvBusWake, NULL);
+}
+
+/* バスの次の変化(フレーム完了、調停)の時刻にイベントを置く */
+static void prvBusWake(void *pvCtx, uint64_t ullAtNs)
+{
+    (void)pvCtx;
+    vSimPostEvent(ullAtNs / 1000, prvBusStep, NULL);
+}
+
+static void prvBusStep(void *pvArg)
+{
+    (void)pvArg;
+    gxBus.vAdvance(ullSimNowUs() * 1000);
+}
+
+/* Masterの送信待ちが増えた */
+static void prvBusKick(void *pvArg)
+{
+    (void)pvArg;
+    gxMaster.vKick(ullSimNowUs() * 1000);
+}
+
+/*****************************************************************************/
+/**
+ * バスオフ
+ * Masterのコントローラはバスから離れ、TXキューと送信中のフレームを捨てる。
+ *
+ * @param    pvArgは未使用
+ *
+ * @return   ##
+ *
+ * @note     送信中のフレームはフレームの終わりでvTxDone(false)になる
+ *
+ ******************************************************************************/
+static void prvBusOff(void *pvArg)
+{
+    (void)pvArg;
+    if (geState != CAN_STATE_RUNNING)
+        return;
+    geState = CAN_STATE_BUS_OFF;
+    gxMaster.ulTec = VCAN_BUS_OFF_TEC;
+    gulBusOffs++;
+    prvAlert(CAN_ALERT_BUS_OFF);
+    ullSimCounter("can.frames lost (bus-off)") += uxQueueMessagesWaiting(gxTxQueue);
+    xQueueReset(gxTxQueue);
+    gxMaster.vDropHeld();
+}
+
+/* 128 x 11ビットのレセッシブを検出 -> STOPPED (can_start()で再開) */
+static void prvRecoveryDone(void *pvArg)
+{
+    (void)pvArg;
+    if (geState != CAN_STATE_RECOVERING)
+        return;
+    geState = CAN_STATE_STOPPED;
+    gxMaster.ulTec = 0;
+    gxMaster.ulRec = 0;
+    prvAlert(CAN_ALERT_BUS_RECOVERED);
+}
+
+/* 有効なアラートのみ上げる */
+static void prvAlert(uint32_t ulAlert)
+{
+    if (gxAlerts != NULL && (gulAlertsEnabled & ulAlert) != 0)
+        xEventGroupSetBits(gxAlerts, gulAlertsEnabled & ulAlert);
+}
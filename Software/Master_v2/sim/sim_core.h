@@ -0,0 +1,84 @@
+/*****************************************************************************/
+/**
+ * @file sim_core.h
+ * @comments Virtual Arena 仮想時間スケジューラ
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_CORE_H
+#define SIM_CORE_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_WAIT_FOREVER UINT64_MAX
+#define SIM_MS(ms) ((uint64_t)(ms)*1000ULL)
+#define SIM_SEC(s) ((uint64_t)(s)*1000000ULL)
+
+/*
+ * 仮想時間スケジューラの動作
+ *  - 各タスクはpthreadで実行されるが、同時に走るのは常に1タスクのみ。
+ *  - 実行可能タスクのうち最高優先度のものを選び、同優先度は到着順。
+ *  - 全タスクがブロックしたら次の起床時刻まで仮想時刻を進める。
+ *  - コードの実行時間は0とみなす(遅延はバス/UART/I2C等のモデルで付与)。
+ * 以上より、同じシード・同じ設定なら実行結果は常に同一になる。
+ */
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef void (*SimEventFn_t)(void *pvArg);
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+/* 時刻 */
+uint64_t ullSimNowUs(void);
+uint64_t ullSimTicksToWakeUs(TickType_t xTicks);
+
+/* スケジューラ内部API (シム実装用) */
+void vSimLock(void);
+void vSimUnlock(void);
+BaseType_t xSimWaitLocked(const void *pvObj, uint64_t ullWakeUs);
+UBaseType_t uxSimWakeLocked(const void *pvObj, BaseType_t xAll);
+void vSimRetimeLocked(const void *pvObj, uint64_t ullWakeUs);
+void vSimDelayUs(uint64_t ullUs);
+
+/* イベント (最高優先度の"SimEvent"タスクから呼ばれる) */
+void vSimPostEvent(uint64_t ullAtUs, SimEventFn_t pxFn, void *pvArg);
+
+/* 実行制御 */
+void vSimSetTimeLimit(uint64_t ullLimitUs);
+void vSimSetStopHook(void (*pxHook)(int iCode));
+void vSimStart(TaskFunction_t pxMainTask) __attribute__((noreturn));
+void vSimStop(int iCode) __attribute__((noreturn));
+
+/* ログ */
+void vSimSetLogLevel(int iLevel);
+
+/* レポート */
+void vSimQueueReport(FILE *pxOut);
+void vSimRingReport(FILE *pxOut);
+uint64_t ullSimTaskLastRxEnqUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,1107 @@
+/*****************************************************************************/
+/**
+ * @file sim_floor.cpp
+ * @comments Virtual Arena パネル(25枚)とプレイヤーのモデル
+ *           同時に遊ぶときはプレイヤー毎に自分の区画(ctrl_zone)だけを踏む。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+
+#include "ctrl_group.h"
+#include "ctrl_zone.h"
+#include "def_system.h"
+#include "tb_canproto.h"
+#include "tb_timesync.h"
+
+#include "sim_core.h"
+#include "sim_floor.h"
+#include "sim_hw.h"
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * Panel_v2 (main.cpp) の動作を再現する
+ *  - loop()は1フレームずつ処理し、処理中に届いたフレームは
+ *    待機状態へ戻るときのvClearCanRxBuffer()で捨てられる
+ *  - bBtnFlag: 点灯時間以内に踏まれたらMasterへ返信
+ *  - bStartSwFlag: 踏まれるまで点灯を続け、踏まれたら返信
+ *  - それ以外(デモ点灯): 点灯時間の間点灯
+ *  - フレームはtb_canproto.hで読み、受信したバージョンで返信する。
+ *    旧ファームウェア(ulV1PanelMask)はv1の位置のまま読み、対応バージョン0で返す
+ */
+#define PANEL_LOOP_TAIL_US SIM_MS(10) // タイムアウト後のdelay(10)
+#define PANEL_DEMO_TAIL_US SIM_MS(20)
+#define PANEL_MASTER_CAN_ID 0x00
+#define PANEL_V1_LIGHT_CONV_MS 1000 // 従来のPanelのLIGHT_TIME_CONV_NUM(秒 -> ms)
+
+/*
+ * 死活監視(v2のパネルのみ)
+ *  - 起動時、TBCAN_HEARTBEAT_MS毎、問い合わせへの返信でCAN ID 0x100 + PanelIDへ送る
+ *  - 送信はloop()の状態と関係なく行う(ポーリングの合間に送るため)
+ *  - 起動の位相はパネル毎にずらす(電源投入のばらつき)
+ */
+#define PANEL_BOOT_PHASE_US SIM_MS(40) // PanelID毎の起動のずれ
+#define PANEL_FW_MAJOR 2
+#define PANEL_FW_MINOR 3
+
+/*
+ * 時刻同期(v2のパネルのみ, tb_timesync.h)
+ *  - パネル毎の時計: 位相はランダム、周波数は±dPanelSkewPpmのずれ(uint32_tで一周する)
+ *  - SYNCの受信割り込みの時刻は受信完了から0..dPanelIsrJitterUs遅れる
+ *  - loop()が処理中のときに届いたSYNC/FOLLOW_UPは捨てられる
+ *  - 同期していれば踏んだ時刻と反応時間(点灯 -> 踏んだ)を付けて返す
+ */
+
+/*
+ * 配送確認(v2のパネルのみ, tb_canproto.h)
+ *  - ACK要求のフレームを読んだら(待機中のみ)受信処理の後にACKを返す。
+ *    最後に受けた番号と同じならACKだけ返して捨てる
+ *  - 押下許可／スタート通知にTBCAN_FLAG_REL_REPLYがあれば返信にACK要求を付け、
+ *    ACKが来るまで待つ(TBCAN_ACK_TIMEOUT_MS、再送毎に倍、TBCAN_RETRY_MAX回まで送り直す)
+ *  - ACK待ちの間に届いたフレームは1つだけ取っておき、待機状態へ戻ってから処理する
+ *  - 故障注入(--lose): パネル毎の受信、Masterへの返信・ACKをそれぞれの確率で失う
+ */
+
+/* ePlaylist_t (drv_dfplayer.h) */
+#define SIM_SE_PANEL 4
+#define SIM_SE_DAMAGE 7
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+enum eSimPanelMode
+{
+    PANEL_MODE_IDLE,
+    PANEL_MODE_BUTTON,
+    PANEL_MODE_START_SW,
+    PANEL_MODE_DEMO,
+    PANEL_MODE_ACK_WAIT // 返信のACK待ち
+};
+
+struct SimPanel
+{
+    uint32_t ulId;
+    eSimPanelMode eMode;
+    SimCanFrame xFrame; // 処理中のフレーム
+    tbCanFrame_t xCmd;  // 処理中のフレームの内容
+    bool bV1Only;       // 旧ファームウェア
+    bool bAnim;         // アニメーション、LED毎の色を描ける(描画はしない、受けた数だけ数える)
+    tbCanPixelRx_t xPixelRx; // LED毎の色のフレームを揃える
+    bool bDead;         // 止まった(故障注入)
+    bool bStuck;        // センサが踏まれたまま(故障注入)
+    uint8_t bStatusCount;
+    uint64_t ullStompUs;
+    // 時計と時刻同期
+    double dClockPpb;      // 周波数のずれ[ppb]
+    uint32_t ulClockPhase; // 位相[us]
+    tbTimeSync_t xSync;
+    uint8_t bSyncSeq;
+    uint32_t ulSyncRxUs;
+    bool bSyncPending;
+    uint32_t ulLedOnUs; // 点灯した時刻(パネルの時計)
+    // 配送確認
+    bool bRelRxValid;     // ACK要求のフレームを受けた
+    uint8_t bRelRxSeq;    // 最後に受けたACK要求のフレームの番号
+    uint8_t bRelTries;    // 返信を送り直した回数
+    uint64_t ullRelDueUs; // 次に送り直す時刻
+    bool bHeld;           // ACK待ちの間に届いたフレームを取ってある
+    SimCanFrame xHeld;
+};
+
+/* プレイヤー(区画毎に1人) */
+struct SimPlayer
+{
+    int iTeam;
+    uint32_t ulPanel;        // 今いるパネル(スタートSWから)
+    uint64_t ullFreeUs;      // 次を踏めるようになる時刻
+    uint64_t ullLastSpawnUs;
+    SimFloorGameStats xGame;
+};
+
+static_assert(SIM_FLOOR_PLAYER_MAX == configZONE_MAX,
+              "SIM_FLOOR_PLAYER_MAX must follow configZONE_MAX");
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static SimFloorConfig gxConfig;
+static SimPanel gPanels[SIM_FLOOR_PANEL_NUM + 1]; // [0]は未使用
+static uint64_t gullRand = 1;
+static uint64_t gullFaultRand = 1; // 故障注入用(プレイヤーの乱数列を変えない)
+static uint64_t gullClockRand = 1; // パネルの時計用(同上)
+static SimPlayer gPlayers[SIM_FLOOR_PLAYER_MAX];
+static const zoneLayout_t *gpxLayout = NULL;
+static std::deque<uint64_t> gStompFifo; // 効果音待ちの踏んだ時刻
+static SimFloorGameStats gxTotal;
+static bool gbStatusMuted = false; // 再生: エントリー後の死活監視は記録のフレームを流す
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvPanelRx(const SimCanFrame *pxFrame);
+static void prvPanelAccept(SimPanel *pxPanel, const SimCanFrame *pxFrame);
+static void prvPanelLit(void *pvArg);
+static void prvPanelStomp(void *pvArg);
+static void prvPanelRelease(void *pvArg);
+static void prvPanelDeferredSubmit(void *pvArg);
+static void prvPanelSubmit(const SimCanFrame *pxFrame);
+static void prvPanelSendAck(SimPanel *pxPanel, uint8_t bSeq);
+static void prvPanelAckRx(SimPanel *pxPanel, const SimCanFrame *pxFrame);
+static void prvPanelAckTimeout(void *pvArg);
+static void prvPanelIdle(SimPanel *pxPanel);
+static void prvPanelStatus(SimPanel *pxPanel, uint8_t bReason);
+static void prvPanelBoot(void *pvArg);
+static void prvPanelHeartbeat(void *pvArg);
+static void prvPanelDiscoverReply(void *pvArg);
+static void prvPanelDie(void *pvArg);
+static void prvPanelStick(void *pvArg);
+static double prvRandUniform(void);
+static double prvRandFault(void);
+static double prvRandClock(void);
+static uint32_t prvPanelLocalUs(const SimPanel *pxPanel, uint64_t ullUs);
+static void prvPanelSync(SimPanel *pxPanel, const SimCanFrame *pxFrame, uint8_t bCmd);
+static double prvRandNormal(void);
+static double prvSampleMs(const SimDist *pxDist);
+static bool prvPanelDecode(const SimPanel *pxPanel, const can_message_t *pxMsg,
+                           tbCanFrame_t *pxCmd);
+static int prvFrameColor(const tbCanFrame_t *pxCmd);
+static uint32_t prvGridDist(uint32_t ulA, uint32_t ulB);
+static SimPlayer *prvPlayerOf(uint32_t ulPanelId);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+void vSimFloorInit(const SimFloorConfig *pxConfig)
+{
+    gxConfig = *pxConfig;
+    gullRand = pxConfig->ullSeed * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+    gullFaultRand = gullRand ^ 0xD1B54A32D192ED03ULL;
+    gullClockRand = gullRand ^ 0x8CB92BA72F3D8DD7ULL;
+    for (uint32_t i = 1; i <= SIM_FLOOR_PANEL_NUM; i++)
+    {
+        gPanels[i].ulId = i;
+        gPanels[i].dClockPpb = (prvRandClock() * 2.0 - 1.0) * pxConfig->dPanelSkewPpm * 1000.0;
+        gPanels[i].ulClockPhase = (uint32_t)(prvRandClock() * 4294967296.0);
+        vTbSyncInit(&gPanels[i].xSync);
+        gPanels[i].eMode = PANEL_MODE_IDLE;
+        gPanels[i].bV1Only = (pxConfig->ulV1PanelMask & (1UL << i)) != 0;
+        gPanels[i].bAnim = !gPanels[i].bV1Only && (pxConfig->ulAnimPanelMask & (1UL << i)) != 0;
+        if (!gPanels[i].bV1Only)
+            vSimPostEvent(i * PANEL_BOOT_PHASE_US, prvPanelBoot, &gPanels[i]);
+        if ((pxConfig->ulDeadPanelMask & (1UL << i)) != 0)
+            vSimPostEvent((uint64_t)(pxConfig->dDeadAtS * 1e6), prvPanelDie, &gPanels[i]);
+        if ((pxConfig->ulStuckPanelMask & (1UL << i)) != 0)
+            vSimPostEvent((uint64_t)(pxConfig->dStuckAtS * 1e6), prvPanelStick, &gPanels[i]);
+    }
+    gpxLayout = pxZoneGetLayout(1);
+    vSimCanSetPanelRxHook(prvPanelRx);
+}
+
+/*****************************************************************************/
+/**
+ * エントリー(GMが送信)
+ * 人数から区画を決め、各プレイヤーを自分の区画に割り当てる。
+ *
+ * @param    piTeam: プレイヤー毎のチーム(1:RED 2:GREEN 3:BLUE、並びが区画)
+ * @param    ulPlayers: 人数
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimFloorEntry(const int *piTeam, uint32_t ulPlayers)
+{
+    gpxLayout = pxZoneGetLayout(ulPlayers);
+    for (uint32_t i = 0; i < SIM_FLOOR_PLAYER_MAX; i++)
+    {
+        gPlayers[i].iTeam = i < ulPlayers ? piTeam[i] : 0;
+    }
+    // 再生: ここから先の死活監視のフレームは記録にある
+    if (gxConfig.bReplay)
+        gbStatusMuted = true;
+}
+
+/*****************************************************************************/
+/**
+ * ゲーム開始(GMが"esp_gamestart"を受信)
+ * プレイヤーは自分の区画のスタートSWから動き始める。
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimFloorBeginGame(void)
+{
+    for (uint32_t i = 0; i < SIM_FLOOR_PLAYER_MAX; i++)
+    {
+        gPlayers[i].ulPanel = i < gpxLayout->bZoneNum ? gpxLayout->bStartSw[i] : PANEL_13;
+        gPlayers[i].ullLastSpawnUs = 0;
+        memset(&gPlayers[i].xGame, 0, sizeof(gPlayers[i].xGame));
+    }
+    gStompFifo.clear();
+}
+
+/*****************************************************************************/
+/**
+ * 再生: 記録された受信フレームをパネルから送る
+ *
+ * @param    pxMsg: Masterが受信したフレーム(data[0]:PanelID)
+ *
+ * @return   ##
+ *
+ * @note     SimEventタスクのコンテキストから呼ぶこと
+ *
+ ******************************************************************************/
+void vSimFloorReplayRx(const can_message_t *pxMsg)
+{
+    SimCanFrame xTx = {};
+    tbCanFrame_t xRx = {};
+
+    if (TBCAN_ID_IS_STATUS(pxMsg->identifier))
+    {
+        // 死活監視: パネルの状態は変えない
+        xTx.msg = *pxMsg;
+        xTx.ullOriginUs = ullSimNowUs();
+        xTx.iSrcNode = (int)(pxMsg->identifier & TBCAN_ID_MASK);
+        ullSimCounter("floor.replayed frames")++;
+        vSimCanPanelSubmit(&xTx);
+        return;
+    }
+
+    uint32_t ulId = bTbCanDecode(pxMsg->data, pxMsg->data_length_code, &xRx) != 0
+                        ? xRx.bPanelId
+                        : 0;
+
+    xTx.msg = *pxMsg;
+    xTx.ullOriginUs = ullSimNowUs();
+    xTx.iSrcNode = (int)ulId;
+    if (ulId >= 1 && ulId <= SIM_FLOOR_PANEL_NUM)
+    {
+        // 踏まれたパネルは待機状態へ戻る
+        gPanels[ulId].xFrame.iSrcNode = SIM_CAN_MASTER_NODE;
+        gPanels[ulId].eMode = PANEL_MODE_IDLE;
+        if (xRx.bBtn == 1 && xRx.bStartSw == 0)
+        {
+            prvPlayerOf(ulId)->xGame.ulStomps++;
+            gxTotal.ulStomps++;
+            gStompFifo.push_back(xTx.ullOriginUs);
+        }
+    }
+    ullSimCounter("floor.replayed frames")++;
+    vSimCanPanelSubmit(&xTx);
+}
+
+SimFloorGameStats xSimFloorTakeGameStats(uint32_t ulZone)
+{
+    SimFloorGameStats xStats = {};
+    if (ulZone < SIM_FLOOR_PLAYER_MAX)
+    {
+        xStats = gPlayers[ulZone].xGame;
+        memset(&gPlayers[ulZone].xGame, 0, sizeof(gPlayers[ulZone].xGame));
+    }
+    return xStats;
+}
+
+/*****************************************************************************/
+/**
+ * 効果音の再生(DFPlayerモデルから呼ばれる)
+ * 踏んだ時刻から効果音までの遅延を記録する。
+ *
+ * @param    iSound: ePlaylist_t
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimFloorOnSound(int iSound)
+{
+    if (iSound != SIM_SE_PANEL && iSound != SIM_SE_DAMAGE)
+        return;
+    if (gStompFifo.empty())
+    {
+        ullSimCounter("floor.hit SE without stomp")++;
+        return;
+    }
+    xSimSeries("stomp -> SE play").vAdd(ullSimNowUs() - gStompFifo.front());
+    gStompFifo.pop_front();
+}
+
+void vSimFloorReport(FILE *pxOut)
+{
+    fprintf(pxOut, "--- floor (all games) ---\n");
+    fprintf(pxOut, "%-34s %10u\n", "spawns lit", gxTotal.ulSpawns);
+    fprintf(pxOut, "%-34s %10u\n", "spawns dropped (panel busy)",
+            gxTotal.ulSpawnDropped);
+    fprintf(pxOut, "%-34s %10u\n", "stomps", gxTotal.ulStomps);
+    fprintf(pxOut, "%-34s %10u\n", "timeouts", gxTotal.ulTimeouts);
+    fprintf(pxOut, "%-34s %10u\n", "skipped by player", gxTotal.ulSkipped);
+    fprintf(pxOut, "%-34s %10zu\n", "stomps without SE (after finish)",
+            gStompFifo.size());
+    uint32_t ulLocked = 0;
+    for (uint32_t i = 1; i <= SIM_FLOOR_PANEL_NUM; i++)
+    {
+        ulLocked += bTbSyncLocked(&gPanels[i].xSync,
+                                  prvPanelLocalUs(&gPanels[i], ullSimNowUs()))
+                        ? 1
+                        : 0;
+    }
+    fprintf(pxOut, "%-34s %10u\n", "panels time-synced (at end)", ulLocked);
+}
+
+/*****************************************************************************/
+/**
+ * 分布指定のパース "normal:450,120" 形式
+ *
+ * @param    pcSpec: 指定文字列
+ * @param    pxDist: 出力
+ *
+ * @return   true: 成功
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+bool bSimDistParse(const char *pcSpec, SimDist *pxDist)
+{
+    static const struct
+    {
+        const char *pcName;
+        eSimDist eType;
+    } cxNames[] = {{"fixed", SIM_DIST_FIXED},
+                   {"uniform", SIM_DIST_UNIFORM},
+                   {"normal", SIM_DIST_NORMAL},
+                   {"lognormal", SIM_DIST_LOGNORMAL},
+                   {"exp", SIM_DIST_EXP}};
+    const char *pcColon = strchr(pcSpec, ':');
+    if (pcColon == NULL)
+        return false;
+    size_t uxLen = (size_t)(pcColon - pcSpec);
+    for (const auto &name : cxNames)
+    {
+        if (strlen(name.pcName) == uxLen && strncmp(pcSpec, name.pcName, uxLen) == 0)
+        {
+            double dA = 0.0, dB = 0.0;
+            int iN = sscanf(pcColon + 1, "%lf,%lf", &dA, &dB);
+            if (iN < 1)
+                return false;
+            pxDist->eType = name.eType;
+            pxDist->dA = dA;
+            pxDist->dB = dB;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * バスからの受信
+ * MCP2515のフィルタ: 自パネルID、自分の行・列を含むグループ宛て(ctrl_group)
+ *
+ * @param    pxFrame: 受信フレーム
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvPanelRx(const SimCanFrame *pxFrame)
+{
+    uint32_t ulMask = ulGroupPanelMask(pxFrame->msg.identifier);
+    if (ulMask == 0)
+    {
+        ullSimCounter("floor.frames to no panel")++;
+        return;
+    }
+    if (CAN_ID_IS_GROUP(pxFrame->msg.identifier))
+        ullSimCounter("floor.group frames")++;
+
+    for (uint32_t i = 1; i <= SIM_FLOOR_PANEL_NUM; i++)
+    {
+        if ((ulMask & (1UL << i)) == 0)
+            continue;
+        // 故障注入: このパネルだけ受け損なう(MCP2515のオーバーラン、ノイズ)
+        if (gxConfig.dLoseProb > 0.0 && prvRandFault() < gxConfig.dLoseProb)
+        {
+            ullSimCounter("floor.frames to panel lost (injected)")++;
+            continue;
+        }
+        prvPanelAccept(&gPanels[i], pxFrame);
+    }
+}
+
+/* 1枚のパネルの受信処理 */
+static void prvPanelAccept(SimPanel *pxPanel, const SimCanFrame *pxFrame)
+{
+    uint32_t ulId = pxPanel->ulId;
+    tbCanFrame_t xCmd;
+    uint8_t bCtrl = 0;
+    if (pxPanel->bDead)
+    {
+        ullSimCounter("floor.frames to dead panel")++;
+        return;
+    }
+    if (!pxPanel->bV1Only)
+        bCtrl = bTbCanDecodeCtrl(pxFrame->msg.data, pxFrame->msg.data_length_code);
+    if (bCtrl == TBCAN_CMD_SYNC || bCtrl == TBCAN_CMD_FOLLOW_UP)
+    {
+        prvPanelSync(pxPanel, pxFrame, bCtrl);
+        return;
+    }
+    if (bCtrl == TBCAN_CMD_ACK)
+    {
+        prvPanelAckRx(pxPanel, pxFrame);
+        return;
+    }
+    if (bCtrl == TBCAN_CMD_ANIM)
+    {
+        // アニメーション: パネルが自分で描く(判定はしないのでloop()の状態は変えない)
+        if (pxPanel->bAnim)
+            ullSimCounter("floor.anim commands")++;
+        else
+            ullSimCounter("floor.anim to unsupported panel")++;
+        return;
+    }
+    if (bCtrl == TBCAN_CMD_PIXEL)
+    {
+        // LED毎の色: 揃ったときだけ表示する(loop()の状態は変えない)
+        tbCanPixel_t xPixel;
+        if (!pxPanel->bAnim)
+            ullSimCounter("floor.pixel to unsupported panel")++;
+        else if (bTbCanDecodePixel(&pxPanel->xPixelRx, pxFrame->msg.data, &xPixel))
+            ullSimCounter("floor.pixel images")++;
+        return;
+    }
+    if (bCtrl == TBCAN_CMD_DISCOVER)
+    {
+        // 問い合わせ: PanelID毎の枠をずらして返す(loop()の状態は変えない)
+        vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dPanelRxMs * 1000.0) +
+                          SIM_MS((uint64_t)(ulId - PANEL_1) * TBCAN_DISCOVER_SLOT_MS),
+                      prvPanelDiscoverReply, pxPanel);
+        return;
+    }
+    if (!prvPanelDecode(pxPanel, &pxFrame->msg, &xCmd))
+        return;
+    bool bButton = xCmd.bBtn == 1;
+    if (pxPanel->eMode == PANEL_MODE_ACK_WAIT && !pxPanel->bHeld)
+    {
+        // ACK待ちの間に読んだフレームは取っておく
+        pxPanel->xHeld = *pxFrame;
+        pxPanel->bHeld = true;
+        ullSimCounter("floor.frames held during ack wait")++;
+        return;
+    }
+    if (pxPanel->eMode != PANEL_MODE_IDLE)
+    {
+        // 処理中: 待機状態へ戻るときに捨てられる
+        ullSimCounter("floor.frames dropped (panel busy)")++;
+        if (bButton)
+        {
+            prvPlayerOf(ulId)->xGame.ulSpawnDropped++;
+            gxTotal.ulSpawnDropped++;
+        }
+        return;
+    }
+    if (xCmd.bAckReq)
+    {
+        // ACKを返す。ACKが失われた再送はACKだけ返して捨てる
+        prvPanelSendAck(pxPanel, xCmd.bSeq);
+        if (pxPanel->bRelRxValid && pxPanel->bRelRxSeq == xCmd.bSeq)
+        {
+            ullSimCounter("floor.duplicate frames suppressed")++;
+            return;
+        }
+        pxPanel->bRelRxValid = true;
+        pxPanel->bRelRxSeq = xCmd.bSeq;
+    }
+
+    pxPanel->xFrame = *pxFrame;
+    pxPanel->xCmd = xCmd;
+    if (bButton)
+        pxPanel->eMode = PANEL_MODE_BUTTON;
+    else if (xCmd.bStartSw == 1)
+        pxPanel->eMode = PANEL_MODE_START_SW;
+    else
+        pxPanel->eMode = PANEL_MODE_DEMO;
+
+    vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dPanelRxMs * 1000.0),
+                  prvPanelLit, pxPanel);
+}
+
+/*****************************************************************************/
+/**
+ * LED点灯、プレイヤーの行動決定
+ *
+ * @param    pvArg: SimPanel*
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvPanelLit(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    SimPlayer *pxPlayer = prvPlayerOf(pxPanel->ulId);
+    const tbCanFrame_t *pxCmd = &pxPanel->xCmd;
+    uint64_t ullNow = ullSimNowUs();
+    uint64_t ullOffUs = ullNow + SIM_MS((uint64_t)pxCmd->usLightMs);
+
+    if (pxPanel->bDead)
+        return;
+    pxPanel->ulLedOnUs = prvPanelLocalUs(pxPanel, ullNow);
+    if (pxPanel->xFrame.ullOriginUs != 0)
+    {
+        xSimSeries("CAN_tx queue in -> LED on")
+            .vAdd(ullNow - pxPanel->xFrame.ullOriginUs);
+    }
+
+    switch (pxPanel->eMode)
+    {
+    case PANEL_MODE_BUTTON:
+    {
+        pxPlayer->xGame.ulSpawns++;
+        gxTotal.ulSpawns++;
+        if (pxPlayer->ullLastSpawnUs != 0)
+            xSimSeries("spawn interval (LED on)").vAdd(ullNow - pxPlayer->ullLastSpawnUs);
+        pxPlayer->ullLastSpawnUs = ullNow;
+
+        if (gxConfig.bReplay)
+        {
+            // 再生: 踏んだフレームはvSimFloorReplayRx()で流す
+            vSimPostEvent(ullOffUs + PANEL_LOOP_TAIL_US, prvPanelRelease, pxPanel);
+            break;
+        }
+
+        int iColor = prvFrameColor(pxCmd);
+        // チームの弱点色 (csWeakTbl: RED->BLUE, GREEN->RED, BLUE->GREEN)
+        static const int ciWeak[] = {0, 3, 1, 2};
+        int iTeam = pxPlayer->iTeam;
+        bool bWeak = iTeam >= 1 && iTeam <= 3 && iColor == ciWeak[iTeam];
+        bool bSkip = prvRandUniform() < gxConfig.dMissProb ||
+                     (bWeak && prvRandUniform() < gxConfig.dAvoidProb);
+
+        uint64_t ullStompUs = 0;
+        if (pxPanel->bStuck)
+        {
+            // センサが踏まれたまま: 点灯した途端に踏まれたと返す
+            bSkip = false;
+            ullStompUs = ullNow;
+        }
+        else if (!bSkip)
+        {
+            double dReact = prvSampleMs(&gxConfig.xReaction);
+            if (dReact < gxConfig.dMinReactionMs)
+                dReact = gxConfig.dMinReactionMs;
+            ullStompUs = ullNow + (uint64_t)(dReact * 1000.0);
+            if (ullStompUs < pxPlayer->ullFreeUs)
+                ullStompUs = pxPlayer->ullFreeUs;
+            // 今いるパネルから歩く
+            ullStompUs += (uint64_t)(prvGridDist(pxPlayer->ulPanel, pxPanel->ulId) *
+                                     gxConfig.dStepMs * 1000.0);
+        }
+
+        if (!bSkip && ullStompUs < ullOffUs)
+        {
+            pxPlayer->ulPanel = pxPanel->ulId;
+            pxPlayer->ullFreeUs = ullStompUs + (uint64_t)(gxConfig.dMoveMs * 1000.0);
+            pxPanel->ullStompUs = ullStompUs;
+            vSimPostEvent(ullStompUs, prvPanelStomp, pxPanel);
+        }
+        else
+        {
+            if (bSkip)
+            {
+                pxPlayer->xGame.ulSkipped++;
+                gxTotal.ulSkipped++;
+            }
+            pxPlayer->xGame.ulTimeouts++;
+            gxTotal.ulTimeouts++;
+            vSimPostEvent(ullOffUs + PANEL_LOOP_TAIL_US, prvPanelRelease, pxPanel);
+        }
+        break;
+    }
+    case PANEL_MODE_START_SW:
+    {
+        if (gxConfig.bReplay)
+            break; // 再生: 記録の押下フレームで待機状態へ戻る
+        uint64_t ullStompUs =
+            ullNow + (uint64_t)(gxConfig.dStartDelayMs * 1000.0);
+        if (ullStompUs < pxPlayer->ullFreeUs)
+            ullStompUs = pxPlayer->ullFreeUs;
+        pxPanel->ullStompUs = ullStompUs;
+        vSimPostEvent(ullStompUs, prvPanelStomp, pxPanel);
+        break;
+    }
+    case PANEL_MODE_DEMO:
+    default:
+        vSimPostEvent(ullOffUs + PANEL_DEMO_TAIL_US, prvPanelRelease, pxPanel);
+        break;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 踏まれた -> Masterへ返信 (bCanSendWrapper相当)
+ * 受信したフレームと同じバージョンで返す
+ *
+ * @param    pvArg: SimPanel*
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvPanelStomp(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    tbCanFrame_t xReply = pxPanel->xCmd;
+    SimCanFrame xTx = {};
+
+    if (pxPanel->bDead)
+        return;
+
+    xReply.bPanelId = (uint8_t)pxPanel->ulId;
+    xReply.bBtn = 1; // スタートSWでも押下フラグを立てて返す
+    xReply.usLightMs = 0;
+    xReply.bCap = pxPanel->bV1Only ? 0 : TBCAN_VER_MAX;
+    // Masterが求めていれば返信にACK要求を付ける
+    xReply.bAckReq = xReply.bVer == TBCAN_VER_2 && !pxPanel->bV1Only && pxPanel->xCmd.bRelReply;
+    xReply.bRelReply = 0;
+    xTx.msg.identifier = PANEL_MASTER_CAN_ID;
+    xTx.msg.data_length_code = bTbCanEncode(&xReply, xReply.bVer, xTx.msg.data);
+    xTx.ullOriginUs = pxPanel->ullStompUs;
+    xTx.iSrcNode = (int)pxPanel->ulId;
+
+    if (pxPanel->eMode == PANEL_MODE_BUTTON)
+    {
+        // 同期していれば踏んだ時刻(Masterの時刻)と反応時間を付ける(vPanelStampPress相当)
+        uint32_t ulPressUs = prvPanelLocalUs(pxPanel, pxPanel->ullStompUs);
+        if (xReply.bVer == TBCAN_VER_2 && bTbSyncLocked(&pxPanel->xSync, ulPressUs))
+        {
+            uint32_t ulEstUs = ulTbSyncToMaster(&pxPanel->xSync, ulPressUs);
+            uint32_t ulReactTick = (ulPressUs - pxPanel->ulLedOnUs) >> TBCAN_TIME_TICK_SHIFT;
+            int32_t lErrUs = (int32_t)(ulEstUs - (uint32_t)pxPanel->ullStompUs);
+            xReply.bTimed = 1;
+            xReply.usPressTick = (uint16_t)(ulEstUs >> TBCAN_TIME_TICK_SHIFT);
+            xReply.usReactTick = ulReactTick > 0xFFFF ? 0xFFFF : (uint16_t)ulReactTick;
+            xTx.msg.data_length_code = bTbCanEncode(&xReply, xReply.bVer, xTx.msg.data);
+            xSimSeries("timed press error (abs)").vAdd((uint64_t)(lErrUs < 0 ? -lErrUs : lErrUs));
+            ullSimCounter("floor.timed stomps")++;
+        }
+        else
+        {
+            ullSimCounter("floor.untimed stomps")++;
+        }
+        prvPlayerOf(pxPanel->ulId)->xGame.ulStomps++;
+        gxTotal.ulStomps++;
+        gStompFifo.push_back(pxPanel->ullStompUs);
+    }
+
+    // シリアル出力等の後に送信、送信後に待機状態へ
+    pxPanel->xFrame = xTx;
+    vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dPanelTxMs * 1000.0),
+                  prvPanelRelease, pxPanel);
+}
+
+static void prvPanelRelease(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    if (pxPanel->xFrame.iSrcNode == (int)pxPanel->ulId)
+    {
+        prvPanelSubmit(&pxPanel->xFrame);
+
+        // 故障注入: 同じ押下フレームをもう一度送る
+        if (gxConfig.dDupProb > 0.0 && prvRandFault() < gxConfig.dDupProb)
+        {
+            ullSimCounter("floor.duplicate stomps injected")++;
+            vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dDupGapMs * 1000.0),
+                          prvPanelDeferredSubmit, new SimCanFrame(pxPanel->xFrame));
+        }
+
+        // ACK要求を付けた返信はACKを待つ
+        if ((pxPanel->xFrame.msg.data[1] & TBCAN_FLAG_ACK_REQ) != 0 &&
+            (pxPanel->xFrame.msg.data[0] >> TBCAN_VER_SHIFT) == TBCAN_VER_2)
+        {
+            pxPanel->eMode = PANEL_MODE_ACK_WAIT;
+            pxPanel->bRelTries = 0;
+            pxPanel->ullRelDueUs = ullSimNowUs() + SIM_MS(TBCAN_ACK_TIMEOUT_MS);
+            vSimPostEvent(pxPanel->ullRelDueUs, prvPanelAckTimeout, pxPanel);
+            return;
+        }
+    }
+    prvPanelIdle(pxPanel);
+}
+
+/* 待機状態へ戻る(ACK待ちの間に取っておいたフレームを処理する) */
+static void prvPanelIdle(SimPanel *pxPanel)
+{
+    pxPanel->xFrame.iSrcNode = SIM_CAN_MASTER_NODE;
+    pxPanel->eMode = PANEL_MODE_IDLE;
+    if (pxPanel->bHeld)
+    {
+        pxPanel->bHeld = false;
+        prvPanelAccept(pxPanel, &pxPanel->xHeld);
+    }
+}
+
+static void prvPanelDeferredSubmit(void *pvArg)
+{
+    SimCanFrame *pxFrame = (SimCanFrame *)pvArg;
+    prvPanelSubmit(pxFrame);
+    delete pxFrame;
+}
+
+/* バスへ送る(故障注入: Masterへのフレームを失う) */
+static void prvPanelSubmit(const SimCanFrame *pxFrame)
+{
+    if (pxFrame->msg.identifier == PANEL_MASTER_CAN_ID && gxConfig.dLoseProb > 0.0 &&
+        prvRandFault() < gxConfig.dLoseProb)
+    {
+        ullSimCounter("floor.frames to master lost (injected)")++;
+        return;
+    }
+    vSimCanPanelSubmit(pxFrame);
+}
+
+/*****************************************************************************/
+/**
+ * ACKを返す (bPanelSendAck相当)
+ *
+ * @param    pxPanel: パネル
+ * @param    bSeq: 受けたフレームの番号
+ *
+ * @return   ##
+ *
+ * @note     受信処理(シリアル出力)の後に送る。再生中は記録のACKを流すので送らない
+ *
+ ******************************************************************************/
+static void prvPanelSendAck(SimPanel *pxPanel, uint8_t bSeq)
+{
+    SimCanFrame xTx = {};
+
+    if (gxConfig.bReplay)
+        return;
+    xTx.msg.identifier = PANEL_MASTER_CAN_ID;
+    xTx.msg.data_length_code = bTbCanEncodeAck((uint8_t)pxPanel->ulId, bSeq, xTx.msg.data);
+    xTx.iSrcNode = (int)pxPanel->ulId;
+    ullSimCounter("floor.acks sent")++;
+    vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dPanelRxMs * 1000.0),
+                  prvPanelDeferredSubmit, new SimCanFrame(xTx));
+}
+
+/* Masterからの返信のACK */
+static void prvPanelAckRx(SimPanel *pxPanel, const SimCanFrame *pxFrame)
+{
+    uint8_t bPanelId;
+    uint8_t bSeq;
+
+    vTbCanDecodeAck(pxFrame->msg.data, &bPanelId, &bSeq);
+    if (pxPanel->eMode != PANEL_MODE_ACK_WAIT || bPanelId != pxPanel->ulId ||
+        bSeq != pxPanel->xFrame.msg.data[2])
+    {
+        ullSimCounter("floor.acks stale")++;
+        return;
+    }
+    ullSimCounter("floor.acks received")++;
+    prvPanelIdle(pxPanel);
+}
+
+/* 返信のACKが来ない: 送り直す／諦める */
+static void prvPanelAckTimeout(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+
+    if (pxPanel->bDead || pxPanel->eMode != PANEL_MODE_ACK_WAIT ||
+        ullSimNowUs() < pxPanel->ullRelDueUs)
+    {
+        return;
+    }
+    if (pxPanel->bRelTries >= TBCAN_RETRY_MAX)
+    {
+        ullSimCounter("floor.reply give-ups")++;
+        prvPanelIdle(pxPanel);
+        return;
+    }
+    pxPanel->bRelTries++;
+    ullSimCounter("floor.reply retransmits")++;
+    prvPanelSubmit(&pxPanel->xFrame);
+    pxPanel->ullRelDueUs = ullSimNowUs() + (SIM_MS(TBCAN_ACK_TIMEOUT_MS) << pxPanel->bRelTries);
+    vSimPostEvent(pxPanel->ullRelDueUs, prvPanelAckTimeout, pxPanel);
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを送る (vPanelSendStatus相当)
+ *
+ * @param    pxPanel: パネル
+ * @param    bReason: TBCAN_STATUS_*
+ *
+ * @return   ##
+ *
+ * @note     止まったパネル、再生中のエントリー後は送らない
+ *
+ ******************************************************************************/
+static void prvPanelStatus(SimPanel *pxPanel, uint8_t bReason)
+{
+    tbCanStatus_t xStatus = {};
+    SimCanFrame xTx = {};
+
+    if (pxPanel->bDead || gbStatusMuted)
+        return;
+    xStatus.bPanelId = (uint8_t)pxPanel->ulId;
+    xStatus.bSensor = pxPanel->bStuck ? TBCAN_SENSOR_PRESSED | TBCAN_SENSOR_STUCK : 0;
+    xStatus.bCount = ++pxPanel->bStatusCount;
+    xStatus.bFwMajor = PANEL_FW_MAJOR;
+    xStatus.bFwMinor = PANEL_FW_MINOR;
+    xStatus.bReason = bReason;
+    xStatus.bFeat = TBCAN_FEAT_ACK;
+    if (pxPanel->bAnim)
+        xStatus.bFeat |= TBCAN_FEAT_ANIM | TBCAN_FEAT_PIXEL;
+    xStatus.bCap = TBCAN_VER_MAX;
+    xTx.msg.identifier = TBCAN_ID_STATUS_BASE + pxPanel->ulId;
+    xTx.msg.data_length_code = bTbCanEncodeStatus(&xStatus, xTx.msg.data);
+    xTx.ullOriginUs = ullSimNowUs();
+    xTx.iSrcNode = (int)pxPanel->ulId;
+    ullSimCounter("floor.status frames")++;
+    vSimCanPanelSubmit(&xTx);
+}
+
+static void prvPanelBoot(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    prvPanelStatus(pxPanel, TBCAN_STATUS_BOOT);
+    vSimPostEvent(ullSimNowUs() + SIM_MS(TBCAN_HEARTBEAT_MS), prvPanelHeartbeat, pxPanel);
+}
+
+static void prvPanelHeartbeat(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    if (pxPanel->bDead)
+        return;
+    prvPanelStatus(pxPanel, TBCAN_STATUS_PERIODIC);
+    vSimPostEvent(ullSimNowUs() + SIM_MS(TBCAN_HEARTBEAT_MS), prvPanelHeartbeat, pxPanel);
+}
+
+static void prvPanelDiscoverReply(void *pvArg)
+{
+    prvPanelStatus((SimPanel *)pvArg, TBCAN_STATUS_DISCOVER);
+}
+
+/*****************************************************************************/
+/**
+ * 時刻同期のフレームの受信 (vPanelTimeSync相当)
+ *
+ * @param    pxPanel: パネル
+ * @param    pxFrame: SYNC / FOLLOW_UP
+ * @param    bCmd: TBCAN_CMD_SYNC / TBCAN_CMD_FOLLOW_UP
+ *
+ * @return   ##
+ *
+ * @note     loop()が処理中なら捨てられる(待機状態へ戻るときに受信バッファを消す)
+ *
+ ******************************************************************************/
+static void prvPanelSync(SimPanel *pxPanel, const SimCanFrame *pxFrame, uint8_t bCmd)
+{
+    uint8_t bSeq;
+    uint32_t ulMasterUs;
+
+    if (pxPanel->eMode != PANEL_MODE_IDLE)
+    {
+        ullSimCounter("floor.sync frames lost (panel busy)")++;
+        if (bCmd == TBCAN_CMD_SYNC)
+            pxPanel->bSyncPending = false;
+        return;
+    }
+    vTbCanDecodeSync(pxFrame->msg.data, &bSeq, &ulMasterUs);
+    if (bCmd == TBCAN_CMD_SYNC)
+    {
+        uint64_t ullIsrUs = ullSimNowUs() +
+                            (uint64_t)(prvRandClock() * gxConfig.dPanelIsrJitterUs);
+        pxPanel->bSyncSeq = bSeq;
+        pxPanel->ulSyncRxUs = prvPanelLocalUs(pxPanel, ullIsrUs);
+        pxPanel->bSyncPending = true;
+        return;
+    }
+    if (!pxPanel->bSyncPending || bSeq != pxPanel->bSyncSeq)
+    {
+        ullSimCounter("floor.sync follow-ups unmatched")++;
+        return;
+    }
+    pxPanel->bSyncPending = false;
+    if (bTbSyncUpdate(&pxPanel->xSync, pxPanel->ulSyncRxUs, ulMasterUs))
+        ullSimCounter("floor.sync samples")++;
+    else
+        ullSimCounter("floor.sync samples rejected")++;
+}
+
+/* パネルの時計(micros()相当) */
+static uint32_t prvPanelLocalUs(const SimPanel *pxPanel, uint64_t ullUs)
+{
+    return (uint32_t)(pxPanel->ulClockPhase + ullUs +
+                      (int64_t)((double)ullUs * pxPanel->dClockPpb / 1e9));
+}
+
+/* 故障注入: パネルが止まる(電源断、ケーブル抜け) */
+static void prvPanelDie(void *pvArg)
+{
+    SimPanel *pxPanel = (SimPanel *)pvArg;
+    pxPanel->bDead = true;
+    pxPanel->eMode = PANEL_MODE_IDLE;
+    pxPanel->bHeld = false;
+    pxPanel->xFrame.iSrcNode = SIM_CAN_MASTER_NODE;
+    ullSimCounter("floor.panels died")++;
+}
+
+/* 故障注入: センサが踏まれたままになる */
+static void prvPanelStick(void *pvArg)
+{
+    ((SimPanel *)pvArg)->bStuck = true;
+    ullSimCounter("floor.panels stuck")++;
+}
+
+/* 5x5の盤面(PanelIDは行優先)のチェビシェフ距離 */
+static uint32_t prvGridDist(uint32_t ulA, uint32_t ulB)
+{
+    int iDr = abs((int)((ulA - 1) / 5) - (int)((ulB - 1) / 5));
+    int iDc = abs((int)((ulA - 1) % 5) - (int)((ulB - 1) % 5));
+    return (uint32_t)(iDr > iDc ? iDr : iDc);
+}
+
+/* パネルの区画のプレイヤー(区画外は区画0の人が踏む) */
+static SimPlayer *prvPlayerOf(uint32_t ulPanelId)
+{
+    uint32_t ulZone = ulZoneOfPanel(gpxLayout, ulPanelId);
+    return &gPlayers[ulZone < SIM_FLOOR_PLAYER_MAX ? ulZone : 0];
+}
+
+/*
+ * パネルのファームウェアでフレームを読む
+ * 旧ファームウェアはtb_canproto.hを通さず、従来のPanelと同じにv1の位置のまま読む
+ * (v2のフレームが届くと色や時間が壊れる)
+ */
+static bool prvPanelDecode(const SimPanel *pxPanel, const can_message_t *pxMsg,
+                           tbCanFrame_t *pxCmd)
+{
+    if (pxPanel->bV1Only)
+    {
+        uint8_t bData[TBCAN_DLC] = {};
+        memcpy(bData, pxMsg->data, sizeof(bData));
+        if ((bData[0] >> TBCAN_VER_SHIFT) != 0)
+            ullSimCounter("floor.v2 frames to v1 panel")++;
+        // 従来のPanel(canMsg_t)と同じ: [5]は秒、フェードは直線、[7]とv2の項目は見ない
+        uint32_t ulLightMs = (uint32_t)bData[5] * PANEL_V1_LIGHT_CONV_MS;
+        *pxCmd = tbCanFrame_t{};
+        pxCmd->bVer = TBCAN_VER_1;
+        pxCmd->bPanelId = (uint8_t)(bData[0] & TBCAN_ID_MASK);
+        pxCmd->bBtn = bData[1];
+        pxCmd->bR = bData[2];
+        pxCmd->bG = bData[3];
+        pxCmd->bB = bData[4];
+        pxCmd->usLightMs = (uint16_t)(ulLightMs > 0xFFFF ? 0xFFFF : ulLightMs);
+        pxCmd->bStartSw = bData[6];
+        pxCmd->bFade = TBCAN_FADE_LINEAR;
+        return true;
+    }
+    if (bTbCanDecode(pxMsg->data, pxMsg->data_length_code, pxCmd) == 0)
+    {
+        ullSimCounter("floor.undecodable frames")++;
+        return false;
+    }
+    if (pxCmd->bVer == TBCAN_VER_2)
+        ullSimCounter("floor.v2 frames")++;
+    return true;
+}
+
+static int prvFrameColor(const tbCanFrame_t *pxCmd)
+{
+    // enum COLOR: RED=2, GREEN=3, BLUE=4 -> 1..3 (チーム番号と同じ並び)
+    bool bR = pxCmd->bR > 0, bG = pxCmd->bG > 0, bB = pxCmd->bB > 0;
+    if (bR && !bG && !bB)
+        return 1;
+    if (!bR && bG && !bB)
+        return 2;
+    if (!bR && !bG && bB)
+        return 3;
+    return 0;
+}
+
+/* xorshift64* */
+static double prvRandUniform(void)
+{
+    gullRand ^= gullRand >> 12;
+    gullRand ^= gullRand << 25;
+    gullRand ^= gullRand >> 27;
+    return (double)((gullRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double prvRandFault(void)
+{
+    gullFaultRand ^= gullFaultRand >> 12;
+    gullFaultRand ^= gullFaultRand << 25;
+    gullFaultRand ^= gullFaultRand >> 27;
+    return (double)((gullFaultRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double prvRandClock(void)
+{
+    gullClockRand ^= gullClockRand >> 12;
+    gullClockRand ^= gullClockRand << 25;
+    gullClockRand ^= gullClockRand >> 27;
+    return (double)((gullClockRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double prvRandNormal(void)
+{
+    double dU1 = prvRandUniform();
+    double dU2 = prvRandUniform();
+    if (dU1 < 1e-12)
+        dU1 = 1e-12;
+    return sqrt(-2.0 * log(dU1)) * cos(2.0 * M_PI * dU2);
+}
+
+static double prvSampleMs(const SimDist *pxDist)
+{
+    switch (pxDist->eType)
+    {
+    case SIM_DIST_UNIFORM:
+        return pxDist->dA + (pxDist->dB - pxDist->dA) * prvRandUniform();
+    case SIM_DIST_NORMAL:
+        return pxDist->dA + pxDist->dB * prvRandNormal();
+    case SIM_DIST_LOGNORMAL:
+    {
+        double dVar = log(1.0 + (pxDist->dB * pxDist->dB) / (pxDist->dA * pxDist->dA));
+        double dMu = log(pxDist->dA) - dVar / 2.0;
+        return exp(dMu + sqrt(dVar) * prvRandNormal());
+    }
+    case SIM_DIST_EXP:
+        return pxDist->dA - pxDist->dB * log(1.0 - prvRandUniform());
+    case SIM_DIST_FIXED:
+    default:
+        return pxDist->dA;
+    }
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************/
+/**
+ * @file sim_floor.h
+ * @comments Virtual Arena パネル(25枚)とプレイヤーのモデル
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_FLOOR_H
+#define SIM_FLOOR_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "driver/can.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_FLOOR_PANEL_NUM 25
+#define SIM_FLOOR_PLAYER_MAX 3 // 同時に遊ぶ人数の上限(区画数)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 反応時間の分布 */
+enum eSimDist
+{
+    SIM_DIST_FIXED,     // a
+    SIM_DIST_UNIFORM,   // [a, b]
+    SIM_DIST_NORMAL,    // 平均a, 標準偏差b
+    SIM_DIST_LOGNORMAL, // 平均a, 標準偏差b (対数正規)
+    SIM_DIST_EXP        // a + 指数分布(平均b)
+};
+
+struct SimDist
+{
+    eSimDist eType;
+    double dA; // ms
+    double dB; // ms
+};
+
+/*
+ * パネル/プレイヤー設定
+ * パネルの遅延はPanel_v2のシリアル出力やloop()の処理時間の目安。
+ */
+struct SimFloorConfig
+{
+    uint64_t ullSeed = 1;
+    double dPanelRxMs = 8.0;   // CAN受信 -> LED点灯
+    double dPanelTxMs = 3.0;   // 踏まれた -> CAN送信要求
+    SimDist xReaction = {SIM_DIST_NORMAL, 450.0, 120.0};
+    double dMinReactionMs = 120.0;
+    double dMoveMs = 250.0;    // 踏んだ後、次を踏めるまで
+    double dStepMs = 0.0;      // 1マス(斜め含む)移動する時間(0:位置を考えない)
+    double dMissProb = 0.05;   // 見逃し確率
+    double dAvoidProb = 0.5;   // 弱点色を避ける確率
+    double dStartDelayMs = 1500.0; // スタートSWを踏むまで
+    double dDupProb = 0.0;     // 踏んだフレームを重複送信する確率(故障注入)
+    double dDupGapMs = 5.0;    // 重複送信の間隔
+    double dLoseProb = 0.0;    // フレームを失う確率(パネル毎の受信、パネル -> Master。故障注入)
+    uint32_t ulV1PanelMask = 0; // 旧ファームウェア(CANプロトコルv1のみ)のパネル(bit = PanelID)
+    uint32_t ulAnimPanelMask = 0; // アニメーション、LED毎の色(TBCAN_FEAT_ANIM / PIXEL)を描けるパネル
+    uint32_t ulDeadPanelMask = 0;  // 途中で止まるパネル(受信も死活監視の送信もしない)
+    double dDeadAtS = 0.0;         // 止まる時刻
+    uint32_t ulStuckPanelMask = 0; // 途中からセンサが踏まれたままになるパネル
+    double dStuckAtS = 0.0;        // 踏まれたままと報告し始める時刻
+    double dPanelSkewPpm = 100.0;   // パネルの時計のずれ(±の一様分布、セラミック発振子)
+    double dPanelIsrJitterUs = 20.0; // SYNCの受信割り込みの遅れ(0..の一様分布)
+    bool bReplay = false;      // 再生: プレイヤーは踏まず、記録の受信フレームを流す
+};
+
+/* ゲーム(区画)毎のパネル側集計 */
+struct SimFloorGameStats
+{
+    uint32_t ulSpawns;       // 押下許可付きで点灯したパネル
+    uint32_t ulSpawnDropped; // パネルが処理中で取りこぼしたパネル生成
+    uint32_t ulStomps;       // 踏んで送信したパネル
+    uint32_t ulTimeouts;     // 時間切れ
+    uint32_t ulSkipped;      // 見逃し/回避
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vSimFloorInit(const SimFloorConfig *pxConfig);
+void vSimFloorEntry(const int *piTeam, uint32_t ulPlayers);
+void vSimFloorBeginGame(void);
+void vSimFloorReplayRx(const can_message_t *pxMsg);
+SimFloorGameStats xSimFloorTakeGameStats(uint32_t ulZone);
+void vSimFloorReport(FILE *pxOut);
+bool bSimDistParse(const char *pcSpec, SimDist *pxDist);
+
+#endif
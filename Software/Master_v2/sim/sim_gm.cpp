@@ -0,0 +1,488 @@
+/*****************************************************************************/
+/**
+ * @file sim_gm.cpp
+ * @comments Virtual Arena GameManagement(gamemng.py) / Webserverのモデル
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "ctrl_sched.h"
+#include "util_diag.h"
+
+#include "sim_core.h"
+#include "sim_floor.h"
+#include "sim_gm.h"
+#include "sim_hw.h"
+#include "sim_replay.h"
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* drv_gamemng.c のコマンド文字列 */
+#define GM_CMD_WAIT "esp_wait"
+#define GM_CMD_GAME_START "esp_gamestart"
+#define GM_CMD_PLAYER_ENTRY "esp_playerEntry"
+#define GM_CMD_TRACE "esp_trace "
+#define GM_CMD_TUNE_OK "esp_tune"
+#define GM_CMD_REC "esp_rec "
+#define GM_CMD_FAIL "Bad command"
+#define GM_CMD_PANELS "esp_panels "
+#define GM_CMD_DIAG "esp_diag "
+
+/* 難易度調整を続けて送るときの間隔(TCPで1つに繋がらないように) */
+#define GM_TUNE_GAP_US SIM_MS(100)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+struct SimGameResult
+{
+    int iTeam;
+    int iDifficulty;
+    int iZone;
+    std::string name;
+    int iRed, iBlue, iGreen, iHp, iRemaining;
+    uint64_t ullStartUs;
+    uint64_t ullResultUs;
+    SimFloorGameStats xFloor;
+    schedJitter_t xSpawnJitter;
+    std::string trace; // POSTのtraceフィールド
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static SimGmConfig gxConfig;
+static uint32_t gulEntries = 0;
+static uint32_t gulRounds = 0;
+static bool gbEntryPending = false;
+static uint64_t gullGameStartUs = 0;
+static std::vector<SimGameResult> gResults;
+static std::string gRecBuf;       // 受信中の記録
+static size_t gxRecRemain = 0;    // 記録の残りバイト数
+static bool gbRecDiag = false;     // 受信中のバイナリが診断ログ(esp_diag)
+static uint32_t gulRecordings = 0;
+static std::string gPanels;        // 最後に届いたパネルの死活(JSON)
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvConnect(void *pvArg);
+static void prvSendTune(void *pvArg);
+static void prvSendEntry(void *pvArg);
+static int prvFormInt(const char *pcPost, const char *pcKey);
+static void prvRecReceive(const char *pcData, size_t xLen);
+static void prvDiagCheck(void);
+static void prvCheckStop(void);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+void vSimGmStart(const SimGmConfig *pxConfig)
+{
+    gxConfig = *pxConfig;
+    vSimPostEvent((uint64_t)(gxConfig.dConnectMs * 1000.0), prvConnect, NULL);
+}
+
+uint32_t ulSimGmResults(void) { return (uint32_t)gResults.size(); }
+
+/*****************************************************************************/
+/**
+ * ESP32からの受信 (tcp_server_taskのsend)
+ *
+ * @param    pcData / iLen
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimGmOnServerSend(const char *pcData, int iLen)
+{
+    if (gxRecRemain > 0)
+    {
+        prvRecReceive(pcData, (size_t)iLen);
+        return;
+    }
+
+    std::string cmd(pcData, iLen);
+    if (cmd.compare(0, strlen(GM_CMD_REC), GM_CMD_REC) == 0)
+    {
+        // "esp_rec <bytes>\n" + バイナリ(以降のsendに分かれて届く)
+        size_t xNl = cmd.find('\n');
+        gxRecRemain = strtoul(cmd.c_str() + strlen(GM_CMD_REC), NULL, 10);
+        gbRecDiag = false;
+        gRecBuf.clear();
+        if (xNl != std::string::npos && xNl + 1 < cmd.size())
+            prvRecReceive(pcData + xNl + 1, cmd.size() - xNl - 1);
+    }
+    else if (cmd.compare(0, strlen(GM_CMD_DIAG), GM_CMD_DIAG) == 0)
+    {
+        // "esp_diag <bytes>\n" + バイナリ(esp_recと同じ受け方)
+        size_t xNl = cmd.find('\n');
+        gxRecRemain = strtoul(cmd.c_str() + strlen(GM_CMD_DIAG), NULL, 10);
+        gbRecDiag = true;
+        gRecBuf.clear();
+        if (xNl != std::string::npos && xNl + 1 < cmd.size())
+            prvRecReceive(pcData + xNl + 1, cmd.size() - xNl - 1);
+    }
+    else if (cmd == GM_CMD_WAIT)
+    {
+        if (!gbEntryPending && gulEntries < gxConfig.ulGames)
+        {
+            gbEntryPending = true;
+            vSimPostEvent(ullSimNowUs() + (uint64_t)(gxConfig.dEntryDelayMs * 1000.0),
+                          prvSendEntry, NULL);
+        }
+    }
+    else if (cmd == GM_CMD_GAME_START)
+    {
+        gullGameStartUs = ullSimNowUs();
+        vSimFloorBeginGame();
+    }
+    else if (cmd == GM_CMD_PLAYER_ENTRY)
+    {
+        ullSimCounter("gm.player entry")++;
+    }
+    else if (cmd == GM_CMD_TUNE_OK)
+    {
+        ullSimCounter("gm.tune accepted")++;
+    }
+    else if (cmd == GM_CMD_FAIL)
+    {
+        ullSimCounter("gm.bad command")++;
+    }
+    else if (cmd.compare(0, strlen(GM_CMD_PANELS), GM_CMD_PANELS) == 0)
+    {
+        ullSimCounter("gm.panel reports")++;
+        gPanels = cmd.substr(strlen(GM_CMD_PANELS));
+        if (cmd.back() != '}')
+            ullSimCounter("gm.panel reports truncated")++;
+    }
+    else if (cmd.compare(0, strlen(GM_CMD_TRACE), GM_CMD_TRACE) == 0)
+    {
+        ullSimCounter("gm.trace messages")++;
+        if (cmd.back() != '}')
+            ullSimCounter("gm.trace messages truncated")++;
+    }
+    else
+    {
+        ullSimCounter("gm.unknown message")++;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * Webserver(POST /result)
+ * 規定ゲーム数の結果が揃ったらシミュレーションを終了する。
+ * 同時に遊ぶときは区画(zone)毎に届く。
+ *
+ * @param    pcPostData: "team=..&difficulty=..&..."
+ *
+ * @return   ##
+ *
+ * @note     http_client_taskのコンテキストで呼ばれる
+ *
+ ******************************************************************************/
+void vSimGmOnResult(const char *pcPostData)
+{
+    SimGameResult xResult;
+    xResult.iTeam = prvFormInt(pcPostData, "team");
+    xResult.iDifficulty = prvFormInt(pcPostData, "difficulty");
+    xResult.iZone = prvFormInt(pcPostData, "zone");
+    xResult.iRed = prvFormInt(pcPostData, "redPoint");
+    xResult.iBlue = prvFormInt(pcPostData, "bluePoint");
+    xResult.iGreen = prvFormInt(pcPostData, "greenPoint");
+    xResult.iHp = prvFormInt(pcPostData, "hitPoint");
+    xResult.iRemaining = prvFormInt(pcPostData, "remainingTime");
+    const char *pcTrace = strstr(pcPostData, "&trace=");
+    if (pcTrace != NULL)
+    {
+        pcTrace += strlen("&trace=");
+        xResult.trace.assign(pcTrace, strcspn(pcTrace, "&"));
+    }
+    const char *pcName = strstr(pcPostData, "name=");
+    if (pcName != NULL)
+    {
+        pcName += strlen("name=");
+        xResult.name.assign(pcName, strcspn(pcName, "&"));
+    }
+    xResult.ullStartUs = gullGameStartUs;
+    xResult.ullResultUs = ullSimNowUs();
+    xResult.xFloor = xSimFloorTakeGameStats((uint32_t)xResult.iZone);
+    vCtrlSchedGetJitter(SCHED_EV_SPAWN, &xResult.xSpawnJitter);
+    gResults.push_back(xResult);
+
+    if (bSimReplayEnabled())
+    {
+        int iVerdict = iSimReplayCheck(xResult.iZone, xResult.iRed, xResult.iGreen,
+                                       xResult.iBlue, xResult.iHp, xResult.iRemaining);
+        if (gResults.size() >= gxConfig.ulGames)
+            vSimStop(iVerdict);
+        return;
+    }
+    prvCheckStop();
+}
+
+void vSimGmReport(FILE *pxOut)
+{
+    fprintf(pxOut, "--- games ---\n");
+    fprintf(pxOut,
+            "%-3s %-8s %4s %4s %4s %4s %4s %3s %5s %2s | %6s %6s %6s %6s %6s | "
+            "%8s %15s\n",
+            "#", "name", "team", "dif", "R", "G", "B", "hp", "rem", "z", "spawn",
+            "drop", "stomp", "tout", "skip", "start[s]", "jitter mean/max");
+    int i = 1;
+    for (const SimGameResult &r : gResults)
+    {
+        fprintf(pxOut,
+                "%-3d %-8s %4d %4d %4d %4d %4d %3d %5d %2d | %6u %6u %6u %6u %6u | "
+                "%8.3f %6.3f/%6.3fms\n",
+                i++, r.name.c_str(), r.iTeam, r.iDifficulty, r.iRed, r.iGreen,
+                r.iBlue, r.iHp, r.iRemaining, r.iZone, r.xFloor.ulSpawns,
+                r.xFloor.ulSpawnDropped, r.xFloor.ulStomps,
+                r.xFloor.ulTimeouts, r.xFloor.ulSkipped, r.ullStartUs / 1e6,
+                r.xSpawnJitter.ulCount
+                    ? r.xSpawnJitter.llSumUs / 1e3 / r.xSpawnJitter.ulCount
+                    : 0.0,
+                r.xSpawnJitter.llMaxUs / 1e3);
+    }
+
+    // traceフィールド: 区間名:件数:平均us:最大us:ビン0.ビン1...|...
+    fprintf(pxOut, "--- firmware trace per game (POST trace) [ms] ---\n");
+    fprintf(pxOut, "%-3s %-10s %6s %9s %9s  %s\n", "#", "stage", "n", "mean",
+            "max", "hist <1,<2,<4..<1024,>=1024");
+    i = 1;
+    for (const SimGameResult &r : gResults)
+    {
+        size_t xPos = 0;
+        while (xPos < r.trace.size())
+        {
+            size_t xEnd = r.trace.find('|', xPos);
+            if (xEnd == std::string::npos)
+                xEnd = r.trace.size();
+            std::string stage = r.trace.substr(xPos, xEnd - xPos);
+            char cName[16] = {};
+            unsigned uN = 0, uMean = 0, uMax = 0;
+            int iUsed = 0;
+            if (sscanf(stage.c_str(), "%15[^:]:%u:%u:%u:%n", cName, &uN, &uMean,
+                       &uMax, &iUsed) == 4)
+            {
+                fprintf(pxOut, "%-3d %-10s %6u %9.3f %9.3f  %s\n", i, cName,
+                        uN, uMean / 1e3, uMax / 1e3, stage.c_str() + iUsed);
+            }
+            xPos = xEnd + 1;
+        }
+        i++;
+    }
+
+    fprintf(pxOut, "--- last panel report (esp_panels) ---\n%s\n",
+            gPanels.empty() ? "(none)" : gPanels.c_str());
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static void prvConnect(void *pvArg)
+{
+    (void)pvArg;
+    vSimNetClientConnect();
+
+    // 難易度調整(gamemng.pyのTuneボタン相当)
+    prvSendTune((void *)(uintptr_t)0);
+}
+
+/* 難易度調整をcTuneJson[n]から順に1つずつ送る */
+static void prvSendTune(void *pvArg)
+{
+    uintptr_t uxIdx = (uintptr_t)pvArg;
+    if (uxIdx >= SIM_GM_PLAYER_MAX || gxConfig.cTuneJson[uxIdx][0] == '\0')
+        return;
+    vSimNetClientSend(gxConfig.cTuneJson[uxIdx], (int)strlen(gxConfig.cTuneJson[uxIdx]));
+    vSimPostEvent(ullSimNowUs() + GM_TUNE_GAP_US, prvSendTune, (void *)(uxIdx + 1));
+}
+
+/*****************************************************************************/
+/**
+ * エントリー送信 (gamemng.pyと同じJSON)
+ * 1人はオブジェクト、2人以上は配列(並びが区画の番号)で送る。
+ *
+ * @param    pvArgは未使用
+ *
+ * @return   ##
+ *
+ * @note     残りゲーム数が人数より少なければ残りの人数で遊ぶ
+ *
+ ******************************************************************************/
+static void prvSendEntry(void *pvArg)
+{
+    (void)pvArg;
+    char cJson[512];
+    int iTeam[SIM_GM_PLAYER_MAX];
+    uint32_t ulPlayers = gxConfig.ulPlayers;
+    int iLen = 0;
+
+    if (ulPlayers > gxConfig.ulGames - gulEntries)
+        ulPlayers = gxConfig.ulGames - gulEntries;
+    if (ulPlayers > 1)
+        cJson[iLen++] = '[';
+    for (uint32_t i = 0; i < ulPlayers; i++)
+    {
+        int iDifficulty = gxConfig.iEntryDifficulty[i] != 0 ? gxConfig.iEntryDifficulty[i]
+                          : gxConfig.iDifficulty != 0       ? gxConfig.iDifficulty
+                                                            : (int)(gulEntries % 4) + 1;
+        iTeam[i] = gxConfig.iEntryTeam[i] != 0 ? gxConfig.iEntryTeam[i]
+                   : gxConfig.iTeam != 0       ? gxConfig.iTeam
+                                               : (int)(gulEntries % 3) + 1;
+        gulEntries++;
+        iLen += snprintf(cJson + iLen, sizeof(cJson) - iLen,
+                         "%s{\"startFlag\":true,\"name\":\"sim%02u\",\"team\":%d,"
+                         "\"difficulty\":%d}",
+                         i == 0 ? "" : ",", gulEntries, iTeam[i], iDifficulty);
+    }
+    if (ulPlayers > 1)
+        iLen += snprintf(cJson + iLen, sizeof(cJson) - iLen, "]");
+    gulRounds++;
+    gbEntryPending = false;
+
+    vSimFloorEntry(iTeam, ulPlayers);
+    vSimNetClientSend(cJson, iLen);
+}
+
+/*****************************************************************************/
+/**
+ * 記録(esp_rec)の受信
+ * 揃ったら<cRecOut><n>.tbrecへ保存する。
+ *
+ * @param    pcData / xLen
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvRecReceive(const char *pcData, size_t xLen)
+{
+    size_t xTake = xLen < gxRecRemain ? xLen : gxRecRemain;
+    gRecBuf.append(pcData, xTake);
+    gxRecRemain -= xTake;
+    if (xTake < xLen)
+        ullSimCounter("gm.recording overrun bytes") += xLen - xTake;
+    if (gxRecRemain > 0)
+        return;
+    if (gbRecDiag)
+    {
+        prvDiagCheck();
+        gRecBuf.clear();
+        return;
+    }
+
+    gulRecordings++;
+    ullSimCounter("gm.recordings")++;
+    if (gxConfig.cRecOut[0] != '\0')
+    {
+        std::string path =
+            std::string(gxConfig.cRecOut) + std::to_string(gulRecordings) + ".tbrec";
+        if (!bSimRecSave(path.c_str(), gRecBuf.data(), gRecBuf.size()))
+            ullSimCounter("gm.recording save failed")++;
+    }
+    gRecBuf.clear();
+    prvCheckStop();
+}
+
+/*****************************************************************************/
+/**
+ * 診断ログ(esp_diag)の確認
+ * 形式を確かめて記録数を数える(文字列にするのはgamemng.py)。
+ * --rec-out指定時は<cRecOut><n>.tbdiagへ保存する。
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvDiagCheck(void)
+{
+    diagHeader_t xHeader;
+    const diagEvent_t *pxEvent;
+
+    uint64_t ullDumps = ++ullSimCounter("gm.diag dumps");
+
+    if (gxConfig.cRecOut[0] != '\0')
+    {
+        std::string path =
+            std::string(gxConfig.cRecOut) + std::to_string(ullDumps) + ".tbdiag";
+        if (!bSimRecSave(path.c_str(), gRecBuf.data(), gRecBuf.size()))
+            ullSimCounter("gm.recording save failed")++;
+    }
+    if (gRecBuf.size() < sizeof(xHeader))
+    {
+        ullSimCounter("gm.diag malformed")++;
+        return;
+    }
+    memcpy(&xHeader, gRecBuf.data(), sizeof(xHeader));
+    if (memcmp(xHeader.cMagic, DIAG_MAGIC, sizeof(xHeader.cMagic)) != 0 ||
+        xHeader.usEventSize != sizeof(diagEvent_t) ||
+        gRecBuf.size() != sizeof(xHeader) + xHeader.ulCount * sizeof(diagEvent_t))
+    {
+        ullSimCounter("gm.diag malformed")++;
+        return;
+    }
+    ullSimCounter("gm.diag events") += xHeader.ulCount;
+    ullSimCounter("gm.diag dropped") += xHeader.ulDropped;
+    pxEvent = (const diagEvent_t *)(gRecBuf.data() + sizeof(xHeader));
+    for (uint32_t i = 0; i < xHeader.ulCount; i++)
+    {
+        if (pxEvent[i].bCode == 0 || pxEvent[i].bCode >= MAX_DIAG_CODE)
+            ullSimCounter("gm.diag unknown code")++;
+    }
+}
+
+/* 規定ゲーム数の結果(とラウンド毎の記録)が揃ったら終了(生成数が下限未満のゲームがあれば失敗) */
+static void prvCheckStop(void)
+{
+    if (gResults.size() < gxConfig.ulGames)
+        return;
+    if (gxConfig.cRecOut[0] != '\0' && gulRecordings < gulRounds)
+        return;
+    for (const SimGameResult &r : gResults)
+    {
+        if (r.xFloor.ulSpawns < gxConfig.ulMinSpawns)
+        {
+            fprintf(stderr, "sim: %s spawned %u < %u (zone %d)\n", r.name.c_str(),
+                    r.xFloor.ulSpawns, gxConfig.ulMinSpawns, r.iZone);
+            vSimStop(SIM_EXIT_SPAWN_SHORT);
+        }
+    }
+    vSimStop(0);
+}
+
+static int prvFormInt(const char *pcPost, const char *pcKey)
+{
+    std::string key = std::string(pcKey) + "=";
+    const char *pcHit = pcPost;
+    while ((pcHit = strstr(pcHit, key.c_str())) != NULL)
+    {
+        if (pcHit == pcPost || pcHit[-1] == '&')
+            return atoi(pcHit + key.size());
+        pcHit += key.size();
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************/
+/**
+ * @file sim_gm.h
+ * @comments Virtual Arena GameManagement(gamemng.py) / Webserverのモデル
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_GM_H
+#define SIM_GM_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_GM_PLAYER_MAX 3 // 1ラウンドのエントリー数の上限(configZONE_MAX)
+#define SIM_EXIT_SPAWN_SHORT 8 // 生成数がulMinSpawnsに届かないゲームがあった
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+struct SimGmConfig
+{
+    uint32_t ulGames = 3;        // ゲーム(エントリー)の総数
+    uint32_t ulPlayers = 1;      // 1ラウンドで同時に遊ぶ人数(JSON配列で送る)
+    int iDifficulty = 0;         // 1..4, 0:毎ゲーム切り替え
+    int iTeam = 0;               // 1..3, 0:毎ゲーム切り替え
+    int iEntryTeam[SIM_GM_PLAYER_MAX] = {};       // 人毎の指定(0:iTeamに従う)
+    int iEntryDifficulty[SIM_GM_PLAYER_MAX] = {}; // 人毎の指定(0:iDifficultyに従う)
+    double dConnectMs = 5000;    // 起動からGMがTCP接続するまで
+    double dEntryDelayMs = 3000; // "esp_wait"受信からエントリー送信まで
+    char cTuneJson[SIM_GM_PLAYER_MAX][160] = {}; // 接続直後に送る難易度調整(空:送らない)
+    char cRecOut[128] = {};      // 記録の保存先(<prefix><n>.tbrec、空:保存しない)
+    uint32_t ulMinSpawns = 0;    // 1ゲームの生成数の下限(0:見ない、make testの生成停止検出)
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vSimGmStart(const SimGmConfig *pxConfig);
+uint32_t ulSimGmResults(void);
+void vSimGmReport(FILE *pxOut);
+
+#endif
@@ -0,0 +1,69 @@
+/*****************************************************************************/
+/**
+ * @file sim_hw.h
+ * @comments Virtual Arena ハードウェアモデル間のインタフェース
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_HW_H
+#define SIM_HW_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "driver/can.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_CAN_MASTER_NODE 0 // Master(ESP32)のノード番号
+#define SIM_CAN_BIT_US 2      // 500kbps
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * バス上のフレーム
+ * ullOriginUs: 計測用の起点時刻(生成元キューへの投入時刻、踏んだ時刻など)
+ */
+struct SimCanFrame
+{
+    can_message_t msg;
+    uint64_t ullOriginUs;
+    int iSrcNode;
+};
+
+typedef void (*SimCanRxHook_t)(const SimCanFrame *pxFrame);
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+/* sim_can.cpp: TWAIドライバ + バス(vcan.h) */
+void vSimCanSetPanelRxHook(SimCanRxHook_t pxHook);
+void vSimCanPanelSubmit(const SimCanFrame *pxFrame);
+void vSimCanFaultConfig(double dErrProb, const uint64_t *pullBusOffUs, uint32_t ulBusOffNum,
+                        uint64_t ullSeed);
+void vSimCanReport(FILE *pxOut);
+
+/* sim_periph.cpp: Arduino / DFPlayer / I2C(HPDLTB) */
+void vSimPeriphSeed(uint64_t ullSeed);
+void vSimPeriphReport(FILE *pxOut);
+
+/* sim_net.cpp: Wi-Fi / ソケット / HTTPクライアント */
+void vSimNetClientConnect(void);
+void vSimNetClientSend(const char *pcData, int iLen);
+
+/* sim_floor.cpp / sim_gm.cpp からの通知 (詳細はsim_floor.h, sim_gm.h) */
+void vSimFloorOnSound(int iSound);
+void vSimGmOnServerSend(const char *pcData, int iLen);
+void vSimGmOnResult(const char *pcPostData);
+
+#endif
@@ -0,0 +1,373 @@
+/*****************************************************************************/
+/**
+ * @file sim_main.cpp
+ * @comments Virtual Arena メイン
+ *           Master_v2のファームウェアをホスト上で25枚の仮想パネルと共に動かす
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "sim_core.h"
+#include "sim_floor.h"
+#include "sim_gm.h"
+#include "sim_hw.h"
+#include "sim_replay.h"
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_BUS_OFF_MAX 8 // --bus-off の指定数
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+/* ファームウェア側のQueue (統計表示用に名前を付ける、Ringはutil_ringの登録を使う) */
+extern QueueHandle_t xPlayerInfoQueue;
+extern "C" QueueHandle_t xGamemngTxQueue;
+extern "C" QueueHandle_t xHttpPostQueue;
+
+extern "C" void app_main();
+
+static SimFloorConfig gxFloorConfig;
+static SimGmConfig gxGmConfig;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvMainTask(void *pvParameters);
+static void prvReport(int iCode);
+static void prvUsage(const char *pcProg);
+static bool prvParseTune(const char *pcVal, char *pcJson, size_t xSize);
+static bool prvParseMaskAt(const char *pcVal, uint32_t *pulMask, double *pdAtS);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+int main(int argc, char **argv)
+{
+    uint64_t ullSeed = 1;
+    const char *pcReplay = NULL;
+    double dTimeLimitS = 0.0;
+    int iLogLevel = ESP_LOG_WARN;
+    double dCanErrProb = 0.0;
+    uint64_t ullBusOffUs[SIM_BUS_OFF_MAX];
+    uint32_t ulBusOffNum = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *pcArg = argv[i];
+        const char *pcVal = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool bUsed = true;
+
+        if (strcmp(pcArg, "-v") == 0)
+        {
+            iLogLevel = ESP_LOG_INFO;
+            bUsed = false;
+        }
+        else if (strcmp(pcArg, "-vv") == 0)
+        {
+            iLogLevel = ESP_LOG_DEBUG;
+            bUsed = false;
+        }
+        else if (strcmp(pcArg, "-h") == 0 || strcmp(pcArg, "--help") == 0)
+        {
+            prvUsage(argv[0]);
+            return 0;
+        }
+        else if (pcVal == NULL)
+        {
+            prvUsage(argv[0]);
+            return 1;
+        }
+        else if (strcmp(pcArg, "--games") == 0)
+            gxGmConfig.ulGames = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--players") == 0)
+            gxGmConfig.ulPlayers = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--seed") == 0)
+            ullSeed = strtoull(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--difficulty") == 0)
+            gxGmConfig.iDifficulty = strcmp(pcVal, "cycle") == 0 ? 0 : atoi(pcVal);
+        else if (strcmp(pcArg, "--team") == 0)
+            gxGmConfig.iTeam = strcmp(pcVal, "cycle") == 0 ? 0 : atoi(pcVal);
+        else if (strcmp(pcArg, "--connect-ms") == 0)
+            gxGmConfig.dConnectMs = atof(pcVal);
+        else if (strcmp(pcArg, "--entry-ms") == 0)
+            gxGmConfig.dEntryDelayMs = atof(pcVal);
+        else if (strcmp(pcArg, "--tune") == 0)
+        {
+            if (!prvParseTune(pcVal, gxGmConfig.cTuneJson[0],
+                              sizeof(gxGmConfig.cTuneJson[0])))
+            {
+                fprintf(stderr, "bad tune: %s\n", pcVal);
+                return 1;
+            }
+        }
+        else if (strcmp(pcArg, "--rec-out") == 0)
+            snprintf(gxGmConfig.cRecOut, sizeof(gxGmConfig.cRecOut), "%s", pcVal);
+        else if (strcmp(pcArg, "--replay") == 0)
+            pcReplay = pcVal;
+        else if (strcmp(pcArg, "--min-spawns") == 0)
+            gxGmConfig.ulMinSpawns = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--rt") == 0)
+        {
+            if (!bSimDistParse(pcVal, &gxFloorConfig.xReaction))
+            {
+                fprintf(stderr, "bad distribution: %s\n", pcVal);
+                return 1;
+            }
+        }
+        else if (strcmp(pcArg, "--move-ms") == 0)
+            gxFloorConfig.dMoveMs = atof(pcVal);
+        else if (strcmp(pcArg, "--step-ms") == 0)
+            gxFloorConfig.dStepMs = atof(pcVal);
+        else if (strcmp(pcArg, "--miss") == 0)
+            gxFloorConfig.dMissProb = atof(pcVal);
+        else if (strcmp(pcArg, "--avoid") == 0)
+            gxFloorConfig.dAvoidProb = atof(pcVal);
+        else if (strcmp(pcArg, "--start-ms") == 0)
+            gxFloorConfig.dStartDelayMs = atof(pcVal);
+        else if (strcmp(pcArg, "--dup") == 0)
+            gxFloorConfig.dDupProb = atof(pcVal);
+        else if (strcmp(pcArg, "--lose") == 0)
+            gxFloorConfig.dLoseProb = atof(pcVal);
+        else if (strcmp(pcArg, "--panel-rx-ms") == 0)
+            gxFloorConfig.dPanelRxMs = atof(pcVal);
+        else if (strcmp(pcArg, "--panel-tx-ms") == 0)
+            gxFloorConfig.dPanelTxMs = atof(pcVal);
+        else if (strcmp(pcArg, "--panel-skew-ppm") == 0)
+            gxFloorConfig.dPanelSkewPpm = atof(pcVal);
+        else if (strcmp(pcArg, "--panel-isr-jitter-us") == 0)
+            gxFloorConfig.dPanelIsrJitterUs = atof(pcVal);
+        else if (strcmp(pcArg, "--can-err") == 0)
+            dCanErrProb = atof(pcVal);
+        else if (strcmp(pcArg, "--bus-off") == 0)
+        {
+            // SEC[,SEC...]
+            for (const char *pc = pcVal; *pc != '\0' && ulBusOffNum < SIM_BUS_OFF_MAX;)
+            {
+                char *pcEnd;
+                ullBusOffUs[ulBusOffNum++] = (uint64_t)(strtod(pc, &pcEnd) * 1e6);
+                pc = *pcEnd == ',' ? pcEnd + 1 : pcEnd;
+                if (pcEnd == pc)
+                    break;
+            }
+        }
+        else if (strcmp(pcArg, "--v1-panels") == 0)
+            gxFloorConfig.ulV1PanelMask = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--anim-panels") == 0)
+            gxFloorConfig.ulAnimPanelMask = (uint32_t)strtoul(pcVal, NULL, 0);
+        else if (strcmp(pcArg, "--dead-panels") == 0)
+        {
+            if (!prvParseMaskAt(pcVal, &gxFloorConfig.ulDeadPanelMask,
+                                &gxFloorConfig.dDeadAtS))
+            {
+                fprintf(stderr, "bad panels: %s\n", pcVal);
+                return 1;
+            }
+        }
+        else if (strcmp(pcArg, "--stuck-panels") == 0)
+        {
+            if (!prvParseMaskAt(pcVal, &gxFloorConfig.ulStuckPanelMask,
+                                &gxFloorConfig.dStuckAtS))
+            {
+                fprintf(stderr, "bad panels: %s\n", pcVal);
+                return 1;
+            }
+        }
+        else if (strcmp(pcArg, "--time-limit") == 0)
+            dTimeLimitS = atof(pcVal);
+        else
+        {
+            prvUsage(argv[0]);
+            return 1;
+        }
+        if (bUsed)
+            i++;
+    }
+
+    // 再生: ゲーム数/チーム/難易度/プロファイルは記録から
+    if (pcReplay != NULL &&
+        !bSimReplayLoad(pcReplay, &gxGmConfig, &gxFloorConfig))
+    {
+        return 1;
+    }
+    if (gxGmConfig.ulGames == 0 || gxGmConfig.ulPlayers == 0 ||
+        gxGmConfig.ulPlayers > SIM_GM_PLAYER_MAX ||
+        gxGmConfig.iDifficulty < 0 || gxGmConfig.iDifficulty > 4 ||
+        gxGmConfig.iTeam < 0 || gxGmConfig.iTeam > 3)
+    {
+        prvUsage(argv[0]);
+        return 1;
+    }
+    if (dTimeLimitS <= 0.0)
+        dTimeLimitS = 120.0 * gxGmConfig.ulGames + 60.0;
+
+    gxFloorConfig.ullSeed = ullSeed;
+    vSimPeriphSeed(ullSeed);
+    vSimSetLogLevel(iLogLevel);
+    vSimSetTimeLimit((uint64_t)(dTimeLimitS * 1e6));
+    vSimSetStopHook(prvReport);
+    vSimFloorInit(&gxFloorConfig);
+    vSimCanFaultConfig(dCanErrProb, ullBusOffUs, ulBusOffNum, ullSeed);
+    vSimGmStart(&gxGmConfig);
+
+    vSimStart(prvMainTask);
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * mainタスク (ESP-IDFのmain_task相当)
+ *
+ * @param    pvParametersはNULLです。
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvMainTask(void *pvParameters)
+{
+    (void)pvParameters;
+    app_main();
+
+    vQueueAddToRegistry(xPlayerInfoQueue, "xPlayerInfoQueue");
+    vQueueAddToRegistry(xGamemngTxQueue, "xGamemngTxQueue");
+    vQueueAddToRegistry(xHttpPostQueue, "xHttpPostQueue");
+
+    vTaskDelete(NULL);
+}
+
+static void prvReport(int iCode)
+{
+    FILE *pxOut = stdout;
+    fprintf(pxOut, "=== trinitybullet virtual arena: t=%.3fs exit=%d ===\n",
+            ullSimNowUs() / 1e6, iCode);
+    vSimGmReport(pxOut);
+    vSimReplayReport(pxOut);
+    vSimFloorReport(pxOut);
+    vSimStatsReport(pxOut);
+    vSimQueueReport(pxOut);
+    vSimRingReport(pxOut);
+    vSimCanReport(pxOut);
+    vSimPeriphReport(pxOut);
+}
+
+static void prvUsage(const char *pcProg)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --games N            ゲーム数 (default 3)\n"
+            "  --players 1-3        同時に遊ぶ人数 (区画に分ける, default 1)\n"
+            "  --seed S             乱数シード (default 1)\n"
+            "  --difficulty 1-4|cycle\n"
+            "  --team 1-3|cycle\n"
+            "  --connect-ms MS      起動 -> GMのTCP接続 (default 5000)\n"
+            "  --entry-ms MS        esp_wait -> エントリー送信 (default 3000)\n"
+            "  --tune D:SPAWN,LIGHT,PCT,HS,HSAME,HW\n"
+            "                       接続直後に難易度Dのプロファイルを上書き\n"
+            "                       (ms, ms, %%, 体力増減 強/同/弱)\n"
+            "  --rec-out PREFIX     Masterの記録をPREFIX<n>.tbrecへ保存\n"
+            "  --replay FILE        記録を再生して結果を照合 (不一致: exit 7)\n"
+            "  --min-spawns N       生成数がN未満のゲームがあれば exit 8 (default 0: 見ない)\n"
+            "  --rt DIST:A[,B]      反応時間 fixed|uniform|normal|lognormal|exp"
+            " (default normal:450,120)\n"
+            "  --move-ms MS         踏んだ後の移動時間 (default 250)\n"
+            "  --step-ms MS         1マス移動する時間 (default 0: 位置を考えない)\n"
+            "  --miss P             見逃し確率 (default 0.05)\n"
+            "  --avoid P            弱点色を避ける確率 (default 0.5)\n"
+            "  --start-ms MS        スタートSWを踏むまで (default 1500)\n"
+            "  --dup P              踏んだフレームを重複送信する確率 (default 0)\n"
+            "  --lose P             パネルの受信、パネル -> Masterのフレームを失う確率 (default 0)\n"
+            "  --panel-rx-ms MS     パネル受信 -> 点灯 (default 8)\n"
+            "  --panel-tx-ms MS     踏む -> パネル送信 (default 3)\n"
+            "  --panel-skew-ppm PPM パネルの時計のずれ ±PPM (default 100)\n"
+            "  --panel-isr-jitter-us US\n"
+            "                       SYNCの受信割り込みの遅れ 0..US (default 20)\n"
+            "  --can-err P          フレーム毎のバスエラー確率 (再送, TEC/REC, default 0)\n"
+            "  --bus-off SEC[,SEC]  指定時刻にMasterのCANをバスオフにする\n"
+            "  --v1-panels MASK     旧ファームウェア(CANプロトコルv1)のパネル\n"
+            "                       (bit = PanelID, 0x3fffffe: 全部, default 0)\n"
+            "  --anim-panels MASK   アニメーション、LED毎の色(TBCAN_CMD_ANIM / PIXEL)を描けるパネル\n"
+            "                       (アニメーションは全部のときだけデモとカウントダウンに使う, default 0)\n"
+            "  --dead-panels MASK@SEC\n"
+            "                       SEC秒にパネルが止まる(受信も死活監視も止まる)\n"
+            "  --stuck-panels MASK@SEC\n"
+            "                       SEC秒からセンサが踏まれたままになる\n"
+            "  --time-limit SEC     仮想時間の上限\n"
+            "  -v / -vv             ファームウェアのログ(INFO / DEBUG)\n",
+            pcProg);
+}
+
+/*****************************************************************************/
+/**
+ * --tune D:SPAWN,LIGHT,PCT,HS,HSAME,HW をGMの難易度調整JSONへ
+ *
+ * @param    pcVal: 引数
+ * @param    pcJson / xSize: 格納先
+ *
+ * @return   true: 成功
+ *
+ * @note     範囲チェックはファームウェア側(Bad commandが返る)
+ *
+ ******************************************************************************/
+static bool prvParseTune(const char *pcVal, char *pcJson, size_t xSize)
+{
+    int iDfclt, iSpawn, iLight, iPct, iHs, iHsame, iHw;
+    if (sscanf(pcVal, "%d:%d,%d,%d,%d,%d,%d", &iDfclt, &iSpawn, &iLight, &iPct,
+               &iHs, &iHsame, &iHw) != 7)
+        return false;
+    int iLen = snprintf(pcJson, xSize,
+                        "{\"tune\":%d,\"spawnMs\":%d,\"lightMs\":%d,"
+                        "\"speedupPct\":%d,\"hpStrong\":%d,\"hpSame\":%d,"
+                        "\"hpWeak\":%d}",
+                        iDfclt, iSpawn, iLight, iPct, iHs, iHsame, iHw);
+    return iLen > 0 && (size_t)iLen < xSize;
+}
+
+/*****************************************************************************/
+/**
+ * --dead-panels / --stuck-panels MASK@SEC
+ *
+ * @param    pcVal: 引数
+ * @param    pulMask: パネル(bit = PanelID)
+ * @param    pdAtS: 時刻[s]
+ *
+ * @return   true: 成功
+ *
+ * @note     @SECを省くと起動時(0秒)
+ *
+ ******************************************************************************/
+static bool prvParseMaskAt(const char *pcVal, uint32_t *pulMask, double *pdAtS)
+{
+    char *pcEnd;
+    *pulMask = (uint32_t)strtoul(pcVal, &pcEnd, 0);
+    *pdAtS = 0.0;
+    if (pcEnd == pcVal)
+        return false;
+    if (*pcEnd == '@')
+        *pdAtS = strtod(pcEnd + 1, &pcEnd);
+    return *pcEnd == '\0' && *pdAtS >= 0.0;
+}
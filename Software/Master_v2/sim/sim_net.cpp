@@ -0,0 +1,450 @@
+/*****************************************************************************/
+/**
+ * @file sim_net.cpp
+ * @comments Virtual Arena ネットワークモデル(Wi-Fi, ソケット, HTTPクライアント)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_event_loop.h"
+#include "esp_http_client.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "tcpip_adapter.h"
+#include "lwip/sockets.h"
+
+#include "sim_core.h"
+#include "sim_hw.h"
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * GM(PC)とのTCP接続はメモリ上のバッファで模擬する。
+ * 接続は1本のみ(tcp_server_taskと同じ)。
+ */
+#define SIM_SOCK_LISTEN 50
+#define SIM_SOCK_CONN 51
+
+#define WIFI_START_DELAY_US SIM_MS(50)
+#define WIFI_ASSOC_DELAY_US SIM_MS(800)
+#define WIFI_GOT_IP_DELAY_US SIM_MS(10)
+#define WIFI_GOT_IP6_DELAY_US SIM_MS(1200)
+#define HTTP_POST_DELAY_US SIM_MS(20)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+struct SimHttpClient
+{
+    esp_http_client_config_t config;
+    std::string post;
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+// Wi-Fi
+static system_event_cb_t gpxEventCb = NULL;
+static void *gpvEventCtx = NULL;
+
+// Socket
+static bool gbListening = false;
+static bool gbClientConnected = false;
+static bool gbAccepted = false;
+static bool gbNonBlock = false;
+static std::string gRxBuf; // GM -> ESP
+static char gcAcceptObj;
+static char gcRecvObj;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvWifiEvent(void *pvArg);
+
+/*****************************************************************************/
+/* Public Function (GM側)
+******************************************************************************/
+void vSimNetClientConnect(void)
+{
+    vSimLock();
+    gbClientConnected = true;
+    uxSimWakeLocked(&gcAcceptObj, pdTRUE);
+    vSimUnlock();
+}
+
+void vSimNetClientSend(const char *pcData, int iLen)
+{
+    vSimLock();
+    gRxBuf.append(pcData, iLen);
+    uxSimWakeLocked(&gcRecvObj, pdTRUE);
+    vSimUnlock();
+}
+
+/*****************************************************************************/
+/* Public Function (Wi-Fi / NVS / TCPIP adapter)
+******************************************************************************/
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+void tcpip_adapter_init(void) {}
+
+esp_err_t tcpip_adapter_dhcpc_stop(tcpip_adapter_if_t tcpip_if)
+{
+    (void)tcpip_if;
+    return ESP_OK;
+}
+
+esp_err_t tcpip_adapter_set_ip_info(tcpip_adapter_if_t tcpip_if,
+                                    const tcpip_adapter_ip_info_t *ip_info)
+{
+    (void)tcpip_if;
+    (void)ip_info;
+    return ESP_OK;
+}
+
+esp_err_t tcpip_adapter_create_ip6_linklocal(tcpip_adapter_if_t tcpip_if)
+{
+    (void)tcpip_if;
+    vSimPostEvent(ullSimNowUs() + WIFI_GOT_IP6_DELAY_US, prvWifiEvent,
+                  (void *)(intptr_t)SYSTEM_EVENT_AP_STA_GOT_IP6);
+    return ESP_OK;
+}
+
+char *ip6addr_ntoa(const ip6_addr_t *addr)
+{
+    static char cBuf[48];
+    snprintf(cBuf, sizeof(cBuf), "FE80::%X:%X", addr->addr[2], addr->addr[3]);
+    return cBuf;
+}
+
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx)
+{
+    gpxEventCb = cb;
+    gpvEventCtx = ctx;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    (void)storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *conf)
+{
+    (void)interface;
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    vSimPostEvent(ullSimNowUs() + WIFI_START_DELAY_US, prvWifiEvent,
+                  (void *)(intptr_t)SYSTEM_EVENT_STA_START);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    vSimPostEvent(ullSimNowUs() + WIFI_ASSOC_DELAY_US, prvWifiEvent,
+                  (void *)(intptr_t)SYSTEM_EVENT_STA_CONNECTED);
+    vSimPostEvent(ullSimNowUs() + WIFI_ASSOC_DELAY_US + WIFI_GOT_IP_DELAY_US,
+                  prvWifiEvent, (void *)(intptr_t)SYSTEM_EVENT_STA_GOT_IP);
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/* Public Function (Socket)
+******************************************************************************/
+int lwip_socket(int domain, int type, int protocol)
+{
+    (void)domain;
+    (void)type;
+    (void)protocol;
+    return SIM_SOCK_LISTEN;
+}
+
+int lwip_bind(int s, const struct sockaddr *name, socklen_t namelen)
+{
+    (void)name;
+    (void)namelen;
+    return s == SIM_SOCK_LISTEN ? 0 : -1;
+}
+
+int lwip_listen(int s, int backlog)
+{
+    (void)backlog;
+    if (s != SIM_SOCK_LISTEN)
+        return -1;
+    gbListening = true;
+    return 0;
+}
+
+/*****************************************************************************/
+/**
+ * accept
+ * GMが接続するまでブロックする。
+ *
+ * @param    ##
+ *
+ * @return   接続ソケット
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen)
+{
+    if (s != SIM_SOCK_LISTEN || !gbListening)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    vSimLock();
+    while (!gbClientConnected)
+    {
+        xSimWaitLocked(&gcAcceptObj, SIM_WAIT_FOREVER);
+    }
+    gbAccepted = true;
+    gbNonBlock = false;
+    vSimUnlock();
+
+    if (addr != NULL && addrlen != NULL && *addrlen >= sizeof(sockaddr_in))
+    {
+        struct sockaddr_in *pxIn = (struct sockaddr_in *)addr;
+        memset(addr, 0, *addrlen);
+        pxIn->sin_family = AF_INET;
+        pxIn->sin_addr.s_addr = htonl(0xC0A80A02); // 192.168.10.2
+        pxIn->sin_port = htons(40000);
+    }
+    return SIM_SOCK_CONN;
+}
+
+int lwip_recv(int s, void *mem, size_t len, int flags)
+{
+    (void)flags;
+    if (s != SIM_SOCK_CONN || !gbAccepted)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    vSimLock();
+    while (gRxBuf.empty())
+    {
+        if (!gbClientConnected)
+        {
+            vSimUnlock();
+            return 0;
+        }
+        if (gbNonBlock)
+        {
+            vSimUnlock();
+            errno = EAGAIN;
+            return -1;
+        }
+        xSimWaitLocked(&gcRecvObj, SIM_WAIT_FOREVER);
+    }
+    size_t uxLen = gRxBuf.size() < len ? gRxBuf.size() : len;
+    memcpy(mem, gRxBuf.data(), uxLen);
+    gRxBuf.erase(0, uxLen);
+    vSimUnlock();
+    return (int)uxLen;
+}
+
+int lwip_send(int s, const void *dataptr, size_t size, int flags)
+{
+    (void)flags;
+    if (s != SIM_SOCK_CONN || !gbAccepted)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    vSimGmOnServerSend((const char *)dataptr, (int)size);
+    return (int)size;
+}
+
+int lwip_shutdown(int s, int how)
+{
+    (void)s;
+    (void)how;
+    return 0;
+}
+
+int lwip_close(int s)
+{
+    if (s == SIM_SOCK_CONN)
+        gbAccepted = false;
+    else if (s == SIM_SOCK_LISTEN)
+        gbListening = false;
+    return 0;
+}
+
+int lwip_fcntl(int s, int cmd, ...)
+{
+    va_list args;
+    va_start(args, cmd);
+    int iVal = (cmd == F_SETFL) ? va_arg(args, int) : 0;
+    va_end(args);
+
+    if (s != SIM_SOCK_CONN)
+        return -1;
+    if (cmd == F_GETFL)
+        return gbNonBlock ? O_NONBLOCK : 0;
+    if (cmd == F_SETFL)
+    {
+        gbNonBlock = (iVal & O_NONBLOCK) != 0;
+        return 0;
+    }
+    return -1;
+}
+
+char *lwip_sim_ntoa_r(const void *addr, char *buf, int buflen)
+{
+    uint32_t ulAddr;
+    memcpy(&ulAddr, addr, sizeof(ulAddr));
+    ulAddr = ntohl(ulAddr);
+    snprintf(buf, buflen, "%u.%u.%u.%u", (ulAddr >> 24) & 0xFF,
+             (ulAddr >> 16) & 0xFF, (ulAddr >> 8) & 0xFF, ulAddr & 0xFF);
+    return buf;
+}
+
+char *lwip_sim_ntoa6_r(const void *addr, char *buf, int buflen)
+{
+    (void)addr;
+    snprintf(buf, buflen, "::");
+    return buf;
+}
+
+/*****************************************************************************/
+/* Public Function (HTTP client)
+******************************************************************************/
+esp_http_client_handle_t
+esp_http_client_init(const esp_http_client_config_t *config)
+{
+    SimHttpClient *pxClient = new SimHttpClient();
+    pxClient->config = *config;
+    return pxClient;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client,
+                                  const char *url)
+{
+    (void)client;
+    (void)url;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client,
+                                     esp_http_client_method_t method)
+{
+    (void)client;
+    (void)method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client,
+                                         const char *data, int len)
+{
+    client->post.assign(data, len);
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * POST実行
+ * Webserverまでの往復時間だけブロックしてから、結果をGMモデルへ渡す。
+ *
+ * @param    client
+ *
+ * @return   ESP_OK
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    esp_http_client_event_t xEvt = {};
+    xEvt.client = client;
+    if (client->config.event_handler != NULL)
+    {
+        xEvt.event_id = HTTP_EVENT_ON_CONNECTED;
+        client->config.event_handler(&xEvt);
+    }
+    vSimDelayUs(HTTP_POST_DELAY_US);
+    vSimGmOnResult(client->post.c_str());
+    if (client->config.event_handler != NULL)
+    {
+        xEvt.event_id = HTTP_EVENT_ON_FINISH;
+        client->config.event_handler(&xEvt);
+    }
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    (void)client;
+    return 200;
+}
+
+int esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    (void)client;
+    return 0;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client)
+{
+    (void)client;
+    return false;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    delete client;
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static void prvWifiEvent(void *pvArg)
+{
+    system_event_t xEvent = {};
+    xEvent.event_id = (system_event_id_t)(intptr_t)pvArg;
+    if (xEvent.event_id == SYSTEM_EVENT_AP_STA_GOT_IP6)
+    {
+        xEvent.event_info.got_ip6.ip6_info.ip.addr[2] = 0x0200;
+        xEvent.event_info.got_ip6.ip6_info.ip.addr[3] = 0x0064;
+    }
+    if (gpxEventCb != NULL)
+        gpxEventCb(gpvEventCtx, &xEvent);
+}
@@ -0,0 +1,293 @@
+/*****************************************************************************/
+/**
+ * @file sim_periph.cpp
+ * @comments Virtual Arena 周辺機器モデル(Arduino, DFPlayer, I2C/HPDLTB)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <string.h>
+
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "Arduino.h"
+#include "DFRobotDFPlayerMini.h"
+#include "driver/i2c.h"
+#include "esp_spiffs.h"
+#include "esp_system.h"
+
+#include "sim_core.h"
+#include "sim_hw.h"
+#include "sim_replay.h"
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define DFPLAYER_FRAME_BYTES 10 // 7E FF 06 CMD ACK PH PL CH CL EF
+#define DFPLAYER_MAX_TRACK 8
+#define HPDLTB_ADDR 0x1E // 区画nの表示器は +n (drv_hpdltb.c)
+#define HPDLTB_NUM 3     // configZONE_MAX
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+// esp_random()用 xorshift64*
+static uint64_t gullRandState = 0x9E3779B97F4A7C15ULL;
+
+// DFPlayer
+static uint64_t gullPlayCount[DFPLAYER_MAX_TRACK + 1];
+static unsigned long gulDfpBaud = 9600;
+
+// I2C
+struct SimI2cCmd
+{
+    std::vector<uint8_t> bytes;
+    uint32_t ulStarts;
+};
+static uint32_t gulI2cClkHz = 100000;
+static uint8_t gbHpdltb[HPDLTB_NUM][4];
+static uint64_t gullHpdltbWrites[HPDLTB_NUM];
+
+/*****************************************************************************/
+/* Public Function (ESP-IDF / Arduino)
+******************************************************************************/
+void vSimPeriphSeed(uint64_t ullSeed)
+{
+    gullRandState = ullSeed ^ 0x9E3779B97F4A7C15ULL;
+    if (gullRandState == 0)
+        gullRandState = 1;
+}
+
+uint32_t esp_random(void)
+{
+    gullRandState ^= gullRandState >> 12;
+    gullRandState ^= gullRandState << 25;
+    gullRandState ^= gullRandState >> 27;
+    return (uint32_t)((gullRandState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+void initArduino(void) {}
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    (void)pin;
+    (void)val;
+}
+int digitalRead(uint8_t pin)
+{
+    (void)pin;
+    return LOW;
+}
+
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+unsigned long millis(void) { return (unsigned long)(ullSimNowUs() / 1000); }
+unsigned long micros(void) { return (unsigned long)ullSimNowUs(); }
+
+/* ESP32 Arduinoと同様にesp_random()を使う */
+long random(long howbig)
+{
+    if (howbig <= 0)
+        return 0;
+    return (long)(esp_random() % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    long lValue;
+    if (bSimReplayRandom(howsmall, howbig, &lValue))
+        return lValue;
+    if (howsmall >= howbig)
+        return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        vSimPeriphSeed(seed);
+}
+
+/*****************************************************************************/
+/* Public Function (SPIFFS)
+******************************************************************************/
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf)
+{
+    (void)conf;
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/* Public Function (DFPlayer)
+******************************************************************************/
+bool DFRobotDFPlayerMini::begin(Stream &stream, bool isACK, bool doReset)
+{
+    HardwareSerial *pxSerial = static_cast<HardwareSerial *>(&stream);
+    (void)isACK;
+    (void)doReset;
+    if (pxSerial->baudRate() != 0)
+        gulDfpBaud = pxSerial->baudRate();
+    return false;
+}
+
+void DFRobotDFPlayerMini::volume(uint8_t volume)
+{
+    _volume = volume;
+    sendStack();
+}
+
+/*****************************************************************************/
+/**
+ * 再生
+ * 10byteのコマンド送信時間(UART)だけ呼出元タスクをブロックする。
+ *
+ * @param    fileNumber: トラック番号(ePlaylist_t)
+ *
+ * @return   ##
+ *
+ * @note     踏んでから効果音が鳴るまでの遅延はsim_floorで計測する
+ *
+ ******************************************************************************/
+void DFRobotDFPlayerMini::play(int fileNumber)
+{
+    sendStack();
+    if (fileNumber >= 0 && fileNumber <= DFPLAYER_MAX_TRACK)
+        gullPlayCount[fileNumber]++;
+    vSimFloorOnSound(fileNumber);
+}
+
+void DFRobotDFPlayerMini::sendStack()
+{
+    // 8N1: 10bit/byte
+    vSimDelayUs((uint64_t)DFPLAYER_FRAME_BYTES * 10 * 1000000ULL / gulDfpBaud);
+}
+
+/*****************************************************************************/
+/* Public Function (I2C)
+******************************************************************************/
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    (void)i2c_num;
+    if (i2c_conf->mode == I2C_MODE_MASTER && i2c_conf->master.clk_speed > 0)
+        gulI2cClkHz = i2c_conf->master.clk_speed;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode,
+                             size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags)
+{
+    (void)i2c_num;
+    (void)mode;
+    (void)slv_rx_buf_len;
+    (void)slv_tx_buf_len;
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void) { return new SimI2cCmd(); }
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle) { delete cmd_handle; }
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    cmd_handle->ulStarts++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data,
+                                bool ack_en)
+{
+    (void)ack_en;
+    cmd_handle->bytes.push_back(data);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, uint8_t *data,
+                           size_t data_len, bool ack_en)
+{
+    (void)ack_en;
+    cmd_handle->bytes.insert(cmd_handle->bytes.end(), data, data + data_len);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    (void)cmd_handle;
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * コマンド実行
+ * (START + 9bit/byte + STOP) のクロック数だけブロックし、
+ * HPDLTB宛て(0x1E..)の4byteを表示器毎に表示内容として保持する。
+ *
+ * @param    ##
+ *
+ * @return   ESP_OK
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle,
+                               TickType_t ticks_to_wait)
+{
+    (void)i2c_num;
+    (void)ticks_to_wait;
+    uint64_t ullClocks = cmd_handle->ulStarts + cmd_handle->bytes.size() * 9 + 1;
+    vSimDelayUs(ullClocks * 1000000ULL / gulI2cClkHz);
+
+    int iDisp = (cmd_handle->bytes.empty() ? 0 : cmd_handle->bytes[0] >> 1) - HPDLTB_ADDR;
+    if (cmd_handle->bytes.size() == 5 && iDisp >= 0 && iDisp < HPDLTB_NUM)
+    {
+        memcpy(gbHpdltb[iDisp], &cmd_handle->bytes[1], sizeof(gbHpdltb[iDisp]));
+        gullHpdltbWrites[iDisp]++;
+    }
+    return ESP_OK;
+}
+
+void vSimPeriphReport(FILE *pxOut)
+{
+    static const char *const cpcSound[DFPLAYER_MAX_TRACK + 1] = {
+        "-",       "COUNTDOWN_1", "COUNTDOWN_2", "ENTRY", "PANEL",
+        "FINISH", "PINCH",       "DAMAGE",      "-"};
+    fprintf(pxOut, "--- peripherals ---\n");
+    for (int i = 1; i <= DFPLAYER_MAX_TRACK; i++)
+    {
+        if (gullPlayCount[i] == 0)
+            continue;
+        char cName[48];
+        snprintf(cName, sizeof(cName), "dfplayer SE_%s", cpcSound[i]);
+        fprintf(pxOut, "%-34s %10llu\n", cName,
+                (unsigned long long)gullPlayCount[i]);
+    }
+    for (int i = 0; i < HPDLTB_NUM; i++)
+    {
+        if (i > 0 && gullHpdltbWrites[i] == 0)
+            continue;
+        char cName[48];
+        snprintf(cName, sizeof(cName), i == 0 ? "hpdltb i2c writes" : "hpdltb%d i2c writes", i);
+        fprintf(pxOut, "%-34s %10llu (last: msg=%u hp=%u time=%u%u)\n", cName,
+                (unsigned long long)gullHpdltbWrites[i], gbHpdltb[i][0],
+                gbHpdltb[i][1], gbHpdltb[i][2], gbHpdltb[i][3]);
+    }
+}
@@ -0,0 +1,463 @@
+/*****************************************************************************/
+/**
+ * @file sim_replay.cpp
+ * @comments Virtual Arena レコーダ(util_rec)の記録の再生と照合
+ *
+ *           記録(.tbrec)のエントリーとプロファイルでGMを動かし、
+ *           パネルからの受信フレームを記録と同じ時刻(エントリー基準)に
+ *           バスへ流す。ゲームの進行を決める乱数(REC_RAND)は記録の値を返す。
+ *           ファームウェアのctrl_mainをそのまま通して、結果を記録と照合する。
+ *           同時に遊んだ記録はエントリー・結果が区画毎にあり、区画毎に照合する。
+ *           踏んだ時刻付きのフレーム(TBCAN_FLAG_TIME)はMasterの時刻を持つので、
+ *           記録の最初の時刻同期(REC_SYNC)で記録時の時計を求め、再生時の時計へずらす。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "ctrl_dfclt.h"
+#include "tb_canproto.h"
+#include "util_rec.h"
+
+#include "sim_core.h"
+#include "sim_hw.h"
+#include "sim_replay.h"
+#include "sim_stats.h"
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_CAN_BIT_US 2 // 500kbps
+#define SIM_REPLAY_DEAD_AT_S 1.0 // 全パネルの起動の報告(PanelID * 40ms)の後
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+struct SimRecRand
+{
+    long lValue;
+    long lMin;
+    long lMax;
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static bool gbLoaded = false;
+static const char *gpcPath = NULL;
+static recHeader_t gxHeader;
+static std::vector<recEvent_t> gRec;
+static std::deque<SimRecRand> gRand;
+static const recEvent_t *gpxRecResult[SIM_GM_PLAYER_MAX]; // 区画毎
+static uint32_t gulZoneNum = 0;
+
+static bool gbStarted = false;
+static bool gbRandActive = false;
+static uint32_t gulRandUsed = 0;
+static uint32_t gulRandMismatch = 0;
+static uint32_t gulRecCnt[MAX_REC_TYPE];
+static uint32_t gulRunCnt[MAX_REC_TYPE];
+static int giVerdict = -1; // -1:未照合 0:一致 SIM_EXIT_REPLAY_MISMATCH:不一致
+static bool gbChecked[SIM_GM_PLAYER_MAX];
+static int giResult[SIM_GM_PLAYER_MAX][5]; // 再生結果 R,G,B,HP,残り時間
+static bool gbRecClockKnown = false;
+static uint32_t gulRecOriginUs = 0;   // 記録のエントリー時のesp_timer(下位32bit)
+static uint64_t gullReplayOriginUs = 0; // 再生のエントリー時のesp_timer
+
+static const char *const cpcTypeName[MAX_REC_TYPE] = {
+    "", "entry", "game start", "can tx", "can rx", "tick", "hp",
+    "reject", "se", "display", "rand", "result", "live", "sync"};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvInjectRx(void *pvArg);
+static void prvShiftPressTick(const recEvent_t *pxEvent, can_message_t *pxMsg);
+static int16_t prvData16(const recEvent_t *pxEvent, int iIdx);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 記録の読み込み
+ *
+ * @param    pcPath: .tbrecファイル
+ * @param    pxGm: エントリー(チーム/難易度/プロファイル)を設定する
+ * @param    pxFloor: プレイヤーを止める(踏むのは記録)
+ *
+ * @return   true: 成功
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+bool bSimReplayLoad(const char *pcPath, SimGmConfig *pxGm, SimFloorConfig *pxFloor)
+{
+    FILE *pxIn = fopen(pcPath, "rb");
+    if (pxIn == NULL)
+    {
+        perror(pcPath);
+        return false;
+    }
+    bool bOk = fread(&gxHeader, sizeof(gxHeader), 1, pxIn) == 1 &&
+               memcmp(gxHeader.cMagic, REC_MAGIC, sizeof(gxHeader.cMagic)) == 0 &&
+               gxHeader.usVersion == REC_VERSION &&
+               gxHeader.usEventSize == sizeof(recEvent_t);
+    if (bOk)
+    {
+        gRec.resize(gxHeader.ulCount);
+        bOk = gxHeader.ulCount == 0 ||
+              fread(gRec.data(), sizeof(recEvent_t), gRec.size(), pxIn) == gRec.size();
+    }
+    fclose(pxIn);
+    if (!bOk)
+    {
+        fprintf(stderr, "%s: not a recording (version %d)\n", pcPath, REC_VERSION);
+        return false;
+    }
+    if (gxHeader.ulDropped != 0)
+    {
+        fprintf(stderr, "%s: %u events were overwritten, cannot replay\n", pcPath,
+                gxHeader.ulDropped);
+        return false;
+    }
+
+    const recEvent_t *pxEntry[SIM_GM_PLAYER_MAX] = {};
+    const recEvent_t *pxStart[SIM_GM_PLAYER_MAX] = {};
+    const recEvent_t *pxLive = NULL; // エントリー時のパネルの死活
+    for (const recEvent_t &xEvent : gRec)
+    {
+        if (xEvent.bType >= MAX_REC_TYPE)
+            continue;
+        gulRecCnt[xEvent.bType]++;
+        switch (xEvent.bType)
+        {
+        case REC_ENTRY:
+            if (xEvent.bData[0] < SIM_GM_PLAYER_MAX)
+                pxEntry[xEvent.bData[0]] = &xEvent;
+            break;
+        case REC_GAME_START:
+            if (xEvent.bId < SIM_GM_PLAYER_MAX)
+                pxStart[xEvent.bId] = &xEvent;
+            break;
+        case REC_RAND:
+        {
+            int32_t lValue;
+            memcpy(&lValue, xEvent.bData, sizeof(lValue));
+            gRand.push_back(SimRecRand{lValue, prvData16(&xEvent, 2),
+                                       prvData16(&xEvent, 3)});
+            break;
+        }
+        case REC_RESULT:
+            if (xEvent.bId < SIM_GM_PLAYER_MAX)
+                gpxRecResult[xEvent.bId] = &xEvent;
+            break;
+        case REC_LIVE:
+            if (pxLive == NULL)
+                pxLive = &xEvent;
+            break;
+        case REC_SYNC:
+            if (!gbRecClockKnown)
+            {
+                uint32_t ulDoneUs;
+                memcpy(&ulDoneUs, xEvent.bData, sizeof(ulDoneUs));
+                gulRecOriginUs = ulDoneUs - xEvent.ulTimeUs;
+                gbRecClockKnown = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    // 区画は0から詰めて使われる
+    while (gulZoneNum < SIM_GM_PLAYER_MAX && pxEntry[gulZoneNum] != NULL)
+        gulZoneNum++;
+    bool bComplete = gulZoneNum > 0;
+    for (uint32_t i = 0; i < gulZoneNum; i++)
+        bComplete = bComplete && gpxRecResult[i] != NULL;
+    if (!bComplete)
+    {
+        fprintf(stderr, "%s: no entry/result in recording\n", pcPath);
+        return false;
+    }
+
+    // 記録と同じエントリー、同じプロファイル(上書きされていた場合に備える)
+    pxGm->ulGames = gulZoneNum;
+    pxGm->ulPlayers = gulZoneNum;
+    for (uint32_t i = 0; i < gulZoneNum; i++)
+    {
+        pxGm->iEntryTeam[i] = pxEntry[i]->bId;
+        pxGm->iEntryDifficulty[i] = pxEntry[i]->usArg;
+        pxGm->cTuneJson[i][0] = '\0';
+        if (pxStart[i] != NULL)
+        {
+            dfcltProfile_t xProfile;
+            memcpy(&xProfile, pxStart[i]->bData, sizeof(xProfile));
+            snprintf(pxGm->cTuneJson[i], sizeof(pxGm->cTuneJson[i]),
+                     "{\"tune\":%d,\"spawnMs\":%u,\"lightMs\":%u,\"speedupPct\":%u,"
+                     "\"hpStrong\":%d,\"hpSame\":%d,\"hpWeak\":%d}",
+                     pxEntry[i]->usArg, xProfile.usSpawnMs, xProfile.usLightMs,
+                     xProfile.bSpeedUpPct, xProfile.cHpStrong, xProfile.cHpSame,
+                     xProfile.cHpWeak);
+        }
+    }
+    for (uint32_t i = gulZoneNum; i < SIM_GM_PLAYER_MAX; i++)
+        pxGm->cTuneJson[i][0] = '\0';
+    pxFloor->bReplay = true;
+
+    // エントリー時に途絶えていたパネルは起動の報告だけして止める
+    // (ゲーム中の死活監視のフレームは記録にあり、そのまま流す)
+    if (pxLive != NULL)
+    {
+        memcpy(&pxFloor->ulDeadPanelMask, &pxLive->bData[0], sizeof(uint32_t));
+        memcpy(&pxFloor->ulStuckPanelMask, &pxLive->bData[4], sizeof(uint32_t));
+        pxFloor->dDeadAtS = SIM_REPLAY_DEAD_AT_S;
+        pxFloor->dStuckAtS = 0.0;
+    }
+
+    gpcPath = pcPath;
+    gbLoaded = true;
+    return true;
+}
+
+bool bSimReplayEnabled(void) { return gbLoaded; }
+
+/*****************************************************************************/
+/**
+ * 乱数(Arduinoのrandom(min, max))を記録の値で置き換える
+ *
+ * @param    lMin / lMax: random()の引数
+ * @param    plValue: 返す値
+ *
+ * @return   true: 記録の値を使う
+ *
+ * @note     エントリー〜結果の間だけ(デモ点灯の乱数は置き換えない)
+ *
+ ******************************************************************************/
+bool bSimReplayRandom(long lMin, long lMax, long *plValue)
+{
+    if (!gbRandActive || gRand.empty())
+        return false;
+
+    SimRecRand xRand = gRand.front();
+    gRand.pop_front();
+    gulRandUsed++;
+    if (xRand.lMin != lMin || xRand.lMax != lMax || xRand.lValue < lMin ||
+        xRand.lValue >= lMax)
+    {
+        // 再生が記録と分岐した(空きパネル数が違う等)
+        gulRandMismatch++;
+        return false;
+    }
+    *plValue = xRand.lValue;
+    return true;
+}
+
+/*****************************************************************************/
+/**
+ * 再生結果(結果POST)と記録の照合
+ *
+ * @param    iZone: 区画(結果POSTのzone)
+ * @param    iRed .. iRemaining: 結果POSTの値
+ *
+ * @return   0:ここまで一致 / SIM_EXIT_REPLAY_MISMATCH
+ *
+ * @note     区画毎に呼ばれる。一度不一致になったら戻らない。
+ *
+ ******************************************************************************/
+int iSimReplayCheck(int iZone, int iRed, int iGreen, int iBlue, int iHp, int iRemaining)
+{
+    if (iZone < 0 || (uint32_t)iZone >= gulZoneNum || gbChecked[iZone])
+    {
+        giVerdict = SIM_EXIT_REPLAY_MISMATCH;
+        return giVerdict;
+    }
+    int *piResult = giResult[iZone];
+    const recEvent_t *pxRec = gpxRecResult[iZone];
+    gbChecked[iZone] = true;
+    piResult[0] = iRed;
+    piResult[1] = iGreen;
+    piResult[2] = iBlue;
+    piResult[3] = iHp;
+    piResult[4] = iRemaining;
+
+    bool bMatch = gulRandMismatch == 0 && giVerdict <= 0;
+    for (int i = 0; i < 4; i++)
+        bMatch = bMatch && piResult[i] == prvData16(pxRec, i);
+    bMatch = bMatch && iRemaining == (int16_t)pxRec->usArg;
+
+    giVerdict = bMatch ? 0 : SIM_EXIT_REPLAY_MISMATCH;
+    return giVerdict;
+}
+
+/*****************************************************************************/
+/**
+ * GMが受信した記録をファイルへ
+ *
+ * @param    pcPath: 出力先
+ * @param    pcData / xLen: recHeader_t + recEvent_t * n
+ *
+ * @return   true: 成功
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+bool bSimRecSave(const char *pcPath, const char *pcData, size_t xLen)
+{
+    FILE *pxOut = fopen(pcPath, "wb");
+    if (pxOut == NULL)
+    {
+        perror(pcPath);
+        return false;
+    }
+    bool bOk = fwrite(pcData, 1, xLen, pxOut) == xLen;
+    fclose(pxOut);
+    return bOk;
+}
+
+void vSimReplayReport(FILE *pxOut)
+{
+    if (!gbLoaded)
+        return;
+
+    fprintf(pxOut, "--- replay (%s, game %u) ---\n", gpcPath, gxHeader.ulGame);
+    fprintf(pxOut, "%-12s %10s %10s\n", "event", "recorded", "replayed");
+    for (int i = REC_ENTRY; i < MAX_REC_TYPE; i++)
+    {
+        fprintf(pxOut, "%-12s %10u %10u%s\n", cpcTypeName[i], gulRecCnt[i],
+                gulRunCnt[i], gulRecCnt[i] != gulRunCnt[i] ? "  *" : "");
+    }
+    fprintf(pxOut, "%-34s %10u\n", "random values used", gulRandUsed);
+    fprintf(pxOut, "%-34s %10u\n", "random values diverged", gulRandMismatch);
+    fprintf(pxOut, "%-12s %6s %6s %6s %6s %6s\n", "result", "R", "G", "B", "hp",
+            "rem");
+    for (uint32_t z = 0; z < gulZoneNum; z++)
+    {
+        const recEvent_t *pxRec = gpxRecResult[z];
+        char cLabel[16];
+        snprintf(cLabel, sizeof(cLabel), "recorded z%u", z);
+        fprintf(pxOut, "%-12s %6d %6d %6d %6d %6d\n", cLabel, prvData16(pxRec, 0),
+                prvData16(pxRec, 1), prvData16(pxRec, 2), prvData16(pxRec, 3),
+                (int16_t)pxRec->usArg);
+        snprintf(cLabel, sizeof(cLabel), "replayed z%u", z);
+        if (gbChecked[z])
+            fprintf(pxOut, "%-12s %6d %6d %6d %6d %6d\n", cLabel, giResult[z][0],
+                    giResult[z][1], giResult[z][2], giResult[z][3], giResult[z][4]);
+        else
+            fprintf(pxOut, "%-12s %6s\n", cLabel, "-");
+    }
+    fprintf(pxOut, "verdict: %s\n",
+            giVerdict == 0 ? "MATCH" : giVerdict < 0 ? "NOT FINISHED" : "MISMATCH");
+}
+
+/*****************************************************************************/
+/**
+ * ファームウェアのレコーダからの通知 (util_rec.h)
+ *
+ * @param    pxEvent: 記録したイベント
+ *
+ * @return   ##
+ *
+ * @note     ファームウェアのタスクから呼ばれる
+ *
+ ******************************************************************************/
+extern "C" void vSimRecOnEvent(const recEvent_t *pxEvent)
+{
+    ullSimCounter("rec.events")++;
+    if (!gbLoaded || pxEvent->bType >= MAX_REC_TYPE)
+        return;
+    gulRunCnt[pxEvent->bType]++;
+
+    if (pxEvent->bType == REC_ENTRY && !gbStarted)
+    {
+        // 記録と同じエントリー基準の時刻で受信フレームを流す
+        uint64_t ullOriginUs = ullSimNowUs() - pxEvent->ulTimeUs;
+        gullReplayOriginUs = ullOriginUs;
+        gbStarted = true;
+        gbRandActive = true;
+        for (const recEvent_t &xEvent : gRec)
+        {
+            if (xEvent.bType != REC_CAN_RX)
+                continue;
+            can_message_t xMsg = {};
+            xMsg.identifier = xEvent.usArg;
+            xMsg.data_length_code = xEvent.bId;
+            memcpy(xMsg.data, xEvent.bData, sizeof(xMsg.data));
+            // 記録は受信完了の時刻なので、フレーム長だけ前に送り始める
+            uint64_t ullFrameUs = (uint64_t)ulVcanFrameBits(&xMsg) * SIM_CAN_BIT_US;
+            uint64_t ullAtUs = ullOriginUs + xEvent.ulTimeUs;
+            vSimPostEvent(ullAtUs > ullFrameUs ? ullAtUs - ullFrameUs : 0,
+                          prvInjectRx, (void *)&xEvent);
+        }
+    }
+    else if (pxEvent->bType == REC_RESULT)
+    {
+        gbRandActive = false;
+    }
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static void prvInjectRx(void *pvArg)
+{
+    const recEvent_t *pxEvent = (const recEvent_t *)pvArg;
+    can_message_t xMsg = {};
+
+    xMsg.identifier = pxEvent->usArg;
+    xMsg.data_length_code = pxEvent->bId;
+    memcpy(xMsg.data, pxEvent->bData, sizeof(xMsg.data));
+    prvShiftPressTick(pxEvent, &xMsg);
+    vSimFloorReplayRx(&xMsg);
+}
+
+/*
+ * 踏んだ時刻付きのフレーム: 受信時刻からの遡り(64us単位)を保って再生時の時計へずらす
+ * (Masterは受信時刻の近くへ広げて読む, drv_can bCanMsgConv)
+ */
+static void prvShiftPressTick(const recEvent_t *pxEvent, can_message_t *pxMsg)
+{
+    tbCanFrame_t xFrame;
+
+    if (pxMsg->identifier != TBCAN_ID_MASTER ||
+        bTbCanDecode(pxMsg->data, pxMsg->data_length_code, &xFrame) != TBCAN_VER_2 ||
+        !xFrame.bTimed)
+        return;
+    if (!gbRecClockKnown)
+    {
+        ullSimCounter("replay.timed frames without sync")++;
+        return;
+    }
+    uint16_t usAge = (uint16_t)((uint16_t)((gulRecOriginUs + pxEvent->ulTimeUs) >>
+                                           TBCAN_TIME_TICK_SHIFT) -
+                                xFrame.usPressTick);
+    uint16_t usTick = (uint16_t)((uint16_t)((uint32_t)(gullReplayOriginUs + pxEvent->ulTimeUs) >>
+                                            TBCAN_TIME_TICK_SHIFT) -
+                                 usAge);
+    // [3..4] 踏んだ時刻(リトルエンディアン, tb_canproto.h)
+    pxMsg->data[3] = (uint8_t)usTick;
+    pxMsg->data[4] = (uint8_t)(usTick >> 8);
+    ullSimCounter("replay.timed frames shifted")++;
+}
+
+static int16_t prvData16(const recEvent_t *pxEvent, int iIdx)
+{
+    int16_t sValue;
+    memcpy(&sValue, &pxEvent->bData[iIdx * 2], sizeof(sValue));
+    return sValue;
+}
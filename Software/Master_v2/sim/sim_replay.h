@@ -0,0 +1,40 @@
+/*****************************************************************************/
+/**
+ * @file sim_replay.h
+ * @comments Virtual Arena レコーダ(util_rec)の記録の再生と照合
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim_floor.h"
+#include "sim_gm.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_EXIT_REPLAY_MISMATCH 7
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+bool bSimReplayLoad(const char *pcPath, SimGmConfig *pxGm, SimFloorConfig *pxFloor);
+bool bSimReplayEnabled(void);
+bool bSimReplayRandom(long lMin, long lMax, long *plValue);
+int iSimReplayCheck(int iZone, int iRed, int iGreen, int iBlue, int iHp, int iRemaining);
+bool bSimRecSave(const char *pcPath, const char *pcData, size_t xLen);
+void vSimReplayReport(FILE *pxOut);
+
+#endif
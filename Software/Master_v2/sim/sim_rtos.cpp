@@ -0,0 +1,1386 @@
+/*****************************************************************************/
+/**
+ * @file sim_rtos.cpp
+ * @comments Virtual Arena 仮想時間スケジューラ／FreeRTOS API実装
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sim_core.h"
+#include "sim_stats.h"
+#include "util_ring.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SIM_EVENT_TASK_PRIO (configMAX_PRIORITIES - 1)
+#define SIM_MAIN_TASK_PRIO 1 // ESP_TASK_MAIN_PRIO
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+enum eSimTaskState
+{
+    SIM_TASK_READY,
+    SIM_TASK_BLOCKED,
+    SIM_TASK_DELETED
+};
+
+struct SimTask
+{
+    std::string name;
+    UBaseType_t uxPrio;
+    TaskFunction_t pxFn;
+    void *pvArg;
+    pthread_t xThread;
+    pthread_cond_t xCond;
+    eSimTaskState eState;
+    uint64_t ullReadySeq; // 同優先度内の実行順
+    uint64_t ullBlockSeq; // 同一オブジェクト待ちの起床順
+    const void *pvWaitObj;
+    uint64_t ullWakeUs;
+    bool bWoken;
+    char cDelayObj;   // vTaskDelay用待ちオブジェクト
+    char cNotifyObj;  // Task Notify用待ちオブジェクト
+    uint32_t ulNotifyValue;
+    bool bNotifyPending;
+    uint64_t ullLastRxEnqUs; // 最後に受信したQueue要素の投入時刻
+};
+
+struct SimQueue
+{
+    UBaseType_t uxLength;
+    UBaseType_t uxItemSize;
+    std::vector<uint8_t> storage;
+    std::vector<uint64_t> enqUs;
+    UBaseType_t uxHead;
+    UBaseType_t uxCount;
+    char cRxObj;
+    char cTxObj;
+    // 統計
+    std::string name;
+    uint64_t ullSends;
+    uint64_t ullFails;
+    uint64_t ullBlockedSends;
+    uint64_t ullBlockedUs;
+    UBaseType_t uxHighWater;
+    SimSeries residency;
+};
+
+struct SimTimer
+{
+    std::string name;
+    TickType_t xPeriod;
+    UBaseType_t uxAutoReload;
+    void *pvId;
+    TimerCallbackFunction_t pxCallback;
+    bool bActive;
+    uint64_t ullExpiryUs;
+};
+
+struct SimEventGroup
+{
+    EventBits_t uxBits;
+    char cObj;
+};
+
+struct SimEvent
+{
+    uint64_t ullAtUs;
+    uint64_t ullSeq;
+    SimEventFn_t pxFn;
+    void *pvArg;
+    bool operator>(const SimEvent &rhs) const
+    {
+        return ullAtUs != rhs.ullAtUs ? ullAtUs > rhs.ullAtUs
+                                      : ullSeq > rhs.ullSeq;
+    }
+};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static pthread_mutex_t gxMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gxIdleCond = PTHREAD_COND_INITIALIZER;
+static std::vector<SimTask *> gTasks;
+static SimTask *gpxCurrent = NULL;
+static uint64_t gullNowUs = 0;
+static uint64_t gullSeq = 0;
+static uint64_t gullTimeLimitUs = SIM_WAIT_FOREVER;
+static void (*gpxStopHook)(int) = NULL;
+
+// Queue
+static std::vector<SimQueue *> gQueues;
+
+/* ファームウェアのSPSCリング(util_ring)の滞留時間計測 */
+struct SimRingTrack
+{
+    std::vector<uint64_t> enqUs; // スロット毎の投入時刻
+    uint64_t ullMboxEnqUs;       // メールボックスの投入時刻
+    SimSeries residency;
+};
+static std::map<const ring_t *, SimRingTrack> gRingTracks;
+
+// Timer Daemon
+static std::vector<SimTimer *> gTimers;
+static char gcTimerObj;
+
+// Event
+static std::priority_queue<SimEvent, std::vector<SimEvent>,
+                           std::greater<SimEvent>>
+    gEvents;
+static char gcEventObj;
+
+// Log
+static esp_log_level_t geLogLevel = ESP_LOG_WARN;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static SimTask *prvPickNextLocked();
+static void prvSwitchLocked(SimTask *pxSelf);
+static void prvPreemptLocked();
+static void *prvTaskEntry(void *pvArg);
+static void prvTimerDaemonTask(void *pvArg);
+static void prvEventTask(void *pvArg);
+
+/*****************************************************************************/
+/* Private Function (Scheduler)
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 次に実行するタスクを選ぶ
+ * 実行可能タスクが無ければ、次の起床時刻まで仮想時刻を進める。
+ *
+ * @param    ##
+ *
+ * @return   SimTask*
+ *
+ * @note     ロック取得済みで呼ぶこと
+ *
+ ******************************************************************************/
+static SimTask *prvPickNextLocked()
+{
+    for (;;)
+    {
+        SimTask *pxBest = NULL;
+        for (SimTask *pxTask : gTasks)
+        {
+            if (pxTask->eState != SIM_TASK_READY)
+                continue;
+            if (pxBest == NULL || pxTask->uxPrio > pxBest->uxPrio ||
+                (pxTask->uxPrio == pxBest->uxPrio &&
+                 pxTask->ullReadySeq < pxBest->ullReadySeq))
+            {
+                pxBest = pxTask;
+            }
+        }
+        if (pxBest != NULL)
+            return pxBest;
+
+        // 全タスクがブロック中: 次の起床時刻まで進める
+        uint64_t ullNext = SIM_WAIT_FOREVER;
+        for (SimTask *pxTask : gTasks)
+        {
+            if (pxTask->eState == SIM_TASK_BLOCKED && pxTask->ullWakeUs < ullNext)
+                ullNext = pxTask->ullWakeUs;
+        }
+        if (ullNext == SIM_WAIT_FOREVER)
+        {
+            fprintf(stderr, "sim: deadlock, all tasks blocked at t=%.3fs\n",
+                    gullNowUs / 1e6);
+            pthread_mutex_unlock(&gxMutex);
+            vSimStop(2);
+        }
+        if (ullNext > gullTimeLimitUs)
+        {
+            fprintf(stderr, "sim: time limit reached at t=%.3fs\n",
+                    gullTimeLimitUs / 1e6);
+            gullNowUs = gullTimeLimitUs;
+            pthread_mutex_unlock(&gxMutex);
+            vSimStop(3);
+        }
+        if (ullNext > gullNowUs)
+            gullNowUs = ullNext;
+
+        for (SimTask *pxTask : gTasks)
+        {
+            if (pxTask->eState == SIM_TASK_BLOCKED &&
+                pxTask->ullWakeUs <= gullNowUs)
+            {
+                pxTask->eState = SIM_TASK_READY;
+                pxTask->pvWaitObj = NULL;
+                pxTask->bWoken = false;
+                pxTask->ullReadySeq = ++gullSeq;
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 実行権の受け渡し
+ * 呼出元タスクは自分の状態(READY/BLOCKED)を設定してから呼ぶ。
+ *
+ * @param    pxSelf: 呼出元タスク
+ *
+ * @return   ##
+ *
+ * @note     ロック取得済みで呼ぶこと
+ *
+ ******************************************************************************/
+static void prvSwitchLocked(SimTask *pxSelf)
+{
+    SimTask *pxNext = prvPickNextLocked();
+    if (pxNext == pxSelf)
+        return;
+
+    gpxCurrent = pxNext;
+    pthread_cond_signal(&pxNext->xCond);
+    while (gpxCurrent != pxSelf)
+    {
+        pthread_cond_wait(&pxSelf->xCond, &gxMutex);
+    }
+}
+
+/*****************************************************************************/
+/**
+ * より高い優先度のタスクが実行可能なら実行権を譲る
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ロック取得済みで呼ぶこと
+ *
+ ******************************************************************************/
+static void prvPreemptLocked()
+{
+    SimTask *pxSelf = gpxCurrent;
+    if (pxSelf == NULL)
+        return;
+    for (SimTask *pxTask : gTasks)
+    {
+        if (pxTask->eState == SIM_TASK_READY && pxTask->uxPrio > pxSelf->uxPrio)
+        {
+            // 割り込まれたタスクは同優先度の先頭に残す (ullReadySeqは維持)
+            prvSwitchLocked(pxSelf);
+            return;
+        }
+    }
+}
+
+static void *prvTaskEntry(void *pvArg)
+{
+    SimTask *pxTask = (SimTask *)pvArg;
+
+    pthread_mutex_lock(&gxMutex);
+    while (gpxCurrent != pxTask)
+    {
+        pthread_cond_wait(&pxTask->xCond, &gxMutex);
+    }
+    pthread_mutex_unlock(&gxMutex);
+
+    pxTask->pxFn(pxTask->pvArg);
+
+    // FreeRTOSではreturn禁止だが、念のため削除扱いにする
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+/*****************************************************************************/
+/* Public Function (Scheduler)
+******************************************************************************/
+uint64_t ullSimNowUs(void) { return gullNowUs; }
+
+/*****************************************************************************/
+/**
+ * Tick数 -> 起床時刻[us]
+ * FreeRTOSと同じく、現在のTick境界から数える。
+ *
+ * @param    xTicks: 待ちTick数 (portMAX_DELAYは無期限)
+ *
+ * @return   起床時刻[us]
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint64_t ullSimTicksToWakeUs(TickType_t xTicks)
+{
+    if (xTicks == portMAX_DELAY)
+        return SIM_WAIT_FOREVER;
+    uint64_t ullTickUs = 1000000ULL / configTICK_RATE_HZ;
+    return (gullNowUs / ullTickUs + (uint64_t)xTicks) * ullTickUs;
+}
+
+void vSimLock(void) { pthread_mutex_lock(&gxMutex); }
+void vSimUnlock(void) { pthread_mutex_unlock(&gxMutex); }
+
+/*****************************************************************************/
+/**
+ * オブジェクト待ち
+ *
+ * @param    pvObj: 待ちオブジェクト(アドレスのみ使用)
+ * @param    ullWakeUs: タイムアウト時刻[us]
+ *
+ * @return   pdTRUE: uxSimWakeLocked()で起床 / pdFALSE: タイムアウト
+ *
+ * @note     ロック取得済みで呼ぶこと
+ *
+ ******************************************************************************/
+BaseType_t xSimWaitLocked(const void *pvObj, uint64_t ullWakeUs)
+{
+    SimTask *pxSelf = gpxCurrent;
+    configASSERT(pxSelf != NULL);
+
+    pxSelf->eState = SIM_TASK_BLOCKED;
+    pxSelf->pvWaitObj = pvObj;
+    pxSelf->ullWakeUs = ullWakeUs;
+    pxSelf->bWoken = false;
+    pxSelf->ullBlockSeq = ++gullSeq;
+    prvSwitchLocked(pxSelf);
+    return pxSelf->bWoken ? pdTRUE : pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * オブジェクト待ちタスクの起床
+ * 優先度の高い順、同優先度は待ち開始順に起こす。
+ *
+ * @param    pvObj: 待ちオブジェクト
+ * @param    xAll: pdTRUEなら全て起こす
+ *
+ * @return   起こしたタスク数
+ *
+ * @note     ロック取得済みで呼ぶこと
+ *
+ ******************************************************************************/
+UBaseType_t uxSimWakeLocked(const void *pvObj, BaseType_t xAll)
+{
+    UBaseType_t uxWoken = 0;
+    for (;;)
+    {
+        SimTask *pxBest = NULL;
+        for (SimTask *pxTask : gTasks)
+        {
+            if (pxTask->eState != SIM_TASK_BLOCKED || pxTask->pvWaitObj != pvObj)
+                continue;
+            if (pxBest == NULL || pxTask->uxPrio > pxBest->uxPrio ||
+                (pxTask->uxPrio == pxBest->uxPrio &&
+                 pxTask->ullBlockSeq < pxBest->ullBlockSeq))
+            {
+                pxBest = pxTask;
+            }
+        }
+        if (pxBest == NULL)
+            break;
+        pxBest->eState = SIM_TASK_READY;
+        pxBest->pvWaitObj = NULL;
+        pxBest->bWoken = true;
+        pxBest->ullReadySeq = ++gullSeq;
+        uxWoken++;
+        if (xAll != pdTRUE)
+            break;
+    }
+    if (uxWoken > 0)
+        prvPreemptLocked();
+    return uxWoken;
+}
+
+/*****************************************************************************/
+/**
+ * オブジェクト待ちタスクの起床時刻を前倒しする
+ *
+ * @param    pvObj: 待ちオブジェクト
+ * @param    ullWakeUs: 新しい起床時刻
+ *
+ * @return   ##
+ *
+ * @note     タイマデーモン／イベントタスクの待ち時間更新用
+ *
+ ******************************************************************************/
+void vSimRetimeLocked(const void *pvObj, uint64_t ullWakeUs)
+{
+    for (SimTask *pxTask : gTasks)
+    {
+        if (pxTask->eState == SIM_TASK_BLOCKED && pxTask->pvWaitObj == pvObj &&
+            ullWakeUs < pxTask->ullWakeUs)
+        {
+            pxTask->ullWakeUs = ullWakeUs;
+        }
+    }
+}
+
+void vSimDelayUs(uint64_t ullUs)
+{
+    vSimLock();
+    SimTask *pxSelf = gpxCurrent;
+    xSimWaitLocked(&pxSelf->cDelayObj, gullNowUs + ullUs);
+    vSimUnlock();
+}
+
+/*****************************************************************************/
+/**
+ * イベント登録
+ * 指定時刻にSimEventタスク(最高優先度)からpxFnを呼ぶ。
+ * 割り込みハンドラ相当の処理(バス受信完了など)に使う。
+ *
+ * @param    ullAtUs: 実行時刻[us]
+ * @param    pxFn: コールバック
+ * @param    pvArg: 引数
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimPostEvent(uint64_t ullAtUs, SimEventFn_t pxFn, void *pvArg)
+{
+    vSimLock();
+    if (ullAtUs < gullNowUs)
+        ullAtUs = gullNowUs;
+    gEvents.push(SimEvent{ullAtUs, ++gullSeq, pxFn, pvArg});
+    vSimRetimeLocked(&gcEventObj, ullAtUs);
+    vSimUnlock();
+}
+
+static void prvEventTask(void *pvArg)
+{
+    (void)pvArg;
+    for (;;)
+    {
+        vSimLock();
+        if (gEvents.empty())
+        {
+            xSimWaitLocked(&gcEventObj, SIM_WAIT_FOREVER);
+            vSimUnlock();
+            continue;
+        }
+        SimEvent xEvent = gEvents.top();
+        if (xEvent.ullAtUs > gullNowUs)
+        {
+            xSimWaitLocked(&gcEventObj, xEvent.ullAtUs);
+            vSimUnlock();
+            continue;
+        }
+        gEvents.pop();
+        vSimUnlock();
+
+        xEvent.pxFn(xEvent.pvArg);
+    }
+}
+
+void vSimSetTimeLimit(uint64_t ullLimitUs) { gullTimeLimitUs = ullLimitUs; }
+
+void vSimSetStopHook(void (*pxHook)(int iCode)) { gpxStopHook = pxHook; }
+
+/*****************************************************************************/
+/**
+ * シミュレーション開始
+ * SimEvent／Tmr Svcタスクとmainタスク(app_main相当)を生成して実行する。
+ *
+ * @param    pxMainTask: mainタスク関数
+ *
+ * @return   戻らない
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimStart(TaskFunction_t pxMainTask)
+{
+    xTaskCreate(prvEventTask, "SimEvent", 4096, NULL, SIM_EVENT_TASK_PRIO, NULL);
+    xTaskCreate(prvTimerDaemonTask, "Tmr Svc", 4096, NULL,
+                configTIMER_TASK_PRIORITY, NULL);
+    xTaskCreate(pxMainTask, "main", 4096, NULL, SIM_MAIN_TASK_PRIO, NULL);
+
+    pthread_mutex_lock(&gxMutex);
+    gpxCurrent = prvPickNextLocked();
+    pthread_cond_signal(&gpxCurrent->xCond);
+    for (;;)
+    {
+        pthread_cond_wait(&gxIdleCond, &gxMutex);
+    }
+}
+
+void vSimStop(int iCode)
+{
+    if (gpxStopHook != NULL)
+        gpxStopHook(iCode);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(iCode);
+}
+
+void vSimAssertFailed(const char *pcFile, int iLine, const char *pcExpr)
+{
+    fprintf(stderr, "sim: assert failed (%s) at %s:%d, t=%.3fs\n", pcExpr,
+            pcFile, iLine, gullNowUs / 1e6);
+    vSimStop(4);
+}
+
+uint64_t ullSimTaskLastRxEnqUs(void)
+{
+    return gpxCurrent != NULL ? gpxCurrent->ullLastRxEnqUs : 0;
+}
+
+/*****************************************************************************/
+/* Public Function (Task)
+******************************************************************************/
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode,
+                                   const char *const pcName,
+                                   const uint32_t usStackDepth,
+                                   void *const pvParameters,
+                                   UBaseType_t uxPriority,
+                                   TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID)
+{
+    (void)usStackDepth;
+    (void)xCoreID;
+    SimTask *pxTask = new SimTask();
+    pxTask->name = pcName;
+    pxTask->uxPrio = uxPriority;
+    pxTask->pxFn = pvTaskCode;
+    pxTask->pvArg = pvParameters;
+    pthread_cond_init(&pxTask->xCond, NULL);
+
+    pthread_mutex_lock(&gxMutex);
+    pxTask->eState = SIM_TASK_READY;
+    pxTask->ullReadySeq = ++gullSeq;
+    gTasks.push_back(pxTask);
+    if (pvCreatedTask != NULL)
+        *pvCreatedTask = pxTask;
+
+    pthread_attr_t xAttr;
+    pthread_attr_init(&xAttr);
+    pthread_attr_setdetachstate(&xAttr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&xAttr, 1024 * 1024);
+    int iErr = pthread_create(&pxTask->xThread, &xAttr, prvTaskEntry, pxTask);
+    pthread_attr_destroy(&xAttr);
+    configASSERT(iErr == 0);
+
+    // 生成したタスクの方が優先度が高ければ切り替える
+    prvPreemptLocked();
+    pthread_mutex_unlock(&gxMutex);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxTask = (xTaskToDelete == NULL) ? gpxCurrent : xTaskToDelete;
+    pxTask->eState = SIM_TASK_DELETED;
+    if (pxTask != gpxCurrent)
+    {
+        pthread_mutex_unlock(&gxMutex);
+        return;
+    }
+
+    // 自タスク削除: 実行権を渡してスレッドを終了する
+    gpxCurrent = prvPickNextLocked();
+    pthread_cond_signal(&gpxCurrent->xCond);
+    pthread_mutex_unlock(&gxMutex);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxSelf = gpxCurrent;
+    if (xTicksToDelay == 0)
+    {
+        pxSelf->ullReadySeq = ++gullSeq;
+        prvSwitchLocked(pxSelf);
+    }
+    else
+    {
+        xSimWaitLocked(&pxSelf->cDelayObj, ullSimTicksToWakeUs(xTicksToDelay));
+    }
+    pthread_mutex_unlock(&gxMutex);
+}
+
+void vTaskDelayUntil(TickType_t *const pxPreviousWakeTime,
+                     const TickType_t xTimeIncrement)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxSelf = gpxCurrent;
+    uint64_t ullTickUs = 1000000ULL / configTICK_RATE_HZ;
+    uint64_t ullWakeUs =
+        ((uint64_t)*pxPreviousWakeTime + xTimeIncrement) * ullTickUs;
+    *pxPreviousWakeTime += xTimeIncrement;
+    if (ullWakeUs > gullNowUs)
+        xSimWaitLocked(&pxSelf->cDelayObj, ullWakeUs);
+    pthread_mutex_unlock(&gxMutex);
+}
+
+void vTaskYield(void) { vTaskDelay(0); }
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(gullNowUs / (1000000ULL / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR(void) { return xTaskGetTickCount(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return gpxCurrent; }
+
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+    SimTask *pxTask = (xTaskToQuery == NULL) ? gpxCurrent : xTaskToQuery;
+    return (char *)pxTask->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    (void)xTask;
+    return 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit,
+                          TickType_t xTicksToWait)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxSelf = gpxCurrent;
+    if (pxSelf->ulNotifyValue == 0 && xTicksToWait != 0)
+    {
+        xSimWaitLocked(&pxSelf->cNotifyObj, ullSimTicksToWakeUs(xTicksToWait));
+    }
+    uint32_t ulValue = pxSelf->ulNotifyValue;
+    if (ulValue != 0)
+    {
+        pxSelf->ulNotifyValue = (xClearCountOnExit == pdTRUE) ? 0 : ulValue - 1;
+    }
+    pxSelf->bNotifyPending = false;
+    pthread_mutex_unlock(&gxMutex);
+    return ulValue;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry,
+                           uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue,
+                           TickType_t xTicksToWait)
+{
+    BaseType_t xReturn;
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxSelf = gpxCurrent;
+    if (!pxSelf->bNotifyPending)
+    {
+        pxSelf->ulNotifyValue &= ~ulBitsToClearOnEntry;
+        if (xTicksToWait != 0)
+        {
+            xSimWaitLocked(&pxSelf->cNotifyObj,
+                           ullSimTicksToWakeUs(xTicksToWait));
+        }
+    }
+    if (pulNotificationValue != NULL)
+        *pulNotificationValue = pxSelf->ulNotifyValue;
+    if (pxSelf->bNotifyPending)
+    {
+        pxSelf->ulNotifyValue &= ~ulBitsToClearOnExit;
+        xReturn = pdTRUE;
+    }
+    else
+    {
+        xReturn = pdFALSE;
+    }
+    pxSelf->bNotifyPending = false;
+    pthread_mutex_unlock(&gxMutex);
+    return xReturn;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue,
+                              eNotifyAction eAction,
+                              uint32_t *pulPreviousNotificationValue)
+{
+    BaseType_t xReturn = pdPASS;
+    configASSERT(xTaskToNotify != NULL);
+
+    pthread_mutex_lock(&gxMutex);
+    SimTask *pxTask = xTaskToNotify;
+    if (pulPreviousNotificationValue != NULL)
+        *pulPreviousNotificationValue = pxTask->ulNotifyValue;
+    bool bWasPending = pxTask->bNotifyPending;
+    switch (eAction)
+    {
+    case eSetBits:
+        pxTask->ulNotifyValue |= ulValue;
+        break;
+    case eIncrement:
+        pxTask->ulNotifyValue++;
+        break;
+    case eSetValueWithOverwrite:
+        pxTask->ulNotifyValue = ulValue;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (bWasPending)
+            xReturn = pdFAIL;
+        else
+            pxTask->ulNotifyValue = ulValue;
+        break;
+    case eNoAction:
+    default:
+        break;
+    }
+    pxTask->bNotifyPending = true;
+    uxSimWakeLocked(&pxTask->cNotifyObj, pdFALSE);
+    pthread_mutex_unlock(&gxMutex);
+    return xReturn;
+}
+
+BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t xTaskToNotify,
+                                     uint32_t ulValue, eNotifyAction eAction,
+                                     uint32_t *pulPreviousNotificationValue,
+                                     BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken != NULL)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return xTaskGenericNotify(xTaskToNotify, ulValue, eAction,
+                              pulPreviousNotificationValue);
+}
+
+/*****************************************************************************/
+/* Public Function (Queue)
+******************************************************************************/
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    SimQueue *pxQueue = new SimQueue();
+    pxQueue->uxLength = uxQueueLength;
+    pxQueue->uxItemSize = uxItemSize;
+    pxQueue->storage.resize((size_t)uxQueueLength * uxItemSize);
+    pxQueue->enqUs.resize(uxQueueLength);
+    pthread_mutex_lock(&gxMutex);
+    gQueues.push_back(pxQueue);
+    pthread_mutex_unlock(&gxMutex);
+    return pxQueue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    // 統計出力のため実体は残す
+    (void)xQueue;
+}
+
+void vQueueAddToRegistry(QueueHandle_t xQueue, const char *pcQueueName)
+{
+    if (xQueue != NULL)
+        xQueue->name = pcQueueName;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue,
+                             const void *const pvItemToQueue,
+                             TickType_t xTicksToWait,
+                             const BaseType_t xCopyPosition)
+{
+    configASSERT(xQueue != NULL);
+    pthread_mutex_lock(&gxMutex);
+    SimQueue *pxQueue = xQueue;
+    uint64_t ullWakeUs = ullSimTicksToWakeUs(xTicksToWait);
+    uint64_t ullStartUs = gullNowUs;
+    bool bBlocked = false;
+
+    while (pxQueue->uxCount >= pxQueue->uxLength &&
+           xCopyPosition != queueOVERWRITE)
+    {
+        if (xTicksToWait == 0 ||
+            (bBlocked && gullNowUs >= ullWakeUs))
+        {
+            pxQueue->ullFails++;
+            pthread_mutex_unlock(&gxMutex);
+            return errQUEUE_FULL;
+        }
+        bBlocked = true;
+        xSimWaitLocked(&pxQueue->cTxObj, ullWakeUs);
+    }
+    if (bBlocked)
+    {
+        pxQueue->ullBlockedSends++;
+        pxQueue->ullBlockedUs += gullNowUs - ullStartUs;
+    }
+
+    UBaseType_t uxSlot;
+    if (xCopyPosition == queueOVERWRITE && pxQueue->uxCount >= pxQueue->uxLength)
+    {
+        uxSlot = pxQueue->uxHead;
+    }
+    else if (xCopyPosition == queueSEND_TO_FRONT)
+    {
+        pxQueue->uxHead =
+            (pxQueue->uxHead + pxQueue->uxLength - 1) % pxQueue->uxLength;
+        uxSlot = pxQueue->uxHead;
+        pxQueue->uxCount++;
+    }
+    else
+    {
+        uxSlot = (pxQueue->uxHead + pxQueue->uxCount) % pxQueue->uxLength;
+        pxQueue->uxCount++;
+    }
+    if (pxQueue->uxItemSize > 0)
+    {
+        memcpy(&pxQueue->storage[(size_t)uxSlot * pxQueue->uxItemSize],
+               pvItemToQueue, pxQueue->uxItemSize);
+    }
+    pxQueue->enqUs[uxSlot] = gullNowUs;
+    pxQueue->ullSends++;
+    if (pxQueue->uxCount > pxQueue->uxHighWater)
+        pxQueue->uxHighWater = pxQueue->uxCount;
+
+    uxSimWakeLocked(&pxQueue->cRxObj, pdFALSE);
+    pthread_mutex_unlock(&gxMutex);
+    return pdPASS;
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue,
+                                    const void *const pvItemToQueue,
+                                    BaseType_t *const pxHigherPriorityTaskWoken,
+                                    const BaseType_t xCopyPosition)
+{
+    if (pxHigherPriorityTaskWoken != NULL)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return xQueueGenericSend(xQueue, pvItemToQueue, 0, xCopyPosition);
+}
+
+static BaseType_t prvQueueReceive(QueueHandle_t xQueue, void *const pvBuffer,
+                                  TickType_t xTicksToWait, bool bPeek)
+{
+    configASSERT(xQueue != NULL);
+    pthread_mutex_lock(&gxMutex);
+    SimQueue *pxQueue = xQueue;
+    uint64_t ullWakeUs = ullSimTicksToWakeUs(xTicksToWait);
+    bool bBlocked = false;
+
+    while (pxQueue->uxCount == 0)
+    {
+        if (xTicksToWait == 0 || (bBlocked && gullNowUs >= ullWakeUs))
+        {
+            pthread_mutex_unlock(&gxMutex);
+            return errQUEUE_EMPTY;
+        }
+        bBlocked = true;
+        xSimWaitLocked(&pxQueue->cRxObj, ullWakeUs);
+    }
+
+    UBaseType_t uxSlot = pxQueue->uxHead;
+    if (pvBuffer != NULL && pxQueue->uxItemSize > 0)
+    {
+        memcpy(pvBuffer, &pxQueue->storage[(size_t)uxSlot * pxQueue->uxItemSize],
+               pxQueue->uxItemSize);
+    }
+    if (!bPeek)
+    {
+        pxQueue->residency.vAdd(gullNowUs - pxQueue->enqUs[uxSlot]);
+        if (gpxCurrent != NULL)
+            gpxCurrent->ullLastRxEnqUs = pxQueue->enqUs[uxSlot];
+        pxQueue->uxHead = (pxQueue->uxHead + 1) % pxQueue->uxLength;
+        pxQueue->uxCount--;
+        uxSimWakeLocked(&pxQueue->cTxObj, pdFALSE);
+    }
+    pthread_mutex_unlock(&gxMutex);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *const pvBuffer,
+                         TickType_t xTicksToWait)
+{
+    return prvQueueReceive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *const pvBuffer,
+                      TickType_t xTicksToWait)
+{
+    return prvQueueReceive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void *const pvBuffer,
+                                BaseType_t *const pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken != NULL)
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    return prvQueueReceive(xQueue, pvBuffer, 0, false);
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue)
+{
+    (void)xNewQueue;
+    pthread_mutex_lock(&gxMutex);
+    xQueue->uxHead = 0;
+    xQueue->uxCount = 0;
+    uxSimWakeLocked(&xQueue->cTxObj, pdTRUE);
+    pthread_mutex_unlock(&gxMutex);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+    return xQueue->uxCount;
+}
+
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue)
+{
+    return xQueue->uxLength - xQueue->uxCount;
+}
+
+/*****************************************************************************/
+/**
+ * Queue統計の出力
+ * vQueueAddToRegistry()で名前を付けたQueueのみ対象。
+ *
+ * @param    pxOut: 出力先
+ *
+ * @return   ##
+ *
+ * @note     residency: 投入から取り出しまでの滞留時間
+ *
+ ******************************************************************************/
+void vSimQueueReport(FILE *pxOut)
+{
+    fprintf(pxOut, "--- queues ---\n");
+    fprintf(pxOut, "%-18s %5s %8s %6s %8s %10s %9s %9s %9s\n", "", "len",
+            "sends", "hiwat", "blocked", "blocked_ms", "res_mean", "res_p99",
+            "res_max");
+    for (SimQueue *pxQueue : gQueues)
+    {
+        if (pxQueue->name.empty())
+            continue;
+        fprintf(pxOut, "%-18s %5u %8llu %6u %8llu %10.3f %9.3f %9.3f %9.3f\n",
+                pxQueue->name.c_str(), pxQueue->uxLength,
+                (unsigned long long)pxQueue->ullSends, pxQueue->uxHighWater,
+                (unsigned long long)pxQueue->ullBlockedSends,
+                pxQueue->ullBlockedUs / 1000.0,
+                pxQueue->residency.dMean() / 1000.0,
+                pxQueue->residency.ullPercentile(99) / 1000.0,
+                pxQueue->residency.ullMax() / 1000.0);
+    }
+}
+
+/*****************************************************************************/
+/* Public Function (Ring)
+******************************************************************************/
+/*****************************************************************************/
+/**
+ * util_ringからの計測フック
+ * 取り出したタスクに投入時刻を渡す(Queueと同じくCAN送信の起点に使う)
+ *
+ * @param    pxRing: リング
+ * @param    ulIdx: 添字 / 0xFFFFFFFF(メールボックス)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+extern "C" void vSimRingOnPush(const ring_t *pxRing, uint32_t ulIdx)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimRingTrack &xTrack = gRingTracks[pxRing];
+    if (xTrack.enqUs.empty())
+        xTrack.enqUs.resize(pxRing->ulMask + 1);
+    if (ulIdx == 0xFFFFFFFFUL)
+        xTrack.ullMboxEnqUs = gullNowUs;
+    else
+        xTrack.enqUs[ulIdx & pxRing->ulMask] = gullNowUs;
+    pthread_mutex_unlock(&gxMutex);
+}
+
+extern "C" void vSimRingOnPop(const ring_t *pxRing, uint32_t ulIdx)
+{
+    pthread_mutex_lock(&gxMutex);
+    SimRingTrack &xTrack = gRingTracks[pxRing];
+    uint64_t ullEnqUs = gullNowUs;
+    if (ulIdx == 0xFFFFFFFFUL)
+        ullEnqUs = xTrack.ullMboxEnqUs;
+    else if (!xTrack.enqUs.empty())
+        ullEnqUs = xTrack.enqUs[ulIdx & pxRing->ulMask];
+    xTrack.residency.vAdd(gullNowUs - ullEnqUs);
+    if (gpxCurrent != NULL)
+        gpxCurrent->ullLastRxEnqUs = ullEnqUs;
+    pthread_mutex_unlock(&gxMutex);
+}
+
+void vSimRingReport(FILE *pxOut)
+{
+    static const char *const pcPolicy[] = {"block", "drop_old", "coalesce"};
+    ringStats_t xStats;
+
+    fprintf(pxOut, "--- rings ---\n");
+    fprintf(pxOut, "%-18s %5s %-8s %8s %6s %6s %6s %6s %9s %9s %9s\n", "",
+            "len", "policy", "pushes", "hiwat", "drop", "coal", "block",
+            "res_mean", "res_p99", "res_max");
+    for (uint32_t i = 0; pxRingGetRegistered(i) != NULL; i++)
+    {
+        ring_t *pxRing = pxRingGetRegistered(i);
+        SimSeries &xRes = gRingTracks[pxRing].residency;
+        vRingGetStats(pxRing, &xStats);
+        fprintf(pxOut,
+                "%-18s %5u %-8s %8u %6u %6u %6u %6u %9.3f %9.3f %9.3f\n",
+                xStats.pcName, xStats.ulSize,
+                xStats.ePolicy < MAX_RING_POLICY ? pcPolicy[xStats.ePolicy] : "?",
+                xStats.ulPushCnt, xStats.ulHighWater, xStats.ulDropCnt,
+                xStats.ulCoalesceCnt, xStats.ulBlockCnt, xRes.dMean() / 1000.0,
+                xRes.ullPercentile(99) / 1000.0, xRes.ullMax() / 1000.0);
+    }
+}
+
+/*****************************************************************************/
+/* Public Function (Timer)
+******************************************************************************/
+TimerHandle_t xTimerCreate(const char *const pcTimerName,
+                           const TickType_t xTimerPeriodInTicks,
+                           const UBaseType_t uxAutoReload,
+                           void *const pvTimerID,
+                           TimerCallbackFunction_t pxCallbackFunction)
+{
+    SimTimer *pxTimer = new SimTimer();
+    pxTimer->name = pcTimerName;
+    pxTimer->xPeriod = xTimerPeriodInTicks;
+    pxTimer->uxAutoReload = uxAutoReload;
+    pxTimer->pvId = pvTimerID;
+    pxTimer->pxCallback = pxCallbackFunction;
+    pxTimer->bActive = false;
+    pthread_mutex_lock(&gxMutex);
+    gTimers.push_back(pxTimer);
+    pthread_mutex_unlock(&gxMutex);
+    return pxTimer;
+}
+
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer,
+                                const BaseType_t xCommandID,
+                                const TickType_t xOptionalValue,
+                                BaseType_t *const pxHigherPriorityTaskWoken,
+                                const TickType_t xTicksToWait)
+{
+    (void)pxHigherPriorityTaskWoken;
+    (void)xTicksToWait;
+    pthread_mutex_lock(&gxMutex);
+    switch (xCommandID)
+    {
+    case tmrCOMMAND_CHANGE_PERIOD:
+        xTimer->xPeriod = xOptionalValue;
+        /* fall through */
+    case tmrCOMMAND_START:
+    case tmrCOMMAND_RESET:
+        xTimer->bActive = true;
+        xTimer->ullExpiryUs = ullSimTicksToWakeUs(xTimer->xPeriod);
+        vSimRetimeLocked(&gcTimerObj, xTimer->ullExpiryUs);
+        break;
+    case tmrCOMMAND_STOP:
+        xTimer->bActive = false;
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&gxMutex);
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+    return xTimer->bActive ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t xTimer) { return xTimer->pvId; }
+
+/*****************************************************************************/
+/**
+ * タイマデーモンタスク (Tmr Svc, 優先度configTIMER_TASK_PRIORITY)
+ *
+ * @param    pvArgはNULLです。
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static void prvTimerDaemonTask(void *pvArg)
+{
+    (void)pvArg;
+    for (;;)
+    {
+        pthread_mutex_lock(&gxMutex);
+        SimTimer *pxNext = NULL;
+        for (SimTimer *pxTimer : gTimers)
+        {
+            if (pxTimer->bActive &&
+                (pxNext == NULL || pxTimer->ullExpiryUs < pxNext->ullExpiryUs))
+            {
+                pxNext = pxTimer;
+            }
+        }
+        if (pxNext == NULL || pxNext->ullExpiryUs > gullNowUs)
+        {
+            xSimWaitLocked(&gcTimerObj, pxNext == NULL ? SIM_WAIT_FOREVER
+                                                       : pxNext->ullExpiryUs);
+            pthread_mutex_unlock(&gxMutex);
+            continue;
+        }
+
+        if (pxNext->uxAutoReload == pdTRUE)
+        {
+            pxNext->ullExpiryUs +=
+                (uint64_t)pxNext->xPeriod * (1000000ULL / configTICK_RATE_HZ);
+        }
+        else
+        {
+            pxNext->bActive = false;
+        }
+        pthread_mutex_unlock(&gxMutex);
+
+        pxNext->pxCallback(pxNext);
+    }
+}
+
+/*****************************************************************************/
+/* Public Function (Event Group)
+******************************************************************************/
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    SimEventGroup *pxGroup = new SimEventGroup();
+    pxGroup->uxBits = 0;
+    return pxGroup;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup,
+                               const EventBits_t uxBitsToSet)
+{
+    pthread_mutex_lock(&gxMutex);
+    xEventGroup->uxBits |= uxBitsToSet;
+    EventBits_t uxBits = xEventGroup->uxBits;
+    uxSimWakeLocked(&xEventGroup->cObj, pdTRUE);
+    pthread_mutex_unlock(&gxMutex);
+    return uxBits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup,
+                                 const EventBits_t uxBitsToClear)
+{
+    pthread_mutex_lock(&gxMutex);
+    EventBits_t uxBits = xEventGroup->uxBits;
+    xEventGroup->uxBits &= ~uxBitsToClear;
+    pthread_mutex_unlock(&gxMutex);
+    return uxBits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    return xEventGroup->uxBits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit,
+                                const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+    pthread_mutex_lock(&gxMutex);
+    uint64_t ullWakeUs = ullSimTicksToWakeUs(xTicksToWait);
+    for (;;)
+    {
+        EventBits_t uxBits = xEventGroup->uxBits;
+        bool bMatch = (xWaitForAllBits == pdTRUE)
+                          ? ((uxBits & uxBitsToWaitFor) == uxBitsToWaitFor)
+                          : ((uxBits & uxBitsToWaitFor) != 0);
+        if (bMatch || xTicksToWait == 0 || gullNowUs >= ullWakeUs)
+        {
+            if (bMatch && xClearOnExit == pdTRUE)
+                xEventGroup->uxBits &= ~uxBitsToWaitFor;
+            pthread_mutex_unlock(&gxMutex);
+            return uxBits;
+        }
+        xSimWaitLocked(&xEventGroup->cObj, ullWakeUs);
+    }
+}
+
+/*****************************************************************************/
+/* Public Function (ESP-IDF misc)
+******************************************************************************/
+int64_t esp_timer_get_time(void) { return (int64_t)gullNowUs; }
+
+/*
+ * esp_timer
+ * 開始毎に世代を進め、停止/再開始された古いイベントは捨てる。
+ */
+struct esp_timer
+{
+    esp_timer_create_args_t xArgs;
+    uint32_t ulGen;
+    uint64_t ullPeriodUs; // 0:one-shot
+    bool bArmed;
+};
+
+struct SimEspTimerFire
+{
+    esp_timer_handle_t xTimer;
+    uint32_t ulGen;
+};
+
+static void prvEspTimerFire(void *pvArg)
+{
+    SimEspTimerFire *pxFire = (SimEspTimerFire *)pvArg;
+    esp_timer_handle_t xTimer = pxFire->xTimer;
+    bool bValid = xTimer->bArmed && xTimer->ulGen == pxFire->ulGen;
+
+    if (bValid && xTimer->ullPeriodUs != 0)
+        vSimPostEvent(gullNowUs + xTimer->ullPeriodUs, prvEspTimerFire, pxFire);
+    else
+        delete pxFire;
+
+    if (bValid)
+    {
+        if (xTimer->ullPeriodUs == 0)
+            xTimer->bArmed = false;
+        xTimer->xArgs.callback(xTimer->xArgs.arg);
+    }
+}
+
+static esp_err_t prvEspTimerStart(esp_timer_handle_t xTimer, uint64_t ullUs,
+                                  uint64_t ullPeriodUs)
+{
+    if (xTimer == NULL)
+        return ESP_ERR_INVALID_ARG;
+    if (xTimer->bArmed)
+        return ESP_ERR_INVALID_STATE;
+    xTimer->bArmed = true;
+    xTimer->ullPeriodUs = ullPeriodUs;
+    vSimPostEvent(gullNowUs + ullUs, prvEspTimerFire,
+                  new SimEspTimerFire{xTimer, ++xTimer->ulGen});
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t *out_handle)
+{
+    if (create_args == NULL || create_args->callback == NULL ||
+        out_handle == NULL)
+        return ESP_ERR_INVALID_ARG;
+    *out_handle = new esp_timer{*create_args, 0, 0, false};
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return prvEspTimerStart(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return prvEspTimerStart(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL)
+        return ESP_ERR_INVALID_ARG;
+    if (!timer->bArmed)
+        return ESP_ERR_INVALID_STATE;
+    timer->bArmed = false;
+    timer->ulGen++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL)
+        return ESP_ERR_INVALID_ARG;
+    if (timer->bArmed)
+        return ESP_ERR_INVALID_STATE;
+    // 未発火のイベントが参照するため解放しない
+    return ESP_OK;
+}
+
+void vSimSetLogLevel(int iLevel) { geLogLevel = (esp_log_level_t)iLevel; }
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    geLogLevel = level;
+}
+
+uint32_t esp_log_timestamp(void) { return (uint32_t)(gullNowUs / 1000); }
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format,
+                   ...)
+{
+    static const char cLetters[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+    if (level > geLogLevel)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%u) %s: ", cLetters[level], esp_log_timestamp(), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line,
+                             const char *function, const char *expression)
+{
+    fprintf(stderr,
+            "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d (%s)\n"
+            "expression: %s\n",
+            rc, esp_err_to_name(rc), file, line, function, expression);
+    fprintf(stderr, "sim: firmware abort() at t=%.3fs\n", gullNowUs / 1e6);
+    vSimStop(5);
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "sim: esp_restart() at t=%.3fs\n", gullNowUs / 1e6);
+    vSimStop(6);
+}
@@ -0,0 +1,134 @@
+/*****************************************************************************/
+/**
+ * @file sim_stats.cpp
+ * @comments Virtual Arena 統計(系列・カウンタ)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <math.h>
+
+#include <map>
+#include <memory>
+
+#include "sim_stats.h"
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+// 出力順を登録順にするため、名前->index と本体を分けて持つ
+static std::map<std::string, size_t> gSeriesIndex;
+static std::vector<std::pair<std::string, std::unique_ptr<SimSeries>>> gSeries;
+static std::map<std::string, size_t> gCounterIndex;
+static std::vector<std::pair<std::string, uint64_t>> gCounters;
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+double SimSeries::dStdDev() const
+{
+    if (m_samples.size() < 2)
+        return 0.0;
+    double dMean = this->dMean();
+    double dAcc = 0.0;
+    for (uint64_t v : m_samples)
+        dAcc += ((double)v - dMean) * ((double)v - dMean);
+    return sqrt(dAcc / (double)(m_samples.size() - 1));
+}
+
+uint64_t SimSeries::ullPercentile(double dPct)
+{
+    if (m_samples.empty())
+        return 0;
+    if (!m_bSorted)
+    {
+        std::sort(m_samples.begin(), m_samples.end());
+        m_bSorted = true;
+    }
+    size_t uxIdx = (size_t)((dPct / 100.0) * (double)(m_samples.size() - 1) + 0.5);
+    return m_samples[std::min(uxIdx, m_samples.size() - 1)];
+}
+
+uint64_t SimSeries::ullMax() { return ullPercentile(100.0); }
+
+/*****************************************************************************/
+/**
+ * 名前付き系列／カウンタの取得 (無ければ登録)
+ *
+ * @param    name: 系列名
+ *
+ * @return   SimSeries& / uint64_t&
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+SimSeries &xSimSeries(const std::string &name)
+{
+    auto it = gSeriesIndex.find(name);
+    if (it != gSeriesIndex.end())
+        return *gSeries[it->second].second;
+    gSeriesIndex[name] = gSeries.size();
+    gSeries.emplace_back(name, std::unique_ptr<SimSeries>(new SimSeries()));
+    return *gSeries.back().second;
+}
+
+uint64_t &ullSimCounter(const std::string &name)
+{
+    auto it = gCounterIndex.find(name);
+    if (it != gCounterIndex.end())
+        return gCounters[it->second].second;
+    gCounterIndex[name] = gCounters.size();
+    gCounters.emplace_back(name, 0);
+    return gCounters.back().second;
+}
+
+/*****************************************************************************/
+/**
+ * 系列の表形式出力 (ms表示)
+ *
+ * @param    pxOut: 出力先
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSimSeriesPrintHeader(FILE *pxOut, const char *pcTitle)
+{
+    fprintf(pxOut, "--- %s [ms] ---\n", pcTitle);
+    fprintf(pxOut, "%-34s %7s %9s %9s %9s %9s %9s %9s\n", "", "n", "mean",
+            "sd", "p50", "p90", "p99", "max");
+}
+
+void vSimSeriesPrint(FILE *pxOut, const char *pcName, SimSeries &series)
+{
+    fprintf(pxOut, "%-34s %7zu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", pcName,
+            series.uxCount(), series.dMean() / 1000.0,
+            series.dStdDev() / 1000.0, series.ullPercentile(50) / 1000.0,
+            series.ullPercentile(90) / 1000.0,
+            series.ullPercentile(99) / 1000.0, series.ullMax() / 1000.0);
+}
+
+void vSimStatsReport(FILE *pxOut)
+{
+    vSimSeriesPrintHeader(pxOut, "latency / interval");
+    for (auto &entry : gSeries)
+    {
+        vSimSeriesPrint(pxOut, entry.first.c_str(), *entry.second);
+    }
+
+    fprintf(pxOut, "--- counters ---\n");
+    for (auto &entry : gCounters)
+    {
+        fprintf(pxOut, "%-34s %10llu\n", entry.first.c_str(),
+                (unsigned long long)entry.second);
+    }
+}
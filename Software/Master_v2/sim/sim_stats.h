@@ -0,0 +1,72 @@
+/*****************************************************************************/
+/**
+ * @file sim_stats.h
+ * @comments Virtual Arena 統計(系列・カウンタ)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_STATS_H
+#define SIM_STATS_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * 時間系列 (単位はus)
+ * 百分位点は出力時にソートして求める。
+ */
+class SimSeries
+{
+  public:
+    void vAdd(uint64_t ullValue)
+    {
+        m_samples.push_back(ullValue);
+        m_ullSum += ullValue;
+        m_bSorted = false;
+    }
+    size_t uxCount() const { return m_samples.size(); }
+    double dMean() const
+    {
+        return m_samples.empty() ? 0.0
+                                 : (double)m_ullSum / (double)m_samples.size();
+    }
+    double dStdDev() const;
+    uint64_t ullPercentile(double dPct);
+    uint64_t ullMax();
+    void vClear()
+    {
+        m_samples.clear();
+        m_ullSum = 0;
+    }
+
+  private:
+    std::vector<uint64_t> m_samples;
+    uint64_t m_ullSum = 0;
+    bool m_bSorted = true;
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+SimSeries &xSimSeries(const std::string &name);
+uint64_t &ullSimCounter(const std::string &name);
+void vSimSeriesPrintHeader(FILE *pxOut, const char *pcTitle);
+void vSimSeriesPrint(FILE *pxOut, const char *pcName, SimSeries &series);
+void vSimStatsReport(FILE *pxOut);
+
+#endif
@@ -0,0 +1,192 @@
+/*****************************************************************************/
+/**
+ * @file test_adapt.cpp
+ * @comments ctrl_adapt(適応難易度)のホストテスト
+ *
+ *           反応時間と体力の合成データを流し、
+ *             - 生成周期／点灯時間が難易度毎の範囲(ctrl_dfclt)から出ないこと
+ *             - 上手なプレイヤーは下限、苦戦するプレイヤーは上限に収束すること
+ *             - 点灯時間が反応時間の平均＋偏差に追従すること
+ *             - 体力が減ったら周期を戻し、その後ADAPT_DAMAGE_HOLD標本は速くしないこと
+ *           を確かめる。
+ *
+ *   make test && ./build/test_adapt
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+
+#include "ctrl_adapt.h"
+#include "ctrl_dfclt.h"
+#include "test_util.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TEST_SAMPLES 300         // 収束を見る標本数
+#define TEST_HOLD 8              // ctrl_adapt.cのADAPT_DAMAGE_HOLD
+#define TEST_FAST_RT_MS 350      // 上手なプレイヤーの反応時間
+#define TEST_SLOW_RT_MS 1800     // 苦戦するプレイヤーの反応時間
+#define TEST_JITTER_MS 50        // 反応時間の揺れ(交互に±)
+#define TEST_LIGHT_MARGIN_MS 200 // ctrl_adapt.cのADAPT_LIGHT_MARGIN_US
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/* 難易度のプロファイルと範囲で初期化 */
+static void prvInit(eDfclt_t eDfclt, adaptCtrl_t *pxCtrl, adaptBounds_t *pxBounds)
+{
+    const dfcltProfile_t &rxProfile = rxDfcltDefault(eDfclt);
+
+    vDfcltGetAdaptBounds(eDfclt, &rxProfile, pxBounds);
+    vAdaptInit(pxCtrl, pxBounds, rxProfile.usSpawnMs, rxProfile.usLightMs);
+}
+
+/* 生成周期／点灯時間が範囲内か */
+static bool prvInBounds(const adaptCtrl_t *pxCtrl, const adaptBounds_t *pxBounds)
+{
+    uint32_t ulSpawnUs = ulAdaptSpawnUs(pxCtrl);
+    uint16_t usLightMs = usAdaptLightMs(pxCtrl);
+
+    return ulSpawnUs >= pxBounds->usSpawnMinMs * 1000UL &&
+           ulSpawnUs <= pxBounds->usSpawnMaxMs * 1000UL &&
+           usLightMs >= pxBounds->usLightMinMs && usLightMs <= pxBounds->usLightMaxMs &&
+           usLightMs % configLIGHT_TIME_UNIT_MS == 0;
+}
+
+/* 反応時間の標本(中心±揺れを交互に) */
+static int64_t prvRtUs(uint32_t ulRtMs, uint32_t ulIndex)
+{
+    int32_t lMs = (int32_t)ulRtMs + ((ulIndex & 1) ? TEST_JITTER_MS : -TEST_JITTER_MS);
+    return (int64_t)lMs * 1000;
+}
+
+/*
+ * 上手なプレイヤー(全部踏む、反応が速い)は下限へ、
+ * 苦戦するプレイヤー(半分見逃す、反応が遅い)は上限へ収束する
+ */
+static void prvTestConverge(eDfclt_t eDfclt)
+{
+    adaptCtrl_t xCtrl;
+    adaptBounds_t xBounds;
+    bool bInBounds = true;
+
+    prvInit(eDfclt, &xCtrl, &xBounds);
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        vAdaptOnHit(&xCtrl, prvRtUs(TEST_FAST_RT_MS, i), pdTRUE);
+        bInBounds = bInBounds && prvInBounds(&xCtrl, &xBounds);
+    }
+    TEST_CHECK(bInBounds);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), xBounds.usSpawnMinMs * 1000UL);
+    TEST_CHECK_EQ(usAdaptLightMs(&xCtrl), xBounds.usLightMinMs);
+    TEST_CHECK(ulAdaptHitPct(&xCtrl) >= xBounds.bHitTargetPct);
+
+    prvInit(eDfclt, &xCtrl, &xBounds);
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        if (i & 1)
+            vAdaptOnMiss(&xCtrl);
+        else
+            vAdaptOnHit(&xCtrl, prvRtUs(TEST_SLOW_RT_MS, i / 2), pdTRUE);
+        bInBounds = bInBounds && prvInBounds(&xCtrl, &xBounds);
+    }
+    TEST_CHECK(bInBounds);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), xBounds.usSpawnMaxMs * 1000UL);
+    TEST_CHECK_EQ(usAdaptLightMs(&xCtrl), xBounds.usLightMaxMs);
+    TEST_CHECK(ulAdaptHitPct(&xCtrl) < xBounds.bHitTargetPct);
+}
+
+/* 標本が揃うまでは動かさず、その後は点灯時間が平均＋4偏差＋余裕に追従する */
+static void prvTestLightTracks(void)
+{
+    adaptCtrl_t xCtrl;
+    adaptBounds_t xBounds;
+    const uint32_t ulRtMs = 1000;
+    const uint32_t ulExpectMs = ulRtMs + 4 * TEST_JITTER_MS + TEST_LIGHT_MARGIN_MS;
+
+    prvInit(DFCLT_EASY, &xCtrl, &xBounds);
+    TEST_CHECK(xBounds.usLightMinMs < ulExpectMs && ulExpectMs < xBounds.usLightMaxMs);
+
+    uint32_t ulSpawnUs = ulAdaptSpawnUs(&xCtrl);
+    uint16_t usLightMs = usAdaptLightMs(&xCtrl);
+    for (uint32_t i = 0; i < 3; i++)
+        vAdaptOnHit(&xCtrl, prvRtUs(ulRtMs, i), pdTRUE);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), ulSpawnUs);
+    TEST_CHECK_EQ(usAdaptLightMs(&xCtrl), usLightMs);
+
+    for (uint32_t i = 3; i < TEST_SAMPLES; i++)
+        vAdaptOnHit(&xCtrl, prvRtUs(ulRtMs, i), pdTRUE);
+    TEST_CHECK(prvInBounds(&xCtrl, &xBounds));
+    TEST_CHECK(usAdaptLightMs(&xCtrl) + (uint32_t)configLIGHT_TIME_UNIT_MS >= ulExpectMs);
+    TEST_CHECK(usAdaptLightMs(&xCtrl) <= ulExpectMs + configLIGHT_TIME_UNIT_MS);
+}
+
+/*
+ * 体力が減ったら残り体力に応じて周期を戻し、
+ * その後ADAPT_DAMAGE_HOLD標本は押下率が高くても速くしない
+ */
+static void prvTestDamage(void)
+{
+    adaptCtrl_t xCtrl;
+    adaptBounds_t xBounds;
+    uint32_t ulSpawnUs;
+    uint32_t ulMinUs;
+
+    prvInit(DFCLT_NORMAL, &xCtrl, &xBounds);
+    ulMinUs = xBounds.usSpawnMinMs * 1000UL;
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+        vAdaptOnHit(&xCtrl, prvRtUs(TEST_FAST_RT_MS, i), pdTRUE);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), ulMinUs);
+
+    // 体力半分で1/4戻す
+    vAdaptOnDamage(&xCtrl, 5, 10);
+    ulSpawnUs = ulAdaptSpawnUs(&xCtrl);
+    TEST_CHECK_EQ(ulSpawnUs, ulMinUs + ulMinUs / 4);
+
+    // 戻した後のADAPT_DAMAGE_HOLD標本は速くしない
+    for (uint32_t i = 0; i < TEST_HOLD; i++)
+    {
+        vAdaptOnHit(&xCtrl, prvRtUs(TEST_FAST_RT_MS, i), pdTRUE);
+        TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), ulSpawnUs);
+    }
+    vAdaptOnHit(&xCtrl, prvRtUs(TEST_FAST_RT_MS, TEST_HOLD), pdTRUE);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), ulSpawnUs - (ulSpawnUs >> 5));
+
+    // 残り体力が少ないほど大きく戻す(残り1で9/20)
+    prvInit(DFCLT_NORMAL, &xCtrl, &xBounds);
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+        vAdaptOnHit(&xCtrl, prvRtUs(TEST_FAST_RT_MS, i), pdTRUE);
+    vAdaptOnDamage(&xCtrl, 1, 10);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), ulMinUs + ulMinUs * 9 / 20);
+
+    // 何度減っても上限を超えない、体力が減っていなければ何もしない
+    for (uint32_t i = 0; i < 10; i++)
+        vAdaptOnDamage(&xCtrl, 0, 10);
+    TEST_CHECK_EQ(ulAdaptSpawnUs(&xCtrl), xBounds.usSpawnMaxMs * 1000UL);
+    xCtrl.usHold = 0;
+    vAdaptOnDamage(&xCtrl, 10, 10);
+    TEST_CHECK_EQ(xCtrl.usHold, 0);
+}
+
+/*****************************************************************************/
+/* Main
+******************************************************************************/
+int main(void)
+{
+    for (int i = DFCLT_EASY; i < MAX_DFCLT; i++)
+        prvTestConverge((eDfclt_t)i);
+    prvTestLightTracks();
+    prvTestDamage();
+    return TEST_RESULT("test_adapt");
+}
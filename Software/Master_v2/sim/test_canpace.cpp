@@ -0,0 +1,173 @@
+/*****************************************************************************/
+/**
+ * @file test_canpace.cpp
+ * @comments drv_canpace(CAN送信の宛先Panel毎の間隔)のホストテスト
+ *
+ *           CAN_txタスクと同じ順(取っておいたフレームを送る -> 新しいフレーム)で呼び、
+ *             - Panel A宛てが間隔待ちでも、間に来たPanel B宛ては待たずに送ること
+ *             - 取っておいたフレームは間隔が空いたら届いた順に送ること
+ *             - 同じPanel宛て(グループ宛てを含む)は追い越さないこと
+ *             - 時刻同期の間隔待ち(ulHoldMask)の間は後から来たフレームを止めること
+ *           を確かめる。
+ *
+ *   make test && ./build/test_canpace
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+
+#include "ctrl_group.h"
+#include "drv_canpace.h"
+#include "test_util.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TEST_GAP_US ((int64_t)configCAN_PANEL_GAP_MS * 1000)
+#define TEST_T0_US 1000000LL
+#define TEST_PANEL_A PANEL_7
+#define TEST_PANEL_B PANEL_13
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/* 宛先と目印(bSeq)だけのフレーム */
+static canCommMsg_t prvMsg(uint32_t ulCanId, uint8_t bSeq)
+{
+    canCommMsg_t xMsg = {};
+    xMsg.ulCanId = ulCanId;
+    xMsg.bSeq = bSeq;
+    return xMsg;
+}
+
+/* 取り出したフレームの目印(無ければ0) */
+static uint8_t prvPop(canPace_t *pxPace, uint32_t ulHoldMask, int64_t llNowUs)
+{
+    canCommMsg_t xMsg = {};
+    if (xCanPacePop(pxPace, ulHoldMask, llNowUs, &xMsg) != pdTRUE)
+        return 0;
+    return xMsg.bSeq;
+}
+
+/* A, A, B, A, Bの順に来ても、B宛てはAの間隔待ちで遅れない */
+static void prvTestInterleave(void)
+{
+    canPace_t xPace;
+    canCommMsg_t xA1 = prvMsg(TEST_PANEL_A, 1);
+    canCommMsg_t xA2 = prvMsg(TEST_PANEL_A, 2);
+    canCommMsg_t xB3 = prvMsg(TEST_PANEL_B, 3);
+    canCommMsg_t xA4 = prvMsg(TEST_PANEL_A, 4);
+    canCommMsg_t xB5 = prvMsg(TEST_PANEL_B, 5);
+
+    vCanPaceInit(&xPace, TEST_GAP_US);
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, 0), INT64_MAX);
+
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA1, 0, TEST_T0_US), pdTRUE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA2, 0, TEST_T0_US + 1), pdFALSE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xB3, 0, TEST_T0_US + 2), pdTRUE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA4, 0, TEST_T0_US + 3), pdFALSE);
+    TEST_CHECK_EQ(xPace.ulDeferNum, 2);
+
+    // B宛ての2つ目はB自身の間隔だけ待つ
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xB5, 0, TEST_T0_US + TEST_GAP_US + 2), pdTRUE);
+
+    // A宛ては間隔が空くまで出さず、届いた順に1つずつ
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, 0), TEST_T0_US + TEST_GAP_US);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US - 1), 0);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 2);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 0);
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, 0), TEST_T0_US + 2 * TEST_GAP_US);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + 2 * TEST_GAP_US), 4);
+    TEST_CHECK_EQ(xPace.ulDeferNum, 0);
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, 0), INT64_MAX);
+}
+
+/* グループ宛ては含まれる全Panelの間隔を待ち、後から来た同じPanel宛てに追い越させない */
+static void prvTestGroupOrder(void)
+{
+    canPace_t xPace;
+    canCommMsg_t xA1 = prvMsg(TEST_PANEL_A, 1);
+    canCommMsg_t xAll2 = prvMsg(CAN_ID_GROUP_ALL, 2);
+    canCommMsg_t xB3 = prvMsg(TEST_PANEL_B, 3);
+    int64_t llReadyUs;
+
+    vCanPaceInit(&xPace, TEST_GAP_US);
+    TEST_CHECK((ulGroupPanelMask(CAN_ID_GROUP_ALL) & (1UL << TEST_PANEL_B)) != 0);
+
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA1, 0, TEST_T0_US), pdTRUE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xAll2, 0, TEST_T0_US), pdFALSE);
+    // Bは間隔が空いているが、前の全体宛てを追い越さない
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xB3, 0, TEST_T0_US), pdFALSE);
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, 0), TEST_T0_US + TEST_GAP_US);
+
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 2);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 0);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + 2 * TEST_GAP_US), 3);
+
+    // 時刻同期と再送は取っておいたフレームを見ない(宛先の間隔だけ)
+    TEST_CHECK_EQ(xCanPaceTake(&xPace, TEST_PANEL_A, TEST_T0_US + 2 * TEST_GAP_US, &llReadyUs),
+                  pdTRUE);
+    TEST_CHECK_EQ(xCanPaceTake(&xPace, CAN_ID_GROUP_ALL, TEST_T0_US + 2 * TEST_GAP_US, &llReadyUs),
+                  pdFALSE);
+    TEST_CHECK_EQ(llReadyUs, TEST_T0_US + 3 * TEST_GAP_US);
+}
+
+/* 時刻同期の間隔待ちの間は、後から来たフレームも取っておいたフレームも止める */
+static void prvTestHold(void)
+{
+    canPace_t xPace;
+    canCommMsg_t xA1 = prvMsg(TEST_PANEL_A, 1);
+    canCommMsg_t xB2 = prvMsg(TEST_PANEL_B, 2);
+    uint32_t ulHold = ulGroupPanelMask(CAN_ID_GROUP_ALL);
+
+    vCanPaceInit(&xPace, TEST_GAP_US);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA1, 0, TEST_T0_US), pdTRUE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA1, 0, TEST_T0_US), pdFALSE);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xB2, ulHold, TEST_T0_US), pdFALSE);
+    TEST_CHECK_EQ(llCanPaceNextUs(&xPace, ulHold), INT64_MAX);
+    TEST_CHECK_EQ(prvPop(&xPace, ulHold, TEST_T0_US + TEST_GAP_US), 0);
+
+    // 時刻同期を送った後は届いた順に
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 1);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 2);
+}
+
+/* 取っておく場所が埋まったら知らせる */
+static void prvTestFull(void)
+{
+    canPace_t xPace;
+    canCommMsg_t xA = prvMsg(TEST_PANEL_A, 1);
+
+    vCanPaceInit(&xPace, TEST_GAP_US);
+    TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA, 0, TEST_T0_US), pdTRUE);
+    for (uint32_t i = 0; i < CAN_PACE_DEFER_SIZE; i++)
+    {
+        TEST_CHECK_EQ(xCanPaceFull(&xPace), pdFALSE);
+        TEST_CHECK_EQ(xCanPaceSubmit(&xPace, &xA, 0, TEST_T0_US), pdFALSE);
+    }
+    TEST_CHECK_EQ(xCanPaceFull(&xPace), pdTRUE);
+    TEST_CHECK_EQ(prvPop(&xPace, 0, TEST_T0_US + TEST_GAP_US), 1);
+    TEST_CHECK_EQ(xCanPaceFull(&xPace), pdFALSE);
+}
+
+/*****************************************************************************/
+/* Main
+******************************************************************************/
+int main(void)
+{
+    prvTestInterleave();
+    prvTestGroupOrder();
+    prvTestHold();
+    prvTestFull();
+    return TEST_RESULT("test_canpace");
+}
@@ -0,0 +1,154 @@
+/*****************************************************************************/
+/**
+ * @file test_panel.cpp
+ * @comments ctrl_panel(パネル状態テーブル)のホストテスト
+ *
+ *           ctrl_mainと同じ順(点灯登録 -> 押下 / llPanelTblExpireUsの時刻に点灯終了)で
+ *           呼び、押下判定の結果
+ *             - 期限内: PANEL_HIT_OK
+ *             - 期限を過ぎ、点灯終了より前: PANEL_HIT_LATE
+ *             - 点灯終了後、判定済み、未点灯: PANEL_HIT_NOT_LIT
+ *             - 範囲外のPanelID: PANEL_HIT_INVALID
+ *           と、点灯終了が判定済み／再点灯済みの点灯を見逃しに数えないことを確かめる。
+ *
+ *   make test && ./build/test_panel
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdio.h>
+
+#include "ctrl_panel.h"
+#include "test_util.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TEST_SPAWN_US 1000000LL
+#define TEST_LIGHT_US 1500000LL // 点灯時間＋余裕(ctrl_mainのllDeadlineUs - 点灯要求時刻)
+#define TEST_DEADLINE_US (TEST_SPAWN_US + TEST_LIGHT_US)
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/* 1枚点灯させたテーブル */
+static uint8_t prvSpawn(panelTbl_t *pxTbl, uint32_t ulPanelId, enum COLOR eColor)
+{
+    return bPanelTblSpawn(pxTbl, ulPanelId, eColor, TEST_SPAWN_US, TEST_DEADLINE_US);
+}
+
+/* 期限内の押下は点灯させた色と反応時間を返し、2回目は判定済み */
+static void prvTestOk(void)
+{
+    panelTbl_t xTbl = {};
+    panelHit_t xHit = {};
+    uint8_t bGen;
+
+    vPanelTblClear(&xTbl);
+    bGen = prvSpawn(&xTbl, PANEL_5, GREEN);
+    TEST_CHECK_EQ(ulPanelTblLitMask(&xTbl), 1UL << PANEL_5);
+
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_5, TEST_DEADLINE_US, &xHit), PANEL_HIT_OK);
+    TEST_CHECK_EQ(xHit.eColor, GREEN);
+    TEST_CHECK_EQ(xHit.bGen, bGen);
+    TEST_CHECK_EQ(xHit.llReactionUs, TEST_LIGHT_US);
+    TEST_CHECK_EQ(ulPanelTblLitMask(&xTbl), 0);
+
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_5, TEST_DEADLINE_US, &xHit), PANEL_HIT_NOT_LIT);
+    // 判定済みの点灯は点灯終了で見逃しにしない
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_5, bGen), pdFALSE);
+}
+
+/* 期限を過ぎ、点灯終了より前の押下はLATE(判定済みになる) */
+static void prvTestLate(void)
+{
+    panelTbl_t xTbl = {};
+    panelHit_t xHit = {};
+    int64_t llExpireUs;
+    uint8_t bGen;
+
+    vPanelTblClear(&xTbl);
+    bGen = prvSpawn(&xTbl, PANEL_7, RED);
+    llExpireUs = llPanelTblExpireUs(&xTbl, PANEL_7);
+    TEST_CHECK(llExpireUs > TEST_DEADLINE_US);
+
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_7, TEST_DEADLINE_US + 1, &xHit), PANEL_HIT_LATE);
+    TEST_CHECK_EQ(xHit.eColor, RED);
+    TEST_CHECK_EQ(xHit.bGen, bGen);
+    TEST_CHECK_EQ(xHit.llReactionUs, TEST_LIGHT_US + 1);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_7, TEST_DEADLINE_US + 2, &xHit), PANEL_HIT_NOT_LIT);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_7, bGen), pdFALSE);
+
+    // 点灯終了の直前まではLATE
+    bGen = prvSpawn(&xTbl, PANEL_7, RED);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_7, llExpireUs - 1, &xHit), PANEL_HIT_LATE);
+}
+
+/* 押されずに点灯終了したら見逃し、その後の押下はNOT_LIT */
+static void prvTestExpire(void)
+{
+    panelTbl_t xTbl = {};
+    panelHit_t xHit = {};
+    uint8_t bGen;
+    uint8_t bGenNext;
+
+    vPanelTblClear(&xTbl);
+    bGen = prvSpawn(&xTbl, PANEL_3, BLUE);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_3, bGen), pdTRUE);
+    TEST_CHECK_EQ(ulPanelTblLitMask(&xTbl), 0);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_3, llPanelTblExpireUs(&xTbl, PANEL_3), &xHit),
+                  PANEL_HIT_NOT_LIT);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_3, bGen), pdFALSE);
+
+    // 点灯終了の前に再点灯したら、古い点灯終了は新しい点灯を消さない
+    bGen = prvSpawn(&xTbl, PANEL_3, BLUE);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_3, TEST_SPAWN_US, &xHit), PANEL_HIT_OK);
+    bGenNext = prvSpawn(&xTbl, PANEL_3, GREEN);
+    TEST_CHECK(bGenNext != bGen);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_3, bGen), pdFALSE);
+    TEST_CHECK_EQ(ulPanelTblLitMask(&xTbl), 1UL << PANEL_3);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_3, bGenNext), pdTRUE);
+}
+
+/* 未点灯、範囲外、ゲームを跨いだ押下 */
+static void prvTestReject(void)
+{
+    panelTbl_t xTbl = {};
+    panelHit_t xHit = {};
+    uint8_t bGen;
+
+    vPanelTblClear(&xTbl);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_1, TEST_SPAWN_US, &xHit), PANEL_HIT_NOT_LIT);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, 0, TEST_SPAWN_US, &xHit), PANEL_HIT_INVALID);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, MAX_PANEL_NUM, TEST_SPAWN_US, &xHit), PANEL_HIT_INVALID);
+    TEST_CHECK_EQ(prvSpawn(&xTbl, MAX_PANEL_NUM, RED), 0);
+    TEST_CHECK_EQ(llPanelTblExpireUs(&xTbl, 0), 0);
+
+    // 初期化で消灯するが世代は残る(前ゲームの点灯終了を弾く)
+    bGen = prvSpawn(&xTbl, PANEL_2, RED);
+    vPanelTblClear(&xTbl);
+    TEST_CHECK_EQ(ePanelTblHit(&xTbl, PANEL_2, TEST_SPAWN_US, &xHit), PANEL_HIT_NOT_LIT);
+    TEST_CHECK(prvSpawn(&xTbl, PANEL_2, RED) != bGen);
+    TEST_CHECK_EQ(xPanelTblExpire(&xTbl, PANEL_2, bGen), pdFALSE);
+}
+
+/*****************************************************************************/
+/* Main
+******************************************************************************/
+int main(void)
+{
+    prvTestOk();
+    prvTestLate();
+    prvTestExpire();
+    prvTestReject();
+    return TEST_RESULT("test_panel");
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************/
+/**
+ * @file test_util.h
+ * @comments ホストテストの共通部(判定マクロとESP_LOGの出力先)
+ *
+ *           テストはsimのスケジューラを使わず、ファームウェアのモジュールを
+ *           直接呼ぶ。1つでも失敗すれば終了コード1で終わる(make testが止まる)。
+ *           テスト毎に1つの実行ファイルなので、main()のあるファイルで1回だけ
+ *           includeする。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_TEST_UTIL_H
+#define SIM_TEST_UTIL_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static unsigned guTestChecks = 0;
+static unsigned guTestFails = 0;
+
+/*****************************************************************************/
+/* Macro Definitions
+******************************************************************************/
+/* 条件の判定(失敗しても続ける) */
+#define TEST_CHECK(cond)                                                       \
+    do                                                                         \
+    {                                                                          \
+        guTestChecks++;                                                        \
+        if (!(cond))                                                           \
+        {                                                                      \
+            guTestFails++;                                                     \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);    \
+        }                                                                      \
+    } while (0)
+
+/* 整数の一致(値も出す) */
+#define TEST_CHECK_EQ(actual, expected)                                        \
+    do                                                                         \
+    {                                                                          \
+        long long llA_ = (long long)(actual), llE_ = (long long)(expected);    \
+        guTestChecks++;                                                        \
+        if (llA_ != llE_)                                                      \
+        {                                                                      \
+            guTestFails++;                                                     \
+            fprintf(stderr, "FAIL %s:%d: %s == %lld, expected %lld\n",         \
+                    __FILE__, __LINE__, #actual, llA_, llE_);                  \
+        }                                                                      \
+    } while (0)
+
+/* 結果の表示と終了コード */
+#define TEST_RESULT(name)                                                      \
+    (printf("%s: %u checks, %u failed\n", name, guTestChecks, guTestFails),    \
+     guTestFails == 0 ? 0 : 1)
+
+/*****************************************************************************/
+/* ESP_LOG (sim_rtos.cppの代わり、失敗の手掛かりとして標準エラーに出す)
+******************************************************************************/
+extern "C" void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    (void)level;
+}
+
+extern "C" uint32_t esp_log_timestamp(void) { return 0; }
+
+extern "C" void esp_log_write(esp_log_level_t level, const char *tag,
+                              const char *format, ...)
+{
+    va_list xArgs;
+    (void)level;
+    fprintf(stderr, "%s: ", tag);
+    va_start(xArgs, format);
+    vfprintf(stderr, format, xArgs);
+    va_end(xArgs);
+    fputc('\n', stderr);
+}
+
+#endif
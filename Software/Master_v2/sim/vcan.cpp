@@ -0,0 +1,722 @@
+/*****************************************************************************/
+/**
+ * @file vcan.cpp
+ * @comments 仮想CANバス(ビット時間単位の近似モデル)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <string.h>
+
+#include "vcan.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define VCAN_CRC15_POLY 0x4599
+#define VCAN_STD_ID_MASK 0x7FF
+#define VCAN_FRAME_MAX_BITS 128 // スタッフ前(SOF〜CRC)の最大は98
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static VcanBus *gpxDefaultBus = nullptr;
+
+/*****************************************************************************/
+/* Public Function (Frame)
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * フレーム長の計算
+ * 標準フォーマットのビット列を組み立ててCRC-15とスタッフビットを求める。
+ *
+ * @param    pxMsg: フレーム
+ *
+ * @return   フレーム長[bit] (フレーム間スペース含む)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulVcanFrameBits(const can_message_t *pxMsg)
+{
+    uint8_t bBits[VCAN_FRAME_MAX_BITS];
+    uint32_t ulNum = 0;
+
+    auto push = [&bBits, &ulNum](uint32_t ulValue, int iWidth) {
+        for (int i = iWidth - 1; i >= 0; i--)
+            bBits[ulNum++] = (ulValue >> i) & 1;
+    };
+    uint8_t bDlc = pxMsg->data_length_code;
+    push(0, 1);                                         // SOF
+    push(pxMsg->identifier & VCAN_STD_ID_MASK, 11);     // ID
+    push((pxMsg->flags & CAN_MSG_FLAG_RTR) ? 1 : 0, 1); // RTR
+    push(0, 1);                                         // IDE
+    push(0, 1);                                         // r0
+    push(bDlc, 4);                                      // DLC
+    if (!(pxMsg->flags & CAN_MSG_FLAG_RTR))
+    {
+        for (int i = 0; i < bDlc && i < CAN_MAX_DATA_LEN; i++)
+            push(pxMsg->data[i], 8);
+    }
+
+    uint16_t usCrc = 0;
+    for (uint32_t i = 0; i < ulNum; i++)
+    {
+        bool bNext = bBits[i] ^ ((usCrc >> 14) & 1);
+        usCrc = (usCrc << 1) & 0x7FFF;
+        if (bNext)
+            usCrc ^= VCAN_CRC15_POLY;
+    }
+    push(usCrc, 15);
+
+    // スタッフビット: 同値が5連続したら反転ビットを挿入(挿入ビットも連続数に含む)
+    uint32_t ulStuff = 0;
+    int iRun = 0;
+    uint8_t bLast = 2;
+    for (uint32_t i = 0; i < ulNum; i++)
+    {
+        uint8_t b = bBits[i];
+        if (b == bLast)
+        {
+            iRun++;
+        }
+        else
+        {
+            bLast = b;
+            iRun = 1;
+        }
+        if (iRun == 5)
+        {
+            ulStuff++;
+            bLast = !b;
+            iRun = 1;
+        }
+    }
+    return ulNum + ulStuff + VCAN_FRAME_TAIL_BITS;
+}
+
+/*****************************************************************************/
+/**
+ * ESP32 CANコントローラの単一フィルタ(標準フォーマット)
+ *
+ * @param    ulCode / ulMask: can_filter_config_tのacceptance_code / acceptance_mask
+ * @param    ulId: CAN ID
+ *
+ * @return   true: 受ける
+ *
+ * @note     IDはbit31..21。maskの1は「見ない」
+ *
+ ******************************************************************************/
+bool bVcanTwaiFilterMatch(uint32_t ulCode, uint32_t ulMask, uint32_t ulId)
+{
+    uint32_t ulBits = (ulId & VCAN_STD_ID_MASK) << 21;
+    uint32_t ulCare = ~ulMask & 0xFFE00000;
+    return ((ulBits ^ ulCode) & ulCare) == 0;
+}
+
+void vVcanSetDefaultBus(VcanBus *pxBus) { gpxDefaultBus = pxBus; }
+
+VcanBus *pxVcanDefaultBus(void) { return gpxDefaultBus; }
+
+/*****************************************************************************/
+/* Public Function (Node)
+******************************************************************************/
+void VcanNode::vKick(uint64_t ullNs)
+{
+    if (pxBus != nullptr)
+        pxBus->vRequest(ullNs);
+}
+
+/*****************************************************************************/
+/* Public Function (Bus)
+******************************************************************************/
+VcanBus::VcanBus(uint32_t ulBitrate) : m_ullBitNs(1000000000ULL / ulBitrate)
+{
+    memset(&m_xOnBus, 0, sizeof(m_xOnBus));
+}
+
+int VcanBus::iAttach(VcanNode *pxNode)
+{
+    pxNode->pxBus = this;
+    pxNode->iNode = (int)m_nodes.size();
+    m_nodes.push_back(pxNode);
+    return pxNode->iNode;
+}
+
+void VcanBus::vSetWake(WakeFn pfnWake, void *pvCtx)
+{
+    m_pfnWake = pfnWake;
+    m_pvWakeCtx = pvCtx;
+}
+
+/*****************************************************************************/
+/**
+ * 故障注入の設定
+ *
+ * @param    dProb: フレーム毎のエラーの確率
+ * @param    ullSeed: 乱数シード
+ *
+ * @return   ##
+ *
+ * @note     確率が0なら乱数を引かない(故障なしの結果は乱数シードに依らない)
+ *
+ ******************************************************************************/
+void VcanBus::vSetErrorRate(double dProb, uint64_t ullSeed)
+{
+    m_dErrProb = dProb;
+    m_ullRand = ullSeed * 0xBF58476D1CE4E5B9ULL + 0x94D049BB133111EBULL;
+}
+
+/*****************************************************************************/
+/**
+ * 送信待ちが増えた
+ *
+ * @param    ullNowNs: 現在時刻
+ *
+ * @return   ##
+ *
+ * @note     バスが空いていればすぐに調停する。
+ *           送信中、またはコールバックの中なら終わった後で調停する。
+ *
+ ******************************************************************************/
+void VcanBus::vRequest(uint64_t ullNowNs)
+{
+    if (m_bLocked || m_eState != BUS_IDLE)
+        return;
+    vAdvance(ullNowNs);
+    if (m_eState == BUS_IDLE)
+        prvArbitrate(m_ullNowNs);
+}
+
+/*****************************************************************************/
+/**
+ * 指定時刻に調停する(バスオフからの復帰など)
+ *
+ * @param    ullAtNs: 調停する時刻
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void VcanBus::vRequestAt(uint64_t ullAtNs)
+{
+    if (ullAtNs < m_ullKickNs)
+    {
+        m_ullKickNs = ullAtNs;
+        if (m_eState == BUS_IDLE)
+            prvSchedule(ullAtNs);
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 時刻を進める
+ * ullNowNsまでに終わるフレーム、調停を順に処理する。
+ *
+ * @param    ullNowNs: 進める時刻
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void VcanBus::vAdvance(uint64_t ullNowNs)
+{
+    if (m_bLocked)
+        return;
+    for (;;)
+    {
+        uint64_t ullNs = ullNextNs();
+        if (ullNs > ullNowNs)
+            break;
+        if (ullNs < m_ullNowNs)
+            ullNs = m_ullNowNs;
+        m_ullNowNs = ullNs;
+        if (m_eState != BUS_IDLE)
+        {
+            prvFinish(ullNs);
+        }
+        else
+        {
+            m_ullKickNs = VCAN_NEVER;
+            prvArbitrate(ullNs);
+        }
+    }
+    if (ullNowNs > m_ullNowNs)
+        m_ullNowNs = ullNowNs;
+}
+
+/* 次に状態が変わる時刻 */
+uint64_t VcanBus::ullNextNs() const
+{
+    return m_eState != BUS_IDLE ? m_ullDoneNs : m_ullKickNs;
+}
+
+/*****************************************************************************/
+/* Private Function (Bus)
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 調停
+ * バスに参加しているノードの送信待ちのうち(ID, RTR)が最小のものを送り始める。
+ *
+ * @param    ullNs: 現在時刻
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void VcanBus::prvArbitrate(uint64_t ullNs)
+{
+    can_message_t xMsg;
+    uint32_t ulBestKey = UINT32_MAX;
+    uint32_t ulPending = 0;
+    int iBest = -1;
+
+    m_bLocked = true;
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        VcanNode *pxNode = m_nodes[i];
+        if (!pxNode->bOnBus(ullNs) || !pxNode->bTxPeek(&xMsg))
+            continue;
+        // 標準フォーマット: ID(MSB先) -> RTR(データフレームが優先)
+        uint32_t ulKey = ((xMsg.identifier & VCAN_STD_ID_MASK) << 1) |
+                         ((xMsg.flags & CAN_MSG_FLAG_RTR) ? 1 : 0);
+        ulPending++;
+        if (ulKey < ulBestKey)
+        {
+            ulBestKey = ulKey;
+            iBest = (int)i;
+            m_xOnBus = xMsg;
+        }
+        else if (ulKey == ulBestKey)
+        {
+            m_xStats.ullIdClash++;
+        }
+    }
+    if (iBest < 0)
+    {
+        m_eState = BUS_IDLE;
+        m_bLocked = false;
+        if (m_ullKickNs != VCAN_NEVER)
+            prvSchedule(m_ullKickNs);
+        return;
+    }
+
+    m_xStats.ullArbitrations++;
+    if (ulPending > 1)
+    {
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            VcanNode *pxNode = m_nodes[i];
+            if ((int)i != iBest && pxNode->bOnBus(ullNs) && pxNode->bTxPeek(&xMsg))
+            {
+                pxNode->ulArbLost++;
+                m_xStats.ullArbLost++;
+            }
+        }
+    }
+    m_iWinner = iBest;
+    m_nodes[iBest]->vTxBegin(ullNs);
+
+    uint32_t ulBits = ulVcanFrameBits(&m_xOnBus);
+    m_eState = BUS_FRAME;
+    if (m_dErrProb > 0.0 && prvRand() < m_dErrProb)
+    {
+        // フレーム中(SOF〜ACKデリミタ)のどこかでエラー -> エラーフレーム
+        uint32_t ulBody = ulBits - VCAN_FRAME_TAIL_BITS;
+        uint32_t ulPos = 1 + (uint32_t)(prvRand() * (ulBody - 1));
+        ulBits = ulPos + VCAN_ERROR_FRAME_BITS;
+        m_eState = BUS_ERROR;
+    }
+    m_xStats.ullBits += ulBits;
+    m_xStats.ullBusyNs += ulBits * m_ullBitNs;
+    m_ullDoneNs = ullNs + ulBits * m_ullBitNs;
+    m_bLocked = false;
+    prvSchedule(m_ullDoneNs);
+}
+
+/*****************************************************************************/
+/**
+ * フレームの終わり
+ * 成功なら送信元へ結果を、他のノードへフレームを配る。
+ * エラーならTEC/RECを進め、フレームは送信元に残る(次の調停で再送)。
+ *
+ * @param    ullNs: 現在時刻
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void VcanBus::prvFinish(uint64_t ullNs)
+{
+    VcanNode *pxTx = m_nodes[m_iWinner];
+    BusState eDone = m_eState;
+    can_message_t xMsg = m_xOnBus;
+
+    m_bLocked = true;
+    m_eState = BUS_IDLE;
+    m_ullDoneNs = VCAN_NEVER;
+
+    if (!pxTx->bOnBus(ullNs))
+    {
+        // 送信中にバスから外れた(停止、バスオフ)
+        pxTx->vTxDone(false, ullNs);
+    }
+    else if (eDone == BUS_FRAME)
+    {
+        m_xStats.ullFrames++;
+        pxTx->ulTxOk++;
+        if (pxTx->bCountErrors && pxTx->ulTec > 0)
+            pxTx->ulTec--;
+        pxTx->vTxDone(true, ullNs);
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            VcanNode *pxNode = m_nodes[i];
+            if ((int)i == m_iWinner || !pxNode->bOnBus(ullNs))
+                continue;
+            if (pxNode->bCountErrors && pxNode->ulRec > 0)
+                pxNode->ulRec--;
+            pxNode->vRx(&xMsg, ullNs);
+        }
+    }
+    else
+    {
+        m_xStats.ullErrors++;
+        pxTx->ulTxErr++;
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            VcanNode *pxNode = m_nodes[i];
+            if ((int)i != m_iWinner && pxNode->bCountErrors && pxNode->bOnBus(ullNs))
+                pxNode->ulRec++;
+        }
+        if (pxTx->bCountErrors)
+        {
+            pxTx->ulTec += VCAN_TEC_TX_ERROR;
+            if (pxTx->ulTec >= VCAN_BUS_OFF_TEC)
+                pxTx->vBusOff(ullNs);
+        }
+    }
+    m_bLocked = false;
+    prvArbitrate(ullNs);
+}
+
+void VcanBus::prvSchedule(uint64_t ullAtNs)
+{
+    if (m_pfnWake != nullptr)
+        m_pfnWake(m_pvWakeCtx, ullAtNs);
+}
+
+/* xorshift64* */
+double VcanBus::prvRand()
+{
+    m_ullRand ^= m_ullRand >> 12;
+    m_ullRand ^= m_ullRand << 25;
+    m_ullRand ^= m_ullRand >> 27;
+    return (double)((m_ullRand * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*****************************************************************************/
+/* Public Function (TWAI)
+******************************************************************************/
+VcanTwai::VcanTwai(uint32_t ulTxLen, uint32_t ulRxLen, uint32_t ulCode, uint32_t ulMask)
+    : m_ulTxLen(ulTxLen), m_ulRxLen(ulRxLen), m_ulCode(ulCode), m_ulMask(ulMask)
+{
+    memset(&m_xHeld, 0, sizeof(m_xHeld));
+}
+
+bool VcanTwai::bTransmit(const can_message_t *pxMsg, uint64_t ullNs)
+{
+    if (m_tx.size() >= m_ulTxLen)
+        return false;
+    m_tx.push_back(*pxMsg);
+    vKick(ullNs);
+    return true;
+}
+
+bool VcanTwai::bReceive(can_message_t *pxMsg, uint64_t *pullNs)
+{
+    if (m_rx.empty())
+        return false;
+    *pxMsg = m_rx.front().xMsg;
+    if (pullNs != nullptr)
+        *pullNs = m_rx.front().ullNs;
+    m_rx.pop_front();
+    return true;
+}
+
+bool VcanTwai::bTxPeek(can_message_t *pxMsg)
+{
+    if (m_bHeld)
+    {
+        *pxMsg = m_xHeld;
+        return true;
+    }
+    if (m_tx.empty())
+        return false;
+    *pxMsg = m_tx.front();
+    return true;
+}
+
+/* TXキューの先頭を送信バッファへ(キューが1つ空く) */
+void VcanTwai::vTxBegin(uint64_t ullNs)
+{
+    (void)ullNs;
+    if (!m_bHeld)
+    {
+        m_xHeld = m_tx.front();
+        m_tx.pop_front();
+        m_bHeld = true;
+    }
+}
+
+void VcanTwai::vTxDone(bool bOk, uint64_t ullNs)
+{
+    (void)bOk;
+    (void)ullNs;
+    m_bHeld = false;
+}
+
+void VcanTwai::vRx(const can_message_t *pxMsg, uint64_t ullNs)
+{
+    if (!bVcanTwaiFilterMatch(m_ulCode, m_ulMask, pxMsg->identifier))
+        return;
+    if (m_rx.size() >= m_ulRxLen)
+    {
+        ulRxMissed++;
+        return;
+    }
+    m_rx.push_back({*pxMsg, ullNs});
+}
+
+/*****************************************************************************/
+/* Public Function (MCP2515)
+******************************************************************************/
+VcanMcp2515::VcanMcp2515() { vReset(); }
+
+/* リセット後: マスク/フィルタ0(全部受ける)、バッファ空、ロールオーバーなし */
+void VcanMcp2515::vReset()
+{
+    memset(m_ulMask, 0, sizeof(m_ulMask));
+    memset(m_ulFilt, 0, sizeof(m_ulFilt));
+    memset(m_xRxb, 0, sizeof(m_xRxb));
+    memset(m_ullRxNs, 0, sizeof(m_ullRxNs));
+    memset(m_bRxFull, 0, sizeof(m_bRxFull));
+    memset(m_xTxb, 0, sizeof(m_xTxb));
+    memset(m_bTxPrio, 0, sizeof(m_bTxPrio));
+    memset(m_bTxReq, 0, sizeof(m_bTxReq));
+    m_bBukt = false;
+    m_iTxOnBus = -1;
+    m_bBusOff = false;
+    ulTec = 0;
+    ulRec = 0;
+}
+
+void VcanMcp2515::vSetMask(int iNum, uint32_t ulMask)
+{
+    if (iNum >= 0 && iNum < VCAN_MCP_MASK_NUM)
+        m_ulMask[iNum] = ulMask & VCAN_STD_ID_MASK;
+}
+
+void VcanMcp2515::vSetFilter(int iNum, uint32_t ulFilt)
+{
+    if (iNum >= 0 && iNum < VCAN_MCP_FILT_NUM)
+        m_ulFilt[iNum] = ulFilt & VCAN_STD_ID_MASK;
+}
+
+void VcanMcp2515::vSetInt(IntFn pfnInt, void *pvCtx)
+{
+    m_pfnInt = pfnInt;
+    m_pvIntCtx = pvCtx;
+}
+
+/*****************************************************************************/
+/**
+ * 受信バッファの読み出し(READ RX BUFFER)
+ *
+ * @param    pxMsg: 格納先
+ * @param    pullNs: 受信した時刻(NULL可)
+ *
+ * @return   false: 空
+ *
+ * @note     RXB0を先に読む。読んだバッファのRXnIFを下ろす
+ *           (もう一方が埋まっていればINTはLのまま)
+ *
+ ******************************************************************************/
+bool VcanMcp2515::bRead(can_message_t *pxMsg, uint64_t *pullNs)
+{
+    int i = m_bRxFull[0] ? 0 : (m_bRxFull[1] ? 1 : -1);
+    if (i < 0)
+        return false;
+    *pxMsg = m_xRxb[i];
+    if (pullNs != nullptr)
+        *pullNs = m_ullRxNs[i];
+    m_bRxFull[i] = false;
+    return true;
+}
+
+/*****************************************************************************/
+/**
+ * 送信バッファへの書き込みと送信要求(LOAD TX BUFFER + RTS)
+ *
+ * @param    pxMsg: フレーム
+ * @param    bPrio: TXP(0..3、大きい方が先)
+ * @param    ullNs: 現在時刻
+ *
+ * @return   false: 空いている送信バッファがない
+ *
+ * @note     TXB0から順に空いているものを使う
+ *
+ ******************************************************************************/
+bool VcanMcp2515::bLoad(const can_message_t *pxMsg, uint8_t bPrio, uint64_t ullNs)
+{
+    for (int i = 0; i < VCAN_MCP_TXB_NUM; i++)
+    {
+        if (m_bTxReq[i])
+            continue;
+        m_xTxb[i] = *pxMsg;
+        m_bTxPrio[i] = bPrio & 0x03;
+        m_bTxReq[i] = true;
+        vKick(ullNs);
+        return true;
+    }
+    return false;
+}
+
+uint32_t VcanMcp2515::ulTxPending() const
+{
+    uint32_t ulNum = 0;
+    for (int i = 0; i < VCAN_MCP_TXB_NUM; i++)
+        ulNum += m_bTxReq[i] ? 1 : 0;
+    return ulNum;
+}
+
+bool VcanMcp2515::bTxPeek(can_message_t *pxMsg)
+{
+    int i = prvTxNext();
+    if (i < 0)
+        return false;
+    *pxMsg = m_xTxb[i];
+    return true;
+}
+
+void VcanMcp2515::vTxBegin(uint64_t ullNs)
+{
+    (void)ullNs;
+    m_iTxOnBus = prvTxNext();
+}
+
+void VcanMcp2515::vTxDone(bool bOk, uint64_t ullNs)
+{
+    (void)ullNs;
+    if (bOk && m_iTxOnBus >= 0)
+        m_bTxReq[m_iTxOnBus] = false;
+    m_iTxOnBus = -1;
+}
+
+/*****************************************************************************/
+/**
+ * 受信(受け入れフィルタ -> 受信バッファ)
+ *
+ * @param    pxMsg: フレーム
+ * @param    ullNs: 受信完了時刻
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void VcanMcp2515::vRx(const can_message_t *pxMsg, uint64_t ullNs)
+{
+    uint32_t ulId = pxMsg->identifier & VCAN_STD_ID_MASK;
+    bool bPending = bRxPending();
+    bool bStored;
+
+    if (prvMatch(0, 0, ulId) || prvMatch(0, 1, ulId))
+    {
+        bStored = prvStore(0, pxMsg, ullNs);
+        if (!bStored && m_bBukt)
+            bStored = prvStore(1, pxMsg, ullNs);
+        if (!bStored)
+            ulRxOverflow[m_bBukt ? 1 : 0]++;
+    }
+    else if (prvMatch(1, 2, ulId) || prvMatch(1, 3, ulId) || prvMatch(1, 4, ulId) ||
+             prvMatch(1, 5, ulId))
+    {
+        bStored = prvStore(1, pxMsg, ullNs);
+        if (!bStored)
+            ulRxOverflow[1]++;
+    }
+    else
+    {
+        ulRxFiltered++;
+        return;
+    }
+
+    // INT: H -> L
+    if (!bPending && bRxPending() && m_pfnInt != nullptr)
+        m_pfnInt(m_pvIntCtx, ullNs);
+}
+
+/* バスオフ中は参加しない(VCAN_RECOVERY_BITSで自動復帰) */
+bool VcanMcp2515::bOnBus(uint64_t ullNs)
+{
+    if (m_bBusOff && ullNs >= m_ullRecoverNs)
+    {
+        m_bBusOff = false;
+        ulTec = 0;
+        ulRec = 0;
+    }
+    return !m_bBusOff;
+}
+
+void VcanMcp2515::vBusOff(uint64_t ullNs)
+{
+    m_bBusOff = true;
+    m_ullRecoverNs = ullNs + VCAN_RECOVERY_BITS * pxBus->ullBitNs();
+    pxBus->vRequestAt(m_ullRecoverNs);
+}
+
+/*****************************************************************************/
+/* Private Function (MCP2515)
+******************************************************************************/
+bool VcanMcp2515::prvMatch(int iMask, int iFilt, uint32_t ulId) const
+{
+    return ((ulId ^ m_ulFilt[iFilt]) & m_ulMask[iMask]) == 0;
+}
+
+bool VcanMcp2515::prvStore(int iRxb, const can_message_t *pxMsg, uint64_t ullNs)
+{
+    if (m_bRxFull[iRxb])
+        return false;
+    m_xRxb[iRxb] = *pxMsg;
+    m_ullRxNs[iRxb] = ullNs;
+    m_bRxFull[iRxb] = true;
+    ulRxAccepted++;
+    return true;
+}
+
+/* 次に送るTXB: TXPが高い方、同じならバッファ番号が大きい方 */
+int VcanMcp2515::prvTxNext() const
+{
+    int iNext = -1;
+    for (int i = 0; i < VCAN_MCP_TXB_NUM; i++)
+    {
+        if (m_bTxReq[i] && (iNext < 0 || m_bTxPrio[i] >= m_bTxPrio[iNext]))
+            iNext = i;
+    }
+    return iNext;
+}
@@ -0,0 +1,271 @@
+/*****************************************************************************/
+/**
+ * @file vcan.h
+ * @comments 仮想CANバス(ビット時間単位の近似モデル)
+ *           simのスケジューラやFreeRTOSに依存しない単体のライブラリで、
+ *           sim_can.cpp(ESP32のCANドライバ)とbench_can.cpp(スループット計測)、
+ *           shim/mcp_can.h(Panel_v2のMCP_CAN)の下で使う。
+ *
+ *           - 時刻は[ns]。バスは自分では進まず、持ち主がvAdvance()で進める
+ *             (次に進める時刻はWakeFnで知らせる)
+ *           - 調停: バスが空いた時点で送信待ちのノードのうち(ID, RTR)が最小のものが勝つ
+ *           - フレーム長: 標準フォーマットのビット列を組み立て、CRC-15とスタッフビットを数える
+ *           - 故障: フレーム毎の確率でフレーム中のどこかのビットでエラーになり、
+ *             エラーフレームの後に再び調停する。送信側TEC +8 / 受信側REC +1、成功で -1。
+ *             TECが256に達したノードはバスオフ(復帰はノード側)
+ *           - 受信: EOFの時点で送信元以外の全ノードへ配る(フィルタはノード側)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SIM_VCAN_H
+#define SIM_VCAN_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "driver/can.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define VCAN_BITRATE_DEFAULT 500000
+#define VCAN_FRAME_TAIL_BITS (1 + 2 + 7 + 3) // CRC del, ACK, EOF, IFS
+#define VCAN_ERROR_FRAME_BITS (6 + 8 + 3)    // エラーフラグ, デリミタ, IFS
+#define VCAN_TEC_TX_ERROR 8
+#define VCAN_ERROR_PASSIVE 128
+#define VCAN_BUS_OFF_TEC 256
+#define VCAN_RECOVERY_BITS (128 * 11)        // バスオフからの復帰(11ビットのレセッシブ x 128)
+#define VCAN_NEVER UINT64_MAX
+
+/* MCP2515 */
+#define VCAN_MCP_RXB_NUM 2
+#define VCAN_MCP_TXB_NUM 3
+#define VCAN_MCP_MASK_NUM 2
+#define VCAN_MCP_FILT_NUM 6
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+class VcanBus;
+
+/*
+ * バスに繋がるノード(CANコントローラ)
+ * 送信待ちは調停の度にbTxPeek()で聞く。勝ったらvTxBegin()、終わったらvTxDone()。
+ * エラーで終わったフレームはvTxBegin()の後もbTxPeek()で同じものを返すこと(再送)。
+ */
+class VcanNode
+{
+  public:
+    virtual ~VcanNode() {}
+
+    // 調停に出すフレーム(無ければfalse)
+    virtual bool bTxPeek(can_message_t *pxMsg) = 0;
+    // 調停に勝って送信を始めた
+    virtual void vTxBegin(uint64_t ullNs) { (void)ullNs; }
+    // 送信の結果(false: 送信中にバスから外れた)
+    virtual void vTxDone(bool bOk, uint64_t ullNs) = 0;
+    // 受信(EOFの時点、自分の送信は来ない)
+    virtual void vRx(const can_message_t *pxMsg, uint64_t ullNs) = 0;
+    // バスに参加しているか(停止中、バスオフは参加しない)
+    virtual bool bOnBus(uint64_t ullNs) { (void)ullNs; return true; }
+    // TECがVCAN_BUS_OFF_TECに達した
+    virtual void vBusOff(uint64_t ullNs) { (void)ullNs; }
+
+    // 自分の送信待ちが増えた(バスが空いていれば調停する)
+    void vKick(uint64_t ullNs);
+    bool bErrorPassive() const { return ulTec >= VCAN_ERROR_PASSIVE || ulRec >= VCAN_ERROR_PASSIVE; }
+
+    // バスが更新する
+    VcanBus *pxBus = nullptr;
+    int iNode = -1;
+    bool bCountErrors = true; // false: TEC/RECを数えない(複数の実機をまとめたノード)
+    uint32_t ulTec = 0;
+    uint32_t ulRec = 0;
+    uint32_t ulTxOk = 0;
+    uint32_t ulTxErr = 0;
+    uint32_t ulArbLost = 0;
+};
+
+struct VcanBusStats
+{
+    uint64_t ullFrames;       // 送り終えたフレーム
+    uint64_t ullBits;         // バスを使ったビット数(エラーフレームを含む)
+    uint64_t ullBusyNs;       // バスを使った時間
+    uint64_t ullErrors;       // エラーになったフレーム
+    uint64_t ullArbitrations; // 調停の回数
+    uint64_t ullArbLost;      // 調停に負けたノードの延べ数
+    uint64_t ullIdClash;      // 同じ(ID, RTR)が同時に調停に出た(本来は設計ミス)
+};
+
+/*
+ * バス
+ * vRequest()/vKick()で送信待ちを知らせ、WakeFnで知らされた時刻にvAdvance()を呼ぶ。
+ * ノードのコールバック(vTxDone/vRxなど)の中で送信待ちを増やしてもよい
+ * (コールバックを全部呼んでから調停する)。
+ */
+class VcanBus
+{
+  public:
+    typedef void (*WakeFn)(void *pvCtx, uint64_t ullAtNs);
+
+    explicit VcanBus(uint32_t ulBitrate = VCAN_BITRATE_DEFAULT);
+
+    int iAttach(VcanNode *pxNode);
+    void vSetWake(WakeFn pfnWake, void *pvCtx);
+    void vSetErrorRate(double dProb, uint64_t ullSeed);
+    void vRequest(uint64_t ullNowNs);
+    void vRequestAt(uint64_t ullAtNs);
+    void vAdvance(uint64_t ullNowNs);
+
+    uint64_t ullNowNs() const { return m_ullNowNs; }
+    uint64_t ullNextNs() const;
+    uint64_t ullBitNs() const { return m_ullBitNs; }
+    bool bBusy() const { return m_eState != BUS_IDLE; }
+    int iOnBusNode() const { return bBusy() ? m_iWinner : -1; }
+    const VcanBusStats &xStats() const { return m_xStats; }
+
+  private:
+    enum BusState
+    {
+        BUS_IDLE,
+        BUS_FRAME, // フレーム送信中
+        BUS_ERROR  // フレーム途中からエラーフレーム
+    };
+
+    void prvArbitrate(uint64_t ullNs);
+    void prvFinish(uint64_t ullNs);
+    void prvSchedule(uint64_t ullAtNs);
+    double prvRand();
+
+    std::vector<VcanNode *> m_nodes;
+    uint64_t m_ullBitNs;
+    uint64_t m_ullNowNs = 0;
+    BusState m_eState = BUS_IDLE;
+    uint64_t m_ullDoneNs = VCAN_NEVER;  // 送信中のフレームの終わり
+    uint64_t m_ullKickNs = VCAN_NEVER;  // 空いているバスで次に調停する時刻
+    int m_iWinner = -1;
+    can_message_t m_xOnBus;
+    bool m_bLocked = false; // 調停・配送中(vRequestは後で調停する)
+    WakeFn m_pfnWake = nullptr;
+    void *m_pvWakeCtx = nullptr;
+    double m_dErrProb = 0.0;
+    uint64_t m_ullRand = 1;
+    VcanBusStats m_xStats = {};
+};
+
+/*
+ * ESP32のCANコントローラ(TWAI)相当
+ * TXキュー(送信中のフレームは含まない) / RXキュー / 単一フィルタ
+ */
+class VcanTwai : public VcanNode
+{
+  public:
+    VcanTwai(uint32_t ulTxLen, uint32_t ulRxLen, uint32_t ulCode = 0, uint32_t ulMask = 0xFFFFFFFF);
+
+    bool bTransmit(const can_message_t *pxMsg, uint64_t ullNs); // false: TXキュー満杯
+    bool bReceive(can_message_t *pxMsg, uint64_t *pullNs);       // false: 空
+    uint32_t ulTxWaiting() const { return (uint32_t)m_tx.size() + (m_bHeld ? 1 : 0); }
+    uint32_t ulRxWaiting() const { return (uint32_t)m_rx.size(); }
+
+    bool bTxPeek(can_message_t *pxMsg) override;
+    void vTxBegin(uint64_t ullNs) override;
+    void vTxDone(bool bOk, uint64_t ullNs) override;
+    void vRx(const can_message_t *pxMsg, uint64_t ullNs) override;
+
+    uint32_t ulRxMissed = 0;
+
+  private:
+    struct RxItem
+    {
+        can_message_t xMsg;
+        uint64_t ullNs;
+    };
+    std::deque<can_message_t> m_tx;
+    std::deque<RxItem> m_rx;
+    can_message_t m_xHeld; // 送信中(エラーなら再送)
+    bool m_bHeld = false;
+    uint32_t m_ulTxLen;
+    uint32_t m_ulRxLen;
+    uint32_t m_ulCode;
+    uint32_t m_ulMask;
+};
+
+/*
+ * MCP2515相当(標準フォーマットのみ)
+ * RXB0: RXM0とRXF0/1、RXB1: RXM1とRXF2-5。RXB0に合うフレームはRXB0へ、
+ * 埋まっていればBUKT(ロールオーバー)が有効ならRXB1へ。入らなければ溢れ(EFLG.RXnOVR)。
+ * INTはRXnIFのどれかが立っている間Lで、H->Lの度にIntFnを呼ぶ。
+ * TXB0-2は優先度(TXP)が高い方、同じならバッファ番号が大きい方から送る。
+ * バスオフからはVCAN_RECOVERY_BITS後に自動で復帰する。
+ */
+class VcanMcp2515 : public VcanNode
+{
+  public:
+    typedef void (*IntFn)(void *pvCtx, uint64_t ullNs);
+
+    VcanMcp2515();
+
+    void vSetMask(int iNum, uint32_t ulMask);
+    void vSetFilter(int iNum, uint32_t ulFilt);
+    void vSetRollover(bool bBukt) { m_bBukt = bBukt; }
+    void vSetInt(IntFn pfnInt, void *pvCtx);
+    void vReset();
+
+    bool bRxPending() const { return m_bRxFull[0] || m_bRxFull[1]; }
+    bool bRead(can_message_t *pxMsg, uint64_t *pullNs);                // RXB0、RXB1の順
+    bool bLoad(const can_message_t *pxMsg, uint8_t bPrio, uint64_t ullNs); // false: TXBが空いていない
+    uint32_t ulTxPending() const;
+
+    bool bTxPeek(can_message_t *pxMsg) override;
+    void vTxBegin(uint64_t ullNs) override;
+    void vTxDone(bool bOk, uint64_t ullNs) override;
+    void vRx(const can_message_t *pxMsg, uint64_t ullNs) override;
+    bool bOnBus(uint64_t ullNs) override;
+    void vBusOff(uint64_t ullNs) override;
+
+    uint32_t ulRxOverflow[VCAN_MCP_RXB_NUM] = {}; // EFLG.RX0OVR / RX1OVR
+    uint32_t ulRxFiltered = 0;                    // フィルタで捨てたフレーム
+    uint32_t ulRxAccepted = 0;
+
+  private:
+    bool prvMatch(int iMask, int iFilt, uint32_t ulId) const;
+    bool prvStore(int iRxb, const can_message_t *pxMsg, uint64_t ullNs);
+    int prvTxNext() const;
+
+    uint32_t m_ulMask[VCAN_MCP_MASK_NUM];
+    uint32_t m_ulFilt[VCAN_MCP_FILT_NUM];
+    bool m_bBukt = false;
+    can_message_t m_xRxb[VCAN_MCP_RXB_NUM];
+    uint64_t m_ullRxNs[VCAN_MCP_RXB_NUM];
+    bool m_bRxFull[VCAN_MCP_RXB_NUM];
+    can_message_t m_xTxb[VCAN_MCP_TXB_NUM];
+    uint8_t m_bTxPrio[VCAN_MCP_TXB_NUM];
+    bool m_bTxReq[VCAN_MCP_TXB_NUM];
+    int m_iTxOnBus = -1;
+    uint64_t m_ullRecoverNs = 0; // バスオフ中: 復帰する時刻
+    bool m_bBusOff = false;
+    IntFn m_pfnInt = nullptr;
+    void *m_pvIntCtx = nullptr;
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+uint32_t ulVcanFrameBits(const can_message_t *pxMsg);
+bool bVcanTwaiFilterMatch(uint32_t ulCode, uint32_t ulMask, uint32_t ulId);
+
+/* shim/mcp_can.h(MCP_CAN::begin)が繋ぐバス */
+void vVcanSetDefaultBus(VcanBus *pxBus);
+VcanBus *pxVcanDefaultBus(void);
+
+#endif
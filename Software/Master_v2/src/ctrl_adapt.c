@@ -0,0 +1,276 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_adapt.c
+ * @comments 適応難易度(プレイヤーの反応時間と押下率で生成周期／点灯時間を調整)
+ *           押下/見逃しの度に推定値を更新し、範囲内で生成周期と点灯時間を動かす。
+ *           時刻は引数で受け取り、RTOSに依存しない(排他は呼び出し側で行う)。
+ *           メモリ確保なし。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <string.h>
+
+#include "ctrl_adapt.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define ADAPT_Q16_ONE 65536UL
+#define ADAPT_MIN_SAMPLES 4          // これ未満の間は調整しない
+#define ADAPT_LIGHT_MARGIN_US 200000 // 点灯時間の余裕(踏み込み、CAN往復)
+#define ADAPT_LIGHT_UNIT_US (configLIGHT_TIME_UNIT_MS * 1000LL)
+#define ADAPT_SPAWN_DEC_SHIFT 5      // 押下率が目標以上: 周期を1/32短く
+#define ADAPT_SPAWN_INC_SHIFT 4      // 押下率が目標未満: 周期を1/16長く
+#define ADAPT_DAMAGE_HOLD 8          // 体力が減った後、速くしない標本数
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvAdaptSample(adaptCtrl_t *pxCtrl, int32_t lRtUs, BOOL_t xHit);
+static uint32_t prvClamp(uint32_t ulValue, uint32_t ulMin, uint32_t ulMax);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 初期化(ゲーム開始時)
+ *
+ * @param    pxCtrl: 制御状態
+ * @param    pxBounds: 調整範囲
+ * @param    ulSpawnMs / ulLightMs: 初期値(難易度プロファイル)
+ *
+ * @return   ##
+ *
+ * @note     押下率の初期値は目標値(最初の数回で大きく動かさない)
+ *
+ ******************************************************************************/
+void vAdaptInit(adaptCtrl_t *pxCtrl, const adaptBounds_t *pxBounds,
+                uint32_t ulSpawnMs, uint32_t ulLightMs)
+{
+    memset(pxCtrl, 0x00, sizeof(*pxCtrl));
+    pxCtrl->xBounds = *pxBounds;
+    pxCtrl->ulHitQ16 = pxBounds->bHitTargetPct * ADAPT_Q16_ONE / 100;
+    pxCtrl->ulSpawnUs = prvClamp(ulSpawnMs, pxBounds->usSpawnMinMs,
+                                 pxBounds->usSpawnMaxMs) * 1000;
+    pxCtrl->usLightMs = (uint16_t)prvClamp(ulLightMs, pxBounds->usLightMinMs,
+                                           pxBounds->usLightMaxMs);
+}
+
+/*****************************************************************************/
+/**
+ * 押された
+ *
+ * @param    pxCtrl: 制御状態
+ * @param    llReactionUs: 点灯要求から押下受信まで[us]
+ * @param    xCorrect: pdFALSE:弱点色を踏んだ(数えるだけ、体力はvAdaptOnDamage)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vAdaptOnHit(adaptCtrl_t *pxCtrl, int64_t llReactionUs, BOOL_t xCorrect)
+{
+    if (llReactionUs < 0)
+        llReactionUs = 0;
+    if (llReactionUs > INT32_MAX)
+        llReactionUs = INT32_MAX;
+    pxCtrl->ulHits++;
+    if (xCorrect != pdTRUE)
+        pxCtrl->ulWrongs++;
+    prvAdaptSample(pxCtrl, (int32_t)llReactionUs, pdTRUE);
+}
+
+/*****************************************************************************/
+/**
+ * 押されずに消えた
+ *
+ * @param    pxCtrl: 制御状態
+ *
+ * @return   ##
+ *
+ * @note     反応時間は「点灯時間以上」なので点灯時間を標本として入れる。
+ *           避けるべき色(弱点色)の見逃しは呼ばないこと。
+ *
+ ******************************************************************************/
+void vAdaptOnMiss(adaptCtrl_t *pxCtrl)
+{
+    pxCtrl->ulMisses++;
+    prvAdaptSample(pxCtrl, (int32_t)pxCtrl->usLightMs * 1000, pdFALSE);
+}
+
+/*****************************************************************************/
+/**
+ * 体力が減った
+ * 残り体力が少ないほど生成周期を大きく戻す(体力半分で1/4、残り1で2/5)。
+ *
+ * @param    pxCtrl: 制御状態
+ * @param    lHitPoint: 減った後の体力
+ * @param    lMaxHitPoint: 体力上限
+ *
+ * @return   ##
+ *
+ * @note     その後ADAPT_DAMAGE_HOLD回は速くしない
+ *
+ ******************************************************************************/
+void vAdaptOnDamage(adaptCtrl_t *pxCtrl, int32_t lHitPoint, int32_t lMaxHitPoint)
+{
+    uint32_t ulSpawnUs = pxCtrl->ulSpawnUs;
+    int32_t lLost;
+
+    if (lMaxHitPoint <= 0)
+        return;
+    lLost = lMaxHitPoint - (lHitPoint < 0 ? 0 : lHitPoint);
+    if (lLost <= 0)
+        return;
+    if (lLost > lMaxHitPoint)
+        lLost = lMaxHitPoint;
+
+    ulSpawnUs += (uint32_t)((uint64_t)ulSpawnUs * (uint32_t)lLost /
+                            (2 * (uint32_t)lMaxHitPoint));
+    pxCtrl->ulSpawnUs = prvClamp(ulSpawnUs, pxCtrl->xBounds.usSpawnMinMs * 1000UL,
+                                 pxCtrl->xBounds.usSpawnMaxMs * 1000UL);
+    pxCtrl->usHold = ADAPT_DAMAGE_HOLD;
+}
+
+/*****************************************************************************/
+/**
+ * 現在の生成周期[us]
+ *
+ * @param    pxCtrl: 制御状態
+ *
+ * @return   uint32_t 生成周期[us]
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulAdaptSpawnUs(const adaptCtrl_t *pxCtrl)
+{
+    return pxCtrl->ulSpawnUs;
+}
+
+/*****************************************************************************/
+/**
+ * 現在の点灯時間[ms]
+ *
+ * @param    pxCtrl: 制御状態
+ *
+ * @return   uint16_t 点灯時間[ms] (configLIGHT_TIME_UNIT_MSの倍数)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint16_t usAdaptLightMs(const adaptCtrl_t *pxCtrl)
+{
+    return pxCtrl->usLightMs;
+}
+
+/*****************************************************************************/
+/**
+ * 押下率の平滑値[%]
+ *
+ * @param    pxCtrl: 制御状態
+ *
+ * @return   uint32_t 押下率[%]
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulAdaptHitPct(const adaptCtrl_t *pxCtrl)
+{
+    return (uint32_t)((uint64_t)pxCtrl->ulHitQ16 * 100 / ADAPT_Q16_ONE);
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 推定値の更新と生成周期／点灯時間の調整
+ *
+ * @param    pxCtrl: 制御状態
+ * @param    lRtUs: 反応時間の標本[us]
+ * @param    xHit: pdTRUE:押された / pdFALSE:見逃し
+ *
+ * @return   ##
+ *
+ * @note     生成周期は目標押下率を境に「ゆっくり速く／素早く遅く」する
+ *
+ ******************************************************************************/
+static void prvAdaptSample(adaptCtrl_t *pxCtrl, int32_t lRtUs, BOOL_t xHit)
+{
+    const adaptBounds_t *pxBounds = &pxCtrl->xBounds;
+    uint32_t ulSamples = pxCtrl->ulHits + pxCtrl->ulMisses;
+    uint32_t ulTargetQ16 = pxBounds->bHitTargetPct * ADAPT_Q16_ONE / 100;
+    uint32_t ulSpawnUs = pxCtrl->ulSpawnUs;
+    int32_t lErr;
+    int64_t llLightUs;
+    uint32_t ulLightMs;
+
+    // 反応時間: 平滑平均と平均偏差
+    if (ulSamples == 1)
+    {
+        pxCtrl->lRtAvgUs = lRtUs;
+        pxCtrl->lRtDevUs = lRtUs / 2;
+    }
+    else
+    {
+        lErr = lRtUs - pxCtrl->lRtAvgUs;
+        pxCtrl->lRtAvgUs += lErr / 8;
+        pxCtrl->lRtDevUs += ((lErr < 0 ? -lErr : lErr) - pxCtrl->lRtDevUs) / 4;
+    }
+
+    // 押下率
+    if (xHit == pdTRUE)
+        pxCtrl->ulHitQ16 += (ADAPT_Q16_ONE - pxCtrl->ulHitQ16) / 8;
+    else
+        pxCtrl->ulHitQ16 -= pxCtrl->ulHitQ16 / 8;
+
+    if (ulSamples < ADAPT_MIN_SAMPLES)
+        return;
+
+    // 生成周期(体力が減った後のADAPT_DAMAGE_HOLD標本は速くしない)
+    if (pxCtrl->ulHitQ16 < ulTargetQ16)
+        ulSpawnUs += ulSpawnUs >> ADAPT_SPAWN_INC_SHIFT;
+    else if (pxCtrl->usHold == 0)
+        ulSpawnUs -= ulSpawnUs >> ADAPT_SPAWN_DEC_SHIFT;
+    if (pxCtrl->usHold > 0)
+        pxCtrl->usHold--;
+    pxCtrl->ulSpawnUs = prvClamp(ulSpawnUs, pxBounds->usSpawnMinMs * 1000UL,
+                                 pxBounds->usSpawnMaxMs * 1000UL);
+
+    // 点灯時間(押された標本が揃ってから、単位に切り上げ)
+    if (pxCtrl->ulHits >= ADAPT_MIN_SAMPLES)
+    {
+        llLightUs = (int64_t)pxCtrl->lRtAvgUs + 4 * (int64_t)pxCtrl->lRtDevUs +
+                    ADAPT_LIGHT_MARGIN_US;
+        ulLightMs = (uint32_t)((llLightUs + ADAPT_LIGHT_UNIT_US - 1) /
+                               ADAPT_LIGHT_UNIT_US) * configLIGHT_TIME_UNIT_MS;
+        pxCtrl->usLightMs = (uint16_t)prvClamp(ulLightMs,
+                                               pxBounds->usLightMinMs,
+                                               pxBounds->usLightMaxMs);
+    }
+}
+
+static uint32_t prvClamp(uint32_t ulValue, uint32_t ulMin, uint32_t ulMax)
+{
+    if (ulValue < ulMin)
+        return ulMin;
+    if (ulValue > ulMax)
+        return ulMax;
+    return ulValue;
+}
@@ -0,0 +1,84 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_adapt.h
+ * @comments 適応難易度(プレイヤーの反応時間と押下率で生成周期／点灯時間を調整)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_ADAPT_H
+#define SRC_CTRL_ADAPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 調整範囲(難易度毎、ctrl_dfcltが決める) */
+typedef struct ADAPT_BOUNDS
+{
+    uint16_t usSpawnMinMs; // 生成周期[ms]
+    uint16_t usSpawnMaxMs;
+    uint16_t usLightMinMs; // 点灯時間[ms] (configLIGHT_TIME_UNIT_MSの倍数)
+    uint16_t usLightMaxMs;
+    uint8_t bHitTargetPct; // 目標押下率[%]: 上回れば速く、下回れば遅くする
+} adaptBounds_t;
+
+/*
+ * 制御状態
+ * 反応時間はTCPのRTT推定と同じ平滑平均＋平均偏差で持ち、
+ * 点灯時間 = 平均 + 4 * 偏差 + 余裕 とする。
+ * 押下率 = 踏んだ / (踏んだ + 見逃し) で生成周期を動かし、
+ * 体力が減ったら(弱点色を踏んだら)残り体力に応じて周期を戻す。
+ */
+typedef struct ADAPT_CTRL
+{
+    adaptBounds_t xBounds;
+    int32_t lRtAvgUs;     // 反応時間の平滑平均[us] (1/8)
+    int32_t lRtDevUs;     // 反応時間の平均偏差[us] (1/4)
+    uint32_t ulHitQ16;    // 押下率の平滑値 (Q16, 1/8)
+    uint32_t ulSpawnUs;   // 現在の生成周期[us]
+    uint16_t usLightMs;   // 現在の点灯時間[ms]
+    uint16_t usHold;      // 体力が減った後、速くしない残り回数
+    uint32_t ulHits;      // 押された数(弱点色を含む)
+    uint32_t ulWrongs;    // 弱点色が押された数
+    uint32_t ulMisses;    // 押されずに消えた数(弱点色を除く)
+} adaptCtrl_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vAdaptInit(adaptCtrl_t *pxCtrl, const adaptBounds_t *pxBounds,
+                uint32_t ulSpawnMs, uint32_t ulLightMs);
+void vAdaptOnHit(adaptCtrl_t *pxCtrl, int64_t llReactionUs, BOOL_t xCorrect);
+void vAdaptOnMiss(adaptCtrl_t *pxCtrl);
+void vAdaptOnDamage(adaptCtrl_t *pxCtrl, int32_t lHitPoint, int32_t lMaxHitPoint);
+uint32_t ulAdaptSpawnUs(const adaptCtrl_t *pxCtrl);
+uint16_t usAdaptLightMs(const adaptCtrl_t *pxCtrl);
+uint32_t ulAdaptHitPct(const adaptCtrl_t *pxCtrl);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,187 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_dfclt.cpp
+ * @comments 難易度プロファイル
+ *           既定値はcsDfcltProfileTbl(constexpr)。GMから難易度毎の上書きを
+ *           受け付け、次のゲーム開始時に反映する(再書き込み不要)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* ESP-IDF Includes */
+#include <sys/param.h>
+#include "esp_log.h"
+
+#include "ctrl_dfclt.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TAG "Dfclt"
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+/* 上書き値: tcp_server_task(GM)が書き、CtrlTxタスクが読む */
+static dfcltProfile_t xDfcltOverride[MAX_DFCLT];
+static uint32_t ulOverrideMask = 0; // bit = eDfclt_t
+static portMUX_TYPE xDfcltMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 難易度プロファイル取得(上書きがあれば上書き値)
+ *
+ * @param    eDfclt: 難易度
+ * @param    pxProfile: 格納先
+ *
+ * @return   ##
+ *
+ * @note     ゲーム開始時に1回呼び、ゲーム中はコピーを使う
+ *
+ ******************************************************************************/
+void vDfcltGetProfile(eDfclt_t eDfclt, dfcltProfile_t *pxProfile)
+{
+    *pxProfile = rxDfcltDefault(eDfclt);
+
+    portENTER_CRITICAL(&xDfcltMux);
+    if (eDfclt >= DFCLT_EASY && eDfclt < MAX_DFCLT &&
+        (ulOverrideMask & (1UL << eDfclt)) != 0)
+    {
+        *pxProfile = xDfcltOverride[eDfclt];
+    }
+    portEXIT_CRITICAL(&xDfcltMux);
+}
+
+/*****************************************************************************/
+/**
+ * 難易度プロファイルの上書き
+ *
+ * @param    eDfclt: 難易度
+ * @param    pxProfile: 上書き値
+ *
+ * @return   pdPASS / pdFAIL(範囲外)
+ *
+ * @note     次のゲームから反映
+ *
+ ******************************************************************************/
+BOOL_t xDfcltSetOverride(eDfclt_t eDfclt, const dfcltProfile_t *pxProfile)
+{
+    if (eDfclt < DFCLT_EASY || eDfclt >= MAX_DFCLT ||
+        xDfcltValidate(pxProfile) != pdTRUE)
+    {
+        return pdFAIL;
+    }
+
+    portENTER_CRITICAL(&xDfcltMux);
+    xDfcltOverride[eDfclt] = *pxProfile;
+    ulOverrideMask |= (1UL << eDfclt);
+    portEXIT_CRITICAL(&xDfcltMux);
+
+    ESP_LOGI(TAG, "Override dfclt:%d spawn:%ums light:%ums speedup:%u%% hp:%d/%d/%d",
+             eDfclt, pxProfile->usSpawnMs, pxProfile->usLightMs,
+             pxProfile->bSpeedUpPct, pxProfile->cHpStrong, pxProfile->cHpSame,
+             pxProfile->cHpWeak);
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 上書きの解除(既定値に戻す)
+ *
+ * @param    eDfclt: 難易度
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vDfcltClearOverride(eDfclt_t eDfclt)
+{
+    if (eDfclt < DFCLT_EASY || eDfclt >= MAX_DFCLT)
+        return;
+
+    portENTER_CRITICAL(&xDfcltMux);
+    ulOverrideMask &= ~(1UL << eDfclt);
+    portEXIT_CRITICAL(&xDfcltMux);
+    ESP_LOGI(TAG, "Clear override dfclt:%d", eDfclt);
+}
+
+/*****************************************************************************/
+/**
+ * 適応難易度の調整範囲
+ *
+ * @param    eDfclt: 難易度
+ * @param    pxProfile: ゲームで使うプロファイル(上書き後)
+ * @param    pxBounds: 格納先
+ *
+ * @return   ##
+ *
+ * @note     範囲はプロファイルに対する%なので、上書きにも追従する。
+ *           configADAPT_ENABLE == 0 ならプロファイルの値に固定。
+ *
+ ******************************************************************************/
+void vDfcltGetAdaptBounds(eDfclt_t eDfclt, const dfcltProfile_t *pxProfile,
+                          adaptBounds_t *pxBounds)
+{
+#if configADAPT_ENABLE == 1
+    const dfcltAdapt_t &rxAdapt =
+        csDfcltAdaptTbl[(eDfclt >= DFCLT_EASY && eDfclt < MAX_DFCLT) ? eDfclt
+                                                                    : DFCLT_EASY];
+    uint32_t ulLightMin = (uint32_t)pxProfile->usLightMs * rxAdapt.bLightMinPct / 100;
+    uint32_t ulLightMax = (uint32_t)pxProfile->usLightMs * rxAdapt.bLightMaxPct / 100;
+
+    // 点灯時間は単位の倍数(下限は切り上げ、上限は切り捨て)
+    ulLightMin = (ulLightMin + configLIGHT_TIME_UNIT_MS - 1) / configLIGHT_TIME_UNIT_MS *
+                 configLIGHT_TIME_UNIT_MS;
+    ulLightMax = ulLightMax / configLIGHT_TIME_UNIT_MS * configLIGHT_TIME_UNIT_MS;
+
+    pxBounds->usSpawnMinMs = (uint16_t)MAX((uint32_t)DFCLT_SPAWN_MS_MIN,
+                                           (uint32_t)pxProfile->usSpawnMs * rxAdapt.bSpawnMinPct / 100);
+    pxBounds->usSpawnMaxMs = (uint16_t)MIN((uint32_t)DFCLT_SPAWN_MS_MAX,
+                                           (uint32_t)pxProfile->usSpawnMs * rxAdapt.bSpawnMaxPct / 100);
+    pxBounds->usLightMinMs = (uint16_t)MAX((uint32_t)DFCLT_LIGHT_MS_MIN, ulLightMin);
+    pxBounds->usLightMaxMs = (uint16_t)MIN((uint32_t)DFCLT_LIGHT_MS_MAX, ulLightMax);
+    pxBounds->bHitTargetPct = rxAdapt.bHitTargetPct;
+#else
+    (void)eDfclt;
+    pxBounds->usSpawnMinMs = pxBounds->usSpawnMaxMs = pxProfile->usSpawnMs;
+    pxBounds->usLightMinMs = pxBounds->usLightMaxMs = pxProfile->usLightMs;
+    pxBounds->bHitTargetPct = 50;
+#endif
+}
+
+/*****************************************************************************/
+/**
+ * 範囲チェック
+ *
+ * @param    pxProfile: プロファイル
+ *
+ * @return   pdTRUE / pdFALSE
+ *
+ * @note     既定値のテーブルはstatic_assertで同じチェックをしている
+ *
+ ******************************************************************************/
+BOOL_t xDfcltValidate(const dfcltProfile_t *pxProfile)
+{
+    return bDfcltProfileValid(*pxProfile) ? pdTRUE : pdFALSE;
+}
@@ -0,0 +1,152 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_dfclt.h
+ * @comments 難易度プロファイル(生成周期／点灯時間／スピードアップ／体力増減)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_DFCLT_H
+#define SRC_CTRL_DFCLT_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "ctrl_adapt.h"
+#include "def_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* 上書き値の範囲 */
+#define DFCLT_SPAWN_MS_MIN 100
+#define DFCLT_SPAWN_MS_MAX 10000
+#define DFCLT_LIGHT_MS_MIN configLIGHT_TIME_UNIT_MS
+#define DFCLT_LIGHT_MS_MAX (configLIGHT_TIME_UNIT_MS * 255)
+#define DFCLT_SPEEDUP_PCT_MIN 10
+#define DFCLT_SPEEDUP_PCT_MAX 100
+#define DFCLT_HP_ABS_MAX 10
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef struct DFCLT_PROFILE
+{
+    uint16_t usSpawnMs;  // パネル生成周期[ms]
+    uint16_t usLightMs;  // 点灯時間[ms] (configLIGHT_TIME_UNIT_MSの倍数)
+    uint8_t bSpeedUpPct; // スピードアップ後の生成周期[%] (100:スピードアップなし)
+    int8_t cHpStrong;    // 体力増減: 強い色
+    int8_t cHpSame;      // 体力増減: 同じ色
+    int8_t cHpWeak;      // 体力増減: 弱点色
+} dfcltProfile_t;
+
+/* 適応難易度の調整範囲(プロファイルの生成周期／点灯時間に対する%) */
+typedef struct DFCLT_ADAPT
+{
+    uint8_t bSpawnMinPct;
+    uint8_t bSpawnMaxPct;
+    uint8_t bLightMinPct;
+    uint8_t bLightMaxPct;
+    uint8_t bHitTargetPct; // 目標押下率[%]
+} dfcltAdapt_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vDfcltGetProfile(eDfclt_t eDfclt, dfcltProfile_t *pxProfile);
+BOOL_t xDfcltSetOverride(eDfclt_t eDfclt, const dfcltProfile_t *pxProfile);
+void vDfcltClearOverride(eDfclt_t eDfclt);
+BOOL_t xDfcltValidate(const dfcltProfile_t *pxProfile);
+void vDfcltGetAdaptBounds(eDfclt_t eDfclt, const dfcltProfile_t *pxProfile,
+                          adaptBounds_t *pxBounds);
+
+#ifdef __cplusplus
+}
+
+/*
+ * 既定の難易度プロファイル
+ * [0]は空とし、enumの値と対応させる。
+ */
+constexpr dfcltProfile_t csDfcltProfileTbl[] = {
+    {},
+    /*  spawn  light  speedup  strong same weak */
+    {1500, 2000, 80, 0, 0, 0},  // DFCLT_EASY
+    {1000, 2000, 80, 1, 0, -1}, // DFCLT_NORMAL
+    {600, 1500, 80, 1, 0, -2},  // DFCLT_HARD
+    {300, 1500, 100, 0, 0, -4}, // DFCLT_LUNATIC (スピードアップなし)
+};
+
+/* 範囲外の難易度はEASY */
+constexpr const dfcltProfile_t &rxDfcltDefault(eDfclt_t eDfclt)
+{
+    return csDfcltProfileTbl[(eDfclt >= DFCLT_EASY && eDfclt < MAX_DFCLT) ? eDfclt
+                                                                         : DFCLT_EASY];
+}
+
+constexpr bool bDfcltProfileValid(const dfcltProfile_t &xProfile)
+{
+    return xProfile.usSpawnMs >= DFCLT_SPAWN_MS_MIN &&
+           xProfile.usSpawnMs <= DFCLT_SPAWN_MS_MAX &&
+           xProfile.usLightMs >= DFCLT_LIGHT_MS_MIN &&
+           xProfile.usLightMs <= DFCLT_LIGHT_MS_MAX &&
+           xProfile.usLightMs % configLIGHT_TIME_UNIT_MS == 0 &&
+           xProfile.bSpeedUpPct >= DFCLT_SPEEDUP_PCT_MIN &&
+           xProfile.bSpeedUpPct <= DFCLT_SPEEDUP_PCT_MAX &&
+           xProfile.cHpStrong >= -DFCLT_HP_ABS_MAX && xProfile.cHpStrong <= DFCLT_HP_ABS_MAX &&
+           xProfile.cHpSame >= -DFCLT_HP_ABS_MAX && xProfile.cHpSame <= DFCLT_HP_ABS_MAX &&
+           xProfile.cHpWeak >= -DFCLT_HP_ABS_MAX && xProfile.cHpWeak <= DFCLT_HP_ABS_MAX;
+}
+
+/*
+ * 適応難易度の調整範囲
+ * 上手なプレイヤーには速く短く、苦戦しているプレイヤーには遅く長くする。
+ * 難しい難易度ほど目標押下率を下げる。
+ */
+constexpr dfcltAdapt_t csDfcltAdaptTbl[] = {
+    {},
+    /* spawn min/max  light min/max  target */
+    {60, 150, 50, 150, 85}, // DFCLT_EASY
+    {50, 130, 50, 130, 80}, // DFCLT_NORMAL
+    {50, 120, 60, 120, 70}, // DFCLT_HARD
+    {60, 100, 60, 100, 60}, // DFCLT_LUNATIC (遅くはしない)
+};
+
+constexpr bool bDfcltAdaptValid(const dfcltAdapt_t &xAdapt)
+{
+    return xAdapt.bSpawnMinPct > 0 && xAdapt.bSpawnMinPct <= 100 &&
+           xAdapt.bSpawnMaxPct >= 100 && xAdapt.bLightMinPct > 0 &&
+           xAdapt.bLightMinPct <= 100 && xAdapt.bLightMaxPct >= 100 &&
+           xAdapt.bHitTargetPct > 0 && xAdapt.bHitTargetPct < 100;
+}
+
+static_assert(sizeof(csDfcltAdaptTbl) / sizeof(csDfcltAdaptTbl[0]) == MAX_DFCLT,
+              "csDfcltAdaptTbl must have one entry per eDfclt_t");
+static_assert(bDfcltAdaptValid(csDfcltAdaptTbl[DFCLT_EASY]) &&
+                  bDfcltAdaptValid(csDfcltAdaptTbl[DFCLT_NORMAL]) &&
+                  bDfcltAdaptValid(csDfcltAdaptTbl[DFCLT_HARD]) &&
+                  bDfcltAdaptValid(csDfcltAdaptTbl[DFCLT_LUNATIC]),
+              "csDfcltAdaptTbl: range must contain 100%");
+static_assert(sizeof(csDfcltProfileTbl) / sizeof(csDfcltProfileTbl[0]) == MAX_DFCLT,
+              "csDfcltProfileTbl must have one entry per eDfclt_t");
+static_assert(bDfcltProfileValid(rxDfcltDefault(DFCLT_EASY)) &&
+                  bDfcltProfileValid(rxDfcltDefault(DFCLT_NORMAL)) &&
+                  bDfcltProfileValid(rxDfcltDefault(DFCLT_HARD)) &&
+                  bDfcltProfileValid(rxDfcltDefault(DFCLT_LUNATIC)),
+              "csDfcltProfileTbl: value out of range (light time must be a "
+              "multiple of configLIGHT_TIME_UNIT_MS)");
+#endif
+#endif
@@ -0,0 +1,137 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_group.c
+ * @comments CANのグループ宛て(行×列のビットマップ)
+ *           行の集合×列の集合を1フレームで送れる。全体・行・列・矩形の区画は1フレーム、
+ *           それ以外のパネル集合は同じ列の並びを持つ行毎にまとめて送る。
+ *           ID(bit9..5:行, bit4..0:列)は宛先のビットを0にするので、全体宛ても
+ *           上位7bitが全て1(禁止ID)にならず、グループ同士では全体宛てが最優先になる。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+
+#include "ctrl_group.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define GROUP_GRID_SIZE 5 // CAN_ID_GROUP_MAPのビット数
+#define GROUP_ROW(id) (((id)-PANEL_1) / GROUP_GRID_SIZE)
+#define GROUP_COL(id) (((id)-PANEL_1) % GROUP_GRID_SIZE)
+#define PANEL_ID_VALID(id) ((id) >= PANEL_1 && (id) < MAX_PANEL_NUM)
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static uint32_t prvRowColMap(uint32_t ulPanelMask, uint32_t ulRow);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * パネル集合をグループ宛てのCAN IDに分ける
+ *
+ * @param    ulPanelMask: 送り先(bit = PanelID)
+ * @param    pulCanId: CAN IDの格納先
+ * @param    ulMax: 格納先の数(GROUP_SPLIT_MAXあれば必ず足りる)
+ *
+ * @return   uint32_t 格納したCAN IDの数
+ *
+ * @note     列の並びが同じ行を1つのIDにまとめる。
+ *           格納先が足りない分は格納しない(戻り値はulMaxまで)。
+ *
+ ******************************************************************************/
+uint32_t ulGroupSplit(uint32_t ulPanelMask, uint32_t *pulCanId, uint32_t ulMax)
+{
+    uint32_t ulDone = 0; // 処理済みの行
+    uint32_t ulNum = 0;
+
+    for (uint32_t r = 0; r < GROUP_GRID_SIZE; r++)
+    {
+        uint32_t ulColMap = prvRowColMap(ulPanelMask, r);
+        if ((ulDone & (1UL << r)) != 0 || ulColMap == 0)
+            continue;
+
+        // 同じ列の並びの行をまとめる
+        uint32_t ulRowMap = 0;
+        for (uint32_t q = r; q < GROUP_GRID_SIZE; q++)
+        {
+            if (prvRowColMap(ulPanelMask, q) == ulColMap)
+                ulRowMap |= 1UL << q;
+        }
+        ulDone |= ulRowMap;
+
+        if (ulNum < ulMax)
+            pulCanId[ulNum++] = CAN_ID_GROUP(ulRowMap, ulColMap);
+    }
+    return ulNum;
+}
+
+/*****************************************************************************/
+/**
+ * CAN IDを受信するパネル
+ *
+ * @param    ulCanId: CAN ID
+ *
+ * @return   uint32_t 受信するパネル(bit = PanelID)
+ *
+ * @note     Panel_v2のMCP2515のフィルタ(ulGroupAcceptMask)と同じ判定
+ *
+ ******************************************************************************/
+uint32_t ulGroupPanelMask(uint32_t ulCanId)
+{
+    uint32_t ulMask = 0;
+
+    if (!CAN_ID_IS_GROUP(ulCanId))
+        return PANEL_ID_VALID(ulCanId) ? (1UL << ulCanId) : 0;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        uint32_t ulAccept = ulGroupAcceptMask(i);
+        if ((ulCanId & ulAccept) == (CAN_ID_GROUP_FLAG & ulAccept))
+            ulMask |= 1UL << i;
+    }
+    return ulMask;
+}
+
+/*****************************************************************************/
+/**
+ * パネルのグループ宛て受信マスク(MCP2515 RXM0)
+ *
+ * @param    ulPanelId: PanelID
+ *
+ * @return   uint32_t マスク(フィルタはCAN_ID_GROUP_FLAG)
+ *
+ * @note     bit10と自分の行・列のビットだけを見る
+ *
+ ******************************************************************************/
+uint32_t ulGroupAcceptMask(uint32_t ulPanelId)
+{
+    if (!PANEL_ID_VALID(ulPanelId))
+        return 0x7FF;
+    return CAN_ID_GROUP_FLAG |
+           (1UL << (CAN_ID_GROUP_ROW_SHIFT + GROUP_ROW(ulPanelId))) |
+           (1UL << GROUP_COL(ulPanelId));
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+/* 行rの中でulPanelMaskに含まれる列(bit = 列) */
+static uint32_t prvRowColMap(uint32_t ulPanelMask, uint32_t ulRow)
+{
+    return (ulPanelMask >> (PANEL_1 + ulRow * GROUP_GRID_SIZE)) & CAN_ID_GROUP_MAP;
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_group.h
+ * @comments CANのグループ宛て(行×列のビットマップ)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_GROUP_H
+#define SRC_CTRL_GROUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define GROUP_SPLIT_MAX 5 // 1つのパネル集合を送るのに要るフレーム数の上限(行数)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+uint32_t ulGroupSplit(uint32_t ulPanelMask, uint32_t *pulCanId, uint32_t ulMax);
+uint32_t ulGroupPanelMask(uint32_t ulCanId);
+uint32_t ulGroupAcceptMask(uint32_t ulPanelId);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,238 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_live.c
+ * @comments パネルの死活テーブル(死活監視のフレームから作る)
+ *           v2のPanelはTBCAN_HEARTBEAT_MS毎に状態(tb_canproto.h)を送る。
+ *           一度届いたパネルはconfigPANEL_DEAD_MS途絶えたらDEAD、
+ *           センサが踏まれたままならSTUCKとし、パネル生成から外す。
+ *           一度も届かないパネル(v1のファームウェア)はUNKNOWNのまま外さない。
+ *           Panelの受信の回数(3bitで一周する)は差分を足していく。
+ *           時刻は引数で受け取り、RTOSに依存しない(排他は呼び出し側で行う)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ctrl_live.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define PANEL_ID_VALID(id) ((id) >= PANEL_1 && (id) < MAX_PANEL_NUM)
+#define RXCNT(sensor, shift) (((sensor) >> (shift)) & TBCAN_SENSOR_RXCNT_MASK)
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static const char *const cpcLiveName[MAX_PANEL_LIVE] = {"unknown", "alive", "dead",
+                                                        "stuck"};
+/* JSONでPanelIDを並べる状態 */
+static const ePanelLive_t ceListed[] = {PANEL_LIVE_DEAD, PANEL_LIVE_STUCK, PANEL_LIVE_UNKNOWN};
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * テーブル初期化(全パネルUNKNOWN)
+ *
+ * @param    pxTbl: 死活テーブル
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vLiveTblInit(liveTbl_t *pxTbl)
+{
+    memset(pxTbl, 0x00, sizeof(liveTbl_t));
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを受けた
+ *
+ * @param    pxTbl: 死活テーブル
+ * @param    pxStatus: 受信した状態
+ * @param    llNowUs: 受信時刻[us]
+ *
+ * @return   ##
+ *
+ * @note     状態は次のxLiveTblUpdateで変わる
+ *
+ ******************************************************************************/
+void vLiveTblOnStatus(liveTbl_t *pxTbl, const tbCanStatus_t *pxStatus, int64_t llNowUs)
+{
+    uint32_t ulId = pxStatus->bPanelId;
+    uint8_t bGap;
+    uint8_t bPrev;
+
+    if (!PANEL_ID_VALID(ulId))
+        return;
+
+    if (pxStatus->bReason == TBCAN_STATUS_BOOT)
+    {
+        pxTbl->usBoots[ulId]++;
+    }
+    else if ((pxTbl->ulHeard & (1UL << ulId)) != 0)
+    {
+        // 問い合わせへの返信も数えるので、飛んだ分だけ失ったとみなす
+        bGap = (uint8_t)(pxStatus->bCount - pxTbl->bCount[ulId]);
+        if (bGap > 1)
+            pxTbl->usLost[ulId] += bGap - 1;
+
+        if ((pxStatus->bFeat & TBCAN_FEAT_RXCNT) != 0)
+        {
+            bPrev = pxTbl->bSensor[ulId];
+            pxTbl->usRxFull[ulId] += (RXCNT(pxStatus->bSensor, TBCAN_SENSOR_RXFULL_SHIFT) -
+                                      RXCNT(bPrev, TBCAN_SENSOR_RXFULL_SHIFT)) &
+                                     TBCAN_SENSOR_RXCNT_MASK;
+            pxTbl->usRxOvr[ulId] += (RXCNT(pxStatus->bSensor, TBCAN_SENSOR_RXOVR_SHIFT) -
+                                     RXCNT(bPrev, TBCAN_SENSOR_RXOVR_SHIFT)) &
+                                    TBCAN_SENSOR_RXCNT_MASK;
+        }
+    }
+    pxTbl->ulHeard |= 1UL << ulId;
+    pxTbl->bSensor[ulId] = pxStatus->bSensor;
+    pxTbl->bCount[ulId] = pxStatus->bCount;
+    pxTbl->bFwMajor[ulId] = pxStatus->bFwMajor;
+    pxTbl->bFwMinor[ulId] = pxStatus->bFwMinor;
+    pxTbl->llLastUs[ulId] = llNowUs;
+}
+
+/*****************************************************************************/
+/**
+ * 状態の更新
+ *
+ * @param    pxTbl: 死活テーブル
+ * @param    llNowUs: 現在時刻[us]
+ *
+ * @return   pdTRUE: いずれかのパネルの状態が変わった
+ *
+ * @note     周期的に呼ぶ(呼ぶ周期が途絶えの判定の分解能になる)
+ *
+ ******************************************************************************/
+BOOL_t xLiveTblUpdate(liveTbl_t *pxTbl, int64_t llNowUs)
+{
+    BOOL_t xChanged = pdFALSE;
+    uint32_t ulExclude = 0;
+    uint8_t bState;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((pxTbl->ulHeard & (1UL << i)) == 0)
+            bState = PANEL_LIVE_UNKNOWN;
+        else if (llNowUs - pxTbl->llLastUs[i] > (int64_t)configPANEL_DEAD_MS * 1000)
+            bState = PANEL_LIVE_DEAD;
+        else if ((pxTbl->bSensor[i] & TBCAN_SENSOR_STUCK) != 0)
+            bState = PANEL_LIVE_STUCK;
+        else
+            bState = PANEL_LIVE_ALIVE;
+
+        if (bState != pxTbl->bState[i])
+        {
+            pxTbl->bState[i] = bState;
+            xChanged = pdTRUE;
+        }
+        if (bState == PANEL_LIVE_DEAD || bState == PANEL_LIVE_STUCK)
+            ulExclude |= 1UL << i;
+    }
+    pxTbl->ulExclude = ulExclude;
+    return xChanged;
+}
+
+/*****************************************************************************/
+/**
+ * 状態毎のパネル
+ *
+ * @param    pxTbl: 死活テーブル
+ * @param    eState: 状態
+ *
+ * @return   uint32_t パネル(bit = PanelID)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulLiveTblMask(const liveTbl_t *pxTbl, ePanelLive_t eState)
+{
+    uint32_t ulMask = 0;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if (pxTbl->bState[i] == eState)
+            ulMask |= 1UL << i;
+    }
+    return ulMask;
+}
+
+/*****************************************************************************/
+/**
+ * 運営画面(GM)向けにJSONで出力
+ * {"alive":23,"dead":[7],"stuck":[],"unknown":[12],"fw":["2.1",..,""],"rxovr":[0,..]}
+ * fw / rxovrはPanelID順(PANEL_1から)、届いていないパネルは"" / 0
+ *
+ * @param    pxTbl: 死活テーブル
+ * @param    pcBuf: 出力先
+ * @param    xSize: 出力先のサイズ
+ *
+ * @return   出力した文字数(切り詰めた場合はxSize - 1)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int lLiveTblFormatJson(const liveTbl_t *pxTbl, char *pcBuf, size_t xSize)
+{
+    uint32_t ulMask;
+    size_t xPos;
+    int iFirst;
+
+    xPos = snprintf(pcBuf, xSize, "{\"%s\":%u", cpcLiveName[PANEL_LIVE_ALIVE],
+                    (unsigned)__builtin_popcount(ulLiveTblMask(pxTbl, PANEL_LIVE_ALIVE)));
+    for (uint32_t s = 0; s < COUNTOF(ceListed) && xPos < xSize; s++)
+    {
+        ulMask = ulLiveTblMask(pxTbl, ceListed[s]);
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, ",\"%s\":[", cpcLiveName[ceListed[s]]);
+        iFirst = 1;
+        for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM && xPos < xSize; i++)
+        {
+            if ((ulMask & (1UL << i)) == 0)
+                continue;
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "%s%u", iFirst ? "" : ",", i);
+            iFirst = 0;
+        }
+        if (xPos < xSize)
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "]");
+    }
+    if (xPos < xSize)
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, ",\"fw\":[");
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM && xPos < xSize; i++)
+    {
+        if ((pxTbl->ulHeard & (1UL << i)) != 0)
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "%s\"%u.%u\"",
+                             i == PANEL_1 ? "" : ",", pxTbl->bFwMajor[i], pxTbl->bFwMinor[i]);
+        else
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "%s\"\"", i == PANEL_1 ? "" : ",");
+    }
+    if (xPos < xSize)
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, "],\"rxovr\":[");
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM && xPos < xSize; i++)
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, "%s%u", i == PANEL_1 ? "" : ",",
+                         pxTbl->usRxOvr[i]);
+    if (xPos < xSize)
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, "]}");
+
+    return (int)(xPos < xSize ? xPos : xSize - 1);
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_live.h
+ * @comments パネルの死活テーブル(死活監視のフレームから作る)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_LIVE_H
+#define SRC_CTRL_LIVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* パネルの状態 */
+typedef enum PANEL_LIVE
+{
+    PANEL_LIVE_UNKNOWN = 0, // 一度も届いていない(v1のファームウェア／起動時から故障)
+    PANEL_LIVE_ALIVE,       // 届いている
+    PANEL_LIVE_DEAD,        // 途絶えた(configPANEL_DEAD_MS)
+    PANEL_LIVE_STUCK,       // 届いているがセンサが踏まれたまま
+    MAX_PANEL_LIVE
+} ePanelLive_t;
+
+/*
+ * 死活テーブル
+ * PANEL_NOで引くSoA形式。[0]は空とし、enumの値と対応させる。
+ * 状態はxLiveTblUpdateでだけ変わる(受信の度には変えない)。
+ */
+typedef struct LIVE_TBL
+{
+    uint8_t bState[MAX_PANEL_NUM];    // ePanelLive_t
+    uint8_t bSensor[MAX_PANEL_NUM];   // TBCAN_SENSOR_*
+    uint8_t bCount[MAX_PANEL_NUM];    // 最後に受けた送信回数
+    uint8_t bFwMajor[MAX_PANEL_NUM];  // ファームウェアのバージョン
+    uint8_t bFwMinor[MAX_PANEL_NUM];
+    uint16_t usLost[MAX_PANEL_NUM];   // 送信回数の飛び(バス上で失ったフレーム)
+    uint16_t usBoots[MAX_PANEL_NUM];  // 起動の通知を受けた回数
+    uint16_t usRxFull[MAX_PANEL_NUM]; // Panelの受信の列が一杯だった回数(TBCAN_FEAT_RXCNT)
+    uint16_t usRxOvr[MAX_PANEL_NUM];  // Panelの受信オーバーフロー(失った指示)
+    int64_t llLastUs[MAX_PANEL_NUM];  // 最後に受けた時刻[us]
+    uint32_t ulHeard;                 // 一度でも届いたパネル(bit = PanelID)
+    uint32_t ulExclude;               // 生成から外すパネル(DEAD | STUCK)
+} liveTbl_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vLiveTblInit(liveTbl_t *pxTbl);
+void vLiveTblOnStatus(liveTbl_t *pxTbl, const tbCanStatus_t *pxStatus, int64_t llNowUs);
+BOOL_t xLiveTblUpdate(liveTbl_t *pxTbl, int64_t llNowUs);
+uint32_t ulLiveTblMask(const liveTbl_t *pxTbl, ePanelLive_t eState);
+int lLiveTblFormatJson(const liveTbl_t *pxTbl, char *pcBuf, size_t xSize);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -27,6 +27,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/timers.h"
+#include "freertos/event_groups.h"
 
 /* Standard Lib Includes */
 #include <stdio.h>
@@ -38,6 +39,7 @@
 #include "esp_system.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 /* User Includes */
 #include "def_system.h"
@@ -46,6 +48,16 @@
 #include "drv_dfplayer.h"
 #include "drv_hpdltb.h"
 #include "ctrl_main.h"
+#include "ctrl_adapt.h"
+#include "ctrl_dfclt.h"
+#include "ctrl_group.h"
+#include "ctrl_panel.h"
+#include "ctrl_sched.h"
+#include "ctrl_spawn.h"
+#include "ctrl_zone.h"
+#include "util_rec.h"
+#include "util_ring.h"
+#include "util_trace.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -56,28 +68,37 @@
 #define tskprioCTRL_RXTASK 5
 
 /* Queue Configure */
-#define QUEUE_CTRL_RX_SIZE 16
-#define QUEUE_CTRL_RX_WAIT portMAX_DELAY
+#define QUEUE_CTRL_RX_SIZE 16 // SPSC Ring, Producer: CAN_rxタスク
+#define QUEUE_CTRL_RX_POLICY RING_POLICY_BLOCK
+#define QUEUE_CTRL_RX_WAIT pdMS_TO_TICKS(configSTART_RESEND_MS) // 過ぎたらスタート通知を送り直す
 #define QUEUE_CTRL_RX_WAIT_NOWPLAYING pdMS_TO_TICKS(1000)
 
 #define QUEUE_PLAYER_RX_SIZE 4
 #define QUEUE_PLAYER_RX_WAIT pdMS_TO_TICKS(100) // デモLED点灯間隔
 
+/*
+ * Event Configure
+ * Task NotifyはRingの待ち合わせに使うため、Tx/Rx間の通知はEvent Groupで行う
+ */
+#define EVENT_CTRL_GAME_START BIT0 // Tx -> Rx: ゲーム開始
+#define EVENT_CTRL_SCORE_DONE BIT1 // Rx -> Tx: スコア確定
+
 /* Timer Configure */
 #define TIMER_GAMEMNG_COUNT_TICK pdMS_TO_TICKS(100) // 0.1sタイマ
+#define TIMER_GAMEMNG_COUNT_US 100000               // 0.1sタイマ[us]
 #define TIMER_INIT_TIME 500                         // 60秒をカウントする(600 Count)
-#define TIMER_SPEEDUP_COEFFICIENT 0.8               // スピードアップ時の係数
 #define TIMER_SPEEDUP_THRESHOLD 250                 // スピードアップの時間しきい値
 
 /* Game Configure */
-#define gameconfSTART_SW_PANEL_NUM PANEL_13
-#define gameconfSTART_SW_LIGHT_TIME 2  // second
-#define gameconfINIT_HIT_POINT 5       // 体力上限
-#define gameconfLIGHT_TIME 2           // second, ゲーム中のLED点灯時間
-#define gameconfLIGHT_TIME_EASY 2      // second, ゲーム中のLED点灯時間
-#define gameconfLIGHT_TIME_NORMAL 2    // second, ゲーム中のLED点灯時間
-#define gameconfLIGHT_TIME_HARD 1.5    // second, ゲーム中のLED点灯時間
-#define gameconfLIGHT_TIME_LUNAITC 1.5 // second, ゲーム中のLED点灯時間
+#define gameconfENTRY_GATHER_MS 2000        // 最初のエントリーから同じ回のエントリーを待つ時間
+#define gameconfSTART_SW_LIGHT_TIME_MS 2000 // スタートSWの点灯時間
+#define gameconfINIT_HIT_POINT 5            // 体力上限
+#define gameconfEXPIRE_MARGIN_MS 100        // 点灯終了からパネルを再利用するまでの余裕
+// ゲーム中の点灯時間、生成周期、体力増減は難易度プロファイル(ctrl_dfclt)
+// 点灯時間と生成周期はゲーム中に適応難易度(ctrl_adapt)が範囲内で調整する
+#define gameconfSPAWN_MIN_DIST 1     // プレイヤーの足元には出さない
+#define gameconfSPAWN_STEP_MS 300    // 1マス移動する時間(届く距離の見積もり)
+#define gameconfSPAWN_ANTI_CLUSTER pdFALSE // 点灯中パネルの隣を避ける(遠くに散るので既定は無効)
 
 /* Demo Blink Configure */
 #define DEMO_HALOWEEN_MODE 0
@@ -89,11 +110,6 @@
  * Constant Table
  * [0]は空とし、enumの値と対応させる。
  */
-const struct HIT_POINT_TBL csHpTbl[] = {{},
-                                        {DFCLT_EASY, 0, 0, 0},
-                                        {DFCLT_NORMAL, 1, 0, -1},
-                                        {DFCLT_HARD, 1, 0, -2},
-                                        {DFCLT_LUNATIC, 0, 0, -4}};
 const struct WEAK_POINT_TBL csWeakTbl[] = {{},
                                            {TEAM_RED, GREEN, RED, BLUE},
                                            {TEAM_GREEN, BLUE, GREEN, RED},
@@ -102,6 +118,38 @@ const struct WEAK_POINT_TBL csWeakTbl[] = {{},
 /*****************************************************************************/
 /* TAG Definitions
 ******************************************************************************/
+/*
+ * 区画(同時に遊ぶゲーム)毎の状態
+ * エントリー1件につき1区画。区画毎に体力、得点、残り時間、難易度を持つ。
+ */
+typedef struct GAME_ZONE
+{
+    struct GAME_INFO stGameInfo;
+    /*
+     * 難易度プロファイル: ゲーム開始時にTxタスクがコピーする
+     * (ゲーム中の上書きは次のゲームから反映)
+     */
+    dfcltProfile_t stDfclt;
+    adaptCtrl_t stAdapt; // xPanelTblMuxで排他
+    spawnGen_t stSpawn;  // xPanelTblMuxで排他
+    uint32_t ulSeed;     // 生成器のシード(ログ用)
+    int iTimer;          // 残りカウント
+    /*
+     * Timer Flag: ゲームプレイ時にpdTRUEへ
+     * カウント0 or 体力0でpdFALSEに戻す
+     */
+    BOOL_t xTimerFlag;
+} gameZone_t;
+
+/* 待機中のデモのアニメーション(Panelが描く) */
+typedef struct DEMO_ANIM
+{
+    uint8_t bAnim;       // TBCAN_ANIM_*
+    uint8_t bColorInfoR; // 色(パレットの色)
+    uint8_t bColorInfoG;
+    uint8_t bColorInfoB;
+    uint16_t usPeriodMs; // 周期[ms]
+} demoAnim_t;
 
 /*****************************************************************************/
 /* Variable Definitions
@@ -113,22 +161,49 @@ TaskHandle_t xCtrlRxTask;
 TaskHandle_t xCtrlTxTask;
 
 // Queue
-QueueHandle_t xCtrlRxCanQueue = NULL;
 QueueHandle_t xPlayerInfoQueue = NULL;
 
+// Ring
+static SpscRing<canCommMsg_t, QUEUE_CTRL_RX_SIZE> xCtrlRxCanRing;
+
+// Event
+EventGroupHandle_t xCtrlEventGroup;
+
 // Timer
 TimerHandle_t xGameMngTimer;
-int sulTimer;
 
-// Flags(static)
+// for Game
 /*
- * Timer Flag: ゲームプレイ時にpdTRUEへ
- * カウント0 or 体力0でpdFALSEに戻す
+ * 区画毎のゲーム: [0 .. ulZoneNum-1]を使う
+ * 区画数と割り当てはゲーム開始前にTxタスクが決め、ゲーム中は変えない
  */
-static BOOL_t xTimerFlag = pdFALSE;
+static gameZone_t stZone[configZONE_MAX];
+static uint32_t ulZoneNum = 1;
+static const zoneLayout_t *pxZoneLayout = NULL;
 
-// for Game
-static struct GAME_INFO stGameInfo;
+/*
+ * Panel State Table: Tx(点灯)とRx(押下判定)で共有する
+ * 適応難易度と生成器(プレイヤー位置)も同じ契機で更新するので、
+ * いずれもxPanelTblMuxで排他する(区画は重ならないので1つの表で足りる)
+ */
+static panelTbl_t stPanelTbl;
+static portMUX_TYPE xPanelTblMux = portMUX_INITIALIZER_UNLOCKED;
+
+/* デモのアニメーション: configANIM_DEMO_MS毎に順に切り替える */
+static const demoAnim_t csDemoAnimTbl[] = {
+#if DEMO_HALOWEEN_MODE == 1
+    {TBCAN_ANIM_BREATHE, 235, 97, 0, 3000},
+    {TBCAN_ANIM_SWEEP, 106, 51, 134, 1000},
+    {TBCAN_ANIM_CHASE, 235, 97, 0, 800},
+    {TBCAN_ANIM_PULSE, 106, 51, 134, 1000},
+#else
+    {TBCAN_ANIM_RAINBOW, MAX_BR, MAX_BR, MAX_BR, 2000},
+    {TBCAN_ANIM_SWEEP, 0, 0, MAX_BR, 1000},
+    {TBCAN_ANIM_BREATHE, MAX_BR, 0, 0, 3000},
+    {TBCAN_ANIM_CHASE, 0, MAX_BR, 0, 800},
+    {TBCAN_ANIM_PULSE, MAX_BR, MAX_BR, MAX_BR, 1000},
+#endif
+};
 
 /*****************************************************************************/
 /* Function Prototypes
@@ -141,12 +216,26 @@ static void prvCtrlMainTxTask(void *pxParameters);
 void prvGameTimerHandle(TimerHandle_t xTimer);
 
 // Some Functions
-void vLightOnAllPanel(uint32_t ulLightTime, TickType_t xInterval);
-BOOL_t xSendStartNotifyToPanel(eTeamcl_t eTeam);
+void vLightOnAllPanel(uint32_t ulLightTimeMs);
+void vSendGroupMsg(uint32_t ulPanelMask, canCommMsg_t tCanMsg);
+BOOL_t xSendStartNotifyToPanel(uint32_t ulPanelId, eTeamcl_t eTeam);
 enum COLOR eDetectPanelColor(canCommMsg_t *canMsg);
-int iCalcHitPoint(eTeamcl_t eTeam, eDfclt_t eDfclt, enum COLOR eColor);
-void vGameStartSequence(eTeamcl_t eTeam);
+int iCalcHitPoint(eTeamcl_t eTeam, const dfcltProfile_t *pxDfclt,
+                  enum COLOR eColor);
+void vGameStartSequence();
 void vGameFinishSequence();
+int64_t llGetSpawnIntervalUs(gameZone_t *pxZone, BOOL_t xSpeedUp);
+BOOL_t xIsWeakColor(eTeamcl_t eTeam, uint8_t bColor);
+BOOL_t xIsAnyZonePlaying();
+BOOL_t xSpawnPanel(uint32_t ulZone);
+uint32_t ulGatherEntries(playerInfo_t *pxEntry);
+void vSetTeamColor(eTeamcl_t eTeam, canCommMsg_t *pxMsg);
+void vSetAnimMsg(canCommMsg_t *pxMsg, uint8_t bAnim, uint16_t usPeriodMs,
+                 uint16_t usDurationMs, int64_t llStartUs);
+void vSendDemoAnim(uint32_t ulIdx);
+void vSendCountRing(uint32_t ulPanelId, const canCommMsg_t *pxColor, uint32_t ulCount);
+long lRandomRec(long lMin, long lMax);
+void vRecordResult(uint32_t ulZone);
 
 /*****************************************************************************/
 /* Public Function
@@ -167,17 +256,23 @@ esp_err_t lInitCtrlMainFunction()
 {
     BOOL_t xStatus;
 
-    // Create Queue
-    xCtrlRxCanQueue = xQueueCreate(QUEUE_CTRL_RX_SIZE, sizeof(canCommMsg_t));
-    configASSERT(xCtrlRxCanQueue);
+    // Create Ring / Queue
+    xCtrlRxCanRing.vInit(QUEUE_CTRL_RX_POLICY, "xCtrlRxCanRing");
     xPlayerInfoQueue = xQueueCreate(QUEUE_CTRL_RX_SIZE, sizeof(playerInfo_t));
     configASSERT(xPlayerInfoQueue);
 
+    // Create Event
+    xCtrlEventGroup = xEventGroupCreate();
+    configASSERT(xCtrlEventGroup);
+
     // Create Timer
     xGameMngTimer = xTimerCreate("GameMngTimer", TIMER_GAMEMNG_COUNT_TICK,
                                  pdTRUE, NULL, prvGameTimerHandle);
     configASSERT(xGameMngTimer);
 
+    // Create Scheduler
+    ESP_ERROR_CHECK(lInitCtrlSched());
+
     // Create Task
     xStatus = xTaskCreatePinnedToCore(
         prvCtrlMainRxTask, "prvCtrlMainRxTask", tskstacMAIN_CTRLTASK, NULL,
@@ -212,20 +307,46 @@ BOOL_t xSendPlayerInfoQueue(playerInfo_t playerInfo)
 
 /*****************************************************************************/
 /**
- * Can MsgをCtrlMain Queueへ送信
+ * 同じ回のPlayer InfoをまとめてQueueへ送信
  *
- * @param    canCommMsg_t：canで送信するメッセージ
+ * @param    pxInfo: エントリーの配列
+ * @param    ulNum: エントリー数
  *
- * @return   pdPASS / pdFAIL
+ * @return   pdPASS:全員送った / pdFAIL:Queueの空きが足りない(誰も送らない)
  *
- * @note		##
+ * @note     送り手はtcp_server_taskだけなので、空きを確かめた後に減ることはない
  *
  ******************************************************************************/
-BOOL_t xSendCtrlCanRxQueue(canCommMsg_t canRxMsg)
+BOOL_t xSendPlayerInfoSet(const playerInfo_t *pxInfo, uint32_t ulNum)
 {
-    BOOL_t xStatus;
-    xStatus = xQueueSendToBack(xCtrlRxCanQueue, &canRxMsg, portMAX_DELAY);
-    return xStatus;
+    if (uxQueueSpacesAvailable(xPlayerInfoQueue) < ulNum)
+        return pdFAIL;
+
+    for (uint32_t i = 0; i < ulNum; i++)
+    {
+        if (xQueueSendToBack(xPlayerInfoQueue, &pxInfo[i], 0) != pdPASS)
+            return pdFAIL;
+    }
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * Can MsgをCtrlMain Queueへまとめて送信
+ *
+ * @param    pxCanRxMsg：canで受信したメッセージの配列
+ * @param    ulNum：メッセージ数
+ *
+ * @return   送信したメッセージ数
+ *
+ * @note		CAN_rxタスクからのみ呼ぶこと(SPSC)
+ *          得点を落とさないため、満杯なら空くまで待つ
+ *          ctrl_mainを起こすのは1回だけ
+ *
+ ******************************************************************************/
+uint32_t ulSendCtrlCanRxBatch(const canCommMsg_t *pxCanRxMsg, uint32_t ulNum)
+{
+    return xCtrlRxCanRing.ulSendBatch(pxCanRxMsg, ulNum, portMAX_DELAY);
 }
 
 /*****************************************************************************/
@@ -246,27 +367,80 @@ BOOL_t xSendCtrlCanRxQueue(canCommMsg_t canRxMsg)
 static void prvCtrlMainTxTask(void *pxParameters)
 {
     playerInfo_t playerInfo = {};
+    playerInfo_t tEntry[configZONE_MAX] = {};
     canCommMsg_t canMsg = {};
     dfpCtrlMsg_t dfpMsg = {};
     hpdltb_t tHpdltb = {};
-    enum COLOR eColor;
-    uint32_t ulPanelIdBuff = 0;
-    TickType_t xDelay = configWAIT_EASY;
+    schedItem_t tSched = {};
+    schedJitter_t tJitter = {};
+    adaptBounds_t tBounds[configZONE_MAX] = {};
+    adaptCtrl_t tAdapt = {};
+    canTxStats_t tCanFrom = {};
+    canTxStats_t tCanTo = {};
+    canHealth_t tCanHealth;
+    canRelStats_t tCanRel;
+    canRxStats_t tCanRx;
+    gameZone_t *pxZone;
+    int64_t llIntervalUs = 0;
+    int64_t llNowUs = 0;
+    BOOL_t xSpeedUp = pdFALSE;
+    BOOL_t xMissed;
+    uint8_t bColor;
+    uint8_t bZone;
+    uint32_t ulPanelId;
+    uint32_t ulZone;
+    uint32_t ulStartMask;
+    uint32_t ulRelaxed;
+    uint32_t ulLiveSeq;
+    uint32_t ulAnimIdx = 0;
+    TickType_t xAnimTick = 0;
+    BOOL_t xAnimDemo = pdFALSE;
+    uint32_t i;
+
+    // 起動前に全Panelへ問い合わせ(返信で死活テーブルが埋まる)
+    xSendCanDiscover();
 
     // 起動前全点灯
-    vLightOnAllPanel(3, pdMS_TO_TICKS(50));
+    vLightOnAllPanel(3000);
     vTaskDelay(pdMS_TO_TICKS(3000));
 
     for (;;)
     {
         // スタート通知待ち
         xSendGamemngTxQueue(GMMSG_FIN_PREPARE);
+        xSendGamemngTxQueue(GMMSG_PANELS);
+        ulLiveSeq = ulCanGetLive(NULL);
 
         tHpdltb.eMsg = HPDLTB_BLANK;
-        xSendHpdltbQueue(tHpdltb);
+        for (i = 0; i < configZONE_MAX; i++)
+        {
+            tHpdltb.bLine = (uint8_t)i;
+            xSendHpdltbQueue(tHpdltb);
+        }
 
         while (xQueueReceive(xPlayerInfoQueue, &playerInfo, QUEUE_PLAYER_RX_WAIT) != pdPASS)
         {
+            // 待機中にパネルの死活が変わったら運営画面へ
+            if (ulCanGetLive(NULL) != ulLiveSeq)
+            {
+                xSendGamemngTxQueue(GMMSG_PANELS);
+                ulLiveSeq = ulCanGetLive(NULL);
+            }
+
+            // Panelが全てアニメーションを描けるなら、間隔毎に1フレームで盤面全体へ
+            if (xCanPanelsHaveFeat(ulGroupPanelMask(CAN_ID_GROUP_ALL), TBCAN_FEAT_ANIM))
+            {
+                if (!xAnimDemo ||
+                    xTaskGetTickCount() - xAnimTick >= pdMS_TO_TICKS(configANIM_DEMO_MS))
+                {
+                    vSendDemoAnim(ulAnimIdx++);
+                    xAnimTick = xTaskGetTickCount();
+                    xAnimDemo = pdTRUE;
+                }
+                continue;
+            }
+            xAnimDemo = pdFALSE;
+
             // Demo Blink
             // バッファクリア
             memset(&canMsg, 0x00, sizeof(canCommMsg_t));
@@ -275,7 +449,7 @@ static void prvCtrlMainTxTask(void *pxParameters)
             canMsg.bPanelId = 0;
             canMsg.bBtnFlag = 0;
             canMsg.bStartSwFlag = 0;
-            canMsg.bLightTime = 1;
+            canMsg.usLightTimeMs = 1000;
 
             // ランダム要素
             canMsg.ulCanId = (uint32_t)random(PANEL_1, MAX_PANEL_NUM);
@@ -303,43 +477,61 @@ static void prvCtrlMainTxTask(void *pxParameters)
             // 送信
             xSendCanTxQueue(canMsg);
         }
-        // デモ点灯の後若干待ちを入れる
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        ESP_LOGI(TAG, "Player Info | startFlg:%d name:%s diffculty:%d team:%d",
-                 playerInfo.startFlg, playerInfo.name, playerInfo.difficulty,
-                 playerInfo.team);
+        // デモのアニメーションを止める(ゲームの点灯に混ざらないように)
+        if (xAnimDemo)
+        {
+            memset(&canMsg, 0x00, sizeof(canCommMsg_t));
+            vSetAnimMsg(&canMsg, TBCAN_ANIM_OFF, configANIM_DEMO_MS, 0, 0);
+            vSendGroupMsg(ulGroupPanelMask(CAN_ID_GROUP_ALL), canMsg);
+            xAnimDemo = pdFALSE;
+        }
+        // デモ点灯の後若干待ちを入れる(この間に届いた同じ回のエントリーも受け付ける)
+        tEntry[0] = playerInfo;
+        ulZoneNum = ulGatherEntries(tEntry);
+        pxZoneLayout = pxZoneGetLayout(ulZoneNum);
 
         /* ゲーム情報をコピー */
-        stGameInfo.difficuty = playerInfo.difficulty;
-        stGameInfo.team = playerInfo.team;
-        sprintf(stGameInfo.name, playerInfo.name);
-
-        /* 難易度別にDelayを設定する */
-        switch (stGameInfo.difficuty)
+        for (i = 0; i < ulZoneNum; i++)
         {
-        case DFCLT_EASY:
-            xDelay = configWAIT_EASY;
-            break;
-        case DFCLT_NORMAL:
-            xDelay = configWAIT_NORMAL;
-            break;
-        case DFCLT_HARD:
-            xDelay = configWAIT_HARD;
-            break;
-        case DFCLT_LUNATIC:
-            xDelay = configWAIT_LUNATIC;
-            break;
-        default:
-            break;
+            ESP_LOGI(TAG, "Player Info | zone:%u startFlg:%d name:%s diffculty:%d team:%d",
+                     i, tEntry[i].startFlg, tEntry[i].name, tEntry[i].difficulty,
+                     tEntry[i].team);
+            memset(&stZone[i], 0x00, sizeof(gameZone_t));
+            stZone[i].stGameInfo.difficuty = tEntry[i].difficulty;
+            stZone[i].stGameInfo.team = tEntry[i].team;
+            stZone[i].stGameInfo.zone = i;
+            snprintf(stZone[i].stGameInfo.name, sizeof(stZone[i].stGameInfo.name),
+                     "%s", tEntry[i].name);
         }
 
         if (playerInfo.startFlg == pdTRUE)
         {
+            // 記録開始(エントリーからゲーム終了まで)
+            vRecStartGame();
+            for (i = 0; i < ulZoneNum; i++)
+            {
+                bZone = (uint8_t)i;
+                vRecEvent(REC_ENTRY, (uint8_t)stZone[i].stGameInfo.team,
+                          (uint16_t)stZone[i].stGameInfo.difficuty, &bZone, 1);
+            }
+            vCanRecLive();
+
             // CANのキューをリセットしておく
-            xQueueReset(xCtrlRxCanQueue);
+            xCtrlRxCanRing.vReset();
 
-            // スタートSWのメッセージを送信
-            xSendStartNotifyToPanel(playerInfo.team);
+            // スタートSWのメッセージを送信(区画毎)
+            ulStartMask = 0;
+            for (i = 0; i < ulZoneNum; i++)
+            {
+                if ((ulCanPanelExcludeMask() & (1UL << pxZoneLayout->bStartSw[i])) != 0)
+                {
+                    ESP_LOGW(TAG, "Start SW not alive | zone:%u panel:%u", i,
+                             pxZoneLayout->bStartSw[i]);
+                }
+                xSendStartNotifyToPanel(pxZoneLayout->bStartSw[i],
+                                        stZone[i].stGameInfo.team);
+                ulStartMask |= 1UL << pxZoneLayout->bStartSw[i];
+            }
 
             // GameMngにPlayerEntry表示
             xSendGamemngTxQueue(GMMSG_ENTRY);
@@ -349,121 +541,201 @@ static void prvCtrlMainTxTask(void *pxParameters)
             dfpMsg.uiVolume = DFPLAYER_DEFAULT_VOLUME;
             xSendDfplayerQueue(dfpMsg);
 
-            // 押下待ち
-            xQueueReceive(xCtrlRxCanQueue, &canMsg, QUEUE_CTRL_RX_WAIT);
-            ESP_LOGD(TAG, "Receive CAN Msg | Panel:%d", canMsg.bPanelId);
+            // 押下待ち(全区画のスタートSW)
+            while (ulStartMask != 0)
+            {
+                if (xCtrlRxCanRing.xReceive(&canMsg, QUEUE_CTRL_RX_WAIT) != pdTRUE)
+                {
+                    // 届かなかった(v1のPanel、再送し切った)ときのため送り直す
+                    for (i = 0; i < ulZoneNum; i++)
+                    {
+                        if ((ulStartMask & (1UL << pxZoneLayout->bStartSw[i])) == 0)
+                            continue;
+                        ESP_LOGW(TAG, "Start SW resend | zone:%u panel:%u", i,
+                                 pxZoneLayout->bStartSw[i]);
+                        xSendStartNotifyToPanel(pxZoneLayout->bStartSw[i],
+                                                stZone[i].stGameInfo.team);
+                    }
+                    continue;
+                }
+                ESP_LOGD(TAG, "Receive CAN Msg | Panel:%d", canMsg.bPanelId);
+
+                // スタートSW以外が来たら中止
+                if (canMsg.bBtnFlag != 1 || canMsg.bPanelId >= MAX_PANEL_NUM ||
+                    (ulStartMask & (1UL << canMsg.bPanelId)) == 0)
+                {
+                    break;
+                }
+                ulStartMask &= ~(1UL << canMsg.bPanelId);
+            }
 
-            // CAN MsgがPANEL_13でBtnFlg==1のとき
-            if (canMsg.bBtnFlag == 1 && canMsg.bPanelId == PANEL_13)
+            // 全区画のスタートSWでBtnFlg==1のとき
+            if (ulStartMask == 0)
             {
                 // ゲームスタート通知(GM? Web?)
                 xSendGamemngTxQueue(GMMSG_GAME_START);
+                vCanGetTxStats(&tCanFrom);
 
                 /*
                  * ゲームスタートカウントダウン
                  */
-                vGameStartSequence(playerInfo.team);
+                vGameStartSequence();
+
+                // 難易度プロファイル確定(Rxタスクの体力計算でも使う)
+                for (i = 0; i < ulZoneNum; i++)
+                {
+                    pxZone = &stZone[i];
+                    vDfcltGetProfile(pxZone->stGameInfo.difficuty, &pxZone->stDfclt);
+                    ESP_LOGI(TAG, "Dfclt profile | zone:%u spawn:%ums light:%ums speedup:%u%%",
+                             i, pxZone->stDfclt.usSpawnMs, pxZone->stDfclt.usLightMs,
+                             pxZone->stDfclt.bSpeedUpPct);
+                    vRecEvent(REC_GAME_START, (uint8_t)i, 0, &pxZone->stDfclt,
+                              sizeof(pxZone->stDfclt));
+                    vDfcltGetAdaptBounds(pxZone->stGameInfo.difficuty, &pxZone->stDfclt,
+                                         &tBounds[i]);
+                    ESP_LOGI(TAG, "Adapt bounds | zone:%u spawn:%u-%ums light:%u-%ums target:%u%%",
+                             i, tBounds[i].usSpawnMinMs, tBounds[i].usSpawnMaxMs,
+                             tBounds[i].usLightMinMs, tBounds[i].usLightMaxMs,
+                             tBounds[i].bHitTargetPct);
+                }
 
                 // タイマ開始（ゲームスタート、カウント開始）
-                xTimerFlag = pdTRUE;
-                sulTimer = TIMER_INIT_TIME;
-                ESP_LOGI(TAG, "Start Timer");
+                for (i = 0; i < ulZoneNum; i++)
+                {
+                    stZone[i].iTimer = TIMER_INIT_TIME;
+                    stZone[i].xTimerFlag = pdTRUE;
+                }
+                ESP_LOGI(TAG, "Start Timer | zones:%u", ulZoneNum);
                 xTimerReset(xGameMngTimer, portMAX_DELAY);
 
                 // 受信タスク動作開始
-                xTaskNotifyGive(xCtrlRxTask);
-
-                // バッファクリア
-                memset(&canMsg, 0x00, sizeof(canCommMsg_t));
+                xEventGroupSetBits(xCtrlEventGroup, EVENT_CTRL_GAME_START);
 
-                // ゲーム中フラグON(タイマ != 0, 体力 != 0)
-                while (xTimerFlag == pdTRUE)
+                /*
+                 * パネル生成／点灯終了／スピードアップをスケジューラへ登録
+                 * 生成は開始時刻からの周期で決まるため、CAN送信の待ちで
+                 * 周期がずれない。生成は区画毎(ulArg:区画)。
+                 */
+                vTraceStartGame();
+                llNowUs = esp_timer_get_time();
+                vCtrlSchedClear();
+                // 生成器のシード(記録に残るので再生で同じ並びになる)
+                for (i = 0; i < ulZoneNum; i++)
                 {
-                    // パネルランダム生成
-                    do
-                    {
-                        ulPanelIdBuff = (uint32_t)random(PANEL_1, MAX_PANEL_NUM);
-                    } while (canMsg.ulCanId == ulPanelIdBuff);
-
-                    // バッファクリア
-                    memset(&canMsg, 0x00, sizeof(canCommMsg_t));
-
-                    canMsg.ulCanId = ulPanelIdBuff;
-                    // canMsg.ulCanId = PANEL_6;
-
-                    // 色ランダム生成
-                    eColor = (enum COLOR)random(RED, BLUE + 1);
-                    switch (eColor)
-                    {
-                    case RED:
-                        canMsg.bColorInfoR = MAX_BR;
-                        break;
-                    case GREEN:
-                        canMsg.bColorInfoG = MAX_BR;
-                        break;
-                    case BLUE:
-                        canMsg.bColorInfoB = MAX_BR;
-                        break;
-                    default:
-                        break;
-                    }
-
-                    // 押下許可フラグ
-                    canMsg.bBtnFlag = 1;
+                    stZone[i].ulSeed = ((uint32_t)lRandomRec(0, 0x7FFF) << 15) |
+                                       (uint32_t)lRandomRec(0, 0x7FFF);
+                }
+                portENTER_CRITICAL(&xPanelTblMux);
+                vPanelTblClear(&stPanelTbl);
+                for (i = 0; i < ulZoneNum; i++)
+                {
+                    vAdaptInit(&stZone[i].stAdapt, &tBounds[i], stZone[i].stDfclt.usSpawnMs,
+                               stZone[i].stDfclt.usLightMs);
+                    vSpawnGenInit(&stZone[i].stSpawn, stZone[i].ulSeed,
+                                  pxZoneLayout->bStartSw[i]);
+                }
+                portEXIT_CRITICAL(&xPanelTblMux);
+                xSpeedUp = pdFALSE;
+                for (i = 0; i < ulZoneNum; i++)
+                {
+                    xCtrlSchedAdd(llNowUs, SCHED_EV_SPAWN, i);
+                }
+                xCtrlSchedAdd(llNowUs + (int64_t)(TIMER_INIT_TIME - TIMER_SPEEDUP_THRESHOLD + 1) *
+                                            TIMER_GAMEMNG_COUNT_US,
+                              SCHED_EV_SPEEDUP, 0);
 
-                    // LED点灯時間
-                    // 難易度別に設定する
-                    switch (stGameInfo.difficuty)
-                    {
-                    case DFCLT_EASY:
-                        canMsg.bLightTime = gameconfLIGHT_TIME_EASY;
-                        break;
-                    case DFCLT_NORMAL:
-                        canMsg.bLightTime = gameconfLIGHT_TIME_NORMAL;
-                        break;
-                    case DFCLT_HARD:
-                        canMsg.bLightTime = gameconfLIGHT_TIME_HARD;
-                        break;
-                    case DFCLT_LUNATIC:
-                        canMsg.bLightTime = gameconfLIGHT_TIME_LUNAITC;
-                        break;
-                    default:
-                        break;
-                    }
+                // ゲーム中フラグON(いずれかの区画でタイマ != 0, 体力 != 0)
+                while (xIsAnyZonePlaying() == pdTRUE)
+                {
+                    vCtrlSchedWaitUntil(llCtrlSchedNextDeadline(),
+                                        TIMER_GAMEMNG_COUNT_TICK);
 
-                    // 残り時間がn秒になったらゲームスピードを早くする
-                    if (sulTimer < TIMER_SPEEDUP_THRESHOLD)
+                    while (xIsAnyZonePlaying() == pdTRUE &&
+                           xCtrlSchedPop(esp_timer_get_time(), &tSched) == pdTRUE)
                     {
-                        /* 難易度別にDelayを設定する */
-                        switch (stGameInfo.difficuty)
+                        switch (tSched.eEvent)
                         {
-                        case DFCLT_EASY:
-                            xDelay = configWAIT_EASY * TIMER_SPEEDUP_COEFFICIENT;
-                            break;
-                        case DFCLT_NORMAL:
-                            xDelay = configWAIT_NORMAL * TIMER_SPEEDUP_COEFFICIENT;
+                        case SCHED_EV_SPAWN:
+                            // 終わった区画は生成しない(次も登録しない)
+                            pxZone = &stZone[tSched.ulArg];
+                            if (pxZone->xTimerFlag != pdTRUE)
+                            {
+                                break;
+                            }
+                            // 次の生成(周期は適応難易度の現在値、遅れて過ぎた周期は飛ばす)
+                            // 取り出した分の空きがあるうちに登録する(点灯終了に取られないように)
+                            llIntervalUs = llGetSpawnIntervalUs(pxZone, xSpeedUp);
+                            tSched.llDeadlineUs += llIntervalUs;
+                            llNowUs = esp_timer_get_time();
+                            while (tSched.llDeadlineUs <= llNowUs)
+                            {
+                                tSched.llDeadlineUs += llIntervalUs;
+                            }
+                            if (xCtrlSchedAdd(tSched.llDeadlineUs, SCHED_EV_SPAWN,
+                                              tSched.ulArg) != pdPASS)
+                            {
+                                ESP_LOGE(TAG, "[Critical Error] Spawn stopped | zone:%u",
+                                         tSched.ulArg);
+                            }
+
+                            // CANが止まっている間は点灯しても届かないので飛ばす(周期は続ける)
+                            if (eCanGetHealth() != CAN_HEALTH_DOWN)
+                            {
+                                xSpawnPanel(tSched.ulArg);
+                            }
                             break;
-                        case DFCLT_HARD:
-                            xDelay = configWAIT_HARD * TIMER_SPEEDUP_COEFFICIENT;
+                        case SCHED_EV_EXPIRE:
+                            // ulArg: PanelID | 世代 << 8
+                            // 押されずに消えたら見逃し(弱点色は避けて正解なので数えない)
+                            // CANが不調の間は押しても届かないことがあるので難易度に数えない
+                            ulPanelId = tSched.ulArg & 0xFF;
+                            ulZone = ulZoneOfPanel(pxZoneLayout, ulPanelId);
+                            portENTER_CRITICAL(&xPanelTblMux);
+                            bColor = stPanelTbl.bColor[ulPanelId];
+                            xMissed = xPanelTblExpire(&stPanelTbl, ulPanelId,
+                                                      (uint8_t)(tSched.ulArg >> 8));
+                            if (xMissed == pdTRUE && ulZone != ZONE_NONE &&
+                                eCanGetHealth() == CAN_HEALTH_OK &&
+                                xIsWeakColor(stZone[ulZone].stGameInfo.team, bColor) == pdFALSE)
+                            {
+                                vAdaptOnMiss(&stZone[ulZone].stAdapt);
+                            }
+                            portEXIT_CRITICAL(&xPanelTblMux);
                             break;
-                        case DFCLT_LUNATIC:
-                            // Lunaticはソフランなし
-                            // xDelay = configWAIT_LUNATIC * TIMER_SPEEDUP_COEFFICIENT;
+                        case SCHED_EV_SPEEDUP:
+                            // 残り時間がn秒になったらゲームスピードを早くする
+                            xSpeedUp = pdTRUE;
+                            for (i = 0; i < ulZoneNum; i++)
+                            {
+                                ESP_LOGI(TAG, "Speed up | zone:%u interval:%lldus", i,
+                                         (long long)llGetSpawnIntervalUs(&stZone[i], pdTRUE));
+                            }
                             break;
                         default:
                             break;
                         }
                     }
+                }
 
-                    // CAN送信
-                    if (xSendCanTxQueue(canMsg) != pdPASS)
-                    {
-                        ESP_LOGE(TAG, "Failed Send CanMsg panelNo:%d",
-                                 canMsg.ulCanId);
-                    }
-
-                    // Wait(難易度で変化する)
-                    vTaskDelay(xDelay);
+                // 周期のずれを表示
+                vCtrlSchedGetJitter(SCHED_EV_SPAWN, &tJitter);
+                ESP_LOGI(TAG, "Spawn jitter | count:%u mean:%lldus max:%lldus",
+                         tJitter.ulCount,
+                         (long long)(tJitter.ulCount ? tJitter.llSumUs / tJitter.ulCount : 0),
+                         (long long)tJitter.llMaxUs);
+                for (i = 0; i < ulZoneNum; i++)
+                {
+                    portENTER_CRITICAL(&xPanelTblMux);
+                    tAdapt = stZone[i].stAdapt;
+                    ulRelaxed = stZone[i].stSpawn.ulRelaxed;
+                    portEXIT_CRITICAL(&xPanelTblMux);
+                    ESP_LOGI(TAG, "Adapt | zone:%u spawn:%uus light:%ums rt:%dus dev:%dus "
+                                  "ratio:%u%% hit:%u wrong:%u miss:%u",
+                             i, ulAdaptSpawnUs(&tAdapt), usAdaptLightMs(&tAdapt),
+                             tAdapt.lRtAvgUs, tAdapt.lRtDevUs, ulAdaptHitPct(&tAdapt),
+                             tAdapt.ulHits, tAdapt.ulWrongs, tAdapt.ulMisses);
+                    ESP_LOGI(TAG, "Spawn | zone:%u seed:0x%08x relaxed:%u", i,
+                             stZone[i].ulSeed, ulRelaxed);
                 }
             }
         }
@@ -473,16 +745,57 @@ static void prvCtrlMainTxTask(void *pxParameters)
         // 終了シーケンス
         vGameFinishSequence();
 
+        // CAN送信の実績(カウントダウンから終了表示まで)
+        vCanGetTxStats(&tCanTo);
+        ESP_LOGI(TAG, "CAN tx | frames:%u fps:%u peak:%u load:%u.%u%% paced:%u backpressure:%u",
+                 tCanTo.ulFrames - tCanFrom.ulFrames, ulCanTxFps(&tCanFrom, &tCanTo),
+                 tCanTo.ulPeakFps, ulCanTxLoadPermil(&tCanFrom, &tCanTo) / 10,
+                 ulCanTxLoadPermil(&tCanFrom, &tCanTo) % 10,
+                 tCanTo.ulPaced - tCanFrom.ulPaced,
+                 tCanTo.ulBackpressure - tCanFrom.ulBackpressure);
+        vCanGetHealth(&tCanHealth);
+        ESP_LOGI(TAG, "CAN health | state:%d tec-peak:%u rec-peak:%u bus-off:%u recovered:%u "
+                      "dropped:%u down:%lldms",
+                 tCanHealth.eHealth, tCanHealth.ulTecPeak, tCanHealth.ulRecPeak,
+                 tCanHealth.ulBusOff, tCanHealth.ulRecovered, tCanHealth.ulTxDropped,
+                 (long long)(tCanHealth.llDownUs / 1000));
+        vCanGetRelStats(&tCanRel);
+        ESP_LOGI(TAG, "CAN reliable | sent:%u acked:%u retry:%u give-up:%u ack-tx:%u dup:%u",
+                 tCanRel.ulSent, tCanRel.ulAcked, tCanRel.ulRetry, tCanRel.ulGiveUp,
+                 tCanRel.ulAckTx, tCanRel.ulDup);
+        vCanGetRxStats(&tCanRx);
+        ESP_LOGI(TAG, "CAN rx | wakeups:%u frames:%u forwarded:%u batch-max:%u",
+                 tCanRx.ulWakeups, tCanRx.ulFrames, tCanRx.ulForwarded,
+                 tCanRx.ulBatchMax);
+
         // スコア格納待ち
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xEventGroupWaitBits(xCtrlEventGroup, EVENT_CTRL_SCORE_DONE, pdTRUE,
+                            pdTRUE, portMAX_DELAY);
+        vTraceFinishGame();
+        for (i = 0; i < ulZoneNum; i++)
+        {
+            vRecordResult(i);
+        }
+        vRecFinishGame();
 
-        // 結果をWebserverへ送信(踏んだパネル数、プレイヤー情報、残り時間※!=0でゲームオーバー)
-        xSendHttpPostQueue(stGameInfo);
+        // 結果をWebserverへ送信(区画毎: 踏んだパネル数、プレイヤー情報、残り時間※!=0でゲームオーバー)
+        for (i = 0; i < ulZoneNum; i++)
+        {
+            xSendHttpPostQueue(stZone[i].stGameInfo);
+        }
         xSendGamemngTxQueue(GMMSG_SCORE);
+        xSendGamemngTxQueue(GMMSG_TRACE);
+        xSendGamemngTxQueue(GMMSG_REC);
+        xSendGamemngTxQueue(GMMSG_DIAG);
+        xSendGamemngTxQueue(GMMSG_PANELS);
 
         // ゲーム中に来たゲームスタート通知を削除する
         xQueueReset(xPlayerInfoQueue);
 
+        // 死活テーブルを確かめ直す(v1のPanelは消灯色のデモ点灯に見えるので、
+        // スタートSWの通知とぶつからないゲーム終了後に送る)
+        xSendCanDiscover();
+
         // ゲーム終了後
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
@@ -504,40 +817,56 @@ static void prvCtrlMainRxTask(void *pxParameters)
     canCommMsg_t canMsg = {};
     dfpCtrlMsg_t dfpMsg;
     enum COLOR eColor;
-    BOOL_t xHp1SeFlg = pdFALSE;
-    BOOL_t xStatus;
+    BOOL_t xHp1SeFlg[configZONE_MAX] = {};
+    ePanelHit_t eHit;
+    panelHit_t tHit = {};
+    gameZone_t *pxZone;
+    struct GAME_INFO *pxInfo;
+    uint32_t ulZone;
+    uint32_t ulHitCnt = 0;
+    uint32_t ulRejectCnt = 0;
+    int64_t llReactionSumUs = 0;
+    uint32_t ulTimedCnt = 0;
+    int64_t llTimedLagSumUs = 0;
+    int iHpDelta;
+    uint8_t bRecData[2];
+    uint32_t i;
 
     for (;;)
     {
         // ゲームスタート待ち
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        ESP_LOGI(TAG, "(RxTask)Game Start");
+        xEventGroupWaitBits(xCtrlEventGroup, EVENT_CTRL_GAME_START, pdTRUE,
+                            pdTRUE, portMAX_DELAY);
+        ESP_LOGI(TAG, "(RxTask)Game Start | zones:%u", ulZoneNum);
 
         // スコアをリセット
-        stGameInfo.redPoint = 0;
-        stGameInfo.bluePoint = 0;
-        stGameInfo.greenPoint = 0;
-        stGameInfo.remainingTime = 0;
-        stGameInfo.hitPoint = gameconfINIT_HIT_POINT;
-
-        // フラグを0に
-        xHp1SeFlg = pdFALSE;
-
-        // hpdltb_t tHpdltb;
-
-        // tHpdltb.bHp = (uint8_t)stGameInfo.hitPoint;
-        // tHpdltb.bTimeH = (uint8_t)sulTimer;
-        // tHpdltb.bTimeL = 0;
-        // xSendHpdltbQueue(tHpdltb);
+        for (i = 0; i < ulZoneNum; i++)
+        {
+            pxInfo = &stZone[i].stGameInfo;
+            pxInfo->redPoint = 0;
+            pxInfo->bluePoint = 0;
+            pxInfo->greenPoint = 0;
+            pxInfo->remainingTime = 0;
+            pxInfo->hitPoint = gameconfINIT_HIT_POINT;
+
+            // フラグを0に
+            xHp1SeFlg[i] = pdFALSE;
+        }
+        ulHitCnt = 0;
+        ulRejectCnt = 0;
+        llReactionSumUs = 0;
+        ulTimedCnt = 0;
+        llTimedLagSumUs = 0;
 
         // ゲームスタート
-        while (xTimerFlag == pdTRUE)
+        while (xIsAnyZonePlaying() == pdTRUE)
         {
             // CAN受信待ち
-            if (xQueueReceive(xCtrlRxCanQueue, &canMsg,
-                              QUEUE_CTRL_RX_WAIT_NOWPLAYING) == pdTRUE)
+            if (xCtrlRxCanRing.xReceive(&canMsg,
+                                        QUEUE_CTRL_RX_WAIT_NOWPLAYING) == pdTRUE)
             {
                 ESP_LOGI(TAG, "Receive CAN Msg | Panel:%d", canMsg.bPanelId);
+                vTracePoint(TP_CTRL_RX, canMsg.bPanelId);
 
                 // 押されたときの音を再生
                 /* ダメージ音を付けたいので体力計算のときに鳴らす */
@@ -545,18 +874,79 @@ static void prvCtrlMainRxTask(void *pxParameters)
                 // dfpMsg.uiVolume = 10;
                 // xSendDfplayerQueue(dfpMsg);
 
-                // 色判別
-                eColor = eDetectPanelColor(&canMsg);
+                // 区画の振り分け(PanelIDで決まる)
+                ulZone = ulZoneOfPanel(pxZoneLayout, canMsg.bPanelId);
+                pxZone = (ulZone != ZONE_NONE) ? &stZone[ulZone] : NULL;
+
+                // 押下判定(遊んでいる区画で、Masterが点灯させたパネルか)
+                portENTER_CRITICAL(&xPanelTblMux);
+                if (pxZone == NULL || pxZone->xTimerFlag != pdTRUE)
+                {
+                    eHit = (canMsg.bPanelId < PANEL_1 || canMsg.bPanelId >= MAX_PANEL_NUM)
+                               ? PANEL_HIT_INVALID
+                               : PANEL_HIT_OFF_ZONE;
+                }
+                else
+                {
+                    // 時刻付きならパネルで押された時刻で判定する(CANの待ちを含まない)
+                    eHit = ePanelTblHit(&stPanelTbl, canMsg.bPanelId,
+                                        canMsg.bTimed ? canMsg.llPressUs
+                                                      : esp_timer_get_time(),
+                                        &tHit);
+                }
+                if (eHit == PANEL_HIT_OK)
+                {
+                    // 反応時間はパネルが測った点灯 -> 押下を使う
+                    if (canMsg.bTimed)
+                        tHit.llReactionUs = canMsg.ulReactionUs;
+                    vSpawnGenSetPlayer(&pxZone->stSpawn, canMsg.bPanelId);
+                    vAdaptOnHit(&pxZone->stAdapt, tHit.llReactionUs,
+                                xIsWeakColor(pxZone->stGameInfo.team, (uint8_t)tHit.eColor) == pdTRUE
+                                    ? pdFALSE
+                                    : pdTRUE);
+                }
+                else if (eHit == PANEL_HIT_LATE && eCanGetHealth() == CAN_HEALTH_OK &&
+                         xIsWeakColor(pxZone->stGameInfo.team, (uint8_t)tHit.eColor) == pdFALSE)
+                {
+                    // 期限切れは判定済みになり点灯終了では数えないので、ここで見逃しに数える
+                    vAdaptOnMiss(&pxZone->stAdapt);
+                }
+                portEXIT_CRITICAL(&xPanelTblMux);
+                if (eHit != PANEL_HIT_OK)
+                {
+                    ESP_LOGW(TAG, "(RxTask) Reject panel:%d reason:%d",
+                             canMsg.bPanelId, eHit);
+                    vRecEvent(REC_REJECT, canMsg.bPanelId, (uint16_t)eHit,
+                              NULL, 0);
+                    ulRejectCnt++;
+                    continue;
+                }
+                ulHitCnt++;
+                llReactionSumUs += tHit.llReactionUs;
+                if (canMsg.bTimed)
+                {
+                    ulTimedCnt++;
+                    llTimedLagSumUs += esp_timer_get_time() - canMsg.llPressUs;
+                }
+                pxInfo = &pxZone->stGameInfo;
+
+                // 色判別(点灯させた色を使う、時刻付きの押下は色を持たない)
+                eColor = tHit.eColor;
+                if (!canMsg.bTimed && eDetectPanelColor(&canMsg) != eColor)
+                {
+                    ESP_LOGW(TAG, "(RxTask) Color mismatch panel:%d",
+                             canMsg.bPanelId);
+                }
                 switch (eColor)
                 {
                 case RED:
-                    stGameInfo.redPoint++;
+                    pxInfo->redPoint++;
                     break;
                 case GREEN:
-                    stGameInfo.greenPoint++;
+                    pxInfo->greenPoint++;
                     break;
                 case BLUE:
-                    stGameInfo.bluePoint++;
+                    pxInfo->bluePoint++;
                     break;
                 default:
                     ESP_LOGI(TAG, "(RxTask) Failed Color undetected panel:%d",
@@ -565,92 +955,125 @@ static void prvCtrlMainRxTask(void *pxParameters)
                 }
 
                 // 体力計算
-                stGameInfo.hitPoint += iCalcHitPoint(
-                    stGameInfo.team, stGameInfo.difficuty, eColor);
+                iHpDelta = iCalcHitPoint(pxInfo->team, &pxZone->stDfclt, eColor);
+                pxInfo->hitPoint += iHpDelta;
 
                 /* 体力が5より多くなったら5に戻す */
-                if (stGameInfo.hitPoint > gameconfINIT_HIT_POINT)
+                if (pxInfo->hitPoint > gameconfINIT_HIT_POINT)
                 {
-                    stGameInfo.hitPoint = gameconfINIT_HIT_POINT;
+                    pxInfo->hitPoint = gameconfINIT_HIT_POINT;
                 }
-
-                // もし体力が0ならタイマフラグをpdFALSEへ
-                if (stGameInfo.hitPoint <= 0)
+                if (iHpDelta < 0)
+                {
+                    portENTER_CRITICAL(&xPanelTblMux);
+                    vAdaptOnDamage(&pxZone->stAdapt, pxInfo->hitPoint, gameconfINIT_HIT_POINT);
+                    portEXIT_CRITICAL(&xPanelTblMux);
+                }
+                bRecData[0] = (uint8_t)eColor;
+                bRecData[1] = (uint8_t)(int8_t)iHpDelta;
+                vRecEvent(REC_HP, canMsg.bPanelId,
+                          (uint16_t)(int16_t)pxInfo->hitPoint, bRecData,
+                          sizeof(bRecData));
+                vTracePoint(TP_SCORE, canMsg.bPanelId);
+
+                // もし体力が0ならその区画のタイマフラグをpdFALSEへ(残り時間はそこで止まる)
+                if (pxInfo->hitPoint <= 0)
                 {
-                    xTimerFlag = pdFALSE;
+                    pxZone->xTimerFlag = pdFALSE;
                 }
 
                 // もし体力が1なら音声を鳴らす
-                if (stGameInfo.hitPoint == 1 && xHp1SeFlg == pdFALSE)
+                if (pxInfo->hitPoint == 1 && xHp1SeFlg[ulZone] == pdFALSE)
                 {
                     dfpMsg.eSound = SE_PINCH;
-                    xSendDfplayerQueue(dfpMsg);
-                    xHp1SeFlg = pdTRUE;
+                    xSendDfplayerHitQueue(dfpMsg);
+                    xHp1SeFlg[ulZone] = pdTRUE;
                 }
-                else if (stGameInfo.hitPoint != 1 && xHp1SeFlg == pdTRUE)
+                else if (pxInfo->hitPoint != 1 && xHp1SeFlg[ulZone] == pdTRUE)
                 {
-                    xHp1SeFlg = pdFALSE;
+                    xHp1SeFlg[ulZone] = pdFALSE;
                 }
 
-                ESP_LOGI(TAG, "(RxTask) stGameInfo={point R%dG%dB%d, hp%d}",
-                         stGameInfo.redPoint, stGameInfo.greenPoint,
-                         stGameInfo.bluePoint, stGameInfo.hitPoint);
+                ESP_LOGI(TAG, "(RxTask) zone:%u stGameInfo={point R%dG%dB%d, hp%d}",
+                         ulZone, pxInfo->redPoint, pxInfo->greenPoint,
+                         pxInfo->bluePoint, pxInfo->hitPoint);
             }
         }
-        // 残り時間を格納
-        stGameInfo.remainingTime = sulTimer;
-        if (sulTimer < 0)
-            ESP_LOGE(TAG, "(RxTask) Failed Timer count is 0");
+        ESP_LOGI(TAG, "(RxTask) hit:%u reject:%u reaction mean:%lldus timed:%u press->rx mean:%lldus",
+                 ulHitCnt, ulRejectCnt,
+                 (long long)(ulHitCnt ? llReactionSumUs / ulHitCnt : 0), ulTimedCnt,
+                 (long long)(ulTimedCnt ? llTimedLagSumUs / ulTimedCnt : 0));
 
-        // CtrlTxTaskへスコア確定を通知
-        xStatus = xTaskNotifyGive(xCtrlTxTask);
-        if (xStatus != pdPASS)
+        // 残り時間を格納(区画が終わった時点でカウントは止まっている)
+        for (i = 0; i < ulZoneNum; i++)
         {
-            ESP_LOGE(TAG, "Failed xTaskNotifyGive(xCtrlTxTask)");
+            stZone[i].stGameInfo.remainingTime = stZone[i].iTimer;
+            if (stZone[i].iTimer < 0)
+                ESP_LOGE(TAG, "(RxTask) Failed Timer count is 0 zone:%u", i);
         }
+
+        // CtrlTxTaskへスコア確定を通知
+        xEventGroupSetBits(xCtrlEventGroup, EVENT_CTRL_SCORE_DONE);
     }
 }
 
 /*****************************************************************************/
 /**
  * ゲームのカウント毎に呼び出される関数です。
- * カウント変数から1ずつ減算します。
- * 0になったらカウントフラグをpdFALSEにします。
+ * 遊んでいる区画のカウント変数から1ずつ減算します。
+ * 0になったらその区画のカウントフラグをpdFALSEにします。
  *
  * @param	pvParametersはNULLです。
  *
  * @return  ##
  *
- * @note    ##
+ * @note    全区画が終わったらタイマを止める
  *
  ******************************************************************************/
 void prvGameTimerHandle(TimerHandle_t xTimer)
 {
     hpdltb_t tHpdltb;
-    sulTimer--;
-    ESP_LOGD(TAG, "Timer Count:%d", sulTimer);
-
-    // todo: 時間送信
-    tHpdltb.eMsg = HPDLTB_NORMAL;
-    tHpdltb.bHp = (uint8_t)stGameInfo.hitPoint;
-    tHpdltb.bTimeH = (uint8_t)(sulTimer / 10);
-    tHpdltb.bTimeL = (uint8_t)(sulTimer - ((int)(sulTimer / 10) * 10));
-    xSendHpdltbQueue(tHpdltb);
-
-    if (sulTimer == 0)
-    { // カウント０
-        ESP_LOGI(TAG, "Stop Timer (Time up)");
-        xTimerFlag = pdFALSE;
-        xTimerStop(xTimer, portMAX_DELAY);
-    }
-    else if (sulTimer > 0 && xTimerFlag == pdFALSE)
-    { // 体力切れ
-        ESP_LOGI(TAG, "Stop Timer (Game over)");
-        xTimerStop(xTimer, portMAX_DELAY);
+    gameZone_t *pxZone;
+    BOOL_t xPlaying = pdFALSE;
+
+    for (uint32_t i = 0; i < ulZoneNum; i++)
+    {
+        pxZone = &stZone[i];
+        if (pxZone->xTimerFlag != pdTRUE)
+        { // 体力切れ or カウント０(カウントを止める)
+            continue;
+        }
+        pxZone->iTimer--;
+        ESP_LOGD(TAG, "Timer Count:%d zone:%u", pxZone->iTimer, i);
+
+        // todo: 時間送信
+        tHpdltb.eMsg = HPDLTB_NORMAL;
+        tHpdltb.bLine = (uint8_t)i;
+        tHpdltb.bHp = (uint8_t)pxZone->stGameInfo.hitPoint;
+        tHpdltb.bTimeH = (uint8_t)(pxZone->iTimer / 10);
+        tHpdltb.bTimeL = (uint8_t)(pxZone->iTimer - ((int)(pxZone->iTimer / 10) * 10));
+        xSendHpdltbTickQueue(tHpdltb); // 待たない(タイマデーモンを止めない)
+        vRecEvent(REC_TICK, (uint8_t)i, (uint16_t)pxZone->iTimer, &tHpdltb.bHp, 1);
+
+        if (pxZone->iTimer == 0)
+        { // カウント０
+            ESP_LOGI(TAG, "Time up zone:%u", i);
+            pxZone->xTimerFlag = pdFALSE;
+        }
+        else if (pxZone->iTimer < 0)
+        {
+            ESP_LOGE(TAG, "Timer Count Error iTimer:%d zone:%u", pxZone->iTimer, i);
+        }
+        else
+        {
+            xPlaying = pdTRUE;
+        }
     }
-    else if (sulTimer < 0)
+
+    if (xPlaying == pdFALSE)
     {
-        ESP_LOGE(TAG, "Timer Count Error sulTimer:%d", sulTimer);
+        ESP_LOGI(TAG, "Stop Timer");
+        xTimerStop(xTimer, portMAX_DELAY);
     }
 }
 
@@ -658,79 +1081,206 @@ void prvGameTimerHandle(TimerHandle_t xTimer)
 /**
  * 起動時に一回すべてのパネルを点灯させます。
  *
- * @param	##
+ * @param	ulLightTimeMs: 点灯時間[ms]
  *
  * @return  ##
  *
- * @note    ##
+ * @note    全体宛て1フレームで一斉に点灯する
  *
  ******************************************************************************/
-void vLightOnAllPanel(uint32_t ulLightTime, TickType_t xInterval)
+void vLightOnAllPanel(uint32_t ulLightTimeMs)
 {
     canCommMsg_t canMsg = {};
 
-    for (int i = PANEL_1; i < MAX_PANEL_NUM; i++)
-    {
-        // canMsgへ情報を格納
-        canMsg.ulCanId = i;
-        canMsg.bPanelId = 0x00; //別になんでもよい
-        canMsg.bBtnFlag = 0;    // StartSwFlagとの切り分け
-        canMsg.bColorInfoR = MAX_BR;
-        canMsg.bColorInfoG = MAX_BR;
-        canMsg.bColorInfoB = MAX_BR;
-        canMsg.bLightTime = (byte)ulLightTime;
-        canMsg.bStartSwFlag = 0;
+    // canMsgへ情報を格納
+    canMsg.ulCanId = CAN_ID_GROUP_ALL;
+    canMsg.bPanelId = 0x00; //別になんでもよい
+    canMsg.bBtnFlag = 0;    // StartSwFlagとの切り分け
+    canMsg.bColorInfoR = MAX_BR;
+    canMsg.bColorInfoG = MAX_BR;
+    canMsg.bColorInfoB = MAX_BR;
+    canMsg.usLightTimeMs = (uint16_t)ulLightTimeMs;
+    canMsg.bStartSwFlag = 0;
+
+    xSendCanTxQueue(canMsg);
+}
+
+/*****************************************************************************/
+/**
+ * パネル集合へグループ宛てで送信します。
+ *
+ * @param	ulPanelMask: 送り先(bit = PanelID)
+ * @param   tCanMsg: 送信するメッセージ(ulCanIdは上書き)
+ *
+ * @return  ##
+ *
+ * @note    行×列の組毎に1フレーム(ctrl_group)
+ *
+ ******************************************************************************/
+void vSendGroupMsg(uint32_t ulPanelMask, canCommMsg_t tCanMsg)
+{
+    uint32_t ulCanId[GROUP_SPLIT_MAX];
+    uint32_t ulNum = ulGroupSplit(ulPanelMask, ulCanId, GROUP_SPLIT_MAX);
 
-        xSendCanTxQueue(canMsg);
-        vTaskDelay(xInterval);
+    for (uint32_t i = 0; i < ulNum; i++)
+    {
+        tCanMsg.ulCanId = ulCanId[i];
+        xSendCanTxQueue(tCanMsg);
     }
 }
 
 /*****************************************************************************/
 /**
- * GMからのプレイヤー情報受け取り後に、PANEL_13へスタート通知を送信します
- * その後、PANEL_13はスタートの動作を行うはず…です。
+ * GMからのプレイヤー情報受け取り後に、区画のスタートSWへスタート通知を送信します
+ * その後、スタートSWのパネルはスタートの動作を行うはず…です。
  *
- * @param	pvParametersはNULLです。
+ * @param	ulPanelId: スタートSWのパネル
+ * @param   eTeam: チーム(色)
  *
  * @return  ##
  *
- * @note    ##
+ * @note    配送確認付き(ACKが来なければdrv_canが送り直す)
  *
  ******************************************************************************/
-BOOL_t xSendStartNotifyToPanel(eTeamcl_t eTeam)
+BOOL_t xSendStartNotifyToPanel(uint32_t ulPanelId, eTeamcl_t eTeam)
 {
-    canCommMsg_t canMsg;
+    canCommMsg_t canMsg = {};
 
     // canMsgへ情報を格納
-    canMsg.ulCanId = gameconfSTART_SW_PANEL_NUM;
+    canMsg.ulCanId = ulPanelId;
     canMsg.bPanelId = 0x00; //別になんでもよい
     canMsg.bBtnFlag = 0;    // StartSwFlagとの切り分け
-    canMsg.bColorInfoR = HALF_BR;
-    canMsg.bColorInfoG = HALF_BR;
-    canMsg.bColorInfoB = HALF_BR;
-    canMsg.bLightTime = gameconfSTART_SW_LIGHT_TIME;
+    canMsg.usLightTimeMs = gameconfSTART_SW_LIGHT_TIME_MS;
     canMsg.bStartSwFlag = 1;
+    canMsg.bReliable = 1; // 届かないとゲームが始まらないのでACKを待つ
 
     // チーム色を格納する
+    vSetTeamColor(eTeam, &canMsg);
+
+    // 送信
+    return xSendCanTxQueue(canMsg);
+}
+
+/*****************************************************************************/
+/**
+ * チーム色
+ * チームの色をMAX_BR、それ以外をHALF_BRにします。
+ *
+ * @param	eTeam: チーム
+ * @param   pxMsg: 色を格納するメッセージ
+ *
+ * @return  ##
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+void vSetTeamColor(eTeamcl_t eTeam, canCommMsg_t *pxMsg)
+{
+    pxMsg->bColorInfoR = HALF_BR;
+    pxMsg->bColorInfoG = HALF_BR;
+    pxMsg->bColorInfoB = HALF_BR;
+
     switch (eTeam)
     {
     case TEAM_RED:
-        canMsg.bColorInfoR = MAX_BR;
+        pxMsg->bColorInfoR = MAX_BR;
         break;
     case TEAM_GREEN:
-        canMsg.bColorInfoG = MAX_BR;
+        pxMsg->bColorInfoG = MAX_BR;
         break;
     case TEAM_BLUE:
-        canMsg.bColorInfoB = MAX_BR;
+        pxMsg->bColorInfoB = MAX_BR;
         break;
 
     default:
         break;
     }
+}
 
-    // 送信
-    return xSendCanTxQueue(canMsg);
+/*****************************************************************************/
+/**
+ * アニメーションの指示
+ * 色(RGB)はそのまま、TBCAN_CMD_ANIMとして送る項目を格納します。
+ *
+ * @param	pxMsg: 格納するメッセージ(色は呼ぶ側が入れる)
+ * @param   bAnim: TBCAN_ANIM_*
+ * @param   usPeriodMs: 周期[ms]
+ * @param   usDurationMs: 続ける時間[ms](0: 次の指示まで)
+ * @param   llStartUs: 開始時刻[us](esp_timer, 0: Panelが受信したとき)
+ *
+ * @return  ##
+ *
+ * @note    送る前に宛先がTBCAN_FEAT_ANIMを持っているか確かめること(xCanPanelsHaveFeat)
+ *
+ ******************************************************************************/
+void vSetAnimMsg(canCommMsg_t *pxMsg, uint8_t bAnim, uint16_t usPeriodMs,
+                 uint16_t usDurationMs, int64_t llStartUs)
+{
+    pxMsg->bCmd = TBCAN_CMD_ANIM;
+    pxMsg->bAnim = bAnim;
+    pxMsg->usAnimPeriodMs = usPeriodMs;
+    pxMsg->usLightTimeMs = usDurationMs;
+    pxMsg->llAnimStartUs = llStartUs;
+    pxMsg->bBtnFlag = 0;
+    pxMsg->bStartSwFlag = 0;
+    pxMsg->bReliable = 0;
+}
+
+/*****************************************************************************/
+/**
+ * 待機中のデモのアニメーションを盤面全体へ送る
+ *
+ * @param	ulIdx: 何番目のデモか(csDemoAnimTblを順に回る)
+ *
+ * @return  ##
+ *
+ * @note    全Panelで開始時刻を揃える(SWEEP、CHASEが盤面で繋がる)。
+ *          Masterが止まっても残らないよう、続ける時間は切り替えの間隔より少し長くする
+ *
+ ******************************************************************************/
+void vSendDemoAnim(uint32_t ulIdx)
+{
+    const demoAnim_t *pxDemo = &csDemoAnimTbl[ulIdx % COUNTOF(csDemoAnimTbl)];
+    canCommMsg_t tCanMsg = {};
+
+    tCanMsg.bColorInfoR = pxDemo->bColorInfoR;
+    tCanMsg.bColorInfoG = pxDemo->bColorInfoG;
+    tCanMsg.bColorInfoB = pxDemo->bColorInfoB;
+    vSetAnimMsg(&tCanMsg, pxDemo->bAnim, pxDemo->usPeriodMs,
+                configANIM_DEMO_MS + configANIM_DEMO_MS / 4,
+                esp_timer_get_time() + (int64_t)configANIM_LEAD_MS * 1000);
+    vSendGroupMsg(ulGroupPanelMask(CAN_ID_GROUP_ALL), tCanMsg);
+}
+
+/*****************************************************************************/
+/**
+ * カウントダウンの残りをスタートSWのLEDの数で出す
+ *
+ * @param	ulPanelId: スタートSWのパネル
+ * @param   pxColor: チーム色(vSetTeamColor)
+ * @param   ulCount: 残りのカウント(点けるLEDの数)
+ *
+ * @return  ##
+ *
+ * @note    TBCAN_FEAT_PIXELのPanelのみ(1回TBCAN_PIXEL_SEG_NUMフレーム)。
+ *          次のカウントまで消えないように点灯時間は2カウント分
+ *
+ ******************************************************************************/
+void vSendCountRing(uint32_t ulPanelId, const canCommMsg_t *pxColor, uint32_t ulCount)
+{
+    canCommMsg_t tCanMsg = {};
+
+    tCanMsg.ulCanId = ulPanelId;
+    tCanMsg.bCmd = TBCAN_CMD_PIXEL;
+    tCanMsg.bFade = TBCAN_FADE_HOLD;
+    tCanMsg.usLightTimeMs = 2 * configANIM_COUNT_MS;
+    for (uint32_t i = 0; i < TBCAN_PIXEL_NUM && i < ulCount; i++)
+    {
+        tCanMsg.bPixel[i][0] = pxColor->bColorInfoR;
+        tCanMsg.bPixel[i][1] = pxColor->bColorInfoG;
+        tCanMsg.bPixel[i][2] = pxColor->bColorInfoB;
+    }
+    xSendCanTxQueue(tCanMsg);
 }
 
 /*****************************************************************************/
@@ -742,102 +1292,133 @@ BOOL_t xSendStartNotifyToPanel(eTeamcl_t eTeam)
  *
  * @return  ##
  *
- * @note    ##
+ * @note    区画毎に、スタートSWの周り(中枠)→残り(外枠)の順にチーム色で点灯
+ *          点灯／消灯はグループ宛て(区画毎に数フレーム)で一斉に行う。
+ *          区画のPanelが全てアニメーションを描けるときは、Seq.2で区画全体へ
+ *          チーム色のSWEEPを1回送り(開始時刻を揃える)、Seq.3は送らない。
+ *          スタートSWのPanelがLED毎の色を出せるときは、残りのカウントをLEDの数で出す
  *
  ******************************************************************************/
-void vGameStartSequence(eTeamcl_t eTeam)
+void vGameStartSequence()
 {
     hpdltb_t tHpdltb = {};
     dfpCtrlMsg_t tDfpMsg = {};
     canCommMsg_t tCanMsg{};
-    byte bColorR = HALF_BR;
-    byte bColorG = HALF_BR;
-    byte bColorB = HALF_BR;
-    const uint32_t culCDPanel1[8] = {PANEL_7, PANEL_8, PANEL_9, PANEL_12, PANEL_14, PANEL_17, PANEL_18, PANEL_19};
-    const uint32_t culCDPanel2[15] = {PANEL_1, PANEL_2, PANEL_3, PANEL_4, PANEL_5, PANEL_6,
-                                      PANEL_10, PANEL_11, PANEL_16, PANEL_20,
-                                      PANEL_21, PANEL_22, PANEL_23, PANEL_24, PANEL_25};
+    canCommMsg_t tTeamMsg[configZONE_MAX] = {};
+    uint32_t ulRing1[configZONE_MAX]; // 中枠: スタートSWの周り
+    uint32_t ulAnimMask[configZONE_MAX]; // アニメーションを送る区画(0: 従来の点灯)
+    BOOL_t xRing[configZONE_MAX];        // スタートSWでカウントを出す
+    int64_t llStartUs;
+    uint32_t ulZone;
+    uint32_t i;
     tDfpMsg.uiVolume = DFPLAYER_DEFAULT_VOLUME;
     tHpdltb.eMsg = HPDLTB_COUNT;
 
-    // チーム色を格納
-    switch (eTeam)
+    // 区画毎にチーム色と中枠を格納
+    for (i = 0; i < ulZoneNum; i++)
     {
-    case TEAM_RED:
-        bColorR = MAX_BR;
-        break;
-    case TEAM_GREEN:
-        bColorG = MAX_BR;
-        break;
-    case TEAM_BLUE:
-        bColorB = MAX_BR;
-        break;
-    default:
-        break;
+        vSetTeamColor(stZone[i].stGameInfo.team, &tTeamMsg[i]);
+        ulRing1[i] = ulSpawnNearMask(pxZoneLayout->bStartSw[i], 1) &
+                     pxZoneLayout->ulMask[i] & ~(1UL << pxZoneLayout->bStartSw[i]);
+        ulAnimMask[i] = pxZoneLayout->ulMask[i] & ~(1UL << pxZoneLayout->bStartSw[i]);
+        if (!xCanPanelsHaveFeat(ulAnimMask[i], TBCAN_FEAT_ANIM))
+            ulAnimMask[i] = 0;
+        xRing[i] = xCanPanelsHaveFeat(1UL << pxZoneLayout->bStartSw[i], TBCAN_FEAT_PIXEL);
     }
 
     // Seq.1 SE:Countdown1
     tDfpMsg.eSound = SE_COUNTDOWN_1;
     xSendDfplayerQueue(tDfpMsg);
     tHpdltb.bTimeL = 0x03; // 3表示
-    xSendHpdltbQueue(tHpdltb);
+    for (i = 0; i < ulZoneNum; i++)
+    {
+        tHpdltb.bLine = (uint8_t)i;
+        xSendHpdltbQueue(tHpdltb);
+        if (xRing[i])
+            vSendCountRing(pxZoneLayout->bStartSw[i], &tTeamMsg[i], tHpdltb.bTimeL);
+    }
     vTaskDelay(pdMS_TO_TICKS(1000));
 
     // Seq.2 パネル中枠点灯, SE:Countdown1
     tDfpMsg.eSound = SE_COUNTDOWN_1;
     xSendDfplayerQueue(tDfpMsg);
     tHpdltb.bTimeL = 0x02; // 2表示
-    xSendHpdltbQueue(tHpdltb);
-    for (int i = 0; i < 8; i++)
+    for (i = 0; i < ulZoneNum; i++)
+    {
+        tHpdltb.bLine = (uint8_t)i;
+        xSendHpdltbQueue(tHpdltb);
+        if (xRing[i])
+            vSendCountRing(pxZoneLayout->bStartSw[i], &tTeamMsg[i], tHpdltb.bTimeL);
+    }
+    llStartUs = esp_timer_get_time() + (int64_t)configANIM_LEAD_MS * 1000;
+    for (ulZone = 0; ulZone < ulZoneNum; ulZone++)
     {
+        if (ulAnimMask[ulZone] != 0)
+        {
+            // 残り2カウント、1カウントで1回流れる
+            canCommMsg_t tAnimMsg = tTeamMsg[ulZone];
+            vSetAnimMsg(&tAnimMsg, TBCAN_ANIM_SWEEP, configANIM_COUNT_MS,
+                        2 * configANIM_COUNT_MS, llStartUs);
+            vSendGroupMsg(ulAnimMask[ulZone], tAnimMsg);
+            continue;
+        }
         tCanMsg.bBtnFlag = 0;
-        tCanMsg.bColorInfoR = bColorR;
-        tCanMsg.bColorInfoG = bColorG;
-        tCanMsg.bColorInfoB = bColorB;
-        tCanMsg.bLightTime = 4;
+        tCanMsg.bColorInfoR = tTeamMsg[ulZone].bColorInfoR;
+        tCanMsg.bColorInfoG = tTeamMsg[ulZone].bColorInfoG;
+        tCanMsg.bColorInfoB = tTeamMsg[ulZone].bColorInfoB;
+        tCanMsg.usLightTimeMs = 4000;
         tCanMsg.bPanelId = 0;
         tCanMsg.bStartSwFlag = 0;
-        tCanMsg.ulCanId = culCDPanel1[i];
-        xSendCanTxQueue(tCanMsg);
+        vSendGroupMsg(ulRing1[ulZone], tCanMsg);
     }
     vTaskDelay(pdMS_TO_TICKS(1000));
 
-    // Seq.3 パネル中枠点灯, SE:Countdown1
+    // Seq.3 パネル外枠点灯, SE:Countdown1
     tDfpMsg.eSound = SE_COUNTDOWN_1;
     xSendDfplayerQueue(tDfpMsg);
     tHpdltb.bTimeL = 0x01; // 1表示
-    xSendHpdltbQueue(tHpdltb);
-    for (int i = 0; i < 15; i++)
+    for (i = 0; i < ulZoneNum; i++)
+    {
+        tHpdltb.bLine = (uint8_t)i;
+        xSendHpdltbQueue(tHpdltb);
+        if (xRing[i])
+            vSendCountRing(pxZoneLayout->bStartSw[i], &tTeamMsg[i], tHpdltb.bTimeL);
+    }
+    for (ulZone = 0; ulZone < ulZoneNum; ulZone++)
     {
+        if (ulAnimMask[ulZone] != 0)
+            continue; // Seq.2のアニメーションが続いている
         tCanMsg.bBtnFlag = 0;
-        tCanMsg.bColorInfoR = bColorR;
-        tCanMsg.bColorInfoG = bColorG;
-        tCanMsg.bColorInfoB = bColorB;
-        tCanMsg.bLightTime = 3;
+        tCanMsg.bColorInfoR = tTeamMsg[ulZone].bColorInfoR;
+        tCanMsg.bColorInfoG = tTeamMsg[ulZone].bColorInfoG;
+        tCanMsg.bColorInfoB = tTeamMsg[ulZone].bColorInfoB;
+        tCanMsg.usLightTimeMs = 3000;
         tCanMsg.bPanelId = 0;
         tCanMsg.bStartSwFlag = 0;
-        tCanMsg.ulCanId = culCDPanel2[i];
-        xSendCanTxQueue(tCanMsg);
+        vSendGroupMsg(pxZoneLayout->ulMask[ulZone] & ~ulRing1[ulZone] &
+                          ~(1UL << pxZoneLayout->bStartSw[ulZone]),
+                      tCanMsg);
     }
     vTaskDelay(pdMS_TO_TICKS(1000));
 
-    // Seq.4 パネル中枠点灯, SE:Countdown2
+    // Seq.4 パネル消灯, SE:Countdown2
     tDfpMsg.eSound = SE_COUNTDOWN_2;
     xSendDfplayerQueue(tDfpMsg);
     tHpdltb.bTimeL = 0xFF; // GO表示
-    xSendHpdltbQueue(tHpdltb);
-    for (int i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    for (i = 0; i < ulZoneNum; i++)
     {
-        tCanMsg.bBtnFlag = 0;
-        tCanMsg.bColorInfoR = 0;
-        tCanMsg.bColorInfoG = 0;
-        tCanMsg.bColorInfoB = 0;
-        tCanMsg.bLightTime = 0;
-        tCanMsg.bPanelId = 0;
-        tCanMsg.bStartSwFlag = 0;
-        tCanMsg.ulCanId = i;
-        xSendCanTxQueue(tCanMsg);
+        tHpdltb.bLine = (uint8_t)i;
+        xSendHpdltbQueue(tHpdltb);
     }
+    tCanMsg.bBtnFlag = 0;
+    tCanMsg.bColorInfoR = 0;
+    tCanMsg.bColorInfoG = 0;
+    tCanMsg.bColorInfoB = 0;
+    tCanMsg.usLightTimeMs = 0;
+    tCanMsg.bPanelId = 0;
+    tCanMsg.bStartSwFlag = 0;
+    tCanMsg.ulCanId = CAN_ID_GROUP_ALL;
+    xSendCanTxQueue(tCanMsg);
     vTaskDelay(pdMS_TO_TICKS(2000));
 }
 
@@ -863,23 +1444,229 @@ void vGameFinishSequence()
     // Seq.1 SE:Finish
     tDfpMsg.eSound = SE_FINISH;
     xSendDfplayerQueue(tDfpMsg);
-    xSendHpdltbQueue(tHpdltb);
+    for (uint32_t i = 0; i < ulZoneNum; i++)
+    {
+        tHpdltb.bLine = (uint8_t)i;
+        xSendHpdltbQueue(tHpdltb);
+    }
 
     vTaskDelay(pdMS_TO_TICKS(2000));
 
-    for (int i = 0; i < MAX_PANEL_NUM; i++)
+    // 全体宛て1フレームで一斉に点灯
+    tCanMsg.bBtnFlag = 0;
+    tCanMsg.bColorInfoR = MAX_BR;
+    tCanMsg.bColorInfoG = MAX_BR;
+    tCanMsg.bColorInfoB = MAX_BR;
+    tCanMsg.usLightTimeMs = 2000;
+    tCanMsg.bPanelId = 0;
+    tCanMsg.bStartSwFlag = 0;
+    tCanMsg.ulCanId = CAN_ID_GROUP_ALL;
+    xSendCanTxQueue(tCanMsg);
+}
+
+/*****************************************************************************/
+/**
+ * パネル生成周期
+ *
+ * @param	gameZone_t *pxZone: 区画
+ * @param   BOOL_t xSpeedUp: スピードアップ中
+ *
+ * @return  int64_t 周期[us]
+ *
+ * @note    適応難易度の現在値にスピードアップ率を掛ける。
+ *          スピードアップ率100%(Lunatic)はソフランなし
+ *
+ ******************************************************************************/
+int64_t llGetSpawnIntervalUs(gameZone_t *pxZone, BOOL_t xSpeedUp)
+{
+    int64_t llIntervalUs;
+
+    portENTER_CRITICAL(&xPanelTblMux);
+    llIntervalUs = ulAdaptSpawnUs(&pxZone->stAdapt);
+    portEXIT_CRITICAL(&xPanelTblMux);
+
+    if (xSpeedUp == pdTRUE)
     {
-        tCanMsg.bBtnFlag = 0;
-        tCanMsg.bColorInfoR = MAX_BR;
-        tCanMsg.bColorInfoG = MAX_BR;
-        tCanMsg.bColorInfoB = MAX_BR;
-        tCanMsg.bLightTime = 2;
-        tCanMsg.bPanelId = 0;
-        tCanMsg.bStartSwFlag = 0;
-        tCanMsg.ulCanId = i;
-        xSendCanTxQueue(tCanMsg);
-        vTaskDelay(pdMS_TO_TICKS(10));
+        llIntervalUs = llIntervalUs * pxZone->stDfclt.bSpeedUpPct / 100;
     }
+    return llIntervalUs;
+}
+
+/*****************************************************************************/
+/**
+ * 避けるべき色(弱点色)か
+ *
+ * @param	eTeam: チーム
+ * @param   bColor: パネル状態テーブルの色(enum COLOR)
+ *
+ * @return  pdTRUE / pdFALSE
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+BOOL_t xIsWeakColor(eTeamcl_t eTeam, uint8_t bColor)
+{
+    if (eTeam < TEAM_RED || eTeam >= MAX_TEAM)
+        return pdFALSE;
+    return (bColor == csWeakTbl[eTeam].weak) ? pdTRUE : pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 遊んでいる区画があるか
+ *
+ * @param	##
+ *
+ * @return  pdTRUE / pdFALSE
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+BOOL_t xIsAnyZonePlaying()
+{
+    for (uint32_t i = 0; i < ulZoneNum; i++)
+    {
+        if (stZone[i].xTimerFlag == pdTRUE)
+            return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 同じ回のエントリーを集める
+ * 最初のエントリーからgameconfENTRY_GATHER_MSの間に届いたエントリーを
+ * 区画数(configZONE_MAX)まで受け付けます。
+ *
+ * @param	pxEntry: [0]に最初のエントリー、[1..]に集めたエントリーを格納
+ *
+ * @return  uint32_t エントリー数(区画数)
+ *
+ * @note    エントリーの数によらずgameconfENTRY_GATHER_MS待つ(デモ点灯の後の待ち)
+ *          startFlgがpdFALSEのエントリーは数えない
+ *
+ ******************************************************************************/
+uint32_t ulGatherEntries(playerInfo_t *pxEntry)
+{
+    uint32_t ulNum = 1;
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xElapsed;
+
+    while ((xElapsed = xTaskGetTickCount() - xStart) < pdMS_TO_TICKS(gameconfENTRY_GATHER_MS))
+    {
+        if (ulNum >= configZONE_MAX)
+        {
+            vTaskDelay(pdMS_TO_TICKS(gameconfENTRY_GATHER_MS) - xElapsed);
+            break;
+        }
+        if (xQueueReceive(xPlayerInfoQueue, &pxEntry[ulNum],
+                          pdMS_TO_TICKS(gameconfENTRY_GATHER_MS) - xElapsed) == pdPASS &&
+            pxEntry[ulNum].startFlg == pdTRUE)
+        {
+            ulNum++;
+        }
+    }
+    return ulNum;
+}
+
+/*****************************************************************************/
+/**
+ * パネル生成
+ * 区画内の点灯中でないパネルを盤面の制約(ctrl_spawn)で選んでパネル状態テーブルに登録し、
+ * 点灯させて点灯終了をスケジュールします。
+ *
+ * @param	ulZone: 区画
+ *
+ * @return  pdPASS / pdFAIL(空きなし、送信失敗)
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+BOOL_t xSpawnPanel(uint32_t ulZone)
+{
+    gameZone_t *pxZone = &stZone[ulZone];
+    canCommMsg_t canMsg = {};
+    enum COLOR eColor;
+    spawnRule_t tRule = {};
+    uint32_t ulPanelId;
+    uint8_t bGen;
+    int64_t llNowUs;
+    int64_t llDeadlineUs;
+    int64_t llExpireUs;
+    uint16_t usLightMs;
+
+    tRule.bMinDist = gameconfSPAWN_MIN_DIST;
+    tRule.xAntiCluster = gameconfSPAWN_ANTI_CLUSTER;
+    // 途絶えた／踏まれたままのパネルは出さない
+    tRule.ulZoneMask = pxZoneLayout->ulMask[ulZone] & ~ulCanPanelExcludeMask();
+
+    // パネルと色の選択(区画内、プレイヤー位置から点灯時間内に届く範囲)
+    portENTER_CRITICAL(&xPanelTblMux);
+    usLightMs = usAdaptLightMs(&pxZone->stAdapt);
+    tRule.bMaxDist = (uint8_t)ulSpawnReachDist(usLightMs, pxZone->stAdapt.lRtAvgUs,
+                                               gameconfSPAWN_STEP_MS);
+    ulPanelId = ulSpawnGenPick(&pxZone->stSpawn, ulPanelTblLitMask(&stPanelTbl), &tRule);
+    eColor = (enum COLOR)(RED + ulSpawnGenRand(&pxZone->stSpawn, BLUE - RED + 1));
+    portEXIT_CRITICAL(&xPanelTblMux);
+    if (ulPanelId == 0)
+    {
+        ESP_LOGW(TAG, "No free panel zone:%u", ulZone);
+        return pdFAIL;
+    }
+    canMsg.ulCanId = ulPanelId;
+
+    switch (eColor)
+    {
+    case RED:
+        canMsg.bColorInfoR = MAX_BR;
+        break;
+    case GREEN:
+        canMsg.bColorInfoG = MAX_BR;
+        break;
+    case BLUE:
+        canMsg.bColorInfoB = MAX_BR;
+        break;
+    default:
+        break;
+    }
+
+    // 押下許可フラグ
+    canMsg.bBtnFlag = 1;
+
+    // LED点灯時間(適応難易度の現在値)
+    canMsg.usLightTimeMs = usLightMs;
+
+    // 送信前に登録する(押下の返信が先に届いても判定できるように)
+    llNowUs = esp_timer_get_time();
+    llDeadlineUs = llNowUs + (int64_t)(usLightMs + gameconfEXPIRE_MARGIN_MS) * 1000;
+    portENTER_CRITICAL(&xPanelTblMux);
+    bGen = bPanelTblSpawn(&stPanelTbl, ulPanelId, eColor, llNowUs, llDeadlineUs);
+    llExpireUs = llPanelTblExpireUs(&stPanelTbl, ulPanelId);
+    portEXIT_CRITICAL(&xPanelTblMux);
+    vTracePoint(TP_SPAWN, ulPanelId);
+
+    // 点灯終了(期限を過ぎた押下をLATEと判定できるよう、猶予の後に消灯扱いにする)
+    // 押されて猶予中に再点灯したパネルは前の点灯終了が残っているので取り消す(パネル毎に1つ)
+    ulCtrlSchedCancel(SCHED_EV_EXPIRE, ulPanelId, 0xFF);
+    if (xCtrlSchedAdd(llExpireUs, SCHED_EV_EXPIRE, ulPanelId | ((uint32_t)bGen << 8)) != pdPASS)
+    {
+        portENTER_CRITICAL(&xPanelTblMux);
+        xPanelTblExpire(&stPanelTbl, ulPanelId, bGen);
+        portEXIT_CRITICAL(&xPanelTblMux);
+        return pdFAIL;
+    }
+
+    // CAN送信(失敗したら消灯扱い、残った点灯終了は何もしない)
+    if (xSendCanTxQueue(canMsg) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed Send CanMsg panelNo:%d", canMsg.ulCanId);
+        portENTER_CRITICAL(&xPanelTblMux);
+        xPanelTblExpire(&stPanelTbl, ulPanelId, bGen);
+        portEXIT_CRITICAL(&xPanelTblMux);
+        return pdFAIL;
+    }
+
+    return pdPASS;
 }
 
 /*****************************************************************************/
@@ -921,16 +1708,17 @@ enum COLOR eDetectPanelColor(canCommMsg_t *canMsg)
  * 体力計算
  * 踏んだ色＋チーム色＋難易度から、体力の増減を返します。
  *
- * @param	enum COLOR eColor
- * @param   eTeamcl_t eTeam
- * @param   eDfclt_t eDfclt
+ * @param	eTeamcl_t eTeam
+ * @param   const dfcltProfile_t *pxDfclt: 難易度プロファイル
+ * @param   enum COLOR eColor
  *
  * @return  int     戻り値を現在の体力に足せばいいと思います。
  *
  * @note    ##
  *
  ******************************************************************************/
-int iCalcHitPoint(eTeamcl_t eTeam, eDfclt_t eDfclt, enum COLOR eColor)
+int iCalcHitPoint(eTeamcl_t eTeam, const dfcltProfile_t *pxDfclt,
+                  enum COLOR eColor)
 {
     dfpCtrlMsg_t dfpMsg = {};
     // // 所属チームの弱点をコピー
@@ -953,20 +1741,68 @@ int iCalcHitPoint(eTeamcl_t eTeam, eDfclt_t eDfclt, enum COLOR eColor)
     if (eColor == csWeakTbl[eTeam].strong)
     {
         dfpMsg.eSound = SE_PANEL;
-        xSendDfplayerQueue(dfpMsg);
-        return csHpTbl[eDfclt].strong;
+        xSendDfplayerHitQueue(dfpMsg);
+        return pxDfclt->cHpStrong;
     }
     else if (eColor == csWeakTbl[eTeam].same)
     {
         dfpMsg.eSound = SE_PANEL;
-        xSendDfplayerQueue(dfpMsg);
-        return csHpTbl[eDfclt].same;
+        xSendDfplayerHitQueue(dfpMsg);
+        return pxDfclt->cHpSame;
     }
     else if (eColor == csWeakTbl[eTeam].weak)
     {
         dfpMsg.eSound = SE_DAMAGE;
-        xSendDfplayerQueue(dfpMsg);
-        return csHpTbl[eDfclt].weak;
+        xSendDfplayerHitQueue(dfpMsg);
+        return pxDfclt->cHpWeak;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+/*****************************************************************************/
+/**
+ * 乱数(記録付き)
+ * ゲームの進行を決める乱数はこれを使い、再生時に同じ値を返せるようにする。
+ *
+ * @param	lMin: 下限
+ * @param   lMax: 上限(含まない)
+ *
+ * @return  long 乱数
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+long lRandomRec(long lMin, long lMax)
+{
+    long lValue = random(lMin, lMax);
+    int32_t lData[2];
+
+    lData[0] = (int32_t)lValue;
+    lData[1] = (int32_t)(((uint32_t)(uint16_t)lMax << 16) | (uint16_t)lMin);
+    vRecEvent(REC_RAND, 0, 0, lData, sizeof(lData));
+    return lValue;
+}
+
+/*****************************************************************************/
+/**
+ * 結果の記録(再生時の照合用)
+ *
+ * @param	ulZone: 区画
+ *
+ * @return  ##
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+void vRecordResult(uint32_t ulZone)
+{
+    const struct GAME_INFO *pxInfo = &stZone[ulZone].stGameInfo;
+    int16_t sResult[4];
+
+    sResult[0] = (int16_t)pxInfo->redPoint;
+    sResult[1] = (int16_t)pxInfo->greenPoint;
+    sResult[2] = (int16_t)pxInfo->bluePoint;
+    sResult[3] = (int16_t)pxInfo->hitPoint;
+    vRecEvent(REC_RESULT, (uint8_t)ulZone, (uint16_t)pxInfo->remainingTime, sResult,
+              sizeof(sResult));
+}
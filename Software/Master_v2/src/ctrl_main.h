@@ -38,7 +38,8 @@ extern "C" {
 ******************************************************************************/
 esp_err_t lInitCtrlMainFunction();
 BOOL_t xSendPlayerInfoQueue(playerInfo_t playerInfo);
-BOOL_t xSendCtrlCanRxQueue(canCommMsg_t canRxMsg);
+BOOL_t xSendPlayerInfoSet(const playerInfo_t *pxInfo, uint32_t ulNum);
+uint32_t ulSendCtrlCanRxBatch(const canCommMsg_t *pxCanRxMsg, uint32_t ulNum);
 
 #ifdef __cplusplus
 }
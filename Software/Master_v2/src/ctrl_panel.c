@@ -0,0 +1,178 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_panel.c
+ * @comments パネル状態テーブル(Masterが点灯させた色／時刻／世代)
+ *           パネルから返ってくる色は使わず、このテーブルで押下を判定する。
+ *           時刻は引数で受け取り、RTOSに依存しない(排他は呼び出し側で行う)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <string.h>
+
+#include "ctrl_panel.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define PANEL_ID_VALID(id) ((id) >= PANEL_1 && (id) < MAX_PANEL_NUM)
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * テーブル初期化(全パネル消灯)
+ *
+ * @param    pxTbl: パネル状態テーブル
+ *
+ * @return   ##
+ *
+ * @note     世代は残す(前ゲームの遅れた押下を弾くため)
+ *
+ ******************************************************************************/
+void vPanelTblClear(panelTbl_t *pxTbl)
+{
+    memset(pxTbl->bColor, NOLIGHT, sizeof(pxTbl->bColor));
+    memset(pxTbl->llSpawnUs, 0x00, sizeof(pxTbl->llSpawnUs));
+    memset(pxTbl->llDeadlineUs, 0x00, sizeof(pxTbl->llDeadlineUs));
+}
+
+/*****************************************************************************/
+/**
+ * 点灯登録
+ *
+ * @param    pxTbl: パネル状態テーブル
+ * @param    ulPanelId: PANEL_NO
+ * @param    eColor: 点灯色
+ * @param    llNowUs: 点灯要求時刻[us]
+ * @param    llDeadlineUs: 押下受付の期限[us]
+ *
+ * @return   uint8_t 世代(点灯終了時にxPanelTblExpireへ渡す)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint8_t bPanelTblSpawn(panelTbl_t *pxTbl, uint32_t ulPanelId, enum COLOR eColor,
+                       int64_t llNowUs, int64_t llDeadlineUs)
+{
+    if (!PANEL_ID_VALID(ulPanelId))
+        return 0;
+
+    pxTbl->bGen[ulPanelId]++;
+    pxTbl->bColor[ulPanelId] = (uint8_t)eColor;
+    pxTbl->llSpawnUs[ulPanelId] = llNowUs;
+    pxTbl->llDeadlineUs[ulPanelId] = llDeadlineUs;
+    return pxTbl->bGen[ulPanelId];
+}
+
+/*****************************************************************************/
+/**
+ * 点灯終了の時刻
+ *
+ * @param    pxTbl: パネル状態テーブル
+ * @param    ulPanelId: PANEL_NO
+ *
+ * @return   int64_t 押下受付の期限＋PANEL_LATE_GRACE_US[us] / 0: 範囲外のPanelID
+ *
+ * @note     この時刻にxPanelTblExpireを呼ぶ(期限を過ぎた押下をLATEと判定できるように)
+ *
+ ******************************************************************************/
+int64_t llPanelTblExpireUs(const panelTbl_t *pxTbl, uint32_t ulPanelId)
+{
+    if (!PANEL_ID_VALID(ulPanelId))
+        return 0;
+    return pxTbl->llDeadlineUs[ulPanelId] + PANEL_LATE_GRACE_US;
+}
+
+/*****************************************************************************/
+/**
+ * 点灯終了
+ * 同じ世代の点灯が残っていれば消灯扱いにします。
+ *
+ * @param    pxTbl: パネル状態テーブル
+ * @param    ulPanelId: PANEL_NO
+ * @param    bGen: bPanelTblSpawnの戻り値
+ *
+ * @return   pdTRUE:消灯した(押されずに時間切れ) / pdFALSE
+ *
+ * @note     押下済み、または再点灯済みなら何もしない
+ *
+ ******************************************************************************/
+BOOL_t xPanelTblExpire(panelTbl_t *pxTbl, uint32_t ulPanelId, uint8_t bGen)
+{
+    if (!PANEL_ID_VALID(ulPanelId) || pxTbl->bGen[ulPanelId] != bGen ||
+        pxTbl->bColor[ulPanelId] == NOLIGHT)
+        return pdFALSE;
+
+    pxTbl->bColor[ulPanelId] = NOLIGHT;
+    return pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * 押下判定
+ * 点灯中かつ期限内の押下のみ受け付け、判定済みにします。
+ *
+ * @param    pxTbl: パネル状態テーブル
+ * @param    ulPanelId: 押されたPANEL_NO
+ * @param    llNowUs: 押下時刻[us](時刻付きの押下はパネルで押された時刻、他は受信時刻)
+ * @param    pxHit: 判定結果の格納先(PANEL_HIT_OK/PANEL_HIT_LATEのとき有効)
+ *
+ * @return   ePanelHit_t
+ *
+ * @note     期限切れも判定済みにする(同じ点灯への押下は1回のみ)。
+ *           期限切れはllPanelTblExpireUsの時刻までに届いたものだけLATEになり、
+ *           それより後はxPanelTblExpireで消灯済みなのでNOT_LIT
+ *
+ ******************************************************************************/
+ePanelHit_t ePanelTblHit(panelTbl_t *pxTbl, uint32_t ulPanelId, int64_t llNowUs,
+                         panelHit_t *pxHit)
+{
+    if (!PANEL_ID_VALID(ulPanelId))
+        return PANEL_HIT_INVALID;
+    if (pxTbl->bColor[ulPanelId] == NOLIGHT)
+        return PANEL_HIT_NOT_LIT;
+
+    pxHit->eColor = (enum COLOR)pxTbl->bColor[ulPanelId];
+    pxHit->bGen = pxTbl->bGen[ulPanelId];
+    pxHit->llReactionUs = llNowUs - pxTbl->llSpawnUs[ulPanelId];
+    pxTbl->bColor[ulPanelId] = NOLIGHT;
+
+    return (llNowUs > pxTbl->llDeadlineUs[ulPanelId]) ? PANEL_HIT_LATE
+                                                      : PANEL_HIT_OK;
+}
+
+/*****************************************************************************/
+/**
+ * 点灯中パネルのビットマスク
+ *
+ * @param    pxTbl: パネル状態テーブル
+ *
+ * @return   uint32_t bit = PANEL_NO
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulPanelTblLitMask(const panelTbl_t *pxTbl)
+{
+    uint32_t ulMask = 0;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if (pxTbl->bColor[i] != NOLIGHT)
+            ulMask |= (1UL << i);
+    }
+    return ulMask;
+}
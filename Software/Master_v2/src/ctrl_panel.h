@@ -0,0 +1,88 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_panel.h
+ * @comments パネル状態テーブル(Masterが点灯させた色／時刻／世代)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_PANEL_H
+#define SRC_CTRL_PANEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * 期限切れの押下を受け付ける猶予[us]
+ * 点灯終了(xPanelTblExpire)は期限＋猶予に行い、その間の押下はPANEL_HIT_LATEにする
+ */
+#define PANEL_LATE_GRACE_US 300000
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * パネル状態テーブル
+ * PANEL_NOで引くSoA形式。[0]は空とし、enumの値と対応させる。
+ */
+typedef struct PANEL_TBL
+{
+    uint8_t bColor[MAX_PANEL_NUM];       // 点灯色(enum COLOR), NOLIGHT:消灯/判定済み
+    uint8_t bGen[MAX_PANEL_NUM];         // 世代(点灯毎に加算)
+    int64_t llSpawnUs[MAX_PANEL_NUM];    // 点灯要求時刻[us]
+    int64_t llDeadlineUs[MAX_PANEL_NUM]; // 押下受付の期限[us]
+} panelTbl_t;
+
+/* 押下判定結果 */
+typedef enum PANEL_HIT
+{
+    PANEL_HIT_OK = 0,
+    PANEL_HIT_INVALID,  // 範囲外のPanelID
+    PANEL_HIT_NOT_LIT,  // 点灯していない(判定済み／重複)
+    PANEL_HIT_LATE,     // 期限切れ
+    PANEL_HIT_OFF_ZONE, // 区画外／区画のゲームが終わっている(ctrl_mainが判定)
+    MAX_PANEL_HIT
+} ePanelHit_t;
+
+typedef struct PANEL_HIT_INFO
+{
+    enum COLOR eColor;    // Masterが点灯させた色
+    uint8_t bGen;         // 判定した点灯の世代
+    int64_t llReactionUs; // 点灯要求から押下受信まで[us]
+} panelHit_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vPanelTblClear(panelTbl_t *pxTbl);
+uint8_t bPanelTblSpawn(panelTbl_t *pxTbl, uint32_t ulPanelId, enum COLOR eColor,
+                       int64_t llNowUs, int64_t llDeadlineUs);
+int64_t llPanelTblExpireUs(const panelTbl_t *pxTbl, uint32_t ulPanelId);
+BOOL_t xPanelTblExpire(panelTbl_t *pxTbl, uint32_t ulPanelId, uint8_t bGen);
+ePanelHit_t ePanelTblHit(panelTbl_t *pxTbl, uint32_t ulPanelId, int64_t llNowUs,
+                         panelHit_t *pxHit);
+uint32_t ulPanelTblLitMask(const panelTbl_t *pxTbl);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,459 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_sched.c
+ * @comments ゲーム中イベントのスケジューラ(ハッシュ化タイマホイール)
+ *           パネル生成／点灯終了／スピードアップをesp_timerのus時刻で管理する。
+ *
+ *           スロット = (発火時刻 / SCHED_SLOT_US) % SCHED_WHEEL_SIZE
+ *           1周(SCHED_WHEEL_SIZE * SCHED_SLOT_US)より先のイベントも同じスロット
+ *           に入り、発火時刻の比較で次周以降として扱う。
+ *           CtrlTxTaskからのみ呼ぶこと(排他なし)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <string.h>
+
+/* ESP-IDF Includes */
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ctrl_sched.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* Timer Wheel Configure */
+#define SCHED_WHEEL_SIZE 64 // スロット数(2の累乗)
+#define SCHED_WHEEL_MASK (SCHED_WHEEL_SIZE - 1)
+#define SCHED_SLOT_US 25000 // 1スロット25ms, 1周1.6s
+/*
+ * 同時に登録できるイベント数
+ * 点灯終了はパネル毎に1つ(再点灯のときは前の分を取り消す, ulCtrlSchedCancel)、
+ * 生成は区画毎に1つ、スピードアップが1つ。生成の再登録は取り出した分の空きを使う
+ */
+#define SCHED_MAX_ITEM ((MAX_PANEL_NUM - PANEL_1) + configZONE_MAX + 1)
+#define SCHED_NIL 0xFF
+_Static_assert(SCHED_MAX_ITEM < SCHED_NIL, "SCHED_MAX_ITEM must fit the uint8_t node index");
+
+/* ESPLOGGER Configure */
+#define TAG "CtrlSched"
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef struct SCHED_NODE
+{
+    schedItem_t tItem;
+    uint8_t bNext; // 同一スロット内の次ノード / 空きリストの次ノード
+} schedNode_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+// Semaphore
+static SemaphoreHandle_t xSchedWakeSem = NULL;
+
+// esp_timer
+static esp_timer_handle_t xSchedTimer = NULL;
+
+// Timer Wheel
+static schedNode_t stNode[SCHED_MAX_ITEM];
+static uint8_t bSlotHead[SCHED_WHEEL_SIZE];
+static uint8_t bFreeHead;
+static uint32_t ulItemCount;
+static int64_t llCursorUs; // 処理中スロットの開始時刻
+
+// Jitter
+static schedJitter_t stJitter[MAX_SCHED_EV];
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvSchedTimerHandle(void *pvArg);
+static uint8_t prvSchedFindDue(uint8_t bSlot, int64_t llLimitUs,
+                               uint8_t *pbPrev);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * CtrlSched初期化
+ *
+ * @param    ##
+ *
+ * @return   ESP_OK / ESP_FAIL
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t lInitCtrlSched()
+{
+    const esp_timer_create_args_t tTimerArgs = {
+        .callback = prvSchedTimerHandle,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "CtrlSched"};
+
+    xSchedWakeSem = xSemaphoreCreateBinary();
+    configASSERT(xSchedWakeSem);
+
+    if (esp_timer_create(&tTimerArgs, &xSchedTimer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed esp_timer_create");
+        return ESP_FAIL;
+    }
+
+    vCtrlSchedClear();
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * 登録済みイベントと発火遅れの集計を全て破棄します
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     カーソルは現在時刻に合わせる
+ *
+ ******************************************************************************/
+void vCtrlSchedClear()
+{
+    memset(bSlotHead, SCHED_NIL, sizeof(bSlotHead));
+    for (int i = 0; i < SCHED_MAX_ITEM; i++)
+    {
+        stNode[i].bNext = (i + 1 < SCHED_MAX_ITEM) ? (uint8_t)(i + 1) : SCHED_NIL;
+    }
+    bFreeHead = 0;
+    ulItemCount = 0;
+    llCursorUs = esp_timer_get_time() / SCHED_SLOT_US * SCHED_SLOT_US;
+    memset(stJitter, 0x00, sizeof(stJitter));
+}
+
+/*****************************************************************************/
+/**
+ * イベント登録
+ *
+ * @param    llDeadlineUs: 発火時刻[us]
+ * @param    eEvent: イベント
+ * @param    ulArg: 引数
+ *
+ * @return   pdPASS / pdFAIL(登録数上限)
+ *
+ * @note     既に過ぎた時刻は次のxCtrlSchedPopで発火する
+ *
+ ******************************************************************************/
+BOOL_t xCtrlSchedAdd(int64_t llDeadlineUs, eSchedEv_t eEvent, uint32_t ulArg)
+{
+    uint8_t bIdx = bFreeHead;
+    uint8_t bSlot;
+
+    if (bIdx == SCHED_NIL)
+    {
+        ESP_LOGE(TAG, "Failed xCtrlSchedAdd (full) event:%d", eEvent);
+        return pdFAIL;
+    }
+    bFreeHead = stNode[bIdx].bNext;
+
+    stNode[bIdx].tItem.llDeadlineUs = llDeadlineUs;
+    stNode[bIdx].tItem.eEvent = eEvent;
+    stNode[bIdx].tItem.ulArg = ulArg;
+
+    // 過ぎた時刻は処理中スロットへ入れる
+    bSlot = (uint8_t)(((llDeadlineUs < llCursorUs ? llCursorUs : llDeadlineUs) /
+                       SCHED_SLOT_US) &
+                      SCHED_WHEEL_MASK);
+    stNode[bIdx].bNext = bSlotHead[bSlot];
+    bSlotHead[bSlot] = bIdx;
+    ulItemCount++;
+
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * イベントの取り消し
+ * eEventで(ulArg & ulArgMask) == ulMatchのイベントを全て外します。
+ *
+ * @param    eEvent: イベント
+ * @param    ulMatch: 引数の比較値
+ * @param    ulArgMask: 比較する引数のビット
+ *
+ * @return   uint32_t 取り消した数
+ *
+ * @note     全スロットを見る(SCHED_WHEEL_SIZE + 登録数)
+ *
+ ******************************************************************************/
+uint32_t ulCtrlSchedCancel(eSchedEv_t eEvent, uint32_t ulMatch, uint32_t ulArgMask)
+{
+    uint32_t ulCancel = 0;
+    uint8_t bPrev;
+    uint8_t bIdx;
+    uint8_t bNext;
+
+    for (int i = 0; i < SCHED_WHEEL_SIZE; i++)
+    {
+        bPrev = SCHED_NIL;
+        for (bIdx = bSlotHead[i]; bIdx != SCHED_NIL; bIdx = bNext)
+        {
+            bNext = stNode[bIdx].bNext;
+            if (stNode[bIdx].tItem.eEvent != eEvent ||
+                (stNode[bIdx].tItem.ulArg & ulArgMask) != ulMatch)
+            {
+                bPrev = bIdx;
+                continue;
+            }
+            // スロットから外して空きリストへ戻す
+            if (bPrev == SCHED_NIL)
+                bSlotHead[i] = bNext;
+            else
+                stNode[bPrev].bNext = bNext;
+            stNode[bIdx].bNext = bFreeHead;
+            bFreeHead = bIdx;
+            ulItemCount--;
+            ulCancel++;
+        }
+    }
+    return ulCancel;
+}
+
+/*****************************************************************************/
+/**
+ * 発火時刻を過ぎたイベントを1つ取り出す
+ * 発火時刻の早い順に取り出し、発火遅れを集計します。
+ *
+ * @param    llNowUs: 現在時刻[us]
+ * @param    pxItem: 取り出したイベントの格納先
+ *
+ * @return   pdTRUE:取り出した / pdFALSE:発火するイベントなし
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+BOOL_t xCtrlSchedPop(int64_t llNowUs, schedItem_t *pxItem)
+{
+    uint8_t bSlot;
+    uint8_t bIdx;
+    uint8_t bPrev;
+    int64_t llSlotEndUs;
+    int64_t llLateUs;
+
+    while (ulItemCount > 0 && llCursorUs <= llNowUs)
+    {
+        bSlot = (uint8_t)((llCursorUs / SCHED_SLOT_US) & SCHED_WHEEL_MASK);
+        llSlotEndUs = llCursorUs + SCHED_SLOT_US;
+
+        bIdx = prvSchedFindDue(bSlot,
+                               (llSlotEndUs <= llNowUs) ? llSlotEndUs - 1 : llNowUs,
+                               &bPrev);
+        if (bIdx != SCHED_NIL)
+        {
+            // スロットから外して空きリストへ戻す
+            if (bPrev == SCHED_NIL)
+                bSlotHead[bSlot] = stNode[bIdx].bNext;
+            else
+                stNode[bPrev].bNext = stNode[bIdx].bNext;
+            stNode[bIdx].bNext = bFreeHead;
+            bFreeHead = bIdx;
+            ulItemCount--;
+
+            *pxItem = stNode[bIdx].tItem;
+
+            llLateUs = llNowUs - pxItem->llDeadlineUs;
+            stJitter[pxItem->eEvent].ulCount++;
+            stJitter[pxItem->eEvent].llSumUs += llLateUs;
+            if (llLateUs > stJitter[pxItem->eEvent].llMaxUs)
+                stJitter[pxItem->eEvent].llMaxUs = llLateUs;
+            return pdTRUE;
+        }
+
+        // 処理中スロットの時間がまだ終わっていない
+        if (llSlotEndUs > llNowUs)
+            break;
+        llCursorUs = llSlotEndUs;
+    }
+
+    // 空なら現在時刻まで進める
+    if (ulItemCount == 0 && llCursorUs <= llNowUs)
+        llCursorUs = llNowUs / SCHED_SLOT_US * SCHED_SLOT_US;
+
+    return pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 次に発火するイベントの時刻を返します
+ *
+ * @param    ##
+ *
+ * @return   発火時刻[us], イベントなしはINT64_MAX
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int64_t llCtrlSchedNextDeadline()
+{
+    int64_t llSlotUs = llCursorUs;
+    int64_t llMinUs = INT64_MAX;
+    uint8_t bSlot;
+    uint8_t bIdx;
+    uint8_t bPrev;
+
+    if (ulItemCount == 0)
+        return INT64_MAX;
+
+    // 1周分のスロットを順に見る
+    for (int i = 0; i < SCHED_WHEEL_SIZE; i++)
+    {
+        bSlot = (uint8_t)((llSlotUs / SCHED_SLOT_US) & SCHED_WHEEL_MASK);
+        bIdx = prvSchedFindDue(bSlot, llSlotUs + SCHED_SLOT_US - 1, &bPrev);
+        if (bIdx != SCHED_NIL)
+            return stNode[bIdx].tItem.llDeadlineUs;
+        llSlotUs += SCHED_SLOT_US;
+    }
+
+    // 1周より先のイベントしかない
+    for (int i = 0; i < SCHED_WHEEL_SIZE; i++)
+    {
+        for (bIdx = bSlotHead[i]; bIdx != SCHED_NIL; bIdx = stNode[bIdx].bNext)
+        {
+            if (stNode[bIdx].tItem.llDeadlineUs < llMinUs)
+                llMinUs = stNode[bIdx].tItem.llDeadlineUs;
+        }
+    }
+    return llMinUs;
+}
+
+/*****************************************************************************/
+/**
+ * 指定時刻までブロックします
+ * 発火時刻はesp_timerでus単位に合わせ、Tick単位の丸めを受けません。
+ *
+ * @param    llDeadlineUs: 起床時刻[us]
+ * @param    xMaxWait: 最大待ち時間(ゲーム終了フラグの確認間隔)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vCtrlSchedWaitUntil(int64_t llDeadlineUs, TickType_t xMaxWait)
+{
+    int64_t llWaitUs = llDeadlineUs - esp_timer_get_time();
+
+    if (llWaitUs <= 0)
+        return;
+
+    if (llWaitUs > (int64_t)xMaxWait * portTICK_PERIOD_MS * 1000)
+    {
+        vTaskDelay(xMaxWait);
+        return;
+    }
+
+    // 前回の残りを捨ててから起床タイマを掛ける
+    xSemaphoreTake(xSchedWakeSem, 0);
+    if (esp_timer_start_once(xSchedTimer, (uint64_t)llWaitUs) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed esp_timer_start_once");
+        vTaskDelay(xMaxWait);
+        return;
+    }
+    xSemaphoreTake(xSchedWakeSem, xMaxWait);
+    esp_timer_stop(xSchedTimer);
+}
+
+/*****************************************************************************/
+/**
+ * 発火遅れの集計を取得します
+ *
+ * @param    eEvent: イベント
+ * @param    pxJitter: 格納先
+ *
+ * @return   ##
+ *
+ * @note     vCtrlSchedClearまでの累計
+ *
+ ******************************************************************************/
+void vCtrlSchedGetJitter(eSchedEv_t eEvent, schedJitter_t *pxJitter)
+{
+    *pxJitter = stJitter[eEvent];
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * esp_timerのコールバック
+ *
+ * @param    pvArgは未使用
+ *
+ * @return   ##
+ *
+ * @note     esp_timerタスクから呼ばれる
+ *
+ ******************************************************************************/
+static void prvSchedTimerHandle(void *pvArg)
+{
+    xSemaphoreGive(xSchedWakeSem);
+}
+
+/*****************************************************************************/
+/**
+ * スロット内でllLimitUs以前に発火する最も早いノードを探す
+ *
+ * @param    bSlot: スロット
+ * @param    llLimitUs: 発火時刻の上限[us]
+ * @param    pbPrev: 見つかったノードの前のノード(先頭ならSCHED_NIL)
+ *
+ * @return   ノード番号 / SCHED_NIL
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static uint8_t prvSchedFindDue(uint8_t bSlot, int64_t llLimitUs,
+                               uint8_t *pbPrev)
+{
+    uint8_t bBest = SCHED_NIL;
+    uint8_t bPrev = SCHED_NIL;
+
+    *pbPrev = SCHED_NIL;
+    for (uint8_t bIdx = bSlotHead[bSlot]; bIdx != SCHED_NIL;
+         bPrev = bIdx, bIdx = stNode[bIdx].bNext)
+    {
+        if (stNode[bIdx].tItem.llDeadlineUs > llLimitUs)
+            continue;
+        if (bBest == SCHED_NIL ||
+            stNode[bIdx].tItem.llDeadlineUs < stNode[bBest].tItem.llDeadlineUs)
+        {
+            bBest = bIdx;
+            *pbPrev = bPrev;
+        }
+    }
+    return bBest;
+}
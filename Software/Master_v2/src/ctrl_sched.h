@@ -0,0 +1,78 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_sched.h
+ * @comments ゲーム中イベントのスケジューラ(タイマホイール)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_SCHED_H
+#define SRC_CTRL_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include "esp_err.h"
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* スケジュールするイベント */
+typedef enum SCHED_EVENT
+{
+    SCHED_EV_NONE = 0,
+    SCHED_EV_SPAWN,   // パネル生成(難易度別の周期)
+    SCHED_EV_EXPIRE,  // パネル点灯時間終了(ulArg:PanelID | 世代 << 8, パネル毎に1つ)
+    SCHED_EV_SPEEDUP, // スピードアップ開始
+    MAX_SCHED_EV
+} eSchedEv_t;
+
+typedef struct SCHED_ITEM
+{
+    int64_t llDeadlineUs; // 発火時刻(esp_timer_get_time基準)
+    eSchedEv_t eEvent;
+    uint32_t ulArg;
+} schedItem_t;
+
+/* 発火遅れ(発火時刻との差)の集計 */
+typedef struct SCHED_JITTER
+{
+    uint32_t ulCount;
+    int64_t llSumUs;
+    int64_t llMaxUs;
+} schedJitter_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+esp_err_t lInitCtrlSched();
+void vCtrlSchedClear();
+BOOL_t xCtrlSchedAdd(int64_t llDeadlineUs, eSchedEv_t eEvent, uint32_t ulArg);
+uint32_t ulCtrlSchedCancel(eSchedEv_t eEvent, uint32_t ulMatch, uint32_t ulArgMask);
+BOOL_t xCtrlSchedPop(int64_t llNowUs, schedItem_t *pxItem);
+int64_t llCtrlSchedNextDeadline();
+void vCtrlSchedWaitUntil(int64_t llDeadlineUs, TickType_t xMaxWait);
+void vCtrlSchedGetJitter(eSchedEv_t eEvent, schedJitter_t *pxJitter);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
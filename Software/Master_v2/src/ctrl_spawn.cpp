@@ -0,0 +1,301 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_spawn.cpp
+ * @comments パネル生成位置の選択(5x5の盤面の距離を使う)
+ *           パネル毎・距離毎の近傍マスクをコンパイル時に作り、
+ *           候補 = 空き & 距離の制約 & 点灯中パネルの隣以外 をビット演算で求める。
+ *           候補が無ければ決まった順に制約を緩めるので、やり直しのループは無い。
+ *           時刻／RTOSに依存しない(排他は呼び出し側で行う)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+
+#include "ctrl_spawn.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define SPAWN_SEED_DEFAULT 0x2545F491UL // シード0のときの代わり(xorshiftは0で止まる)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+namespace
+{
+constexpr uint32_t ulAbsDiff(uint32_t a, uint32_t b) { return a > b ? a - b : b - a; }
+
+/* PanelID同士のチェビシェフ距離 */
+constexpr uint32_t ulGridDist(uint32_t p, uint32_t q)
+{
+    return ulAbsDiff((p - 1) / SPAWN_GRID_SIZE, (q - 1) / SPAWN_GRID_SIZE) >
+                   ulAbsDiff((p - 1) % SPAWN_GRID_SIZE, (q - 1) % SPAWN_GRID_SIZE)
+               ? ulAbsDiff((p - 1) / SPAWN_GRID_SIZE, (q - 1) / SPAWN_GRID_SIZE)
+               : ulAbsDiff((p - 1) % SPAWN_GRID_SIZE, (q - 1) % SPAWN_GRID_SIZE);
+}
+
+/* パネルpから距離d以内のパネル(bit = PanelID) */
+constexpr uint32_t ulNearMask(uint32_t p, uint32_t d, uint32_t q = PANEL_1)
+{
+    return q >= MAX_PANEL_NUM
+               ? 0
+               : ((p >= PANEL_1 && ulGridDist(p, q) <= d) ? (1UL << q) : 0) |
+                     ulNearMask(p, d, q + 1);
+}
+} // namespace
+
+#define SPAWN_NEAR_ROW(p)                                                  \
+    {                                                                      \
+        ulNearMask(p, 0), ulNearMask(p, 1), ulNearMask(p, 2),              \
+            ulNearMask(p, 3), ulNearMask(p, 4)                             \
+    }
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+/* culSpawnNearTbl[PanelID][距離]: 距離以内のパネル([0]は空) */
+static constexpr uint32_t culSpawnNearTbl[MAX_PANEL_NUM][SPAWN_DIST_MAX + 1] = {
+    SPAWN_NEAR_ROW(0),  SPAWN_NEAR_ROW(1),  SPAWN_NEAR_ROW(2),  SPAWN_NEAR_ROW(3),
+    SPAWN_NEAR_ROW(4),  SPAWN_NEAR_ROW(5),  SPAWN_NEAR_ROW(6),  SPAWN_NEAR_ROW(7),
+    SPAWN_NEAR_ROW(8),  SPAWN_NEAR_ROW(9),  SPAWN_NEAR_ROW(10), SPAWN_NEAR_ROW(11),
+    SPAWN_NEAR_ROW(12), SPAWN_NEAR_ROW(13), SPAWN_NEAR_ROW(14), SPAWN_NEAR_ROW(15),
+    SPAWN_NEAR_ROW(16), SPAWN_NEAR_ROW(17), SPAWN_NEAR_ROW(18), SPAWN_NEAR_ROW(19),
+    SPAWN_NEAR_ROW(20), SPAWN_NEAR_ROW(21), SPAWN_NEAR_ROW(22), SPAWN_NEAR_ROW(23),
+    SPAWN_NEAR_ROW(24), SPAWN_NEAR_ROW(25),
+};
+
+static_assert(SPAWN_GRID_SIZE * SPAWN_GRID_SIZE == configPANEL_NUM &&
+                  MAX_PANEL_NUM == configPANEL_NUM + 1,
+              "ctrl_spawn assumes a 5x5 floor numbered from PANEL_1");
+static_assert(culSpawnNearTbl[PANEL_13][1] ==
+                  ((1UL << PANEL_7) | (1UL << PANEL_8) | (1UL << PANEL_9) |
+                   (1UL << PANEL_12) | (1UL << PANEL_13) | (1UL << PANEL_14) |
+                   (1UL << PANEL_17) | (1UL << PANEL_18) | (1UL << PANEL_19)),
+              "culSpawnNearTbl: ring 1 of the centre must match culCDPanel1");
+static_assert(culSpawnNearTbl[PANEL_1][SPAWN_DIST_MAX] == SPAWN_ALL_MASK,
+              "culSpawnNearTbl: the corner must reach every panel");
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static uint32_t prvPopCount(uint32_t ulMask);
+static uint32_t prvSelectBit(uint32_t ulMask, uint32_t ulNth);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 生成器の初期化(ゲーム開始時)
+ *
+ * @param    pxGen: 生成器
+ * @param    ulSeed: シード(同じシード・同じ入力なら同じ並び)
+ * @param    ulPlayerPanel: プレイヤーの初期位置(スタートSW)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vSpawnGenInit(spawnGen_t *pxGen, uint32_t ulSeed, uint32_t ulPlayerPanel)
+{
+    pxGen->ulState = (ulSeed != 0) ? ulSeed : SPAWN_SEED_DEFAULT;
+    pxGen->ulPlayerPanel = ulPlayerPanel;
+    pxGen->ulRelaxed = 0;
+}
+
+/*****************************************************************************/
+/**
+ * プレイヤー位置の更新(パネルが踏まれた)
+ *
+ * @param    pxGen: 生成器
+ * @param    ulPanelId: 踏まれたパネル
+ *
+ * @return   ##
+ *
+ * @note     範囲外は無視
+ *
+ ******************************************************************************/
+void vSpawnGenSetPlayer(spawnGen_t *pxGen, uint32_t ulPanelId)
+{
+    if (ulPanelId >= PANEL_1 && ulPanelId < MAX_PANEL_NUM)
+        pxGen->ulPlayerPanel = ulPanelId;
+}
+
+/*****************************************************************************/
+/**
+ * 乱数(生成器の並びから取る)
+ *
+ * @param    pxGen: 生成器
+ * @param    ulRange: 範囲(0 .. ulRange-1)
+ *
+ * @return   uint32_t 乱数
+ *
+ * @note     ulRange == 0 なら0
+ *
+ ******************************************************************************/
+uint32_t ulSpawnGenRand(spawnGen_t *pxGen, uint32_t ulRange)
+{
+    uint32_t x = pxGen->ulState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pxGen->ulState = x;
+    // 剰余の偏りを避けて上位ビットで範囲に写す
+    return (uint32_t)(((uint64_t)x * ulRange) >> 32);
+}
+
+/*****************************************************************************/
+/**
+ * 生成するパネルの選択
+ * 次の順に制約を緩め、最初に候補が残った段階で一様に選ぶ。
+ *   1. 空き & 距離(最小〜最大) & 点灯中パネルの隣以外
+ *   2. 空き & 距離(最小〜最大)
+ *   3. 空き & 最小距離以上
+ *   4. 空き
+ * 空き = 区画内 & 点灯中でない
+ *
+ * @param    pxGen: 生成器
+ * @param    ulLitMask: 点灯中のパネル(bit = PanelID)
+ * @param    pxRule: 制約
+ *
+ * @return   uint32_t PanelID / 0:空きなし
+ *
+ * @note     処理量はパネル数で決まる(やり直しなし)
+ *
+ ******************************************************************************/
+uint32_t ulSpawnGenPick(spawnGen_t *pxGen, uint32_t ulLitMask,
+                        const spawnRule_t *pxRule)
+{
+    uint32_t ulFree = SPAWN_ALL_MASK & pxRule->ulZoneMask & ~ulLitMask;
+    uint32_t ulFar = SPAWN_ALL_MASK;
+    uint32_t ulReach = SPAWN_ALL_MASK;
+    uint32_t ulCluster = 0;
+    uint32_t ulCand[4];
+    uint32_t ulPlayer = pxGen->ulPlayerPanel;
+    uint32_t ulMaxDist = pxRule->bMaxDist;
+    uint32_t i;
+
+    if (ulFree == 0)
+        return 0;
+
+    if (ulPlayer >= PANEL_1 && ulPlayer < MAX_PANEL_NUM)
+    {
+        if (pxRule->bMinDist > 0)
+        {
+            ulFar = ~culSpawnNearTbl[ulPlayer][pxRule->bMinDist > SPAWN_DIST_MAX
+                                                   ? SPAWN_DIST_MAX
+                                                   : pxRule->bMinDist - 1];
+        }
+        ulReach = culSpawnNearTbl[ulPlayer][ulMaxDist > SPAWN_DIST_MAX ? SPAWN_DIST_MAX
+                                                                      : ulMaxDist];
+    }
+
+    // 点灯中パネルの隣(点灯中はulFreeで除かれる)
+    if (pxRule->xAntiCluster == pdTRUE)
+    {
+        for (i = PANEL_1; i < MAX_PANEL_NUM; i++)
+        {
+            if ((ulLitMask & (1UL << i)) != 0)
+                ulCluster |= culSpawnNearTbl[i][1];
+        }
+    }
+
+    ulCand[0] = ulFree & ulFar & ulReach & ~ulCluster;
+    ulCand[1] = ulFree & ulFar & ulReach;
+    ulCand[2] = ulFree & ulFar;
+    ulCand[3] = ulFree;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (ulCand[i] != 0)
+            break;
+    }
+    if (i > 0)
+        pxGen->ulRelaxed++;
+
+    return prvSelectBit(ulCand[i], ulSpawnGenRand(pxGen, prvPopCount(ulCand[i])));
+}
+
+/*****************************************************************************/
+/**
+ * 近傍マスク
+ *
+ * @param    ulPanelId: PanelID
+ * @param    ulDist: 距離
+ *
+ * @return   uint32_t 距離以内のパネル(bit = PanelID)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulSpawnNearMask(uint32_t ulPanelId, uint32_t ulDist)
+{
+    if (ulPanelId < PANEL_1 || ulPanelId >= MAX_PANEL_NUM)
+        return 0;
+    return culSpawnNearTbl[ulPanelId][ulDist > SPAWN_DIST_MAX ? SPAWN_DIST_MAX : ulDist];
+}
+
+/*****************************************************************************/
+/**
+ * 点灯時間内に届く距離
+ *
+ * @param    ulLightMs: 点灯時間[ms]
+ * @param    lReactionUs: 反応時間の推定[us]
+ * @param    ulStepMs: 1歩の時間[ms]
+ *
+ * @return   uint32_t 距離(1 .. SPAWN_DIST_MAX)
+ *
+ * @note     (点灯時間 - 反応時間) / 1歩 、最低でも隣までは届くとする
+ *
+ ******************************************************************************/
+uint32_t ulSpawnReachDist(uint32_t ulLightMs, int32_t lReactionUs,
+                          uint32_t ulStepMs)
+{
+    int32_t lSpareMs = (int32_t)ulLightMs - lReactionUs / 1000;
+    uint32_t ulDist;
+
+    if (ulStepMs == 0)
+        return SPAWN_DIST_MAX;
+    ulDist = (lSpareMs > 0) ? (uint32_t)lSpareMs / ulStepMs : 0;
+    if (ulDist < 1)
+        ulDist = 1;
+    if (ulDist > SPAWN_DIST_MAX)
+        ulDist = SPAWN_DIST_MAX;
+    return ulDist;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+static uint32_t prvPopCount(uint32_t ulMask)
+{
+    uint32_t ulCount = 0;
+
+    for (; ulMask != 0; ulMask &= ulMask - 1)
+        ulCount++;
+    return ulCount;
+}
+
+/* ulNth番目(0から)に立っているビットの位置 */
+static uint32_t prvSelectBit(uint32_t ulMask, uint32_t ulNth)
+{
+    for (; ulMask != 0; ulMask &= ulMask - 1)
+    {
+        if (ulNth-- == 0)
+            return (uint32_t)__builtin_ctz(ulMask);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_spawn.h
+ * @comments パネル生成位置の選択(5x5の盤面の距離を使う)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_SPAWN_H
+#define SRC_CTRL_SPAWN_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * 盤面: PanelIDは行優先で並ぶ(PANEL_1が左上、PANEL_25が右下)
+ * 距離はチェビシェフ距離(斜めも1歩)
+ */
+#define SPAWN_GRID_SIZE 5
+#define SPAWN_DIST_MAX (SPAWN_GRID_SIZE - 1)
+#define SPAWN_ALL_MASK (((1UL << MAX_PANEL_NUM) - 1) & ~1UL) // bit = PanelID
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 生成の制約(ゲーム中に変わる値はulSpawnReachDistで求める) */
+typedef struct SPAWN_RULE
+{
+    uint8_t bMinDist;     // プレイヤー位置からの最小距離(0:足元も可)
+    uint8_t bMaxDist;     // プレイヤー位置からの最大距離(到達できる距離)
+    BOOL_t xAntiCluster;  // 点灯中パネルの隣を避ける
+    uint32_t ulZoneMask;  // 生成してよいパネル(区画, bit = PanelID)
+} spawnRule_t;
+
+/* 生成器の状態(シードから同じ並びを再現できる) */
+typedef struct SPAWN_GEN
+{
+    uint32_t ulState;       // xorshift32
+    uint32_t ulPlayerPanel; // プレイヤーの推定位置(最後に踏まれたパネル)
+    uint32_t ulRelaxed;     // 制約を緩めて選んだ回数
+} spawnGen_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vSpawnGenInit(spawnGen_t *pxGen, uint32_t ulSeed, uint32_t ulPlayerPanel);
+void vSpawnGenSetPlayer(spawnGen_t *pxGen, uint32_t ulPanelId);
+uint32_t ulSpawnGenRand(spawnGen_t *pxGen, uint32_t ulRange);
+uint32_t ulSpawnGenPick(spawnGen_t *pxGen, uint32_t ulLitMask,
+                        const spawnRule_t *pxRule);
+uint32_t ulSpawnNearMask(uint32_t ulPanelId, uint32_t ulDist);
+uint32_t ulSpawnReachDist(uint32_t ulLightMs, int32_t lReactionUs,
+                          uint32_t ulStepMs);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,154 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_zone.cpp
+ * @comments 盤面の区画(同時に遊ぶゲーム毎のパネル範囲)
+ *           人数毎の割り当てをコンパイル時に作り、重なりが無いことを確かめる。
+ *           区画の間は1列空けて、隣のプレイヤーとぶつからないようにする。
+ *
+ *             1人         2人         3人
+ *           A A A A A   A A . B B   A A . B B
+ *           A A A A A   A A . B B   A A . B B
+ *           A A S A A   A S . S B   A A . B B
+ *           A A A A A   A A . B B   . C C C .
+ *           A A A A A   A A . B B   . C C C .
+ *           (S:スタートSW, 3人は左上7・右上9・下18)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+
+#include "ctrl_spawn.h"
+#include "ctrl_zone.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+namespace
+{
+/* 行r0..r1, 列c0..c1の矩形(両端を含む, bit = PanelID) */
+constexpr uint32_t ulRectMask(uint32_t r0, uint32_t c0, uint32_t r1, uint32_t c1,
+                              uint32_t q = PANEL_1)
+{
+    return q >= MAX_PANEL_NUM
+               ? 0
+               : (((q - 1) / SPAWN_GRID_SIZE >= r0 && (q - 1) / SPAWN_GRID_SIZE <= r1 &&
+                   (q - 1) % SPAWN_GRID_SIZE >= c0 && (q - 1) % SPAWN_GRID_SIZE <= c1)
+                      ? (1UL << q)
+                      : 0) |
+                     ulRectMask(r0, c0, r1, c1, q + 1);
+}
+
+constexpr uint32_t ulPopCount(uint32_t x)
+{
+    return x == 0 ? 0 : (x & 1) + ulPopCount(x >> 1);
+}
+
+/* 区画が重ならず盤面内にあり、スタートSWが自分の区画にある */
+constexpr bool bLayoutValid(const zoneLayout_t &l, uint32_t i = 0, uint32_t ulUsed = 0)
+{
+    return i >= l.bZoneNum
+               ? true
+               : (l.ulMask[i] & ~SPAWN_ALL_MASK) == 0 && (l.ulMask[i] & ulUsed) == 0 &&
+                     (l.ulMask[i] & (1UL << l.bStartSw[i])) != 0 &&
+                     bLayoutValid(l, i + 1, ulUsed | l.ulMask[i]);
+}
+
+/* 区画の広さが揃っている(人数が違っても同じ条件で競える) */
+constexpr bool bLayoutFair(const zoneLayout_t &l, uint32_t i = 1)
+{
+    return i >= l.bZoneNum ? true
+                           : ulPopCount(l.ulMask[i]) == ulPopCount(l.ulMask[0]) &&
+                                 bLayoutFair(l, i + 1);
+}
+} // namespace
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+/* csZoneTbl[人数-1] */
+static constexpr zoneLayout_t csZoneTbl[ZONE_LAYOUT_MAX] = {
+    {1, {SPAWN_ALL_MASK, 0, 0}, {PANEL_13, 0, 0}},
+    {2, {ulRectMask(0, 0, 4, 1), ulRectMask(0, 3, 4, 4), 0}, {PANEL_12, PANEL_14, 0}},
+    {3,
+     {ulRectMask(0, 0, 2, 1), ulRectMask(0, 3, 2, 4), ulRectMask(3, 1, 4, 3)},
+     {PANEL_7, PANEL_9, PANEL_18}},
+};
+
+static_assert(configZONE_MAX >= 1 && configZONE_MAX <= ZONE_LAYOUT_MAX,
+              "configZONE_MAX: add a layout to csZoneTbl");
+static_assert(csZoneTbl[0].bZoneNum == 1 && csZoneTbl[1].bZoneNum == 2 &&
+                  csZoneTbl[2].bZoneNum == 3,
+              "csZoneTbl is indexed by the number of players - 1");
+static_assert(bLayoutValid(csZoneTbl[0]) && bLayoutValid(csZoneTbl[1]) &&
+                  bLayoutValid(csZoneTbl[2]),
+              "csZoneTbl: zones must be disjoint and own their start switch");
+static_assert(bLayoutFair(csZoneTbl[1]) && bLayoutFair(csZoneTbl[2]),
+              "csZoneTbl: zones of one layout must have the same size");
+static_assert(csZoneTbl[0].bStartSw[0] == PANEL_13,
+              "csZoneTbl: a single game starts from the centre as before");
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 区画の割り当て
+ *
+ * @param    ulZoneNum: 同時に遊ぶ人数
+ *
+ * @return   const zoneLayout_t*
+ *
+ * @note     範囲外は近い方(1 / configZONE_MAX)に丸める
+ *
+ ******************************************************************************/
+const zoneLayout_t *pxZoneGetLayout(uint32_t ulZoneNum)
+{
+    if (ulZoneNum < 1)
+        ulZoneNum = 1;
+    if (ulZoneNum > configZONE_MAX)
+        ulZoneNum = configZONE_MAX;
+    return &csZoneTbl[ulZoneNum - 1];
+}
+
+/*****************************************************************************/
+/**
+ * パネルの属する区画
+ *
+ * @param    pxLayout: 区画の割り当て
+ * @param    ulPanelId: PanelID
+ *
+ * @return   uint32_t 区画(0 ..) / ZONE_NONE
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulZoneOfPanel(const zoneLayout_t *pxLayout, uint32_t ulPanelId)
+{
+    if (ulPanelId < PANEL_1 || ulPanelId >= MAX_PANEL_NUM)
+        return ZONE_NONE;
+    for (uint32_t i = 0; i < pxLayout->bZoneNum; i++)
+    {
+        if ((pxLayout->ulMask[i] & (1UL << ulPanelId)) != 0)
+            return i;
+    }
+    return ZONE_NONE;
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************/
+/**
+ * @file ctrl_zone.h
+ * @comments 盤面の区画(同時に遊ぶゲーム毎のパネル範囲)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_CTRL_ZONE_H
+#define SRC_CTRL_ZONE_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define ZONE_LAYOUT_MAX 3 // 割り当てを用意した区画数の上限(configZONE_MAXはこれ以下)
+#define ZONE_NONE 0xFF    // どの区画にも属さない(区画の間の緩衝パネル)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * 区画の割り当て(同時に遊ぶ人数毎)
+ * 区画同士は重ならない。区画に属さないパネルはゲーム中使わない。
+ */
+typedef struct ZONE_LAYOUT
+{
+    uint8_t bZoneNum;                   // 区画数
+    uint32_t ulMask[ZONE_LAYOUT_MAX];   // 区画のパネル(bit = PanelID)
+    uint8_t bStartSw[ZONE_LAYOUT_MAX];  // スタートSW(プレイヤーの初期位置)
+} zoneLayout_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+const zoneLayout_t *pxZoneGetLayout(uint32_t ulZoneNum);
+uint32_t ulZoneOfPanel(const zoneLayout_t *pxLayout, uint32_t ulPanelId);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
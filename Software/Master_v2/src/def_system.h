@@ -21,6 +21,9 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 
+/* Common Includes (Panel_v2と共通) */
+#include "tb_canproto.h"
+
 /*****************************************************************************/
 /* Macro
 ******************************************************************************/
@@ -33,15 +36,133 @@
 /* プレイヤー名最大長 */
 #define configPLAYERNAME_LENGTH 64
 
-/* 難易度別ブロック時間 */
-#define configWAIT_EASY pdMS_TO_TICKS(1500)
-#define configWAIT_NORMAL pdMS_TO_TICKS(1000)
-#define configWAIT_HARD pdMS_TO_TICKS(600)
-#define configWAIT_LUNATIC pdMS_TO_TICKS(300)
+/*
+ * 点灯時間(難易度・適応制御)の刻み[ms]
+ * Masterの中では[ms]で持ち、送るときに宛先のPanelのCANプロトコルの単位へ直す
+ * (v1: 秒に切り上げ、v2: 10ms, tb_canproto.h)。
+ * 1秒未満の刻みが届くのはv2を返してきたPanelだけ
+ */
+#define configLIGHT_TIME_UNIT_MS 100
+
+/*
+ * Panelへ送るCANプロトコルの最大バージョン(tb_canproto.h)
+ * Panelが対応を返してきたらそのPanelだけv2にする。TBCAN_VER_1で従来のまま。
+ */
+#define configCAN_PROTO_MAX TBCAN_VER_2
 
 /* スレーブ(Panel)固定値 */
 #define configPANEL_NUM 25
 
+/*
+ * 同じPanel宛てのCANフレームの最小間隔[ms](drv_can)
+ * Panel_v2はMCP2515からSPIで読み出し、シリアルへ出力してから次を待つ。
+ * 別のPanel宛ては間隔を空けずに送る。
+ */
+#define configCAN_PANEL_GAP_MS 10
+
+/*
+ * CANの監視(drv_can)
+ * PERIOD  : can_get_status_info()を見る周期[ms]
+ * WINDOW  : エラー数などを数える直近の時間[s](1s毎に区切る)
+ * TX_WAIT : ドライバのTXキューの空き待ちの上限[ms](過ぎたらフレームを捨てる)
+ */
+#define configCAN_HEALTH_PERIOD_MS 100
+#define configCAN_HEALTH_WINDOW_S 10
+#define configCAN_TX_WAIT_MS 100
+
+/*
+ * パネルの死活監視(ctrl_live)
+ * 死活監視のフレーム(TBCAN_HEARTBEAT_MS毎)がこの時間届かなければパネル生成から外す。
+ * 3回続けて落としたら外す(判定はconfigCAN_HEALTH_PERIOD_MS毎)
+ */
+#define configPANEL_DEAD_MS (3 * TBCAN_HEARTBEAT_MS + 500)
+
+/*
+ * パネルとの時刻同期(drv_can, tb_timesync.h)
+ * この周期でSYNC / FOLLOW_UPを全体宛てに送る(全PanelがCANプロトコルv2のときのみ)。
+ * 同期したPanelは踏んだ時刻と反応時間を返信に入れる。0で送らない。
+ */
+#define configTIME_SYNC_PERIOD_MS TBCAN_SYNC_PERIOD_MS
+
+/*
+ * 配送確認(drv_can, tb_canproto.h)
+ * ACK_MS    : ACKを待つ時間[ms](再送毎に倍)
+ * RETRY_MAX : 再送の回数(送り切ったら諦める)
+ * DUP_MS    : 同じPanelから同じ番号の返信が続いたら重複として捨てる時間[ms]
+ * スタートSWの押下待ちはSTART_RESEND_MS毎にスタート通知を送り直す(v1のPanel、諦めたとき)
+ */
+#define configCAN_REL_ACK_MS TBCAN_ACK_TIMEOUT_MS
+#define configCAN_REL_RETRY_MAX TBCAN_RETRY_MAX
+#define configCAN_REL_DUP_MS 1000
+#define configSTART_RESEND_MS 5000
+
+/*
+ * Panelのアニメーション(TBCAN_CMD_ANIM, 盤面が全てTBCAN_FEAT_ANIMのときだけ)
+ * DEMO_MS   : 待機中のデモを切り替える間隔[ms](1フレームで盤面全体、次の指示まで続ける)
+ * LEAD_MS   : 開始時刻を送信より先にする時間[ms](グループ毎のフレームが揃ってから始める)
+ * COUNT_MS  : カウントダウンの周期[ms](1カウントで列の順に1回流れる)
+ */
+#define configANIM_DEMO_MS 8000
+#define configANIM_LEAD_MS 50
+#define configANIM_COUNT_MS 1000
+
+/*
+ * CANの受信(drv_can)
+ * 1回の起床でドライバのRXキューからまとめて取り出す最大フレーム数。
+ * 変換したメッセージはまとめてctrl_mainへ送る(通知は1回)。
+ */
+#define configCAN_RX_BATCH 16
+
+/*
+ * CAN ID (11bit標準フォーマット)
+ * 0x000        : Master宛て(Panelからの返答)
+ * 0x001..0x019 : Panel宛て(PanelID)
+ * 0x400..0x7FE : グループ宛て(ctrl_group)
+ *                bit9..5が行、bit4..0が列。0(ドミナント)のビットの行×列のPanelが受信する。
+ *                Panel_v2のMCP2515はbit10と自分の行・列のビットだけをマスクで見る。
+ *                値はtb_canproto.hでPanel側と共有する
+ */
+#define CAN_ID_MASTER TBCAN_ID_MASTER
+#define CAN_ID_GROUP_FLAG TBCAN_ID_GROUP_FLAG
+#define CAN_ID_GROUP_ROW_SHIFT TBCAN_ID_GROUP_ROW_SHIFT
+#define CAN_ID_GROUP_MAP 0x1F // 5x5の盤面(行／列のビット数)
+#define CAN_ID_GROUP(ulRowMap, ulColMap)                                       \
+    ((uint32_t)(CAN_ID_GROUP_FLAG |                                            \
+                ((~(uint32_t)(ulRowMap) & CAN_ID_GROUP_MAP) << CAN_ID_GROUP_ROW_SHIFT) | \
+                (~(uint32_t)(ulColMap) & CAN_ID_GROUP_MAP)))
+#define CAN_ID_GROUP_ALL CAN_ID_GROUP(CAN_ID_GROUP_MAP, CAN_ID_GROUP_MAP)
+#define CAN_ID_GROUP_ROW(row) CAN_ID_GROUP(1UL << (row), CAN_ID_GROUP_MAP)
+#define CAN_ID_GROUP_COL(col) CAN_ID_GROUP(CAN_ID_GROUP_MAP, 1UL << (col))
+#define CAN_ID_IS_GROUP(id) (((id)&CAN_ID_GROUP_FLAG) != 0)
+
+/*
+ * 同時に遊べるゲーム数(盤面の区画数, ctrl_zone)
+ * 1回のエントリーで受け付けるプレイヤー数、HPDLTBの台数も同じ
+ */
+#define configZONE_MAX 3
+
+/* レイテンシトレース(util_trace) 1:有効 0:無効 */
+#define configTRACE_ENABLE 1
+
+/* 適応難易度(ctrl_adapt) 1:有効 0:無効(難易度プロファイルの固定値) */
+#define configADAPT_ENABLE 1
+
+/* イベントレコーダ(util_rec) 1:有効 0:無効, 記録数(2の累乗, 1件16byte) */
+#define configREC_ENABLE 1
+#define configREC_EVENT_NUM 4096
+
+/* 診断ログ(util_diag) 1:有効 0:無効, 記録数(2の累乗, 1件16byte) */
+#define configDIAG_ENABLE 1
+#define configDIAG_EVENT_NUM 1024
+
+/* Panelのファームウェア配信(drv_canfw)
+ * イメージの既定のパス、パスの最大長、
+ * データフレームの間隔[us](0: ドライバのTXキューが空き次第), ブロックの間隔[ms](Panelの書き込み時間) */
+#define configCANFW_IMAGE_PATH "/spiffs/panel_v2.bin"
+#define configCANFW_PATH_LENGTH 64
+#define configCANFW_FRAME_GAP_US 0
+#define configCANFW_BLOCK_GAP_MS 12
+
 /*****************************************************************************/
 /* TAG Definitions
 ******************************************************************************/
@@ -92,14 +213,26 @@ enum COLOR
  */
 typedef struct CAN_MESSAGE
 {
-    uint32_t ulCanId; // 送信先／受信元
-    byte bPanelId;    // PanelID（Panelからの返答のみに使用）
-    byte bColorInfoR; // 色情報 - R
-    byte bColorInfoG; // 色情報 - G
-    byte bColorInfoB; // 色情報 - B
-    byte bBtnFlag;    // パネル押下許可／押下フラグ
-    byte bLightTime;  // LED点灯時間
+    uint32_t ulCanId;       // 送信先／受信元
+    byte bPanelId;          // PanelID（Panelからの返答のみに使用）
+    byte bColorInfoR;       // 色情報 - R
+    byte bColorInfoG;       // 色情報 - G
+    byte bColorInfoB;       // 色情報 - B
+    byte bBtnFlag;          // パネル押下許可／押下フラグ
+    uint16_t usLightTimeMs; // LED点灯時間[ms] (v1は秒に切り上げ, v2は10ms単位で送る)
     byte bStartSwFlag;
+    byte bFade;             // フェードカーブ(TBCAN_FADE_*, v2のみ)
+    byte bSeq;              // シーケンス番号(drv_canが付ける、返信は受信した番号)
+    byte bProto;            // 受信したフレームのバージョン(TBCAN_VER_*)
+    byte bCmd;              // 0以外: 問い合わせ(TBCAN_CMD_*, 送信のみ。他の項目は見ない)
+    byte bTimed;            // 踏んだ時刻付きの返信(受信のみ, 色は無い)
+    int64_t llPressUs;      // 踏んだ時刻[us](esp_timer, bTimedのみ)
+    uint32_t ulReactionUs;  // Panelで測った反応時間(点灯 -> 踏んだ)[us](bTimedのみ)
+    byte bReliable;         // 配送確認(送信: ACKを待って再送する / 受信: ACKを返した)
+    byte bAnim;             // アニメーション(TBCAN_ANIM_*, TBCAN_CMD_ANIMのみ。色・続ける時間は上と共用)
+    uint16_t usAnimPeriodMs; // アニメーションの周期[ms]
+    int64_t llAnimStartUs;  // アニメーションの開始時刻[us](esp_timer, 0: Panelが受信したとき)
+    byte bPixel[TBCAN_PIXEL_NUM][3]; // LED毎の色(TBCAN_CMD_PIXELのみ。点灯時間・フェードは上と共用)
 } canCommMsg_t;
 
 /*
@@ -125,6 +258,7 @@ struct GAME_INFO
     uint32_t greenPoint;
     int32_t hitPoint;
     uint32_t remainingTime;
+    uint32_t zone; // 区画(0 .. configZONE_MAX-1)
 };
 
 /* Panel enum定義 */
@@ -182,15 +316,6 @@ typedef struct LED_COLOR_TBL
 //     {BLUE_L, SETCOLOR(0, 0, LOW_BR)},
 // };
 
-/* Hit Point Table */
-struct HIT_POINT_TBL
-{
-    eDfclt_t difficulty;
-    int strong;
-    int same;
-    int weak;
-};
-
 /* Weak point Table */
 struct WEAK_POINT_TBL
 {
@@ -26,14 +26,24 @@
 /* Standard Lib Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
 
 /* ESP-IDF Includes */
 #include "driver/can.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "drv_can.h"
+#include "drv_canfw.h"
+#include "drv_canpace.h"
+#include "ctrl_group.h"
 #include "ctrl_main.h"
+#include "util_diag.h"
+#include "util_rec.h"
+#include "util_ring.h"
+#include "util_trace.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -42,10 +52,31 @@
 #define tskstacMAIN_CANTASK 4096
 #define tskprioMAIN_CANRXTASK 9
 #define tskprioMAIN_CANTXTASK 8
+#define tskprioMAIN_CANHEALTHTASK 10 // 復帰をRx/Txより先に行う
 
-/* Queue Configure */
+/* Queue Configure (SPSC Ring, Producer: CtrlTxタスク) */
 #define QUEUE_CAN_TX_SIZE 32
 #define QUEUE_CAN_TX_WAIT portMAX_DELAY
+#define QUEUE_CAN_TX_POLICY RING_POLICY_BLOCK
+
+/*
+ * 送信パイプライン
+ * ドライバのTXキューは詰めて使い、同じPanel宛てだけconfigCAN_PANEL_GAP_MS空ける
+ * (間隔待ちのフレームはdrv_canpaceに取っておき、他のPanel宛ては先に送る)
+ */
+#define CAN_TX_BITRATE 500000
+#define CAN_TX_FRAME_BITS(dlc) (47 + 8 * (dlc)) // 標準フレーム+IFS(スタッフビット除く)
+#define CAN_TX_PEAK_WINDOW_US 100000
+
+/*
+ * 時刻同期: SYNCの送信完了をアラートで待つ
+ * (送信完了の時刻をFOLLOW_UPで送る。PanelはSYNCの受信割り込みの時刻と組にする)
+ */
+#define CAN_SYNC_ALERTS (CAN_ALERT_TX_SUCCESS | CAN_ALERT_TX_FAILED)
+
+/* 監視: 1s毎の区間の数、エラーパッシブの閾値 */
+#define CAN_HEALTH_SLOT_TICKS (1000 / configCAN_HEALTH_PERIOD_MS)
+#define CAN_HEALTH_ERR_PASSIVE 128
 
 /* CAN Driver Configure */
 #define TX_GPIO_NUM 25
@@ -61,6 +92,29 @@ static const can_general_config_t g_config =
 /* ESPLOGGER Configure */
 #define EXAMPLE_TAG "CAN Driver"
 
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 監視の1s毎の区間 */
+typedef struct CAN_HEALTH_SLOT
+{
+    uint32_t ulBusErrors;
+    uint32_t ulArbLost;
+    uint32_t ulTxFailed;
+    uint32_t ulRxMissed;
+    uint32_t ulTecPeak;
+    uint32_t ulRecPeak;
+} canHealthSlot_t;
+
+/* 配送確認: ACK待ちのフレーム(Panel毎に1つ) */
+typedef struct CAN_REL_TX
+{
+    can_message_t xMsg; // 送ったフレーム(再送は同じ番号のまま)
+    int64_t llDueUs;    // 次に送り直す時刻
+    uint8_t bTries;     // 再送した回数
+    uint8_t bActive;    // ACK待ち
+} canRelTx_t;
+
 /*****************************************************************************/
 /* Variable Definitions
 ******************************************************************************/
@@ -70,22 +124,88 @@ static const can_general_config_t g_config =
 TaskHandle_t xCanRxTask;
 TaskHandle_t xCanTxTask;
 
-// Queue
-QueueHandle_t xCanTxQueue = NULL;
+// Ring
+static ring_t xCanTxRing;
+static canCommMsg_t xCanTxRingBuf[QUEUE_CAN_TX_SIZE];
 
 // CAN
 uint32_t ulCanId;
 
+// 送信パイプライン(CAN_txタスクのみが書く、統計の読み出しはxCanStatsMuxで保護)
+static canPace_t xCanPace; // Panel毎の次に送れる時刻と間隔待ちのフレーム
+static canTxStats_t xCanTxStats;
+static int64_t llPeakWindowUs;
+static uint32_t ulPeakWindowFrames;
+static portMUX_TYPE xCanStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+ * Panel毎のCANプロトコルのバージョン(tb_canproto.h)
+ * CAN_rxタスクが返信の対応バージョンから書き、CAN_txタスクが読む(1byteなので排他しない)
+ * 起動時は全Panelがv1
+ */
+static volatile uint8_t bPanelProto[MAX_PANEL_NUM];
+static uint8_t bCanTxSeq;
+static uint8_t bCanPixelXfer; // LED毎の色の指示の番号(下位3bitを送る)
+static uint8_t bCanSyncSeq;
+
+// 受信統計(CAN_rxタスクが書く、読み出しはxCanStatsMuxで保護)
+static canRxStats_t xCanRxStats;
+
+/*
+ * 配送確認(tb_canproto.h)
+ * xRelTx    : CAN_txタスクが積んで再送し、ACKを受けたCAN_rxタスクが下ろす(xCanRelMuxで保護)
+ * bPanelFeat: Panelの機能(TBCAN_FEAT_*)。CAN_rxタスクが死活監視から書く(1byteなので排他しない)
+ * xCanTxLock: CAN_rxタスクが返すACKがSYNCの送信完了の待ちに混ざらないようにする
+ */
+static canRelTx_t xRelTx[MAX_PANEL_NUM];
+static canRelStats_t xCanRelStats;
+static volatile uint8_t bPanelFeat[MAX_PANEL_NUM];
+static portMUX_TYPE xCanRelMux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t xCanTxLock = NULL;
+
+// 監視(CAN_healthタスクが書く、ulTxDroppedはCAN_txタスク。xCanStatsMuxで保護)
+static canHealth_t xCanHealth;
+static canHealthSlot_t xCanHealthSlot[configCAN_HEALTH_WINDOW_S];
+
+/*
+ * パネルの死活(CAN_rxタスクが受信を書き、CAN_healthタスクが状態を更新する)
+ * 状態が変わる度にulLiveSeqを進める。xCanLiveMuxで保護
+ */
+static liveTbl_t xLiveTbl;
+static uint32_t ulLiveSeq;
+static portMUX_TYPE xCanLiveMux = portMUX_INITIALIZER_UNLOCKED;
+
 /*****************************************************************************/
 /* Function Prototypes
 ******************************************************************************/
 // Task
 static void prvCanRxTask(void *pvParameters);
 static void prvCanTxTask(void *pvParameters);
+static void prvCanHealthTask(void *pvParameters);
 
 // CAN Function
+static BOOL_t prvCanRxFrame(can_message_t *pxFrame, canCommMsg_t *pxMsg);
+static void prvCanTxCount(uint8_t bDlc, BOOL_t xBackpressure);
+static BOOL_t prvCanTimeSync(int64_t llNowUs, int64_t *pllReadyUs);
+static BOOL_t prvCanTimeSyncTx(void);
+static BOOL_t prvCanWaitTxDone(void);
+static uint8_t prvCanTxProto(uint32_t ulCanId);
+static uint8_t prvCanTxFeat(uint32_t ulCanId);
+static uint8_t prvCanEncodeAnim(const canCommMsg_t *pxMsg, uint8_t *pbData);
+static BOOL_t prvCanTransmit(can_message_t *pxMsg, uint32_t ulCanId);
+static void prvCanSendPixel(const canCommMsg_t *pxMsg);
+static void prvCanRelArm(const can_message_t *pxMsg);
+static int64_t prvCanRelRetry(void);
+static void prvCanRxAck(const can_message_t *pxMsg);
+static BOOL_t prvCanRxReliable(const canCommMsg_t *pxMsg);
+static void prvCanTxAck(uint8_t bPanelId, uint8_t bSeq);
+static uint32_t prvCanDelta(uint32_t ulNow, uint32_t ulLast);
+static eCanHealth_t prvCanHealthUpdate(const can_status_info_t *pxStatus, int64_t llDtUs);
+static void prvCanRxProto(const canCommMsg_t *pxMsg, uint8_t bCap);
+static void prvCanRxStatus(const can_message_t *pxMsg);
+static void prvCanLiveUpdate(int64_t llNowUs);
 void vCanSendWrapper(canCommMsg_t canMsg);
-void vCanMsgConv(can_message_t *canMsg, canCommMsg_t *canCommMsg);
+uint8_t bCanMsgConv(can_message_t *canMsg, canCommMsg_t *canCommMsg);
 
 /*****************************************************************************/
 /* Public Function
@@ -108,11 +228,19 @@ esp_err_t lInitCanFunction()
 
     // Install CAN driver
     ESP_ERROR_CHECK(can_driver_install(&g_config, &t_config, &f_config));
+    ESP_ERROR_CHECK(can_reconfigure_alerts(CAN_SYNC_ALERTS, NULL));
     ESP_LOGI(EXAMPLE_TAG, "Driver installed");
 
-    // Create Queue
-    xCanTxQueue = xQueueCreate(QUEUE_CAN_TX_SIZE, sizeof(canCommMsg_t));
-    configASSERT(xCanTxQueue);
+    vLiveTblInit(&xLiveTbl);
+    vCanPaceInit(&xCanPace, (int64_t)configCAN_PANEL_GAP_MS * 1000);
+
+    // Create Mutex
+    xCanTxLock = xSemaphoreCreateMutex();
+    configASSERT(xCanTxLock);
+
+    // Create Ring
+    vRingInit(&xCanTxRing, xCanTxRingBuf, QUEUE_CAN_TX_SIZE,
+              sizeof(canCommMsg_t), NULL, QUEUE_CAN_TX_POLICY, "xCanTxRing");
 
     // Create Task
     xStatus = xTaskCreatePinnedToCore(
@@ -129,6 +257,12 @@ esp_err_t lInitCanFunction()
     ESP_ERROR_CHECK(can_start());
     ESP_LOGI(EXAMPLE_TAG, "Driver started");
 
+    // 監視は開始後に動かす(STOPPEDを復帰待ちと見分けるため)
+    xStatus = xTaskCreatePinnedToCore(
+        prvCanHealthTask, "CAN_health", tskstacMAIN_CANTASK, NULL,
+        tskprioMAIN_CANHEALTHTASK, NULL, tskNO_AFFINITY);
+    configASSERT(xStatus);
+
     return (xStatus == pdPASS ? ESP_OK : ESP_FAIL);
 }
 
@@ -140,16 +274,325 @@ esp_err_t lInitCanFunction()
  *
  * @return   pdPASS / pdFAIL
  *
- * @note		##
+ * @note		CtrlTxタスクからのみ呼ぶこと(SPSC)
  *
  ******************************************************************************/
 BOOL_t xSendCanTxQueue(canCommMsg_t canTxMsg)
 {
     BOOL_t xStatus;
-    xStatus = xQueueSendToBack(xCanTxQueue, &canTxMsg, portMAX_DELAY);
+    xStatus = xRingSend(&xCanTxRing, &canTxMsg, QUEUE_CAN_TX_WAIT);
     return xStatus;
 }
 
+/*****************************************************************************/
+/**
+ * 全Panelへ問い合わせ(死活監視のフレームを返させる)
+ *
+ * @param    ##
+ *
+ * @return   pdPASS / pdFAIL
+ *
+ * @note		CtrlTxタスクからのみ呼ぶこと(SPSC)
+ *          v1のPanelは返さない(UNKNOWNのまま)
+ *
+ ******************************************************************************/
+BOOL_t xSendCanDiscover(void)
+{
+    canCommMsg_t canMsg = {};
+
+    canMsg.ulCanId = CAN_ID_GROUP_ALL;
+    canMsg.bCmd = TBCAN_CMD_DISCOVER;
+    return xSendCanTxQueue(canMsg);
+}
+
+/*****************************************************************************/
+/**
+ * 1フレームをそのまま送る
+ *
+ * @param    ulCanId: CAN ID
+ * @param    pbData / bDlc: 送信データ
+ *
+ * @return   pdPASS / pdFAIL(ドライバのTXキューが空かない)
+ *
+ * @note		CAN_fwタスクから呼ぶ(ファームウェアの配信)。CAN_txタスクの
+ *          送信リングを通さず、xCanTxLockで時刻同期の送信と混ざらないようにする。
+ *          フレームが多いので記録(util_rec)には残さない
+ *
+ ******************************************************************************/
+BOOL_t xCanSendFrame(uint32_t ulCanId, const uint8_t *pbData, uint8_t bDlc)
+{
+    can_message_t tx_msg = {.identifier = ulCanId, .flags = CAN_MSG_FLAG_NONE};
+    esp_err_t xErr;
+
+    tx_msg.data_length_code = MIN(bDlc, TBCAN_DLC);
+    memcpy(tx_msg.data, pbData, tx_msg.data_length_code);
+    xSemaphoreTake(xCanTxLock, portMAX_DELAY);
+    xErr = can_transmit(&tx_msg, pdMS_TO_TICKS(configCAN_TX_WAIT_MS));
+    xSemaphoreGive(xCanTxLock);
+
+    if (xErr != ESP_OK)
+    {
+        portENTER_CRITICAL(&xCanStatsMux);
+        xCanHealth.ulTxDropped++;
+        portEXIT_CRITICAL(&xCanStatsMux);
+        ESP_LOGW(EXAMPLE_TAG, "Frame dropped - ID = 0x%03x (%s)", ulCanId,
+                 esp_err_to_name(xErr));
+        return pdFAIL;
+    }
+    prvCanTxCount(tx_msg.data_length_code, pdFALSE);
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * パネル生成から外すパネル(死活監視で途絶えた／センサが踏まれたまま)
+ *
+ * @param    ##
+ *
+ * @return   uint32_t パネル(bit = PanelID)
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+uint32_t ulCanPanelExcludeMask(void)
+{
+    uint32_t ulMask;
+
+    portENTER_CRITICAL(&xCanLiveMux);
+    ulMask = xLiveTbl.ulExclude;
+    portEXIT_CRITICAL(&xCanLiveMux);
+    return ulMask;
+}
+
+/*****************************************************************************/
+/**
+ * 死活テーブルの取得
+ *
+ * @param    pxTbl: 格納先
+ *
+ * @return   uint32_t 更新番号(状態が変わる度に進む)
+ *
+ * @note     どのタスクから呼んでもよい。pxTbl == NULLなら更新番号だけ返す
+ *
+ ******************************************************************************/
+uint32_t ulCanGetLive(liveTbl_t *pxTbl)
+{
+    uint32_t ulSeq;
+
+    portENTER_CRITICAL(&xCanLiveMux);
+    if (pxTbl != NULL)
+        *pxTbl = xLiveTbl;
+    ulSeq = ulLiveSeq;
+    portEXIT_CRITICAL(&xCanLiveMux);
+    return ulSeq;
+}
+
+/*****************************************************************************/
+/**
+ * パネルの死活を記録(util_rec)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     エントリー時の状態を残すためctrl_mainからも呼ぶ
+ *
+ ******************************************************************************/
+void vCanRecLive(void)
+{
+    uint8_t bRecData[8];
+    uint32_t ulAlive;
+    uint32_t ulDead;
+    uint32_t ulStuck;
+
+    portENTER_CRITICAL(&xCanLiveMux);
+    ulAlive = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_ALIVE);
+    ulDead = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_DEAD);
+    ulStuck = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_STUCK);
+    portEXIT_CRITICAL(&xCanLiveMux);
+
+    // bData[0..3]: DEAD [4..7]: STUCK
+    memcpy(&bRecData[0], &ulDead, sizeof(ulDead));
+    memcpy(&bRecData[4], &ulStuck, sizeof(ulStuck));
+    vRecEvent(REC_LIVE, (uint8_t)__builtin_popcount(ulAlive), 0, bRecData,
+              sizeof(bRecData));
+}
+
+/*****************************************************************************/
+/**
+ * 送信統計の取得
+ *
+ * @param    pxStats: 格納先(起動からの累計)
+ *
+ * @return   ##
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+void vCanGetTxStats(canTxStats_t *pxStats)
+{
+    portENTER_CRITICAL(&xCanStatsMux);
+    *pxStats = xCanTxStats;
+    portEXIT_CRITICAL(&xCanStatsMux);
+    pxStats->llUs = esp_timer_get_time();
+}
+
+/*****************************************************************************/
+/**
+ * 配送確認の統計の取得
+ *
+ * @param    pxStats: 格納先(起動からの累計)
+ *
+ * @return   ##
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+void vCanGetRelStats(canRelStats_t *pxStats)
+{
+    portENTER_CRITICAL(&xCanStatsMux);
+    *pxStats = xCanRelStats;
+    portEXIT_CRITICAL(&xCanStatsMux);
+}
+
+/*****************************************************************************/
+/**
+ * 受信統計の取得
+ *
+ * @param    pxStats: 格納先(起動からの累計)
+ *
+ * @return   ##
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+void vCanGetRxStats(canRxStats_t *pxStats)
+{
+    portENTER_CRITICAL(&xCanStatsMux);
+    *pxStats = xCanRxStats;
+    portEXIT_CRITICAL(&xCanStatsMux);
+}
+
+/*****************************************************************************/
+/**
+ * CANの監視結果の取得
+ *
+ * @param    pxHealth: 格納先
+ *
+ * @return   ##
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+void vCanGetHealth(canHealth_t *pxHealth)
+{
+    portENTER_CRITICAL(&xCanStatsMux);
+    *pxHealth = xCanHealth;
+    portEXIT_CRITICAL(&xCanStatsMux);
+}
+
+/*****************************************************************************/
+/**
+ * CANの状態
+ *
+ * @param    ##
+ *
+ * @return   eCanHealth_t
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+eCanHealth_t eCanGetHealth(void)
+{
+    eCanHealth_t eHealth;
+
+    portENTER_CRITICAL(&xCanStatsMux);
+    eHealth = xCanHealth.eHealth;
+    portEXIT_CRITICAL(&xCanStatsMux);
+    return eHealth;
+}
+
+/*****************************************************************************/
+/**
+ * Panelへ送るCANプロトコルのバージョン
+ *
+ * @param    ulPanelId: PanelID
+ *
+ * @return   uint8_t TBCAN_VER_1 / TBCAN_VER_2
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint8_t bCanPanelProto(uint32_t ulPanelId)
+{
+    if (ulPanelId < PANEL_1 || ulPanelId >= MAX_PANEL_NUM || bPanelProto[ulPanelId] == 0)
+        return TBCAN_VER_1;
+    return bPanelProto[ulPanelId];
+}
+
+/*****************************************************************************/
+/**
+ * Panelが機能(TBCAN_FEAT_*)を持っているか
+ *
+ * @param    ulPanelMask: パネル(bit = PanelID)
+ * @param    bFeat: TBCAN_FEAT_*(複数なら全て)
+ *
+ * @return   pdTRUE: 全Panelが持っている / pdFALSE: 持っていないPanelがいる、パネルが無い
+ *
+ * @note     死活監視を返さないv1のPanelは何も持っていない
+ *
+ ******************************************************************************/
+BOOL_t xCanPanelsHaveFeat(uint32_t ulPanelMask, uint8_t bFeat)
+{
+    if (ulPanelMask == 0)
+        return pdFALSE;
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((ulPanelMask & (1UL << i)) != 0 && (bPanelFeat[i] & bFeat) != bFeat)
+            return pdFALSE;
+    }
+    return pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * 2回の取得の間のフレーム/s
+ *
+ * @param    pxFrom / pxTo: vCanGetTxStatsの結果
+ *
+ * @return   uint32_t フレーム/s
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulCanTxFps(const canTxStats_t *pxFrom, const canTxStats_t *pxTo)
+{
+    int64_t llUs = pxTo->llUs - pxFrom->llUs;
+    if (llUs <= 0)
+        return 0;
+    return (uint32_t)((int64_t)(pxTo->ulFrames - pxFrom->ulFrames) * 1000000 / llUs);
+}
+
+/*****************************************************************************/
+/**
+ * 2回の取得の間のバス負荷(Masterの送信分)
+ *
+ * @param    pxFrom / pxTo: vCanGetTxStatsの結果
+ *
+ * @return   uint32_t バス負荷[‰]
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulCanTxLoadPermil(const canTxStats_t *pxFrom, const canTxStats_t *pxTo)
+{
+    int64_t llUs = pxTo->llUs - pxFrom->llUs;
+    if (llUs <= 0)
+        return 0;
+    return (uint32_t)((int64_t)(pxTo->ullBits - pxFrom->ullBits) * 1000 * 1000000 /
+                      ((int64_t)CAN_TX_BITRATE * llUs));
+}
+
 /*****************************************************************************/
 /* Private Function
 ******************************************************************************/
@@ -157,6 +600,9 @@ BOOL_t xSendCanTxQueue(canCommMsg_t canTxMsg)
 /*****************************************************************************/
 /**
  * CANを受信するタスク。
+ * 1つ目のフレームを待ち、以降はドライバのRXキューに溜まっている分を
+ * 待たずにまとめて取り出して変換し、ctrl_mainへまとめて送る(起こすのは1回)。
+ * ログは整形せず診断ログ(util_diag)に残す。
  *
  * @param	pvParametersはNULLです。
  *
@@ -167,28 +613,46 @@ BOOL_t xSendCanTxQueue(canCommMsg_t canTxMsg)
  ******************************************************************************/
 static void prvCanRxTask(void *pvParameters)
 {
-    canCommMsg_t rxCanMsg;
+    static canCommMsg_t xRxBatch[configCAN_RX_BATCH];
     can_message_t rx_message;
+    TickType_t xWait;
+    uint32_t ulFrames;
+    uint32_t ulNum;
 
     ESP_LOGI(EXAMPLE_TAG, "RX_TASK started");
     for (;;)
     {
-        // Wait CAN Message
-        ESP_ERROR_CHECK(can_receive(&rx_message, portMAX_DELAY));
-        ESP_LOGI(EXAMPLE_TAG, "Msg received - ID = %d", rx_message.identifier);
-
-        // メッセージ形式を変換
-        vCanMsgConv(&rx_message, &rxCanMsg);
-        ESP_LOGI(EXAMPLE_TAG,
-                 "rxCanMsg = {.PanelID = %d, .BtnFlag = %d, .ColorInfo = R%d "
-                 "G%d B%d, "
-                 ".LightTime = %d}",
-                 rxCanMsg.bPanelId, rxCanMsg.bBtnFlag, rxCanMsg.bColorInfoR,
-                 rxCanMsg.bColorInfoG, rxCanMsg.bColorInfoB,
-                 rxCanMsg.bLightTime);
+        // Wait CAN Message (ドライバが止まっている間は監視タスクの復帰を待つ)
+        ulFrames = 0;
+        ulNum = 0;
+        xWait = portMAX_DELAY;
+        while (ulFrames < configCAN_RX_BATCH &&
+               can_receive(&rx_message, xWait) == ESP_OK)
+        {
+            ulFrames++;
+            xWait = 0;
+            if (prvCanRxFrame(&rx_message, &xRxBatch[ulNum]) == pdTRUE)
+                ulNum++;
+        }
+        if (ulFrames == 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(configCAN_HEALTH_PERIOD_MS));
+            continue;
+        }
 
         // ctrl_mainへ送信
-        xSendCtrlCanRxQueue(rxCanMsg);
+        if (ulNum > 0)
+            ulSendCtrlCanRxBatch(xRxBatch, ulNum);
+        if (ulFrames > 1)
+            vDiagEvent(DIAG_CAN_RX_BATCH, (uint8_t)ulFrames, (uint16_t)ulNum, NULL, 0);
+
+        portENTER_CRITICAL(&xCanStatsMux);
+        xCanRxStats.ulWakeups++;
+        xCanRxStats.ulFrames += ulFrames;
+        xCanRxStats.ulForwarded += ulNum;
+        if (ulFrames > xCanRxStats.ulBatchMax)
+            xCanRxStats.ulBatchMax = ulFrames;
+        portEXIT_CRITICAL(&xCanStatsMux);
     }
 }
 
@@ -206,49 +670,1011 @@ static void prvCanRxTask(void *pvParameters)
 static void prvCanTxTask(void *pvParameters)
 {
     canCommMsg_t txCanMsg;
+    int64_t llSyncUs = esp_timer_get_time();
+    int64_t llNowUs;
+    int64_t llWakeUs;
+    int64_t llReadyUs;
+    uint32_t ulHoldMask = 0; // 間隔待ちの時刻同期の宛先(後から来たフレームに追い越させない)
+    TickType_t xWait;
+    BOOL_t xSynced;
 
     ESP_LOGI(EXAMPLE_TAG, "TX_TASK started");
     for (;;)
     {
-        // Wait Queue notification
-        xQueueReceive(xCanTxQueue, &txCanMsg, QUEUE_CAN_TX_WAIT);
+        llWakeUs = INT64_MAX;
+
+        // 時刻同期(送信の合間に周期的に送る。全Panelが受け取れるまでは延ばす)
+        if (configTIME_SYNC_PERIOD_MS > 0)
+        {
+            llNowUs = esp_timer_get_time();
+            if (llNowUs >= llSyncUs)
+            {
+                xSynced = prvCanTimeSync(llNowUs, &llReadyUs);
+                if (llReadyUs > llNowUs)
+                {
+                    if (ulHoldMask == 0)
+                    {
+                        portENTER_CRITICAL(&xCanStatsMux);
+                        xCanTxStats.ulPaced++;
+                        portEXIT_CRITICAL(&xCanStatsMux);
+                    }
+                    ulHoldMask = ulGroupPanelMask(CAN_ID_GROUP_ALL);
+                    llSyncUs = llReadyUs;
+                }
+                else
+                {
+                    ulHoldMask = 0;
+                    portENTER_CRITICAL(&xCanStatsMux);
+                    if (xSynced == pdTRUE)
+                        xCanTxStats.ulSync++;
+                    else
+                        xCanTxStats.ulSyncSkipped++;
+                    portEXIT_CRITICAL(&xCanStatsMux);
+                    llSyncUs = llNowUs + (int64_t)configTIME_SYNC_PERIOD_MS * 1000;
+                }
+            }
+            llWakeUs = llSyncUs;
+        }
+
+        // 配送確認(ACKの来ないフレームを送り直す)
+        llWakeUs = MIN(llWakeUs, prvCanRelRetry());
+
+        // 間隔待ちで取っておいたフレームを、宛先が受け取れるようになった順に送る
+        while (xCanPacePop(&xCanPace, ulHoldMask, esp_timer_get_time(), &txCanMsg) == pdTRUE)
+            vCanSendWrapper(txCanMsg);
+        llWakeUs = MIN(llWakeUs, llCanPaceNextUs(&xCanPace, ulHoldMask));
+
+        xWait = QUEUE_CAN_TX_WAIT;
+        if (llWakeUs != INT64_MAX)
+        {
+            llNowUs = esp_timer_get_time();
+            xWait = llWakeUs > llNowUs ? pdMS_TO_TICKS((llWakeUs - llNowUs + 999) / 1000) : 0;
+        }
+
+        // 取っておく場所が無ければ取り出さない(xCanTxRing経由でCtrlTxタスクへ背圧)
+        if (xCanPaceFull(&xCanPace) == pdTRUE)
+        {
+            vTaskDelay(xWait);
+            continue;
+        }
+
+        // Wait Ring notification
+        if (xRingReceive(&xCanTxRing, &txCanMsg, xWait) != pdPASS)
+            continue;
+        vTracePoint(TP_CAN_TX_DEQ, txCanMsg.ulCanId);
+
+        // 宛先Panelが受け取れなければ取っておく(他のPanel宛ては待たない)
+        if (xCanPaceSubmit(&xCanPace, &txCanMsg, ulHoldMask, esp_timer_get_time()) != pdTRUE)
+        {
+            portENTER_CRITICAL(&xCanStatsMux);
+            xCanTxStats.ulPaced++;
+            portEXIT_CRITICAL(&xCanStatsMux);
+            continue;
+        }
 
         // Panelへ送信
         vCanSendWrapper(txCanMsg);
     }
 }
 
+/*****************************************************************************/
+/**
+ * CANの監視タスク
+ * can_get_status_info()を周期的に見て、バスオフなら復帰させる。
+ * 復帰(128 x 11ビットのレセッシブ)が終わるとSTOPPEDになるので、can_start()で再開する。
+ *
+ * @param	pvParametersはNULLです。
+ *
+ * @return  ##
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+static void prvCanHealthTask(void *pvParameters)
+{
+    can_status_info_t xStatus;
+    eCanHealth_t eHealth = CAN_HEALTH_OK;
+    eCanHealth_t eLast = CAN_HEALTH_OK;
+    BOOL_t xRecovering = pdFALSE;
+    int64_t llLastUs = esp_timer_get_time();
+    int64_t llNowUs;
+
+    ESP_LOGI(EXAMPLE_TAG, "HEALTH_TASK started");
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(configCAN_HEALTH_PERIOD_MS));
+        if (can_get_status_info(&xStatus) != ESP_OK)
+            continue;
+
+        switch (xStatus.state)
+        {
+        case CAN_STATE_BUS_OFF:
+            if (can_initiate_recovery() == ESP_OK)
+            {
+                ESP_LOGE(EXAMPLE_TAG, "Bus-off | tec:%u rec:%u, start recovery",
+                         xStatus.tx_error_counter, xStatus.rx_error_counter);
+                xRecovering = pdTRUE;
+                portENTER_CRITICAL(&xCanStatsMux);
+                xCanHealth.ulBusOff++;
+                portEXIT_CRITICAL(&xCanStatsMux);
+            }
+            break;
+        case CAN_STATE_STOPPED:
+            if (xRecovering == pdTRUE && can_start() == ESP_OK)
+            {
+                ESP_LOGW(EXAMPLE_TAG, "Recovered from bus-off");
+                xRecovering = pdFALSE;
+                xStatus.state = CAN_STATE_RUNNING;
+                portENTER_CRITICAL(&xCanStatsMux);
+                xCanHealth.ulRecovered++;
+                portEXIT_CRITICAL(&xCanStatsMux);
+            }
+            break;
+        default:
+            break;
+        }
+
+        llNowUs = esp_timer_get_time();
+        prvCanLiveUpdate(llNowUs);
+        eHealth = prvCanHealthUpdate(&xStatus, llNowUs - llLastUs);
+        llLastUs = llNowUs;
+        if (eHealth != eLast)
+        {
+            ESP_LOGW(EXAMPLE_TAG, "Health %d -> %d | tec:%u rec:%u", eLast, eHealth,
+                     xStatus.tx_error_counter, xStatus.rx_error_counter);
+            eLast = eHealth;
+        }
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 監視結果の更新
+ * ドライバの累計カウンタの差を1s毎の区間に足し、直近の合計／最大を求める。
+ *
+ * @param	pxStatus: can_get_status_info()の結果
+ * @param   llDtUs: 前回からの時間[us]
+ *
+ * @return  eCanHealth_t 今回の状態
+ *
+ * @note    CAN_healthタスクから呼ぶ
+ *
+ ******************************************************************************/
+static eCanHealth_t prvCanHealthUpdate(const can_status_info_t *pxStatus, int64_t llDtUs)
+{
+    static can_status_info_t xLast;
+    static uint32_t ulSlot;
+    static uint32_t ulSlotTicks;
+    canHealthSlot_t *pxSlot;
+    canHealthSlot_t xSum = {};
+    eCanHealth_t eHealth;
+
+    // 1s毎に次の区間へ(一番古い区間を捨てる)
+    if (++ulSlotTicks >= CAN_HEALTH_SLOT_TICKS)
+    {
+        ulSlotTicks = 0;
+        ulSlot = (ulSlot + 1) % configCAN_HEALTH_WINDOW_S;
+        memset(&xCanHealthSlot[ulSlot], 0, sizeof(canHealthSlot_t));
+    }
+    pxSlot = &xCanHealthSlot[ulSlot];
+    pxSlot->ulBusErrors += prvCanDelta(pxStatus->bus_error_count, xLast.bus_error_count);
+    pxSlot->ulArbLost += prvCanDelta(pxStatus->arb_lost_count, xLast.arb_lost_count);
+    pxSlot->ulTxFailed += prvCanDelta(pxStatus->tx_failed_count, xLast.tx_failed_count);
+    pxSlot->ulRxMissed += prvCanDelta(pxStatus->rx_missed_count, xLast.rx_missed_count);
+    pxSlot->ulTecPeak = MAX(pxSlot->ulTecPeak, pxStatus->tx_error_counter);
+    pxSlot->ulRecPeak = MAX(pxSlot->ulRecPeak, pxStatus->rx_error_counter);
+    xLast = *pxStatus;
+
+    for (uint32_t i = 0; i < configCAN_HEALTH_WINDOW_S; i++)
+    {
+        xSum.ulBusErrors += xCanHealthSlot[i].ulBusErrors;
+        xSum.ulArbLost += xCanHealthSlot[i].ulArbLost;
+        xSum.ulTxFailed += xCanHealthSlot[i].ulTxFailed;
+        xSum.ulRxMissed += xCanHealthSlot[i].ulRxMissed;
+        xSum.ulTecPeak = MAX(xSum.ulTecPeak, xCanHealthSlot[i].ulTecPeak);
+        xSum.ulRecPeak = MAX(xSum.ulRecPeak, xCanHealthSlot[i].ulRecPeak);
+    }
+
+    if (pxStatus->state != CAN_STATE_RUNNING)
+        eHealth = CAN_HEALTH_DOWN;
+    else if (pxStatus->tx_error_counter >= CAN_HEALTH_ERR_PASSIVE ||
+             pxStatus->rx_error_counter >= CAN_HEALTH_ERR_PASSIVE || xSum.ulBusErrors > 0 ||
+             xSum.ulTxFailed > 0)
+        eHealth = CAN_HEALTH_WARN;
+    else
+        eHealth = CAN_HEALTH_OK;
+
+    portENTER_CRITICAL(&xCanStatsMux);
+    if (xCanHealth.eHealth == CAN_HEALTH_DOWN)
+        xCanHealth.llDownUs += llDtUs;
+    xCanHealth.eHealth = eHealth;
+    xCanHealth.ulTec = pxStatus->tx_error_counter;
+    xCanHealth.ulRec = pxStatus->rx_error_counter;
+    xCanHealth.ulTecPeak = xSum.ulTecPeak;
+    xCanHealth.ulRecPeak = xSum.ulRecPeak;
+    xCanHealth.ulBusErrors = xSum.ulBusErrors;
+    xCanHealth.ulArbLost = xSum.ulArbLost;
+    xCanHealth.ulTxFailed = xSum.ulTxFailed;
+    xCanHealth.ulRxMissed = xSum.ulRxMissed;
+    portEXIT_CRITICAL(&xCanStatsMux);
+
+    return eHealth;
+}
+
+/* ドライバの累計カウンタの差(ドライバの再インストールで0に戻ったときは今の値) */
+static uint32_t prvCanDelta(uint32_t ulNow, uint32_t ulLast)
+{
+    return ulNow >= ulLast ? ulNow - ulLast : ulNow;
+}
+
+/*****************************************************************************/
+/**
+ * 受信した1フレームの処理
+ *
+ * @param	pxFrame: 受信したフレーム
+ * @param   pxMsg: ctrl_mainへ送るメッセージの格納先
+ *
+ * @return  pdTRUE: ctrl_mainへ送る / pdFALSE: 送らない
+ *          (死活監視、ACK、不明なフレーム、重複)
+ *
+ * @note    CAN_rxタスクから呼ぶこと
+ *
+ ******************************************************************************/
+static BOOL_t prvCanRxFrame(can_message_t *pxFrame, canCommMsg_t *pxMsg)
+{
+    uint8_t bCap;
+    uint8_t bInfo[5];
+
+    vRecEvent(REC_CAN_RX, pxFrame->data_length_code,
+              (uint16_t)pxFrame->identifier, pxFrame->data,
+              sizeof(pxFrame->data));
+    vDiagEvent(DIAG_CAN_RX, pxFrame->data_length_code,
+               (uint16_t)pxFrame->identifier, pxFrame->data,
+               sizeof(pxFrame->data));
+
+    // 死活監視はctrl_mainへ送らない
+    if (TBCAN_ID_IS_STATUS(pxFrame->identifier))
+    {
+        prvCanRxStatus(pxFrame);
+        return pdFALSE;
+    }
+
+    // ファームウェア配信の応答はCAN_fwタスクへ
+    if (TBCAN_ID_IS_FW_REPLY(pxFrame->identifier))
+    {
+        vCanFwRxReply(pxFrame->identifier, pxFrame->data, pxFrame->data_length_code);
+        return pdFALSE;
+    }
+
+    // 配送確認のACKもctrl_mainへ送らない
+    if (bTbCanDecodeCtrl(pxFrame->data, pxFrame->data_length_code) == TBCAN_CMD_ACK)
+    {
+        prvCanRxAck(pxFrame);
+        return pdFALSE;
+    }
+
+    // メッセージ形式を変換
+    bCap = bCanMsgConv(pxFrame, pxMsg);
+    if (pxMsg->bProto == 0)
+    {
+        ESP_LOGE(EXAMPLE_TAG, "Unknown frame | ID:%d DLC:%d data[0]:0x%02x",
+                 pxFrame->identifier, pxFrame->data_length_code,
+                 pxFrame->data[0]);
+        return pdFALSE;
+    }
+    prvCanRxProto(pxMsg, bCap);
+
+    // ACKを返し、重複(ACKが失われた再送など)は捨てる
+    if (prvCanRxReliable(pxMsg) != pdTRUE)
+        return pdFALSE;
+    vTracePoint(TP_CAN_RX, pxMsg->bPanelId);
+
+    bInfo[0] = pxMsg->bBtnFlag;
+    bInfo[1] = pxMsg->bColorInfoR;
+    bInfo[2] = pxMsg->bColorInfoG;
+    bInfo[3] = pxMsg->bColorInfoB;
+    bInfo[4] = pxMsg->bProto;
+    vDiagEvent(DIAG_CAN_RX_MSG, pxMsg->bPanelId, pxMsg->bSeq, bInfo, sizeof(bInfo));
+    return pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * 送信統計の更新
+ *
+ * @param	bDlc: 送信したフレームのDLC
+ * @param   xBackpressure: ドライバのTXキューが埋まっていた
+ *
+ * @return  ##
+ *
+ * @note    CAN_txタスク、CAN_rxタスク(ACK)から呼ぶ
+ *
+ ******************************************************************************/
+static void prvCanTxCount(uint8_t bDlc, BOOL_t xBackpressure)
+{
+    int64_t llNowUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&xCanStatsMux);
+    xCanTxStats.ulFrames++;
+    xCanTxStats.ullBits += CAN_TX_FRAME_BITS(bDlc);
+    if (xBackpressure)
+        xCanTxStats.ulBackpressure++;
+    if (llNowUs - llPeakWindowUs >= CAN_TX_PEAK_WINDOW_US)
+    {
+        llPeakWindowUs = llNowUs;
+        ulPeakWindowFrames = 0;
+    }
+    ulPeakWindowFrames++;
+    if (ulPeakWindowFrames * (1000000 / CAN_TX_PEAK_WINDOW_US) > xCanTxStats.ulPeakFps)
+        xCanTxStats.ulPeakFps = ulPeakWindowFrames * (1000000 / CAN_TX_PEAK_WINDOW_US);
+    portEXIT_CRITICAL(&xCanStatsMux);
+}
+
+/*****************************************************************************/
+/**
+ * 時刻同期(SYNC + FOLLOW_UP)を全体宛てに送る
+ * SYNCの送信完了(アラート)の時刻を控え、続くFOLLOW_UPで送る。
+ * PanelはSYNCの受信割り込みの時刻と組にして自分の時計を合わせる(tb_timesync.h)。
+ *
+ * @param	llNowUs: 現在時刻[us]
+ * @param   pllReadyUs: 全Panelが受け取れる時刻[us]の格納先
+ *          (llNowUsより後なら送らずに戻るので、その時刻に呼び直す)
+ *
+ * @return  pdTRUE: 送った / pdFALSE: 送らなかった
+ *
+ * @note    CAN_txタスクから呼ぶ。v1のPanelにはデモ点灯に見えるので、
+ *          全Panelがv2のときだけ送る。
+ *          他のフレームの送信完了と見分けるため、TXキューが空になってから送る
+ *          (CAN_rxタスクのACKはxCanTxLockで止める)。
+ *
+ ******************************************************************************/
+static BOOL_t prvCanTimeSync(int64_t llNowUs, int64_t *pllReadyUs)
+{
+    BOOL_t xSynced;
+
+    *pllReadyUs = 0;
+    if (prvCanTxProto(CAN_ID_GROUP_ALL) < TBCAN_VER_2 ||
+        eCanGetHealth() != CAN_HEALTH_OK)
+    {
+        return pdFALSE;
+    }
+
+    // 全Panelが受け取れるまで延ばす(待たない)
+    if (xCanPaceTake(&xCanPace, CAN_ID_GROUP_ALL, llNowUs, pllReadyUs) != pdTRUE)
+        return pdFALSE;
+
+    xSemaphoreTake(xCanTxLock, portMAX_DELAY);
+    xSynced = prvCanTimeSyncTx();
+    xSemaphoreGive(xCanTxLock);
+    return xSynced;
+}
+
+/* SYNC + FOLLOW_UPの送信(xCanTxLockを取って呼ぶ) */
+static BOOL_t prvCanTimeSyncTx(void)
+{
+    can_message_t tx_msg = {.identifier = CAN_ID_GROUP_ALL,
+                            .flags = CAN_MSG_FLAG_NONE};
+    uint32_t ulAlerts = 0;
+    int64_t llDoneUs;
+
+    // 送信中のフレームを送り切る
+    if (prvCanWaitTxDone() != pdTRUE)
+        return pdFALSE;
+
+    // SYNC: 送信完了の時刻を控える
+    can_read_alerts(&ulAlerts, 0);
+    tx_msg.data_length_code =
+        bTbCanEncodeSync(TBCAN_CMD_SYNC, bCanSyncSeq, 0, tx_msg.data);
+    if (can_transmit(&tx_msg, 0) != ESP_OK)
+        return pdFALSE;
+    do
+    {
+        if (can_read_alerts(&ulAlerts, pdMS_TO_TICKS(configCAN_TX_WAIT_MS)) != ESP_OK)
+            return pdFALSE;
+    } while ((ulAlerts & CAN_SYNC_ALERTS) == 0);
+    llDoneUs = esp_timer_get_time();
+    if ((ulAlerts & CAN_ALERT_TX_FAILED) != 0)
+        return pdFALSE;
+    prvCanTxCount(tx_msg.data_length_code, pdFALSE);
+
+    // FOLLOW_UP: SYNCの送信完了の時刻
+    tx_msg.data_length_code = bTbCanEncodeSync(TBCAN_CMD_FOLLOW_UP, bCanSyncSeq,
+                                               (uint32_t)llDoneUs, tx_msg.data);
+    if (can_transmit(&tx_msg, pdMS_TO_TICKS(configCAN_TX_WAIT_MS)) != ESP_OK)
+        return pdFALSE;
+    prvCanTxCount(tx_msg.data_length_code, pdFALSE);
+    vRecEvent(REC_SYNC, bCanSyncSeq, 0, &llDoneUs, sizeof(uint32_t));
+    ESP_LOGD(EXAMPLE_TAG, "Time sync %d | %lld", bCanSyncSeq, (long long)llDoneUs);
+    bCanSyncSeq++;
+    return pdTRUE;
+}
+
+/* ドライバのTXキューが空になるまで待つ(pdFALSE: configCAN_TX_WAIT_MS待っても空かない) */
+static BOOL_t prvCanWaitTxDone(void)
+{
+    can_status_info_t xStatus;
+    uint32_t ulAlerts;
+
+    for (;;)
+    {
+        if (can_get_status_info(&xStatus) != ESP_OK)
+            return pdFALSE;
+        if (xStatus.msgs_to_tx == 0)
+            return pdTRUE;
+        if (can_read_alerts(&ulAlerts, pdMS_TO_TICKS(configCAN_TX_WAIT_MS)) != ESP_OK)
+            return pdFALSE;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 送信するフレームのCANプロトコルのバージョン
+ * グループ宛ては含まれる全Panelが対応しているバージョン
+ *
+ * @param	ulCanId: 送信先のCAN ID
+ *
+ * @return  uint8_t TBCAN_VER_1 / TBCAN_VER_2
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+static uint8_t prvCanTxProto(uint32_t ulCanId)
+{
+    uint32_t ulMask = ulGroupPanelMask(ulCanId);
+    uint8_t bVer = configCAN_PROTO_MAX;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((ulMask & (1UL << i)) != 0 && bCanPanelProto(i) < bVer)
+            bVer = bCanPanelProto(i);
+    }
+    return bVer;
+}
+
+/*****************************************************************************/
+/**
+ * 送信先のPanelの機能(TBCAN_FEAT_*)
+ * グループ宛ては含まれる全Panelが持つ機能
+ *
+ * @param	ulCanId: 送信先のCAN ID
+ *
+ * @return  uint8_t TBCAN_FEAT_*
+ *
+ * @note    死活監視を返さないv1のPanelは0
+ *
+ ******************************************************************************/
+static uint8_t prvCanTxFeat(uint32_t ulCanId)
+{
+    uint32_t ulMask = ulGroupPanelMask(ulCanId);
+    uint8_t bFeat = 0xFF;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((ulMask & (1UL << i)) != 0)
+            bFeat &= bPanelFeat[i];
+    }
+    return ulMask != 0 ? bFeat : 0;
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションのフレームを作る
+ *
+ * @param	pxMsg: 送るメッセージ(bCmd = TBCAN_CMD_ANIM)
+ * @param   pbData: 出力(TBCAN_DLC byte)
+ *
+ * @return  uint8_t DLC
+ *
+ * @note    色はパレットの番号で送る(パレットに無い色はWHITE)。
+ *          開始時刻はPanelの時刻同期と同じ64us単位の下位16bit(±2sまで)
+ *
+ ******************************************************************************/
+static uint8_t prvCanEncodeAnim(const canCommMsg_t *pxMsg, uint8_t *pbData)
+{
+    tbCanAnim_t xAnim = {.bAnim = pxMsg->bAnim,
+                         .bColor = bTbCanPaletteFind(pxMsg->bColorInfoR, pxMsg->bColorInfoG,
+                                                     pxMsg->bColorInfoB),
+                         .usPeriodMs = pxMsg->usAnimPeriodMs,
+                         .usDurationMs = pxMsg->usLightTimeMs,
+                         .bTimed = pxMsg->llAnimStartUs != 0,
+                         .usStartTick = (uint16_t)(pxMsg->llAnimStartUs >> TBCAN_TIME_TICK_SHIFT)};
+
+    if (xAnim.bColor >= TBCAN_PALETTE_NUM)
+        xAnim.bColor = 1; // WHITE
+    return bTbCanEncodeAnim(&xAnim, pbData);
+}
+
+/*****************************************************************************/
+/**
+ * ACK待ちへ積む
+ *
+ * @param	pxMsg: ACK要求を付けて送ったフレーム(Panel宛て)
+ *
+ * @return  ##
+ *
+ * @note    CAN_txタスクから呼ぶ。ACK待ちが残っていれば新しいフレームで置き換える
+ *
+ ******************************************************************************/
+static void prvCanRelArm(const can_message_t *pxMsg)
+{
+    canRelTx_t *pxRel = &xRelTx[pxMsg->identifier];
+
+    portENTER_CRITICAL(&xCanRelMux);
+    pxRel->xMsg = *pxMsg;
+    pxRel->llDueUs = esp_timer_get_time() + (int64_t)configCAN_REL_ACK_MS * 1000;
+    pxRel->bTries = 0;
+    pxRel->bActive = 1;
+    portEXIT_CRITICAL(&xCanRelMux);
+
+    portENTER_CRITICAL(&xCanStatsMux);
+    xCanRelStats.ulSent++;
+    portEXIT_CRITICAL(&xCanStatsMux);
+}
+
+/*****************************************************************************/
+/**
+ * ACKの来ないフレームを送り直す
+ * 待つ時間は再送毎に倍にする(Panelが点灯中で読めない間を避ける)。
+ * configCAN_REL_RETRY_MAX回送り直してもACKが無ければ諦める。
+ *
+ * @param	##
+ *
+ * @return  int64_t 次に送り直す時刻[us](INT64_MAX: ACK待ちなし)
+ *
+ * @note    CAN_txタスクから呼ぶ
+ *
+ ******************************************************************************/
+static int64_t prvCanRelRetry(void)
+{
+    int64_t llNowUs = esp_timer_get_time();
+    int64_t llNextUs = INT64_MAX;
+    int64_t llDueUs;
+    int64_t llReadyUs;
+    can_message_t tx_msg;
+    uint8_t bTries;
+    BOOL_t xActive;
+    esp_err_t xErr;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        portENTER_CRITICAL(&xCanRelMux);
+        xActive = xRelTx[i].bActive ? pdTRUE : pdFALSE;
+        llDueUs = xRelTx[i].llDueUs;
+        bTries = xRelTx[i].bTries;
+        tx_msg = xRelTx[i].xMsg;
+        if (xActive && llDueUs <= llNowUs && bTries >= configCAN_REL_RETRY_MAX)
+            xRelTx[i].bActive = 0;
+        portEXIT_CRITICAL(&xCanRelMux);
+
+        if (xActive != pdTRUE)
+            continue;
+        if (llDueUs > llNowUs)
+        {
+            llNextUs = MIN(llNextUs, llDueUs);
+            continue;
+        }
+        if (bTries >= configCAN_REL_RETRY_MAX)
+        {
+            ESP_LOGW(EXAMPLE_TAG, "No ACK - ID = %d seq:%d, give up", tx_msg.identifier,
+                     tx_msg.data[2]);
+            portENTER_CRITICAL(&xCanStatsMux);
+            xCanRelStats.ulGiveUp++;
+            portEXIT_CRITICAL(&xCanStatsMux);
+            continue;
+        }
+
+        // 同じ番号で送り直す(受けていたPanelはACKだけ返す)
+        // 宛先Panelの間隔待ちの間は、受け取れる時刻に見直す(他のPanel宛ては待たない)
+        if (xCanPaceTake(&xCanPace, tx_msg.identifier, llNowUs, &llReadyUs) != pdTRUE)
+        {
+            llNextUs = MIN(llNextUs, llReadyUs);
+            continue;
+        }
+        xErr = can_transmit(&tx_msg, pdMS_TO_TICKS(configCAN_TX_WAIT_MS));
+        portENTER_CRITICAL(&xCanStatsMux);
+        if (xErr == ESP_OK)
+            xCanRelStats.ulRetry++;
+        else
+            xCanHealth.ulTxDropped++;
+        portEXIT_CRITICAL(&xCanStatsMux);
+        if (xErr == ESP_OK)
+        {
+            prvCanTxCount(tx_msg.data_length_code, pdFALSE);
+            vRecEvent(REC_CAN_TX, tx_msg.data_length_code, (uint16_t)tx_msg.identifier,
+                      tx_msg.data, sizeof(tx_msg.data));
+            vDiagEvent(DIAG_CAN_RETRY, (uint8_t)i, tx_msg.data[2], &bTries, 1);
+        }
+
+        llDueUs = esp_timer_get_time() + ((int64_t)configCAN_REL_ACK_MS * 1000 << (bTries + 1));
+        portENTER_CRITICAL(&xCanRelMux);
+        if (xRelTx[i].bActive)
+        {
+            xRelTx[i].bTries = bTries + 1;
+            xRelTx[i].llDueUs = llDueUs;
+        }
+        portEXIT_CRITICAL(&xCanRelMux);
+        llNextUs = MIN(llNextUs, llDueUs);
+    }
+    return llNextUs;
+}
+
+/*****************************************************************************/
+/**
+ * ACKを受けた
+ *
+ * @param	pxMsg: 受信したフレーム(TBCAN_CMD_ACK)
+ *
+ * @return  ##
+ *
+ * @note    CAN_rxタスクから呼ぶ。番号の違うACK(諦めた後、置き換えた前のフレーム)は見ない
+ *
+ ******************************************************************************/
+static void prvCanRxAck(const can_message_t *pxMsg)
+{
+    uint8_t bPanelId;
+    uint8_t bSeq;
+    BOOL_t xAcked = pdFALSE;
+
+    vTbCanDecodeAck(pxMsg->data, &bPanelId, &bSeq);
+    if (bPanelId < PANEL_1 || bPanelId >= MAX_PANEL_NUM)
+        return;
+
+    portENTER_CRITICAL(&xCanRelMux);
+    if (xRelTx[bPanelId].bActive && xRelTx[bPanelId].xMsg.data[2] == bSeq)
+    {
+        xRelTx[bPanelId].bActive = 0;
+        xAcked = pdTRUE;
+    }
+    portEXIT_CRITICAL(&xCanRelMux);
+
+    if (xAcked == pdTRUE)
+    {
+        portENTER_CRITICAL(&xCanStatsMux);
+        xCanRelStats.ulAcked++;
+        portEXIT_CRITICAL(&xCanStatsMux);
+    }
+    ESP_LOGD(EXAMPLE_TAG, "ACK received - Panel = %d seq:%d%s", bPanelId, bSeq,
+             xAcked == pdTRUE ? "" : " (stale)");
+}
+
+/*****************************************************************************/
+/**
+ * 返信の配送確認
+ * ACK要求があればACKを返し、同じPanelから同じ番号が続いたら重複として捨てる。
+ *
+ * @param	pxMsg: 受信したメッセージ
+ *
+ * @return  pdTRUE: ctrl_mainへ送る / pdFALSE: 重複
+ *
+ * @note    CAN_rxタスクから呼ぶ。番号はMasterが送ったフレームの番号なので
+ *          v2の返信のみ見る(v1は常に0)
+ *
+ ******************************************************************************/
+static BOOL_t prvCanRxReliable(const canCommMsg_t *pxMsg)
+{
+    static uint8_t bRxSeq[MAX_PANEL_NUM];
+    static int64_t llRxSeqUs[MAX_PANEL_NUM]; // 0: まだ受けていない
+    int64_t llNowUs = esp_timer_get_time();
+    uint8_t bPanelId = pxMsg->bPanelId;
+
+    if (pxMsg->bProto < TBCAN_VER_2 || bPanelId < PANEL_1 || bPanelId >= MAX_PANEL_NUM)
+        return pdTRUE;
+    if (pxMsg->bReliable)
+        prvCanTxAck(bPanelId, pxMsg->bSeq);
+
+    if (llRxSeqUs[bPanelId] != 0 && bRxSeq[bPanelId] == pxMsg->bSeq &&
+        llNowUs - llRxSeqUs[bPanelId] < (int64_t)configCAN_REL_DUP_MS * 1000)
+    {
+        vDiagEvent(DIAG_CAN_RX_DUP, bPanelId, pxMsg->bSeq, NULL, 0);
+        portENTER_CRITICAL(&xCanStatsMux);
+        xCanRelStats.ulDup++;
+        portEXIT_CRITICAL(&xCanStatsMux);
+        return pdFALSE;
+    }
+    bRxSeq[bPanelId] = pxMsg->bSeq;
+    llRxSeqUs[bPanelId] = llNowUs;
+    return pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * PanelへACKを返す
+ *
+ * @param	bPanelId: 返信してきたPanel
+ * @param   bSeq: 返信の番号
+ *
+ * @return  ##
+ *
+ * @note    CAN_rxタスクから呼ぶ。Panelは返信の後ACKを待っているので間隔待ちはしない
+ *
+ ******************************************************************************/
+static void prvCanTxAck(uint8_t bPanelId, uint8_t bSeq)
+{
+    can_message_t tx_msg = {.identifier = bPanelId, .flags = CAN_MSG_FLAG_NONE};
+    esp_err_t xErr;
+
+    tx_msg.data_length_code = bTbCanEncodeAck(bPanelId, bSeq, tx_msg.data);
+    xSemaphoreTake(xCanTxLock, portMAX_DELAY);
+    xErr = can_transmit(&tx_msg, pdMS_TO_TICKS(configCAN_TX_WAIT_MS));
+    xSemaphoreGive(xCanTxLock);
+
+    portENTER_CRITICAL(&xCanStatsMux);
+    if (xErr == ESP_OK)
+        xCanRelStats.ulAckTx++;
+    else
+        xCanHealth.ulTxDropped++;
+    portEXIT_CRITICAL(&xCanStatsMux);
+    if (xErr != ESP_OK)
+    {
+        ESP_LOGW(EXAMPLE_TAG, "ACK dropped - ID = %d (%s)", tx_msg.identifier,
+                 esp_err_to_name(xErr));
+        return;
+    }
+    prvCanTxCount(tx_msg.data_length_code, pdFALSE);
+    vRecEvent(REC_CAN_TX, tx_msg.data_length_code, (uint16_t)tx_msg.identifier,
+              tx_msg.data, sizeof(tx_msg.data));
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを受けた
+ *
+ * @param	pxMsg: 受信したフレーム(CAN ID 0x100 + PanelID)
+ *
+ * @return  ##
+ *
+ * @note    CAN_rxタスクから呼ぶ。対応バージョンも更新する
+ *
+ ******************************************************************************/
+static void prvCanRxStatus(const can_message_t *pxMsg)
+{
+    tbCanStatus_t xStatus;
+    canCommMsg_t xProto = {};
+    BOOL_t xHeard;
+
+    if (bTbCanDecodeStatus(pxMsg->data, pxMsg->data_length_code, &xStatus) == 0 ||
+        xStatus.bPanelId != (pxMsg->identifier & TBCAN_ID_MASK))
+    {
+        ESP_LOGE(EXAMPLE_TAG, "Bad status frame | ID:%d data[0]:0x%02x",
+                 pxMsg->identifier, pxMsg->data[0]);
+        return;
+    }
+
+    portENTER_CRITICAL(&xCanLiveMux);
+    xHeard = (xLiveTbl.ulHeard & (1UL << xStatus.bPanelId)) != 0 ? pdTRUE : pdFALSE;
+    vLiveTblOnStatus(&xLiveTbl, &xStatus, esp_timer_get_time());
+    portEXIT_CRITICAL(&xCanLiveMux);
+
+    // ゲームの途中で再起動したパネルは点灯状態を失っている
+    if (xStatus.bReason == TBCAN_STATUS_BOOT && xHeard == pdTRUE)
+    {
+        ESP_LOGW(EXAMPLE_TAG, "Panel %d rebooted | fw:%d.%d", xStatus.bPanelId,
+                 xStatus.bFwMajor, xStatus.bFwMinor);
+    }
+    else if (xStatus.bReason == TBCAN_STATUS_BOOT)
+    {
+        ESP_LOGI(EXAMPLE_TAG, "Panel %d booted | fw:%d.%d", xStatus.bPanelId,
+                 xStatus.bFwMajor, xStatus.bFwMinor);
+    }
+
+    bPanelFeat[xStatus.bPanelId] = xStatus.bFeat;
+    xProto.bPanelId = xStatus.bPanelId;
+    xProto.bProto = TBCAN_VER_2;
+    prvCanRxProto(&xProto, xStatus.bCap);
+}
+
+/*****************************************************************************/
+/**
+ * パネルの死活の更新
+ * 状態が変わったらログと記録に残す(運営画面へはctrl_mainが送る)
+ *
+ * @param	llNowUs: 現在時刻[us]
+ *
+ * @return  ##
+ *
+ * @note    CAN_healthタスクから呼ぶ
+ *
+ ******************************************************************************/
+static void prvCanLiveUpdate(int64_t llNowUs)
+{
+    static uint32_t ulLastExclude;
+    uint32_t ulAlive;
+    uint32_t ulDead;
+    uint32_t ulStuck;
+    uint32_t ulExclude;
+    BOOL_t xChanged;
+
+    portENTER_CRITICAL(&xCanLiveMux);
+    xChanged = xLiveTblUpdate(&xLiveTbl, llNowUs);
+    if (xChanged == pdTRUE)
+        ulLiveSeq++;
+    ulAlive = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_ALIVE);
+    ulDead = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_DEAD);
+    ulStuck = ulLiveTblMask(&xLiveTbl, PANEL_LIVE_STUCK);
+    ulExclude = xLiveTbl.ulExclude;
+    portEXIT_CRITICAL(&xCanLiveMux);
+
+    if (xChanged != pdTRUE)
+        return;
+    if (ulExclude != ulLastExclude)
+    {
+        ESP_LOGW(EXAMPLE_TAG, "Panel live | alive:0x%08x dead:0x%08x stuck:0x%08x",
+                 ulAlive, ulDead, ulStuck);
+        ulLastExclude = ulExclude;
+    }
+    vCanRecLive();
+}
+
+/*****************************************************************************/
+/**
+ * 返信からPanelのCANプロトコルのバージョンを更新
+ *
+ * @param	pxMsg: 受信したメッセージ
+ * @param   bCap: Panelが返してきた対応バージョン(0: v1のみ)
+ *
+ * @return  ##
+ *
+ * @note    v1のPanelに差し替えられたら(対応バージョン0のv1返信)v1へ戻す
+ *
+ ******************************************************************************/
+static void prvCanRxProto(const canCommMsg_t *pxMsg, uint8_t bCap)
+{
+    uint8_t bVer = bCap > pxMsg->bProto ? bCap : pxMsg->bProto;
+
+    if (pxMsg->bPanelId < PANEL_1 || pxMsg->bPanelId >= MAX_PANEL_NUM)
+        return;
+    if (bVer > configCAN_PROTO_MAX)
+        bVer = configCAN_PROTO_MAX;
+    if (bVer != bCanPanelProto(pxMsg->bPanelId))
+    {
+        ESP_LOGI(EXAMPLE_TAG, "Panel %d: CAN protocol v%d", pxMsg->bPanelId, bVer);
+        bPanelProto[pxMsg->bPanelId] = bVer;
+    }
+}
+
 /*****************************************************************************/
 /**
  * CAN メッセージ送信ラッパー
  * canCommMsg_tを入力し、canMsg.canIdへメッセージを送信する
  *
  * @param	canMsg：送信するCANの情報
- * @param   canID：Panel固有のCAN ID
  *
- * @return  CAN_OK / CAN err各種
+ * @return  ##
  *
- * @note    ##
+ * @note    ドライバのTXキューへ積んだら戻る(送信完了は待たない)。
+ *          キューが埋まっていれば空くまでブロックし、xCanTxRing経由で
+ *          CtrlTxタスクへ背圧をかける。configCAN_TX_WAIT_MS待っても
+ *          積めないとき(バスオフ等)は捨てる。
+ *          bReliableのPanel宛てはACK要求を付け、ACKが来なければCAN_txタスクが送り直す
+ *          (配送確認に対応したv2のPanelのみ。グループ宛ては送りっぱなし)。
+ *          アニメーション、LED毎の色は宛先の全PanelがTBCAN_FEAT_ANIM / PIXELのときだけ送る
+ *          (v1のPanelは点灯の指示と読むので、呼ぶ側が確かめていても送る直前に見直す)。
  *
  ******************************************************************************/
 void vCanSendWrapper(canCommMsg_t canMsg)
 {
-    can_message_t tx_msg = {.data_length_code = 7,
-                            .identifier = canMsg.ulCanId,
+    can_message_t tx_msg = {.identifier = canMsg.ulCanId,
                             .flags = CAN_MSG_FLAG_NONE};
+    uint8_t bVer = prvCanTxProto(canMsg.ulCanId);
+    BOOL_t xRelFeat = bVer >= TBCAN_VER_2 && (prvCanTxFeat(canMsg.ulCanId) & TBCAN_FEAT_ACK) != 0;
+    tbCanFrame_t xFrame = {.bPanelId = canMsg.bPanelId,
+                           .bBtn = canMsg.bBtnFlag,
+                           .bStartSw = canMsg.bStartSwFlag,
+                           .bFade = canMsg.bFade,
+                           .bSeq = bCanTxSeq++,
+                           .bCap = TBCAN_VER_MAX,
+                           .bR = canMsg.bColorInfoR,
+                           .bG = canMsg.bColorInfoG,
+                           .bB = canMsg.bColorInfoB,
+                           .usLightMs = canMsg.usLightTimeMs};
+
+    // 押下の返信はACK付きで返させる。スタート通知などはACKを待つ
+    xFrame.bRelReply = xRelFeat && (canMsg.bBtnFlag || canMsg.bStartSwFlag);
+    xFrame.bAckReq = xRelFeat && canMsg.bReliable && canMsg.ulCanId >= PANEL_1 &&
+                     canMsg.ulCanId < MAX_PANEL_NUM;
+
+    // LED毎の色は複数フレームに分けて続けて送る
+    if (canMsg.bCmd == TBCAN_CMD_PIXEL)
+    {
+        if (bVer < TBCAN_VER_2 || (prvCanTxFeat(canMsg.ulCanId) & TBCAN_FEAT_PIXEL) == 0)
+        {
+            ESP_LOGW(EXAMPLE_TAG, "Pixel dropped - ID = %d (not supported)", canMsg.ulCanId);
+            return;
+        }
+        prvCanSendPixel(&canMsg);
+        return;
+    }
+
+    // 宛先Panelが対応しているバージョンで詰める
+    if (canMsg.bCmd == TBCAN_CMD_ANIM)
+    {
+        if (bVer < TBCAN_VER_2 || (prvCanTxFeat(canMsg.ulCanId) & TBCAN_FEAT_ANIM) == 0)
+        {
+            ESP_LOGW(EXAMPLE_TAG, "Anim dropped - ID = %d (not supported)", canMsg.ulCanId);
+            return;
+        }
+        tx_msg.data_length_code = prvCanEncodeAnim(&canMsg, tx_msg.data);
+    }
+    else if (canMsg.bCmd != 0)
+        tx_msg.data_length_code = bTbCanEncodeCtrl(canMsg.bCmd, tx_msg.data);
+    else
+        tx_msg.data_length_code = bTbCanEncode(&xFrame, bVer, tx_msg.data);
+
+    if (prvCanTransmit(&tx_msg, canMsg.ulCanId) == pdPASS && canMsg.bCmd == 0 && xFrame.bAckReq)
+        prvCanRelArm(&tx_msg);
+}
 
-    // dataの下位バイトから情報を埋めていく
-    tx_msg.data[0] = canMsg.bPanelId;
-    tx_msg.data[1] = canMsg.bBtnFlag;
-    tx_msg.data[2] = canMsg.bColorInfoR;
-    tx_msg.data[3] = canMsg.bColorInfoG;
-    tx_msg.data[4] = canMsg.bColorInfoB;
-    tx_msg.data[5] = canMsg.bLightTime;
-    tx_msg.data[6] = canMsg.bStartSwFlag;
+/*****************************************************************************/
+/**
+ * ドライバのTXキューへ1フレーム積む
+ *
+ * @param	pxMsg: 送るフレーム
+ * @param   ulCanId: 送信先(トレース用)
+ *
+ * @return  pdPASS: 積んだ / pdFAIL: 捨てた
+ *
+ * @note    CAN_txタスクから呼ぶ(vCanSendWrapper)
+ *
+ ******************************************************************************/
+static BOOL_t prvCanTransmit(can_message_t *pxMsg, uint32_t ulCanId)
+{
+    can_status_info_t xStatus;
+    BOOL_t xBackpressure = pdFALSE;
+    esp_err_t xErr;
 
-    ESP_ERROR_CHECK(can_transmit(&tx_msg, portMAX_DELAY));
-    ESP_LOGI(EXAMPLE_TAG, "Msg transmit - ID = %d", tx_msg.identifier);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    if (can_get_status_info(&xStatus) == ESP_OK &&
+        xStatus.msgs_to_tx >= g_config.tx_queue_len)
+    {
+        xBackpressure = pdTRUE;
+    }
+    /*
+     * バスオフ中(INVALID_STATE)やTXキューが空かない(TIMEOUT)ときは捨てる。
+     * 遅れて届いた点灯は意味が無いので、復帰後に送り直さない
+     */
+    xErr = can_transmit(pxMsg, pdMS_TO_TICKS(configCAN_TX_WAIT_MS));
+    if (xErr != ESP_OK)
+    {
+        ESP_LOGW(EXAMPLE_TAG, "Msg dropped - ID = %d (%s)", pxMsg->identifier,
+                 esp_err_to_name(xErr));
+        portENTER_CRITICAL(&xCanStatsMux);
+        xCanHealth.ulTxDropped++;
+        portEXIT_CRITICAL(&xCanStatsMux);
+        return pdFAIL;
+    }
+    prvCanTxCount(pxMsg->data_length_code, xBackpressure);
+    vTracePoint(TP_CAN_TX_DONE, ulCanId);
+    vRecEvent(REC_CAN_TX, pxMsg->data_length_code, (uint16_t)pxMsg->identifier,
+              pxMsg->data, sizeof(pxMsg->data));
+    vDiagEvent(DIAG_CAN_TX, pxMsg->data_length_code, (uint16_t)pxMsg->identifier,
+               pxMsg->data, sizeof(pxMsg->data));
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * LED毎の色を送る(TBCAN_PIXEL_SEG_NUMフレーム)
+ *
+ * @param	pxMsg: 送るメッセージ(bCmd = TBCAN_CMD_PIXEL)
+ *
+ * @return  ##
+ *
+ * @note    同じ指示の番号で続けて積む(間に他のフレームを挟まない)。
+ *          1つ捨てたら残りも送らない(Panelは揃わない指示を出さない)
+ *
+ ******************************************************************************/
+static void prvCanSendPixel(const canCommMsg_t *pxMsg)
+{
+    can_message_t tx_msg = {.identifier = pxMsg->ulCanId, .flags = CAN_MSG_FLAG_NONE};
+    tbCanPixel_t xPixel = {.usLightMs = pxMsg->usLightTimeMs, .bFade = pxMsg->bFade};
+    uint8_t bXfer = bCanPixelXfer++;
+
+    memcpy(xPixel.bRgb, pxMsg->bPixel, sizeof(xPixel.bRgb));
+    for (uint8_t bSeg = 0; bSeg < TBCAN_PIXEL_SEG_NUM; bSeg++)
+    {
+        tx_msg.data_length_code = bTbCanEncodePixel(&xPixel, bXfer, bSeg, tx_msg.data);
+        if (prvCanTransmit(&tx_msg, pxMsg->ulCanId) != pdPASS)
+            return;
+    }
 }
 
 /*****************************************************************************/
@@ -258,19 +1684,50 @@ void vCanSendWrapper(canCommMsg_t canMsg)
  * @param	canMsg：ESPdrvのCANメッセージ形式
  * @param   canCommMsg：TB固有のCANメッセージ形式
  *
- * @return  ##
+ * @return  uint8_t 送信側の対応バージョン(0: v1のみ)
  *
- * @note    ##
+ * @note    読めないフレームはcanCommMsg->bProto = 0
  *
  ******************************************************************************/
-void vCanMsgConv(can_message_t *canMsg, canCommMsg_t *canCommMsg)
+uint8_t bCanMsgConv(can_message_t *canMsg, canCommMsg_t *canCommMsg)
 {
+    tbCanFrame_t xFrame;
+    int64_t llRxUs;
+    int16_t sAge;
+
     canCommMsg->ulCanId = canMsg->identifier;
-    canCommMsg->bPanelId = canMsg->data[0];
-    canCommMsg->bBtnFlag = canMsg->data[1];
-    canCommMsg->bColorInfoR = canMsg->data[2];
-    canCommMsg->bColorInfoG = canMsg->data[3];
-    canCommMsg->bColorInfoB = canMsg->data[4];
-    canCommMsg->bLightTime = canMsg->data[5];
-    canCommMsg->bStartSwFlag = canMsg->data[6];
+    canCommMsg->bCmd = 0;
+    canCommMsg->bProto =
+        bTbCanDecode(canMsg->data, canMsg->data_length_code, &xFrame);
+    if (canCommMsg->bProto == 0)
+        return 0;
+    canCommMsg->bPanelId = xFrame.bPanelId;
+    canCommMsg->bBtnFlag = xFrame.bBtn;
+    canCommMsg->bColorInfoR = xFrame.bR;
+    canCommMsg->bColorInfoG = xFrame.bG;
+    canCommMsg->bColorInfoB = xFrame.bB;
+    canCommMsg->usLightTimeMs = xFrame.usLightMs;
+    canCommMsg->bStartSwFlag = xFrame.bStartSw;
+    canCommMsg->bFade = xFrame.bFade;
+    canCommMsg->bSeq = xFrame.bSeq;
+    canCommMsg->bTimed = xFrame.bTimed;
+    canCommMsg->bReliable = xFrame.bAckReq;
+    canCommMsg->llPressUs = 0;
+    canCommMsg->ulReactionUs = 0;
+    if (xFrame.bTimed)
+    {
+        /*
+         * 踏んだ時刻は下位16bit(64us単位, 約4.2s)しか無いので受信した時刻から戻す。
+         * Panelの時計が少し進んでいて受信より後になったら受信の時刻にする
+         */
+        llRxUs = esp_timer_get_time();
+        sAge = (int16_t)((uint16_t)(llRxUs >> TBCAN_TIME_TICK_SHIFT) - xFrame.usPressTick);
+        canCommMsg->llPressUs = (((llRxUs >> TBCAN_TIME_TICK_SHIFT) - sAge) << TBCAN_TIME_TICK_SHIFT) +
+                                (1 << (TBCAN_TIME_TICK_SHIFT - 1));
+        if (canCommMsg->llPressUs > llRxUs)
+            canCommMsg->llPressUs = llRxUs;
+        canCommMsg->ulReactionUs = ((uint32_t)xFrame.usReactTick << TBCAN_TIME_TICK_SHIFT) +
+                                   (1 << (TBCAN_TIME_TICK_SHIFT - 1));
+    }
+    return xFrame.bCap;
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 /* Include Files
 ******************************************************************************/
 #include "def_system.h"
+#include "ctrl_live.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -30,6 +31,76 @@
 /*****************************************************************************/
 /* TAG Definitions
 ******************************************************************************/
+/*
+ * 送信統計(起動からの累計)
+ * 2回取得した差からフレーム/s、バス負荷を求める(ulCanTxFps, ulCanTxLoadPermil)
+ */
+typedef struct CAN_TX_STATS
+{
+    int64_t llUs;            // 取得時刻[us]
+    uint32_t ulFrames;       // ドライバへ渡したフレーム数
+    uint64_t ullBits;        // 送信ビット数(スタッフビットを含まない概算)
+    uint32_t ulPeakFps;      // 100ms毎のフレーム数の最大(/s換算)
+    uint32_t ulPaced;        // 宛先Panelの間隔待ちをしたフレーム数
+    uint32_t ulBackpressure; // ドライバのTXキューが埋まっていたフレーム数
+    uint32_t ulSync;         // 時刻同期(SYNC + FOLLOW_UP)を送った回数
+    uint32_t ulSyncSkipped;  // 時刻同期を送らなかった回数(v1のPanelがいる、CANの不調)
+} canTxStats_t;
+
+/*
+ * 配送確認の統計(起動からの累計, tb_canproto.h)
+ * スタート通知はACKを待って再送し、Panelの返信はACKを返して重複を捨てる
+ */
+typedef struct CAN_REL_STATS
+{
+    uint32_t ulSent;   // ACK要求を付けて送ったフレーム
+    uint32_t ulAcked;  // ACKが返ったフレーム
+    uint32_t ulRetry;  // 再送したフレーム
+    uint32_t ulGiveUp; // 再送し切ってもACKが無かったフレーム
+    uint32_t ulAckTx;  // Panelへ返したACK
+    uint32_t ulDup;    // 重複として捨てた返信
+} canRelStats_t;
+
+/*
+ * 受信統計(起動からの累計)
+ * CAN_rxタスクは1回の起床でドライバのRXキューに溜まった分をまとめて取り出す
+ */
+typedef struct CAN_RX_STATS
+{
+    uint32_t ulWakeups;   // 起床した回数
+    uint32_t ulFrames;    // 受信したフレーム
+    uint32_t ulForwarded; // ctrl_mainへ送ったメッセージ
+    uint32_t ulBatchMax;  // 1回の起床で受信したフレーム数の最大
+} canRxStats_t;
+
+/*
+ * CANの状態(監視タスクが更新)
+ * DOWN の間は送信したフレームを捨てる。ゲームはパネル生成を止めて続ける
+ */
+typedef enum CAN_HEALTH
+{
+    CAN_HEALTH_OK,   // 送受信できる
+    CAN_HEALTH_WARN, // エラーパッシブ、または直近にバスエラーあり
+    CAN_HEALTH_DOWN  // バスオフ／復帰中
+} eCanHealth_t;
+
+/* 監視結果(直近configCAN_HEALTH_WINDOW_S秒 / 起動からの累計) */
+typedef struct CAN_HEALTH_INFO
+{
+    eCanHealth_t eHealth;
+    uint32_t ulTec;         // 送信エラーカウンタ(現在)
+    uint32_t ulRec;         // 受信エラーカウンタ(現在)
+    uint32_t ulTecPeak;     // 直近の送信エラーカウンタの最大
+    uint32_t ulRecPeak;     // 直近の受信エラーカウンタの最大
+    uint32_t ulBusErrors;   // 直近のバスエラー
+    uint32_t ulArbLost;     // 直近の調停負け
+    uint32_t ulTxFailed;    // 直近の送信失敗(ドライバ)
+    uint32_t ulRxMissed;    // 直近の受信取りこぼし(ドライバ)
+    uint32_t ulBusOff;      // バスオフ回数(累計)
+    uint32_t ulRecovered;   // バスオフから復帰した回数(累計)
+    uint32_t ulTxDropped;   // 送れずに捨てたフレーム(累計)
+    int64_t llDownUs;       // DOWNだった時間(累計)[us]
+} canHealth_t;
 
 
 /*****************************************************************************/
@@ -44,6 +115,20 @@
 esp_err_t lInitCanFunction();
 
 BOOL_t xSendCanTxQueue(canCommMsg_t canTxMsg);
+void vCanGetTxStats(canTxStats_t *pxStats);
+uint8_t bCanPanelProto(uint32_t ulPanelId);
+BOOL_t xCanPanelsHaveFeat(uint32_t ulPanelMask, uint8_t bFeat);
+void vCanGetRelStats(canRelStats_t *pxStats);
+void vCanGetRxStats(canRxStats_t *pxStats);
+void vCanGetHealth(canHealth_t *pxHealth);
+eCanHealth_t eCanGetHealth(void);
+uint32_t ulCanTxFps(const canTxStats_t *pxFrom, const canTxStats_t *pxTo);
+uint32_t ulCanTxLoadPermil(const canTxStats_t *pxFrom, const canTxStats_t *pxTo);
+BOOL_t xSendCanDiscover(void);
+BOOL_t xCanSendFrame(uint32_t ulCanId, const uint8_t *pbData, uint8_t bDlc);
+uint32_t ulCanPanelExcludeMask(void);
+uint32_t ulCanGetLive(liveTbl_t *pxTbl);
+void vCanRecLive(void);
 
 #ifdef __cplusplus
     }
@@ -0,0 +1,422 @@
+/*****************************************************************************/
+/**
+ * @file drv_canfw.c
+ * @comments Panelのファームウェアの一斉配信(CAN, tb_canfw.h)
+ *           GMの指示でCAN_fwタスクを起こし、イメージを全Panelへ同時に流す。
+ *           状態遷移はtb_canfw.hの送信側(simの仮想CANバスでも同じものを動かす)。
+ *
+ *           - イメージはVFSのパスで指定する(SPIFFSは起動時に/spiffsへマウントする)
+ *           - フレームはdrv_canのxCanSendFrame()で送る(xCanTxLockで時刻同期と混ざらない)。
+ *             間隔を空けない所はドライバのTXキューが空くのを待つだけ(バスの容量で送る)
+ *           - Panelの応答(TBCAN_ID_FW_REPLY_BASE + PanelID)はCAN_rxタスクから
+ *             リング経由で受け取る
+ *           - 終わったら結果をGMへ送る(esp_fwup_result)
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+/* ESP-IDF Includes */
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+
+#include "drv_canfw.h"
+#include "drv_can.h"
+#include "drv_gamemng.h"
+#include "tb_canfw.h"
+#include "util_ring.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* FreeRTOS TaskConfigure */
+#define tskstacMAIN_CANFWTASK 4096
+#define tskprioMAIN_CANFWTASK 7 // CAN_txより低い(ゲームの合間でも点灯を優先)
+
+/* Ring Configure (SPSC Ring, Producer: CAN_rxタスク, Consumer: CAN_fwタスク) */
+#define QUEUE_CANFW_RX_SIZE 64 // 全PanelのMISSING(最大8フレーム)が入る数
+#define QUEUE_CANFW_RX_POLICY RING_POLICY_DROP_OLDEST
+
+/* SPIFFS */
+#define CANFW_SPIFFS_BASE "/spiffs"
+#define CANFW_SPIFFS_MAX_FILES 2
+
+/* ESPLOGGER Configure */
+#define CANFW_TAG "CAN Fw"
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* CAN_rx -> CAN_fw */
+typedef struct CANFW_RX
+{
+    uint32_t ulCanId;
+    uint8_t bDlc;
+    uint8_t bData[TBCAN_DLC];
+} canFwRx_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static ring_t xCanFwRxRing;
+static canFwRx_t xCanFwRxRingBuf[QUEUE_CANFW_RX_SIZE];
+
+static TaskHandle_t xCanFwTask = NULL;
+static volatile uint8_t bCanFwActive; // 配信中(CAN_rxタスクが応答をリングへ入れる)
+static tbFwTx_t xCanFwTx;
+static uint8_t bCanFwSession;
+static char cCanFwPath[configCANFW_PATH_LENGTH];
+static uint8_t bCanFwMajor;
+static uint8_t bCanFwMinor;
+
+static canFwResult_t xCanFwResult;
+static portMUX_TYPE xCanFwMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *cpcCanFwStateName[MAX_CANFW_STATE] = {
+    "idle", "running", "done", "failed", "no_image",
+};
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvCanFwTask(void *pvParameters);
+static uint8_t *prvCanFwLoad(const char *pcPath, uint32_t *pulSize);
+static void prvCanFwFinish(eCanFwState_t eState, uint32_t ulTxErrors);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 初期化(SPIFFSのマウント)
+ *
+ * @param    ##
+ *
+ * @return   ESP_OK
+ *
+ * @note     SPIFFSのパーティションが無くても続ける(配信がNO_IMAGEになるだけ)
+ *
+ ******************************************************************************/
+esp_err_t lInitCanFw(void)
+{
+    esp_vfs_spiffs_conf_t xConf = {
+        .base_path = CANFW_SPIFFS_BASE,
+        .partition_label = NULL,
+        .max_files = CANFW_SPIFFS_MAX_FILES,
+        .format_if_mount_failed = false,
+    };
+    esp_err_t xErr;
+
+    vRingInit(&xCanFwRxRing, xCanFwRxRingBuf, QUEUE_CANFW_RX_SIZE, sizeof(canFwRx_t),
+              NULL, QUEUE_CANFW_RX_POLICY, "xCanFwRxRing");
+
+    xErr = esp_vfs_spiffs_register(&xConf);
+    if (xErr != ESP_OK)
+        ESP_LOGW(CANFW_TAG, "SPIFFS not mounted (%s)", esp_err_to_name(xErr));
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * 配信を始める
+ *
+ * @param    pcPath: イメージのパス(NULLでconfigCANFW_IMAGE_PATH)
+ * @param    bFwMajor / bFwMinor: イメージのバージョン(BEGINでPanelへ知らせる)
+ *
+ * @return   pdPASS / pdFAIL(配信中、タスクを作れない)
+ *
+ * @note     ゲームの合間に呼ぶこと。結果はGMMSG_FWUPで知らせる
+ *
+ ******************************************************************************/
+BOOL_t xCanFwStart(const char *pcPath, uint8_t bFwMajor, uint8_t bFwMinor)
+{
+    BOOL_t xStatus;
+
+    if (bCanFwActive)
+        return pdFAIL;
+    strncpy(cCanFwPath, pcPath != NULL ? pcPath : configCANFW_IMAGE_PATH,
+            sizeof(cCanFwPath) - 1);
+    cCanFwPath[sizeof(cCanFwPath) - 1] = '\0';
+    bCanFwMajor = bFwMajor;
+    bCanFwMinor = bFwMinor;
+
+    portENTER_CRITICAL(&xCanFwMux);
+    memset(&xCanFwResult, 0, sizeof(xCanFwResult));
+    xCanFwResult.eState = CANFW_RUNNING;
+    portEXIT_CRITICAL(&xCanFwMux);
+
+    bCanFwActive = 1;
+    xStatus = xTaskCreatePinnedToCore(prvCanFwTask, "CAN_fw", tskstacMAIN_CANFWTASK, NULL,
+                                      tskprioMAIN_CANFWTASK, &xCanFwTask, tskNO_AFFINITY);
+    if (xStatus != pdPASS)
+    {
+        bCanFwActive = 0;
+        prvCanFwFinish(CANFW_FAILED, 0);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * Panelの応答を受けた
+ *
+ * @param    ulCanId: CAN ID(TBCAN_ID_IS_FW_REPLY)
+ * @param    pbData / bDlc: 受信データ
+ *
+ * @return   ##
+ *
+ * @note     CAN_rxタスクから呼ぶ。配信中でなければ捨てる
+ *
+ ******************************************************************************/
+void vCanFwRxReply(uint32_t ulCanId, const uint8_t *pbData, uint8_t bDlc)
+{
+    canFwRx_t xRx;
+
+    if (!bCanFwActive)
+        return;
+    xRx.ulCanId = ulCanId;
+    xRx.bDlc = MIN(bDlc, TBCAN_DLC);
+    memcpy(xRx.bData, pbData, xRx.bDlc);
+    xRingSend(&xCanFwRxRing, &xRx, 0);
+}
+
+/*****************************************************************************/
+/**
+ * 最後の配信の結果
+ *
+ * @param    pxResult: 出力
+ *
+ * @return   ##
+ *
+ * @note     どのタスクから呼んでもよい
+ *
+ ******************************************************************************/
+void vCanFwGetResult(canFwResult_t *pxResult)
+{
+    portENTER_CRITICAL(&xCanFwMux);
+    *pxResult = xCanFwResult;
+    portEXIT_CRITICAL(&xCanFwMux);
+}
+
+/*****************************************************************************/
+/**
+ * 最後の配信の結果をJSONにする
+ *  {"state":"done","size":N,"crc":"xxxxxxxx","rounds":N,"frames":N,"resent":N,
+ *   "txErrors":N,"ms":N,"done":[..],"failed":[..],"refused":[..],"noReply":[..]}
+ *
+ * @param    pcBuf: 出力
+ * @param    xSize: pcBufの大きさ
+ *
+ * @return   int 書いた文字数
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int lCanFwFormatJson(char *pcBuf, size_t xSize)
+{
+    canFwResult_t xResult;
+    const char *cpcName[] = {"done", "failed", "refused", "noReply"};
+    uint32_t ulMask[4];
+    size_t xPos;
+    int iFirst;
+
+    vCanFwGetResult(&xResult);
+    ulMask[0] = xResult.ulDone;
+    ulMask[1] = xResult.ulFailed;
+    ulMask[2] = xResult.ulRefused;
+    ulMask[3] = xResult.ulNoReply;
+
+    xPos = snprintf(pcBuf, xSize,
+                    "{\"state\":\"%s\",\"size\":%u,\"crc\":\"%08x\",\"rounds\":%u,"
+                    "\"frames\":%u,\"resent\":%u,\"txErrors\":%u,\"ms\":%u",
+                    cpcCanFwStateName[xResult.eState], xResult.ulSize, xResult.ulCrc,
+                    xResult.ulRounds, xResult.ulFrames, xResult.ulResent, xResult.ulTxErrors,
+                    xResult.ulMs);
+    for (uint32_t s = 0; s < COUNTOF(ulMask) && xPos < xSize; s++)
+    {
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, ",\"%s\":[", cpcName[s]);
+        iFirst = 1;
+        for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM && xPos < xSize; i++)
+        {
+            if ((ulMask[s] & (1UL << i)) == 0)
+                continue;
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "%s%u", iFirst ? "" : ",", i);
+            iFirst = 0;
+        }
+        if (xPos < xSize)
+            xPos += snprintf(pcBuf + xPos, xSize - xPos, "]");
+    }
+    if (xPos < xSize)
+        xPos += snprintf(pcBuf + xPos, xSize - xPos, "}");
+
+    return (int)(xPos < xSize ? xPos : xSize - 1);
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 配信タスク(1回の配信で終わる)
+ *
+ * @param	pvParametersはNULLです。
+ *
+ * @return  ##
+ *
+ * @note    送るフレームが無い間はPanelの応答を待つ(次に送る時刻まで)
+ *
+ ******************************************************************************/
+static void prvCanFwTask(void *pvParameters)
+{
+    uint8_t *pbImage;
+    uint32_t ulSize = 0;
+    uint32_t ulCanId;
+    uint32_t ulWaitUs;
+    uint32_t ulTxErrors = 0;
+    uint8_t bData[TBCAN_DLC];
+    uint8_t bDlc;
+    canFwRx_t xRx;
+
+    ESP_LOGI(CANFW_TAG, "FW_TASK started: %s", cCanFwPath);
+    pbImage = prvCanFwLoad(cCanFwPath, &ulSize);
+    if (pbImage == NULL)
+    {
+        prvCanFwFinish(CANFW_NO_IMAGE, 0);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    // 前の配信の遅れた応答を捨てる
+    while (xRingTryReceive(&xCanFwRxRing, &xRx) == pdPASS)
+        ;
+
+    vTbFwTxStart(&xCanFwTx, pbImage, (uint16_t)ulSize, bCanFwMajor, bCanFwMinor,
+                 ++bCanFwSession, TBFW_PANEL_ALL, (uint32_t)esp_timer_get_time());
+    xCanFwTx.ulFrameGapUs = configCANFW_FRAME_GAP_US;
+    xCanFwTx.ulBlockGapUs = configCANFW_BLOCK_GAP_MS * 1000UL;
+    portENTER_CRITICAL(&xCanFwMux);
+    xCanFwResult.ulSize = ulSize;
+    xCanFwResult.ulCrc = xCanFwTx.ulCrc;
+    portEXIT_CRITICAL(&xCanFwMux);
+    ESP_LOGI(CANFW_TAG, "Image %u bytes, crc %08x, session %d", ulSize, xCanFwTx.ulCrc,
+             xCanFwTx.bSession);
+
+    while (!bTbFwTxFinished(&xCanFwTx))
+    {
+        while (xRingTryReceive(&xCanFwRxRing, &xRx) == pdPASS)
+            vTbFwTxReply(&xCanFwTx, xRx.ulCanId, xRx.bData, xRx.bDlc);
+
+        bDlc = bTbFwTxPoll(&xCanFwTx, (uint32_t)esp_timer_get_time(), &ulCanId, bData);
+        if (bDlc != 0)
+        {
+            // 失ったフレームはPanelのNACKで送り直す
+            if (xCanSendFrame(ulCanId, bData, bDlc) != pdPASS)
+                ulTxErrors++;
+            continue;
+        }
+
+        // 次に送る時刻まで応答を待つ(1tick未満はそのまま回す)
+        ulWaitUs = ulTbFwTxWaitUs(&xCanFwTx, (uint32_t)esp_timer_get_time());
+        if (ulWaitUs >= portTICK_PERIOD_MS * 1000UL &&
+            xRingReceive(&xCanFwRxRing, &xRx, pdMS_TO_TICKS(ulWaitUs / 1000)) == pdPASS)
+        {
+            vTbFwTxReply(&xCanFwTx, xRx.ulCanId, xRx.bData, xRx.bDlc);
+        }
+    }
+
+    prvCanFwFinish(xCanFwTx.bState == TBFW_TX_FINISHED ? CANFW_DONE : CANFW_FAILED,
+                   ulTxErrors);
+    free(pbImage);
+    vTaskDelete(NULL);
+}
+
+/*****************************************************************************/
+/**
+ * イメージを読む
+ *
+ * @param	pcPath: パス
+ * @param   pulSize: バイト数
+ *
+ * @return  イメージ(free()すること) / NULL(読めない、空、TBFW_IMAGE_MAXより大きい)
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+static uint8_t *prvCanFwLoad(const char *pcPath, uint32_t *pulSize)
+{
+    FILE *pxFile;
+    uint8_t *pbImage = NULL;
+    long lSize;
+
+    pxFile = fopen(pcPath, "rb");
+    if (pxFile == NULL)
+    {
+        ESP_LOGE(CANFW_TAG, "Cannot open %s", pcPath);
+        return NULL;
+    }
+    if (fseek(pxFile, 0, SEEK_END) == 0 && (lSize = ftell(pxFile)) > 0 &&
+        (uint32_t)lSize <= TBFW_IMAGE_MAX && fseek(pxFile, 0, SEEK_SET) == 0)
+    {
+        pbImage = (uint8_t *)malloc(lSize);
+        if (pbImage != NULL && fread(pbImage, 1, lSize, pxFile) != (size_t)lSize)
+        {
+            free(pbImage);
+            pbImage = NULL;
+        }
+        *pulSize = (uint32_t)lSize;
+    }
+    fclose(pxFile);
+    if (pbImage == NULL)
+        ESP_LOGE(CANFW_TAG, "Cannot read %s (max %u bytes)", pcPath, TBFW_IMAGE_MAX);
+    return pbImage;
+}
+
+/* 結果を控えてGMへ知らせる */
+static void prvCanFwFinish(eCanFwState_t eState, uint32_t ulTxErrors)
+{
+    tbFwTx_t *pxTx = &xCanFwTx;
+
+    portENTER_CRITICAL(&xCanFwMux);
+    xCanFwResult.eState = eState;
+    xCanFwResult.ulTxErrors = ulTxErrors;
+    if (eState == CANFW_DONE || eState == CANFW_FAILED)
+    {
+        xCanFwResult.ulDone = pxTx->ulDone;
+        xCanFwResult.ulFailed = pxTx->ulReady & ~pxTx->ulDone;
+        xCanFwResult.ulRefused = pxTx->ulRefused;
+        xCanFwResult.ulNoReply = pxTx->ulTargets & ~(pxTx->ulReady | pxTx->ulRefused);
+        xCanFwResult.ulRounds = pxTx->bRound;
+        xCanFwResult.ulFrames = pxTx->ulDataFrames;
+        xCanFwResult.ulResent = pxTx->ulBlocksResent;
+        xCanFwResult.ulMs = (pxTx->ulEndUs - pxTx->ulStartUs) / 1000;
+    }
+    portEXIT_CRITICAL(&xCanFwMux);
+    bCanFwActive = 0;
+
+    ESP_LOGI(CANFW_TAG, "Finished: %s done:0x%08x refused:0x%08x", cpcCanFwStateName[eState],
+             xCanFwResult.ulDone, xCanFwResult.ulRefused);
+    xSendGamemngTxQueue(GMMSG_FWUP);
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************/
+/**
+ * @file drv_canfw.h
+ * @comments Panelのファームウェアの一斉配信(CAN, tb_canfw.h)
+ *           SPIFFS(/spiffs)などVFSのファイルからイメージを読み、CAN_fwタスクが
+ *           全Panelへ同時に送る。Panelの応答はCAN_rxタスクから受け取る。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_DRV_CANFW_H
+#define SRC_DRV_CANFW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+typedef enum CANFW_STATE
+{
+    CANFW_IDLE = 0, // 一度も配信していない
+    CANFW_RUNNING,  // 配信中
+    CANFW_DONE,     // 1枚以上書き換えた(失敗したPanelは結果のマスクを見る)
+    CANFW_FAILED,   // 1枚も書き換えられなかった
+    CANFW_NO_IMAGE, // イメージが読めない(無い、空、大きすぎる)
+    MAX_CANFW_STATE
+} eCanFwState_t;
+
+/* 配信の結果(Panelはbit = PanelID) */
+typedef struct CANFW_RESULT
+{
+    eCanFwState_t eState;
+    uint32_t ulSize;     // イメージのバイト数
+    uint32_t ulCrc;      // イメージのCRC32
+    uint32_t ulDone;     // 書き換えたPanel
+    uint32_t ulFailed;   // 送り切れなかった／確定の応答が無かったPanel
+    uint32_t ulRefused;  // 書き換えられないPanel(ブートローダが無い、大きすぎる)
+    uint32_t ulNoReply;  // 開始に応答の無かったPanel(電源断、v1のファームウェア)
+    uint32_t ulRounds;   // 送り直しを含めた周回
+    uint32_t ulFrames;   // 送ったデータフレーム
+    uint32_t ulResent;   // 送り直したブロック
+    uint32_t ulTxErrors; // ドライバへ渡せなかったフレーム
+    uint32_t ulMs;       // かかった時間[ms]
+} canFwResult_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+esp_err_t lInitCanFw(void);
+BOOL_t xCanFwStart(const char *pcPath, uint8_t bFwMajor, uint8_t bFwMinor);
+void vCanFwRxReply(uint32_t ulCanId, const uint8_t *pbData, uint8_t bDlc);
+void vCanFwGetResult(canFwResult_t *pxResult);
+int lCanFwFormatJson(char *pcBuf, size_t xSize);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
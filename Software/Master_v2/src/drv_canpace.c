@@ -0,0 +1,235 @@
+/*****************************************************************************/
+/**
+ * @file drv_canpace.c
+ * @comments CAN送信の宛先Panel毎の間隔(configCAN_PANEL_GAP_MS)と間隔待ちのフレーム
+ *           宛先のPanel(グループ宛ては含まれる全Panel)が前回から間隔を空けていない
+ *           フレームは取っておき、他のPanel宛ては先に送る(列の先頭で待たない)。
+ *           同じPanel宛ての順序は変えない(取っておいたフレームを追い越さない)。
+ *           時刻は引数で受け取り、RTOSに依存しない(CAN_txタスクだけが呼ぶ)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <string.h>
+
+#include "ctrl_group.h"
+#include "drv_canpace.h"
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static int64_t prvPaceReadyUs(const canPace_t *pxPace, uint32_t ulMask);
+static void prvPaceMark(canPace_t *pxPace, uint32_t ulMask, int64_t llNowUs);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 初期化(全Panelがすぐ送れる、間隔待ちなし)
+ *
+ * @param    pxPace: 送信間隔の状態
+ * @param    llGapUs: 同じPanel宛ての間隔[us]
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vCanPaceInit(canPace_t *pxPace, int64_t llGapUs)
+{
+    memset(pxPace, 0x00, sizeof(canPace_t));
+    pxPace->llGapUs = llGapUs;
+}
+
+/*****************************************************************************/
+/**
+ * 宛先が送れるか(取っておいたフレームは見ない)
+ * 送れるなら宛先の次に送れる時刻を進める。
+ *
+ * @param    pxPace: 送信間隔の状態
+ * @param    ulCanId: 送信先のCAN ID
+ * @param    llNowUs: 現在時刻[us]
+ * @param    pllReadyUs: 宛先が送れる時刻[us]の格納先
+ *
+ * @return   pdTRUE: 今送る / pdFALSE: *pllReadyUsまで待つ
+ *
+ * @note     時刻同期、配送確認の再送に使う(待たずに戻る)
+ *
+ ******************************************************************************/
+BOOL_t xCanPaceTake(canPace_t *pxPace, uint32_t ulCanId, int64_t llNowUs, int64_t *pllReadyUs)
+{
+    uint32_t ulMask = ulGroupPanelMask(ulCanId);
+
+    *pllReadyUs = prvPaceReadyUs(pxPace, ulMask);
+    if (llNowUs < *pllReadyUs)
+        return pdFALSE;
+    prvPaceMark(pxPace, ulMask, llNowUs);
+    return pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * 新しいフレームの送信判定
+ * 宛先が送れて、取っておいたフレーム／ulHoldMaskと宛先が重ならなければ今送る。
+ * それ以外は取っておく(xCanPacePopで取り出す)。
+ *
+ * @param    pxPace: 送信間隔の状態
+ * @param    pxMsg: 送るフレーム
+ * @param    ulHoldMask: 今は送らない宛先(時刻同期の間隔待ちなど)
+ * @param    llNowUs: 現在時刻[us]
+ *
+ * @return   pdTRUE: 今送る / pdFALSE: 取っておいた
+ *
+ * @note     取っておく場所があること(xCanPaceFull)を確かめてから呼ぶ。
+ *           無ければ取っておかずに今送る(順序より捨てないことを優先)
+ *
+ ******************************************************************************/
+BOOL_t xCanPaceSubmit(canPace_t *pxPace, const canCommMsg_t *pxMsg, uint32_t ulHoldMask,
+                      int64_t llNowUs)
+{
+    uint32_t ulMask = ulGroupPanelMask(pxMsg->ulCanId);
+    uint32_t ulBusy = ulHoldMask;
+
+    for (uint32_t i = 0; i < pxPace->ulDeferNum; i++)
+        ulBusy |= pxPace->ulDeferMask[i];
+
+    if (((ulMask & ulBusy) == 0 && llNowUs >= prvPaceReadyUs(pxPace, ulMask)) ||
+        pxPace->ulDeferNum >= CAN_PACE_DEFER_SIZE)
+    {
+        prvPaceMark(pxPace, ulMask, llNowUs);
+        return pdTRUE;
+    }
+    pxPace->xDefer[pxPace->ulDeferNum] = *pxMsg;
+    pxPace->ulDeferMask[pxPace->ulDeferNum] = ulMask;
+    pxPace->ulDeferNum++;
+    return pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 取っておいたフレームのうち、今送れるものを1つ取り出す
+ * 届いた順に見て、前に残っているフレームと宛先が重なるものは飛ばす。
+ *
+ * @param    pxPace: 送信間隔の状態
+ * @param    ulHoldMask: 今は送らない宛先
+ * @param    llNowUs: 現在時刻[us]
+ * @param    pxMsg: 取り出したフレームの格納先
+ *
+ * @return   pdTRUE: 取り出した(今送る) / pdFALSE: 送れるものが無い
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+BOOL_t xCanPacePop(canPace_t *pxPace, uint32_t ulHoldMask, int64_t llNowUs,
+                   canCommMsg_t *pxMsg)
+{
+    uint32_t ulBusy = ulHoldMask;
+    uint32_t ulMask;
+
+    for (uint32_t i = 0; i < pxPace->ulDeferNum; i++)
+    {
+        ulMask = pxPace->ulDeferMask[i];
+        if ((ulMask & ulBusy) != 0 || llNowUs < prvPaceReadyUs(pxPace, ulMask))
+        {
+            ulBusy |= ulMask;
+            continue;
+        }
+        *pxMsg = pxPace->xDefer[i];
+        prvPaceMark(pxPace, ulMask, llNowUs);
+
+        // 後ろを詰める(届いた順を保つ)
+        pxPace->ulDeferNum--;
+        memmove(&pxPace->xDefer[i], &pxPace->xDefer[i + 1],
+                (pxPace->ulDeferNum - i) * sizeof(pxPace->xDefer[0]));
+        memmove(&pxPace->ulDeferMask[i], &pxPace->ulDeferMask[i + 1],
+                (pxPace->ulDeferNum - i) * sizeof(pxPace->ulDeferMask[0]));
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 取っておいたフレームが次に送れる時刻
+ *
+ * @param    pxPace: 送信間隔の状態
+ * @param    ulHoldMask: 今は送らない宛先
+ *
+ * @return   int64_t 時刻[us](INT64_MAX: 取っておいたフレームが無い／全て止めている)
+ *
+ * @note     前のフレームと宛先が重なるものは、前のフレームを送った後に見直す
+ *
+ ******************************************************************************/
+int64_t llCanPaceNextUs(const canPace_t *pxPace, uint32_t ulHoldMask)
+{
+    uint32_t ulBusy = ulHoldMask;
+    int64_t llNextUs = INT64_MAX;
+    int64_t llReadyUs;
+
+    for (uint32_t i = 0; i < pxPace->ulDeferNum; i++)
+    {
+        if ((pxPace->ulDeferMask[i] & ulBusy) == 0)
+        {
+            llReadyUs = prvPaceReadyUs(pxPace, pxPace->ulDeferMask[i]);
+            if (llReadyUs < llNextUs)
+                llNextUs = llReadyUs;
+        }
+        ulBusy |= pxPace->ulDeferMask[i];
+    }
+    return llNextUs;
+}
+
+/*****************************************************************************/
+/**
+ * 取っておく場所が無いか
+ *
+ * @param    pxPace: 送信間隔の状態
+ *
+ * @return   pdTRUE: 無い(新しいフレームを受け取らない) / pdFALSE: ある
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+BOOL_t xCanPaceFull(const canPace_t *pxPace)
+{
+    return pxPace->ulDeferNum >= CAN_PACE_DEFER_SIZE ? pdTRUE : pdFALSE;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/* 宛先の全Panelが送れる時刻 */
+static int64_t prvPaceReadyUs(const canPace_t *pxPace, uint32_t ulMask)
+{
+    int64_t llReadyUs = 0;
+
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((ulMask & (1UL << i)) != 0 && pxPace->llReadyUs[i] > llReadyUs)
+            llReadyUs = pxPace->llReadyUs[i];
+    }
+    return llReadyUs;
+}
+
+/* 宛先の全Panelの次に送れる時刻を進める */
+static void prvPaceMark(canPace_t *pxPace, uint32_t ulMask, int64_t llNowUs)
+{
+    for (uint32_t i = PANEL_1; i < MAX_PANEL_NUM; i++)
+    {
+        if ((ulMask & (1UL << i)) != 0)
+            pxPace->llReadyUs[i] = llNowUs + pxPace->llGapUs;
+    }
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************/
+/**
+ * @file drv_canpace.h
+ * @comments CAN送信の宛先Panel毎の間隔(configCAN_PANEL_GAP_MS)と間隔待ちのフレーム
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_DRV_CANPACE_H
+#define SRC_DRV_CANPACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define CAN_PACE_DEFER_SIZE 8 // 取っておける間隔待ちのフレーム数
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * 送信間隔の状態
+ * [0]は空とし、PanelIDと対応させる。間隔待ちのフレームは届いた順に並べる。
+ */
+typedef struct CAN_PACE
+{
+    int64_t llGapUs;                          // 同じPanel宛ての間隔[us]
+    int64_t llReadyUs[MAX_PANEL_NUM];         // Panel毎の次に送れる時刻[us]
+    canCommMsg_t xDefer[CAN_PACE_DEFER_SIZE]; // 間隔待ちのフレーム
+    uint32_t ulDeferMask[CAN_PACE_DEFER_SIZE]; // その宛先(bit = PanelID)
+    uint32_t ulDeferNum;
+} canPace_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vCanPaceInit(canPace_t *pxPace, int64_t llGapUs);
+BOOL_t xCanPaceTake(canPace_t *pxPace, uint32_t ulCanId, int64_t llNowUs, int64_t *pllReadyUs);
+BOOL_t xCanPaceSubmit(canPace_t *pxPace, const canCommMsg_t *pxMsg, uint32_t ulHoldMask,
+                      int64_t llNowUs);
+BOOL_t xCanPacePop(canPace_t *pxPace, uint32_t ulHoldMask, int64_t llNowUs,
+                   canCommMsg_t *pxMsg);
+int64_t llCanPaceNextUs(const canPace_t *pxPace, uint32_t ulHoldMask);
+BOOL_t xCanPaceFull(const canPace_t *pxPace);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -40,6 +40,9 @@
 /* User Includes */
 #include "def_system.h"
 #include "drv_dfplayer.h"
+#include "util_rec.h"
+#include "util_ring.h"
+#include "util_trace.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -48,9 +51,16 @@
 #define tskstacDRV_DFPTASK 4096
 #define tskprioDRV_DFPTASK 9
 
-/* Queue Configure */
+/*
+ * Queue Configure (SPSC Ring)
+ * SEQ: Producer CtrlTxタスク(エントリー／カウントダウン／終了)
+ * HIT: Producer CtrlRxタスク(押下音／ピンチ、遅れた古い音は捨てる)
+ */
 #define QUEUE_DFPLAYER_SIZE 2
 #define QUEUE_DFPLAYER_WAIT portMAX_DELAY
+#define QUEUE_DFPLAYER_POLICY RING_POLICY_BLOCK
+#define QUEUE_DFPLAYER_HIT_SIZE 4
+#define QUEUE_DFPLAYER_HIT_POLICY RING_POLICY_DROP_OLDEST
 
 /* ESPLOGGER Configure */
 #define LOG_TAG "DFPlayer"
@@ -63,8 +73,9 @@
 // Task Handler
 TaskHandle_t xDfplayerTask;
 
-// Queue
-QueueHandle_t xDfplayerQueue = NULL;
+// Ring
+static SpscRing<dfpCtrlMsg_t, QUEUE_DFPLAYER_SIZE> xDfplayerRing;
+static SpscRing<dfpCtrlMsg_t, QUEUE_DFPLAYER_HIT_SIZE> xDfplayerHitRing;
 
 // DFPlayer Def
 // HardwareSerial Serial2(2);
@@ -102,9 +113,9 @@ esp_err_t lInitDfplayer()
     ESP_LOGI(LOG_TAG, "DFPlayer Init");
     DFPlayer.volume(DFPLAYER_DEFAULT_VOLUME);
 
-    // Create Queue
-    xDfplayerQueue = xQueueCreate(QUEUE_DFPLAYER_SIZE, sizeof(dfpCtrlMsg_t));
-    configASSERT(xDfplayerQueue);
+    // Create Ring
+    xDfplayerRing.vInit(QUEUE_DFPLAYER_POLICY, "xDfplayerRing");
+    xDfplayerHitRing.vInit(QUEUE_DFPLAYER_HIT_POLICY, "xDfplayerHitRing");
 
     // Create Task
     xStatus = xTaskCreatePinnedToCore(prvDfplayerTask, "CAN_rx", tskstacDRV_DFPTASK, NULL,
@@ -122,13 +133,32 @@ esp_err_t lInitDfplayer()
 *
 * @return   pdPASS / pdFAIL
 * 		
-* @note		##
+* @note		CtrlTxタスクからのみ呼ぶこと(SPSC)
 *
 ******************************************************************************/
 BOOL_t xSendDfplayerQueue(dfpCtrlMsg_t dfpCtrlMsg)
 {
     BOOL_t xStatus;
-    xStatus = xQueueSendToBack(xDfplayerQueue, &dfpCtrlMsg, portMAX_DELAY);
+    xStatus = xDfplayerRing.xSend(dfpCtrlMsg, QUEUE_DFPLAYER_WAIT);
+    return xStatus;
+}
+
+/*****************************************************************************/
+/**
+* ゲーム中の効果音を送信
+*
+* @param    dfpCtrlMsg_t：再生する効果音
+*
+* @return   pdPASS / pdFAIL
+* 		
+* @note		CtrlRxタスクからのみ呼ぶこと(SPSC)
+*           待たない。再生が追いつかないときは古い音を捨てる。
+*
+******************************************************************************/
+BOOL_t xSendDfplayerHitQueue(dfpCtrlMsg_t dfpCtrlMsg)
+{
+    BOOL_t xStatus;
+    xStatus = xDfplayerHitRing.xSend(dfpCtrlMsg, 0);
     return xStatus;
 }
 
@@ -150,14 +180,16 @@ BOOL_t xSendDfplayerQueue(dfpCtrlMsg_t dfpCtrlMsg)
 static void prvDfplayerTask(void *pvParameters)
 {
     dfpCtrlMsg_t dfpCtrlMsg = {};
+    // ゲーム中の効果音を先に見る
+    ring_t *const pxRing[] = {xDfplayerHitRing.pxHandle(), xDfplayerRing.pxHandle()};
 
     // Set Volume
     DFPlayer.volume(DFPLAYER_DEFAULT_VOLUME);
 
     for (;;)
     {
-        // Queue Wait
-        xQueueReceive(xDfplayerQueue, &dfpCtrlMsg, QUEUE_DFPLAYER_WAIT);
+        // Ring Wait
+        lRingReceiveAny(pxRing, 2, &dfpCtrlMsg, QUEUE_DFPLAYER_WAIT);
         ESP_LOGI(LOG_TAG, "dfpCtrlMsg = {.uiVolume = %d, .eSound = %d",
                  dfpCtrlMsg.uiVolume, dfpCtrlMsg.eSound);
 
@@ -166,6 +198,8 @@ static void prvDfplayerTask(void *pvParameters)
 
         // Play Sound
         DFPlayer.play(dfpCtrlMsg.eSound);
+        vTracePoint(TP_DFP_PLAY, 0);
+        vRecEvent(REC_SE, (uint8_t)dfpCtrlMsg.eSound, 0, NULL, 0);
 
         // ねんのため
         vTaskDelay(pdMS_TO_TICKS(10));
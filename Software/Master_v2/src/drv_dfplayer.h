@@ -60,6 +60,7 @@ extern "C"
     // Init
     esp_err_t lInitDfplayer();
     BOOL_t xSendDfplayerQueue(dfpCtrlMsg_t dfpCtrlMsg);
+    BOOL_t xSendDfplayerHitQueue(dfpCtrlMsg_t dfpCtrlMsg);
 
 #ifdef __cplusplus
 }
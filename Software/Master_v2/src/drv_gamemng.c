@@ -54,6 +54,12 @@
 #include "def_system.h"
 #include "drv_gamemng.h"
 #include "ctrl_main.h"
+#include "ctrl_dfclt.h"
+#include "drv_can.h"
+#include "drv_canfw.h"
+#include "util_diag.h"
+#include "util_rec.h"
+#include "util_trace.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -78,13 +84,28 @@ tcpip_adapter_ip_info_t sIpinfo = {
 
 #define WEBSERVER_POSTDATA_SIZE 1024
 
+/* Trace Configration */
+#define GAMEMNG_TRACE_SIZE 1280
+
+/* Recorder Configration */
+#define GAMEMNG_REC_CHUNK 32 // 1回に読み出すイベント数
+#define GAMEMNG_REC_SEND_RETRY 200
+#define GAMEMNG_REC_SEND_WAIT pdMS_TO_TICKS(10)
+
 /* JSMN Configration */
-#define JSMN_TOKENS_NUM 32
+#define JSMN_TOKENS_NUM 48 // エントリー配列(configZONE_MAX人)が入る数
 
 /* TX_MSG */
 const char *CMD_GMMSG_FIN_PREPARE = "esp_wait";
 const char *CMD_GMMSG_GAME_START = "esp_gamestart";
 const char *CMD_GMMSG_PLAYER_ENTRY = "esp_playerEntry";
+const char *CMD_GMMSG_TRACE = "esp_trace "; // 後ろにJSONが続く
+const char *CMD_GMMSG_TUNE_OK = "esp_tune";
+const char *CMD_GMMSG_REC = "esp_rec "; // 後ろにバイト数と改行、バイナリが続く
+const char *CMD_GMMSG_PANELS = "esp_panels "; // 後ろにJSON(パネルの死活)が続く
+const char *CMD_GMMSG_DIAG = "esp_diag "; // 後ろにバイト数と改行、バイナリが続く
+const char *CMD_GMMSG_FWUP_OK = "esp_fwup";
+const char *CMD_GMMSG_FWUP = "esp_fwup_result "; // 後ろにJSON(配信の結果)が続く
 
 const char *CMD_GMMSG_FAIL = "Bad command";
 
@@ -117,6 +138,13 @@ static esp_err_t event_handler(void *ctx, system_event_t *event);
 static void wait_for_ip();
 
 BOOL_t prvParsePlayerInfo(char *buf, int len);
+static int prvParsePlayerObj(const char *buf, jsmntok_t *tokens, int r,
+                             int iObj, playerInfo_t *pxPlayer);
+BOOL_t prvParseDfcltTune(char *buf, int len);
+BOOL_t prvParseFwup(char *buf, int len);
+static int prvSendAll(int sock, const void *pvData, size_t xLen);
+static int prvSendRecording(int sock);
+static int prvSendDiag(int sock);
 
 /*****************************************************************************/
 /* Public Function
@@ -275,6 +303,7 @@ static void http_client_task(void *pvParameters)
     bool bRetryFlag = false;
     bool RetryCnt = 0;
     char post_data[WEBSERVER_POSTDATA_SIZE] = {};
+    int iPostLen;
     esp_http_client_config_t config = {
         .host = WEBSERVER_HOSTNAME,
         .path = WEBSERVER_POST_DEST,
@@ -305,10 +334,22 @@ static void http_client_task(void *pvParameters)
         // postするデータを格納
         sprintf(post_data,
                 "team=%d&difficulty=%d&name=%s&redPoint=%d&"
-                "bluePoint=%d&greenPoint=%d&hitPoint=%d&remainingTime=%d",
+                "bluePoint=%d&greenPoint=%d&hitPoint=%d&remainingTime=%d&zone=%d",
                 sGameInfo.team, sGameInfo.difficuty, sGameInfo.name,
                 sGameInfo.redPoint, sGameInfo.bluePoint, sGameInfo.greenPoint,
-                sGameInfo.hitPoint, sGameInfo.remainingTime);
+                sGameInfo.hitPoint, sGameInfo.remainingTime, sGameInfo.zone);
+        // レイテンシトレースを付加
+        // トレースは盤面全体の1ゲーム分なので、区画0のPOSTにだけ付ける(区画毎に重複させない)
+        if (sGameInfo.zone == 0)
+        {
+            iPostLen = strlen(post_data);
+            iPostLen += snprintf(post_data + iPostLen, sizeof(post_data) - iPostLen,
+                                 "&trace=");
+            if (iPostLen < (int)sizeof(post_data))
+            {
+                lTraceFormatForm(post_data + iPostLen, sizeof(post_data) - iPostLen);
+            }
+        }
         // const char *post_data = "field1=value1&field2=value2";
         ESP_LOGI(TAG, "send | %s", post_data);
 
@@ -356,11 +397,14 @@ static void http_client_task(void *pvParameters)
  ******************************************************************************/
 static void tcp_server_task(void *pvParameters)
 {
-    char rx_buffer[128];
+    char rx_buffer[512]; // エントリー配列(configZONE_MAX人)が入る大きさ
     char addr_str[128];
     int addr_family;
     int ip_protocol;
     enum MSG_TYPE eTxMsg;
+    static char cTraceBuf[GAMEMNG_TRACE_SIZE];
+    static liveTbl_t xLiveTbl;
+    int iTraceLen;
 
     while (1)
     { // Task Loop
@@ -461,8 +505,50 @@ static void tcp_server_task(void *pvParameters)
                                         // and treat like a string
                     ESP_LOGI(TAG, "Received %d bytes from %s:", len, addr_str);
 
+                    // 難易度調整("tune"キーあり)
+                    if (strstr(rx_buffer, "\"tune\"") != NULL)
+                    {
+                        if (prvParseDfcltTune(rx_buffer, len) == pdPASS)
+                        {
+                            err = send(sock, CMD_GMMSG_TUNE_OK,
+                                       strlen(CMD_GMMSG_TUNE_OK), 0);
+                        }
+                        else
+                        {
+                            ESP_LOGE(TAG, "Cannot Parse tune.");
+                            err = send(sock, CMD_GMMSG_FAIL,
+                                       strlen(CMD_GMMSG_FAIL), 0);
+                        }
+                        if (err < 0)
+                        {
+                            ESP_LOGE(TAG,
+                                     "Error occured during sending: errno %d",
+                                     errno);
+                        }
+                    }
+                    // Panelのファームウェア配信("fwup"キーあり)
+                    else if (strstr(rx_buffer, "\"fwup\"") != NULL)
+                    {
+                        if (prvParseFwup(rx_buffer, len) == pdPASS)
+                        {
+                            err = send(sock, CMD_GMMSG_FWUP_OK,
+                                       strlen(CMD_GMMSG_FWUP_OK), 0);
+                        }
+                        else
+                        {
+                            ESP_LOGE(TAG, "Cannot start fwup.");
+                            err = send(sock, CMD_GMMSG_FAIL,
+                                       strlen(CMD_GMMSG_FAIL), 0);
+                        }
+                        if (err < 0)
+                        {
+                            ESP_LOGE(TAG,
+                                     "Error occured during sending: errno %d",
+                                     errno);
+                        }
+                    }
                     // parse Player Infomation & Send Main
-                    if (prvParsePlayerInfo(rx_buffer, len) != pdPASS)
+                    else if (prvParsePlayerInfo(rx_buffer, len) != pdPASS)
                     {
                         ESP_LOGE(TAG, "Cannot Parse recvData.");
                         err = send(sock, CMD_GMMSG_FAIL, strlen(CMD_GMMSG_FAIL),
@@ -498,6 +584,34 @@ static void tcp_server_task(void *pvParameters)
                         err = send(sock, CMD_GMMSG_PLAYER_ENTRY,
                                    strlen(CMD_GMMSG_PLAYER_ENTRY), 0);
                         break;
+                    case GMMSG_TRACE:
+                        iTraceLen = snprintf(cTraceBuf, sizeof(cTraceBuf), "%s",
+                                             CMD_GMMSG_TRACE);
+                        iTraceLen += lTraceFormatJson(cTraceBuf + iTraceLen,
+                                                      sizeof(cTraceBuf) - iTraceLen);
+                        err = send(sock, cTraceBuf, iTraceLen, 0);
+                        break;
+                    case GMMSG_REC:
+                        err = prvSendRecording(sock);
+                        break;
+                    case GMMSG_DIAG:
+                        err = prvSendDiag(sock);
+                        break;
+                    case GMMSG_PANELS:
+                        ulCanGetLive(&xLiveTbl);
+                        iTraceLen = snprintf(cTraceBuf, sizeof(cTraceBuf), "%s",
+                                             CMD_GMMSG_PANELS);
+                        iTraceLen += lLiveTblFormatJson(&xLiveTbl, cTraceBuf + iTraceLen,
+                                                        sizeof(cTraceBuf) - iTraceLen);
+                        err = send(sock, cTraceBuf, iTraceLen, 0);
+                        break;
+                    case GMMSG_FWUP:
+                        iTraceLen = snprintf(cTraceBuf, sizeof(cTraceBuf), "%s",
+                                             CMD_GMMSG_FWUP);
+                        iTraceLen += lCanFwFormatJson(cTraceBuf + iTraceLen,
+                                                      sizeof(cTraceBuf) - iTraceLen);
+                        err = send(sock, cTraceBuf, iTraceLen, 0);
+                        break;
                     default:
                         ESP_LOGE(TAG, "Not exist GMMSG");
                         break;
@@ -530,6 +644,137 @@ static void tcp_server_task(void *pvParameters)
     vTaskDelete(NULL);
 }
 
+/*****************************************************************************/
+/**
+ * 全部送る(ノンブロッキングソケット用)
+ *
+ * @param	sock: ソケット
+ * @param   pvData / xLen: 送信データ
+ *
+ * @return  0 / -1(エラー、タイムアウト)
+ *
+ * @note    ##
+ *
+ ******************************************************************************/
+static int prvSendAll(int sock, const void *pvData, size_t xLen)
+{
+    const uint8_t *pbData = (const uint8_t *)pvData;
+    int lRetry = 0;
+    int err;
+
+    while (xLen > 0)
+    {
+        err = send(sock, pbData, xLen, 0);
+        if (err > 0)
+        {
+            pbData += err;
+            xLen -= err;
+            lRetry = 0;
+        }
+        else if (err < 0 && errno != EAGAIN)
+        {
+            return -1;
+        }
+        else if (++lRetry > GAMEMNG_REC_SEND_RETRY)
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+        else
+        {
+            vTaskDelay(GAMEMNG_REC_SEND_WAIT);
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/**
+ * 前回のゲームの記録を送信
+ * "esp_rec <バイト数>\n" + recHeader_t + recEvent_t * n
+ *
+ * @param	sock: ソケット
+ *
+ * @return  0 / -1(送信エラー)
+ *
+ * @note    記録がなければ何も送らない
+ *
+ ******************************************************************************/
+static int prvSendRecording(int sock)
+{
+    char cLine[32];
+    recHeader_t xHeader;
+    static recEvent_t xChunk[GAMEMNG_REC_CHUNK];
+    uint32_t ulIdx = 0;
+    uint32_t ulNum;
+    int err;
+
+    if (xRecSnapshot(&xHeader) != pdPASS)
+    {
+        ESP_LOGW(TAG, "No recording");
+        return 0;
+    }
+
+    snprintf(cLine, sizeof(cLine), "%s%u\n", CMD_GMMSG_REC,
+             (unsigned)(sizeof(xHeader) + xHeader.ulCount * sizeof(recEvent_t)));
+    err = prvSendAll(sock, cLine, strlen(cLine));
+    if (err == 0)
+        err = prvSendAll(sock, &xHeader, sizeof(xHeader));
+    while (err == 0 &&
+           (ulNum = ulRecRead(ulIdx, xChunk, GAMEMNG_REC_CHUNK)) > 0)
+    {
+        err = prvSendAll(sock, xChunk, ulNum * sizeof(recEvent_t));
+        ulIdx += ulNum;
+    }
+    vRecRelease();
+
+    ESP_LOGI(TAG, "Recording sent | game:%u events:%u dropped:%u",
+             xHeader.ulGame, xHeader.ulCount, xHeader.ulDropped);
+    return err;
+}
+
+/*****************************************************************************/
+/**
+ * 診断ログを送信
+ * "esp_diag <バイト数>\n" + diagHeader_t + diagEvent_t * n
+ *
+ * @param	sock: ソケット
+ *
+ * @return  0 / -1(送信エラー)
+ *
+ * @note    前回の送信から記録がなければ何も送らない
+ *
+ ******************************************************************************/
+static int prvSendDiag(int sock)
+{
+    char cLine[32];
+    diagHeader_t xHeader;
+    static diagEvent_t xChunk[GAMEMNG_REC_CHUNK];
+    uint32_t ulIdx = 0;
+    uint32_t ulNum;
+    int err;
+
+    if (xDiagSnapshot(&xHeader) != pdPASS)
+        return 0;
+
+    snprintf(cLine, sizeof(cLine), "%s%u\n", CMD_GMMSG_DIAG,
+             (unsigned)(sizeof(xHeader) + xHeader.ulCount * sizeof(diagEvent_t)));
+    err = prvSendAll(sock, cLine, strlen(cLine));
+    if (err == 0)
+        err = prvSendAll(sock, &xHeader, sizeof(xHeader));
+    while (err == 0 &&
+           (ulNum = ulDiagRead(ulIdx, xChunk, GAMEMNG_REC_CHUNK)) > 0)
+    {
+        err = prvSendAll(sock, xChunk, ulNum * sizeof(diagEvent_t));
+        ulIdx += ulNum;
+    }
+    vDiagRelease();
+
+    ESP_LOGI(TAG, "Diagnostics sent | events:%u dropped:%u",
+             xHeader.ulCount, xHeader.ulDropped);
+    return err;
+}
+
 /*****************************************************************************/
 /**
  * プレイヤー情報のパース（JSON）
@@ -552,11 +797,27 @@ static int jsoneq(const char *json, jsmntok_t *tok, const char *s)
     return -1;
 }
 
+/*****************************************************************************/
+/**
+ * プレイヤー情報のパース（JSON）
+ *  {"startFlag":true,"name":"..","team":1,"difficulty":2}
+ *  同じ回に複数人で遊ぶときは配列で送る(最大configZONE_MAX人)
+ *  [{"startFlag":true,..},{"startFlag":true,..}]
+ *
+ * @param	buf: 受信データ
+ * @param   len: 受信データ長
+ *
+ * @return  pdPASS / pdFAIL
+ *
+ * @note    全員パースできて、Queueに全員分の空きがあるときだけctrl_mainへ送る
+ *          (途中で失敗したら誰も送らない)
+ *
+ ******************************************************************************/
 BOOL_t prvParsePlayerInfo(char *buf, int len)
 {
-    // BOOL_t xStatus = pdFAIL;
-    char strBuf[128] = {};
-    playerInfo_t player = {};
+    playerInfo_t player[configZONE_MAX] = {};
+    int iPlayerNum = 0;
+    int iTok;
 
     /* JSON Parse用 */
     jsmn_parser json;
@@ -575,88 +836,342 @@ BOOL_t prvParsePlayerInfo(char *buf, int len)
         return pdFAIL;
     }
 
-    /* Assume the top-level element is an object */
-    if (r < 1 || tokens[0].type != JSMN_OBJECT)
+    /* Assume the top-level element is an object or an array of objects */
+    if (r < 1)
+    {
+        ESP_LOGE(TAG, "JSON: Not Json Object");
+        return pdFAIL;
+    }
+    if (tokens[0].type == JSMN_OBJECT)
+    {
+        if (prvParsePlayerObj(buf, tokens, r, 0, &player[0]) != r)
+            return pdFAIL;
+        iPlayerNum = 1;
+    }
+    else if (tokens[0].type == JSMN_ARRAY)
+    {
+        if (tokens[0].size < 1 || configZONE_MAX < tokens[0].size)
+        {
+            ESP_LOGE(TAG, "JSON: Entry num: ERROR_NUM->%d", tokens[0].size);
+            return pdFAIL;
+        }
+        iTok = 1;
+        for (iPlayerNum = 0; iPlayerNum < tokens[0].size; iPlayerNum++)
+        {
+            iTok = prvParsePlayerObj(buf, tokens, r, iTok, &player[iPlayerNum]);
+            if (iTok < 0)
+                return pdFAIL;
+        }
+        if (iTok != r)
+        {
+            ESP_LOGE(TAG, "JSON: Entry is not an object");
+            return pdFAIL;
+        }
+    }
+    else
     {
         ESP_LOGE(TAG, "JSON: Not Json Object");
         return pdFAIL;
     }
 
-    /* Loop over all keys of the root object */
-    for (int i = 1; i < r; i++)
+    // ctrl_mainへ送信(Queueに全員分の空きがなければ誰も送らない)
+    if (xSendPlayerInfoSet(player, (uint32_t)iPlayerNum) != pdPASS)
     {
-        if (jsoneq(buf, &tokens[i], "startFlag") == 0)
+        ESP_LOGE(TAG, "JSON: Entry queue full num:%d", iPlayerNum);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * プレイヤー情報1人分のパース
+ *
+ * @param	buf: 受信データ
+ * @param   tokens / r: パース結果とトークン数
+ * @param   iObj: オブジェクトのトークン位置
+ * @param   pxPlayer: 格納先
+ *
+ * @return  int 次のトークン位置 / -1:失敗
+ *
+ * @note    値はプリミティブか文字列のみ(入れ子なし)
+ *
+ ******************************************************************************/
+static int prvParsePlayerObj(const char *buf, jsmntok_t *tokens, int r,
+                             int iObj, playerInfo_t *pxPlayer)
+{
+    char strBuf[128] = {};
+    int iEnd;
+    int iLen;
+    int i;
+
+    if (iObj >= r || tokens[iObj].type != JSMN_OBJECT)
+    {
+        ESP_LOGE(TAG, "JSON: Not Json Object");
+        return -1;
+    }
+    iEnd = iObj + 1 + tokens[iObj].size * 2;
+    if (iEnd > r)
+    {
+        ESP_LOGE(TAG, "JSON: Object truncated");
+        return -1;
+    }
+
+    /* Loop over all keys of the object */
+    for (i = iObj + 1; i < iEnd; i++)
+    {
+        iLen = tokens[i + 1].end - tokens[i + 1].start;
+        if (iLen < 0 || (int)sizeof(strBuf) <= iLen)
         {
-            strncpy(strBuf, buf + tokens[i + 1].start,
-                    tokens[i + 1].end - tokens[i + 1].start);
+            ESP_LOGE(TAG, "JSON: Value too long");
+            return -1;
+        }
+        memset(strBuf, 0x00, sizeof(strBuf));
+        strncpy(strBuf, buf + tokens[i + 1].start, iLen);
 
+        if (jsoneq(buf, &tokens[i], "startFlag") == 0)
+        {
             switch (strBuf[0])
             { // StartFlag
             case 't':
             case '1':
-                player.startFlg = pdTRUE;
+                pxPlayer->startFlg = pdTRUE;
                 break;
             case 'f':
             case '0':
-                player.startFlg = pdFALSE;
+                pxPlayer->startFlg = pdFALSE;
                 break;
             default:
                 ESP_LOGE(TAG, "JSON: Obj: startFlag: ERROR_NUM->%d",
-                         player.startFlg);
-                return pdFAIL;
+                         pxPlayer->startFlg);
+                return -1;
                 break;
             }
 
             ESP_LOGI(TAG, "JSON: Obj: startFlag: %s",
-                     player.startFlg ? "true" : "false");
+                     pxPlayer->startFlg ? "true" : "false");
             i++;
         }
         else if (jsoneq(buf, &tokens[i], "name") == 0)
         {
-            strncpy(player.name, buf + tokens[i + 1].start,
-                    tokens[i + 1].end - tokens[i + 1].start);
-            ESP_LOGI(TAG, "JSON: Obj: name: %s", player.name);
+            snprintf(pxPlayer->name, sizeof(pxPlayer->name), "%s", strBuf);
+            ESP_LOGI(TAG, "JSON: Obj: name: %s", pxPlayer->name);
             i++;
         }
         else if (jsoneq(buf, &tokens[i], "difficulty") == 0)
         {
-            strncpy(strBuf, buf + tokens[i + 1].start,
-                    tokens[i + 1].end - tokens[i + 1].start);
-            player.difficulty = atoi(strBuf);
+            pxPlayer->difficulty = atoi(strBuf);
 
             /* 難易度が正しい値か */
-            if (player.difficulty < DFCLT_EASY ||
-                MAX_DFCLT < player.difficulty)
+            if (pxPlayer->difficulty < DFCLT_EASY ||
+                MAX_DFCLT <= pxPlayer->difficulty)
             {
                 ESP_LOGE(TAG, "JSON: Obj: difficulty: ERROR_NUM->%d",
-                         player.difficulty);
-                return pdFAIL;
+                         pxPlayer->difficulty);
+                return -1;
             }
             else
             {
-                ESP_LOGI(TAG, "JSON: Obj: difficulty: %d", player.difficulty);
+                ESP_LOGI(TAG, "JSON: Obj: difficulty: %d", pxPlayer->difficulty);
                 i++;
             }
         }
         else if (jsoneq(buf, &tokens[i], "team") == 0)
         {
-            strncpy(strBuf, buf + tokens[i + 1].start,
-                    tokens[i + 1].end - tokens[i + 1].start);
-            player.team = atoi(strBuf);
+            pxPlayer->team = atoi(strBuf);
 
             /* チームがが正しい値か */
-            if (player.team < TEAM_RED || MAX_TEAM < player.team)
+            if (pxPlayer->team < TEAM_RED || MAX_TEAM < pxPlayer->team)
             {
-                ESP_LOGE(TAG, "JSON: Obj: team: ERROR_NUM->%d", player.team);
-                return pdFAIL;
+                ESP_LOGE(TAG, "JSON: Obj: team: ERROR_NUM->%d", pxPlayer->team);
+                return -1;
             }
             else
             {
-                ESP_LOGI(TAG, "JSON: Obj: team: %d", player.team);
+                ESP_LOGI(TAG, "JSON: Obj: team: %d", pxPlayer->team);
                 i++;
             }
         }
         else
+        {
+            ESP_LOGI(TAG, "Unexpected key: %.*s",
+                     tokens[i].end - tokens[i].start, buf + tokens[i].start);
+            return -1;
+        }
+    }
+    return iEnd;
+}
+
+/*****************************************************************************/
+/**
+ * 難易度プロファイル上書きのパース（JSON）
+ *  {"tune":2,"spawnMs":1000,"lightMs":2000,"speedupPct":80,
+ *   "hpStrong":1,"hpSame":0,"hpWeak":-1}
+ *  {"tune":2,"reset":1} で既定値に戻す
+ *  指定しなかった項目は現在の値のまま
+ *
+ * @param	buf: 受信データ
+ * @param   len: 受信データ長
+ *
+ * @return  pdPASS / pdFAIL
+ *
+ * @note    反映は次のゲーム開始時
+ *
+ ******************************************************************************/
+BOOL_t prvParseDfcltTune(char *buf, int len)
+{
+    char strBuf[16];
+    eDfclt_t eDfclt = MAX_DFCLT;
+    dfcltProfile_t xProfile;
+    BOOL_t xReset = pdFALSE;
+    int lValue;
+
+    /* JSON Parse用 */
+    jsmn_parser json;
+    jsmntok_t tokens[JSMN_TOKENS_NUM] = {};
+    int r = 0;
+
+    jsmn_init(&json);
+    r = jsmn_parse(&json, buf, len, tokens, JSMN_TOKENS_NUM);
+    if (r < 1 || tokens[0].type != JSMN_OBJECT)
+    {
+        ESP_LOGE(TAG, "JSON: Failed JSON Parse errno:%d", r);
+        return pdFAIL;
+    }
+
+    /* 難易度を先に探す(現在の値を土台にするため) */
+    for (int i = 1; i + 1 < r; i += 2)
+    {
+        if (jsoneq(buf, &tokens[i], "tune") == 0)
+        {
+            memset(strBuf, 0, sizeof(strBuf));
+            strncpy(strBuf, buf + tokens[i + 1].start,
+                    MIN(tokens[i + 1].end - tokens[i + 1].start,
+                        (int)sizeof(strBuf) - 1));
+            eDfclt = atoi(strBuf);
+        }
+    }
+    if (eDfclt < DFCLT_EASY || MAX_DFCLT <= eDfclt)
+    {
+        ESP_LOGE(TAG, "JSON: Obj: tune: ERROR_NUM->%d", eDfclt);
+        return pdFAIL;
+    }
+    vDfcltGetProfile(eDfclt, &xProfile);
+
+    for (int i = 1; i + 1 < r; i += 2)
+    {
+        memset(strBuf, 0, sizeof(strBuf));
+        strncpy(strBuf, buf + tokens[i + 1].start,
+                MIN(tokens[i + 1].end - tokens[i + 1].start,
+                    (int)sizeof(strBuf) - 1));
+        lValue = atoi(strBuf);
+
+        if (jsoneq(buf, &tokens[i], "tune") == 0)
+        {
+            continue;
+        }
+        else if (jsoneq(buf, &tokens[i], "reset") == 0)
+        {
+            xReset = (lValue != 0) ? pdTRUE : pdFALSE;
+        }
+        else if (jsoneq(buf, &tokens[i], "spawnMs") == 0)
+        {
+            xProfile.usSpawnMs = (uint16_t)MAX(0, MIN(lValue, UINT16_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "lightMs") == 0)
+        {
+            xProfile.usLightMs = (uint16_t)MAX(0, MIN(lValue, UINT16_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "speedupPct") == 0)
+        {
+            xProfile.bSpeedUpPct = (uint8_t)MAX(0, MIN(lValue, UINT8_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "hpStrong") == 0)
+        {
+            xProfile.cHpStrong = (int8_t)MAX(INT8_MIN, MIN(lValue, INT8_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "hpSame") == 0)
+        {
+            xProfile.cHpSame = (int8_t)MAX(INT8_MIN, MIN(lValue, INT8_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "hpWeak") == 0)
+        {
+            xProfile.cHpWeak = (int8_t)MAX(INT8_MIN, MIN(lValue, INT8_MAX));
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Unexpected key: %.*s",
+                     tokens[i].end - tokens[i].start, buf + tokens[i].start);
+            return pdFAIL;
+        }
+    }
+
+    if (xReset == pdTRUE)
+    {
+        vDfcltClearOverride(eDfclt);
+        return pdPASS;
+    }
+    return xDfcltSetOverride(eDfclt, &xProfile);
+}
+
+/*****************************************************************************/
+/**
+ * Panelのファームウェア配信の指示のパース（JSON）
+ *  {"fwup":1,"path":"/spiffs/panel_v2.bin","major":2,"minor":4}
+ *  pathを省略するとconfigCANFW_IMAGE_PATH、バージョンは省略すると0
+ *
+ * @param	buf: 受信データ
+ * @param   len: 受信データ長
+ *
+ * @return  pdPASS / pdFAIL(配信中、不正な指示)
+ *
+ * @note    結果は終わってからGMMSG_FWUPで送る
+ *
+ ******************************************************************************/
+BOOL_t prvParseFwup(char *buf, int len)
+{
+    char strBuf[configCANFW_PATH_LENGTH];
+    char cPath[configCANFW_PATH_LENGTH] = {};
+    int lMajor = 0;
+    int lMinor = 0;
+
+    /* JSON Parse用 */
+    jsmn_parser json;
+    jsmntok_t tokens[JSMN_TOKENS_NUM] = {};
+    int r = 0;
+
+    jsmn_init(&json);
+    r = jsmn_parse(&json, buf, len, tokens, JSMN_TOKENS_NUM);
+    if (r < 1 || tokens[0].type != JSMN_OBJECT)
+    {
+        ESP_LOGE(TAG, "JSON: Failed JSON Parse errno:%d", r);
+        return pdFAIL;
+    }
+
+    for (int i = 1; i + 1 < r; i += 2)
+    {
+        memset(strBuf, 0, sizeof(strBuf));
+        strncpy(strBuf, buf + tokens[i + 1].start,
+                MIN(tokens[i + 1].end - tokens[i + 1].start,
+                    (int)sizeof(strBuf) - 1));
+
+        if (jsoneq(buf, &tokens[i], "fwup") == 0)
+        {
+            continue;
+        }
+        else if (jsoneq(buf, &tokens[i], "path") == 0)
+        {
+            strcpy(cPath, strBuf);
+        }
+        else if (jsoneq(buf, &tokens[i], "major") == 0)
+        {
+            lMajor = MAX(0, MIN(atoi(strBuf), UINT8_MAX));
+        }
+        else if (jsoneq(buf, &tokens[i], "minor") == 0)
+        {
+            lMinor = MAX(0, MIN(atoi(strBuf), UINT8_MAX));
+        }
+        else
         {
             ESP_LOGI(TAG, "Unexpected key: %.*s",
                      tokens[i].end - tokens[i].start, buf + tokens[i].start);
@@ -664,8 +1179,7 @@ BOOL_t prvParsePlayerInfo(char *buf, int len)
         }
     }
 
-    // ctrl_mainへ送信
-    return xSendPlayerInfoQueue(player);
+    return xCanFwStart(cPath[0] != '\0' ? cPath : NULL, (uint8_t)lMajor, (uint8_t)lMinor);
 }
 
 /*****************************************************************************/
@@ -37,6 +37,11 @@ extern "C"
         GMMSG_GAME_START = 2,
         GMMSG_SCORE = 3,
         GMMSG_ENTRY = 4,
+        GMMSG_TRACE = 5,
+        GMMSG_REC = 6,
+        GMMSG_PANELS = 7,
+        GMMSG_DIAG = 8,
+        GMMSG_FWUP = 9,
         MAX_GMMSG,
     };
 
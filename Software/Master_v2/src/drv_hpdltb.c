@@ -22,6 +22,7 @@
 /* Standard Lib Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* ESP-IDF Includes */
 #include "driver/i2c.h"
@@ -31,6 +32,9 @@
 
 #include "def_system.h"
 #include "drv_hpdltb.h"
+#include "util_rec.h"
+#include "util_ring.h"
+#include "util_trace.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -39,9 +43,17 @@
 #define tskstacDRV_HPDLTB 4096
 #define tskprioDRV_HPDLTB 9
 
-/* Queue Configure */
+/*
+ * Queue Configure (SPSC Ring)
+ * SEQ : Producer CtrlTxタスク(待機／カウントダウン／終了表示)
+ * TICK: Producer タイマデーモン(ゲーム中の表示、最新値だけ分かればよい)
+ *       表示器(区画)毎に持つ(他の区画の表示で上書きしないため)
+ */
 #define QUEUE_HPDLTB_SIZE 16
 #define QUEUE_HPDLTB_WAIT portMAX_DELAY
+#define QUEUE_HPDLTB_POLICY RING_POLICY_BLOCK
+#define QUEUE_HPDLTB_TICK_SIZE 4
+#define QUEUE_HPDLTB_TICK_POLICY RING_POLICY_COALESCE
 
 /* I2C Configure */
 #define I2C_MASTER_SCL_IO GPIO_NUM_22 /*!< gpio number for I2C master clock */
@@ -58,7 +70,7 @@
 #define ACK_VAL 0x0                /*!< I2C ack value */
 #define NACK_VAL 0x1               /*!< I2C nack value */
 
-#define HPDLTB_ADDR 0x1E
+#define HPDLTB_ADDR 0x1E // 区画0, 区画nは +n
 
 static const char *TAG = "HPDLTB";
 
@@ -70,8 +82,12 @@ static const char *TAG = "HPDLTB";
 // Task Handler
 TaskHandle_t xHpdltbTask;
 
-// Queue
-QueueHandle_t xHpdltbQueue = NULL;
+// Ring
+static ring_t xHpdltbRing;
+static hpdltb_t xHpdltbRingBuf[QUEUE_HPDLTB_SIZE];
+static ring_t xHpdltbTickRing[configZONE_MAX];
+static hpdltb_t xHpdltbTickRingBuf[configZONE_MAX][QUEUE_HPDLTB_TICK_SIZE];
+static hpdltb_t xHpdltbTickMbox[configZONE_MAX];
 
 /*****************************************************************************/
 /* Function Prototypes
@@ -81,7 +97,8 @@ static void prvHpdltbTask(void *pvParameters);
 
 // I2C
 esp_err_t i2c_master_init(void);
-static esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t *data_wr, size_t size);
+static esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t bAddr,
+                                        uint8_t *data_wr, size_t size);
 
 /*****************************************************************************/
 /* Public Function
@@ -106,9 +123,15 @@ esp_err_t lInitHpdltb()
     ESP_ERROR_CHECK(i2c_master_init());
     ESP_LOGI(TAG, "Driver installed");
 
-    // Create Queue
-    xHpdltbQueue = xQueueCreate(QUEUE_HPDLTB_SIZE, sizeof(hpdltb_t));
-    configASSERT(xHpdltbQueue);
+    // Create Ring
+    vRingInit(&xHpdltbRing, xHpdltbRingBuf, QUEUE_HPDLTB_SIZE,
+              sizeof(hpdltb_t), NULL, QUEUE_HPDLTB_POLICY, "xHpdltbRing");
+    for (int i = 0; i < configZONE_MAX; i++)
+    {
+        vRingInit(&xHpdltbTickRing[i], xHpdltbTickRingBuf[i],
+                  QUEUE_HPDLTB_TICK_SIZE, sizeof(hpdltb_t), &xHpdltbTickMbox[i],
+                  QUEUE_HPDLTB_TICK_POLICY, "xHpdltbTickRing");
+    }
 
     // Create Task
     xStatus = xTaskCreatePinnedToCore(
@@ -127,16 +150,35 @@ esp_err_t lInitHpdltb()
  *
  * @return   pdPASS / pdFAIL
  *
- * @note		##
+ * @note		CtrlTxタスクからのみ呼ぶこと(SPSC)
  *
  ******************************************************************************/
 BOOL_t xSendHpdltbQueue(hpdltb_t hptldbMsg)
 {
     BOOL_t xStatus;
-    xStatus = xQueueSendToBack(xHpdltbQueue, &hptldbMsg, portMAX_DELAY);
+    xStatus = xRingSend(&xHpdltbRing, &hptldbMsg, QUEUE_HPDLTB_WAIT);
     return xStatus;
 }
 
+/*****************************************************************************/
+/**
+ * ゲーム中の表示を送信
+ *
+ * @param    hpdltb_t：表示するメッセージ
+ *
+ * @return   pdPASS / pdFAIL
+ *
+ * @note		タイマデーモンからのみ呼ぶこと(SPSC)
+ *           待たない。表示が追いつかない間は最新値で上書きする。
+ *
+ ******************************************************************************/
+BOOL_t xSendHpdltbTickQueue(hpdltb_t hptldbMsg)
+{
+    if (hptldbMsg.bLine >= configZONE_MAX)
+        return pdFAIL;
+    return xRingTrySend(&xHpdltbTickRing[hptldbMsg.bLine], &hptldbMsg);
+}
+
 /*****************************************************************************/
 /* Private Function
 ******************************************************************************/
@@ -157,11 +199,21 @@ static void prvHpdltbTask(void *pvParameters)
     esp_err_t ret;
     hpdltb_t rcvBuff;
     uint8_t sendData[4] = {};
+    uint8_t bRecData[4];
+    int lRingIdx;
+    // ゲーム中の表示を先に見る(終了表示を上書きしないため)
+    ring_t *pxRing[configZONE_MAX + 1];
+    for (int i = 0; i < configZONE_MAX; i++)
+    {
+        pxRing[i] = &xHpdltbTickRing[i];
+    }
+    pxRing[configZONE_MAX] = &xHpdltbRing;
 
     for (;;)
     {
-        // Queueから受信
-        xQueueReceive(xHpdltbQueue, &rcvBuff, portMAX_DELAY);
+        // Ringから受信
+        lRingIdx = lRingReceiveAny(pxRing, configZONE_MAX + 1, &rcvBuff,
+                                   QUEUE_HPDLTB_WAIT);
         // ESP_LOGI(TAG, "send I2C data:%d,%d,%d,%d", rcvBuff.eMsg, rcvBuff.bHp, rcvBuff.bTimeH, rcvBuff.bTimeL);
         /*
          * データ変換
@@ -176,11 +228,28 @@ static void prvHpdltbTask(void *pvParameters)
         sendData[3] = rcvBuff.bTimeL;
 
         // 書き込み
-        ret = i2c_master_write_slave(I2C_MASTER_NUM, sendData, sizeof(uint8_t[4]));
+        if (rcvBuff.bLine >= configZONE_MAX)
+        {
+            ESP_LOGE(TAG, "Invalid line:%u", rcvBuff.bLine);
+            continue;
+        }
+        ret = i2c_master_write_slave(I2C_MASTER_NUM, HPDLTB_ADDR + rcvBuff.bLine,
+                                     sendData, sizeof(uint8_t[4]));
+        // ゲーム中の毎カウントの表示はREC_TICKで分かるので記録しない
+        if (lRingIdx == configZONE_MAX)
+        {
+            memcpy(bRecData, &sendData[1], 3);
+            bRecData[3] = rcvBuff.bLine;
+            vRecEvent(REC_DISPLAY, sendData[0], 0, bRecData, sizeof(bRecData));
+        }
         if (ret != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed Senc Data(I2C) errCode:%d", ret);
         }
+        else if (rcvBuff.eMsg == HPDLTB_NORMAL)
+        {
+            vTracePoint(TP_HPDLTB_OUT, 0);
+        }
     }
 }
 
@@ -222,12 +291,13 @@ esp_err_t i2c_master_init(void)
  * --------|---------------------------|----------------------|------|
  *
  */
-static esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t *data_wr, size_t size)
+static esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t bAddr,
+                                        uint8_t *data_wr, size_t size)
 {
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     // hpdltbのアドレスにした
-    i2c_master_write_byte(cmd, (HPDLTB_ADDR << 1) | WRITE_BIT, ACK_CHECK_EN);
+    i2c_master_write_byte(cmd, (bAddr << 1) | WRITE_BIT, ACK_CHECK_EN);
     i2c_master_write(cmd, data_wr, size, ACK_CHECK_EN);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, 1000 / portTICK_RATE_MS);
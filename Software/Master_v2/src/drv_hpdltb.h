@@ -44,6 +44,7 @@ extern "C"
     typedef struct HPDLTB
     {
         enum HPDLTB_MSG eMsg;
+        uint8_t bLine; // 表示器(区画, I2Cアドレス = HPDLTB_ADDR + bLine)
         uint8_t bHp;
         uint8_t bTimeH;
         uint8_t bTimeL;
@@ -58,6 +59,7 @@ extern "C"
 ******************************************************************************/
     esp_err_t lInitHpdltb();
     BOOL_t xSendHpdltbQueue(hpdltb_t hptldbMsg);
+    BOOL_t xSendHpdltbTickQueue(hpdltb_t hptldbMsg);
 
 #ifdef __cplusplus
 }
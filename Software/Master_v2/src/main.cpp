@@ -36,10 +36,13 @@
 
 /* Driver Includes */
 #include "drv_can.h"
+#include "drv_canfw.h"
 #include "drv_dfplayer.h"
 #include "drv_gamemng.h"
 #include "drv_hpdltb.h"
 #include "ctrl_main.h"
+#include "util_diag.h"
+#include "util_rec.h"
 
 /*****************************************************************************/
 /* Constant Definitions
@@ -79,7 +82,10 @@ extern "C" void app_main()
     // Init Function
     // ex. ESP_ERROR_CHECK(iInitFunction( ... ));
     // Error系はesp_err_tを使用してね
+    ESP_ERROR_CHECK(lInitRec());
+    ESP_ERROR_CHECK(lInitDiag());
     ESP_ERROR_CHECK(lInitCanFunction());
+    ESP_ERROR_CHECK(lInitCanFw());
     ESP_ERROR_CHECK(lInitDfplayer());
     ESP_ERROR_CHECK(lInitGameMng());
     ESP_ERROR_CHECK(lInitHpdltb());
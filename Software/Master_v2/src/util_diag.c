@@ -0,0 +1,217 @@
+/*****************************************************************************/
+/**
+ * @file util_diag.c
+ * @comments 診断ログのバイナリリング
+ *           記録はコピー1回と添字の更新だけ(printfの整形やUARTの出力を待たない)。
+ *           リングが一周したら古い記録から上書きし、失った数を残す。
+ *           送信中(xDiagSnapshot〜vDiagRelease)の記録は捨てて数だけ数える。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdlib.h>
+#include <string.h>
+
+/* ESP-IDF Includes */
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "util_diag.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define DIAG_MASK (configDIAG_EVENT_NUM - 1)
+
+#if (configDIAG_EVENT_NUM & DIAG_MASK) != 0
+#error "configDIAG_EVENT_NUM must be a power of 2"
+#endif
+
+/* ESPLOGGER Configure */
+#define TAG "Diag"
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static portMUX_TYPE xDiagMux = portMUX_INITIALIZER_UNLOCKED;
+
+static diagEvent_t *pxDiagBuf = NULL;
+static uint32_t ulDiagHead = 0;  // 記録した数(単調増加)
+static uint32_t ulDiagStart = 0; // 送信中: 一番古い記録の添字
+static uint32_t ulDiagCount = 0; // 送信中: 読み出せる記録数
+static uint32_t ulDiagLost = 0;  // 送信中に捨てた数
+static BOOL_t xDiagFlushing = pdFALSE;
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 診断ログ初期化(リングを確保)
+ *
+ * @param    ##
+ *
+ * @return   ESP_OK / ESP_ERR_NO_MEM
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t lInitDiag()
+{
+#if configDIAG_ENABLE == 1
+    pxDiagBuf = (diagEvent_t *)malloc(sizeof(diagEvent_t) * configDIAG_EVENT_NUM);
+    if (pxDiagBuf == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %u events",
+                 (unsigned)configDIAG_EVENT_NUM);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    return ESP_OK;
+}
+
+#if configDIAG_ENABLE == 1
+/*****************************************************************************/
+/**
+ * 記録
+ *
+ * @param    eCode: 種別
+ * @param    bArg / usArg: 種別毎の値(eDiagCode_t参照)
+ * @param    pvData: 付加データ(最大8byte、NULL可)
+ * @param    xLen: 付加データ長
+ *
+ * @return   ##
+ *
+ * @note     どのタスクからも呼べる
+ *
+ ******************************************************************************/
+void vDiagEvent(eDiagCode_t eCode, uint8_t bArg, uint16_t usArg,
+                const void *pvData, size_t xLen)
+{
+    diagEvent_t xEvent = {};
+
+    if (pxDiagBuf == NULL)
+        return;
+
+    xEvent.ulTimeUs = (uint32_t)esp_timer_get_time();
+    xEvent.bCode = (uint8_t)eCode;
+    xEvent.bArg = bArg;
+    xEvent.usArg = usArg;
+    if (pvData != NULL)
+        memcpy(xEvent.bData, pvData, MIN(xLen, sizeof(xEvent.bData)));
+
+    portENTER_CRITICAL(&xDiagMux);
+    if (xDiagFlushing == pdTRUE)
+    {
+        ulDiagLost++;
+    }
+    else
+    {
+        pxDiagBuf[ulDiagHead & DIAG_MASK] = xEvent;
+        ulDiagHead++;
+    }
+    portEXIT_CRITICAL(&xDiagMux);
+}
+#endif
+
+/*****************************************************************************/
+/**
+ * 送信開始
+ *
+ * @param    pxHeader: ヘッダ格納先
+ *
+ * @return   pdPASS / pdFAIL(無効、記録なし、送信中)
+ *
+ * @note     pdPASSならulDiagRead()で読み、vDiagRelease()を呼ぶこと
+ *
+ ******************************************************************************/
+BOOL_t xDiagSnapshot(diagHeader_t *pxHeader)
+{
+    uint32_t ulDropped;
+
+    if (pxDiagBuf == NULL)
+        return pdFAIL;
+
+    portENTER_CRITICAL(&xDiagMux);
+    if (xDiagFlushing == pdTRUE || ulDiagHead == 0)
+    {
+        portEXIT_CRITICAL(&xDiagMux);
+        return pdFAIL;
+    }
+    xDiagFlushing = pdTRUE;
+    ulDiagCount = MIN(ulDiagHead, (uint32_t)configDIAG_EVENT_NUM);
+    ulDiagStart = ulDiagHead - ulDiagCount;
+    ulDropped = ulDiagStart + ulDiagLost;
+    portEXIT_CRITICAL(&xDiagMux);
+
+    memcpy(pxHeader->cMagic, DIAG_MAGIC, sizeof(pxHeader->cMagic));
+    pxHeader->usVersion = DIAG_VERSION;
+    pxHeader->usEventSize = sizeof(diagEvent_t);
+    pxHeader->ulNowUs = (uint32_t)esp_timer_get_time();
+    pxHeader->ulCount = ulDiagCount;
+    pxHeader->ulDropped = ulDropped;
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 記録の読み出し(古い順)
+ *
+ * @param    ulIdx: 読み出し開始位置(0 = 残っている一番古い記録)
+ * @param    pxEvent: 格納先
+ * @param    ulNum: 格納先の要素数
+ *
+ * @return   読み出した記録数
+ *
+ * @note     xDiagSnapshot()〜vDiagRelease()の間で呼ぶこと
+ *
+ ******************************************************************************/
+uint32_t ulDiagRead(uint32_t ulIdx, diagEvent_t *pxEvent, uint32_t ulNum)
+{
+    uint32_t i;
+
+    for (i = 0; i < ulNum && ulIdx + i < ulDiagCount; i++)
+    {
+        pxEvent[i] = pxDiagBuf[(ulDiagStart + ulIdx + i) & DIAG_MASK];
+    }
+    return i;
+}
+
+/*****************************************************************************/
+/**
+ * 送信終了(送った記録は捨てて、記録を再開する)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vDiagRelease()
+{
+    portENTER_CRITICAL(&xDiagMux);
+    ulDiagHead = 0;
+    ulDiagLost = 0;
+    xDiagFlushing = pdFALSE;
+    portEXIT_CRITICAL(&xDiagMux);
+}
@@ -0,0 +1,97 @@
+/*****************************************************************************/
+/**
+ * @file util_diag.h
+ * @comments 診断ログのバイナリリング
+ *           CAN送受信のように頻度の高い経路のログを、その場で整形せず
+ *           固定長の記録としてリングに残す(常に記録し、一周したら上書き)。
+ *           ゲーム毎にGMへ送り、ホスト側で文字列に直す(gamemng.py)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_UTIL_DIAG_H
+#define SRC_UTIL_DIAG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* ファイル形式(リトルエンディアン): diagHeader_t + diagEvent_t * ulCount */
+#define DIAG_MAGIC "TBDG"
+#define DIAG_VERSION 1
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* 記録種別(値はファイル形式の一部なので変更しないこと) */
+typedef enum DIAG_CODE
+{
+    DIAG_CAN_RX = 1,   // CAN受信         bArg:DLC usArg:CAN ID bData:データ
+    DIAG_CAN_RX_MSG,   // ctrl_mainへ送る bArg:PanelID usArg:seq
+                       //                 bData[0]:押下 [1..3]:R,G,B [4]:プロトコル
+    DIAG_CAN_RX_BATCH, // まとめて受信   bArg:受信フレーム数(2以上) usArg:ctrl_mainへ送った数
+    DIAG_CAN_RX_DUP,   // 重複を捨てた    bArg:PanelID usArg:seq
+    DIAG_CAN_TX,       // CAN送信         bArg:DLC usArg:CAN ID bData:データ
+    DIAG_CAN_RETRY,    // 配送確認の再送  bArg:PanelID usArg:seq bData[0]:それまでの再送回数
+    MAX_DIAG_CODE
+} eDiagCode_t;
+
+/* 1記録16byte */
+typedef struct DIAG_EVENT
+{
+    uint32_t ulTimeUs; // esp_timerの下位32bit[us]
+    uint8_t bCode;     // eDiagCode_t
+    uint8_t bArg;
+    uint16_t usArg;
+    uint8_t bData[8];
+} diagEvent_t;
+
+typedef struct DIAG_HEADER
+{
+    char cMagic[4];       // DIAG_MAGIC
+    uint16_t usVersion;   // DIAG_VERSION
+    uint16_t usEventSize; // sizeof(diagEvent_t)
+    uint32_t ulNowUs;     // 読み出した時刻(esp_timerの下位32bit)
+    uint32_t ulCount;     // 続く記録数
+    uint32_t ulDropped;   // 上書き、送信中で失った記録数
+} diagHeader_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+esp_err_t lInitDiag();
+#if configDIAG_ENABLE == 1
+void vDiagEvent(eDiagCode_t eCode, uint8_t bArg, uint16_t usArg,
+                const void *pvData, size_t xLen);
+#else
+#define vDiagEvent(eCode, bArg, usArg, pvData, xLen)
+#endif
+BOOL_t xDiagSnapshot(diagHeader_t *pxHeader);
+uint32_t ulDiagRead(uint32_t ulIdx, diagEvent_t *pxEvent, uint32_t ulNum);
+void vDiagRelease();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,268 @@
+/*****************************************************************************/
+/**
+ * @file util_rec.c
+ * @comments ゲームイベントのバイナリレコーダ
+ *           エントリーからゲーム終了までのイベントを固定長リングに記録する。
+ *           リングが一周したら古いイベントから上書きし、捨てた数を残す。
+ *           送信中(xRecSnapshot〜vRecRelease)は次のゲームを記録しない。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdlib.h>
+#include <string.h>
+
+/* ESP-IDF Includes */
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "util_rec.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define REC_MASK (configREC_EVENT_NUM - 1)
+
+#if (configREC_EVENT_NUM & REC_MASK) != 0
+#error "configREC_EVENT_NUM must be a power of 2"
+#endif
+
+/* ESPLOGGER Configure */
+#define TAG "Rec"
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static portMUX_TYPE xRecMux = portMUX_INITIALIZER_UNLOCKED;
+
+static recEvent_t *pxRecBuf = NULL;
+static uint32_t ulRecHead = 0; // 記録したイベント数(単調増加)
+static int64_t llRecOriginUs = 0;
+static uint32_t ulRecGame = 0;
+static BOOL_t xRecActive = pdFALSE;
+static BOOL_t xRecFlushing = pdFALSE;
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * レコーダ初期化(リングを確保)
+ *
+ * @param    ##
+ *
+ * @return   ESP_OK / ESP_ERR_NO_MEM
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+esp_err_t lInitRec()
+{
+#if configREC_ENABLE == 1
+    pxRecBuf = (recEvent_t *)malloc(sizeof(recEvent_t) * configREC_EVENT_NUM);
+    if (pxRecBuf == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %u events",
+                 (unsigned)configREC_EVENT_NUM);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    return ESP_OK;
+}
+
+/*****************************************************************************/
+/**
+ * 記録開始(エントリー受付時)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     前のゲームを送信中なら今回は記録しない
+ *
+ ******************************************************************************/
+void vRecStartGame()
+{
+    if (pxRecBuf == NULL)
+        return;
+
+    portENTER_CRITICAL(&xRecMux);
+    if (xRecFlushing == pdTRUE)
+    {
+        portEXIT_CRITICAL(&xRecMux);
+        ESP_LOGW(TAG, "Previous recording is still being sent, skip");
+        return;
+    }
+    ulRecHead = 0;
+    llRecOriginUs = esp_timer_get_time();
+    ulRecGame++;
+    xRecActive = pdTRUE;
+    portEXIT_CRITICAL(&xRecMux);
+}
+
+/*****************************************************************************/
+/**
+ * 記録終了
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vRecFinishGame()
+{
+    portENTER_CRITICAL(&xRecMux);
+    xRecActive = pdFALSE;
+    portEXIT_CRITICAL(&xRecMux);
+}
+
+#if configREC_ENABLE == 1
+/*****************************************************************************/
+/**
+ * イベント記録
+ *
+ * @param    eType: 種別
+ * @param    bId / usArg: 種別毎の値(eRecType_t参照)
+ * @param    pvData: 付加データ(最大8byte、NULL可)
+ * @param    xLen: 付加データ長
+ *
+ * @return   ##
+ *
+ * @note     どのタスクからも呼べる。記録中でなければ何もしない。
+ *
+ ******************************************************************************/
+void vRecEvent(eRecType_t eType, uint8_t bId, uint16_t usArg,
+               const void *pvData, size_t xLen)
+{
+    recEvent_t xEvent = {};
+    BOOL_t xStored = pdFALSE;
+
+    if (xRecActive != pdTRUE)
+        return;
+
+    xEvent.bType = (uint8_t)eType;
+    xEvent.bId = bId;
+    xEvent.usArg = usArg;
+    if (pvData != NULL)
+        memcpy(xEvent.bData, pvData, MIN(xLen, sizeof(xEvent.bData)));
+
+    portENTER_CRITICAL(&xRecMux);
+    if (xRecActive == pdTRUE)
+    {
+        xEvent.ulTimeUs = (uint32_t)(esp_timer_get_time() - llRecOriginUs);
+        pxRecBuf[ulRecHead & REC_MASK] = xEvent;
+        ulRecHead++;
+        xStored = pdTRUE;
+    }
+    portEXIT_CRITICAL(&xRecMux);
+
+#ifdef SIM_HOST
+    if (xStored == pdTRUE)
+        vSimRecOnEvent(&xEvent);
+#else
+    (void)xStored;
+#endif
+}
+#endif
+
+/*****************************************************************************/
+/**
+ * 前回のゲームの送信開始
+ *
+ * @param    pxHeader: ヘッダ格納先
+ *
+ * @return   pdPASS / pdFAIL(記録なし、記録中)
+ *
+ * @note     pdPASSならulRecRead()で読み、vRecRelease()を呼ぶこと
+ *
+ ******************************************************************************/
+BOOL_t xRecSnapshot(recHeader_t *pxHeader)
+{
+    uint32_t ulCount;
+
+    if (pxRecBuf == NULL)
+        return pdFAIL;
+
+    portENTER_CRITICAL(&xRecMux);
+    if (xRecActive == pdTRUE || ulRecGame == 0)
+    {
+        portEXIT_CRITICAL(&xRecMux);
+        return pdFAIL;
+    }
+    xRecFlushing = pdTRUE;
+    ulCount = MIN(ulRecHead, (uint32_t)configREC_EVENT_NUM);
+    portEXIT_CRITICAL(&xRecMux);
+
+    memcpy(pxHeader->cMagic, REC_MAGIC, sizeof(pxHeader->cMagic));
+    pxHeader->usVersion = REC_VERSION;
+    pxHeader->usEventSize = sizeof(recEvent_t);
+    pxHeader->ulGame = ulRecGame;
+    pxHeader->ulCount = ulCount;
+    pxHeader->ulDropped = ulRecHead - ulCount;
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 記録の読み出し(古い順)
+ *
+ * @param    ulIdx: 読み出し開始位置(0 = 残っている一番古いイベント)
+ * @param    pxEvent: 格納先
+ * @param    ulNum: 格納先の要素数
+ *
+ * @return   読み出したイベント数
+ *
+ * @note     xRecSnapshot()〜vRecRelease()の間で呼ぶこと
+ *
+ ******************************************************************************/
+uint32_t ulRecRead(uint32_t ulIdx, recEvent_t *pxEvent, uint32_t ulNum)
+{
+    uint32_t ulCount = MIN(ulRecHead, (uint32_t)configREC_EVENT_NUM);
+    uint32_t ulStart = ulRecHead - ulCount;
+    uint32_t i;
+
+    for (i = 0; i < ulNum && ulIdx + i < ulCount; i++)
+    {
+        pxEvent[i] = pxRecBuf[(ulStart + ulIdx + i) & REC_MASK];
+    }
+    return i;
+}
+
+/*****************************************************************************/
+/**
+ * 送信終了(次のゲームを記録できるようにする)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vRecRelease()
+{
+    portENTER_CRITICAL(&xRecMux);
+    xRecFlushing = pdFALSE;
+    portEXIT_CRITICAL(&xRecMux);
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************/
+/**
+ * @file util_rec.h
+ * @comments ゲームイベントのバイナリレコーダ
+ *           CAN送受信、タイマ、体力、効果音、表示をus単位で記録し、
+ *           ゲーム毎にGMへ送る(ホストのsimで再生して得点を照合する)。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_UTIL_REC_H
+#define SRC_UTIL_REC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* ファイル形式(リトルエンディアン): recHeader_t + recEvent_t * ulCount */
+#define REC_MAGIC "TBRC"
+#define REC_VERSION 2 // 2: CANのIDをusArgへ(グループ宛ては11bit)
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* イベント種別(値はファイル形式の一部なので変更しないこと) */
+typedef enum REC_TYPE
+{
+    REC_ENTRY = 1,  // エントリー     bId:チーム usArg:難易度 bData[0]:区画
+    REC_GAME_START, // タイマ開始     bId:区画 bData:dfcltProfile_t
+    REC_CAN_TX,     // CAN送信完了    bId:DLC usArg:CAN ID bData:データ
+    REC_CAN_RX,     // CAN受信        bId:DLC usArg:CAN ID bData:データ
+    REC_TICK,       // タイマ         bId:区画 usArg:残りカウント bData[0]:体力
+    REC_HP,         // 得点           bId:PanelID usArg:体力(int16) bData[0]:色 [1]:増減
+    REC_REJECT,     // 押下を棄却     bId:PanelID usArg:ePanelHit_t
+    REC_SE,         // 効果音再生     bId:ePlaylist_t
+    REC_DISPLAY,    // 表示(I2C)      bId:eMsg bData[0..2]:体力,時間H,時間L [3]:表示器
+    REC_RAND,       // 乱数           bData[0..3]:値 [4..5]:下限 [6..7]:上限(int16)
+    REC_RESULT,     // 結果           bId:区画 usArg:残り時間 bData:赤,緑,青,体力(int16)
+    REC_LIVE,       // パネル死活     bId:生きている数 bData[0..3]:途絶 [4..7]:踏まれたまま
+    REC_SYNC,       // 時刻同期       bId:番号 bData[0..3]:SYNCの送信完了時刻(esp_timer下位32bit)
+    MAX_REC_TYPE
+} eRecType_t;
+
+/* 1イベント16byte */
+typedef struct REC_EVENT
+{
+    uint32_t ulTimeUs; // 記録開始(エントリー)からの経過[us]
+    uint8_t bType;     // eRecType_t
+    uint8_t bId;
+    uint16_t usArg;
+    uint8_t bData[8];
+} recEvent_t;
+
+typedef struct REC_HEADER
+{
+    char cMagic[4];       // REC_MAGIC
+    uint16_t usVersion;   // REC_VERSION
+    uint16_t usEventSize; // sizeof(recEvent_t)
+    uint32_t ulGame;      // ゲーム番号(起動から)
+    uint32_t ulCount;     // 続くイベント数
+    uint32_t ulDropped;   // リングが一周して失ったイベント数
+} recHeader_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+esp_err_t lInitRec();
+void vRecStartGame();
+void vRecFinishGame();
+#if configREC_ENABLE == 1
+void vRecEvent(eRecType_t eType, uint8_t bId, uint16_t usArg,
+               const void *pvData, size_t xLen);
+#else
+#define vRecEvent(eType, bId, usArg, pvData, xLen)
+#endif
+BOOL_t xRecSnapshot(recHeader_t *pxHeader);
+uint32_t ulRecRead(uint32_t ulIdx, recEvent_t *pxEvent, uint32_t ulNum);
+void vRecRelease();
+
+/* Virtual Arena(sim)は記録されたイベントで再生を進める */
+#ifdef SIM_HOST
+void vSimRecOnEvent(const recEvent_t *pxEvent);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,652 @@
+/*****************************************************************************/
+/**
+ * @file util_ring.c
+ * @comments ロックフリー SPSC(1 Producer / 1 Consumer) リングバッファ
+ *           Queueと違いクリティカルセクションを使わず、要素のコピーは
+ *           添字の公開(アトミック操作)の外で行う。
+ *           待ち合わせはTask Notifyで行うため、リングで待つタスクは
+ *           Task Notifyを他の用途に使わないこと。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdint.h>
+#include <string.h>
+
+#include "util_ring.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/*
+ * 添字の公開と待ちフラグはSEQ_CST(待ち登録と公開の順序を保証し、起床の
+ * 取りこぼしを防ぐ)。それ以外の読み込みはACQUIREで足りる。
+ */
+#define RING_LOAD(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define RING_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define RING_LOAD_ACQ(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_CAS(p, pexp, v)                                                   \
+    __atomic_compare_exchange_n((p), (pexp), (v), 0, __ATOMIC_SEQ_CST,         \
+                                __ATOMIC_SEQ_CST)
+
+#define RING_SLOT(r, i) ((r)->pbBuf + ((i) & (r)->ulMask) * (r)->ulItemSize)
+
+/* メールボックスの添字(Virtual Arenaの計測用) */
+#define RING_MBOX_IDX 0xFFFFFFFFUL
+
+/* Virtual Arena(sim)では投入／取り出しを計測する */
+#ifdef SIM_HOST
+void vSimRingOnPush(const ring_t *pxRing, uint32_t ulIdx);
+void vSimRingOnPop(const ring_t *pxRing, uint32_t ulIdx);
+#else
+#define vSimRingOnPush(pxRing, ulIdx)
+#define vSimRingOnPop(pxRing, ulIdx)
+#endif
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static ring_t *pxRingRegistry[RING_REGISTRY_SIZE];
+static uint32_t ulRingRegistryNum = 0;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static BOOL_t prvRingPush(ring_t *pxRing, const void *pvItem);
+static BOOL_t prvRingPop(ring_t *pxRing, void *pvItem);
+static BOOL_t prvRingFull(ring_t *pxRing);
+static BOOL_t prvRingEmpty(ring_t *pxRing);
+static void prvMboxWrite(ring_t *pxRing, const void *pvItem);
+static BOOL_t prvMboxRead(ring_t *pxRing, void *pvItem);
+static TickType_t prvRemainTicks(TickType_t xStart, TickType_t xTicksToWait);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * リング初期化
+ *
+ * @param    pxRing: リング
+ * @param    pvBuf: 要素バッファ(ulSize * ulItemSize)
+ * @param    ulSize: 要素数(2の累乗)
+ * @param    ulItemSize: 要素サイズ[byte]
+ * @param    pvMbox: メールボックス(ulItemSize, COALESCE以外はNULL可)
+ * @param    ePolicy: 満杯時の動作
+ * @param    pcName: 名前(統計表示用)
+ *
+ * @return   ##
+ *
+ * @note     Producer/Consumerが動き出す前に呼ぶこと
+ *
+ ******************************************************************************/
+void vRingInit(ring_t *pxRing, void *pvBuf, uint32_t ulSize,
+               uint32_t ulItemSize, void *pvMbox, eRingPolicy_t ePolicy,
+               const char *pcName)
+{
+    configASSERT(ulSize != 0 && (ulSize & (ulSize - 1)) == 0);
+    configASSERT(ePolicy != RING_POLICY_COALESCE || pvMbox != NULL);
+
+    memset(pxRing, 0x00, sizeof(ring_t));
+    pxRing->pbBuf = (uint8_t *)pvBuf;
+    pxRing->pbMbox = (uint8_t *)pvMbox;
+    pxRing->ulMask = ulSize - 1;
+    pxRing->ulItemSize = ulItemSize;
+    pxRing->ePolicy = ePolicy;
+    pxRing->pcName = pcName;
+
+    if (ulRingRegistryNum < RING_REGISTRY_SIZE)
+    {
+        pxRingRegistry[ulRingRegistryNum++] = pxRing;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 送信(待たない)
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 送信する要素
+ *
+ * @return   pdPASS / pdFAIL(BLOCKで満杯、または未初期化)
+ *
+ * @note     Producerタスクからのみ呼ぶこと
+ *
+ ******************************************************************************/
+BOOL_t xRingTrySend(ring_t *pxRing, const void *pvItem)
+{
+    if (prvRingPush(pxRing, pvItem) != pdPASS)
+        return pdFAIL;
+
+    // 受信待ち中なら起こす
+    if (RING_LOAD(&pxRing->ulConsumerWaiting))
+        xTaskNotifyGive(pxRing->xConsumer);
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 受信(待たない)
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 受信した要素の格納先
+ *
+ * @return   pdPASS / pdFAIL(空)
+ *
+ * @note     Consumerタスクからのみ呼ぶこと
+ *
+ ******************************************************************************/
+BOOL_t xRingTryReceive(ring_t *pxRing, void *pvItem)
+{
+    if (prvRingPop(pxRing, pvItem) != pdPASS)
+        return pdFAIL;
+
+    // 送信待ち中なら起こす
+    if (RING_LOAD(&pxRing->ulProducerWaiting))
+        xTaskNotifyGive(pxRing->xProducer);
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 送信
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 送信する要素
+ * @param    xTicksToWait: BLOCKで満杯のときに待つ時間
+ *
+ * @return   pdPASS / pdFAIL(タイムアウト)
+ *
+ * @note     DROP_OLDEST/COALESCEは待たない
+ *
+ ******************************************************************************/
+BOOL_t xRingSend(ring_t *pxRing, const void *pvItem, TickType_t xTicksToWait)
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xRemain;
+    BOOL_t xCounted = pdFALSE;
+
+    for (;;)
+    {
+        if (xRingTrySend(pxRing, pvItem) == pdPASS)
+            return pdPASS;
+        if (pxRing->pbBuf == NULL)
+            return pdFAIL; // 未初期化
+
+        xRemain = prvRemainTicks(xStart, xTicksToWait);
+        if (xRemain == 0)
+            return pdFAIL;
+        if (xCounted == pdFALSE)
+        {
+            pxRing->ulBlockCnt++;
+            xCounted = pdTRUE;
+        }
+
+        // 待ちを登録してから再確認(取りこぼし防止)
+        pxRing->xProducer = xTaskGetCurrentTaskHandle();
+        RING_STORE(&pxRing->ulProducerWaiting, 1);
+        if (prvRingFull(pxRing) == pdTRUE)
+        {
+            ulTaskNotifyTake(pdTRUE, xRemain);
+        }
+        RING_STORE(&pxRing->ulProducerWaiting, 0);
+    }
+}
+
+/*****************************************************************************/
+/**
+ * まとめて送信
+ * 入るだけ入れてからConsumerを1回だけ起こす。
+ *
+ * @param    pxRing: リング
+ * @param    pvItems: 送信する要素の配列
+ * @param    ulNum: 要素数
+ * @param    xTicksToWait: BLOCKで満杯のときに1要素毎に待つ時間
+ *
+ * @return   送信した要素数
+ *
+ * @note     満杯で残った分は1つずつxRingSend()で送る
+ *
+ ******************************************************************************/
+uint32_t ulRingSendBatch(ring_t *pxRing, const void *pvItems, uint32_t ulNum,
+                         TickType_t xTicksToWait)
+{
+    const uint8_t *pbItem = (const uint8_t *)pvItems;
+    uint32_t ulSent = 0;
+
+    while (ulSent < ulNum &&
+           prvRingPush(pxRing, pbItem + ulSent * pxRing->ulItemSize) == pdPASS)
+    {
+        ulSent++;
+    }
+
+    // 受信待ち中なら起こす
+    if (ulSent > 0 && RING_LOAD(&pxRing->ulConsumerWaiting))
+        xTaskNotifyGive(pxRing->xConsumer);
+
+    while (ulSent < ulNum &&
+           xRingSend(pxRing, pbItem + ulSent * pxRing->ulItemSize,
+                     xTicksToWait) == pdPASS)
+    {
+        ulSent++;
+    }
+    return ulSent;
+}
+
+/*****************************************************************************/
+/**
+ * 受信
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 受信した要素の格納先
+ * @param    xTicksToWait: 空のときに待つ時間
+ *
+ * @return   pdPASS / pdFAIL(タイムアウト)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+BOOL_t xRingReceive(ring_t *pxRing, void *pvItem, TickType_t xTicksToWait)
+{
+    return (lRingReceiveAny(&pxRing, 1, pvItem, xTicksToWait) >= 0) ? pdPASS
+                                                                    : pdFAIL;
+}
+
+/*****************************************************************************/
+/**
+ * 複数リングからの受信
+ * 配列の先頭のリングから順に見て、最初に取れた要素を返します。
+ * Producerが複数ある経路は、Producer毎にリングを分けてこれで受ける。
+ *
+ * @param    ppxRing: リングの配列(要素サイズはすべて同じ)
+ * @param    ulNum: リング数
+ * @param    pvItem: 受信した要素の格納先
+ * @param    xTicksToWait: すべて空のときに待つ時間
+ *
+ * @return   受信したリングの添字 / -1(タイムアウト)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int lRingReceiveAny(ring_t *const *ppxRing, uint32_t ulNum, void *pvItem,
+                    TickType_t xTicksToWait)
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xRemain;
+    TaskHandle_t xSelf;
+    BOOL_t xEmpty;
+    uint32_t i;
+
+    for (;;)
+    {
+        for (i = 0; i < ulNum; i++)
+        {
+            if (xRingTryReceive(ppxRing[i], pvItem) == pdPASS)
+                return (int)i;
+        }
+
+        xRemain = prvRemainTicks(xStart, xTicksToWait);
+        if (xRemain == 0)
+            return -1;
+
+        // 待ちを登録してから再確認(取りこぼし防止)
+        xSelf = xTaskGetCurrentTaskHandle();
+        xEmpty = pdTRUE;
+        for (i = 0; i < ulNum; i++)
+        {
+            ppxRing[i]->xConsumer = xSelf;
+            RING_STORE(&ppxRing[i]->ulConsumerWaiting, 1);
+        }
+        for (i = 0; i < ulNum; i++)
+        {
+            if (prvRingEmpty(ppxRing[i]) == pdFALSE)
+                xEmpty = pdFALSE;
+        }
+        if (xEmpty == pdTRUE)
+        {
+            ulTaskNotifyTake(pdTRUE, xRemain);
+        }
+        for (i = 0; i < ulNum; i++)
+        {
+            RING_STORE(&ppxRing[i]->ulConsumerWaiting, 0);
+        }
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 未受信の要素をすべて捨てる
+ *
+ * @param    pxRing: リング
+ *
+ * @return   ##
+ *
+ * @note     Consumerタスクからのみ呼ぶこと
+ *
+ ******************************************************************************/
+void vRingReset(ring_t *pxRing)
+{
+    uint32_t ulTail = RING_LOAD(&pxRing->ulTail);
+    uint32_t ulSeq;
+
+    while (!RING_CAS(&pxRing->ulTail, &ulTail, RING_LOAD(&pxRing->ulHead)))
+    {
+    }
+
+    // 書き込み中(奇数)のメールボックスは書き終わった後に受信される
+    ulSeq = RING_LOAD(&pxRing->ulMboxSeq);
+    if ((ulSeq & 1) == 0)
+        RING_STORE(&pxRing->ulMboxTaken, ulSeq);
+}
+
+/*****************************************************************************/
+/**
+ * 未受信の要素数
+ *
+ * @param    pxRing: リング
+ *
+ * @return   uint32_t 要素数(メールボックスは含まない)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+uint32_t ulRingCount(const ring_t *pxRing)
+{
+    return RING_LOAD(&pxRing->ulHead) - RING_LOAD(&pxRing->ulTail);
+}
+
+/*****************************************************************************/
+/**
+ * 統計取得
+ *
+ * @param    pxRing: リング
+ * @param    pxStats: 格納先
+ *
+ * @return   ##
+ *
+ * @note     カウンタは書き込み側タスクが更新するので目安として使う
+ *
+ ******************************************************************************/
+void vRingGetStats(const ring_t *pxRing, ringStats_t *pxStats)
+{
+    pxStats->pcName = pxRing->pcName;
+    pxStats->ePolicy = pxRing->ePolicy;
+    pxStats->ulSize = pxRing->ulMask + 1;
+    pxStats->ulPushCnt = pxRing->ulPushCnt;
+    pxStats->ulPopCnt = pxRing->ulPopCnt;
+    pxStats->ulDropCnt = pxRing->ulDropCnt;
+    pxStats->ulCoalesceCnt = pxRing->ulCoalesceCnt;
+    pxStats->ulBlockCnt = pxRing->ulBlockCnt;
+    pxStats->ulHighWater = pxRing->ulHighWater;
+}
+
+/*****************************************************************************/
+/**
+ * 登録済みリングの取得
+ *
+ * @param    ulIdx: 0から
+ *
+ * @return   ring_t* / NULL(範囲外)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+ring_t *pxRingGetRegistered(uint32_t ulIdx)
+{
+    return (ulIdx < ulRingRegistryNum) ? pxRingRegistry[ulIdx] : NULL;
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * 要素の追加(満杯時は方針に従う)
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 追加する要素
+ *
+ * @return   pdPASS / pdFAIL(BLOCKで満杯)
+ *
+ * @note     DROP_OLDESTで捨てたスロットをConsumerがコピー中でも、
+ *           ConsumerのCASが失敗するのでその読み込みは使われない。
+ *
+ ******************************************************************************/
+static BOOL_t prvRingPush(ring_t *pxRing, const void *pvItem)
+{
+    uint32_t ulHead = pxRing->ulHead; // Producerだけが書く
+    uint32_t ulTail;
+    uint32_t ulUsed;
+
+    if (pxRing->pbBuf == NULL)
+        return pdFAIL;
+
+    // メールボックスに残りがあれば、順序を保つため続けてそちらへ
+    if (pxRing->ePolicy == RING_POLICY_COALESCE &&
+        pxRing->ulMboxSeq != RING_LOAD_ACQ(&pxRing->ulMboxTaken))
+    {
+        prvMboxWrite(pxRing, pvItem);
+        return pdPASS;
+    }
+
+    ulTail = RING_LOAD_ACQ(&pxRing->ulTail);
+    if (ulHead - ulTail > pxRing->ulMask)
+    {
+        switch (pxRing->ePolicy)
+        {
+        case RING_POLICY_DROP_OLDEST:
+            // 失敗 = Consumerが先に取り出した(空きができた)
+            if (RING_CAS(&pxRing->ulTail, &ulTail, ulTail + 1))
+                pxRing->ulDropCnt++;
+            break;
+        case RING_POLICY_COALESCE:
+            prvMboxWrite(pxRing, pvItem);
+            return pdPASS;
+        case RING_POLICY_BLOCK:
+        default:
+            return pdFAIL;
+        }
+    }
+
+    memcpy(RING_SLOT(pxRing, ulHead), pvItem, pxRing->ulItemSize);
+    vSimRingOnPush(pxRing, ulHead);
+    RING_STORE(&pxRing->ulHead, ulHead + 1);
+
+    pxRing->ulPushCnt++;
+    ulUsed = ulHead + 1 - RING_LOAD_ACQ(&pxRing->ulTail);
+    if (ulUsed > pxRing->ulHighWater)
+        pxRing->ulHighWater = ulUsed;
+    return pdPASS;
+}
+
+/*****************************************************************************/
+/**
+ * 要素の取り出し
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 格納先
+ *
+ * @return   pdPASS / pdFAIL(空)
+ *
+ * @note     DROP_OLDESTはコピーしてからCASで確定する(Producerも
+ *           ulTailを進めるため)。それ以外はConsumerだけがulTailを書く。
+ *           リングが空ならメールボックスを見る。
+ *
+ ******************************************************************************/
+static BOOL_t prvRingPop(ring_t *pxRing, void *pvItem)
+{
+    uint32_t ulTail;
+
+    if (pxRing->pbBuf == NULL)
+        return pdFAIL;
+
+    ulTail = RING_LOAD_ACQ(&pxRing->ulTail);
+    while (ulTail != RING_LOAD_ACQ(&pxRing->ulHead))
+    {
+        memcpy(pvItem, RING_SLOT(pxRing, ulTail), pxRing->ulItemSize);
+        if (pxRing->ePolicy != RING_POLICY_DROP_OLDEST)
+        {
+            RING_STORE(&pxRing->ulTail, ulTail + 1);
+            vSimRingOnPop(pxRing, ulTail);
+            pxRing->ulPopCnt++;
+            return pdPASS;
+        }
+        if (RING_CAS(&pxRing->ulTail, &ulTail, ulTail + 1))
+        {
+            vSimRingOnPop(pxRing, ulTail);
+            pxRing->ulPopCnt++;
+            return pdPASS;
+        }
+        // Producerが捨てた → 新しいulTailでやり直し
+    }
+
+    if (pxRing->ePolicy == RING_POLICY_COALESCE &&
+        prvMboxRead(pxRing, pvItem) == pdPASS)
+    {
+        vSimRingOnPop(pxRing, RING_MBOX_IDX);
+        pxRing->ulPopCnt++;
+        return pdPASS;
+    }
+    return pdFAIL;
+}
+
+/*****************************************************************************/
+/**
+ * 満杯判定(Producer側)
+ *
+ * @param    pxRing: リング
+ *
+ * @return   pdTRUE / pdFALSE
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+static BOOL_t prvRingFull(ring_t *pxRing)
+{
+    return (RING_LOAD(&pxRing->ulHead) - RING_LOAD(&pxRing->ulTail) >
+            pxRing->ulMask)
+               ? pdTRUE
+               : pdFALSE;
+}
+
+/*****************************************************************************/
+/**
+ * 空判定(Consumer側)
+ *
+ * @param    pxRing: リング
+ *
+ * @return   pdTRUE / pdFALSE
+ *
+ * @note     書き込み中のメールボックスは空とみなす(書き終わりで起こされる)
+ *
+ ******************************************************************************/
+static BOOL_t prvRingEmpty(ring_t *pxRing)
+{
+    uint32_t ulSeq;
+
+    if (RING_LOAD(&pxRing->ulTail) != RING_LOAD(&pxRing->ulHead))
+        return pdFALSE;
+    if (pxRing->ePolicy != RING_POLICY_COALESCE)
+        return pdTRUE;
+
+    ulSeq = RING_LOAD(&pxRing->ulMboxSeq);
+    return ((ulSeq & 1) == 0 && ulSeq != RING_LOAD(&pxRing->ulMboxTaken))
+               ? pdFALSE
+               : pdTRUE;
+}
+
+/*****************************************************************************/
+/**
+ * メールボックスへ書き込み(上書き)
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 要素
+ *
+ * @return   ##
+ *
+ * @note     シーケンスロック: 書き込み中は奇数
+ *
+ ******************************************************************************/
+static void prvMboxWrite(ring_t *pxRing, const void *pvItem)
+{
+    uint32_t ulSeq = pxRing->ulMboxSeq;
+
+    if (ulSeq != RING_LOAD(&pxRing->ulMboxTaken))
+        pxRing->ulCoalesceCnt++; // 未受信の値を上書き
+    else
+        pxRing->ulPushCnt++;
+
+    RING_STORE(&pxRing->ulMboxSeq, ulSeq + 1);
+    memcpy(pxRing->pbMbox, pvItem, pxRing->ulItemSize);
+    vSimRingOnPush(pxRing, RING_MBOX_IDX);
+    RING_STORE(&pxRing->ulMboxSeq, ulSeq + 2);
+}
+
+/*****************************************************************************/
+/**
+ * メールボックスから読み込み
+ *
+ * @param    pxRing: リング
+ * @param    pvItem: 格納先
+ *
+ * @return   pdPASS / pdFAIL(無し、または書き込み中)
+ *
+ * @note     読んでいる間に上書きされたら読み直す
+ *
+ ******************************************************************************/
+static BOOL_t prvMboxRead(ring_t *pxRing, void *pvItem)
+{
+    uint32_t ulSeq;
+
+    for (;;)
+    {
+        ulSeq = RING_LOAD(&pxRing->ulMboxSeq);
+        if (ulSeq == pxRing->ulMboxTaken || (ulSeq & 1) != 0)
+            return pdFAIL;
+
+        memcpy(pvItem, pxRing->pbMbox, pxRing->ulItemSize);
+        if (RING_LOAD(&pxRing->ulMboxSeq) == ulSeq)
+        {
+            RING_STORE(&pxRing->ulMboxTaken, ulSeq);
+            return pdPASS;
+        }
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 残り待ち時間
+ *
+ * @param    xStart: 待ち開始時のTick
+ * @param    xTicksToWait: 全体の待ち時間
+ *
+ * @return   TickType_t 残り(0:タイムアウト)
+ *
+ * @note     portMAX_DELAYは無期限
+ *
+ ******************************************************************************/
+static TickType_t prvRemainTicks(TickType_t xStart, TickType_t xTicksToWait)
+{
+    TickType_t xElapsed;
+
+    if (xTicksToWait == portMAX_DELAY)
+        return portMAX_DELAY;
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    return (xElapsed >= xTicksToWait) ? 0 : xTicksToWait - xElapsed;
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************/
+/**
+ * @file util_ring.h
+ * @comments ロックフリー SPSC(1 Producer / 1 Consumer) リングバッファ
+ *           ドライバとctrl_main間のメッセージ経路で使う。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_UTIL_RING_H
+#define SRC_UTIL_RING_H
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stdint.h>
+
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "def_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* Producer側とConsumer側の添字を別のキャッシュラインに置く */
+#if defined(__x86_64__) || defined(__aarch64__)
+#define RING_CACHE_LINE 64
+#else
+#define RING_CACHE_LINE 32
+#endif
+#define RING_ALIGNED __attribute__((aligned(RING_CACHE_LINE)))
+
+/* 登録できるリング数(統計表示用) */
+#define RING_REGISTRY_SIZE 8
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/*
+ * 満杯時の動作
+ * BLOCK      : Producerが空くまで待つ(xTicksToWaitまで)
+ * DROP_OLDEST: 一番古い要素を捨てて入れる(待たない)
+ * COALESCE   : 1要素のメールボックスに入れ、後から来た要素で上書きする
+ *              (待たない、最新値だけ分かればよい経路用)
+ */
+typedef enum RING_POLICY
+{
+    RING_POLICY_BLOCK = 0,
+    RING_POLICY_DROP_OLDEST,
+    RING_POLICY_COALESCE,
+    MAX_RING_POLICY
+} eRingPolicy_t;
+
+/*
+ * リング本体
+ * 添字は単調増加(2^32で一周)し、(添字 & ulMask)でスロットを引く。
+ * ulTailはDROP_OLDEST時にProducerも進めるため、両者ともCASで更新する。
+ */
+typedef struct RING
+{
+    /* Producer側 */
+    volatile uint32_t ulHead RING_ALIGNED;
+    volatile uint32_t ulMboxSeq;         // 奇数:書き込み中
+    volatile uint32_t ulProducerWaiting; // BLOCK待ち中
+    TaskHandle_t xProducer;
+    uint32_t ulPushCnt;
+    uint32_t ulDropCnt;
+    uint32_t ulCoalesceCnt;
+    uint32_t ulBlockCnt;
+    uint32_t ulHighWater;
+
+    /* Consumer側 */
+    volatile uint32_t ulTail RING_ALIGNED;
+    volatile uint32_t ulMboxTaken;       // 最後に取り出したulMboxSeq
+    volatile uint32_t ulConsumerWaiting; // 受信待ち中
+    TaskHandle_t xConsumer;
+    uint32_t ulPopCnt;
+
+    /* 初期化後は不変 */
+    uint8_t *pbBuf RING_ALIGNED;
+    uint8_t *pbMbox;
+    uint32_t ulMask; // 要素数 - 1 (要素数は2の累乗)
+    uint32_t ulItemSize;
+    eRingPolicy_t ePolicy;
+    const char *pcName;
+} ring_t;
+
+typedef struct RING_STATS
+{
+    const char *pcName;
+    eRingPolicy_t ePolicy;
+    uint32_t ulSize;
+    uint32_t ulPushCnt;
+    uint32_t ulPopCnt;
+    uint32_t ulDropCnt;
+    uint32_t ulCoalesceCnt;
+    uint32_t ulBlockCnt;
+    uint32_t ulHighWater;
+} ringStats_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vRingInit(ring_t *pxRing, void *pvBuf, uint32_t ulSize,
+               uint32_t ulItemSize, void *pvMbox, eRingPolicy_t ePolicy,
+               const char *pcName);
+BOOL_t xRingTrySend(ring_t *pxRing, const void *pvItem);
+BOOL_t xRingTryReceive(ring_t *pxRing, void *pvItem);
+BOOL_t xRingSend(ring_t *pxRing, const void *pvItem, TickType_t xTicksToWait);
+uint32_t ulRingSendBatch(ring_t *pxRing, const void *pvItems, uint32_t ulNum,
+                         TickType_t xTicksToWait);
+BOOL_t xRingReceive(ring_t *pxRing, void *pvItem, TickType_t xTicksToWait);
+int lRingReceiveAny(ring_t *const *ppxRing, uint32_t ulNum, void *pvItem,
+                    TickType_t xTicksToWait);
+void vRingReset(ring_t *pxRing);
+uint32_t ulRingCount(const ring_t *pxRing);
+void vRingGetStats(const ring_t *pxRing, ringStats_t *pxStats);
+ring_t *pxRingGetRegistered(uint32_t ulIdx);
+
+#ifdef __cplusplus
+}
+
+/*****************************************************************************/
+/**
+ * 型付きリング(C++用)
+ * バッファとメールボックスを持ち、ring_tの関数を呼ぶだけ。
+ *
+ * @note     Nは2の累乗
+ *
+ ******************************************************************************/
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N != 0 && (N & (N - 1)) == 0, "SpscRing: N must be a power of 2");
+
+public:
+    void vInit(eRingPolicy_t ePolicy, const char *pcName)
+    {
+        vRingInit(&xRing, xBuf, N, sizeof(T), &xMbox, ePolicy, pcName);
+    }
+    BOOL_t xSend(const T &xItem, TickType_t xTicksToWait)
+    {
+        return xRingSend(&xRing, &xItem, xTicksToWait);
+    }
+    uint32_t ulSendBatch(const T *pxItems, uint32_t ulNum, TickType_t xTicksToWait)
+    {
+        return ulRingSendBatch(&xRing, pxItems, ulNum, xTicksToWait);
+    }
+    BOOL_t xReceive(T *pxItem, TickType_t xTicksToWait)
+    {
+        return xRingReceive(&xRing, pxItem, xTicksToWait);
+    }
+    void vReset() { vRingReset(&xRing); }
+    uint32_t ulCount() const { return ulRingCount(&xRing); }
+    ring_t *pxHandle() { return &xRing; }
+
+private:
+    ring_t xRing;
+    T xBuf[N];
+    T xMbox;
+};
+#endif
+#endif
@@ -0,0 +1,334 @@
+/*****************************************************************************/
+/**
+ * @file util_trace.c
+ * @comments 踏んでから得点までのレイテンシトレース
+ *           各モジュールのトレースポイントで時刻を記録し、区間毎の
+ *           ヒストグラムをゲーム毎に集計する。
+ *
+ *           パネル生成〜得点はPanelIDで対応付ける。パネル生成で全ポイントを
+ *           待ち状態にし、各ポイントは最初の1回だけ記録する(重複押下や
+ *           ゲーム外の送信は記録しない)。
+ *           効果音と体力表示はPanelIDを持たないため、直前の得点に対応付ける。
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+/* FreeRTOS Includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Standard Lib Includes */
+#include <stdio.h>
+#include <string.h>
+
+/* ESP-IDF Includes */
+#include "esp_timer.h"
+
+#include "util_trace.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+#define TRACE_BIT(ePoint) ((uint8_t)(1U << (ePoint)))
+#define TRACE_OUT_BITS (TRACE_BIT(TP_DFP_PLAY) | TRACE_BIT(TP_HPDLTB_OUT))
+#define TRACE_PANEL_BITS                                                       \
+    (TRACE_BIT(TP_CAN_TX_DEQ) | TRACE_BIT(TP_CAN_TX_DONE) |                    \
+     TRACE_BIT(TP_CAN_RX) | TRACE_BIT(TP_CTRL_RX) | TRACE_BIT(TP_SCORE))
+
+/*
+ * Constant Table
+ * 各トレースポイントで終わる区間と、その始点
+ */
+static const struct
+{
+    eTraceStage_t eStage;
+    eTracePoint_t eFrom;
+} csStageTbl[MAX_TRACE_POINT] = {
+    {MAX_TRACE_STAGE, TP_SPAWN},   // TP_SPAWN
+    {TS_TX_QUEUE, TP_SPAWN},       // TP_CAN_TX_DEQ
+    {TS_CAN_TX, TP_CAN_TX_DEQ},    // TP_CAN_TX_DONE
+    {TS_PANEL, TP_CAN_TX_DONE},    // TP_CAN_RX
+    {TS_RX_QUEUE, TP_CAN_RX},      // TP_CTRL_RX
+    {TS_SCORE, TP_CTRL_RX},        // TP_SCORE
+    {TS_SE, TP_SCORE},             // TP_DFP_PLAY
+    {TS_DISPLAY, TP_SCORE},        // TP_HPDLTB_OUT
+};
+
+static const char *const cpcStageName[MAX_TRACE_STAGE] = {
+    "tx_queue", "can_tx", "panel", "rx_queue",
+    "score", "se", "display", "total"};
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+static portMUX_TYPE xTraceMux = portMUX_INITIALIZER_UNLOCKED;
+
+static BOOL_t xTraceActive = pdFALSE;
+static uint32_t ulTraceGame = 0;
+
+// 記録中
+static int64_t llStamp[MAX_TRACE_POINT][MAX_PANEL_NUM];
+static uint8_t bArmed[MAX_PANEL_NUM]; // bit = 未通過のトレースポイント
+static uint8_t bOutArmed;             // 効果音/体力表示の待ち
+static int64_t llLastScoreUs;
+static traceHist_t stLive[MAX_TRACE_STAGE];
+
+// 前回のゲーム(送信用)
+static traceHist_t stLast[MAX_TRACE_STAGE];
+static uint32_t ulLastGame = 0;
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+static void prvTraceAdd(eTraceStage_t eStage, int64_t llDtUs);
+
+/*****************************************************************************/
+/* Public Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * ゲーム開始(集計をリセットして記録開始)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vTraceStartGame()
+{
+    portENTER_CRITICAL(&xTraceMux);
+    memset(llStamp, 0x00, sizeof(llStamp));
+    memset(bArmed, 0x00, sizeof(bArmed));
+    memset(stLive, 0x00, sizeof(stLive));
+    bOutArmed = 0;
+    ulTraceGame++;
+    xTraceActive = pdTRUE;
+    portEXIT_CRITICAL(&xTraceMux);
+}
+
+/*****************************************************************************/
+/**
+ * ゲーム終了(記録停止、集計を送信用へコピー)
+ *
+ * @param    ##
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vTraceFinishGame()
+{
+    portENTER_CRITICAL(&xTraceMux);
+    xTraceActive = pdFALSE;
+    memcpy(stLast, stLive, sizeof(stLast));
+    ulLastGame = ulTraceGame;
+    portEXIT_CRITICAL(&xTraceMux);
+}
+
+#if configTRACE_ENABLE == 1
+/*****************************************************************************/
+/**
+ * トレースポイント
+ *
+ * @param    ePoint: トレースポイント
+ * @param    ulPanelId: PANEL_NO(TP_DFP_PLAY/TP_HPDLTB_OUTは未使用)
+ *
+ * @return   ##
+ *
+ * @note     どのタスクからも呼べる。ゲーム外では何もしない。
+ *
+ ******************************************************************************/
+void vTracePoint(eTracePoint_t ePoint, uint32_t ulPanelId)
+{
+    int64_t llNowUs;
+    eTracePoint_t eFrom = csStageTbl[ePoint].eFrom;
+
+    if (xTraceActive != pdTRUE)
+        return;
+    llNowUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&xTraceMux);
+    if (ePoint == TP_DFP_PLAY || ePoint == TP_HPDLTB_OUT)
+    {
+        if (bOutArmed & TRACE_BIT(ePoint))
+        {
+            bOutArmed &= ~TRACE_BIT(ePoint);
+            prvTraceAdd(csStageTbl[ePoint].eStage, llNowUs - llLastScoreUs);
+        }
+    }
+    else if (ulPanelId >= PANEL_1 && ulPanelId < MAX_PANEL_NUM)
+    {
+        if (ePoint == TP_SPAWN)
+        {
+            llStamp[TP_SPAWN][ulPanelId] = llNowUs;
+            bArmed[ulPanelId] = TRACE_PANEL_BITS;
+        }
+        else if (bArmed[ulPanelId] & TRACE_BIT(ePoint))
+        {
+            bArmed[ulPanelId] &= ~TRACE_BIT(ePoint);
+            llStamp[ePoint][ulPanelId] = llNowUs;
+            prvTraceAdd(csStageTbl[ePoint].eStage,
+                        llNowUs - llStamp[eFrom][ulPanelId]);
+
+            if (ePoint == TP_SCORE)
+            {
+                prvTraceAdd(TS_TOTAL, llNowUs - llStamp[TP_SPAWN][ulPanelId]);
+                llLastScoreUs = llNowUs;
+                bOutArmed = TRACE_OUT_BITS;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&xTraceMux);
+}
+#endif
+
+/*****************************************************************************/
+/**
+ * 前回のゲームの集計を取得
+ *
+ * @param    pxHist: 格納先(MAX_TRACE_STAGE個)
+ *
+ * @return   ##
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+void vTraceGetLastGame(traceHist_t *pxHist)
+{
+    portENTER_CRITICAL(&xTraceMux);
+    memcpy(pxHist, stLast, sizeof(stLast));
+    portEXIT_CRITICAL(&xTraceMux);
+}
+
+/*****************************************************************************/
+/**
+ * 前回のゲームの集計をJSONで出力(GM向け)
+ * {"game":n,"unit":"us","stage":{"tx_queue":{"n":..,"mean":..,"max":..,
+ *  "hist":[..]},...}}
+ *
+ * @param    pcBuf: 出力先
+ * @param    xLen: 出力先のサイズ
+ *
+ * @return   出力した文字数(切り詰めた場合はxLen - 1)
+ *
+ * @note     ##
+ *
+ ******************************************************************************/
+int lTraceFormatJson(char *pcBuf, size_t xLen)
+{
+    traceHist_t tHist[MAX_TRACE_STAGE];
+    uint32_t ulGame;
+    size_t xPos;
+
+    portENTER_CRITICAL(&xTraceMux);
+    memcpy(tHist, stLast, sizeof(tHist));
+    ulGame = ulLastGame;
+    portEXIT_CRITICAL(&xTraceMux);
+
+    xPos = snprintf(pcBuf, xLen, "{\"game\":%u,\"unit\":\"us\",\"stage\":{", ulGame);
+    for (int i = 0; i < MAX_TRACE_STAGE && xPos < xLen; i++)
+    {
+        xPos += snprintf(pcBuf + xPos, xLen - xPos,
+                         "%s\"%s\":{\"n\":%u,\"mean\":%u,\"max\":%u,\"hist\":[",
+                         i ? "," : "", cpcStageName[i], tHist[i].ulCount,
+                         tHist[i].ulCount ? (uint32_t)(tHist[i].ullSumUs / tHist[i].ulCount) : 0,
+                         tHist[i].ulMaxUs);
+        for (int j = 0; j < TRACE_HIST_BINS && xPos < xLen; j++)
+        {
+            xPos += snprintf(pcBuf + xPos, xLen - xPos, "%s%u", j ? "," : "",
+                             tHist[i].usBin[j]);
+        }
+        if (xPos < xLen)
+            xPos += snprintf(pcBuf + xPos, xLen - xPos, "]}");
+    }
+    if (xPos < xLen)
+        xPos += snprintf(pcBuf + xPos, xLen - xPos, "}}");
+
+    return (int)(xPos < xLen ? xPos : xLen - 1);
+}
+
+/*****************************************************************************/
+/**
+ * 前回のゲームの集計をPOST用に出力(Webserver向け)
+ * 区間名:件数:平均us:最大us:ビン0.ビン1...を'|'で区切る
+ *
+ * @param    pcBuf: 出力先
+ * @param    xLen: 出力先のサイズ
+ *
+ * @return   出力した文字数(切り詰めた場合はxLen - 1)
+ *
+ * @note     URLエンコード不要な文字のみ使う
+ *
+ ******************************************************************************/
+int lTraceFormatForm(char *pcBuf, size_t xLen)
+{
+    traceHist_t tHist[MAX_TRACE_STAGE];
+    size_t xPos = 0;
+
+    vTraceGetLastGame(tHist);
+
+    pcBuf[0] = '\0';
+    for (int i = 0; i < MAX_TRACE_STAGE && xPos < xLen; i++)
+    {
+        xPos += snprintf(pcBuf + xPos, xLen - xPos, "%s%s:%u:%u:%u:",
+                         i ? "|" : "", cpcStageName[i], tHist[i].ulCount,
+                         tHist[i].ulCount ? (uint32_t)(tHist[i].ullSumUs / tHist[i].ulCount) : 0,
+                         tHist[i].ulMaxUs);
+        for (int j = 0; j < TRACE_HIST_BINS && xPos < xLen; j++)
+        {
+            xPos += snprintf(pcBuf + xPos, xLen - xPos, "%s%u", j ? "." : "",
+                             tHist[i].usBin[j]);
+        }
+    }
+
+    return (int)(xPos < xLen ? xPos : xLen - 1);
+}
+
+/*****************************************************************************/
+/* Private Function
+******************************************************************************/
+
+/*****************************************************************************/
+/**
+ * ヒストグラムへ追加
+ *
+ * @param    eStage: 区間
+ * @param    llDtUs: 経過時間[us]
+ *
+ * @return   ##
+ *
+ * @note     xTraceMux取得中に呼ぶこと
+ *
+ ******************************************************************************/
+static void prvTraceAdd(eTraceStage_t eStage, int64_t llDtUs)
+{
+    traceHist_t *pxHist = &stLive[eStage];
+    uint32_t ulUs = (llDtUs < 0) ? 0 : (uint32_t)llDtUs;
+    uint32_t ulMs = ulUs / 1000;
+    int iBin = 0;
+
+    while (ulMs > 0 && iBin < TRACE_HIST_BINS - 1)
+    {
+        ulMs >>= 1;
+        iBin++;
+    }
+
+    pxHist->ulCount++;
+    pxHist->ullSumUs += ulUs;
+    if (ulUs > pxHist->ulMaxUs)
+        pxHist->ulMaxUs = ulUs;
+    if (pxHist->usBin[iBin] < UINT16_MAX)
+        pxHist->usBin[iBin]++;
+}
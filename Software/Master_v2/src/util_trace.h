@@ -0,0 +1,94 @@
+/*****************************************************************************/
+/**
+ * @file util_trace.h
+ * @comments 踏んでから得点までのレイテンシトレース
+ *
+ * MODIFICATION HISTORY:
+ *
+ * Ver   Who           Date        Changes
+ * ----- ------------- ----------- --------------------------------------------
+ * 0.01  drmus0715     2026/10/17  First release
+ *
+ ******************************************************************************/
+#ifndef SRC_UTIL_TRACE_H
+#define SRC_UTIL_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* Include Files
+******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "def_system.h"
+
+/*****************************************************************************/
+/* Constant Definitions
+******************************************************************************/
+/* ヒストグラム: [0]<1ms, [k]<2^k ms, [最後]>=1024ms */
+#define TRACE_HIST_BINS 12
+
+/*****************************************************************************/
+/* TAG Definitions
+******************************************************************************/
+/* トレースポイント(通過順) */
+typedef enum TRACE_POINT
+{
+    TP_SPAWN = 0,   // ctrl_main: パネル生成
+    TP_CAN_TX_DEQ,  // drv_can: CAN_txタスクがQueueから取り出した
+    TP_CAN_TX_DONE, // drv_can: can_transmit完了
+    TP_CAN_RX,      // drv_can: 踏まれたフレームを受信
+    TP_CTRL_RX,     // ctrl_main: RxタスクがQueueから取り出した
+    TP_SCORE,       // ctrl_main: 得点更新
+    TP_DFP_PLAY,    // drv_dfplayer: 効果音再生
+    TP_HPDLTB_OUT,  // drv_hpdltb: 体力表示更新
+    MAX_TRACE_POINT
+} eTracePoint_t;
+
+/* 区間 */
+typedef enum TRACE_STAGE
+{
+    TS_TX_QUEUE = 0, // SPAWN -> CAN_TX_DEQ
+    TS_CAN_TX,       // CAN_TX_DEQ -> CAN_TX_DONE
+    TS_PANEL,        // CAN_TX_DONE -> CAN_RX (バス＋パネル点灯＋プレイヤー)
+    TS_RX_QUEUE,     // CAN_RX -> CTRL_RX
+    TS_SCORE,        // CTRL_RX -> SCORE
+    TS_SE,           // SCORE -> DFP_PLAY
+    TS_DISPLAY,      // SCORE -> HPDLTB_OUT
+    TS_TOTAL,        // SPAWN -> SCORE
+    MAX_TRACE_STAGE
+} eTraceStage_t;
+
+typedef struct TRACE_HIST
+{
+    uint32_t ulCount;
+    uint32_t ulMaxUs;
+    uint64_t ullSumUs;
+    uint16_t usBin[TRACE_HIST_BINS];
+} traceHist_t;
+
+/*****************************************************************************/
+/* Variable Definitions
+******************************************************************************/
+
+/*****************************************************************************/
+/* Function Prototypes
+******************************************************************************/
+void vTraceStartGame();
+void vTraceFinishGame();
+#if configTRACE_ENABLE == 1
+void vTracePoint(eTracePoint_t ePoint, uint32_t ulPanelId);
+#else
+#define vTracePoint(ePoint, ulPanelId)
+#endif
+void vTraceGetLastGame(traceHist_t *pxHist);
+int lTraceFormatJson(char *pcBuf, size_t xLen);
+int lTraceFormatForm(char *pcBuf, size_t xLen);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
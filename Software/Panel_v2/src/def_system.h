@@ -19,11 +19,20 @@
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
 
+// Common Include (Master_v2と共通)
+#include "tb_canproto.h"
+#include "tb_timesync.h"
+#include "tb_canfw.h"
+
 /*****************************************************************************/
 /* Macro
 ******************************************************************************/
 #define COUNTOF(array) (sizeof(array) / sizeof(array[0]))
 #define SETCOLOR(r, g, b) (((uint32_t)r << 16) | ((uint32_t)g << 8) | b)
+#define LED_COUNT 4 // Serial LEDの数(LEDの色の置き場の大きさにも使う)
+#if LED_COUNT != TBCAN_PIXEL_NUM
+#error "LED_COUNTはTBCAN_PIXEL_NUM(tb_canproto.h)と合わせること"
+#endif
 
 /*****************************************************************************/
 /* TAG Definitions
@@ -47,6 +56,25 @@ enum COLOR {
     MAX_COLOR
 };
 
+/* Panelの状態(loop()の状態遷移) */
+enum PANEL_STATE {
+    PANEL_ST_IDLE = 0, // 消灯(踏まれている間は白)
+    PANEL_ST_ARMED,    // 点灯中、踏まれたら返信(BtnFlg)
+    PANEL_ST_START_SW, // スタートスイッチ、踏まれるまで点灯し直す
+    PANEL_ST_DEMO,     // デモ点灯(踏まれても返さない)
+    PANEL_ST_ANIM,     // アニメーション(自分で描く、踏まれても返さない)
+    PANEL_ST_PIXEL,    // LED毎の色(踏まれても返さない)
+
+    MAX_PANEL_STATE
+};
+
+/* センサのイベント */
+enum PANEL_EVENT {
+    PANEL_EV_NONE = 0,
+    PANEL_EV_PRESS,   // 踏まれた
+    PANEL_EV_RELEASE, // 離された
+};
+
 /********************************** struct ***********************************/
 /*
  * CAN Massage Definitions
@@ -54,13 +82,25 @@ enum COLOR {
  */
 typedef struct CAN_MESSAGE {
     uint32_t ulCanId;
-    byte bPanelId;    // PanelID
-    byte bColorInfoR; // 色情報 - R
-    byte bColorInfoG; // 色情報 - G
-    byte bColorInfoB; // 色情報 - B
-    byte bBtnFlag;    // パネル押下許可／押下フラグ
-    byte bLightTime;  // LED点灯時間
+    byte bPanelId;          // PanelID
+    byte bColorInfoR;       // 色情報 - R
+    byte bColorInfoG;       // 色情報 - G
+    byte bColorInfoB;       // 色情報 - B
+    byte bBtnFlag;          // パネル押下許可／押下フラグ
+    uint16_t usLightTimeMs; // LED点灯時間[ms]
     byte bStartSwFlag;
+    byte bFade;             // フェードカーブ(TBCAN_FADE_*)
+    byte bSeq;              // シーケンス番号(返信で返す)
+    byte bProto;            // 受信したバージョン(返信も同じバージョンで送る)
+    byte bCmd;              // 0以外: Masterからの問い合わせ(TBCAN_CMD_*、他の項目は無効)
+    uint32_t ulRxUs;        // 受信割り込みの時刻[us](SYNCで使う)
+    uint32_t ulMasterUs;    // FOLLOW_UPのMasterの時刻[us](下位24bit)
+    byte bTimed;            // 返信に踏んだ時刻を付ける
+    uint16_t usPressTick;   // 踏んだ時刻(Masterの時刻, TBCAN_TIME_TICK_SHIFT単位)
+    uint16_t usReactTick;   // 反応時間(TBCAN_TIME_TICK_SHIFT単位)
+    byte bAckReq;           // 配送確認(受信: ACKを返す / 送信: ACKを待つ)
+    byte bRelReply;         // 返信にACK要求を付けてよい(Masterが付ける)
+    tbCanAnim_t xAnim;      // アニメーション(bCmdがTBCAN_CMD_ANIMのとき)
 } canCommMsg_t;
 
 /* LED Color Table 定義 */
@@ -73,13 +113,60 @@ typedef struct LED_COLOR_TBL {
  * Serial LED 情報格納構造体
  */
 typedef struct SERIAL_LED_INFO {
-    int32_t lOffTimeMs; //消灯時間: LEDの割り込みによって変わる？
-    uint32_t ulColor;   //色情報（*.Colorクラス）
+    uint32_t ulStartMs; // 点灯を始めた時刻[ms]
+    uint32_t ulStepQ24; // 1msあたりのカーブの進み((1 << 24) / 点灯時間)
+    uint32_t ulColor;   // 最後に出した色（*.Colorクラス、変わったときだけshow()）
+    uint16_t usLightMs; // 点灯時間[ms]
+    byte bFade;         // フェードカーブ(TBCAN_FADE_*)
     byte bColorInfoR;   // 色情報 - R
     byte bColorInfoG;   // 色情報 - G
     byte bColorInfoB;   // 色情報 - B
+    bool bShown;        // 1回以上show()した
 } ledInfo_t;
 
+/*
+ * アニメーション情報格納構造体
+ */
+typedef struct PANEL_ANIM_INFO {
+    uint32_t ulStartMs;         // 開始時刻[ms](同期していればMasterの指定に合わせる)
+    uint32_t ulStepQ24;         // 1msあたりの位相の進み((1 << 24) / 周期)
+    uint16_t usPeriodMs;        // 周期[ms]
+    uint16_t usDurationMs;      // 続ける時間[ms](0: 次の指示まで)
+    byte bAnim;                 // TBCAN_ANIM_*
+    byte bColorInfoR;           // 色情報 - R
+    byte bColorInfoG;           // 色情報 - G
+    byte bColorInfoB;           // 色情報 - B
+    byte bCol;                  // 盤面の列(SWEEPの位相をずらす)
+} animInfo_t;
+
+/*
+ * LEDの色の置き場(2面)
+ * 表はstripに出している色、裏に次のフレームを書いてから比べ、
+ * どれかが変わったときだけshow()して表裏を入れ替える
+ */
+typedef struct LED_PIXEL_BUF {
+    uint32_t ulPix[2][LED_COUNT]; // *.Colorクラス
+    byte bFront;                  // 表の面
+} ledPixBuf_t;
+
+/*
+ * センサのイベント(割り込みで積み、loop()で取り出す)
+ */
+typedef struct PANEL_EVENT_ITEM {
+    byte bType;    // PANEL_EV_*
+    uint32_t ulUs; // エッジの時刻[us]
+} panelEvent_t;
+
+/*
+ * 受信したフレーム(CANの割り込みで積み、loop()で取り出す)
+ */
+typedef struct CAN_RX_ITEM {
+    uint32_t ulCanId;
+    uint32_t ulRxUs;           // 受信割り込みの時刻[us]
+    byte bLen;
+    byte bData[TBCAN_DLC];
+} canRxItem_t;
+
 /*
  * Pin設定構造体定義
  */
@@ -92,11 +179,26 @@ typedef struct PIN_CONF {
 /* Constant Definitions
 ******************************************************************************/
 // CAN
-#define MASTER_CAN_ID 0x00
+#define MASTER_CAN_ID TBCAN_ID_MASTER
+#define STATUS_CAN_ID(id) (TBCAN_ID_STATUS_BASE + (id)) // 死活監視(起動時／周期／問い合わせ)
+
+// ファームウェアのバージョン(死活監視でMasterへ知らせる)
+#define PANEL_FW_VER_MAJOR 2
+#define PANEL_FW_VER_MINOR 5
+
+/*
+ * グループ宛てCAN ID (tb_canproto.hでMasterと共有)
+ * bit10:グループ bit9..5:行 bit4..0:列。0のビットの行×列のPanelが受信する。
+ */
+#define CAN_ID_GROUP_FLAG TBCAN_ID_GROUP_FLAG
+#define CAN_ID_GROUP_ROW_SHIFT TBCAN_ID_GROUP_ROW_SHIFT
+#define CAN_ID_STD_MASK TBCAN_ID_STD_MASK
+#define PANEL_GRID_SIZE TBCAN_GRID_SIZE // 5x5, PanelIDは行優先(1..25)
 
 // GPIO ピン定義
 #define PIN_PANEL_SENSOR 2
 #define PIN_SERIAL_LED 6
+#define PIN_CAN_INT 3 // MCP2515のINT(受信バッファにフレームがある間L)
 
 // GPIO ピン設定 ※順番変更禁止！！！
 const pinConf_t sPinConfig[] = {
@@ -121,6 +223,65 @@ const ledColor_t sColorTbl[] = {
     {BLUE_L, SETCOLOR(0, 0, LOW_BR)},
 };
 
+/*
+ * LED Fade Table
+ * フェードは明るさ(0..255)をカーブの表で求め、ガンマ補正して色に掛ける。
+ * カーブは位置(0..65535)の上位6bitで引き、次の点と直線補間する(65点)
+ */
+#define LED_CURVE_POINTS 65
+#define LED_CURVE_IDX_SHIFT 10 // 位置 >> 10 = 表の番号
+#define LED_CURVE_FRAC_SHIFT 3 // 位置 >> 3 & 0x7F = 補間の割合(7bit)
+#define LED_CURVE_FRAC_MASK 0x7F
+#define LED_CURVE_FRAC_BITS 7
+
+/* ガンマ補正(2.2) 明るさ -> 出力の倍率(/256) */
+const uint8_t bGammaTbl[256] PROGMEM = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+/* カーブ(明るさ) [0]:LINEAR [1]:EASE_OUT (1-t)^2 [2]:PULSE 1周期の余弦 */
+#define LED_CURVE_LINEAR 0
+#define LED_CURVE_EASE_OUT 1
+#define LED_CURVE_PULSE 2
+const uint8_t bCurveTbl[][LED_CURVE_POINTS] PROGMEM = {
+    {
+        255, 251, 247, 243, 239, 235, 231, 227, 223, 219, 215, 211, 207,
+        203, 199, 195, 191, 187, 183, 179, 175, 171, 167, 163, 159, 155,
+        151, 147, 143, 139, 135, 131, 128, 124, 120, 116, 112, 108, 104,
+        100,  96,  92,  88,  84,  80,  76,  72,  68,  64,  60,  56,  52,
+         48,  44,  40,  36,  32,  28,  24,  20,  16,  12,   8,   4,   0,
+    },
+    {
+        255, 247, 239, 232, 224, 217, 209, 202, 195, 188, 182, 175, 168,
+        162, 156, 149, 143, 138, 132, 126, 121, 115, 110, 105, 100,  95,
+         90,  85,  81,  76,  72,  68,  64,  60,  56,  52,  49,  45,  42,
+         39,  36,  33,  30,  27,  25,  22,  20,  18,  16,  14,  12,  11,
+          9,   8,   6,   5,   4,   3,   2,   2,   1,   1,   0,   0,   0,
+    },
+    {
+        255, 254, 253, 250, 245, 240, 234, 226, 218, 208, 198, 188, 176,
+        165, 152, 140, 128, 115, 103,  90,  79,  67,  57,  47,  37,  29,
+         21,  15,  10,   5,   2,   1,   0,   1,   2,   5,  10,  15,  21,
+         29,  37,  47,  57,  67,  79,  90, 103, 115, 127, 140, 152, 165,
+        176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254, 255,
+    },
+};
+
 /*****************************************************************************/
 /* Variable Definitions
 ******************************************************************************/
@@ -15,11 +15,9 @@
 /* Include Files
 ******************************************************************************/
 #include <Arduino.h>
-#define DEBUG_EN 1
 // library Include
 #include <SPI.h>
 #include "mcp_can.h"
-#include "MsTimer2.h"
 #include "Adafruit_NeoPixel.h"
 
 // User Include
@@ -31,12 +29,33 @@
 // CAN
 const int SPI_CS_PIN = 10;
 const int CAN_INTR_NO = 1;
-#define CAN_RX_TIMEOUT_CNT 64
-#define LIGHT_TIME_CONV_NUM 1000 // Sec -> miliSec
+#define CAN_RX_RING_NUM 8 // 受信の列の大きさ(2の累乗)
 
-// Serial LED
-#define LED_COUNT 4
-#define SERIAL_LED_SEND_INTERVAL_MS 100
+// MCP2515(受信オーバーフローのフラグはライブラリから読めないので直接読む)
+#define MCP_SPI_CLOCK 4000000
+#define MCP_SPI_READ 0x03
+#define MCP_SPI_BIT_MODIFY 0x05
+#define MCP_REG_EFLG 0x2D
+#define MCP_EFLG_RX0OVR 0x40
+#define MCP_EFLG_RX1OVR 0x80
+#define MCP_EFLG_RXOVR (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR)
+
+// センサ(INT0 = PIN_PANEL_SENSOR、両エッジ)
+const int SENSOR_INTR_NO = 0;
+#define PANEL_EVENT_NUM 8 // イベント列の大きさ(2の累乗)
+
+// Serial LED (LED_COUNTはdef_system.h)
+#define PANEL_LED_FRAME_MS 10 // フェード、アニメーションのフレーム間隔(100Hz)
+#define LED_PULSE_STEP_Q24 ((1UL << 24) / TBCAN_PULSE_PERIOD_MS)
+#define LED_PIXEL_POS_STEP (0x10000UL / LED_COUNT)       // CHASE: LED毎の位相のずれ
+#define LED_COL_POS_STEP (0x10000UL / PANEL_GRID_SIZE)   // SWEEP: 列毎の位相のずれ
+#define LED_HUE_PIXEL_STEP (0x100 / LED_COUNT)           // RAINBOW: LED毎の色相のずれ
+#define LED_STROBE_ON_POS 0x2000                         // STROBE: 周期の1/8だけ光る
+
+// デバッグ出力 0:無し 1:状態遷移など 2:受信したフレームの中身、フレーム毎の送信・ACKも
+// 送信バッファ(64byte)に空きが無いときは捨てる(loop()を止めない)
+#define DEBUG_EN 1
+#define PANEL_LOG_VALUE_LEN 12 // 数値と改行の分
 
 /*****************************************************************************/
 /* Variable Definitions
@@ -44,12 +63,72 @@ const int CAN_INTR_NO = 1;
 // CAN
 MCP_CAN CAN(SPI_CS_PIN); // Set CS to pin 10
 uint32_t ulPanelId;
-bool bCanIntrFlg = false;
-canCommMsg_t canMsg; // 受送信するCAN Msg(割り込み対策)
+canCommMsg_t canMsg; // 実行中の指示
+canCommMsg_t canMsgDeferred; // 踏まれている間に届いた点灯の指示(離されたら実行)
+bool bCanMsgDeferred;
+uint32_t ulDeferredMs;
+
+// 受信の列(Producer: CANの割り込み、Consumer: loop())
+volatile canRxItem_t xCanRxBuf[CAN_RX_RING_NUM];
+volatile byte bCanRxHead;
+volatile byte bCanRxTail;
+volatile byte bCanRxFull; // 列が一杯でMCP2515に残した回数(一周する)
+byte bCanRxOvr;           // MCP2515の受信オーバーフロー(一周する)
+byte bRxFullSent;         // 最後に死活監視で送った回数
+byte bRxOvrSent;
+
+// 状態遷移
+enum PANEL_STATE ePanelState = PANEL_ST_IDLE;
+
+// センサのイベント列(Producer: センサの割り込み、Consumer: loop())
+volatile panelEvent_t xEventBuf[PANEL_EVENT_NUM];
+volatile byte bEventHead;
+byte bEventTail;
+volatile byte bEventLost;      // 列が一杯で捨てたイベント
+volatile bool bEventLevel;     // 最後に積んだレベル(true: 踏まれている)
+uint32_t ulPressTxMaxUs;       // 踏んでから返信を送るまでの最大[us]
+
+// 時刻同期
+tbTimeSync_t xTimeSync;
+byte bSyncSeq;          // 最後に受けたSYNCの番号
+uint32_t ulSyncRxUs;    // そのSYNCの受信割り込みの時刻
+bool bSyncPending;      // FOLLOW_UP待ち
+uint32_t ulLedOnUs;      // 最初にLEDを点けた時刻
+bool bLedOnStamped;
+
+// 配送確認
+bool bRelRxValid;        // ACK要求のフレームを受けた
+byte bRelRxSeq;          // 最後に受けたACK要求のフレームの番号
+canCommMsg_t canMsgRel;  // ACK待ちの返信
+uint32_t ulRelCanId;
+bool bRelPending;
+byte bRelTry;
+uint32_t ulRelStartMs;
+uint32_t ulRelWaitMs;
+
+// PanelID毎に枠をずらして返す応答(問い合わせ、ファームウェア配信)
+bool bDiscoverPending;
+uint32_t ulDiscoverDueMs;
+bool bFwReplyPending;
+byte bFwReplySession;
+uint32_t ulFwReplyDueMs;
+
+// 死活監視
+uint8_t bStatusCount;      // 送った回数(Masterが取りこぼしを数える)
+uint32_t ulLastStatusMs;   // 最後に送った時刻
+uint32_t ulPressedSinceMs; // センサが踏まれ始めた時刻
+bool bSensorPressed;
 
 // Serial LED
 Adafruit_NeoPixel strip(LED_COUNT, PIN_SERIAL_LED, NEO_GRB + NEO_KHZ800);
 ledInfo_t tLedinfo;
+uint32_t ulLedFrameMs;     // 最後にフレームを計算した時刻
+uint16_t usLedCalcCycMax;  // 1フレームの計算の最大[cycle]
+uint16_t usLedShowCycMax;  // show()の最大[cycle]
+animInfo_t tAniminfo;
+ledPixBuf_t tLedPix;
+tbCanPixelRx_t xPixelRx;  // 揃えているLED毎の色のフレーム
+tbCanPixel_t xPixelInfo;  // 揃ったLED毎の色(PIXELで出す)
 
 /*****************************************************************************/
 /* Function Prototypes
@@ -57,19 +136,60 @@ ledInfo_t tLedinfo;
 void vInitGpio();           // GPIO Set Mode
 uint32_t ulGetPanelCanID(); // CAN ID取得
 
+/* 状態遷移 */
+void vPanelEventService();
+void vPanelCanService();
+void vPanelCanDispatch(canCommMsg_t *canRx);
+void vPanelApply(canCommMsg_t *canRx);
+void vPanelApplyDeferred();
+void vPanelStateService();
+void vPanelSlotService();
+void vPanelEnter(enum PANEL_STATE eState);
+void vPanelPress(uint32_t ulPressUs);
+bool bPanelLedExpired();
+// Sensor Intr Function
+void vSensorIntrHandler();
+// デバッグ出力
+void vPanelLog(const char *pcMsg);
+void vPanelLog(const char *pcMsg, int32_t lValue);
+
 /* CAN */
 bool bInitCanDriver(uint32_t ulPanelId); // Init
 // CAN Intr Function
 void vCanIntrHandler();
+void vCanRxDrain(uint32_t ulRxUs);
+void vCanRxCheckOverflow();
 // CAN Tx Wrapper
 byte bCanSendWrapper(canCommMsg_t canMsg, uint32_t canId);
+byte bCanSendReliable(canCommMsg_t canMsg, uint32_t canId);
+void vCanRelService();
+void vCanRelAck(byte bSeq);
+byte bPanelSendAck(byte bSeq);
 // CAN Rx
 byte uCanReceiveInfo(canCommMsg_t *canMsg);
-void vClearCanRxBuffer();
+// 死活監視
+byte bPanelSendStatus(byte bReason);
+void vPanelHeartbeat();
+// ファームウェア配信
+byte bPanelSendFwReply(byte bFwStatus, byte bSession);
+// 時刻同期
+void vPanelTimeSync(canCommMsg_t *canMsg);
+void vPanelStampPress(canCommMsg_t *canMsg, uint32_t ulPressUs);
 
 /* Serial LED */
-void vSerialLedIntrHandler();
+void vPanelLedService();
+void vPanelLedRender();
+uint8_t bLedLevel(ledInfo_t *pxLed, uint32_t ulNowMs);
+uint8_t bLedCurve(uint8_t bCurve, uint16_t usPos);
+uint8_t bLedScale(uint8_t bColor, uint8_t bGamma);
+void vPanelAnimStart(canCommMsg_t *canRx);
+bool bPanelAnimExpired();
+void vPanelAnimRender();
+uint32_t ulAnimPixel(animInfo_t *pxAnim, uint16_t usPos, uint8_t bPixel);
 void vSerialLedLightUp(uint32_t ulColor);
+bool bLedPixCommit();
+void vPanelPixelStart();
+void vPanelPixelRender();
 void vConvCanMsg2LedInfo(canCommMsg_t *canMsg, ledInfo_t *ledinfo);
 
 /*****************************************************************************/
@@ -84,7 +204,10 @@ void vConvCanMsg2LedInfo(canCommMsg_t *canMsg, ledInfo_t *ledinfo);
  *
  * @return  ##
  *
- * @note		##
+ * @note		loop()は待たずに回り続ける(1周は数十us)。
+ *          センサはピン変化の割り込みでイベント列へ、CANは受信割り込みで
+ *          MCP2515の受信バッファを両方読んで受信の列へ積み、loop()が取り出す。
+ *          踏まれたイベントは他の処理より先に返信を送る
  *
  ******************************************************************************/
 void setup()
@@ -102,152 +225,410 @@ void setup()
     Serial.println(ulPanelId);
 
     // Init Function
+    vTbSyncInit(&xTimeSync);
     bInitCanDriver(ulPanelId);
 
-    // Serial Led Send Timer
-    MsTimer2::set(SERIAL_LED_SEND_INTERVAL_MS, vSerialLedIntrHandler);
+    // センサ(起動時に踏まれていればその状態から始める)
+    bEventLevel = digitalRead(PIN_PANEL_SENSOR) != HIGH;
+    bSensorPressed = bEventLevel;
+    ulPressedSinceMs = millis();
+    attachInterrupt(SENSOR_INTR_NO, vSensorIntrHandler, CHANGE);
+
+    // 起動をMasterへ知らせる(ゲーム中の再起動を見分ける)
+    bPanelSendStatus(TBCAN_STATUS_BOOT);
+
+    // フレームの計測(Timer1: 分周無しのフリーラン、1カウント = 1サイクル)
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    vPanelEnter(PANEL_ST_IDLE);
 }
 
 void loop()
 {
-    bool bPanelPushFlg = false;
-    bool bTimeoutFlg = false;
+    vPanelEventService(); // 踏まれた -> 返信(最優先)
+    vPanelCanService();   // 受信したフレームを全部処理
+    vPanelStateService(); // 点灯時間切れ
+    vPanelLedService();   // フェード
+    vCanRelService();     // ACK待ちの再送
+    vPanelSlotService();  // 枠をずらした応答
+    vPanelHeartbeat();
+}
 
-    /* CAN Msg 待機状態 */
-    vClearCanRxBuffer(); // CAN_Rx Buffer Clear
-    bCanIntrFlg = false; // CAN_Rx Flag Clear
-    Serial.println("Wait CAN Message");
-    while (bCanIntrFlg != true)
+/*****************************************************************************/
+/**
+ * センサのイベントを処理する
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    列が溢れたとき(割り込みが続いた)はピンを読み直して合わせる
+ *
+ ******************************************************************************/
+void vPanelEventService()
+{
+    panelEvent_t xEvent;
+
+    while (bEventTail != bEventHead)
     {
-        if (digitalRead(PIN_PANEL_SENSOR) != HIGH)
+        xEvent.bType = xEventBuf[bEventTail].bType;
+        xEvent.ulUs = xEventBuf[bEventTail].ulUs;
+        bEventTail = (bEventTail + 1) & (PANEL_EVENT_NUM - 1);
+
+        if (xEvent.bType == PANEL_EV_PRESS)
         {
-            // LED点灯
-            vSerialLedLightUp(sColorTbl[WHITE_L].ulColor);
-            /*
-             * 踏んでる時にMasterからCANが来たときの対策
-             * 踏まれているときはCANのメッセージをリセットし続ける
-             * 念の為Delayをおいて見る、ちょっと反応悪くなるかも
-             */
-            vClearCanRxBuffer(); // CAN_Rx Buffer Clear
-            memset(&canMsg, 0x00, sizeof(canCommMsg_t));
-            // delay(50);
+            if (!bSensorPressed)
+                ulPressedSinceMs = millis();
+            bSensorPressed = true;
+            vPanelPress(xEvent.ulUs);
         }
         else
         {
-            // LED消灯
-            vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
+            bSensorPressed = false;
+            if (ePanelState == PANEL_ST_IDLE)
+                vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
+            if (ePanelState == PANEL_ST_IDLE && bCanMsgDeferred)
+                vPanelApplyDeferred();
         }
     }
 
-    /* CAN受信 */
-    bCanIntrFlg = false;
-    uint32_t ulCanTimeOutCnt = CAN_RX_TIMEOUT_CNT;
-    while (uCanReceiveInfo(&canMsg) != CAN_OK)
+    if (bEventLost != 0)
     {
-        if (ulCanTimeOutCnt == 0)
+        vPanelLog("[Sensor] Event lost:", bEventLost);
+        bEventLost = 0;
+        bSensorPressed = digitalRead(PIN_PANEL_SENSOR) != HIGH;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * 踏まれた
+ *
+ * @param	ulPressUs: 踏んだ時刻[us](割り込みで取った時刻)
+ *
+ * @return  ##
+ *
+ * @note    返信を先に送り、LEDとデバッグ出力は後にする
+ *
+ ******************************************************************************/
+void vPanelPress(uint32_t ulPressUs)
+{
+    uint32_t ulTxUs;
+
+    switch (ePanelState)
+    {
+    case PANEL_ST_ARMED:
+        vPanelStampPress(&canMsg, ulPressUs);
+        bCanSendReliable(canMsg, MASTER_CAN_ID);
+        break;
+    case PANEL_ST_START_SW:
+        canMsg.bBtnFlag = 1;
+        bCanSendReliable(canMsg, MASTER_CAN_ID);
+        break;
+    case PANEL_ST_IDLE:
+        // 踏まれている間は白(低輝度)
+        vSerialLedLightUp(sColorTbl[WHITE_L].ulColor);
+        return;
+    default:
+        return; // デモ点灯は返さない
+    }
+
+    ulTxUs = micros() - ulPressUs;
+    if (ulTxUs > ulPressTxMaxUs)
+        ulPressTxMaxUs = ulTxUs;
+    vPanelEnter(PANEL_ST_IDLE);
+    vPanelLog("[Notice] Push Panel Sensor, tx(us):", ulTxUs);
+}
+
+/*****************************************************************************/
+/**
+ * 状態を変える
+ *
+ * @param	eState: 次の状態
+ *
+ * @return  ##
+ *
+ * @note    IDLE: LEDを消す(踏まれていれば白)
+ *          ARMED / START_SW / DEMO: canMsgの指示で点灯を始める(最初のフレームはすぐに出す)。
+ *          ANIM: tAniminfoで描き始める(vPanelAnimStartで設定済み)。
+ *          PIXEL: xPixelInfoを出す(点灯時間とフェードはvPanelPixelStartでtLedinfoへ設定済み)。
+ *          ARMEDで既に踏まれているときはすぐに踏まれたことにする
+ *
+ ******************************************************************************/
+void vPanelEnter(enum PANEL_STATE eState)
+{
+    if (eState == PANEL_ST_IDLE)
+    {
+        if (ePanelState != PANEL_ST_IDLE)
         {
-            Serial.println("[Error] CAN Receive Timeout!");
-            break;
+            vPanelLog("[LED] calc max(cycle):", usLedCalcCycMax);
+            vPanelLog("[LED] show max(cycle):", usLedShowCycMax);
         }
-        ulCanTimeOutCnt--;
+        ePanelState = eState;
+        vSerialLedLightUp(bSensorPressed ? sColorTbl[WHITE_L].ulColor
+                                         : sColorTbl[NOLIGHT].ulColor);
+        return;
     }
 
-    /* LED情報セット */
+    ePanelState = eState;
+    if (eState == PANEL_ST_ANIM || eState == PANEL_ST_PIXEL)
+    {
+        if (eState == PANEL_ST_ANIM)
+            vPanelAnimRender();
+        else
+            vPanelPixelRender();
+        vPanelLog("[State] ", eState);
+        return;
+    }
     vConvCanMsg2LedInfo(&canMsg, &tLedinfo);
+    bLedOnStamped = false;
+    vPanelLedRender();
+    vPanelLog("[State] ", eState);
+    if (eState == PANEL_ST_ARMED && bSensorPressed)
+        vPanelPress(micros());
+}
 
-    /* パネル踏み待機 */
-    if (canMsg.bBtnFlag == 1)
-    { // BtnFlgが立っているときのみ
-        Serial.println("Wait Push or Timeout");
-        MsTimer2::start();
-        while (1)
-        {
-            if (digitalRead(PIN_PANEL_SENSOR) != HIGH)
-            {
-                MsTimer2::stop(); // LEDへの送信／時間減算／LEDフェードを停止
-                bPanelPushFlg = true;
-                Serial.println("[Notice] Push Panel Sensor!");
-                break;
-            }
-            if (tLedinfo.lOffTimeMs <= 0)
-            {
-                bTimeoutFlg = true;
-                Serial.println("[Notice] Timeout!");
-                delay(10);
-                break;
-            }
-        }
-        // LEDを消灯
-        vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
+/*****************************************************************************/
+/**
+ * 点灯時間切れ
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    START_SWは点灯し直して踏まれるのを待ち続ける。
+ *          ANIMは続ける時間が過ぎたら消す(0なら次の指示まで)
+ *
+ ******************************************************************************/
+void vPanelStateService()
+{
+    if (ePanelState == PANEL_ST_ANIM)
+    {
+        if (bPanelAnimExpired())
+            vPanelEnter(PANEL_ST_IDLE);
+        return;
+    }
+    if (ePanelState == PANEL_ST_IDLE || !bPanelLedExpired())
+        return;
 
-        /* パネルが踏まれたらCAN Msgを発⾏ */
-        if (bPanelPushFlg)
-        {
-            Serial.println("Send CAN Msg");
-            bCanSendWrapper(canMsg, MASTER_CAN_ID);
-        }
+    if (ePanelState == PANEL_ST_START_SW)
+    {
+        /* LED情報再セット */
+        vConvCanMsg2LedInfo(&canMsg, &tLedinfo);
+        return;
     }
-    else if (canMsg.bStartSwFlag == 1)
+    vPanelLog("[Notice] Timeout!");
+    vPanelEnter(PANEL_ST_IDLE);
+}
+
+/* 点灯時間が過ぎたか */
+bool bPanelLedExpired()
+{
+    return millis() - tLedinfo.ulStartMs >= tLedinfo.usLightMs;
+}
+
+/*****************************************************************************/
+/**
+ * 受信したフレームを全部処理する
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    フレームはCANの割り込みが受信の列へ積む。
+ *          列が一杯で読み残したとき、MCP2515のINTはLのまま(次のエッジが来ない)なので、
+ *          ピンがLならCANの割り込みを止めてここで読む
+ *
+ ******************************************************************************/
+void vPanelCanService()
+{
+    canCommMsg_t canRx = {};
+    bool bReceived = bCanRxTail != bCanRxHead;
+
+    if (digitalRead(PIN_CAN_INT) == LOW)
     {
-        Serial.println("[StartSw]Wait Push");
-        MsTimer2::start();
-        /*
-         * Start Sw
-         * 受け取ったら点滅ループに入る
-         * 点灯時間(lOffTimeMs)が0になったらタイマを更新
-         * 押されたらタイマストップ、CAN Msgを送り返す（BtnFlagをつける）
-         */
-        while (1)
-        {
-            if (digitalRead(PIN_PANEL_SENSOR) != HIGH)
-            {
-                MsTimer2::stop(); // LEDへの送信／時間減算／LEDフェードを停止
-                bPanelPushFlg = true;
-                canMsg.bBtnFlag = 1;
-                Serial.println("[Notice] Push Panel Sensor!");
-                break;
-            }
-            if (tLedinfo.lOffTimeMs <= 0)
-            {
-                /* LED情報再セット */
-                vConvCanMsg2LedInfo(&canMsg, &tLedinfo);
-                MsTimer2::start();
-            }
-        }
-        // LEDを消灯
-        vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
+        EIMSK &= ~_BV(INT1);
+        vCanRxDrain(micros());
+        EIMSK |= _BV(INT1);
+        bReceived = true;
+    }
 
-        /* パネルが踏まれたらCAN Msgを発⾏ */
-        if (bPanelPushFlg)
-        {
-            Serial.println("Send CAN Msg");
-            bCanSendWrapper(canMsg, MASTER_CAN_ID);
-        }
+    while (bCanRxTail != bCanRxHead)
+    {
+        if (uCanReceiveInfo(&canRx) == CAN_OK)
+            vPanelCanDispatch(&canRx);
+        // センサのイベントを先に(受信が続いても返信を遅らせない)
+        if (bEventTail != bEventHead)
+            vPanelEventService();
+    }
+
+    // オーバーフローはフレームが届いたときにだけ起きる
+    if (bReceived)
+        vCanRxCheckOverflow();
+}
+
+/*****************************************************************************/
+/**
+ * 受信したフレーム1つの処理
+ *
+ * @param	canRx: 受信したフレーム
+ *
+ * @return  ##
+ *
+ * @note    点灯の指示は実行中の指示を置き換える(最後の指示に従う)。
+ *          消灯中に踏まれたままのときは最後の点灯の指示を取っておき、離されたら実行する
+ *          (踏んでいる人の足元で点いてすぐ判定されないように)
+ *
+ ******************************************************************************/
+void vPanelCanDispatch(canCommMsg_t *canRx)
+{
+    /* 問い合わせ: PanelID毎に枠をずらして返す(返信がぶつからないように) */
+    if (canRx->bCmd == TBCAN_CMD_DISCOVER)
+    {
+        bDiscoverPending = true;
+        ulDiscoverDueMs = millis() + (ulPanelId - 1) * TBCAN_DISCOVER_SLOT_MS;
+        return;
+    }
+
+    /* ファームウェア配信: ブートローダが無いので書き換えられないと返す(枠は問い合わせと同じ) */
+    if (canRx->bCmd == TBCAN_CMD_FW_BEGIN)
+    {
+        bFwReplyPending = true;
+        bFwReplySession = canRx->bSeq;
+        ulFwReplyDueMs = millis() + (ulPanelId - 1) * TBFW_REPLY_SLOT_MS;
+        return;
+    }
+
+    /* 時刻同期: SYNCの受信時刻と、続くFOLLOW_UPのMasterの時刻を組にする */
+    if (canRx->bCmd == TBCAN_CMD_SYNC || canRx->bCmd == TBCAN_CMD_FOLLOW_UP)
+    {
+        vPanelTimeSync(canRx);
+        return;
+    }
+
+    /* アニメーション: 踏まれていても待たずに始める(判定しないので) */
+    if (canRx->bCmd == TBCAN_CMD_ANIM)
+    {
+        vPanelAnimStart(canRx);
+        return;
+    }
+
+    /* LED毎の色: フレームが揃ったときだけ(bSeq)、アニメーションと同じく待たずに出す */
+    if (canRx->bCmd == TBCAN_CMD_PIXEL)
+    {
+        if (canRx->bSeq)
+            vPanelPixelStart();
+        return;
     }
-    else if (canMsg.bBtnFlag == 0 && canMsg.bStartSwFlag == 0) // デモ点灯用
+
+    /* 返信のACK(遅れた／重複は捨てる) */
+    if (canRx->bCmd == TBCAN_CMD_ACK)
+    {
+        vCanRelAck(canRx->bSeq);
+        return;
+    }
+    if (canRx->bCmd != 0)
+        return;
+
+    /* 配送確認: ACKを返す。同じ番号(ACKが失われた再送)はACKだけ返して捨てる */
+    if (canRx->bAckReq)
     {
-        MsTimer2::start();
-        while (1)
+        bPanelSendAck(canRx->bSeq);
+        if (bRelRxValid && canRx->bSeq == bRelRxSeq)
         {
-            // Serial.println(tLedinfo.lOffTimeMs);
-            delay(10);
-            if (tLedinfo.lOffTimeMs <= 0)
-            {
-                bTimeoutFlg = true;
-                Serial.println("[Notice] Demo Timecount is 0");
-                delay(10);
-                break;
-            }
+            vPanelLog("[Rel] Duplicate frame");
+            return;
         }
-        // LEDを消灯
-        vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
+        bRelRxValid = true;
+        bRelRxSeq = canRx->bSeq;
     }
+
+    if (ePanelState == PANEL_ST_IDLE && bSensorPressed)
+    {
+        if (bCanMsgDeferred)
+            vPanelLog("[Notice] Pressed, deferred frame replaced");
+        canMsgDeferred = *canRx;
+        bCanMsgDeferred = true;
+        ulDeferredMs = millis();
+        return;
+    }
+    bCanMsgDeferred = false;
+    vPanelApply(canRx);
+}
+
+/* 実行中の指示を置き換える */
+void vPanelApply(canCommMsg_t *canRx)
+{
+    canMsg = *canRx;
+    if (canMsg.bBtnFlag == 1)
+        vPanelEnter(PANEL_ST_ARMED); // BtnFlgが立っているときのみ判定
+    else if (canMsg.bStartSwFlag == 1)
+        vPanelEnter(PANEL_ST_START_SW);
     else
+        vPanelEnter(PANEL_ST_DEMO); // デモ点灯用
+}
+
+/* 取っておいた指示を実行する(待った分だけ点灯時間を減らし、過ぎていれば捨てる) */
+void vPanelApplyDeferred()
+{
+    uint32_t ulWaitMs = millis() - ulDeferredMs;
+
+    bCanMsgDeferred = false;
+    if (ulWaitMs >= canMsgDeferred.usLightTimeMs)
+    {
+        vPanelLog("[Notice] Deferred frame expired");
+        return;
+    }
+    canMsgDeferred.usLightTimeMs -= ulWaitMs;
+    vPanelApply(&canMsgDeferred);
+}
+
+/* 枠をずらした応答(時刻になったら送る) */
+void vPanelSlotService()
+{
+    if (bDiscoverPending && (int32_t)(millis() - ulDiscoverDueMs) >= 0)
+    {
+        bDiscoverPending = false;
+        bPanelSendStatus(TBCAN_STATUS_DISCOVER);
+    }
+    if (bFwReplyPending && (int32_t)(millis() - ulFwReplyDueMs) >= 0)
     {
-        /* NOP */
+        bFwReplyPending = false;
+        bPanelSendFwReply(TBFW_ST_NO_BOOT, bFwReplySession);
     }
 }
 
+/*****************************************************************************/
+/**
+ * デバッグ出力
+ *
+ * @param	pcMsg: 文字列
+ * @param   lValue: 後ろに付ける数値
+ *
+ * @return  ##
+ *
+ * @note    送信バッファに入り切らないときは出さない(待つとloop()が止まる)
+ *
+ ******************************************************************************/
+void vPanelLog(const char *pcMsg)
+{
+#if DEBUG_EN
+    if (Serial.availableForWrite() >= (int)strlen(pcMsg) + 2)
+        Serial.println(pcMsg);
+#endif
+}
+
+void vPanelLog(const char *pcMsg, int32_t lValue)
+{
+#if DEBUG_EN
+    if (Serial.availableForWrite() >= (int)strlen(pcMsg) + PANEL_LOG_VALUE_LEN)
+    {
+        Serial.print(pcMsg);
+        Serial.println(lValue);
+    }
+#endif
+}
+
 /*****************************************************************************/
 /**
  * GPIOの初期化
@@ -272,11 +653,14 @@ void vInitGpio()
 /**
  * Can Driver 初期化
  *
- * @param	##
+ * @param	ulPanelId: 自パネルのID
  *
- * @return   ##
+ * @return   true: 成功
  *
- * @note		##
+ * @note		受信するID
+ *          RXB0(RXM0, RXF0/1): グループ宛て(bit10と自分の行・列のビットが0)
+ *          RXB1(RXM1, RXF2-5): 自パネルID宛て
+ *          使わないフィルタも同じ値にする(0のままだと他のIDを拾う)
  *
  ******************************************************************************/
 bool bInitCanDriver(uint32_t ulPanelId)
@@ -285,9 +669,25 @@ bool bInitCanDriver(uint32_t ulPanelId)
         CAN.begin(CAN_500KBPS, MCP_8MHz)) // init can bus : baudrate = 500k
     {
         Serial.println("CAN BUS Shield init ok!");
-        CAN.init_Mask(0, 0, 0x3FF);     // todo
-        CAN.init_Mask(1, 0, 0x3FF);     // todo
-        CAN.init_Filt(0, 0, ulPanelId); // todo
+        // 盤面外のID(DIPの設定ミス)は全体宛て(0x400)だけ受ける
+        uint32_t ulGroupMask = CAN_ID_STD_MASK;
+        if (ulPanelId >= 1 && ulPanelId <= PANEL_GRID_SIZE * PANEL_GRID_SIZE)
+        {
+            uint32_t ulRow = (ulPanelId - 1) / PANEL_GRID_SIZE;
+            uint32_t ulCol = (ulPanelId - 1) % PANEL_GRID_SIZE;
+            ulGroupMask = CAN_ID_GROUP_FLAG |
+                          (1UL << (CAN_ID_GROUP_ROW_SHIFT + ulRow)) | (1UL << ulCol);
+        }
+        CAN.init_Mask(0, 0, ulGroupMask);
+        CAN.init_Filt(0, 0, CAN_ID_GROUP_FLAG);
+        CAN.init_Filt(1, 0, CAN_ID_GROUP_FLAG);
+        CAN.init_Mask(1, 0, CAN_ID_STD_MASK);
+        for (int i = 2; i < 6; i++)
+        {
+            CAN.init_Filt(i, 0, ulPanelId);
+        }
+        // loop()のSPIの送受信中はCANの割り込みを止める(割り込みでもSPIを使う)
+        SPI.usingInterrupt(CAN_INTR_NO);
         attachInterrupt(CAN_INTR_NO, vCanIntrHandler, FALLING);
     }
     else
@@ -336,11 +736,134 @@ uint32_t ulGetPanelCanID()
  *
  * @return  ##
  *
- * @note    ##
+ * @note    MCP2515の受信バッファ(RXB0 / RXB1)を両方読んで受信の列へ積む。
+ *          loop()のSPIの送受信中はSPI.usingInterruptでこの割り込みが止まる
  *
  ******************************************************************************/
-void vCanIntrHandler() { bCanIntrFlg = true; }
+void vCanIntrHandler()
+{
+    vCanRxDrain(micros());
+}
 
+/*****************************************************************************/
+/**
+ * MCP2515の受信バッファを受信の列へ読む
+ *
+ * @param	ulRxUs: 受信時刻[us](時刻同期)
+ *
+ * @return  ##
+ *
+ * @note    割り込み、またはCANの割り込みを止めたloop()から呼ぶ(Producerは常に1つ)。
+ *          列が一杯のときは読まずにMCP2515に残す(INTがLのままなのでloop()が読む)
+ *
+ ******************************************************************************/
+void vCanRxDrain(uint32_t ulRxUs)
+{
+    byte bLen;
+    byte buf[TBCAN_DLC];
+    byte bNext;
+    volatile canRxItem_t *pxItem;
+
+    while (CAN_MSGAVAIL == CAN.checkReceive())
+    {
+        bNext = (bCanRxHead + 1) & (CAN_RX_RING_NUM - 1);
+        if (bNext == bCanRxTail)
+        {
+            bCanRxFull++;
+            return;
+        }
+        bLen = TBCAN_DLC;
+        CAN.readMsgBuf(&bLen, buf);
+        if (bLen > TBCAN_DLC)
+            bLen = TBCAN_DLC;
+
+        pxItem = &xCanRxBuf[bCanRxHead];
+        pxItem->ulCanId = CAN.getCanId();
+        pxItem->ulRxUs = ulRxUs;
+        pxItem->bLen = bLen;
+        for (byte i = 0; i < bLen; i++)
+            pxItem->bData[i] = buf[i];
+        bCanRxHead = bNext;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * MCP2515の受信オーバーフローを数える
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    EFLGのRX0OVR / RX1OVRを読んで落とす(ライブラリからは読めないのでSPIで直接)。
+ *          オーバーフローは受信バッファが両方埋まっているときに届いたフレーム
+ *
+ ******************************************************************************/
+void vCanRxCheckOverflow()
+{
+    byte bEflg;
+
+    SPI.beginTransaction(SPISettings(MCP_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+    digitalWrite(SPI_CS_PIN, LOW);
+    SPI.transfer(MCP_SPI_READ);
+    SPI.transfer(MCP_REG_EFLG);
+    bEflg = SPI.transfer(0x00);
+    digitalWrite(SPI_CS_PIN, HIGH);
+    SPI.endTransaction();
+    if ((bEflg & MCP_EFLG_RXOVR) == 0)
+        return;
+
+    if (bEflg & MCP_EFLG_RX0OVR)
+        bCanRxOvr++;
+    if (bEflg & MCP_EFLG_RX1OVR)
+        bCanRxOvr++;
+
+    SPI.beginTransaction(SPISettings(MCP_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+    digitalWrite(SPI_CS_PIN, LOW);
+    SPI.transfer(MCP_SPI_BIT_MODIFY);
+    SPI.transfer(MCP_REG_EFLG);
+    SPI.transfer(MCP_EFLG_RXOVR);
+    SPI.transfer(0x00);
+    digitalWrite(SPI_CS_PIN, HIGH);
+    SPI.endTransaction();
+    vPanelLog("[CAN] RX overflow:", bCanRxOvr);
+}
+
+/*****************************************************************************/
+/**
+ * センサの割り込み関数(両エッジ)
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    レベルと時刻をイベント列へ積む。同じレベルが続くとき(チャタリングで
+ *          読む前に戻った)は積まない。列が一杯のときは捨てて数える
+ *
+ ******************************************************************************/
+void vSensorIntrHandler()
+{
+    uint32_t ulUs = micros();
+    bool bPressed = digitalRead(PIN_PANEL_SENSOR) != HIGH;
+    byte bNext;
+
+    if (bPressed == bEventLevel)
+        return;
+    bEventLevel = bPressed;
+
+    bNext = (bEventHead + 1) & (PANEL_EVENT_NUM - 1);
+    if (bNext == bEventTail)
+    {
+        if (bEventLost < 0xFF)
+            bEventLost++;
+        return;
+    }
+    xEventBuf[bEventHead].bType = bPressed ? PANEL_EV_PRESS : PANEL_EV_RELEASE;
+    xEventBuf[bEventHead].ulUs = ulUs;
+    bEventHead = bNext;
+}
+
+#if DEBUG_EN > 1
 void vPrintCanMsg(canCommMsg_t canMsg)
 {
     Serial.print("CanID: ");
@@ -358,8 +881,15 @@ void vPrintCanMsg(canCommMsg_t canMsg)
     Serial.print("-B");
     Serial.print(canMsg.bColorInfoB);
     Serial.print(" LightTime: ");
-    Serial.println(canMsg.bLightTime);
+    Serial.print(canMsg.usLightTimeMs);
+    Serial.print(" Fade: ");
+    Serial.print(canMsg.bFade);
+    Serial.print(" Proto: v");
+    Serial.print(canMsg.bProto);
+    Serial.print(" Seq: ");
+    Serial.println(canMsg.bSeq);
 }
+#endif
 /*****************************************************************************/
 /**
  * CANを受信する。
@@ -368,20 +898,29 @@ void vPrintCanMsg(canCommMsg_t canMsg)
  *
  * @return  ##
  *
- * @note    ##
+ * @note    受信の列から1つ取り出す(v1 / v2どちらも受ける, tb_canproto.h)
+ *          列が空、または読めないフレーム(未対応のバージョン)はCAN_FAIL
  *
  ******************************************************************************/
 byte uCanReceiveInfo(canCommMsg_t *canMsg)
 {
-    byte len = 8;
-    byte buf[8];
-    byte bStatus;
+    byte len;
+    byte buf[TBCAN_DLC] = {};
+    byte bStatus = CAN_OK;
+    tbCanFrame_t xFrame;
+    volatile canRxItem_t *pxItem;
 
-    if (CAN_MSGAVAIL == CAN.checkReceive())
-    { // CAN受信チェック
-        // ReadData
-        bStatus = CAN.readMsgBuf(&len, buf);
+    if (bCanRxTail != bCanRxHead)
+    { // 受信の列から取り出す
+        pxItem = &xCanRxBuf[bCanRxTail];
+        len = pxItem->bLen;
+        for (byte i = 0; i < len; i++)
+            buf[i] = pxItem->bData[i];
+        canMsg->ulCanId = pxItem->ulCanId;
+        canMsg->ulRxUs = pxItem->ulRxUs;
+        bCanRxTail = (bCanRxTail + 1) & (CAN_RX_RING_NUM - 1);
 
+#if DEBUG_EN > 1
         Serial.print("[CAN rcv] len:");
         Serial.println(len);
         for (int i = 0; i < len; i++)
@@ -389,17 +928,49 @@ byte uCanReceiveInfo(canCommMsg_t *canMsg)
             Serial.print(buf[i]);
             Serial.print(" ");
         }
+#endif
+
+        // 問い合わせ(死活監視)
+        canMsg->bCmd = bTbCanDecodeCtrl(buf, len);
+        if (canMsg->bCmd != 0)
+        {
+            canMsg->bAckReq = 0;
+            canMsg->bRelReply = 0;
+            if (canMsg->bCmd == TBCAN_CMD_SYNC || canMsg->bCmd == TBCAN_CMD_FOLLOW_UP)
+                vTbCanDecodeSync(buf, &canMsg->bSeq, &canMsg->ulMasterUs);
+            else if (canMsg->bCmd == TBCAN_CMD_ACK)
+                vTbCanDecodeAck(buf, &canMsg->bPanelId, &canMsg->bSeq);
+            else if (canMsg->bCmd == TBCAN_CMD_FW_BEGIN)
+                canMsg->bSeq = buf[6]; // セッション番号
+            else if (canMsg->bCmd == TBCAN_CMD_ANIM)
+                vTbCanDecodeAnim(buf, &canMsg->xAnim);
+            else if (canMsg->bCmd == TBCAN_CMD_PIXEL) // 揃ったら1(中身はxPixelInfo)
+                canMsg->bSeq = bTbCanDecodePixel(&xPixelRx, buf, &xPixelInfo);
+            return bStatus;
+        }
 
         // 情報格納
-        canMsg->ulCanId = CAN.getCanId();
-        canMsg->bPanelId = buf[0];
-        canMsg->bBtnFlag = buf[1];
-        canMsg->bColorInfoR = buf[2];
-        canMsg->bColorInfoG = buf[3];
-        canMsg->bColorInfoB = buf[4];
-        canMsg->bLightTime = buf[5];
-        canMsg->bStartSwFlag = buf[6];
+        if (bTbCanDecode(buf, len, &xFrame) == 0)
+        {
+            vPanelLog("[Error] Unknown CAN frame");
+            return CAN_FAIL;
+        }
+        canMsg->bPanelId = xFrame.bPanelId;
+        canMsg->bBtnFlag = xFrame.bBtn;
+        canMsg->bColorInfoR = xFrame.bR;
+        canMsg->bColorInfoG = xFrame.bG;
+        canMsg->bColorInfoB = xFrame.bB;
+        canMsg->usLightTimeMs = xFrame.usLightMs;
+        canMsg->bStartSwFlag = xFrame.bStartSw;
+        canMsg->bFade = xFrame.bFade;
+        canMsg->bSeq = xFrame.bSeq;
+        canMsg->bProto = xFrame.bVer;
+        canMsg->bTimed = 0;
+        canMsg->bAckReq = xFrame.bAckReq;
+        canMsg->bRelReply = xFrame.bRelReply;
+#if DEBUG_EN > 1
         vPrintCanMsg(*canMsg);
+#endif
     }
     else
     {
@@ -411,67 +982,286 @@ byte uCanReceiveInfo(canCommMsg_t *canMsg)
 
 /*****************************************************************************/
 /**
- * CANの受信バッファをクリアする
+ * CAN メッセージ送信ラッパー
+ * canCommMsg_tを入力し、ESP32（ID:0x00）へ経由でCAN送信する
  *
- * @param	##
+ * @param	canMsg：送信するCANの情報
+ * @param   canID：Panel固有のCAN ID
  *
- * @return  ##
+ * @return  CAN_OK / CAN err各種
  *
- * @note    ##
+ * @note    受信したフレームと同じバージョンで返す。
+ *          対応バージョン(TBCAN_VER_MAX)を付けて、Masterにv2を使えることを知らせる
  *
  ******************************************************************************/
-void vClearCanRxBuffer()
+byte bCanSendWrapper(canCommMsg_t canMsg, uint32_t canId)
 {
-    byte len = 8;
-    byte buf[8];
+    byte bStatus;
+    byte buf[TBCAN_DLC] = {};
+    byte bLen;
+    tbCanFrame_t xFrame = {};
 
-    while (CAN_MSGAVAIL == CAN.checkReceive())
-    { // CAN受信チェック
-        // ReadData
-        CAN.readMsgBuf(&len, buf);
+    xFrame.bPanelId = ulPanelId;
+    xFrame.bBtn = canMsg.bBtnFlag;
+    xFrame.bStartSw = canMsg.bStartSwFlag;
+    xFrame.bFade = canMsg.bFade;
+    xFrame.bSeq = canMsg.bSeq;
+    xFrame.bCap = TBCAN_VER_MAX;
+    xFrame.bR = canMsg.bColorInfoR;
+    xFrame.bG = canMsg.bColorInfoG;
+    xFrame.bB = canMsg.bColorInfoB;
+    xFrame.bTimed = canMsg.bTimed;
+    xFrame.usPressTick = canMsg.usPressTick;
+    xFrame.usReactTick = canMsg.usReactTick;
+    xFrame.bAckReq = canMsg.bAckReq;
+    bLen = bTbCanEncode(&xFrame, canMsg.bProto, buf);
 
-        Serial.print("[CAN Clr] len:");
-        Serial.println(len);
-    }
+    // CAN経由でメッセージを送る
+    bStatus = CAN.sendMsgBuf(canId, 0, bLen, buf);
+#if DEBUG_EN > 1
+    vPanelLog("Send CAN Message | buf[1]:", buf[1]);
+#endif
+
+    return bStatus;
 }
 
 /*****************************************************************************/
 /**
- * CAN メッセージ送信ラッパー
- * canCommMsg_tを入力し、ESP32（ID:0x00）へ経由でCAN送信する
+ * 返信を送る(配送確認付き)
+ * MasterがTBCAN_FLAG_REL_REPLYを付けてきたときはACK要求を付けて送り、
+ * ACKが来るまでTBCAN_ACK_TIMEOUT_MS(再送毎に倍)待って同じ番号で送り直す。
  *
  * @param	canMsg：送信するCANの情報
- * @param   canID：Panel固有のCAN ID
+ * @param   canID：送信先のCAN ID
+ *
+ * @return  CAN_OK / CAN err各種
+ *
+ * @note    待たずに戻る(ACKの受信はvCanRelAck、送り直しはvCanRelServiceがloop()で行う)。
+ *          ACK待ちは1つだけで、前の返信がACK待ちのときは新しい返信に置き換える
+ *
+ ******************************************************************************/
+byte bCanSendReliable(canCommMsg_t canMsg, uint32_t canId)
+{
+    byte bStatus;
+
+    canMsg.bAckReq = canMsg.bProto >= TBCAN_VER_2 && canMsg.bRelReply;
+    bStatus = bCanSendWrapper(canMsg, canId);
+    if (!canMsg.bAckReq)
+        return bStatus;
+
+    if (bRelPending)
+        vPanelLog("[Rel] Replaced");
+    canMsgRel = canMsg;
+    ulRelCanId = canId;
+    bRelTry = 0;
+    ulRelWaitMs = TBCAN_ACK_TIMEOUT_MS;
+    ulRelStartMs = millis();
+    bRelPending = true;
+    return bStatus;
+}
+
+/* ACK待ちの送り直し */
+void vCanRelService()
+{
+    if (!bRelPending || millis() - ulRelStartMs < ulRelWaitMs)
+        return;
+
+    if (bRelTry >= TBCAN_RETRY_MAX)
+    {
+        bRelPending = false;
+        vPanelLog("[Rel] No ACK");
+        return;
+    }
+    bRelTry++;
+    vPanelLog("[Rel] Retransmit");
+    bCanSendWrapper(canMsgRel, ulRelCanId);
+    ulRelWaitMs <<= 1;
+    ulRelStartMs = millis();
+}
+
+/* ACKを受けた(番号の違うACKは遅れて届いたものなので捨てる) */
+void vCanRelAck(byte bSeq)
+{
+    if (!bRelPending || bSeq != canMsgRel.bSeq)
+        return;
+    bRelPending = false;
+#if DEBUG_EN > 1
+    vPanelLog("[Rel] ACK");
+#endif
+}
+
+/*****************************************************************************/
+/**
+ * ACKを返す
+ *
+ * @param	bSeq: 受けたフレームの番号
+ *
+ * @return  CAN_OK / CAN err各種
+ *
+ * @note    Masterは返信を待たずに送り直すので、受けたらすぐに返す
+ *
+ ******************************************************************************/
+byte bPanelSendAck(byte bSeq)
+{
+    byte bStatus;
+    byte buf[TBCAN_DLC] = {};
+    byte bLen;
+
+    bLen = bTbCanEncodeAck(ulPanelId, bSeq, buf);
+    bStatus = CAN.sendMsgBuf(MASTER_CAN_ID, 0, bLen, buf);
+#if DEBUG_EN > 1
+    vPanelLog("Send ACK | seq:", bSeq);
+#endif
+
+    return bStatus;
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視のフレームを送る
+ * CAN ID 0x100 + PanelIDへ、PanelID・センサ状態・ファームウェアのバージョンを送る
+ *
+ * @param	bReason: TBCAN_STATUS_*
  *
  * @return  CAN_OK / CAN err各種
  *
  * @note    ##
  *
  ******************************************************************************/
-byte bCanSendWrapper(canCommMsg_t canMsg, uint32_t canId)
+byte bPanelSendStatus(byte bReason)
 {
     byte bStatus;
-    byte buf[8] = {};
+    byte buf[TBCAN_DLC] = {};
+    byte bLen;
+    tbCanStatus_t xStatus = {};
 
-    // bufの下位バイトから情報を埋めていく
-    buf[0] = ulPanelId;
-    buf[1] = canMsg.bBtnFlag;
-    buf[2] = canMsg.bColorInfoR;
-    buf[3] = canMsg.bColorInfoG;
-    buf[4] = canMsg.bColorInfoB;
-    // buf[5] = canMsg.bLightTime;
-    buf[6] = canMsg.bStartSwFlag;
+    xStatus.bPanelId = ulPanelId;
+    xStatus.bSensor = bSensorPressed ? TBCAN_SENSOR_PRESSED : 0;
+    if (bSensorPressed && millis() - ulPressedSinceMs >= TBCAN_SENSOR_STUCK_MS)
+        xStatus.bSensor |= TBCAN_SENSOR_STUCK;
+    bRxFullSent = bCanRxFull;
+    bRxOvrSent = bCanRxOvr;
+    xStatus.bSensor |= (byte)((bRxFullSent & TBCAN_SENSOR_RXCNT_MASK) << TBCAN_SENSOR_RXFULL_SHIFT);
+    xStatus.bSensor |= (byte)((bRxOvrSent & TBCAN_SENSOR_RXCNT_MASK) << TBCAN_SENSOR_RXOVR_SHIFT);
+    xStatus.bCount = ++bStatusCount;
+    xStatus.bFwMajor = PANEL_FW_VER_MAJOR;
+    xStatus.bFwMinor = PANEL_FW_VER_MINOR;
+    xStatus.bReason = bReason;
+    xStatus.bFeat = TBCAN_FEAT_ACK | TBCAN_FEAT_RXCNT | TBCAN_FEAT_ANIM | TBCAN_FEAT_PIXEL;
+    xStatus.bCap = TBCAN_VER_MAX;
+    bLen = bTbCanEncodeStatus(&xStatus, buf);
 
-    // CAN経由でメッセージを送る
-    bStatus = CAN.sendMsgBuf(canId, 0, 8, buf);
-    Serial.print("Send CAN Message | ID:");
-    Serial.print(canId);
-    Serial.print(" buf[1]:");
-    Serial.println(buf[1]);
+    bStatus = CAN.sendMsgBuf(STATUS_CAN_ID(ulPanelId), 0, bLen, buf);
+    ulLastStatusMs = millis();
+    vPanelLog("Send Status | reason:", bReason);
 
     return bStatus;
 }
 
+/*****************************************************************************/
+/**
+ * ファームウェア配信の応答を送る
+ * CAN ID 0x180 + PanelIDへ、状態(TBFW_ST_*)とセッション番号を送る
+ *
+ * @param	bFwStatus: TBFW_ST_*
+ * @param   bSession: BEGINのセッション番号
+ *
+ * @return  CAN_OK / CAN err各種
+ *
+ * @note    書き換えはブートローダが行う(アプリケーションはNO_BOOTだけ返す)
+ *
+ ******************************************************************************/
+byte bPanelSendFwReply(byte bFwStatus, byte bSession)
+{
+    byte bStatus;
+    byte buf[TBCAN_DLC] = {};
+    byte bLen;
+
+    bLen = bTbFwEncodeReply(ulPanelId, bFwStatus, bSession, TBFW_REPLY_LAST, 0, buf);
+    bStatus = CAN.sendMsgBuf(TBCAN_ID_FW_REPLY_BASE + ulPanelId, 0, bLen, buf);
+    vPanelLog("Send FwReply | status:", bFwStatus);
+
+    return bStatus;
+}
+
+/*****************************************************************************/
+/**
+ * 死活監視(周期送信とセンサの踏まれたままの判定)
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    センサの状態はイベント列から取ったもの(vPanelEventService)
+ *
+ ******************************************************************************/
+void vPanelHeartbeat()
+{
+    if (millis() - ulLastStatusMs >= TBCAN_HEARTBEAT_MS)
+        bPanelSendStatus(TBCAN_STATUS_PERIODIC);
+    // 送るのは3bitなので、一周する前に送る
+    else if ((byte)(bCanRxFull - bRxFullSent) >= TBCAN_RXCNT_REPORT ||
+             (byte)(bCanRxOvr - bRxOvrSent) >= TBCAN_RXCNT_REPORT)
+        bPanelSendStatus(TBCAN_STATUS_RXLOST);
+}
+
+/*****************************************************************************/
+/**
+ * 時刻同期(SYNC / FOLLOW_UP)
+ *
+ * @param	canMsg: 受信したSYNC / FOLLOW_UP
+ *
+ * @return  ##
+ *
+ * @note    SYNCの受信割り込みの時刻と、同じ番号のFOLLOW_UPのMasterの時刻を組にする。
+ *          番号の合わないFOLLOW_UP(SYNCを取りこぼした)は捨てる
+ *
+ ******************************************************************************/
+void vPanelTimeSync(canCommMsg_t *canMsg)
+{
+    if (canMsg->bCmd == TBCAN_CMD_SYNC)
+    {
+        bSyncSeq = canMsg->bSeq;
+        ulSyncRxUs = canMsg->ulRxUs;
+        bSyncPending = true;
+        return;
+    }
+    if (!bSyncPending || canMsg->bSeq != bSyncSeq)
+        return;
+    bSyncPending = false;
+    bTbSyncUpdate(&xTimeSync, ulSyncRxUs, canMsg->ulMasterUs);
+    vPanelLog("[Sync] err(us):", xTimeSync.lLastErrUs);
+}
+
+/*****************************************************************************/
+/**
+ * 返信に踏んだ時刻と反応時間を付ける
+ *
+ * @param	canMsg: 返信するCAN Msg
+ * @param   ulPressUs: 踏んだ時刻[us](自分の時計)
+ *
+ * @return  ##
+ *
+ * @note    v2で同期していて、LEDを点けた後に踏んだときだけ付ける。
+ *          点灯は最初のフレームをshow()した時刻
+ *
+ ******************************************************************************/
+void vPanelStampPress(canCommMsg_t *canMsg, uint32_t ulPressUs)
+{
+    uint32_t ulReactTick;
+
+    canMsg->bTimed = 0;
+    if (canMsg->bProto < TBCAN_VER_2 || !bLedOnStamped ||
+        !bTbSyncLocked(&xTimeSync, ulPressUs))
+        return;
+
+    ulReactTick = (ulPressUs - ulLedOnUs) >> TBCAN_TIME_TICK_SHIFT;
+    canMsg->bTimed = 1;
+    canMsg->usPressTick =
+        (uint16_t)(ulTbSyncToMaster(&xTimeSync, ulPressUs) >> TBCAN_TIME_TICK_SHIFT);
+    canMsg->usReactTick = ulReactTick > 0xFFFF ? 0xFFFF : (uint16_t)ulReactTick;
+}
+
 /*****************************************************************************/
 /**
  * Can MessageとLED Info変換
@@ -481,14 +1271,17 @@ byte bCanSendWrapper(canCommMsg_t canMsg, uint32_t canId)
  *
  * @return  ##
  *
- * @note    ##
+ * @note    点灯時間の割り算はここで1回だけ行う(フレーム毎は掛け算)
  *
  ******************************************************************************/
 void vConvCanMsg2LedInfo(canCommMsg_t *canMsg, ledInfo_t *ledinfo)
 {
-    ledinfo->ulColor =
-        SETCOLOR(canMsg->bColorInfoR, canMsg->bColorInfoG, canMsg->bColorInfoB);
-    ledinfo->lOffTimeMs = LIGHT_TIME_CONV_NUM * canMsg->bLightTime;
+    ledinfo->ulStartMs = millis();
+    ledinfo->usLightMs = canMsg->usLightTimeMs;
+    ledinfo->ulStepQ24 =
+        canMsg->usLightTimeMs == 0 ? 0 : (1UL << 24) / canMsg->usLightTimeMs;
+    ledinfo->bFade = canMsg->bFade;
+    ledinfo->bShown = false;
     ledinfo->bColorInfoR = canMsg->bColorInfoR;
     ledinfo->bColorInfoG = canMsg->bColorInfoG;
     ledinfo->bColorInfoB = canMsg->bColorInfoB;
@@ -502,76 +1295,410 @@ void vConvCanMsg2LedInfo(canCommMsg_t *canMsg, ledInfo_t *ledinfo)
  *
  * @return  ##
  *
- * @note    ##
+ * @note    全てのLEDを同じ色にする(出している色と同じならshow()しない)
  *
  ******************************************************************************/
 void vSerialLedLightUp(uint32_t ulColor)
 {
+    uint32_t *pulBack = tLedPix.ulPix[tLedPix.bFront ^ 1];
+
     // LED色セット
     for (uint16_t i = 0; i < LED_COUNT; i++)
     {
-        strip.setPixelColor(i, ulColor);
+        pulBack[i] = ulColor;
     }
     // LED点灯
+    bLedPixCommit();
+}
+
+/*****************************************************************************/
+/**
+ * 裏の面に書いた色を出す
+ *
+ * @param	##
+ *
+ * @return  true: show()した / false: 表と同じ(何もしない)
+ *
+ * @note    呼ぶ前に裏の面の全てのLEDを書くこと(入れ替えた後の裏は前の表のまま)
+ *
+ ******************************************************************************/
+bool bLedPixCommit()
+{
+    uint32_t *pulFront = tLedPix.ulPix[tLedPix.bFront];
+    uint32_t *pulBack = tLedPix.ulPix[tLedPix.bFront ^ 1];
+    bool bDirty = false;
+    uint8_t i;
+
+    for (i = 0; i < LED_COUNT; i++)
+    {
+        if (pulBack[i] != pulFront[i])
+            bDirty = true;
+    }
+    if (!bDirty)
+        return false;
+
+    for (i = 0; i < LED_COUNT; i++)
+        strip.setPixelColor(i, pulBack[i]);
     strip.show();
-    // Serial.print("[SerialLED] Send show Cmd: ");
-    // Serial.println(tLedinfo.ulColor);
+    tLedPix.bFront ^= 1;
+    return true;
+}
+
+/*****************************************************************************/
+/**
+ * LEDのフレームを更新する(loop()から呼ぶ)
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    点灯中だけPANEL_LED_FRAME_MS毎に明るさを計算し、色が変わったときだけshow()する。
+ *          計算とshow()のサイクル数(Timer1)の最大を残す
+ *
+ ******************************************************************************/
+void vPanelLedService()
+{
+    if (ePanelState == PANEL_ST_IDLE)
+        return;
+    if (millis() - ulLedFrameMs < PANEL_LED_FRAME_MS)
+        return;
+    if (ePanelState == PANEL_ST_ANIM)
+        vPanelAnimRender();
+    else if (ePanelState == PANEL_ST_PIXEL)
+        vPanelPixelRender();
+    else
+        vPanelLedRender();
+}
+
+/* 今の明るさで1フレーム出す */
+void vPanelLedRender()
+{
+    uint16_t usStartCyc;
+    uint16_t usCyc;
+    uint32_t ulColor;
+    uint8_t bGamma;
+
+    ulLedFrameMs = millis();
+    usStartCyc = TCNT1;
+    bGamma = pgm_read_byte(&bGammaTbl[bLedLevel(&tLedinfo, ulLedFrameMs)]);
+    ulColor = SETCOLOR(bLedScale(tLedinfo.bColorInfoR, bGamma),
+                       bLedScale(tLedinfo.bColorInfoG, bGamma),
+                       bLedScale(tLedinfo.bColorInfoB, bGamma));
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedCalcCycMax)
+        usLedCalcCycMax = usCyc;
+
+    if (tLedinfo.bShown && ulColor == tLedinfo.ulColor)
+        return;
+
+    usStartCyc = TCNT1;
+    vSerialLedLightUp(ulColor);
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedShowCycMax)
+        usLedShowCycMax = usCyc;
+
+    tLedinfo.ulColor = ulColor;
+    // 最初に点けた時刻(反応時間の起点)
+    if (!tLedinfo.bShown)
+    {
+        ulLedOnUs = micros();
+        bLedOnStamped = true;
+        tLedinfo.bShown = true;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * フェードカーブの明るさ
+ *
+ * @param	pxLed: LED情報
+ * @param   ulNowMs: 今の時刻[ms]
+ *
+ * @return  明るさ(0..255、ガンマ補正前)
+ *
+ * @note    位置(0..65535)は点灯してからの時間 * ulStepQ24 >> 8(割り算は点灯時に1回)。
+ *          PULSEはTBCAN_PULSE_PERIOD_MS毎に位置が一周する(16bitで切り捨て)
+ *
+ ******************************************************************************/
+uint8_t bLedLevel(ledInfo_t *pxLed, uint32_t ulNowMs)
+{
+    uint32_t ulElapsedMs = ulNowMs - pxLed->ulStartMs;
+    uint16_t usPos;
+    uint8_t bCurve;
+
+    switch (pxLed->bFade)
+    {
+    case TBCAN_FADE_HOLD:
+        return 0xFF;
+    case TBCAN_FADE_PULSE:
+        bCurve = LED_CURVE_PULSE;
+        usPos = (uint16_t)((ulElapsedMs * LED_PULSE_STEP_Q24) >> 8);
+        break;
+    case TBCAN_FADE_EASE_OUT:
+        bCurve = LED_CURVE_EASE_OUT;
+        usPos = ulElapsedMs >= pxLed->usLightMs
+                    ? 0xFFFF
+                    : (uint16_t)((ulElapsedMs * pxLed->ulStepQ24) >> 8);
+        break;
+    default:
+        bCurve = LED_CURVE_LINEAR;
+        usPos = ulElapsedMs >= pxLed->usLightMs
+                    ? 0xFFFF
+                    : (uint16_t)((ulElapsedMs * pxLed->ulStepQ24) >> 8);
+        break;
+    }
+
+    return bLedCurve(bCurve, usPos);
+}
+
+/* カーブの位置(0..65535)の明るさ(表の隣の点と直線補間) */
+uint8_t bLedCurve(uint8_t bCurve, uint16_t usPos)
+{
+    uint8_t bIdx = usPos >> LED_CURVE_IDX_SHIFT;
+    int16_t sFrac = (usPos >> LED_CURVE_FRAC_SHIFT) & LED_CURVE_FRAC_MASK;
+    int16_t sA = pgm_read_byte(&bCurveTbl[bCurve][bIdx]);
+    int16_t sB = pgm_read_byte(&bCurveTbl[bCurve][bIdx + 1]);
+
+    return (uint8_t)(sA + (((sB - sA) * sFrac) >> LED_CURVE_FRAC_BITS));
+}
+
+/* 色にガンマ補正した明るさを掛ける(255のときはそのまま) */
+uint8_t bLedScale(uint8_t bColor, uint8_t bGamma)
+{
+    return (uint8_t)(((uint16_t)bColor * (uint16_t)(bGamma + 1)) >> 8);
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションを始める(TBCAN_CMD_ANIM)
+ *
+ * @param	canRx: 受信したフレーム
+ *
+ * @return  ##
+ *
+ * @note    OFFはアニメーション中だけ消す(ゲームの点灯は消さない)。
+ *          開始時刻は同期しているときだけ使い、受信割り込みの時刻からの差で
+ *          自分の時計に直す(±2s)。過ぎていれば位相を進めた所から描く
+ *
+ ******************************************************************************/
+void vPanelAnimStart(canCommMsg_t *canRx)
+{
+    tbCanAnim_t *pxAnim = &canRx->xAnim;
+    uint8_t bRgb[3];
+    int32_t lDeltaUs;
+
+    if (pxAnim->bAnim == TBCAN_ANIM_OFF || pxAnim->bAnim >= TBCAN_ANIM_MAX)
+    {
+        if (ePanelState == PANEL_ST_ANIM)
+            vPanelEnter(PANEL_ST_IDLE);
+        return;
+    }
+    if (!bTbCanPalette(pxAnim->bColor, bRgb))
+    {
+        vPanelLog("[Error] Unknown anim color:", pxAnim->bColor);
+        return;
+    }
+
+    tAniminfo.bAnim = pxAnim->bAnim;
+    tAniminfo.bColorInfoR = bRgb[0];
+    tAniminfo.bColorInfoG = bRgb[1];
+    tAniminfo.bColorInfoB = bRgb[2];
+    tAniminfo.usPeriodMs = pxAnim->usPeriodMs;
+    tAniminfo.ulStepQ24 = (1UL << 24) / pxAnim->usPeriodMs;
+    tAniminfo.usDurationMs = pxAnim->usDurationMs;
+    tAniminfo.bCol = (ulPanelId - 1) % PANEL_GRID_SIZE;
+    tAniminfo.ulStartMs = millis();
+    if (pxAnim->bTimed && bTbSyncLocked(&xTimeSync, canRx->ulRxUs))
+    {
+        lDeltaUs = (int16_t)(pxAnim->usStartTick -
+                             (uint16_t)(ulTbSyncToMaster(&xTimeSync, canRx->ulRxUs) >>
+                                        TBCAN_TIME_TICK_SHIFT));
+        lDeltaUs = lDeltaUs * (1L << TBCAN_TIME_TICK_SHIFT) - (int32_t)(micros() - canRx->ulRxUs);
+        tAniminfo.ulStartMs += lDeltaUs / 1000;
+    }
+
+    bCanMsgDeferred = false;
+    vPanelEnter(PANEL_ST_ANIM);
+}
+
+/* 続ける時間が過ぎたか(開始前は過ぎていない) */
+bool bPanelAnimExpired()
+{
+    int32_t lElapsedMs = (int32_t)(millis() - tAniminfo.ulStartMs);
+
+    return tAniminfo.usDurationMs != 0 && lElapsedMs >= (int32_t)tAniminfo.usDurationMs;
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションの1フレームを出す
+ *
+ * @param	##
+ *
+ * @return  ##
+ *
+ * @note    位相(0..65535)は開始からの時間を周期で割った余り * ulStepQ24 >> 8。
+ *          開始前は消灯。LED毎に色を裏の面へ書き、どれかが変わったときだけshow()する。
+ *          計算とshow()のサイクル数はフェードと同じ最大に残す
+ *
+ ******************************************************************************/
+void vPanelAnimRender()
+{
+    uint16_t usStartCyc;
+    uint16_t usCyc;
+    uint32_t *pulBack = tLedPix.ulPix[tLedPix.bFront ^ 1];
+    int32_t lElapsedMs;
+    uint16_t usPos;
+    uint8_t i;
+
+    ulLedFrameMs = millis();
+    usStartCyc = TCNT1;
+    lElapsedMs = (int32_t)(ulLedFrameMs - tAniminfo.ulStartMs);
+    usPos = lElapsedMs < 0 ? 0
+                           : (uint16_t)(((uint32_t)lElapsedMs % tAniminfo.usPeriodMs *
+                                         tAniminfo.ulStepQ24) >> 8);
+    for (i = 0; i < LED_COUNT; i++)
+    {
+        pulBack[i] = lElapsedMs < 0 ? sColorTbl[NOLIGHT].ulColor
+                                    : ulAnimPixel(&tAniminfo, usPos, i);
+    }
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedCalcCycMax)
+        usLedCalcCycMax = usCyc;
+
+    usStartCyc = TCNT1;
+    if (!bLedPixCommit())
+        return;
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedShowCycMax)
+        usLedShowCycMax = usCyc;
+}
+
+/*****************************************************************************/
+/**
+ * アニメーションのLED1つの色
+ *
+ * @param	pxAnim: アニメーション情報
+ * @param   usPos: 位相(0..65535)
+ * @param   bPixel: LEDの番号
+ *
+ * @return  色(*.Colorクラス)
+ *
+ * @note    明るさはフェードと同じカーブの表を使い、ガンマ補正して色に掛ける。
+ *          RAINBOWは色相環の色に、指示された色の一番明るい成分を掛ける
+ *
+ ******************************************************************************/
+uint32_t ulAnimPixel(animInfo_t *pxAnim, uint16_t usPos, uint8_t bPixel)
+{
+    uint8_t bLevel;
+    uint8_t bGamma;
+    uint8_t bHue;
+    uint8_t bR = pxAnim->bColorInfoR;
+    uint8_t bG = pxAnim->bColorInfoG;
+    uint8_t bB = pxAnim->bColorInfoB;
+
+    switch (pxAnim->bAnim)
+    {
+    case TBCAN_ANIM_PULSE:
+        bLevel = bLedCurve(LED_CURVE_EASE_OUT, usPos);
+        break;
+    case TBCAN_ANIM_BREATHE:
+        bLevel = bLedCurve(LED_CURVE_PULSE, usPos);
+        break;
+    case TBCAN_ANIM_CHASE:
+        // 先頭から後ろへ減衰する尾を引く
+        bLevel = bLedCurve(LED_CURVE_EASE_OUT, (uint16_t)(usPos - bPixel * LED_PIXEL_POS_STEP));
+        break;
+    case TBCAN_ANIM_STROBE:
+        bLevel = usPos < LED_STROBE_ON_POS ? 0xFF : 0;
+        break;
+    case TBCAN_ANIM_SWEEP:
+        bLevel = bLedCurve(LED_CURVE_EASE_OUT, (uint16_t)(usPos - pxAnim->bCol * LED_COL_POS_STEP));
+        break;
+    case TBCAN_ANIM_RAINBOW:
+        bLevel = bR > bG ? bR : bG;
+        bLevel = bLevel > bB ? bLevel : bB;
+        bHue = (uint8_t)((usPos >> 8) + bPixel * LED_HUE_PIXEL_STEP);
+        // 色相環(R -> G -> B -> R)を3区間の直線で
+        if (bHue < 85)
+        {
+            bR = 255 - bHue * 3;
+            bG = bHue * 3;
+            bB = 0;
+        }
+        else if (bHue < 170)
+        {
+            bHue -= 85;
+            bR = 0;
+            bG = 255 - bHue * 3;
+            bB = bHue * 3;
+        }
+        else
+        {
+            bHue -= 170;
+            bR = bHue * 3;
+            bG = 0;
+            bB = 255 - bHue * 3;
+        }
+        break;
+    default:
+        bLevel = 0;
+        break;
+    }
+
+    bGamma = pgm_read_byte(&bGammaTbl[bLevel]);
+    return SETCOLOR(bLedScale(bR, bGamma), bLedScale(bG, bGamma), bLedScale(bB, bGamma));
 }
 
 /*****************************************************************************/
 /**
- * Serial LEDのタイマ割り込み関数
+ * LED毎の色を出し始める(TBCAN_CMD_PIXELのフレームが揃った)
  *
  * @param	##
  *
  * @return  ##
  *
- * @note    実行毎に以下のパラメータを変更します。
- *          tLedinfo.lOffTimeMs: (OffTimeMs / LED_SEND_INTERVAL_MS)ずつ減算
- *          tLedinfo.ulColor   : (格納された情報(r,g,b) /
- *消灯時間)ずつ減算※未実装
- *
- ******************************************************************************/
-void vSerialLedIntrHandler()
-{
-    interrupts();
-    // Serial.print("[SerialLED] Timer Handle Color:");
-    // Serial.print(tLedinfo.ulColor);
-    // Serial.print(" OffTimeMs:");
-    // Serial.println(tLedinfo.lOffTimeMs);
-
-    // 消灯時間が0でなければ
-    if (tLedinfo.lOffTimeMs > 0)
-    {
-
-        // LED点灯
-        vSerialLedLightUp(SETCOLOR(tLedinfo.bColorInfoR, tLedinfo.bColorInfoG,
-                                   tLedinfo.bColorInfoB));
-
-        // LED光量計算
-        if (tLedinfo.bColorInfoR > 0)
-            tLedinfo.bColorInfoR -=
-                (canMsg.bColorInfoR /
-                 ((LIGHT_TIME_CONV_NUM / SERIAL_LED_SEND_INTERVAL_MS) *
-                  canMsg.bLightTime));
-        if (tLedinfo.bColorInfoG > 0)
-            tLedinfo.bColorInfoG -=
-                (canMsg.bColorInfoG /
-                 ((LIGHT_TIME_CONV_NUM / SERIAL_LED_SEND_INTERVAL_MS) *
-                  canMsg.bLightTime));
-        if (tLedinfo.bColorInfoB > 0)
-            tLedinfo.bColorInfoB -=
-                (canMsg.bColorInfoB /
-                 ((LIGHT_TIME_CONV_NUM / SERIAL_LED_SEND_INTERVAL_MS) *
-                  canMsg.bLightTime));
-    }
-    else if (tLedinfo.lOffTimeMs <= 0)
-    {
-        // タイマをストップ
-        MsTimer2::stop();
-        vSerialLedLightUp(sColorTbl[NOLIGHT].ulColor);
-        Serial.println("[Timer] Stop Timer.");
-    }
-    // 消灯時間を呼び出し毎に減算
-    tLedinfo.lOffTimeMs -= SERIAL_LED_SEND_INTERVAL_MS;
-}
\ No newline at end of file
+ * @note    色はxPixelInfo(次に揃うまで書き換わらない)。
+ *          点灯時間とフェードは1色の点灯と同じくtLedinfoで数える(時間切れでIDLE)
+ *
+ ******************************************************************************/
+void vPanelPixelStart()
+{
+    tLedinfo.ulStartMs = millis();
+    tLedinfo.usLightMs = xPixelInfo.usLightMs;
+    tLedinfo.ulStepQ24 = xPixelInfo.usLightMs == 0 ? 0 : (1UL << 24) / xPixelInfo.usLightMs;
+    tLedinfo.bFade = xPixelInfo.bFade;
+
+    bCanMsgDeferred = false;
+    vPanelEnter(PANEL_ST_PIXEL);
+}
+
+/* LED毎の色に今の明るさを掛けて1フレーム出す */
+void vPanelPixelRender()
+{
+    uint16_t usStartCyc;
+    uint16_t usCyc;
+    uint32_t *pulBack = tLedPix.ulPix[tLedPix.bFront ^ 1];
+    uint8_t bGamma;
+    uint8_t i;
+
+    ulLedFrameMs = millis();
+    usStartCyc = TCNT1;
+    bGamma = pgm_read_byte(&bGammaTbl[bLedLevel(&tLedinfo, ulLedFrameMs)]);
+    for (i = 0; i < LED_COUNT; i++)
+    {
+        pulBack[i] = SETCOLOR(bLedScale(xPixelInfo.bRgb[i][0], bGamma),
+                              bLedScale(xPixelInfo.bRgb[i][1], bGamma),
+                              bLedScale(xPixelInfo.bRgb[i][2], bGamma));
+    }
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedCalcCycMax)
+        usLedCalcCycMax = usCyc;
+
+    usStartCyc = TCNT1;
+    if (!bLedPixCommit())
+        return;
+    usCyc = TCNT1 - usStartCyc;
+    if (usCyc > usLedShowCycMax)
+        usLedShowCycMax = usCyc;
+}